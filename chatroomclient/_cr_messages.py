@@ -4,6 +4,7 @@ receiving messages from the chat room server.
 """
 
 import struct
+import zlib
 
 from vardorvis_cmd.vardorvis_cmd import VardorvisCmd
 
@@ -32,6 +33,10 @@ ADMIN_REMOVE_STYPE = 9
 LEAVE_STYPE = 10
 LOGOUT_STYPE = 11
 QUIT_STYPE = 12
+VERSION_STYPE = 13
+COMPRESS_STYPE = 14
+STATS_STYPE = 15
+RESUME_STYPE = 16
 
 # opcodes
 REQUEST = 0
@@ -105,6 +110,27 @@ REGISTER_REQ = "BBB31s31s"  # ACCOUNT_TYPE, REGISTER_STYPE, REQUEST, username, p
 BUFF_SIZE = 1024
 MESG_SIZE = 4
 
+# Protocol versions. v1 sends the fixed size packets below, one per recv. v2 prefixes every
+# packet with a varint length and packs username/password/room/chat fields as a varint length
+# plus bytes.
+PROTOCOL_V1 = 1
+PROTOCOL_V2 = 2
+MAX_VARINT_LEN = 10
+
+# Compression (v2 only). With zlib the room history and room list are sent as a varint original
+# length followed by a zlib stream primed with COMPRESS_DICTIONARY, which must match the server's
+# dictionary in cr_compress.c byte for byte.
+COMPRESS_NONE = 0
+COMPRESS_ZLIB = 1
+COMPRESS_DICTIONARY = (
+    b"what when just know think about would there some will this that with "
+    b"have from your they been good like yeah okay thanks sure time "
+    b"room\nchat\ngeneral\nrandom\n"
+    b"0123456789 the you and for are not but can was all "
+    b">User has left the room\n"
+    b">User has joined the room\n"
+)
+
 
 def register_req_create(username: str, password: str) -> bytes:
     """
@@ -270,12 +296,13 @@ def list_req_create() -> bytes:
 
 
 # Room join packets.
-JOIN_REQ = "BBB31s"  # ROOMS_TYPE, JOIN_STYPE, REQUEST
+JOIN_REQ = ">BBB31sQ"  # ROOMS_TYPE, JOIN_STYPE, REQUEST, room name, since sequence number
 
 
-def join_req_create(room_name: str) -> bytes:
+def join_req_create(room_name: str, since: int = 0) -> bytes:
     """
     Create a byte array that meets room join request packet format.
+    since is the last chat sequence number held for the room, 0 requests the full history.
     """
     if len(room_name) > MAX_NAME_LEN:
         raise NameError("Room name must be 30 characters or less.")
@@ -283,11 +310,36 @@ def join_req_create(room_name: str) -> bytes:
     mesg_username = room_name.ljust((MAX_NAME_LEN + 1), "\0")
     bytes_username = mesg_username.encode("UTF-8")
 
-    message = (ROOMS_TYPE, JOIN_STYPE, REQUEST, bytes_username)
+    message = (ROOMS_TYPE, JOIN_STYPE, REQUEST, bytes_username, since)
 
     return struct.pack(JOIN_REQ, *message)
 
 
+# Room join acknowledge header: ROOMS_TYPE, JOIN_STYPE, ACKNOWLEDGE, room sequence number,
+# history length. The log lines ("<seq> <username>><chat>\n") newer than since follow.
+JOIN_ACK = ">BBBQH"
+JOIN_ACK_SIZE = struct.calcsize(JOIN_ACK)
+
+
+def join_ack_unpack(received_messsage: bytes):
+    """
+    Unpacks a join acknowledge packet. Returns the room sequence number, the history lines
+    as (seq, username>chat) tuples, and any bytes received after the history.
+    """
+    _, _, _, room_seq, history_len = struct.unpack(
+        JOIN_ACK, received_messsage[:JOIN_ACK_SIZE]
+    )
+    history_end = JOIN_ACK_SIZE + history_len
+    history = []
+
+    for line in received_messsage[JOIN_ACK_SIZE:history_end].decode("UTF-8").split("\n"):
+        seq, _, message = line.partition(" ")
+        if seq.isdigit() and message:
+            history.append((int(seq), message))
+
+    return room_seq, history, received_messsage[history_end:]
+
+
 # Chat packets.
 CHAT_REQ = "BBB151s"  # CHAT_TYPE, CHAT_STYPE, REQUEST. more data will follow with chat.
 
@@ -307,6 +359,22 @@ def chat_req_create(chat: str) -> bytes:
     return struct.pack(CHAT_REQ, *message)
 
 
+# Chat update packets: CHAT_TYPE, CHAT_STYPE, ACKNOWLEDGE, sequence number, username>chat.
+# Room notices (joins/leaves) are not logged and carry sequence number 0. The client's own chats
+# come back in the same layout with RESPONSE as the opcode.
+CHAT_UPDATE = ">BBBQ182s"
+CHAT_UPDATE_SIZE = struct.calcsize(CHAT_UPDATE)
+
+
+def chat_update_unpack(received_messsage: bytes):
+    """
+    Unpacks a chat update packet. Returns the sequence number and the username>chat text.
+    """
+    _, _, _, seq, chat = struct.unpack(CHAT_UPDATE, received_messsage[:CHAT_UPDATE_SIZE])
+
+    return seq, chat.rstrip(b"\0").decode("UTF-8").replace("\0", "")
+
+
 # Chat leave packets.
 LEAVE_REQ = "BBB"  # CHAT_TYPE, LEAVE_STYPE, REQUEST.
 
@@ -333,6 +401,274 @@ def quit_req_create() -> bytes:
     return struct.pack(LEAVE_REQ, *message)
 
 
+# Protocol version packets.
+VERSION_REQ = "BBBB"  # SESSION_TYPE, VERSION_STYPE, REQUEST, version
+
+
+def version_req_create(version: int) -> bytes:
+    """
+    Create a byte array that meets protocol version request packet format.
+    """
+    message = (SESSION_TYPE, VERSION_STYPE, REQUEST, version)
+
+    return struct.pack(VERSION_REQ, *message)
+
+
+# Compression packets.
+COMPRESS_REQ = "BBBB"  # SESSION_TYPE, COMPRESS_STYPE, REQUEST, algorithm
+
+
+def compress_req_create(algorithm: int) -> bytes:
+    """
+    Create a byte array that meets compression request packet format.
+    """
+    message = (SESSION_TYPE, COMPRESS_STYPE, REQUEST, algorithm)
+
+    return struct.pack(COMPRESS_REQ, *message)
+
+
+
+# Stats packets.
+STATS_REQ = "BBB"  # SESSION_TYPE, STATS_STYPE, REQUEST
+
+
+def stats_req_create() -> bytes:
+    """
+    Create a byte array that meets stats request packet format.
+    """
+    message = (SESSION_TYPE, STATS_STYPE, REQUEST)
+
+    return struct.pack(STATS_REQ, *message)
+
+
+# Stats acknowledge: SESSION_TYPE, STATS_STYPE, ACKNOWLEDGE, uptime, sessions, sessions waiting,
+# flush pending, pool threads, dispatch permille, users logged in, rate window, requests and chats
+# in the window, request, chat, byte in and byte out totals, room count. room count entries of
+# room name, members, chats in the window and chat total follow, busiest room first.
+STATS_ACK = ">BBBIHHHHHHBIIQQQQB"
+STATS_ACK_SIZE = struct.calcsize(STATS_ACK)
+STATS_ROOM = ">31sHIQ"
+STATS_ROOM_SIZE = struct.calcsize(STATS_ROOM)
+STATS_FIELDS = (
+    "uptime_s",
+    "sessions",
+    "sessions_waiting",
+    "flush_pending",
+    "pool_threads",
+    "dispatch_permille",
+    "users_logged_in",
+    "rate_window_s",
+    "requests_window",
+    "chats_window",
+    "requests_total",
+    "chats_total",
+    "bytes_in",
+    "bytes_out",
+)
+
+
+# Resume notice: SESSION_TYPE, RESUME_STYPE, ACKNOWLEDGE. The last packet sent by a server that is
+# handing its connections to a new process. The client ends TLS and handshakes again on the same
+# connection.
+RESUME_ACK = "BBB"
+RESUME_NOTICE = struct.pack(RESUME_ACK, SESSION_TYPE, RESUME_STYPE, ACKNOWLEDGE)
+
+
+def stats_ack_unpack(received_messsage: bytes):
+    """
+    Unpacks a stats acknowledge packet. Returns a dict of the server numbers, the rooms as
+    (name, members, chats in the window, chat total) tuples, and any bytes received after them.
+    """
+    fields = struct.unpack(STATS_ACK, received_messsage[:STATS_ACK_SIZE])
+    stats = dict(zip(STATS_FIELDS, fields[3:-1]))
+    rooms = []
+    offset = STATS_ACK_SIZE
+
+    for _ in range(fields[-1]):
+        name, members, chats_window, chats_total = struct.unpack(
+            STATS_ROOM, received_messsage[offset : offset + STATS_ROOM_SIZE]
+        )
+        rooms.append(
+            (name.split(b"\0", 1)[0].decode("UTF-8"), members, chats_window, chats_total)
+        )
+        offset += STATS_ROOM_SIZE
+
+    return stats, rooms, received_messsage[offset:]
+
+def varint_encode(value: int) -> bytes:
+    """
+    Encodes an unsigned int as a little endian base 128 varint.
+    """
+    encoded = bytearray()
+
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            encoded.append(byte | 0x80)
+        else:
+            encoded.append(byte)
+            return bytes(encoded)
+
+
+def varint_decode(data: bytes, offset: int = 0):
+    """
+    Decodes a varint at offset. Returns (value, new offset), or (None, offset) if the varint
+    isn't complete yet. Raises ValueError if it is too long.
+    """
+    value = 0
+
+    for index in range(MAX_VARINT_LEN):
+        if offset + index >= len(data):
+            return None, offset
+
+        byte = data[offset + index]
+        value |= (byte & 0x7F) << (7 * index)
+
+        if not byte & 0x80:
+            return value, offset + index + 1
+
+    raise ValueError("varint too long")
+
+
+def _pack_string(field: bytes) -> bytes:
+    """
+    Packs a NULL padded v1 field as a v2 string field.
+    """
+    field = field.split(b"\0", 1)[0]
+    return varint_encode(len(field)) + field
+
+
+def frame_encode(packet: bytes) -> bytes:
+    """
+    Converts a v1 request packet (built by the *_req_create functions) to a v2 frame.
+    """
+    packet_type, subtype, _ = struct.unpack(RECVD_MSG, packet[:3])
+    payload = packet[:3]
+
+    if packet_type == ACCOUNT_TYPE and subtype in {REGISTER_STYPE, LOGIN_STYPE}:
+        _, _, _, username, password = struct.unpack(REGISTER_REQ, packet)
+        payload += _pack_string(username) + _pack_string(password)
+    elif packet_type == ACCOUNT_TYPE and subtype in {DEL_STYPE, ADMIN_STYPE, ADMIN_REMOVE_STYPE}:
+        payload += _pack_string(struct.unpack(DELETE_REQ, packet)[3])
+    elif packet_type == ROOMS_TYPE and subtype in {CREATE_STYPE, DEL_STYPE}:
+        payload += _pack_string(struct.unpack(ROOM_REQ, packet)[3])
+    elif packet_type == ROOMS_TYPE and subtype == JOIN_STYPE:
+        _, _, _, room_name, since = struct.unpack(JOIN_REQ, packet)
+        payload += _pack_string(room_name) + varint_encode(since)
+    elif packet_type == CHAT_TYPE and subtype == CHAT_STYPE:
+        payload += _pack_string(struct.unpack(CHAT_REQ, packet)[3])
+    else:
+        payload = packet
+
+    return varint_encode(len(payload)) + payload
+
+
+def _unpack_string(payload: bytes, offset: int):
+    """
+    Reads a v2 string field. Returns (bytes, new offset).
+    """
+    length, offset = varint_decode(payload, offset)
+
+    if length is None or offset + length > len(payload):
+        raise ValueError("string field truncated")
+
+    return payload[offset : offset + length], offset + length
+
+
+def _unpack_file(payload: bytes, offset: int, compression: int) -> bytes:
+    """
+    Reads the room history or room list at the end of a v2 payload, decompressing it if
+    compression was negotiated.
+    """
+    if compression != COMPRESS_ZLIB:
+        return payload[offset:]
+
+    length, offset = varint_decode(payload, offset)
+
+    if length is None:
+        raise ValueError("file length truncated")
+
+    if length == 0:
+        return b""
+
+    inflater = zlib.decompressobj(zdict=COMPRESS_DICTIONARY)
+    data = inflater.decompress(payload[offset:], length)
+
+    if len(data) != length:
+        raise ValueError("file length mismatch")
+
+    return data
+
+
+def frame_payload_expand(payload: bytes, compression: int = COMPRESS_NONE) -> bytes:
+    """
+    Expands a v2 payload received from the server to the v1 packet layout, so the rest of
+    the client handles both versions the same way.
+    """
+    packet_type, subtype, opcode = struct.unpack(RECVD_MSG, payload[:3])
+
+    if opcode not in (ACKNOWLEDGE, RESPONSE):
+        return payload
+
+    if packet_type == CHAT_TYPE and subtype == CHAT_STYPE:
+        seq, offset = varint_decode(payload, 3)
+        username, offset = _unpack_string(payload, offset)
+        chat, offset = _unpack_string(payload, offset)
+        body = username.ljust(MAX_NAME_LEN, b"\0") + b">" + chat
+        return struct.pack(CHAT_UPDATE, packet_type, subtype, opcode, seq, body)
+
+    if opcode != ACKNOWLEDGE:
+        return payload
+
+    if packet_type == ROOMS_TYPE and subtype == JOIN_STYPE:
+        seq, offset = varint_decode(payload, 3)
+        history = _unpack_file(payload, offset, compression)
+        return struct.pack(JOIN_ACK, packet_type, subtype, opcode, seq, len(history)) + history
+
+    if packet_type == ROOMS_TYPE and subtype == LIST_STYPE:
+        return payload[:3] + _unpack_file(payload, 3, compression)
+
+    return payload
+
+
+class FrameDecoder:
+    """
+    Incremental v2 frame decoder. Bytes are fed in as they are received, and complete frames
+    are queued (expanded to the v1 layout) in packets. Partial frames are kept until the
+    rest arrives.
+    """
+
+    def __init__(self):
+        self.buffer = b""
+        self.packets = []
+        self.compression = COMPRESS_NONE
+
+    def feed(self, data: bytes):
+        """
+        Adds received bytes and queues every complete frame.
+        """
+        self.buffer += data
+
+        while True:
+            length, offset = varint_decode(self.buffer)
+
+            if length is None or offset + length > len(self.buffer):
+                return
+
+            self.packets.append(
+                frame_payload_expand(self.buffer[offset : offset + length], self.compression)
+            )
+            self.buffer = self.buffer[offset + length :]
+
+    def take(self) -> list:
+        """
+        Returns and clears the queued packets.
+        """
+        packets, self.packets = self.packets, []
+        return packets
+
+
 # Failure packet.
 FAIL_REJ = "BBBB"  # FAIL_TYPE, FAIL_STYPE, REJECT, reason code
 
@@ -31,8 +31,9 @@ class ChatRoomState:
         self.chatting_status = NOT_CHATTING
         self.username = ""
         self.room = ""
-        self.last_msg_recvd = ""
-        self.chat_history = ""
+        self.room_seqs = {}
+        self.room_history = {}
+        self.update_buffer = b""
         self.quit_leave_notifcation = None
         self.ssl_socket = ssl_socket
         self.socket_cond = None
@@ -75,14 +76,36 @@ class ChatRoomState:
 
         return False
 
-    def enter_room(self, room: str, chat_history: str):
+    def enter_room(self, room: str, room_seq: int, history: list):
         """
         Updates the chatting status to CHATTING.
-        Sets room name.
+        Sets room name and merges the history tail received on join into the cached history.
         """
+        # NOTE: A room sequence number lower than the one held means the room was recreated on
+        # the server, and the full history of the new room was sent.
+        if room_seq < self.room_seqs.get(room, 0):
+            self.room_history[room] = []
+
         self.chatting_status = CHATTING
         self.room = room
-        self.chat_history = chat_history
+        self.room_seqs[room] = room_seq
+        self.room_history.setdefault(room, []).extend(message for _, message in history)
+        self.update_buffer = b""
+
+    def record_chat(self, seq: int, message: str) -> bool:
+        """
+        Records a chat update for the current room. Returns False if the update was already
+        received (the server resent it), True otherwise. Room notices (seq 0) are not recorded.
+        """
+        if seq == 0:
+            return True
+
+        if seq <= self.room_seqs.get(self.room, 0):
+            return False
+
+        self.room_seqs[self.room] = seq
+        self.room_history.setdefault(self.room, []).append(message)
+        return True
 
     def leave_room(self):
         """
@@ -38,7 +38,13 @@ class ChatRoomClient(VardorvisCmd):
     Chat Room Client class.
     """
 
-    def __init__(self, hostname: str = "127.0.0.1", port: int = 1234):
+    def __init__(
+        self,
+        hostname: str = "127.0.0.1",
+        port: int = 1234,
+        protocol_version: int = _cr_messages.PROTOCOL_V2,
+        compression: int = _cr_messages.COMPRESS_ZLIB,
+    ):
         super().__init__()
         self.intro = colored(ASCII_ART, "yellow", attrs=["bold"])
         self.prompt = colored("[NOT LOGGED IN]> ", "yellow", attrs=["bold"])
@@ -55,6 +61,16 @@ class ChatRoomClient(VardorvisCmd):
         # latency is worse than this, you should consider using email instead.
         self.server_addr = (hostname, port)
 
+        # NOTE: The highest protocol version to ask the server for. Servers that don't know about
+        # versions reject the request, and the client stays on v1.
+        self.requested_version = protocol_version
+        self.protocol_version = _cr_messages.PROTOCOL_V1
+        self.frame_decoder = _cr_messages.FrameDecoder()
+
+        # NOTE: Compression to ask for once on v2. The server answers with the algorithm it will
+        # use, which may be none.
+        self.requested_compression = compression
+
         # WARNING: The socket does not check the hostname and doesn't check for a valid certificate.
         # This is done as the chat room server has a self-signed certificate and will not pass the
         # verification process. A vlid certificate would need to be acquired by registering the
@@ -84,6 +100,138 @@ class ChatRoomClient(VardorvisCmd):
         self.server_socket = socket.create_connection(self.server_addr)
         self.ssl_socket = self.ssl_context.wrap_socket(self.server_socket)
         self.ssl_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.ssl_socket.settimeout(5)
+        self.negotiate_version()
+        self.negotiate_compression()
+
+    def negotiate_version(self):
+        """
+        Asks the server for the requested protocol version and switches to the version it
+        acknowledges. v1 is asked for too, so the server knows the join requests carry the
+        since field.
+        """
+        self.ssl_socket.sendall(_cr_messages.version_req_create(self.requested_version))
+        received_messsage = self.recv_packet()
+
+        if len(received_messsage) == _cr_messages.MESG_SIZE and tuple(
+            received_messsage[:3]
+        ) == (
+            _cr_messages.SESSION_TYPE,
+            _cr_messages.VERSION_STYPE,
+            _cr_messages.ACKNOWLEDGE,
+        ):
+            self.protocol_version = received_messsage[3]
+
+    def negotiate_compression(self):
+        """
+        Asks the server to compress room histories and room lists. Only available on v2.
+        """
+        if (
+            self.protocol_version != _cr_messages.PROTOCOL_V2
+            or self.requested_compression == _cr_messages.COMPRESS_NONE
+        ):
+            return
+
+        self.send_packet(_cr_messages.compress_req_create(self.requested_compression))
+        received_messsage = self.recv_packet()
+
+        if len(received_messsage) == _cr_messages.MESG_SIZE and tuple(
+            received_messsage[:3]
+        ) == (
+            _cr_messages.SESSION_TYPE,
+            _cr_messages.COMPRESS_STYPE,
+            _cr_messages.ACKNOWLEDGE,
+        ):
+            self.frame_decoder.compression = received_messsage[3]
+
+    def resume(self):
+        """
+        Moves to the new server after a resume notice. Ends TLS with the old server and runs
+        a new handshake on the same connection. The protocol version and compression carry
+        over, the new server keeps the login and room.
+        """
+        self.ssl_socket.settimeout(5)
+        plain_socket = self.ssl_socket.unwrap()
+        self.ssl_socket = self.ssl_context.wrap_socket(plain_socket)
+        self.ssl_socket.settimeout(5)
+        self.cr_state.ssl_socket = self.ssl_socket
+
+    def send_packet(self, packet: bytes):
+        """
+        Sends a v1 packet to the server, framing it first if v2 was negotiated.
+        """
+        if self.protocol_version == _cr_messages.PROTOCOL_V2:
+            packet = _cr_messages.frame_encode(packet)
+
+        self.ssl_socket.sendall(packet)
+
+    def recv_packet(self, size: int = _cr_messages.MESG_SIZE) -> bytes:
+        """
+        Receives one packet from the server. In v1 that's a single recv of up to size bytes.
+        In v2 it reads until a whole frame has arrived and returns it in the v1 layout.
+        """
+        if self.protocol_version != _cr_messages.PROTOCOL_V2:
+            received_messsage = self.ssl_socket.recv(size)
+
+            # NOTE: The notice is the last packet from the old server, the response comes from
+            # the new one.
+            if received_messsage == _cr_messages.RESUME_NOTICE:
+                self.resume()
+                received_messsage = self.ssl_socket.recv(size)
+
+            return received_messsage
+
+        while True:
+            while not self.frame_decoder.packets:
+                chunk = self.ssl_socket.recv(_cr_messages.MESG_SIZE + _cr_messages.BUFF_SIZE)
+
+                if not chunk:
+                    return b""
+
+                self.frame_decoder.feed(chunk)
+
+            received_messsage = self.frame_decoder.packets.pop(0)
+
+            if received_messsage != _cr_messages.RESUME_NOTICE:
+                return received_messsage
+
+            self.resume()
+
+    def recv_gathered(self) -> bytes:
+        """
+        Receives a response that carries a file (room list, room history). v1 has no length,
+        so it reads until the server goes quiet. v2 reads a single frame.
+        """
+        if self.protocol_version == _cr_messages.PROTOCOL_V2:
+            return self.recv_packet()
+
+        received_messsage = b""
+        # NOTE: Set timeout to 0.5 seconds to ensure we don't wait too long for a response.
+        # Most responses won't require more than one buffer size but the packets should come
+        # at about the same time anyways.
+        self.ssl_socket.settimeout(0.5)
+
+        try:
+            while True:
+                chunk = self.ssl_socket.recv(
+                    _cr_messages.MESG_SIZE + _cr_messages.BUFF_SIZE
+                )
+
+                if not chunk:
+                    break
+
+                # NOTE: The rest of the response comes from the new server.
+                if not received_messsage and chunk.startswith(_cr_messages.RESUME_NOTICE):
+                    self.resume()
+                    self.ssl_socket.settimeout(0.5)
+                    chunk = chunk[len(_cr_messages.RESUME_NOTICE) :]
+
+                received_messsage += chunk
+        except TimeoutError:
+            # Return timeout to normal
+            self.ssl_socket.settimeout(5)
+
+        return received_messsage
 
     def _monitor_socket(self):
         """
@@ -104,34 +252,64 @@ class ChatRoomClient(VardorvisCmd):
             received_messsage = self.ssl_socket.recv(
                 _cr_messages.MESG_SIZE + _cr_messages.BUFF_SIZE
             )
-            packet_type, subtype, opcode, _ = _cr_messages.cr_recv_unpack(
-                received_messsage, self
-            )
 
-            if (
-                packet_type == _cr_messages.CHAT_TYPE
-                and subtype == _cr_messages.CHAT_STYPE
-                and opcode == _cr_messages.ACKNOWLEDGE
-            ):
+            resume = False
 
-                # NOTE: It's possible for the server to resend a message and this block ensures
-                # that the same message is not printed more than once.
-                if self.cr_state.last_msg_recvd != received_messsage[3:].decode(
-                    "UTF-8"
-                ):
-                    self.cr_state.last_msg_recvd = received_messsage[3:].decode("UTF-8")
+            # NOTE: v2 frames are expanded to the v1 layout, so updates are handled the same way.
+            if self.protocol_version == _cr_messages.PROTOCOL_V2:
+                self.frame_decoder.feed(received_messsage)
+                packets = self.frame_decoder.take()
+                resume = _cr_messages.RESUME_NOTICE in packets
+                received_messsage = b"".join(
+                    packet for packet in packets if packet != _cr_messages.RESUME_NOTICE
+                )
+
+            self.cr_state.update_buffer += received_messsage
+
+            # NOTE: If the chats haven't been refreshed in a while (by the client user), then it's
+            # possible that recv will take more than one chat in at a time, or part of one. Updates
+            # are fixed size, so complete ones are handled and the rest is kept for the next recv.
+            while len(self.cr_state.update_buffer) >= _cr_messages.CHAT_UPDATE_SIZE:
+                received_messsage = self.cr_state.update_buffer[
+                    : _cr_messages.CHAT_UPDATE_SIZE
+                ]
+                self.cr_state.update_buffer = self.cr_state.update_buffer[
+                    _cr_messages.CHAT_UPDATE_SIZE :
+                ]
+                packet_type, subtype, opcode, _ = _cr_messages.cr_recv_unpack(
+                    received_messsage, self
+                )
 
-                    # NOTE: If the chats haven't been refreshed in a while (by the client user),
-                    # then it's possible that recv will take more than one chat in at a time. To
-                    # ensure all chats are printed on their own line, we'll split the received
-                    # message by the header.
-                    split_pattern = b"\x02\x06\x03"
-                    received_messsage = received_messsage[3:].decode("UTF-8")
-                    messages = received_messsage.split(split_pattern.decode("UTF-8"))
+                if (
+                    packet_type == _cr_messages.CHAT_TYPE
+                    and subtype == _cr_messages.CHAT_STYPE
+                    and opcode == _cr_messages.ACKNOWLEDGE
+                ):
+                    seq, message = _cr_messages.chat_update_unpack(received_messsage)
 
-                    for message in messages:
+                    # NOTE: It's possible for the server to resend a message, the sequence
+                    # number ensures that the same message is not printed more than once.
+                    if self.cr_state.record_chat(seq, message):
                         self.async_alert(_format_line(message))
-                        self.cr_state.last_msg_recvd = message
+                elif (
+                    packet_type == _cr_messages.CHAT_TYPE
+                    and subtype == _cr_messages.CHAT_STYPE
+                    and opcode == _cr_messages.RESPONSE
+                ):
+                    # NOTE: The client's own chat, already on screen. Recording it with its
+                    # sequence number keeps it from coming back in the next join's history.
+                    seq, message = _cr_messages.chat_update_unpack(received_messsage)
+                    self.cr_state.record_chat(seq, message)
+
+            # NOTE: In v1 the notice follows the last whole update.
+            if self.cr_state.update_buffer.startswith(_cr_messages.RESUME_NOTICE):
+                self.cr_state.update_buffer = self.cr_state.update_buffer[
+                    len(_cr_messages.RESUME_NOTICE) :
+                ]
+                resume = True
+
+            if resume:
+                self.resume()
 
         def _handle_disconnection():
             """
@@ -151,7 +329,20 @@ class ChatRoomClient(VardorvisCmd):
                         if self.chatting_event.is_set():
                             _handle_chats()
                             continue
-                        data_read = self.ssl_socket.read(1)
+                        data_read = self.ssl_socket.recv(
+                            _cr_messages.MESG_SIZE + _cr_messages.BUFF_SIZE
+                        )
+
+                        if self.protocol_version == _cr_messages.PROTOCOL_V2:
+                            self.frame_decoder.feed(data_read)
+
+                            if _cr_messages.RESUME_NOTICE in self.frame_decoder.take():
+                                self.resume()
+                                continue
+                        elif data_read == _cr_messages.RESUME_NOTICE:
+                            self.resume()
+                            continue
+
                         if not data_read:
                             _handle_disconnection()
                         break
@@ -191,8 +382,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.login_req_create(username, password)
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_packet()
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
             )
@@ -242,8 +433,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.register_req_create(username, password)
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_packet()
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
             )
@@ -289,8 +480,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.admin_req_create(username)
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_packet()
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
             )
@@ -334,8 +525,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.admin_r_req_create(username)
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_packet()
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
             )
@@ -379,8 +570,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.user_delete_req_create(username)
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_packet()
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
             )
@@ -423,26 +614,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.list_req_create()
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = b""
-            # NOTE: Set timeout to 0.5 seconds to ensure we don't wait too long for a response.
-            # Most responses won't require more than one buffer size but the packets should come
-            # at about the same time anyways.
-            self.ssl_socket.settimeout(0.5)
-
-            try:
-                while True:
-                    chunk = self.ssl_socket.recv(
-                        _cr_messages.MESG_SIZE + _cr_messages.BUFF_SIZE
-                    )
-
-                    if not chunk:
-                        break
-
-                    received_messsage += chunk
-            except TimeoutError:
-                # Return timeout to normal
-                self.ssl_socket.settimeout(5)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_gathered()
 
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
@@ -468,6 +641,74 @@ class ChatRoomClient(VardorvisCmd):
             return True
         return False
 
+    @cmd2.with_category(CATEGORY_AUTHENTICATED)
+    def do_stats(self, args):
+        """
+        Show live server statistics and the busiest rooms. Requires admin privileges.
+        """
+        if self.shutdown_event.is_set():
+            self.verror("Connection to server lost. Shutting down...")
+            return True
+
+        if not self.cr_state.test_login():
+            self.verror("You must be a logged in user to view server stats.")
+            return False
+
+        if self.cr_state.test_chatting():
+            return False
+
+        packed_message = _cr_messages.stats_req_create()
+
+        try:
+            self.send_packet(packed_message)
+            received_messsage = self.recv_gathered()
+
+            packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
+                received_messsage, self
+            )
+
+            if (
+                packet_type == _cr_messages.SESSION_TYPE
+                and subtype == _cr_messages.STATS_STYPE
+                and opcode == _cr_messages.ACKNOWLEDGE
+            ):
+                stats, rooms, _ = _cr_messages.stats_ack_unpack(received_messsage)
+                window = max(stats["rate_window_s"], 1)
+                self.voutput(
+                    f"Uptime: {stats['uptime_s']} s\n"
+                    f"Sessions: {stats['sessions']} "
+                    f"({stats['sessions_waiting']} waiting, "
+                    f"{stats['flush_pending']} pending flush)\n"
+                    f"Users logged in: {stats['users_logged_in']}\n"
+                    f"Pool: {stats['pool_threads']} threads, "
+                    f"{stats['dispatch_permille'] / 10:.1f}% busy\n"
+                    f"Requests: {stats['requests_window'] / window:.1f}/s "
+                    f"({stats['requests_total']} total)\n"
+                    f"Chats: {stats['chats_window'] / window:.1f}/s "
+                    f"({stats['chats_total']} total)\n"
+                    f"Bytes: {stats['bytes_in']} in, {stats['bytes_out']} out"
+                )
+
+                if rooms:
+                    lines = [
+                        f"  {name:<31}{members:>8}{chats_window / window:>10.1f}{chats_total:>10}"
+                        for name, members, chats_window, chats_total in rooms
+                    ]
+                    header = f"  {'Room':<31}{'Members':>8}{'Chats/s':>10}{'Total':>10}"
+                    self.voutput("\n".join([header] + lines))
+            else:
+                _cr_utility.cr_handle_not_acks(
+                    (packet_type, subtype, opcode, reason_code),
+                    _cr_messages.SESSION_TYPE,
+                    _cr_messages.STATS_STYPE,
+                    self.cr_state,
+                    self,
+                )
+        except OSError as error:
+            self.verror(f"stats: {error}")
+            return True
+        return False
+
     @cmd2.with_category(CATEGORY_AUTHENTICATED)
     def do_addroom(self, args):
         """
@@ -488,8 +729,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.room_req_create(room_name)
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_packet()
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
             )
@@ -533,8 +774,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.room_del_req_create(room_name)
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_packet()
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
             )
@@ -564,7 +805,7 @@ class ChatRoomClient(VardorvisCmd):
         Join a room on the chat room server.
         """
 
-        def _update_history_format(chat_history: str):
+        def _update_history_format(chat_history: list):
             """
             Update the chat history format to be more readable.
             """
@@ -577,7 +818,7 @@ class ChatRoomClient(VardorvisCmd):
 
             try:
                 formatted_history = ""
-                for line in chat_history.split("\n"):
+                for line in chat_history:
                     formatted_history += _format_line(line) + "\n"
             except ValueError:
                 pass
@@ -596,29 +837,15 @@ class ChatRoomClient(VardorvisCmd):
             return False
 
         room_name = input("Enter the name of the room to join: ")
-        packed_message = _cr_messages.join_req_create(room_name)
+        # NOTE: Only the chats after the last one seen in this room are requested, the rest are
+        # kept in the room history cache.
+        packed_message = _cr_messages.join_req_create(
+            room_name, self.cr_state.room_seqs.get(room_name, 0)
+        )
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = b""
-            # NOTE: Set timeout to 0.5 seconds to ensure we don't wait too long for a response.
-            # Most responses won't require more than one buffer size but the packets should come
-            # at about the same time anyways.
-            self.ssl_socket.settimeout(0.5)
-
-            try:
-                while True:
-                    chunk = self.ssl_socket.recv(
-                        _cr_messages.MESG_SIZE + _cr_messages.BUFF_SIZE
-                    )
-
-                    if not chunk:
-                        break
-
-                    received_messsage += chunk
-            except TimeoutError:
-                # Return timeout to normal
-                self.ssl_socket.settimeout(5)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_gathered()
 
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
@@ -629,12 +856,21 @@ class ChatRoomClient(VardorvisCmd):
                 and subtype == _cr_messages.JOIN_STYPE
                 and opcode == _cr_messages.ACKNOWLEDGE
             ):
-                chat_history = received_messsage[3:].decode("UTF-8")
-                self.cr_state.enter_room(room_name, chat_history)
+                room_seq, history, remainder = _cr_messages.join_ack_unpack(
+                    received_messsage
+                )
+                self.cr_state.enter_room(room_name, room_seq, history)
+                self.cr_state.update_buffer = remainder + b"".join(
+                    self.frame_decoder.take()
+                )
                 self.voutput(f"Joined {room_name}.")
                 print(
                     colored(
-                        _update_history_format(chat_history), "magenta", attrs=["bold"]
+                        _update_history_format(
+                            self.cr_state.room_history[room_name]
+                        ),
+                        "magenta",
+                        attrs=["bold"],
                     )
                 )
                 self.prompt = colored(
@@ -674,8 +910,8 @@ class ChatRoomClient(VardorvisCmd):
 
         packed_message = _cr_messages.logout_req_create()
         try:
-            self.ssl_socket.sendall(packed_message)
-            self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            self.recv_packet()
             self.cr_state.logout()
             self.prompt = colored("[NOT LOGGED IN]> ", "yellow", attrs=["bold"])
         except OSError as error:
@@ -701,8 +937,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.leave_req_create()
 
         try:
-            self.ssl_socket.sendall(packed_message)
-            received_messsage = self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+            self.send_packet(packed_message)
+            received_messsage = self.recv_packet()
             packet_type, subtype, opcode, reason_code = _cr_messages.cr_recv_unpack(
                 received_messsage, self
             )
@@ -743,7 +979,9 @@ class ChatRoomClient(VardorvisCmd):
 
         packed_message = _cr_messages.chat_req_create(statement.raw)
         try:
-            self.ssl_socket.sendall(packed_message)
+            # NOTE: The chat is added to the room history cache when the server sends it back
+            # with its sequence number.
+            self.send_packet(packed_message)
         except OSError as error:
             self.verror(f"send: {error}")
             return True
@@ -785,8 +1023,8 @@ class ChatRoomClient(VardorvisCmd):
         packed_message = _cr_messages.quit_req_create()
         if self.ssl_socket:
             try:
-                self.ssl_socket.sendall(packed_message)
-                self.ssl_socket.recv(_cr_messages.MESG_SIZE)
+                self.send_packet(packed_message)
+                self.recv_packet()
                 if self.cr_state.test_chatting():
                     self.cr_state.leave_room()
                 if self.cr_state.test_login():
@@ -91,6 +91,37 @@ def test_login_fail(client: ChatRoomClient):
             assert not client.cr_state.test_login()
 
 
+def test_login_v1():
+    """
+    Testing that clients that don't negotiate a protocol version still use the v1 packets.
+    """
+    v1_client = ChatRoomClient(hostname="192.168.56.101", port=1234, protocol_version=1)
+
+    with v1_client.ssl_mutex:
+        assert v1_client.protocol_version == 1
+
+        with patch("builtins.input", return_value="admin"):
+            with patch("getpass.getpass", return_value="password"):
+                assert False is v1_client.do_login("login")
+                assert v1_client.cr_state.test_login()
+
+    v1_client.postloop()
+
+
+def test_negotiated_v2(client: ChatRoomClient):
+    """
+    Testing that the client and server agree on the v2 framing by default.
+    """
+    assert client.protocol_version == 2
+
+
+def test_negotiated_compression(client: ChatRoomClient):
+    """
+    Testing that v2 clients get compressed room histories and room lists by default.
+    """
+    assert client.frame_decoder.compression == 1
+
+
 def test_register(client: ChatRoomClient):
     """
     Testing register of a user.
@@ -0,0 +1,398 @@
+"""Tests the Chat Room Server's cluster mode:
+Starts a two node loopback cluster with chatroomserver/bench/cr_cluster_run.sh and checks
+that chats cross the cluster bus. The server is taken from CR_BUILD_DIR, or
+chatroomserver/build when it is not set, and the tests are skipped when it has not been built.
+"""
+
+# pytest fixture casuses redefined-outer-name
+# pylint: disable=redefined-outer-name
+
+import os
+import signal
+import socket
+import ssl
+import struct
+import subprocess
+import time
+
+import pytest
+
+from chatroomclient import _cr_messages
+
+SERVER_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "chatroomserver")
+BUILD_DIR = os.environ.get("CR_BUILD_DIR", os.path.join(SERVER_DIR, "build"))
+
+# NOTE: Clear of the cr_cluster_run.sh defaults, so a cluster left running by hand doesn't
+# answer for this one.
+NODE_PORT = 4600
+BUS_PORT = 4700
+
+# WARNING: Like the client, doesn't check the server's self-signed certificate.
+SSL_CONTEXT = ssl.create_default_context(ssl.Purpose.SERVER_AUTH)
+SSL_CONTEXT.check_hostname = False
+SSL_CONTEXT.verify_mode = ssl.CERT_NONE
+
+
+# Cluster bus frame types, from cr_cluster.c.
+BUS_HELLO = 0
+BUS_USER_ADD = 3
+BUS_USER_DEL = 4
+
+
+@pytest.fixture(scope="module")
+def cluster_dir(tmp_path_factory):
+    """
+    Fixture for the directory the cluster runs in, which holds the certificate the nodes share.
+    """
+    return tmp_path_factory.mktemp("cluster")
+
+
+@pytest.fixture(scope="module")
+def cluster(cluster_dir):
+    """
+    Fixture to run a two node cluster for the module.
+    """
+    if not os.access(os.path.join(BUILD_DIR, "chat_room"), os.X_OK):
+        pytest.skip(f"no chat_room build in {BUILD_DIR}")
+
+    env = dict(os.environ, NODES="2", PORT=str(NODE_PORT), BUS_PORT=str(BUS_PORT))
+    run = subprocess.Popen(  # pylint: disable=consider-using-with
+        [
+            os.path.join(SERVER_DIR, "bench", "cr_cluster_run.sh"),
+            BUILD_DIR,
+            str(cluster_dir),
+        ],
+        env=env,
+        stdout=subprocess.DEVNULL,
+        start_new_session=True,
+    )
+
+    try:
+        for port in (NODE_PORT, NODE_PORT + 1):
+            wait_for_port(port)
+
+        # NOTE: The nodes dial each other once they're listening; give the bus a moment so
+        # the first room add isn't sent before the peer is up.
+        time.sleep(1)
+
+        yield (NODE_PORT, NODE_PORT + 1)
+    finally:
+        os.killpg(run.pid, signal.SIGINT)
+        run.wait(timeout=10)
+
+
+def wait_for_port(port: int, timeout: float = 10):
+    """
+    Waits until the node on port accepts connections.
+    """
+    deadline = time.monotonic() + timeout
+
+    while True:
+        try:
+            socket.create_connection(("127.0.0.1", port), timeout=1).close()
+            return
+        except OSError:
+            if time.monotonic() > deadline:
+                raise
+            time.sleep(0.1)
+
+
+def connect(port: int) -> ssl.SSLSocket:
+    """
+    Connects to a node and settles on the v1 packets, which are fixed size and easy to read back.
+    """
+    ssl_socket = SSL_CONTEXT.wrap_socket(socket.create_connection(("127.0.0.1", port)))
+    ssl_socket.settimeout(5)
+    ssl_socket.sendall(_cr_messages.version_req_create(_cr_messages.PROTOCOL_V1))
+    assert ssl_socket.recv(_cr_messages.MESG_SIZE)[2] == _cr_messages.ACKNOWLEDGE
+
+    return ssl_socket
+
+
+def request(ssl_socket: ssl.SSLSocket, packet: bytes) -> int:
+    """
+    Sends a request and returns the response code of its reply.
+    """
+    ssl_socket.sendall(packet)
+
+    return ssl_socket.recv(_cr_messages.MESG_SIZE)[2]
+
+
+def recv_until(ssl_socket: ssl.SSLSocket, wanted: bytes, timeout: float = 3) -> bool:
+    """
+    Reads from the socket until wanted shows up or nothing more arrives in timeout.
+    """
+    received = b""
+    ssl_socket.settimeout(timeout)
+
+    try:
+        while wanted not in received:
+            data = ssl_socket.recv(_cr_messages.BUFF_SIZE)
+            if not data:
+                break
+            received += data
+    except (socket.timeout, TimeoutError):
+        pass
+    finally:
+        ssl_socket.settimeout(5)
+
+    return wanted in received
+
+
+def recv_exact(ssl_socket: ssl.SSLSocket, size: int) -> bytes:
+    """
+    Reads exactly size bytes from the socket.
+    """
+    received = b""
+
+    while len(received) < size:
+        data = ssl_socket.recv(size - len(received))
+        assert data, "closed before the whole packet arrived"
+        received += data
+
+    return received
+
+
+def bus_frame(frame_type: int, *fields) -> bytes:
+    """
+    Builds a cluster bus frame. Integer fields are one byte, string fields a length byte and the
+    characters.
+    """
+    body = bytes((frame_type,))
+
+    for field in fields:
+        if isinstance(field, int):
+            body += bytes((field,))
+        else:
+            body += bytes((len(field),)) + field.encode()
+
+    return struct.pack(">H", len(body)) + body
+
+
+def bus_peer(cluster_dir) -> ssl.SSLSocket:
+    """
+    Connects to node 1's bus as node 2, with the certificate the nodes share.
+    """
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    context.check_hostname = False
+    context.load_verify_locations(os.path.join(cluster_dir, "server.crt"))
+    context.load_cert_chain(
+        os.path.join(cluster_dir, "server.crt"), os.path.join(cluster_dir, "server.key")
+    )
+
+    bus = context.wrap_socket(socket.create_connection(("127.0.0.1", BUS_PORT)))
+    bus.sendall(bus_frame(BUS_HELLO, 2))
+
+    return bus
+
+
+def login_remote(port: int, username: str, password: str) -> ssl.SSLSocket:
+    """
+    Logs in on a node that learns of the account over the bus, retrying until it has.
+    """
+    deadline = time.monotonic() + 5
+
+    while True:
+        ssl_socket = connect(port)
+        reply = request(ssl_socket, _cr_messages.login_req_create(username, password))
+        if reply == _cr_messages.ACKNOWLEDGE:
+            return ssl_socket
+
+        ssl_socket.close()
+        assert time.monotonic() < deadline
+        time.sleep(0.1)
+
+
+@pytest.mark.parametrize("room_name", ["lobby", "short1", "nineroom1"])
+def test_cluster_chat_short_room(cluster, room_name: str):
+    """
+    Testing that a chat sent on one node reaches a member of the room on the other.
+    Room names shorter than the hash key are the regression case.
+    """
+    node_a, node_b = cluster
+    username = f"cl{room_name}"
+
+    admin = connect(node_a)
+    assert _cr_messages.ACKNOWLEDGE == request(
+        admin, _cr_messages.login_req_create("admin", "password")
+    )
+    assert _cr_messages.ACKNOWLEDGE == request(admin, _cr_messages.room_req_create(room_name))
+
+    register = connect(node_a)
+    assert _cr_messages.ACKNOWLEDGE == request(
+        register, _cr_messages.register_req_create(username, "password")
+    )
+    register.close()
+
+    member = login_remote(node_b, username, "password")
+    member.sendall(_cr_messages.join_req_create(room_name))
+    assert member.recv(_cr_messages.MESG_SIZE)[2] == _cr_messages.ACKNOWLEDGE
+
+    # NOTE: The join travels to node A as a subscription; the chat is only forwarded once
+    # it has arrived.
+    time.sleep(0.5)
+    admin.sendall(_cr_messages.join_req_create(room_name))
+    assert admin.recv(_cr_messages.MESG_SIZE)[2] == _cr_messages.ACKNOWLEDGE
+
+    chat = f"hello {room_name}"
+    admin.sendall(_cr_messages.chat_req_create(chat))
+    assert recv_until(member, chat.encode())
+
+    admin.close()
+    member.close()
+
+
+def test_cluster_chat_legacy_client(cluster):
+    """
+    Testing that a client that never sends a version request gets the join history and chat
+    updates in the layout it had before chats were numbered, here from a chat on the other node.
+    """
+    node_a, node_b = cluster
+    room_name = "legacyroom"
+
+    admin = connect(node_a)
+    assert _cr_messages.ACKNOWLEDGE == request(
+        admin, _cr_messages.login_req_create("admin", "password")
+    )
+    assert _cr_messages.ACKNOWLEDGE == request(admin, _cr_messages.room_req_create(room_name))
+    admin.sendall(_cr_messages.join_req_create(room_name))
+    assert admin.recv(_cr_messages.MESG_SIZE)[2] == _cr_messages.ACKNOWLEDGE
+    admin.sendall(_cr_messages.chat_req_create("before legacy"))
+
+    for username in ("legacyuser", "legacysender"):
+        register = connect(node_a)
+        assert _cr_messages.ACKNOWLEDGE == request(
+            register, _cr_messages.register_req_create(username, "password")
+        )
+        register.close()
+
+    # NOTE: Older clients don't send a version request, send the join without the since field
+    # and read a plain acknowledge followed by the history lines without sequence numbers.
+    legacy = SSL_CONTEXT.wrap_socket(socket.create_connection(("127.0.0.1", node_a)))
+    legacy.settimeout(5)
+    assert _cr_messages.ACKNOWLEDGE == request(
+        legacy, _cr_messages.login_req_create("legacyuser", "password")
+    )
+    legacy.sendall(_cr_messages.join_req_create(room_name)[: -struct.calcsize(">Q")])
+    time.sleep(0.5)
+    received = legacy.recv(_cr_messages.BUFF_SIZE)
+    assert received[:3] == bytes(
+        (_cr_messages.ROOMS_TYPE, _cr_messages.JOIN_STYPE, _cr_messages.ACKNOWLEDGE)
+    )
+    assert received[3:] == b"admin>before legacy\n"
+
+    sender = login_remote(node_b, "legacysender", "password")
+    sender.sendall(_cr_messages.join_req_create(room_name))
+    assert sender.recv(_cr_messages.MESG_SIZE)[2] == _cr_messages.ACKNOWLEDGE
+    sender.sendall(_cr_messages.chat_req_create("after legacy"))
+
+    # NOTE: chat_t puts the '>' right after the header and the 30 byte username.
+    update = b""
+    while b">after legacy" not in update:
+        data = legacy.recv(_cr_messages.BUFF_SIZE)
+        assert data, "closed before the chat update"
+        update += data
+
+    start = update.index(b">after legacy") - 3 - _cr_messages.MAX_NAME_LEN
+    assert update[start : start + 3] == bytes(
+        (_cr_messages.CHAT_TYPE, _cr_messages.CHAT_STYPE, _cr_messages.ACKNOWLEDGE)
+    )
+    assert update[start + 3 :].startswith(b"legacysender\0")
+
+    admin.close()
+    sender.close()
+    legacy.close()
+
+
+def test_chat_response_seq(cluster):
+    """
+    Testing that the sender of a chat is sent it back with its sequence number, so a rejoin
+    from that sequence number doesn't send the chat again.
+    """
+    node_a, _ = cluster
+    room_name = "seqroom"
+
+    admin = connect(node_a)
+    assert _cr_messages.ACKNOWLEDGE == request(
+        admin, _cr_messages.login_req_create("admin", "password")
+    )
+    assert _cr_messages.ACKNOWLEDGE == request(admin, _cr_messages.room_req_create(room_name))
+
+    admin.sendall(_cr_messages.join_req_create(room_name))
+    room_seq, history, _ = _cr_messages.join_ack_unpack(
+        recv_exact(admin, _cr_messages.JOIN_ACK_SIZE)
+    )
+    assert not history
+
+    admin.sendall(_cr_messages.chat_req_create("my own chat"))
+    response = recv_exact(admin, _cr_messages.CHAT_UPDATE_SIZE)
+    assert response[:3] == bytes(
+        (_cr_messages.CHAT_TYPE, _cr_messages.CHAT_STYPE, _cr_messages.RESPONSE)
+    )
+    seq, message = _cr_messages.chat_update_unpack(response)
+    assert seq == room_seq + 1
+    assert message == "admin>my own chat"
+
+    admin.sendall(_cr_messages.leave_req_create())
+    assert recv_exact(admin, 3)[2] == _cr_messages.ACKNOWLEDGE
+
+    admin.sendall(_cr_messages.join_req_create(room_name, seq))
+    room_seq, history, _ = _cr_messages.join_ack_unpack(
+        recv_exact(admin, _cr_messages.JOIN_ACK_SIZE)
+    )
+    assert room_seq == seq
+    assert not history
+
+    admin.close()
+
+
+def test_cluster_bus_refuses_plain_peer(cluster):
+    """
+    Testing that the bus doesn't take frames from a peer without the cluster's certificate.
+    """
+    node_a, _ = cluster
+
+    intruder = socket.create_connection(("127.0.0.1", BUS_PORT))
+    intruder.sendall(bus_frame(BUS_HELLO, 2) + bus_frame(BUS_USER_ADD, "intruder", "password"))
+    time.sleep(1)
+    intruder.close()
+
+    client = connect(node_a)
+    assert _cr_messages.ACKNOWLEDGE != request(
+        client, _cr_messages.login_req_create("intruder", "password")
+    )
+    client.close()
+
+
+def test_cluster_bus_keeps_admin(cluster, cluster_dir):
+    """
+    Testing that a node can't delete an admin account on another node, while a plain account
+    is still deleted.
+    """
+    node_a, _ = cluster
+
+    register = connect(node_a)
+    assert _cr_messages.ACKNOWLEDGE == request(
+        register, _cr_messages.register_req_create("busdeluser", "password")
+    )
+    register.close()
+
+    bus = bus_peer(cluster_dir)
+    bus.sendall(bus_frame(BUS_USER_DEL, "admin") + bus_frame(BUS_USER_DEL, "busdeluser"))
+    time.sleep(1)
+
+    admin = connect(node_a)
+    assert _cr_messages.ACKNOWLEDGE == request(
+        admin, _cr_messages.login_req_create("admin", "password")
+    )
+    deleted = connect(node_a)
+    assert _cr_messages.ACKNOWLEDGE != request(
+        deleted, _cr_messages.login_req_create("busdeluser", "password")
+    )
+
+    bus.close()
+    admin.close()
+    deleted.close()
+
+
+# End of test_cluster.py file
@@ -0,0 +1,184 @@
+"""Tests the Chat Room Server's hot restart:
+Starts a server with hot restart on in a scratch directory, then a second one in the same
+directory, and checks that the clients of the first carry on with the second. The server is
+taken from CR_BUILD_DIR, or chatroomserver/build when it is not set, and the tests are skipped
+when it has not been built.
+"""
+
+# pytest fixture casuses redefined-outer-name
+# pylint: disable=redefined-outer-name
+
+import os
+import shutil
+import signal
+import subprocess
+import time
+
+import pytest
+
+from chatroomclient import _cr_messages
+from chatroomclient.test_cluster import BUILD_DIR, SERVER_DIR, SSL_CONTEXT
+from chatroomclient.test_cluster import connect, recv_until, request, wait_for_port
+
+SERVER_PORT = 4610
+
+# NOTE: How long cr_client.py's resume() waits for the new server's handshake.
+CLIENT_TIMEOUT = 5
+
+CONFIG = f"""Server Listening Hostname/IP:
+127.0.0.1
+
+Server Listening Port:
+{SERVER_PORT}
+
+Max room count:
+5
+
+Max client count:
+10
+
+Update flush window (ms):
+5
+
+History compression level (0-9):
+6
+
+Metrics port (0 off, loopback only):
+0
+
+Acceptor threads (0 one per core):
+1
+
+Pin acceptors to cores (0 off, 1 on):
+0
+
+Room worker threads (0 off):
+0
+
+Cluster node id (0 off, nodes in cluster.txt):
+0
+
+Hot restart (0 off, 1 on):
+1
+
+Persistent rooms (0 off, 1 on):
+0
+"""
+
+
+def start_server(run_dir: str, log_name: str) -> subprocess.Popen:
+    """
+    Starts a server in run_dir, logging to log_name there.
+    """
+    with open(os.path.join(run_dir, log_name), "w", encoding="utf-8") as log_file:
+        return subprocess.Popen(  # pylint: disable=consider-using-with
+            [os.path.join(BUILD_DIR, "chat_room")],
+            cwd=run_dir,
+            stdout=log_file,
+            stderr=subprocess.STDOUT,
+        )
+
+
+@pytest.fixture
+def run_dir(tmp_path):
+    """
+    Fixture to set up a scratch directory for the servers.
+    """
+    if not os.access(os.path.join(BUILD_DIR, "chat_room"), os.X_OK):
+        pytest.skip(f"no chat_room build in {BUILD_DIR}")
+
+    for name in ("server.crt", "server.key"):
+        if not os.path.exists(os.path.join(SERVER_DIR, name)):
+            pytest.skip(f"no {name}, run gen_certs_run.sh")
+        shutil.copy(os.path.join(SERVER_DIR, name), tmp_path)
+
+    (tmp_path / "config.txt").write_text(CONFIG, encoding="utf-8")
+    (tmp_path / "users.txt").write_text("admin:password\n", encoding="utf-8")
+
+    return str(tmp_path)
+
+
+def wait_for_notice(ssl_socket):
+    """
+    Reads up to the resume notice and ends TLS with the old server. Returns the plain socket.
+    """
+    received = b""
+
+    while not received.endswith(_cr_messages.RESUME_NOTICE):
+        data = ssl_socket.recv(_cr_messages.BUFF_SIZE)
+        assert data, "closed before the resume notice"
+        received += data
+
+    return ssl_socket.unwrap()
+
+
+def test_hot_restart(run_dir: str):
+    """
+    Testing that clients stay in their room across a hot restart, within the client's resume
+    timeout even though one client never answers the notice, and that the old server exits
+    cleanly.
+    """
+    old_server = start_server(run_dir, "old.log")
+    new_server = None
+
+    try:
+        wait_for_port(SERVER_PORT)
+
+        admin = connect(SERVER_PORT)
+        assert _cr_messages.ACKNOWLEDGE == request(
+            admin, _cr_messages.login_req_create("admin", "password")
+        )
+        assert _cr_messages.ACKNOWLEDGE == request(admin, _cr_messages.room_req_create("hotroom"))
+
+        member = connect(SERVER_PORT)
+        assert _cr_messages.ACKNOWLEDGE == request(
+            member, _cr_messages.register_req_create("hotuser", "password")
+        )
+        assert _cr_messages.ACKNOWLEDGE == request(
+            member, _cr_messages.login_req_create("hotuser", "password")
+        )
+
+        # NOTE: Never reads again, so it never answers the resume notice.
+        silent = connect(SERVER_PORT)
+
+        for ssl_socket in (admin, member):
+            ssl_socket.sendall(_cr_messages.join_req_create("hotroom"))
+            assert ssl_socket.recv(_cr_messages.MESG_SIZE)[2] == _cr_messages.ACKNOWLEDGE
+
+        admin.sendall(_cr_messages.chat_req_create("before restart"))
+        assert recv_until(member, b"before restart")
+
+        new_server = start_server(run_dir, "new.log")
+
+        admin = wait_for_notice(admin)
+        member = wait_for_notice(member)
+        notified = time.monotonic()
+
+        resumed = []
+        for plain_socket in (admin, member):
+            plain_socket.settimeout(CLIENT_TIMEOUT)
+            ssl_socket = SSL_CONTEXT.wrap_socket(plain_socket)
+            ssl_socket.settimeout(5)
+            resumed.append(ssl_socket)
+
+        assert time.monotonic() - notified < CLIENT_TIMEOUT
+        admin, member = resumed
+
+        # NOTE: The new server puts a session back in its room after the handshake.
+        time.sleep(0.5)
+        admin.sendall(_cr_messages.chat_req_create("after restart"))
+        assert recv_until(member, b"after restart")
+
+        assert 0 == old_server.wait(timeout=10)
+
+        silent.close()
+        admin.close()
+        member.close()
+    finally:
+        for server in (old_server, new_server):
+            if (server is not None) and (server.poll() is None):
+                server.send_signal(signal.SIGINT)
+                server.wait(timeout=10)
+
+
+# End of test_hot_restart.py file
@@ -19,10 +19,23 @@ bigger_value (int value_1, int value_2)
     return value_1;
 }
 
+//NOTE: Each prime is the first one above 1.5 * 2^k, as far from both
+//neighbouring powers of two as a prime gets, so growing through the table
+//roughly doubles the capacity. The last entry is the largest 32 bit prime.
+static const uint32_t p_prime_capacities[PRIME_CAPACITY_COUNT] = {
+    3, 7, 13, 29, 53, 97, 193, 389, 769, 1543, 3079, 6151, 12289, 24593,
+    49157, 98317, 196613, 393241, 786433, 1572869, 3145739, 6291469,
+    12582917, 25165843, 50331653, 100663319, 201326611, 402653189,
+    805306457, 1610612741, 3221225473u, 4294967291u
+};
+
+//Bases that make Miller-Rabin exact below 4759123141.
+static const uint32_t p_prime_bases[] = {2, 7, 61};
+
 /**
  * @brief Helper function to is_prime. Calculates (base^exponent) % modulus.
  * Decreases the computation time by at least O(e) from the conventional 
- * method. Limited by uint_16 size.
+ * method. Products are taken in 64 bits, so any 32 bit modulus is safe.
  * Pseudocode pulled from: https://en.wikipedia.org/wiki/Modular_
  * exponentiation#:~:text=Modular%20exponentiation%20is%20the%20remainder
  * ,c%20%3D%20be%20mod%20m.
@@ -30,40 +43,33 @@ bigger_value (int value_1, int value_2)
  * @param base 
  * @param exponent 
  * @param modulus 
- * @return uint16_t resul of formula.
+ * @return uint32_t resul of formula.
  */
-uint16_t
-modular_pow (uint16_t base, uint16_t exponent, uint16_t modulus)
+uint32_t
+modular_pow (uint32_t base, uint32_t exponent, uint32_t modulus)
 {
-    uint16_t result = 1;
-    base = base % modulus;
+    uint64_t result = 1;
+    uint64_t square = base % modulus;
 
     while (exponent > 0)
     {
         if (exponent % 2 == 1)
         {
-            result = (result * base) % modulus;
+            result = (result * square) % modulus;
         }
 
-        base = (base * base) % modulus;
+        square = (square * square) % modulus;
 
         exponent = exponent >> 1;
     }
     
-    return result;
+    return result % modulus;
 }
 
-
-//Note: the alternative to this method would be maintaining a table of primes
-//up to 65535, according to the sieve of Eratosthenes . This would probably be
-//more efficient, given the size limitations on the hash table. This
-//implementation would be more simple, though, so miller-rabin test is 
-//implemented for learning purposes.
-
 /**
  * @brief Helper function to next_prime. Determines whether the supplied value
- * is prime. Uses the Miller-Rabin test. Round count macro determines accuracy
- * of testing, default used is five.
+ * is prime. Uses the Miller-Rabin test with the bases 2, 7 and 61, which is
+ * exact for every 32 bit value.
  * Reference: https://en.wikipedia.org/wiki/Miller%E2%80%93Rabin_primality_test
  * 
  * @param value value to be tested for primeness.
@@ -71,20 +77,30 @@ modular_pow (uint16_t base, uint16_t exponent, uint16_t modulus)
  * @return false is returned if value isn't prime.
  */
 bool
-is_prime (uint16_t value)
+is_prime (uint32_t value)
 {
     if (value <= 1)
     {
         return false;
     }
-    if (value <= 3)
+
+    for (size_t counter = 0; counter < (sizeof(p_prime_bases) /
+                                sizeof(p_prime_bases[0])); counter++)
     {
-        return true;
+        if (value == p_prime_bases[counter])
+        {
+            return true;
+        }
+
+        if (0 == (value % p_prime_bases[counter]))
+        {
+            return false;
+        }
     }
 
     //factoring out powers of two
-    uint16_t odd_int = value - 1;
-    uint16_t power_of_two = 0;
+    uint32_t odd_int = value - 1;
+    uint32_t power_of_two = 0;
 
     while (odd_int % 2 == 0)
     {
@@ -92,43 +108,32 @@ is_prime (uint16_t value)
         odd_int = odd_int/2;
     }
 
-    //Seeding inside the loop would generate the same number each time due
-    //to the computational speed.
-    srand(time(NULL));
-
-    uint16_t max_number = value -2;
-    uint16_t minimum_number = 2;
-
-    for (uint8_t counter1 = 0; counter1 < ROUND_COUNT; counter1++)
+    for (size_t counter1 = 0; counter1 < (sizeof(p_prime_bases) /
+                                 sizeof(p_prime_bases[0])); counter1++)
     {
-        //Getting the number within range will decrease the randomness
-        //slightly our base for prime calculations will be determined.
-        uint16_t prime_base = rand() % (max_number + 1 - minimum_number)
-                                                       + minimum_number;
-
-        uint16_t calculation_1 = modular_pow(prime_base,odd_int,value);
-        uint16_t calculation_2 = 0;
+        uint64_t calculation = modular_pow(p_prime_bases[counter1], odd_int,
+                                                                    value);
 
         //test to see if strong base, will skip to next loop if not
-        if ((1 == calculation_1) || ((value - 1) == calculation_1))
+        if ((1 == calculation) || ((value - 1) == calculation))
         {
             continue;
         }
 
-        for (uint16_t counter2 = 0; counter2 < power_of_two; counter2++)
+        bool witness = true;
+
+        for (uint32_t counter2 = 1; counter2 < power_of_two; counter2++)
         {
-            calculation_2 = modular_pow(calculation_1,2,value);
+            calculation = (calculation * calculation) % value;
 
-            if ((1 == calculation_2) && (1 != calculation_1) &&
-                                (calculation_1 != (value - 1)))
+            if ((value - 1) == calculation)
             {
-                return false;
+                witness = false;
+                break;
             }
-
-            calculation_1 = calculation_2;
         }
 
-        if (1 != calculation_2)
+        if (witness)
         {
             return false;
         }
@@ -138,14 +143,15 @@ is_prime (uint16_t value)
 }
 
 /**
- * @brief Helper function to h_table_re_hash. Iterates through odd numbers to
- * determine the next prime number in the integer series.
+ * @brief Iterates through odd numbers to determine the next prime number in
+ * the integer series.
  * 
  * @param value is input integer.
- * @return uint16_t next prime number in integer series.
+ * @return uint32_t next prime number in integer series or FAILURE (1) if
+ * there is no larger 32 bit prime.
  */
-uint16_t
-next_prime (uint16_t value)
+uint32_t
+next_prime (uint32_t value)
 {
     if (value <= 1)
     {
@@ -157,29 +163,77 @@ next_prime (uint16_t value)
         return 3;
     }
 
-    //The search will start at the next odd number
-    if (value % 2 == 0)
-    {
-        value += 1;
-    }
-    else
+    //Bertrand's postulate: for any int  > 3 there exists at least one prime
+    //number, p, such that n < p < 2n. The search is done in 64 bits so it
+    //stops at the top of the range instead of wrapping.
+    for (uint64_t candidate = ((uint64_t) value + 1) | 1;
+                         candidate <= UINT32_MAX; candidate += 2)
     {
-        value += 2;
+        if (is_prime(candidate))
+        {
+            return candidate;
+        }
     }
 
-    uint16_t double_value_holder = value * 2;
+    return FAILURE;
+}
 
-    //Bertrand's postulate: for any int  > 3 there exists at least one prime
-    //number, p, such that n < p < 2n.
-    for (; value < double_value_holder; value += 2)
+/**
+ * @brief Returns the smallest prime capacity that is at least value. The
+ * capacities come from a fixed table of primes that roughly double, each
+ * close to the middle of two powers of two, up to 4294967291.
+ * 
+ * @param value minimum capacity.
+ * @return uint32_t prime capacity or 0 if value is above the table.
+ */
+uint32_t
+prime_capacity (uint32_t value)
+{
+    size_t low = 0;
+    size_t high = PRIME_CAPACITY_COUNT;
+
+    while (low < high)
     {
-        if (is_prime(value))
+        size_t middle = (low + high) / 2;
+
+        if (p_prime_capacities[middle] < value)
         {
-            return value;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
         }
     }
 
-    return FAILURE;
+    if (PRIME_CAPACITY_COUNT == low)
+    {
+        return 0;
+    }
+
+    return p_prime_capacities[low];
+}
+
+/**
+ * @brief Returns the smallest power of two that is at least value.
+ * 
+ * @param value minimum capacity.
+ * @return uint32_t power of two or 0 if value is above 2^31.
+ */
+uint32_t
+power_of_two_capacity (uint32_t value)
+{
+    if (value <= 1)
+    {
+        return 1;
+    }
+
+    if (value > (UINT32_C(1) << 31))
+    {
+        return 0;
+    }
+
+    return UINT32_C(1) << (32 - __builtin_clz(value - 1));
 }
 
 /**
@@ -43,7 +43,6 @@
 
 #endif //SHARED_MACROS
 
-#define ROUND_COUNT 5
 #define FIRST_VAL 1
 #define SECOND_VAL 2
 
@@ -57,10 +56,13 @@
  */
 int bigger_value (int value_1, int value_2);
 
+//Number of entries in the prime capacity table.
+#define PRIME_CAPACITY_COUNT 32
+
 /**
  * @brief Helper function to is_prime. Calculates (base^exponent) % modulus.
  * Decreases the computation time by at least O(e) from the conventional 
- * method. Limited by uint_16 size.
+ * method. Products are taken in 64 bits, so any 32 bit modulus is safe.
  * Pseudocode pulled from: https://en.wikipedia.org/wiki/Modular_
  * exponentiation#:~:text=Modular%20exponentiation%20is%20the%20remainder
  * ,c%20%3D%20be%20mod%20m.
@@ -68,15 +70,15 @@ int bigger_value (int value_1, int value_2);
  * @param base 
  * @param exponent 
  * @param modulus 
- * @return uint16_t resul of formula.
+ * @return uint32_t resul of formula.
  */
-uint16_t
-modular_pow (uint16_t base, uint16_t exponent, uint16_t modulus);
+uint32_t
+modular_pow (uint32_t base, uint32_t exponent, uint32_t modulus);
 
 /**
  * @brief Helper function to next_prime. Determines whether the supplied value
- * is prime. Uses the Miller-Rabin test. Round count macro determines accuracy
- * of testing, default used is five.
+ * is prime. Uses the Miller-Rabin test with the bases 2, 7 and 61, which is
+ * exact for every 32 bit value.
  * Reference: https://en.wikipedia.org/wiki/Miller%E2%80%93Rabin_primality_test
  * 
  * @param value value to be tested for primeness.
@@ -84,17 +86,38 @@ modular_pow (uint16_t base, uint16_t exponent, uint16_t modulus);
  * @return false is returned if value isn't prime.
  */
 bool
-is_prime(uint16_t value);
+is_prime(uint32_t value);
 
 /**
- * @brief Helper function to h_table_re_hash. Iterates through odd numbers to
- * determine the next prime number in the integer series.
+ * @brief Iterates through odd numbers to determine the next prime number in
+ * the integer series.
  * 
  * @param value is input integer.
- * @return uint16_t next prime number in integer series.
+ * @return uint32_t next prime number in integer series or FAILURE (1) if
+ * there is no larger 32 bit prime.
+ */
+uint32_t
+next_prime(uint32_t value);
+
+/**
+ * @brief Returns the smallest prime capacity that is at least value. The
+ * capacities come from a fixed table of primes that roughly double, each
+ * close to the middle of two powers of two, up to 4294967291.
+ * 
+ * @param value minimum capacity.
+ * @return uint32_t prime capacity or 0 if value is above the table.
+ */
+uint32_t
+prime_capacity(uint32_t value);
+
+/**
+ * @brief Returns the smallest power of two that is at least value.
+ * 
+ * @param value minimum capacity.
+ * @return uint32_t power of two or 0 if value is above 2^31.
  */
-uint16_t
-next_prime(uint16_t value);
+uint32_t
+power_of_two_capacity(uint32_t value);
 
 /**
  * @brief Per the rand() man page, if randomness and portability are both
@@ -0,0 +1,1472 @@
+//NOTE: Microbenchmarks for the in-tree libraries (h_table, cll, queue, t_pool,
+//slab and algorithms) and the flight recorder. Inputs are fixed so runs are repeatable. Every case runs
+//several times and the results are printed as JSON, one object per case, so
+//two commits can be compared with a plain diff or a script.
+//
+//Usage: chat_room_bench [-r repetitions] [-f name filter] [-o output file]
+
+#include <getopt.h>
+#include <time.h>
+
+#include "../include/cr_shared.h"
+#include "../include/cr_alloc.h"
+#include "../queue_lib/queue.h"
+
+#define BENCH_REPETITIONS 5
+#define BENCH_MAX_REPETITIONS 100
+
+//NOTE: A prime capacity, the same kind h_table_re_hash grows to, and the
+//power of two beside it for H_TABLE_POWER_OF_TWO tables.
+#define BENCH_TABLE_CAPACITY 4099
+#define BENCH_TABLE_POW2_CAPACITY 4096
+#define BENCH_LOOKUP_ROUNDS 16
+#define BENCH_LOOKUP_MISS 1
+#define BENCH_LOOKUP_POW2 2
+#define BENCH_GROW_CAPACITY 11
+#define BENCH_GROW_ENTRIES 512
+
+#define BENCH_MEMBERS 1024
+#define BENCH_QUEUE_ITEMS 200000
+#define BENCH_POOL_THREADS 4
+#define BENCH_POOL_IDLE_TASKS 2000
+#define BENCH_POOL_BURST_TASKS 20000
+#define BENCH_PRIME_LIMIT 65000
+#define BENCH_TRACE_EVENTS 1000000
+
+//NOTE: Objects the size of a cr_package_t, allocated in batches the way a
+//burst of accepts or updates would.
+#define BENCH_ALLOC_SIZE 48
+#define BENCH_ALLOC_BATCH 256
+#define BENCH_ALLOC_ROUNDS 2000
+
+//NOTE: A full room (MAX_TOTAL_USERS) walked once per chat.
+#define BENCH_BROADCAST_MEMBERS 255
+#define BENCH_BROADCAST_ROUNDS 20000
+
+//NOTE: Log-linear latency histogram, same layout as chat_room_loadgen.
+#define BENCH_SUB_BITS 5
+#define BENCH_SUB_COUNT (1 << BENCH_SUB_BITS)
+#define BENCH_BUCKETS ((64 - BENCH_SUB_BITS) * BENCH_SUB_COUNT)
+
+typedef struct {
+    uint64_t p_counts[BENCH_BUCKETS];
+    uint64_t total;
+} bench_hist_t;
+
+typedef struct bench_case {
+    const char * p_name;
+    const char * p_params;
+    int          arg_1;
+    int          arg_2;
+    uint64_t     (* p_run) (struct bench_case *, bench_hist_t *);
+    uint64_t     ops;
+} bench_case_t;
+
+typedef struct {
+    queue_t *       p_queue;
+    pthread_mutex_t queue_mutex;
+    pthread_cond_t  queue_cond;
+    int             items;
+    int             producers_done;
+} bench_queue_t;
+
+//NOTE: Element of the intrusive cases, a stand in for a user_t with its room
+//link or a task_t with its queue link.
+typedef struct {
+    int              value;
+    cll_link_t       list_link;
+    queue_link_t     queue_link;
+} bench_member_t;
+
+typedef struct {
+    slab_t *         p_slab;
+    void **          pp_objects;
+} bench_alloc_t;
+
+//NOTE: user_t as it was laid out before it was split by cache line, names
+//first and login_status next to the pointers a broadcast reads.
+typedef struct {
+    char                  p_username[MAX_USERNAME_LENGTH + 1];
+    char                  p_password[MAX_PASSWORD_LENGTH + 1];
+    char                  p_chat_room[MAX_ROOM_NAME_LENGTH + 1];
+    volatile int          login_status;
+    volatile int          admin_status;
+    ssl_socket_holder_t * p_ssl_holder;
+    cll_link_t            room_link;
+} bench_packed_user_t;
+
+//NOTE: The broadcast case walks either layout through field offsets.
+typedef struct {
+    size_t           link_offset;
+    size_t           ssl_offset;
+    size_t           login_offset;
+    void *           pp_users[BENCH_BROADCAST_MEMBERS];
+    cll_intrusive_t  members;
+    volatile int     stop;
+} bench_broadcast_t;
+
+typedef struct {
+    uint64_t         submit_ns;
+    uint64_t         run_ns;
+    volatile int *   p_done;
+} bench_task_t;
+
+static char pp_keys[BENCH_TABLE_CAPACITY][KEY_LENGTH + 1];
+static char pp_missing_keys[BENCH_TABLE_CAPACITY][KEY_LENGTH + 1];
+static int p_values[BENCH_TABLE_CAPACITY];
+static bench_member_t p_members[BENCH_MEMBERS];
+static volatile uint64_t sink = 0;
+
+/**
+ * @brief Returns CLOCK_MONOTONIC in nanoseconds.
+ *
+ * @return uint64_t current time.
+ */
+static uint64_t
+bench_now_ns ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * @brief Records a value in the histogram.
+ *
+ * @param p_hist pointer to the histogram.
+ * @param value value to record.
+ */
+static void
+bench_hist_record (bench_hist_t * p_hist, uint64_t value)
+{
+    int index = value;
+
+    if ((2 * BENCH_SUB_COUNT) <= value)
+    {
+        int magnitude = (63 - __builtin_clzll(value)) - BENCH_SUB_BITS;
+        index = (2 * BENCH_SUB_COUNT) + ((magnitude - 1) * BENCH_SUB_COUNT) +
+                ((value >> magnitude) - BENCH_SUB_COUNT);
+    }
+
+    p_hist->p_counts[index]++;
+    p_hist->total++;
+}
+
+/**
+ * @brief Returns the value at a percentile. Values are reported as the
+ * lowest value of their bucket.
+ *
+ * @param p_hist pointer to the histogram.
+ * @param percentile percentile (0-100).
+ * @return uint64_t value at the percentile, zero if the histogram is empty.
+ */
+static uint64_t
+bench_hist_percentile (bench_hist_t * p_hist, double percentile)
+{
+    uint64_t target = (percentile * p_hist->total) / 100.0;
+    uint64_t seen = 0;
+
+    if (0 == target)
+    {
+        target = 1;
+    }
+
+    for (int index = 0; index < BENCH_BUCKETS; index++)
+    {
+        seen += p_hist->p_counts[index];
+
+        if ((seen >= target) && (0 != p_hist->p_counts[index]))
+        {
+            if ((2 * BENCH_SUB_COUNT) > index)
+            {
+                return index;
+            }
+
+            int magnitude = ((index - (2 * BENCH_SUB_COUNT)) /
+                                             BENCH_SUB_COUNT) + 1;
+            uint64_t sub = (index - (2 * BENCH_SUB_COUNT)) % BENCH_SUB_COUNT;
+
+            return (BENCH_SUB_COUNT + sub) << magnitude;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Fills a table with the first entries keys.
+ *
+ * @param capacity initial capacity of the table.
+ * @param entries number of entries.
+ * @param sizing H_TABLE_PRIME or H_TABLE_POWER_OF_TWO.
+ * @return h_table_t* the filled table or NULL on failure.
+ */
+static h_table_t *
+bench_table_fill (int capacity, int entries, uint8_t sizing)
+{
+    h_table_t * p_h_table = h_table_init_sized(capacity, NULL, sizing);
+
+    for (int counter = 0; (NULL != p_h_table) && (counter < entries);
+                                                           counter++)
+    {
+        if (FAILURE == h_table_new_entry(p_h_table, &p_values[counter],
+                                                  pp_keys[counter]))
+        {
+            fprintf(stderr, "bench_table_fill: h_table_new_entry()\n");
+            h_table_destroy(p_h_table, NULL);
+            return NULL;
+        }
+    }
+
+    return p_h_table;
+}
+
+/**
+ * @brief Times inserting arg_1 entries into a table of capacity arg_2.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_h_table_insert (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    uint64_t start = bench_now_ns();
+    h_table_t * p_h_table = bench_table_fill(p_case->arg_2, p_case->arg_1,
+                                                         H_TABLE_PRIME);
+    uint64_t elapsed = bench_now_ns() - start;
+
+    if (NULL == p_h_table)
+    {
+        return 0;
+    }
+
+    h_table_destroy(p_h_table, NULL);
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times looking up every key of a table holding arg_1 entries,
+ * BENCH_LOOKUP_ROUNDS times. With BENCH_LOOKUP_MISS set in arg_2 the keys
+ * looked up are not in the table. With BENCH_LOOKUP_POW2 set the table is an
+ * H_TABLE_POWER_OF_TWO table of BENCH_TABLE_POW2_CAPACITY instead of a prime
+ * one.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_h_table_lookup (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    h_table_t * p_h_table = NULL;
+
+    if (BENCH_LOOKUP_POW2 & p_case->arg_2)
+    {
+        p_h_table = bench_table_fill(BENCH_TABLE_POW2_CAPACITY,
+                           p_case->arg_1, H_TABLE_POWER_OF_TWO);
+    }
+    else
+    {
+        p_h_table = bench_table_fill(BENCH_TABLE_CAPACITY, p_case->arg_1,
+                                                          H_TABLE_PRIME);
+    }
+
+    if (NULL == p_h_table)
+    {
+        return 0;
+    }
+
+    char (* pp_lookup)[KEY_LENGTH + 1] = (BENCH_LOOKUP_MISS & p_case->arg_2) ?
+                                                  pp_missing_keys : pp_keys;
+    uint64_t found = 0;
+    uint64_t start = bench_now_ns();
+
+    for (int round = 0; round < BENCH_LOOKUP_ROUNDS; round++)
+    {
+        for (int counter = 0; counter < p_case->arg_1; counter++)
+        {
+            found += (NULL != h_table_return_entry(p_h_table,
+                                             pp_lookup[counter]));
+        }
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    sink += found;
+    h_table_destroy(p_h_table, NULL);
+    p_case->ops = (uint64_t) p_case->arg_1 * BENCH_LOOKUP_ROUNDS;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times deleting every entry of a table holding arg_1 entries.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_h_table_delete (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    h_table_t * p_h_table = bench_table_fill(BENCH_TABLE_CAPACITY,
+                                       p_case->arg_1, H_TABLE_PRIME);
+
+    if (NULL == p_h_table)
+    {
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        sink += (NULL != h_table_destroy_entry(p_h_table, pp_keys[counter]));
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    h_table_destroy(p_h_table, NULL);
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times building a cll of arg_1 elements. A non-zero arg_2 inserts at
+ * the beginning instead of the end.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_cll_insert (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    cll_t * p_cll = cll_init();
+
+    if (NULL == p_cll)
+    {
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        if (0 != p_case->arg_2)
+        {
+            cll_insert_element_begin(p_cll, &p_values[counter]);
+        }
+        else
+        {
+            cll_insert_element_end(p_cll, &p_values[counter]);
+        }
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    cll_destroy(&p_cll, NULL);
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times emptying a cll of arg_1 elements. A non-zero arg_2 removes
+ * from the end instead of the beginning.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_cll_remove (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    cll_t * p_cll = cll_init();
+
+    if (NULL == p_cll)
+    {
+        return 0;
+    }
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        cll_insert_element_end(p_cll, &p_values[counter]);
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        if (0 != p_case->arg_2)
+        {
+            cll_remove_element_end(p_cll, NULL);
+        }
+        else
+        {
+            cll_remove_element_begin(p_cll, NULL);
+        }
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    cll_destroy(&p_cll, NULL);
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times visiting every element of a cll of arg_1 elements with
+ * cll_return_element, the way the server walks its lists.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_cll_iterate (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    cll_t * p_cll = cll_init();
+
+    if (NULL == p_cll)
+    {
+        return 0;
+    }
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        cll_insert_element_end(p_cll, &p_values[counter]);
+    }
+
+    uint64_t total = 0;
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < cll_size(p_cll); counter++)
+    {
+        total += *(int *) cll_return_element(p_cll, counter);
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    sink += total;
+    cll_destroy(&p_cll, NULL);
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times arg_1 elements joining an intrusive list at the end and then
+ * leaving it in join order, each unlinked through its own link the way a
+ * user leaves a room.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_cll_intrusive_churn (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    cll_intrusive_t list;
+
+    if (SUCCESS != cll_intrusive_init(&list))
+    {
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        cll_intrusive_insert_end(&list, &p_members[counter].list_link);
+    }
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        cll_intrusive_remove(&list, &p_members[counter].list_link);
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times arg_1 elements joining a cll at the end and then leaving it
+ * in join order, each found by address first the way the room code used to.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_cll_churn (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    cll_t * p_cll = cll_init();
+
+    if (NULL == p_cll)
+    {
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        cll_insert_element_end(p_cll, &p_members[counter]);
+    }
+
+    //NOTE: Leaving in join order keeps the element at position 0, so this
+    //times the best case of the old search.
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        for (int position = 0; position < cll_size(p_cll); position++)
+        {
+            if (&p_members[counter] == cll_return_element(p_cll, position))
+            {
+                cll_remove_element(p_cll, position, NULL);
+                break;
+            }
+        }
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    cll_destroy(&p_cll, NULL);
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times visiting every element of an intrusive list of arg_1
+ * elements, the way a room broadcast walks its members.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_cll_intrusive_iterate (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    cll_intrusive_t list;
+
+    if (SUCCESS != cll_intrusive_init(&list))
+    {
+        return 0;
+    }
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        p_members[counter].value = counter;
+        cll_intrusive_insert_end(&list, &p_members[counter].list_link);
+    }
+
+    uint64_t total = 0;
+    uint64_t start = bench_now_ns();
+
+    CLL_INTRUSIVE_FOR_EACH(p_link, &list)
+    {
+        total += CLL_CONTAINER(p_link, bench_member_t, list_link)->value;
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    sink += total;
+
+    while (NULL != cll_intrusive_remove_begin(&list))
+    {
+    }
+
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times arg_1 items going through a queue on one thread. A non-zero
+ * arg_2 uses the intrusive queue instead of queue_t.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_queue_fifo (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    queue_intrusive_t intrusive;
+    queue_t * p_queue = NULL;
+    uint64_t total = 0;
+
+    if (0 != p_case->arg_2)
+    {
+        queue_intrusive_init(&intrusive);
+    }
+    else if (NULL == (p_queue = queue_init()))
+    {
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        bench_member_t * p_member = &p_members[counter % BENCH_MEMBERS];
+
+        if (0 != p_case->arg_2)
+        {
+            queue_intrusive_enqueue(&intrusive, &p_member->queue_link);
+            total += QUEUE_CONTAINER(queue_intrusive_dequeue(&intrusive),
+                                     bench_member_t, queue_link)->value;
+        }
+        else
+        {
+            queue_enqueue(p_queue, p_member);
+            total += ((bench_member_t *) queue_dequeue(p_queue,
+                                                       NULL))->value;
+        }
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    sink += total;
+
+    if (NULL != p_queue)
+    {
+        queue_full_destroy(&p_queue, NULL);
+    }
+
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Producer thread. Enqueues its share of the items under the queue
+ * mutex and wakes a consumer, as t_pool_submit_task does.
+ *
+ * @param p_bench_holder pointer to the shared bench_queue_t.
+ * @return void* NULL.
+ */
+static void *
+bench_queue_producer (void * p_bench_holder)
+{
+    bench_queue_t * p_bench = p_bench_holder;
+
+    for (int counter = 0; counter < p_bench->items; counter++)
+    {
+        pthread_mutex_lock(&p_bench->queue_mutex);
+        queue_enqueue(p_bench->p_queue, &p_values[counter %
+                                        BENCH_TABLE_CAPACITY]);
+        pthread_mutex_unlock(&p_bench->queue_mutex);
+        pthread_cond_signal(&p_bench->queue_cond);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Consumer thread. Dequeues until the producers are done and the
+ * queue is empty, waiting on the condition like t_pool_worker.
+ *
+ * @param p_bench_holder pointer to the shared bench_queue_t.
+ * @return void* NULL.
+ */
+static void *
+bench_queue_consumer (void * p_bench_holder)
+{
+    bench_queue_t * p_bench = p_bench_holder;
+    uint64_t total = 0;
+
+    pthread_mutex_lock(&p_bench->queue_mutex);
+
+    while (true)
+    {
+        while ((0 == queue_size(p_bench->p_queue)) &&
+               (!p_bench->producers_done))
+        {
+            pthread_cond_wait(&p_bench->queue_cond, &p_bench->queue_mutex);
+        }
+
+        if (0 == queue_size(p_bench->p_queue))
+        {
+            break;
+        }
+
+        total += *(int *) queue_dequeue(p_bench->p_queue, NULL);
+    }
+
+    pthread_mutex_unlock(&p_bench->queue_mutex);
+    __atomic_add_fetch(&sink, total, __ATOMIC_RELAXED);
+
+    return NULL;
+}
+
+/**
+ * @brief Times BENCH_QUEUE_ITEMS items going through one queue shared by
+ * arg_1 producers and arg_1 consumers.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_queue_contention (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    pthread_t p_producers[BENCH_POOL_THREADS * 2];
+    pthread_t p_consumers[BENCH_POOL_THREADS * 2];
+    bench_queue_t bench = {
+        .p_queue = queue_init(),
+        .items = BENCH_QUEUE_ITEMS / p_case->arg_1,
+        .producers_done = 0
+    };
+
+    if (NULL == bench.p_queue)
+    {
+        return 0;
+    }
+
+    pthread_mutex_init(&bench.queue_mutex, NULL);
+    pthread_cond_init(&bench.queue_cond, NULL);
+
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        pthread_create(&p_consumers[counter], NULL, bench_queue_consumer,
+                                                                  &bench);
+        pthread_create(&p_producers[counter], NULL, bench_queue_producer,
+                                                                  &bench);
+    }
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        pthread_join(p_producers[counter], NULL);
+    }
+
+    pthread_mutex_lock(&bench.queue_mutex);
+    bench.producers_done = 1;
+    pthread_mutex_unlock(&bench.queue_mutex);
+    pthread_cond_broadcast(&bench.queue_cond);
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        pthread_join(p_consumers[counter], NULL);
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    queue_full_destroy(&bench.p_queue, NULL);
+    pthread_mutex_destroy(&bench.queue_mutex);
+    pthread_cond_destroy(&bench.queue_cond);
+    p_case->ops = (uint64_t) bench.items * p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Thread pool task. Records when it started running.
+ *
+ * @param p_task_holder pointer to the bench_task_t.
+ */
+static void
+bench_pool_task (void * p_task_holder)
+{
+    bench_task_t * p_task = p_task_holder;
+
+    p_task->run_ns = bench_now_ns();
+    __atomic_add_fetch(p_task->p_done, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Times submitting arg_1 tasks to a pool of BENCH_POOL_THREADS
+ * threads and records the submit-to-run latency of every task. A non-zero
+ * arg_2 submits them back to back, otherwise every task runs on an idle pool.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist histogram the latencies are recorded in.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_t_pool_latency (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    uint8_t threads = BENCH_POOL_THREADS;
+    t_pool_t * p_t_pool = t_pool_init(&threads);
+    bench_task_t * p_tasks = calloc(p_case->arg_1, sizeof(bench_task_t));
+    volatile int done = 0;
+
+    if ((NULL == p_t_pool) || (NULL == p_tasks))
+    {
+        fprintf(stderr, "bench_t_pool_latency: setup failure\n");
+        FREE(p_tasks);
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        p_tasks[counter].p_done = &done;
+        p_tasks[counter].submit_ns = bench_now_ns();
+        t_pool_submit_task(p_t_pool, bench_pool_task, &p_tasks[counter]);
+
+        while ((0 == p_case->arg_2) &&
+               ((counter + 1) > __atomic_load_n(&done, __ATOMIC_ACQUIRE)))
+        {
+            sched_yield();
+        }
+    }
+
+    while (p_case->arg_1 > __atomic_load_n(&done, __ATOMIC_ACQUIRE))
+    {
+        sched_yield();
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    for (int counter = 0; counter < p_case->arg_1; counter++)
+    {
+        bench_hist_record(p_hist, (p_tasks[counter].run_ns -
+                                   p_tasks[counter].submit_ns));
+    }
+
+    t_pool_destroy(p_t_pool, WAIT);
+    FREE(p_tasks);
+    p_case->ops = p_case->arg_1;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times is_prime on every value from 2 to BENCH_PRIME_LIMIT.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds.
+ */
+static uint64_t
+bench_is_prime (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    uint64_t primes = 0;
+    uint64_t start = bench_now_ns();
+
+    for (uint16_t value = 2; value < BENCH_PRIME_LIMIT; value++)
+    {
+        primes += is_prime(value);
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    sink += primes;
+    p_case->ops = BENCH_PRIME_LIMIT - 2;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times next_prime on every value up to BENCH_PRIME_LIMIT, the
+ * capacities h_table_re_hash can grow from.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds.
+ */
+static uint64_t
+bench_next_prime (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    uint64_t total = 0;
+    uint64_t start = bench_now_ns();
+
+    for (uint16_t value = 0; value < BENCH_PRIME_LIMIT; value++)
+    {
+        total += next_prime(value);
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    sink += total;
+    p_case->ops = BENCH_PRIME_LIMIT;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times recording flight recorder events into one thread's ring.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds.
+ */
+static uint64_t
+bench_trace_record (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    if (SUCCESS != cr_trace_start())
+    {
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (uint32_t counter = 0; counter < BENCH_TRACE_EVENTS; counter++)
+    {
+        cr_trace_record(TRACE_PACKET_RECEIVED, 0, counter);
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    cr_trace_stop();
+    p_case->ops = BENCH_TRACE_EVENTS;
+
+    return elapsed;
+}
+
+/**
+ * @brief Times an uncontended CR_MUTEX_LOCK and CR_MUTEX_UNLOCK pair with
+ * the flight recorder on (arg_1 = 1) or off (arg_1 = 0).
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds.
+ */
+static uint64_t
+bench_trace_lock (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    if ((p_case->arg_1) && (SUCCESS != cr_trace_start()))
+    {
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (uint32_t counter = 0; counter < BENCH_TRACE_EVENTS; counter++)
+    {
+        CR_MUTEX_LOCK(&mutex);
+        sink++;
+        CR_MUTEX_UNLOCK(&mutex);
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    cr_trace_stop();
+    p_case->ops = BENCH_TRACE_EVENTS;
+
+    return elapsed;
+}
+
+/**
+ * @brief Frees a batch of objects with free or slab_free.
+ *
+ * @param p_bench_holder pointer to the bench_alloc_t.
+ * @return void* NULL.
+ */
+static void *
+bench_alloc_free (void * p_bench_holder)
+{
+    bench_alloc_t * p_bench = p_bench_holder;
+
+    for (int counter = 0; counter < BENCH_ALLOC_BATCH; counter++)
+    {
+        if (NULL == p_bench->p_slab)
+        {
+            free(p_bench->pp_objects[counter]);
+        }
+        else
+        {
+            slab_free(p_bench->pp_objects[counter]);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Times allocating and freeing BENCH_ALLOC_ROUNDS batches of objects
+ * with calloc (arg_1 = 0) or a slab (arg_1 = 1). The batch is freed on the
+ * allocating thread (arg_2 = 0) or on another thread (arg_2 = 1), as a
+ * package allocated by an acceptor is freed by a session.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_alloc (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    void * pp_objects[BENCH_ALLOC_BATCH];
+    bench_alloc_t bench = {
+        .p_slab = NULL,
+        .pp_objects = pp_objects
+    };
+
+    if ((p_case->arg_1) &&
+        (NULL == (bench.p_slab = slab_init(BENCH_ALLOC_SIZE))))
+    {
+        return 0;
+    }
+
+    uint64_t start = bench_now_ns();
+
+    for (int round = 0; round < BENCH_ALLOC_ROUNDS; round++)
+    {
+        for (int counter = 0; counter < BENCH_ALLOC_BATCH; counter++)
+        {
+            pp_objects[counter] = (NULL == bench.p_slab) ?
+                                  calloc(1, BENCH_ALLOC_SIZE) :
+                                  slab_alloc(bench.p_slab);
+        }
+
+        if (p_case->arg_2)
+        {
+            pthread_t thread;
+            pthread_create(&thread, NULL, bench_alloc_free, &bench);
+            pthread_join(thread, NULL);
+        }
+        else
+        {
+            bench_alloc_free(&bench);
+        }
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    if (NULL != bench.p_slab)
+    {
+        slab_destroy(&bench.p_slab);
+    }
+
+    p_case->ops = (uint64_t) BENCH_ALLOC_ROUNDS * BENCH_ALLOC_BATCH;
+
+    return elapsed;
+}
+
+/**
+ * @brief Writer thread. Flips every member's login_status until told to
+ * stop, as logins and logouts on other sessions would.
+ *
+ * @param p_bench_holder pointer to the shared bench_broadcast_t.
+ * @return void* NULL.
+ */
+static void *
+bench_broadcast_writer (void * p_bench_holder)
+{
+    bench_broadcast_t * p_bench = p_bench_holder;
+
+    while (!__atomic_load_n(&p_bench->stop, __ATOMIC_RELAXED))
+    {
+        for (int counter = 0; counter < BENCH_BROADCAST_MEMBERS; counter++)
+        {
+            volatile int * p_login = (volatile int *)
+                ((char *) p_bench->pp_users[counter] + p_bench->login_offset);
+
+            *p_login = !*p_login;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Times BENCH_BROADCAST_ROUNDS broadcasts to a room of
+ * BENCH_BROADCAST_MEMBERS members, reading each member's p_ssl_holder
+ * through its room_link. arg_1 picks the layout, the old packed one (0) or
+ * user_t (1), and a non-zero arg_2 runs a thread writing login_status of
+ * every member meanwhile.
+ *
+ * @param p_case pointer to the case.
+ * @param p_hist unused.
+ * @return uint64_t elapsed nanoseconds, zero on failure.
+ */
+static uint64_t
+bench_broadcast (bench_case_t * p_case, bench_hist_t * p_hist)
+{
+    (void) p_hist;
+
+    static bench_broadcast_t bench;
+    size_t user_size = sizeof(bench_packed_user_t);
+
+    memset(&bench, 0, sizeof(bench));
+    bench.link_offset = offsetof(bench_packed_user_t, room_link);
+    bench.ssl_offset = offsetof(bench_packed_user_t, p_ssl_holder);
+    bench.login_offset = offsetof(bench_packed_user_t, login_status);
+
+    if (p_case->arg_1)
+    {
+        user_size = sizeof(user_t);
+        bench.link_offset = offsetof(user_t, room_link);
+        bench.ssl_offset = offsetof(user_t, p_ssl_holder);
+        bench.login_offset = offsetof(user_t, login_status);
+    }
+
+    cll_intrusive_init(&bench.members);
+
+    for (int counter = 0; counter < BENCH_BROADCAST_MEMBERS; counter++)
+    {
+        bench.pp_users[counter] = (p_case->arg_1) ?
+                                  cr_alloc_aligned(user_size) :
+                                  calloc(1, user_size);
+
+        if (NULL == bench.pp_users[counter])
+        {
+            for (int index = 0; index < counter; index++)
+            {
+                free(bench.pp_users[index]);
+            }
+
+            return 0;
+        }
+
+        *(uintptr_t *) ((char *) bench.pp_users[counter] +
+                        bench.ssl_offset) = (uintptr_t) counter + 1;
+        cll_intrusive_insert_end(&bench.members, (cll_link_t *)
+                        ((char *) bench.pp_users[counter] +
+                                        bench.link_offset));
+    }
+
+    pthread_t writer;
+
+    if (p_case->arg_2)
+    {
+        pthread_create(&writer, NULL, bench_broadcast_writer, &bench);
+    }
+
+    uint64_t total = 0;
+    uint64_t start = bench_now_ns();
+
+    for (int round = 0; round < BENCH_BROADCAST_ROUNDS; round++)
+    {
+        CLL_INTRUSIVE_FOR_EACH(p_link, &bench.members)
+        {
+            char * p_user = (char *) p_link - bench.link_offset;
+
+            total += *(volatile uintptr_t *) (p_user + bench.ssl_offset);
+        }
+    }
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    if (p_case->arg_2)
+    {
+        __atomic_store_n(&bench.stop, 1, __ATOMIC_RELAXED);
+        pthread_join(writer, NULL);
+    }
+
+    sink += total;
+
+    for (int counter = 0; counter < BENCH_BROADCAST_MEMBERS; counter++)
+    {
+        free(bench.pp_users[counter]);
+    }
+
+    p_case->ops = (uint64_t) BENCH_BROADCAST_ROUNDS *
+                             BENCH_BROADCAST_MEMBERS;
+
+    return elapsed;
+}
+
+//NOTE: Loads stay below 0.75, where h_table_new_entry starts to re-hash.
+//The grow case starts small so nearly every insert re-hashes.
+static bench_case_t p_cases[] = {
+    {"h_table_insert", "{\"capacity\": 4099, \"load\": 0.25}", 1024,
+                          BENCH_TABLE_CAPACITY, bench_h_table_insert, 0},
+    {"h_table_insert", "{\"capacity\": 4099, \"load\": 0.50}", 2049,
+                          BENCH_TABLE_CAPACITY, bench_h_table_insert, 0},
+    {"h_table_insert", "{\"capacity\": 4099, \"load\": 0.70}", 2869,
+                          BENCH_TABLE_CAPACITY, bench_h_table_insert, 0},
+    {"h_table_insert_grow", "{\"capacity\": 11, \"entries\": 512}",
+     BENCH_GROW_ENTRIES, BENCH_GROW_CAPACITY, bench_h_table_insert, 0},
+    {"h_table_lookup_hit", "{\"capacity\": 4099, \"load\": 0.25}", 1024, 0,
+                                               bench_h_table_lookup, 0},
+    {"h_table_lookup_hit", "{\"capacity\": 4099, \"load\": 0.50}", 2049, 0,
+                                               bench_h_table_lookup, 0},
+    {"h_table_lookup_hit", "{\"capacity\": 4099, \"load\": 0.70}", 2869, 0,
+                                               bench_h_table_lookup, 0},
+    {"h_table_lookup_miss", "{\"capacity\": 4099, \"load\": 0.70}", 2869,
+                            BENCH_LOOKUP_MISS, bench_h_table_lookup, 0},
+    {"h_table_lookup_hit", "{\"capacity\": 4096, \"sizing\": "
+        "\"power_of_two\", \"load\": 0.25}", 1024, BENCH_LOOKUP_POW2,
+                                               bench_h_table_lookup, 0},
+    {"h_table_lookup_hit", "{\"capacity\": 4096, \"sizing\": "
+        "\"power_of_two\", \"load\": 0.50}", 2048, BENCH_LOOKUP_POW2,
+                                               bench_h_table_lookup, 0},
+    {"h_table_lookup_hit", "{\"capacity\": 4096, \"sizing\": "
+        "\"power_of_two\", \"load\": 0.70}", 2867, BENCH_LOOKUP_POW2,
+                                               bench_h_table_lookup, 0},
+    {"h_table_lookup_miss", "{\"capacity\": 4096, \"sizing\": "
+        "\"power_of_two\", \"load\": 0.70}", 2867,
+        (BENCH_LOOKUP_MISS | BENCH_LOOKUP_POW2), bench_h_table_lookup, 0},
+    {"h_table_delete", "{\"capacity\": 4099, \"load\": 0.25}", 1024, 0,
+                                               bench_h_table_delete, 0},
+    {"h_table_delete", "{\"capacity\": 4099, \"load\": 0.70}", 2869, 0,
+                                               bench_h_table_delete, 0},
+    {"cll_insert_end", "{\"elements\": 1024}", 1024, 0, bench_cll_insert, 0},
+    {"cll_insert_begin", "{\"elements\": 1024}", 1024, 1, bench_cll_insert,
+                                                                         0},
+    {"cll_remove_begin", "{\"elements\": 1024}", 1024, 0, bench_cll_remove,
+                                                                         0},
+    {"cll_remove_end", "{\"elements\": 1024}", 1024, 1, bench_cll_remove, 0},
+    {"cll_iterate", "{\"elements\": 64}", 64, 0, bench_cll_iterate, 0},
+    {"cll_iterate", "{\"elements\": 1024}", 1024, 0, bench_cll_iterate, 0},
+    {"cll_intrusive_iterate", "{\"elements\": 1024}", 1024, 0,
+                                        bench_cll_intrusive_iterate, 0},
+    {"cll_churn", "{\"elements\": 1024}", 1024, 0, bench_cll_churn, 0},
+    {"cll_intrusive_churn", "{\"elements\": 1024}", 1024, 0,
+                                          bench_cll_intrusive_churn, 0},
+    {"queue_fifo", "{\"queue\": \"queue_t\"}", BENCH_QUEUE_ITEMS, 0,
+                                                   bench_queue_fifo, 0},
+    {"queue_fifo", "{\"queue\": \"intrusive\"}", BENCH_QUEUE_ITEMS, 1,
+                                                   bench_queue_fifo, 0},
+    {"queue_contention", "{\"producers\": 1, \"consumers\": 1}", 1, 0,
+                                             bench_queue_contention, 0},
+    {"queue_contention", "{\"producers\": 2, \"consumers\": 2}", 2, 0,
+                                             bench_queue_contention, 0},
+    {"queue_contention", "{\"producers\": 4, \"consumers\": 4}", 4, 0,
+                                             bench_queue_contention, 0},
+    {"t_pool_latency", "{\"threads\": 4, \"submit\": \"idle\"}",
+                BENCH_POOL_IDLE_TASKS, 0, bench_t_pool_latency, 0},
+    {"t_pool_latency", "{\"threads\": 4, \"submit\": \"burst\"}",
+                BENCH_POOL_BURST_TASKS, 1, bench_t_pool_latency, 0},
+    {"is_prime", "{\"values\": 65000}", 0, 0, bench_is_prime, 0},
+    {"next_prime", "{\"values\": 65000}", 0, 0, bench_next_prime, 0},
+    {"trace_record", "{\"events\": 1000000}", 0, 0, bench_trace_record, 0},
+    {"trace_lock", "{\"recorder\": \"off\"}", 0, 0, bench_trace_lock, 0},
+    {"trace_lock", "{\"recorder\": \"on\"}", 1, 0, bench_trace_lock, 0},
+    {"alloc_free", "{\"allocator\": \"calloc\", \"free\": \"local\"}", 0,
+                                                         0, bench_alloc, 0},
+    {"alloc_free", "{\"allocator\": \"slab\", \"free\": \"local\"}", 1, 0,
+                                                            bench_alloc, 0},
+    {"alloc_free", "{\"allocator\": \"calloc\", \"free\": \"remote\"}", 0,
+                                                         1, bench_alloc, 0},
+    {"alloc_free", "{\"allocator\": \"slab\", \"free\": \"remote\"}", 1,
+                                                         1, bench_alloc, 0},
+    {"room_broadcast", "{\"layout\": \"packed\", \"writer\": 0}", 0, 0,
+                                                       bench_broadcast, 0},
+    {"room_broadcast", "{\"layout\": \"split\", \"writer\": 0}", 1, 0,
+                                                       bench_broadcast, 0},
+    {"room_broadcast", "{\"layout\": \"packed\", \"writer\": 1}", 0, 1,
+                                                       bench_broadcast, 0},
+    {"room_broadcast", "{\"layout\": \"split\", \"writer\": 1}", 1, 1,
+                                                       bench_broadcast, 0}
+};
+
+/**
+ * @brief Compares two doubles for qsort.
+ *
+ * @param p_first first value.
+ * @param p_second second value.
+ * @return int negative, zero or positive.
+ */
+static int
+bench_compare (const void * p_first, const void * p_second)
+{
+    double first = *(const double *) p_first;
+    double second = *(const double *) p_second;
+
+    return (first > second) - (first < second);
+}
+
+/**
+ * @brief Runs a case the requested number of times and prints its JSON
+ * object.
+ *
+ * @param p_file output stream.
+ * @param p_case pointer to the case.
+ * @param repetitions number of runs.
+ * @param first whether this is the first object printed.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+bench_run (FILE * p_file, bench_case_t * p_case, int repetitions, int first)
+{
+    double p_ns_per_op[BENCH_MAX_REPETITIONS] = {0};
+    bench_hist_t * p_hist = calloc(1, sizeof(bench_hist_t));
+
+    if (NULL == p_hist)
+    {
+        perror("bench_run: p_hist calloc");
+        return FAILURE;
+    }
+
+    for (int counter = 0; counter < repetitions; counter++)
+    {
+        uint64_t elapsed = p_case->p_run(p_case, p_hist);
+
+        if ((0 == elapsed) || (0 == p_case->ops))
+        {
+            fprintf(stderr, "bench_run: %s failed\n", p_case->p_name);
+            FREE(p_hist);
+            return FAILURE;
+        }
+
+        p_ns_per_op[counter] = (double) elapsed / p_case->ops;
+    }
+
+    qsort(p_ns_per_op, repetitions, sizeof(double), bench_compare);
+
+    fprintf(p_file, "%s    {\"name\": \"%s\", \"params\": %s, "
+            "\"ops\": %" PRIu64 ", \"ns_per_op\": %.2f, "
+            "\"min_ns_per_op\": %.2f, \"max_ns_per_op\": %.2f",
+            first ? "" : ",\n", p_case->p_name, p_case->p_params,
+            p_case->ops, p_ns_per_op[repetitions / 2], p_ns_per_op[0],
+            p_ns_per_op[repetitions - 1]);
+
+    if (0 != p_hist->total)
+    {
+        fprintf(p_file, ", \"p50_ns\": %" PRIu64 ", \"p99_ns\": %" PRIu64
+                ", \"p999_ns\": %" PRIu64 ", \"max_ns\": %" PRIu64,
+                bench_hist_percentile(p_hist, 50.0),
+                bench_hist_percentile(p_hist, 99.0),
+                bench_hist_percentile(p_hist, 99.9),
+                bench_hist_percentile(p_hist, 100.0));
+    }
+
+    fprintf(p_file, "}");
+    fflush(p_file);
+    FREE(p_hist);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Driver code for the library benchmarks.
+ *
+ * @param argc argument count.
+ * @param argv arguments.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+main (int argc, char ** argv)
+{
+    int repetitions = BENCH_REPETITIONS;
+    const char * p_filter = NULL;
+    const char * p_output = NULL;
+    int option = 0;
+
+    while (-1 != (option = getopt(argc, argv, "r:f:o:")))
+    {
+        switch (option)
+        {
+            case 'r':
+                repetitions = atoi(optarg);
+                break;
+            case 'f':
+                p_filter = optarg;
+                break;
+            case 'o':
+                p_output = optarg;
+                break;
+            default:
+                repetitions = 0;
+                break;
+        }
+    }
+
+    if ((1 > repetitions) || (BENCH_MAX_REPETITIONS < repetitions))
+    {
+        fprintf(stderr, "usage: %s [-r repetitions (1-%d)] [-f name filter] "
+                        "[-o output file]\n", argv[0], BENCH_MAX_REPETITIONS);
+        return FAILURE;
+    }
+
+    FILE * p_file = stdout;
+
+    if ((NULL != p_output) && (NULL == (p_file = fopen(p_output, "w"))))
+    {
+        perror("main: fopen");
+        return FAILURE;
+    }
+
+    for (int counter = 0; counter < BENCH_TABLE_CAPACITY; counter++)
+    {
+        snprintf(pp_keys[counter], (KEY_LENGTH + 1), "key%07d", counter);
+        snprintf(pp_missing_keys[counter], (KEY_LENGTH + 1), "nok%07d",
+                                                                counter);
+        p_values[counter] = counter;
+    }
+
+    //NOTE: The library code is timed as built, an unoptimized build is
+    //flagged so it isn't compared with an optimized one by mistake.
+#ifdef __OPTIMIZE__
+    const char * p_optimized = "true";
+#else
+    const char * p_optimized = "false";
+#endif
+
+    fprintf(p_file, "{\n  \"suite\": \"chat_room_bench\",\n"
+            "  \"repetitions\": %d,\n  \"optimized\": %s,\n"
+            "  \"benchmarks\": [\n", repetitions, p_optimized);
+
+    int return_val = SUCCESS;
+    int first = 1;
+
+    for (size_t counter = 0; counter < (sizeof(p_cases) / sizeof(p_cases[0]));
+                                                                   counter++)
+    {
+        if ((NULL != p_filter) && (NULL == strstr(p_cases[counter].p_name,
+                                                             p_filter)))
+        {
+            continue;
+        }
+
+        if (FAILURE == bench_run(p_file, &p_cases[counter], repetitions,
+                                                                 first))
+        {
+            return_val = FAILURE;
+            break;
+        }
+
+        first = 0;
+    }
+
+    fprintf(p_file, "\n  ]\n}\n");
+
+    if (stdout != p_file)
+    {
+        fclose(p_file);
+    }
+
+    return return_val;
+}
+
+//End of cr_bench.c file
@@ -0,0 +1,117 @@
+#!/bin/bash
+#Loopback cluster. Starts NODES chat_room processes on 127.0.0.1, each in its
+#own directory with a shared cluster.txt, and keeps them running until
+#interrupted. Clients connect to PORT, PORT + 1, ...; the nodes talk to each
+#other on BUS_PORT, BUS_PORT + 1, ...
+#
+#Usage: bench/cr_cluster_run.sh [build dir] [work dir]
+#Environment: NODES, PORT, BUS_PORT, WORKERS (room workers per node).
+
+set -e
+
+SERVER_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=$(cd "${1:-$SERVER_DIR/build}" && pwd)
+NODES=${NODES:-3}
+PORT=${PORT:-4400}
+BUS_PORT=${BUS_PORT:-4500}
+WORKERS=${WORKERS:-0}
+
+MAX_TOTAL=$(sed -n 's/^#define MAX_TOTAL_CLIENTS \([0-9]*\).*/\1/p' \
+    "$SERVER_DIR/include/cr_shared.h")
+
+if [ -n "$2" ]; then
+    mkdir -p "$2"
+    WORK_DIR=$(cd "$2" && pwd)
+    KEEP=1
+else
+    WORK_DIR=$(mktemp -d)
+    KEEP=0
+fi
+
+PIDS=""
+
+cleanup () {
+    for PID in $PIDS; do
+        kill -INT "$PID" 2>/dev/null || true
+    done
+    for PID in $PIDS; do
+        wait "$PID" 2>/dev/null || true
+    done
+    if [ "$KEEP" -eq 0 ]; then
+        rm -rf "$WORK_DIR"
+    fi
+}
+trap cleanup EXIT
+
+#The self-signed pair from gen_certs_run.sh, made without prompts if it has
+#not been generated yet or has expired, which the nodes refuse on the bus.
+if [ -f "$SERVER_DIR/server.crt" ] && [ -f "$SERVER_DIR/server.key" ] &&
+    openssl x509 -checkend 0 -noout -in "$SERVER_DIR/server.crt" >/dev/null; then
+    cp "$SERVER_DIR/server.crt" "$SERVER_DIR/server.key" "$WORK_DIR"
+else
+    openssl genpkey -algorithm RSA -out "$WORK_DIR/server.key" 2>/dev/null
+    openssl req -new -key "$WORK_DIR/server.key" -subj "/CN=localhost" \
+        -out "$WORK_DIR/server.csr"
+    openssl x509 -req -days 365 -in "$WORK_DIR/server.csr" \
+        -signkey "$WORK_DIR/server.key" -out "$WORK_DIR/server.crt" 2>/dev/null
+fi
+
+: > "$WORK_DIR/cluster.txt"
+for NODE in $(seq "$NODES"); do
+    echo "$NODE:127.0.0.1:$((BUS_PORT + NODE - 1))" >> "$WORK_DIR/cluster.txt"
+done
+
+for NODE in $(seq "$NODES"); do
+    RUN_DIR="$WORK_DIR/node$NODE"
+    mkdir -p "$RUN_DIR"
+    rm -rf "$RUN_DIR/rooms"
+    cp "$WORK_DIR/server.crt" "$WORK_DIR/server.key" "$WORK_DIR/cluster.txt" \
+        "$RUN_DIR"
+    #The nodes share one certificate, so it is also the only one they trust.
+    cp "$WORK_DIR/server.crt" "$RUN_DIR/cluster_ca.crt"
+    printf "admin:password\n" > "$RUN_DIR/users.txt"
+
+    cat > "$RUN_DIR/config.txt" <<EOF
+Server Listening Hostname/IP:
+127.0.0.1
+
+Server Listening Port:
+$((PORT + NODE - 1))
+
+Max room count:
+20
+
+Max client count:
+$((MAX_TOTAL - 1))
+
+Update flush window (ms):
+5
+
+History compression level (0-9):
+6
+
+Metrics port (0 off, loopback only):
+0
+
+Acceptor threads (0 one per core):
+1
+
+Pin acceptors to cores (0 off, 1 on):
+0
+
+Room worker threads (0 off):
+$WORKERS
+
+Cluster node id (0 off, nodes in cluster.txt):
+$NODE
+EOF
+
+    (cd "$RUN_DIR" && exec "$BUILD_DIR/chat_room" > server.log 2>&1) &
+    PIDS="$PIDS $!"
+    echo "cluster: node $NODE on 127.0.0.1:$((PORT + NODE - 1)), logs in $RUN_DIR"
+done
+
+echo "cluster: $NODES nodes running, interrupt to stop"
+wait
+
+#End of cr_cluster_run.sh file
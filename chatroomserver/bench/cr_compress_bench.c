@@ -0,0 +1,260 @@
+//NOTE: Measures what compression saves on the wire and what it costs in CPU.
+//Room histories and chat updates are built from a fixed word list so runs are
+//repeatable, then encoded the way cr_msg_write encodes them for a v2
+//connection with and without zlib.
+
+#include <time.h>
+
+#include "../include/cr_shared.h"
+#include "../include/cr_frame.h"
+#include "../include/cr_compress.h"
+
+#define BENCH_HISTORIES 64
+#define BENCH_ITERATIONS 20000
+#define BENCH_WORDS 24
+#define BENCH_USERS 6
+
+static const char * p_words[BENCH_WORDS] = {
+    "hello", "there", "how", "are", "you", "doing", "today", "the", "build",
+    "is", "green", "again", "did", "anyone", "see", "that", "game", "last",
+    "night", "lunch", "at", "noon", "sounds", "good"
+};
+
+static const char * p_users[BENCH_USERS] = {
+    "admin", "alice", "bob_the_builder", "carol", "dave99", "guest"
+};
+
+/**
+ * @brief Returns the CPU time used by the process in nanoseconds.
+ *
+ * @return uint64_t CPU time.
+ */
+static uint64_t
+bench_cpu_ns ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * @brief Writes a random chat of a few words.
+ *
+ * @param p_chat buffer the chat is written to (MAX_CHAT_LEN + 1).
+ * @param p_seed rand_r seed.
+ */
+static void
+bench_chat (char * p_chat, unsigned int * p_seed)
+{
+    int word_count = 2 + (rand_r(p_seed) % 8);
+    size_t len = 0;
+    p_chat[0] = '\0';
+
+    for (int counter = 0; counter < word_count; counter++)
+    {
+        const char * p_word = p_words[rand_r(p_seed) % BENCH_WORDS];
+
+        if ((len + strlen(p_word) + 1) >= MAX_CHAT_LEN)
+        {
+            break;
+        }
+
+        len += sprintf((p_chat + len), (0 == counter) ? "%s" : " %s", p_word);
+    }
+}
+
+/**
+ * @brief Builds a v1 join acknowledge holding a full room log
+ * (MAX_CHAT_FILE_SIZE bytes of "<seq> <username>><chat>" lines).
+ *
+ * @param p_packet buffer for the packet (MAX_FRAME_LENGTH).
+ * @param seed rand_r seed.
+ * @param p_lines set to the number of log lines in the history.
+ * @return size_t length of the packet.
+ */
+static size_t
+bench_join_ack (char * p_packet, unsigned int seed, int * p_lines)
+{
+    char p_history[MAX_CHAT_FILE_SIZE + MAX_LOG_LINE_LENGTH] = {0};
+    size_t history_len = 0;
+    uint64_t seq = seed * 1000;
+    *p_lines = 0;
+
+    while (history_len < MAX_CHAT_FILE_SIZE)
+    {
+        char p_chat[MAX_CHAT_LEN + 1] = {0};
+        char p_line[MAX_LOG_LINE_LENGTH + 1] = {0};
+        bench_chat(p_chat, &seed);
+
+        int line_len = snprintf(p_line, sizeof(p_line), "%" PRIu64 " %s>%s\n",
+                         ++seq, p_users[rand_r(&seed) % BENCH_USERS], p_chat);
+
+        if ((history_len + line_len) > MAX_CHAT_FILE_SIZE)
+        {
+            break;
+        }
+
+        memcpy((p_history + history_len), p_line, line_len);
+        history_len += line_len;
+        (*p_lines)++;
+    }
+
+    join_ack_t join_ack = {
+        .type = ROOMS_TYPE,
+        .s_type = JOIN_STYPE,
+        .opcode = ACKNOWLEDGE,
+        .seq = htobe64(seq),
+        .history_len = htobe16(history_len)
+    };
+
+    memcpy(p_packet, &join_ack, sizeof(join_ack_t));
+    memcpy((p_packet + sizeof(join_ack_t)), p_history, history_len);
+
+    return sizeof(join_ack_t) + history_len;
+}
+
+/**
+ * @brief Encodes every history for BENCH_ITERATIONS rounds and prints bytes
+ * on the wire and CPU per message.
+ *
+ * @param pp_packets v1 join acknowledges.
+ * @param p_packet_lens lengths of the join acknowledges.
+ * @param total_lines number of log lines across all histories.
+ * @param compression algorithm to encode with.
+ * @param p_label row label.
+ */
+static void
+bench_histories (char (* pp_packets)[MAX_FRAME_LENGTH], size_t * p_packet_lens,
+                 int total_lines, uint8_t compression, const char * p_label)
+{
+    char p_frame[MAX_FRAME_LENGTH + MAX_VARINT_LENGTH] = {0};
+    uint64_t raw_bytes = 0;
+    uint64_t wire_bytes = 0;
+    int rounds = BENCH_ITERATIONS / BENCH_HISTORIES;
+
+    uint64_t start = bench_cpu_ns();
+
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int counter = 0; counter < BENCH_HISTORIES; counter++)
+        {
+            raw_bytes += p_packet_lens[counter];
+            wire_bytes += cr_frame_encode(pp_packets[counter],
+                        p_packet_lens[counter], p_frame, sizeof(p_frame),
+                                                             compression);
+        }
+    }
+
+    uint64_t cpu_ns = bench_cpu_ns() - start;
+    uint64_t messages = (uint64_t) rounds * BENCH_HISTORIES;
+
+    printf("%-10s %-6s %12.1f %12.1f %8.3f %12.1f %10.1f\n", "history",
+           p_label, (double) raw_bytes / messages,
+           (double) wire_bytes / messages,
+           (double) wire_bytes / raw_bytes,
+           (double) cpu_ns / messages,
+           (double) cpu_ns / ((uint64_t) rounds * total_lines));
+}
+
+/**
+ * @brief Encodes chat updates and prints bytes on the wire and CPU per
+ * message for v1, v2, and v2 with each update compressed on its own.
+ */
+static void
+bench_updates ()
+{
+    char p_frame[MAX_FRAME_LENGTH + MAX_VARINT_LENGTH] = {0};
+    char p_compressed[MAX_FRAME_LENGTH] = {0};
+    uint64_t v1_bytes = 0;
+    uint64_t v2_bytes = 0;
+    uint64_t zlib_bytes = 0;
+    uint64_t v2_ns = 0;
+    uint64_t zlib_ns = 0;
+    unsigned int seed = 1;
+
+    for (int counter = 0; counter < BENCH_ITERATIONS; counter++)
+    {
+        chat_update_t update;
+        memset(&update, 0, sizeof(chat_update_t));
+        update.type = CHAT_TYPE;
+        update.s_type = CHAT_STYPE;
+        update.opcode = ACKNOWLEDGE;
+        update.seq = htobe64(counter + 1);
+        strncpy(update.p_chat, p_users[rand_r(&seed) % BENCH_USERS],
+                                                MAX_USERNAME_LENGTH);
+        update.p_chat[MAX_USERNAME_LENGTH] = '>';
+        bench_chat((update.p_chat + MAX_USERNAME_LENGTH + 1), &seed);
+
+        uint64_t start = bench_cpu_ns();
+        int frame_len = cr_frame_encode((char *) &update, sizeof(update),
+                        p_frame, sizeof(p_frame), COMPRESS_NONE);
+        uint64_t middle = bench_cpu_ns();
+        int zlib_len = cr_compress_deflate(p_frame, frame_len, p_compressed,
+                                                    sizeof(p_compressed));
+        uint64_t end = bench_cpu_ns();
+
+        v1_bytes += sizeof(chat_update_t);
+        v2_bytes += frame_len;
+        zlib_bytes += zlib_len;
+        v2_ns += middle - start;
+        zlib_ns += end - start;
+    }
+
+    printf("%-10s %-6s %12.1f %12.1f %8.3f %12.1f %10s\n", "update", "v1",
+           (double) v1_bytes / BENCH_ITERATIONS,
+           (double) v1_bytes / BENCH_ITERATIONS, 1.0, 0.0, "-");
+    printf("%-10s %-6s %12.1f %12.1f %8.3f %12.1f %10s\n", "update", "v2",
+           (double) v1_bytes / BENCH_ITERATIONS,
+           (double) v2_bytes / BENCH_ITERATIONS,
+           (double) v2_bytes / v1_bytes,
+           (double) v2_ns / BENCH_ITERATIONS, "-");
+    printf("%-10s %-6s %12.1f %12.1f %8.3f %12.1f %10s\n", "update", "v2+z",
+           (double) v1_bytes / BENCH_ITERATIONS,
+           (double) zlib_bytes / BENCH_ITERATIONS,
+           (double) zlib_bytes / v1_bytes,
+           (double) zlib_ns / BENCH_ITERATIONS, "-");
+}
+
+/**
+ * @brief Driver code for the compression benchmark.
+ *
+ * @return int SUCCESS (0).
+ */
+int
+main ()
+{
+    static char pp_packets[BENCH_HISTORIES][MAX_FRAME_LENGTH];
+    size_t p_packet_lens[BENCH_HISTORIES] = {0};
+    int total_lines = 0;
+
+    for (int counter = 0; counter < BENCH_HISTORIES; counter++)
+    {
+        int lines = 0;
+        p_packet_lens[counter] = bench_join_ack(pp_packets[counter],
+                                                (counter + 1), &lines);
+        total_lines += lines;
+    }
+
+    printf("%-10s %-6s %12s %12s %8s %12s %10s\n", "payload", "level",
+           "v1_bytes", "wire_bytes", "ratio", "cpu_ns/msg", "cpu_ns/line");
+
+    bench_histories(pp_packets, p_packet_lens, total_lines, COMPRESS_NONE,
+                                                                   "v2");
+
+    for (int level = 1; level <= MAX_COMPRESS_LEVEL; level++)
+    {
+        char p_label[8] = {0};
+        snprintf(p_label, sizeof(p_label), "z%d", level);
+        cr_compress_set_level(level);
+        bench_histories(pp_packets, p_packet_lens, total_lines,
+                                       COMPRESS_ZLIB, p_label);
+    }
+
+    cr_compress_set_level(DEFAULT_COMPRESS_LEVEL);
+    bench_updates();
+
+    return SUCCESS;
+}
+
+//End of cr_compress_bench.c file
@@ -0,0 +1,128 @@
+#!/bin/bash
+#Fan-out sweep. Starts a fresh chat_room on loopback for every room size,
+#runs chat_room_loadgen -F against it, and appends one JSON line per size to
+#the report, labelled with the git revision so releases can be compared.
+#
+#Usage: bench/cr_fanout_sweep.sh [build dir] [report file]
+#Environment: SIZES (listener counts), SENDERS, RATE (msgs/s), DURATION (s),
+#THREADS (loadgen threads), PORT, LABEL.
+
+set -e
+
+SERVER_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=$(cd "${1:-$SERVER_DIR/build}" && pwd)
+REPORT=$(realpath -m "${2:-fanout_report.jsonl}")
+SIZES=${SIZES:-"10 50 100 500 1000 5000"}
+SENDERS=${SENDERS:-4}
+RATE=${RATE:-200}
+DURATION=${DURATION:-10}
+THREADS=${THREADS:-4}
+PORT=${PORT:-4390}
+LABEL=${LABEL:-$(git -C "$SERVER_DIR" describe --always --dirty 2>/dev/null || echo unknown)}
+
+MAX_TOTAL=$(sed -n 's/^#define MAX_TOTAL_CLIENTS \([0-9]*\).*/\1/p' \
+    "$SERVER_DIR/include/cr_shared.h")
+
+WORK_DIR=$(mktemp -d)
+SERVER_PID=""
+
+cleanup () {
+    if [ -n "$SERVER_PID" ]; then
+        kill -INT "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+#The self-signed pair from gen_certs_run.sh, made without prompts if it has
+#not been generated yet.
+if [ -f "$SERVER_DIR/server.crt" ] && [ -f "$SERVER_DIR/server.key" ]; then
+    cp "$SERVER_DIR/server.crt" "$SERVER_DIR/server.key" "$WORK_DIR"
+else
+    openssl genpkey -algorithm RSA -out "$WORK_DIR/server.key" 2>/dev/null
+    openssl req -new -key "$WORK_DIR/server.key" -subj "/CN=localhost" \
+        -out "$WORK_DIR/server.csr"
+    openssl x509 -req -days 365 -in "$WORK_DIR/server.csr" \
+        -signkey "$WORK_DIR/server.key" -out "$WORK_DIR/server.crt" 2>/dev/null
+fi
+
+#NOTE: The pool runs one thread more than the client count and takes at most
+#MAX_TOTAL_CLIENTS threads. Connections past that wait in the pool queue, so
+#larger rooms can't be measured (less the senders and one spare for the
+#admin session that creates the room). Neither can a cluster spread them:
+#the accounts are shared by every node and capped at MAX_TOTAL_USERS. The
+#largest room the server holds is run in their place.
+MAX_CLIENT=$((MAX_TOTAL - 1))
+MAX_LISTENERS=$((MAX_CLIENT - SENDERS - 1))
+DONE=" "
+SKIPPED=""
+
+for SIZE in $SIZES; do
+    if [ "$SIZE" -gt "$MAX_LISTENERS" ]; then
+        echo "fan-out: $SIZE listeners NOT MEASURED, the server holds at most $MAX_LISTENERS"
+        SKIPPED="$SKIPPED $SIZE"
+        SIZE=$MAX_LISTENERS
+    fi
+
+    case "$DONE" in
+        *" $SIZE "*) continue ;;
+    esac
+    DONE="$DONE$SIZE "
+
+    RUN_DIR="$WORK_DIR/$SIZE"
+    mkdir -p "$RUN_DIR"
+    cp "$WORK_DIR/server.crt" "$WORK_DIR/server.key" "$RUN_DIR"
+    printf "admin:password\n" > "$RUN_DIR/users.txt"
+
+    cat > "$RUN_DIR/config.txt" <<EOF
+Server Listening Hostname/IP:
+127.0.0.1
+
+Server Listening Port:
+$PORT
+
+Max room count:
+1
+
+Max client count:
+$MAX_CLIENT
+
+Update flush window (ms):
+5
+
+History compression level (0-9):
+6
+
+Metrics port (0 off, loopback only):
+0
+EOF
+
+    (cd "$RUN_DIR" && exec "$BUILD_DIR/chat_room" > server.log 2>&1) &
+    SERVER_PID=$!
+
+    for _ in $(seq 50); do
+        if (exec 3<>"/dev/tcp/127.0.0.1/$PORT") 2>/dev/null; then
+            break
+        fi
+        sleep 0.1
+    done
+
+    echo "fan-out: $SIZE listeners, $SENDERS senders, $RATE msgs/s"
+    "$BUILD_DIR/chat_room_loadgen" -p "$PORT" -F -c "$SIZE" -s "$SENDERS" \
+        -m "$RATE" -d "$DURATION" -t "$THREADS" -o "$REPORT" -L "$LABEL" || \
+        { echo "fan-out: $SIZE listeners failed:"; tail -5 "$RUN_DIR/server.log"; }
+
+    kill -INT "$SERVER_PID"
+    wait "$SERVER_PID" 2>/dev/null || true
+    SERVER_PID=""
+done
+
+if [ -n "$SKIPPED" ]; then
+    echo "fan-out: not measured:$SKIPPED listeners (MAX_TOTAL_CLIENTS $MAX_TOTAL," \
+         "one session thread each); $MAX_LISTENERS listeners were run instead"
+fi
+
+echo "report: $REPORT"
+
+#End of cr_fanout_sweep.sh file
@@ -0,0 +1,1588 @@
+//NOTE: Load generator for the chat room server. Opens many TLS sessions
+//against a locally started chat_room, logs them in as synthetic users, joins
+//them to rooms, and sends chats at a target rate. Every chat carries its send
+//time (CLOCK_MONOTONIC, so client and server must share the host), which gives
+//the end-to-end latency when other members receive it.
+//
+//With -F it runs the fan-out scenario instead: one room, -c listeners and -s
+//separate senders. Every chat also carries an id, so the deliveries of one
+//chat can be matched across listeners to give the time until the first
+//listener has it and the spread until the last one does.
+//
+//With -C it runs the churn scenario: every thread connects, handshakes, logs
+//in and quits as fast as it can, cycling through its share of the -c users.
+//Given the server's pid (-S) it also samples the server's RSS and open file
+//descriptors.
+//
+//Usage: chat_room_loadgen [-h host] [-p port] [-c clients] [-r rooms]
+//       [-D room skew] [-s senders] [-m msgs/s] [-d seconds] [-t threads]
+//       [-u user prefix] [-a admin user] [-P admin password] [-F] [-C]
+//       [-S server pid] [-o report file] [-L report label]
+
+#include <dirent.h>
+#include <getopt.h>
+#include <math.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "../include/cr_shared.h"
+#include "../include/cr_msg.h"
+#include "../include/cr_frame.h"
+
+#define LOADGEN_PASSWORD "password"
+#define LOADGEN_ROOM_PREFIX "lgroom"
+#define LOADGEN_TIMEOUT_SEC 5
+#define LOADGEN_RECV_SIZE (BUFF_SIZE * 8)
+
+//NOTE: Fan-out runs keep reading for this long after the measurement so the
+//last measured chats reach every listener.
+#define LOADGEN_GRACE_SEC 1
+
+//Most chats a fan-out run follows (32 bytes each).
+#define LOADGEN_MAX_TRACKED (1 << 21)
+#define LOADGEN_LABEL_SIZE 64
+
+//Interval between samples of the server's RSS and descriptors.
+#define LOADGEN_SAMPLE_MS 100
+#define LOADGEN_PATH_SIZE 256
+
+//NOTE: Log-linear latency histogram. Values below 2 * LOADGEN_SUB_COUNT are
+//exact, above that every power of two is split into LOADGEN_SUB_COUNT
+//buckets (about 3% precision).
+#define LOADGEN_SUB_BITS 5
+#define LOADGEN_SUB_COUNT (1 << LOADGEN_SUB_BITS)
+#define LOADGEN_BUCKETS ((64 - LOADGEN_SUB_BITS) * LOADGEN_SUB_COUNT)
+
+typedef struct {
+    char     p_host[HOST_MAX_STRING + 1];
+    char     p_port[PORT_MAX_STRING + 1];
+    char     p_user_prefix[MAX_USERNAME_LENGTH - 8];
+    char     p_admin[MAX_USERNAME_LENGTH + 1];
+    char     p_admin_password[MAX_PASSWORD_LENGTH + 1];
+    int      clients;
+    int      rooms;
+    double   skew;
+    int      senders;
+    double   rate;
+    int      duration;
+    int      threads;
+    int      fanout;
+    int      listeners;
+    int      churn;
+    int      server_pid;
+    char     p_report[LOADGEN_PATH_SIZE];
+    char     p_label[LOADGEN_LABEL_SIZE];
+} loadgen_options_t;
+
+typedef struct {
+    uint64_t p_counts[LOADGEN_BUCKETS];
+    uint64_t total;
+} loadgen_hist_t;
+
+//NOTE: One per chat in a fan-out run, indexed by the chat's id. The sender
+//sets sent_ns, listeners move first_ns down and last_ns up as they receive
+//it.
+typedef struct {
+    uint64_t sent_ns;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint32_t count;
+    uint32_t measured;
+} loadgen_message_t;
+
+typedef struct {
+    SSL *    p_ssl;
+    int      fd;
+    int      index;
+    int      room;
+    int      sender;
+    int      sender_rank;
+    int      ready;
+    uint64_t chats_sent;
+    uint64_t handshake_ns;
+    uint64_t next_send_ns;
+    size_t   recv_len;
+    char     p_recv[LOADGEN_RECV_SIZE];
+} loadgen_session_t;
+
+typedef struct {
+    pthread_t           thread;
+    loadgen_session_t * p_sessions;
+    int                 count;
+    uint64_t            sent;
+    uint64_t            delivered;
+    uint64_t            errors;
+    loadgen_hist_t      latency;
+    loadgen_hist_t      send_stall;
+    uint64_t            cycles;
+    loadgen_hist_t      handshake;
+    loadgen_hist_t      login;
+} loadgen_worker_t;
+
+typedef struct {
+    double         setup;
+    double         elapsed;
+    uint64_t       sent;
+    uint64_t       delivered;
+    uint64_t       errors;
+    int            ready;
+    int            ready_listeners;
+    uint64_t       measured;
+    uint64_t       complete;
+    loadgen_hist_t latency;
+    loadgen_hist_t send_stall;
+    loadgen_hist_t first;
+    loadgen_hist_t spread;
+    uint64_t       cycles;
+    uint64_t       peak_rss_kb;
+    uint64_t       peak_fds;
+    uint64_t       server_hwm_kb;
+    loadgen_hist_t handshake;
+    loadgen_hist_t login;
+} loadgen_results_t;
+
+static loadgen_options_t options = {
+    .p_host = "127.0.0.1",
+    .p_port = "1234",
+    .p_user_prefix = "lg",
+    .p_admin = "admin",
+    .p_admin_password = "password",
+    .clients = 40,
+    .rooms = 4,
+    .skew = 0.0,
+    .senders = 0,
+    .rate = 1000.0,
+    .duration = 10,
+    .threads = 4,
+    .fanout = 0,
+    .listeners = 0,
+    .churn = 0,
+    .server_pid = 0,
+    .p_report = "",
+    .p_label = ""
+};
+
+static SSL_CTX * p_client_ctx = NULL;
+static pthread_barrier_t start_barrier;
+static volatile int measuring = STOP;
+static volatile int running = CONTINUE;
+static loadgen_message_t * p_messages = NULL;
+static uint64_t messages_tracked = 0;
+
+/**
+ * @brief Returns CLOCK_MONOTONIC in nanoseconds.
+ *
+ * @return uint64_t current time.
+ */
+static uint64_t
+loadgen_now_ns ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * @brief Records a value in the histogram.
+ *
+ * @param p_hist pointer to the histogram.
+ * @param value value to record.
+ */
+static void
+loadgen_hist_record (loadgen_hist_t * p_hist, uint64_t value)
+{
+    int index = value;
+
+    if ((2 * LOADGEN_SUB_COUNT) <= value)
+    {
+        int magnitude = (63 - __builtin_clzll(value)) - LOADGEN_SUB_BITS;
+        index = (2 * LOADGEN_SUB_COUNT) + ((magnitude - 1) * LOADGEN_SUB_COUNT) +
+                ((value >> magnitude) - LOADGEN_SUB_COUNT);
+    }
+
+    p_hist->p_counts[index]++;
+    p_hist->total++;
+}
+
+/**
+ * @brief Returns the lowest value that falls in a bucket.
+ *
+ * @param index bucket index.
+ * @return uint64_t lowest value of the bucket.
+ */
+static uint64_t
+loadgen_hist_value (int index)
+{
+    if ((2 * LOADGEN_SUB_COUNT) > index)
+    {
+        return index;
+    }
+
+    int magnitude = ((index - (2 * LOADGEN_SUB_COUNT)) / LOADGEN_SUB_COUNT) + 1;
+    uint64_t sub = (index - (2 * LOADGEN_SUB_COUNT)) % LOADGEN_SUB_COUNT;
+
+    return (LOADGEN_SUB_COUNT + sub) << magnitude;
+}
+
+/**
+ * @brief Returns the value at a percentile.
+ *
+ * @param p_hist pointer to the histogram.
+ * @param percentile percentile (0-100).
+ * @return uint64_t value at the percentile, zero if the histogram is empty.
+ */
+static uint64_t
+loadgen_hist_percentile (loadgen_hist_t * p_hist, double percentile)
+{
+    if (0 == p_hist->total)
+    {
+        return 0;
+    }
+
+    uint64_t target = ceil((percentile / 100.0) * p_hist->total);
+    uint64_t seen = 0;
+
+    for (int index = 0; index < LOADGEN_BUCKETS; index++)
+    {
+        seen += p_hist->p_counts[index];
+
+        if ((seen >= target) && (0 != p_hist->p_counts[index]))
+        {
+            return loadgen_hist_value(index);
+        }
+    }
+
+    return loadgen_hist_value(LOADGEN_BUCKETS - 1);
+}
+
+/**
+ * @brief Adds every count of one histogram to another.
+ *
+ * @param p_total pointer to the histogram added to.
+ * @param p_hist pointer to the histogram added.
+ */
+static void
+loadgen_hist_merge (loadgen_hist_t * p_total, loadgen_hist_t * p_hist)
+{
+    for (int index = 0; index < LOADGEN_BUCKETS; index++)
+    {
+        p_total->p_counts[index] += p_hist->p_counts[index];
+    }
+
+    p_total->total += p_hist->total;
+}
+
+/**
+ * @brief Moves a value down to new_value if new_value is lower, or if the
+ * value is still zero.
+ *
+ * @param p_value pointer to the value.
+ * @param new_value candidate value.
+ */
+static void
+loadgen_atomic_min (uint64_t * p_value, uint64_t new_value)
+{
+    uint64_t value = __atomic_load_n(p_value, __ATOMIC_RELAXED);
+
+    while (((0 == value) || (new_value < value)) &&
+           (!__atomic_compare_exchange_n(p_value, &value, new_value, 1,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)))
+    {
+    }
+}
+
+/**
+ * @brief Moves a value up to new_value if new_value is higher.
+ *
+ * @param p_value pointer to the value.
+ * @param new_value candidate value.
+ */
+static void
+loadgen_atomic_max (uint64_t * p_value, uint64_t new_value)
+{
+    uint64_t value = __atomic_load_n(p_value, __ATOMIC_RELAXED);
+
+    while ((new_value > value) &&
+           (!__atomic_compare_exchange_n(p_value, &value, new_value, 1,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)))
+    {
+    }
+}
+
+/**
+ * @brief Appends a string field (varint length then bytes) to a payload.
+ *
+ * @param p_payload payload being built.
+ * @param offset current end of the payload.
+ * @param p_string string to append.
+ * @return size_t new end of the payload.
+ */
+static size_t
+loadgen_put_string (char * p_payload, size_t offset, const char * p_string)
+{
+    size_t len = strlen(p_string);
+
+    offset += cr_frame_put_varint((p_payload + offset), MAX_VARINT_LENGTH, len);
+    memcpy((p_payload + offset), p_string, len);
+
+    return offset + len;
+}
+
+/**
+ * @brief Sends a v2 frame.
+ *
+ * @param p_session pointer to the session.
+ * @param p_payload frame payload (header and fields).
+ * @param payload_len length of the payload.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+loadgen_send_frame (loadgen_session_t * p_session, const char * p_payload,
+                                                      size_t payload_len)
+{
+    char p_frame[BUFF_SIZE + MAX_VARINT_LENGTH] = {0};
+    int varint_len = cr_frame_put_varint(p_frame, MAX_VARINT_LENGTH,
+                                                        payload_len);
+
+    memcpy((p_frame + varint_len), p_payload, payload_len);
+
+    if (0 >= SSL_write(p_session->p_ssl, p_frame, (varint_len + payload_len)))
+    {
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Takes the next complete frame out of the session's receive buffer.
+ *
+ * @param p_session pointer to the session.
+ * @param p_payload buffer the payload is copied to (LOADGEN_RECV_SIZE).
+ * @return int payload length, 0 if no complete frame is buffered, or
+ * FAILURE_NEGATIVE (-1) if the stream is corrupt.
+ */
+static int
+loadgen_next_frame (loadgen_session_t * p_session, char * p_payload)
+{
+    uint64_t payload_len = 0;
+    int varint_len = cr_frame_get_varint(p_session->p_recv,
+                                 p_session->recv_len, &payload_len);
+
+    if (FAILURE_NEGATIVE == varint_len)
+    {
+        return FAILURE_NEGATIVE;
+    }
+
+    if ((0 == varint_len) ||
+        ((varint_len + payload_len) > p_session->recv_len))
+    {
+        return ((LOADGEN_RECV_SIZE - MAX_VARINT_LENGTH) < payload_len) ?
+                                                  FAILURE_NEGATIVE : 0;
+    }
+
+    memcpy(p_payload, (p_session->p_recv + varint_len), payload_len);
+    p_session->recv_len -= varint_len + payload_len;
+    memmove(p_session->p_recv, (p_session->p_recv + varint_len + payload_len),
+                                                       p_session->recv_len);
+
+    return payload_len;
+}
+
+/**
+ * @brief Reads whatever the server has sent into the receive buffer.
+ *
+ * @param p_session pointer to the session.
+ * @return int SUCCESS (0) or FAILURE (1) if the connection closed.
+ */
+static int
+loadgen_fill (loadgen_session_t * p_session)
+{
+    int read_bytes = SSL_read(p_session->p_ssl,
+                             (p_session->p_recv + p_session->recv_len),
+                             (LOADGEN_RECV_SIZE - p_session->recv_len));
+
+    if (0 >= read_bytes)
+    {
+        return FAILURE;
+    }
+
+    p_session->recv_len += read_bytes;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Waits for the response to a request, skipping the chat updates
+ * that arrive in between.
+ *
+ * @param p_session pointer to the session.
+ * @param type packet type of the request.
+ * @param s_type packet sub type of the request.
+ * @param p_payload buffer for the response payload (LOADGEN_RECV_SIZE).
+ * @return int response opcode, FAILURE_NEGATIVE (-1) on failure.
+ */
+static int
+loadgen_expect (loadgen_session_t * p_session, uint8_t type, uint8_t s_type,
+                                                           char * p_payload)
+{
+    while (true)
+    {
+        int payload_len = loadgen_next_frame(p_session, p_payload);
+
+        if (FAILURE_NEGATIVE == payload_len)
+        {
+            return FAILURE_NEGATIVE;
+        }
+
+        if (0 == payload_len)
+        {
+            if (FAILURE == loadgen_fill(p_session))
+            {
+                return FAILURE_NEGATIVE;
+            }
+
+            continue;
+        }
+
+        received_msg_t * p_header = (received_msg_t *) p_payload;
+
+        if ((FAIL_TYPE == p_header->type) ||
+            ((type == p_header->type) && (s_type == p_header->s_type)))
+        {
+            return p_header->opcode;
+        }
+    }
+}
+
+/**
+ * @brief Connects a session, switches it to v2, registers and logs in its
+ * user, and joins its room.
+ *
+ * @param p_session pointer to the session.
+ * @param p_username username to log in as.
+ * @param p_password password of the user.
+ * @param register_user whether to register the user first.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+loadgen_session_open (loadgen_session_t * p_session, const char * p_username,
+                            const char * p_password, int register_user)
+{
+    char p_payload[LOADGEN_RECV_SIZE] = {0};
+
+    p_session->fd = n_connect(options.p_host, options.p_port);
+
+    if (FAILURE_NEGATIVE == p_session->fd)
+    {
+        return FAILURE;
+    }
+
+    struct timeval timeout = {.tv_sec = LOADGEN_TIMEOUT_SEC, .tv_usec = 0};
+    setsockopt(p_session->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                                                  sizeof(timeout));
+
+    //NOTE: Chats are small writes, Nagle would hold them back for the
+    //delayed ack of the previous one and show up as latency.
+    int nodelay = 1;
+    setsockopt(p_session->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay,
+                                                  sizeof(nodelay));
+
+    p_session->p_ssl = SSL_new(p_client_ctx);
+
+    if ((NULL == p_session->p_ssl) ||
+        (1 != SSL_set_fd(p_session->p_ssl, p_session->fd)) ||
+        (1 != SSL_connect(p_session->p_ssl)))
+    {
+        return FAILURE;
+    }
+
+    p_session->handshake_ns = loadgen_now_ns();
+
+    version_t version_req = {SESSION_TYPE, VERSION_STYPE, REQUEST,
+                                                        PROTOCOL_V2};
+    version_t version_ack;
+
+    if ((0 >= SSL_write(p_session->p_ssl, &version_req, sizeof(version_t))) ||
+        (sizeof(version_t) != SSL_read(p_session->p_ssl, &version_ack,
+                                                   sizeof(version_t))) ||
+        (PROTOCOL_V2 != version_ack.version))
+    {
+        return FAILURE;
+    }
+
+    char p_request[BUFF_SIZE] = {0};
+    size_t offset = sizeof(received_msg_t);
+
+    offset = loadgen_put_string(p_request, offset, p_username);
+    offset = loadgen_put_string(p_request, offset, p_password);
+
+    if (register_user)
+    {
+        received_msg_t header = {ACCOUNT_TYPE, REGISTER_STYPE, REQUEST};
+        memcpy(p_request, &header, sizeof(received_msg_t));
+
+        //NOTE: The user may be left over from an earlier run.
+        if ((FAILURE == loadgen_send_frame(p_session, p_request, offset)) ||
+            (FAILURE_NEGATIVE == loadgen_expect(p_session, ACCOUNT_TYPE,
+                                            REGISTER_STYPE, p_payload)))
+        {
+            return FAILURE;
+        }
+    }
+
+    received_msg_t header = {ACCOUNT_TYPE, LOGIN_STYPE, REQUEST};
+    memcpy(p_request, &header, sizeof(received_msg_t));
+
+    if ((FAILURE == loadgen_send_frame(p_session, p_request, offset)) ||
+        (ACKNOWLEDGE != loadgen_expect(p_session, ACCOUNT_TYPE, LOGIN_STYPE,
+                                                              p_payload)))
+    {
+        return FAILURE;
+    }
+
+    if (0 > p_session->room)
+    {
+        return SUCCESS;
+    }
+
+    char p_room[MAX_ROOM_NAME_LENGTH + 1] = {0};
+    snprintf(p_room, sizeof(p_room), LOADGEN_ROOM_PREFIX "%d",
+                                               p_session->room);
+
+    received_msg_t join_header = {ROOMS_TYPE, JOIN_STYPE, REQUEST};
+    memcpy(p_request, &join_header, sizeof(received_msg_t));
+    offset = loadgen_put_string(p_request, sizeof(received_msg_t), p_room);
+
+    if ((FAILURE == loadgen_send_frame(p_session, p_request, offset)) ||
+        (ACKNOWLEDGE != loadgen_expect(p_session, ROOMS_TYPE, JOIN_STYPE,
+                                                             p_payload)))
+    {
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Quits and frees a session.
+ *
+ * @param p_session pointer to the session.
+ */
+static void
+loadgen_session_close (loadgen_session_t * p_session)
+{
+    if (NULL != p_session->p_ssl)
+    {
+        received_msg_t quit_req = {SESSION_TYPE, QUIT_STYPE, REQUEST};
+        loadgen_send_frame(p_session, (char *) &quit_req,
+                                  sizeof(received_msg_t));
+        SSL_shutdown(p_session->p_ssl);
+        SSL_free(p_session->p_ssl);
+        p_session->p_ssl = NULL;
+    }
+
+    if (0 < p_session->fd)
+    {
+        close(p_session->fd);
+        p_session->fd = -1;
+    }
+}
+
+/**
+ * @brief Sends one chat carrying its send time and id. The id numbers a
+ * sender's chats so that no two senders share one.
+ *
+ * @param p_worker pointer to the worker owning the session.
+ * @param p_session pointer to the session.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+loadgen_send_chat (loadgen_worker_t * p_worker, loadgen_session_t * p_session)
+{
+    char p_request[BUFF_SIZE] = {0};
+    char p_chat[MAX_CHAT_LEN + 1] = {0};
+    received_msg_t header = {CHAT_TYPE, CHAT_STYPE, REQUEST};
+    uint64_t id = (p_session->chats_sent++ * options.senders) +
+                                           p_session->sender_rank;
+    uint64_t sent_ns = loadgen_now_ns();
+
+    snprintf(p_chat, sizeof(p_chat), "%" PRIu64 " %" PRIu64 " load",
+                                                       sent_ns, id);
+    memcpy(p_request, &header, sizeof(received_msg_t));
+    size_t offset = loadgen_put_string(p_request, sizeof(received_msg_t),
+                                                                p_chat);
+
+    if ((NULL != p_messages) && (id < messages_tracked))
+    {
+        p_messages[id].sent_ns = sent_ns;
+        __atomic_store_n(&p_messages[id].measured, (measuring ? 1 : 0),
+                                                      __ATOMIC_RELAXED);
+    }
+
+    int return_val = loadgen_send_frame(p_session, p_request, offset);
+
+    //NOTE: A write only blocks once the server stops reading the sender,
+    //which is how a slow fan-out pushes back on it.
+    if (measuring)
+    {
+        loadgen_hist_record(&p_worker->send_stall,
+                            (loadgen_now_ns() - sent_ns));
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Handles every complete frame in the session's receive buffer.
+ * Chat updates with a timestamp are counted as deliveries.
+ *
+ * @param p_worker pointer to the worker owning the session.
+ * @param p_session pointer to the session.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+loadgen_drain (loadgen_worker_t * p_worker, loadgen_session_t * p_session)
+{
+    char p_payload[LOADGEN_RECV_SIZE] = {0};
+    int payload_len = 0;
+
+    while (0 < (payload_len = loadgen_next_frame(p_session, p_payload)))
+    {
+        received_msg_t * p_header = (received_msg_t *) p_payload;
+
+        if ((CHAT_TYPE != p_header->type) || (CHAT_STYPE != p_header->s_type) ||
+            (ACKNOWLEDGE != p_header->opcode))
+        {
+            continue;
+        }
+
+        //NOTE: Payload is header, varint seq, username, chat. Notices carry
+        //sequence number zero and no timestamp.
+        uint64_t seq = 0;
+        uint64_t len = 0;
+        size_t offset = sizeof(received_msg_t);
+        int varint_len = cr_frame_get_varint((p_payload + offset),
+                                   (payload_len - offset), &seq);
+
+        if ((0 >= varint_len) || (0 == seq))
+        {
+            continue;
+        }
+
+        offset += varint_len;
+        varint_len = cr_frame_get_varint((p_payload + offset),
+                                  (payload_len - offset), &len);
+        offset += varint_len + len;
+        varint_len = cr_frame_get_varint((p_payload + offset),
+                                  (payload_len - offset), &len);
+        offset += varint_len;
+
+        if ((0 >= varint_len) || ((offset + len) > (size_t) payload_len))
+        {
+            continue;
+        }
+
+        char p_chat[MAX_CHAT_LEN + 1] = {0};
+        memcpy(p_chat, (p_payload + offset), (len > MAX_CHAT_LEN) ?
+                                                    MAX_CHAT_LEN : len);
+        char * p_end = NULL;
+        uint64_t sent_ns = strtoull(p_chat, &p_end, BASE10);
+        uint64_t id = strtoull(p_end, NULL, BASE10);
+        uint64_t now_ns = loadgen_now_ns();
+
+        //NOTE: Fan-out senders are not listeners, what they receive from the
+        //other senders is not counted.
+        if (options.fanout && p_session->sender)
+        {
+            continue;
+        }
+
+        if (measuring && (0 != sent_ns) && (now_ns >= sent_ns))
+        {
+            p_worker->delivered++;
+            loadgen_hist_record(&p_worker->latency, (now_ns - sent_ns));
+        }
+
+        if ((NULL != p_messages) && (id < messages_tracked))
+        {
+            __atomic_add_fetch(&p_messages[id].count, 1, __ATOMIC_RELAXED);
+            loadgen_atomic_min(&p_messages[id].first_ns, now_ns);
+            loadgen_atomic_max(&p_messages[id].last_ns, now_ns);
+        }
+    }
+
+    return (FAILURE_NEGATIVE == payload_len) ? FAILURE : SUCCESS;
+}
+
+/**
+ * @brief Worker thread. Opens its sessions, waits for the other workers, then
+ * sends chats on schedule and reads updates until the run ends.
+ *
+ * @param p_worker_holder pointer to the worker.
+ * @return void* NULL.
+ */
+static void *
+loadgen_worker (void * p_worker_holder)
+{
+    loadgen_worker_t * p_worker = p_worker_holder;
+    struct pollfd * p_fds = calloc(p_worker->count, sizeof(struct pollfd));
+
+    for (int counter = 0; counter < p_worker->count; counter++)
+    {
+        loadgen_session_t * p_session = &p_worker->p_sessions[counter];
+        char p_username[MAX_USERNAME_LENGTH + 1] = {0};
+
+        snprintf(p_username, sizeof(p_username), "%s%d",
+                      options.p_user_prefix, p_session->index);
+
+        if (SUCCESS == loadgen_session_open(p_session, p_username,
+                                              LOADGEN_PASSWORD, 1))
+        {
+            p_session->ready = 1;
+        }
+        else
+        {
+            p_worker->errors++;
+        }
+    }
+
+    pthread_barrier_wait(&start_barrier);
+
+    double interval_ns = 0.0;
+
+    if (0 < options.rate)
+    {
+        interval_ns = (options.senders * 1e9) / options.rate;
+    }
+
+    uint64_t start_ns = loadgen_now_ns();
+
+    for (int counter = 0; counter < p_worker->count; counter++)
+    {
+        //NOTE: Senders are spread across the interval so chats don't all
+        //leave at once.
+        p_worker->p_sessions[counter].next_send_ns = start_ns +
+                    (uint64_t) ((interval_ns * counter) / p_worker->count);
+    }
+
+    while (running && (NULL != p_fds))
+    {
+        uint64_t now_ns = loadgen_now_ns();
+        uint64_t next_ns = now_ns + 10000000ULL;
+
+        for (int counter = 0; counter < p_worker->count; counter++)
+        {
+            loadgen_session_t * p_session = &p_worker->p_sessions[counter];
+
+            p_fds[counter].fd = p_session->ready ? p_session->fd : -1;
+            p_fds[counter].events = POLLIN;
+
+            if ((!p_session->ready) || (!p_session->sender) ||
+                (0.0 == interval_ns))
+            {
+                continue;
+            }
+
+            if (now_ns >= p_session->next_send_ns)
+            {
+                if (FAILURE == loadgen_send_chat(p_worker, p_session))
+                {
+                    p_session->ready = 0;
+                    p_worker->errors++;
+                    continue;
+                }
+
+                if (measuring)
+                {
+                    p_worker->sent++;
+                }
+
+                p_session->next_send_ns += interval_ns;
+
+                //NOTE: A stalled sender skips the chats it missed instead of
+                //bursting to catch up.
+                if (p_session->next_send_ns < now_ns)
+                {
+                    p_session->next_send_ns = now_ns + interval_ns;
+                }
+            }
+
+            if (p_session->next_send_ns < next_ns)
+            {
+                next_ns = p_session->next_send_ns;
+            }
+        }
+
+        int timeout_ms = (next_ns > now_ns) ?
+                         ((next_ns - now_ns) / 1000000ULL) : 0;
+
+        if (0 >= poll(p_fds, p_worker->count, timeout_ms))
+        {
+            continue;
+        }
+
+        for (int counter = 0; counter < p_worker->count; counter++)
+        {
+            loadgen_session_t * p_session = &p_worker->p_sessions[counter];
+
+            if (!(p_fds[counter].revents & (POLLIN | POLLERR | POLLHUP)))
+            {
+                continue;
+            }
+
+            //NOTE: SSL may hold more decrypted bytes than poll can see.
+            do
+            {
+                if (FAILURE == loadgen_fill(p_session))
+                {
+                    p_session->ready = 0;
+                    p_worker->errors++;
+                    break;
+                }
+            } while ((0 < SSL_pending(p_session->p_ssl)) &&
+                     (LOADGEN_RECV_SIZE > p_session->recv_len));
+
+            if (p_session->ready && (FAILURE == loadgen_drain(p_worker,
+                                                            p_session)))
+            {
+                p_session->ready = 0;
+                p_worker->errors++;
+            }
+        }
+    }
+
+    FREE(p_fds);
+
+    for (int counter = 0; counter < p_worker->count; counter++)
+    {
+        loadgen_session_close(&p_worker->p_sessions[counter]);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Churn worker thread. Registers its users, waits for the other
+ * workers, then opens, logs in and quits sessions back to back until the run
+ * ends.
+ *
+ * @param p_worker_holder pointer to the worker.
+ * @return void* NULL.
+ */
+static void *
+loadgen_churn_worker (void * p_worker_holder)
+{
+    loadgen_worker_t * p_worker = p_worker_holder;
+    char p_username[MAX_USERNAME_LENGTH + 1] = {0};
+
+    for (int counter = 0; counter < p_worker->count; counter++)
+    {
+        loadgen_session_t * p_session = &p_worker->p_sessions[counter];
+
+        snprintf(p_username, sizeof(p_username), "%s%d",
+                      options.p_user_prefix, p_session->index);
+
+        if (SUCCESS == loadgen_session_open(p_session, p_username,
+                                              LOADGEN_PASSWORD, 1))
+        {
+            p_session->ready = 1;
+        }
+        else
+        {
+            p_worker->errors++;
+        }
+
+        loadgen_session_close(p_session);
+    }
+
+    pthread_barrier_wait(&start_barrier);
+
+    for (int counter = 0; running && (0 < p_worker->count);
+         counter = (counter + 1) % p_worker->count)
+    {
+        loadgen_session_t * p_session = &p_worker->p_sessions[counter];
+
+        if (!p_session->ready)
+        {
+            continue;
+        }
+
+        snprintf(p_username, sizeof(p_username), "%s%d",
+                      options.p_user_prefix, p_session->index);
+
+        p_session->recv_len = 0;
+        uint64_t start_ns = loadgen_now_ns();
+        int return_val = loadgen_session_open(p_session, p_username,
+                                                  LOADGEN_PASSWORD, 0);
+        uint64_t end_ns = loadgen_now_ns();
+
+        loadgen_session_close(p_session);
+
+        if (!measuring)
+        {
+            continue;
+        }
+
+        if (SUCCESS != return_val)
+        {
+            p_worker->errors++;
+            continue;
+        }
+
+        p_worker->cycles++;
+        loadgen_hist_record(&p_worker->handshake,
+                            (p_session->handshake_ns - start_ns));
+        loadgen_hist_record(&p_worker->login,
+                            (end_ns - p_session->handshake_ns));
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Picks the room of every session. A skew of zero spreads sessions
+ * evenly, a higher skew follows a zipf distribution so the first rooms get
+ * most members.
+ *
+ * @param p_sessions all sessions.
+ */
+static void
+loadgen_assign_rooms (loadgen_session_t * p_sessions)
+{
+    double total = 0.0;
+
+    for (int room = 0; room < options.rooms; room++)
+    {
+        total += 1.0 / pow((room + 1), options.skew);
+    }
+
+    int sender_rank = 0;
+
+    for (int counter = 0; counter < options.clients; counter++)
+    {
+        loadgen_session_t * p_session = &p_sessions[counter];
+        p_session->index = counter;
+        p_session->fd = -1;
+        p_session->room = counter % options.rooms;
+
+        //NOTE: Senders are spread evenly over the session indexes.
+        p_session->sender = (((long) counter * options.senders) %
+                                   options.clients) < options.senders;
+        p_session->sender_rank = p_session->sender ? sender_rank++ : 0;
+
+        if (options.churn)
+        {
+            p_session->room = -1;
+            continue;
+        }
+
+        if (0.0 == options.skew)
+        {
+            continue;
+        }
+
+        double target = (counter + 0.5) / options.clients;
+        double cumulative = 0.0;
+
+        for (int room = 0; room < options.rooms; room++)
+        {
+            cumulative += (1.0 / pow((room + 1), options.skew)) / total;
+            p_session->room = room;
+
+            if (target <= cumulative)
+            {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Logs in as the admin and creates the load generator's rooms.
+ *
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+loadgen_create_rooms ()
+{
+    loadgen_session_t * p_admin = calloc(1, sizeof(loadgen_session_t));
+
+    if (NULL == p_admin)
+    {
+        perror("loadgen_create_rooms: p_admin calloc");
+        return FAILURE;
+    }
+
+    p_admin->room = -1;
+    int return_val = loadgen_session_open(p_admin, options.p_admin,
+                                    options.p_admin_password, 0);
+
+    for (int room = 0; (SUCCESS == return_val) && (room < options.rooms);
+                                                                 room++)
+    {
+        char p_request[BUFF_SIZE] = {0};
+        char p_payload[LOADGEN_RECV_SIZE] = {0};
+        char p_room[MAX_ROOM_NAME_LENGTH + 1] = {0};
+        received_msg_t header = {ROOMS_TYPE, CREATE_STYPE, REQUEST};
+
+        snprintf(p_room, sizeof(p_room), LOADGEN_ROOM_PREFIX "%d", room);
+        memcpy(p_request, &header, sizeof(received_msg_t));
+        size_t offset = loadgen_put_string(p_request, sizeof(received_msg_t),
+                                                                    p_room);
+
+        //NOTE: A room exists reject is fine, it was left by an earlier run.
+        if ((FAILURE == loadgen_send_frame(p_admin, p_request, offset)) ||
+            (FAILURE_NEGATIVE == loadgen_expect(p_admin, ROOMS_TYPE,
+                                           CREATE_STYPE, p_payload)))
+        {
+            return_val = FAILURE;
+        }
+    }
+
+    if (FAILURE == return_val)
+    {
+        fprintf(stderr, "loadgen_create_rooms: admin session failed\n");
+    }
+
+    loadgen_session_close(p_admin);
+    FREE(p_admin);
+
+    return return_val;
+}
+
+/**
+ * @brief Parses the command line into options.
+ *
+ * @param argc argument count.
+ * @param argv arguments.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+loadgen_parse (int argc, char ** argv)
+{
+    int option = 0;
+
+    while (-1 != (option = getopt(argc, argv, "h:p:c:r:D:s:m:d:t:u:a:P:FCS:o:L:")))
+    {
+        switch (option)
+        {
+            case 'h':
+                snprintf(options.p_host, sizeof(options.p_host), "%s", optarg);
+                break;
+            case 'p':
+                snprintf(options.p_port, sizeof(options.p_port), "%s", optarg);
+                break;
+            case 'c':
+                options.clients = atoi(optarg);
+                break;
+            case 'r':
+                options.rooms = atoi(optarg);
+                break;
+            case 'D':
+                options.skew = atof(optarg);
+                break;
+            case 's':
+                options.senders = atoi(optarg);
+                break;
+            case 'm':
+                options.rate = atof(optarg);
+                break;
+            case 'd':
+                options.duration = atoi(optarg);
+                break;
+            case 't':
+                options.threads = atoi(optarg);
+                break;
+            case 'u':
+                snprintf(options.p_user_prefix, sizeof(options.p_user_prefix),
+                                                                "%s", optarg);
+                break;
+            case 'a':
+                snprintf(options.p_admin, sizeof(options.p_admin), "%s",
+                                                                optarg);
+                break;
+            case 'P':
+                snprintf(options.p_admin_password,
+                         sizeof(options.p_admin_password), "%s", optarg);
+                break;
+            case 'F':
+                options.fanout = 1;
+                break;
+            case 'C':
+                options.churn = 1;
+                break;
+            case 'S':
+                options.server_pid = atoi(optarg);
+                break;
+            case 'o':
+                snprintf(options.p_report, sizeof(options.p_report), "%s",
+                                                                  optarg);
+                break;
+            case 'L':
+                snprintf(options.p_label, sizeof(options.p_label), "%s",
+                                                                optarg);
+                break;
+            default:
+                return FAILURE;
+        }
+    }
+
+    //NOTE: In a fan-out run -c counts the listeners only, the senders are
+    //extra sessions in the same room.
+    if (options.fanout)
+    {
+        options.listeners = options.clients;
+        options.senders = (0 >= options.senders) ? 1 : options.senders;
+        options.clients = options.listeners + options.senders;
+        options.rooms = 1;
+        options.skew = 0.0;
+    }
+
+    if ((0 >= options.senders) || (options.senders > options.clients))
+    {
+        options.senders = options.clients;
+    }
+
+    if (options.threads > options.clients)
+    {
+        options.threads = options.clients;
+    }
+
+    if ((0 >= options.clients) || (0 >= options.rooms) ||
+        (options.fanout && (0 >= options.listeners)) ||
+        (options.fanout && options.churn) ||
+        (0 >= options.threads) || (0 >= options.duration) ||
+        (0.0 > options.skew) || (0.0 > options.rate))
+    {
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Samples the server's resident memory and open descriptors from
+ * /proc and keeps the peaks.
+ *
+ * @param p_results pointer to the results.
+ */
+static void
+loadgen_sample_server (loadgen_results_t * p_results)
+{
+    char p_path[LOADGEN_PATH_SIZE] = {0};
+    char p_line[BUFF_SIZE] = {0};
+
+    snprintf(p_path, sizeof(p_path), "/proc/%d/status", options.server_pid);
+    FILE * p_file = fopen(p_path, "r");
+
+    while ((NULL != p_file) && (NULL != fgets(p_line, sizeof(p_line), p_file)))
+    {
+        uint64_t value = 0;
+
+        if ((1 == sscanf(p_line, "VmRSS: %" SCNu64, &value)) &&
+            (value > p_results->peak_rss_kb))
+        {
+            p_results->peak_rss_kb = value;
+        }
+        else if (1 == sscanf(p_line, "VmHWM: %" SCNu64, &value))
+        {
+            p_results->server_hwm_kb = value;
+        }
+    }
+
+    if (NULL != p_file)
+    {
+        fclose(p_file);
+    }
+
+    snprintf(p_path, sizeof(p_path), "/proc/%d/fd", options.server_pid);
+    DIR * p_dir = opendir(p_path);
+    uint64_t fds = 0;
+
+    while ((NULL != p_dir) && (NULL != readdir(p_dir)))
+    {
+        fds++;
+    }
+
+    if (NULL != p_dir)
+    {
+        closedir(p_dir);
+    }
+
+    //NOTE: Less the "." and ".." entries.
+    fds = (2 < fds) ? (fds - 2) : 0;
+    p_results->peak_fds = (fds > p_results->peak_fds) ? fds :
+                                              p_results->peak_fds;
+}
+
+/**
+ * @brief Adds up what the fan-out listeners saw of every chat sent while
+ * measuring: the time until the first listener had it and the spread until
+ * the last one did.
+ *
+ * @param p_results pointer to the results.
+ */
+static void
+loadgen_fanout_results (loadgen_results_t * p_results)
+{
+    for (uint64_t id = 0; (NULL != p_messages) && (id < messages_tracked);
+                                                                     id++)
+    {
+        loadgen_message_t * p_message = &p_messages[id];
+
+        if ((!p_message->measured) || (0 == p_message->count) ||
+            (p_message->first_ns < p_message->sent_ns))
+        {
+            continue;
+        }
+
+        p_results->measured++;
+
+        if (p_message->count >= (uint32_t) p_results->ready_listeners)
+        {
+            p_results->complete++;
+        }
+
+        loadgen_hist_record(&p_results->first,
+                            (p_message->first_ns - p_message->sent_ns));
+        loadgen_hist_record(&p_results->spread,
+                            (p_message->last_ns - p_message->first_ns));
+    }
+}
+
+/**
+ * @brief Prints the p50/p99/p999/max of a histogram in microseconds.
+ *
+ * @param p_file stream to print to.
+ * @param p_format format of one value, given its name and the value.
+ * @param p_separator printed between values.
+ * @param p_hist pointer to the histogram.
+ */
+static void
+loadgen_print_percentiles (FILE * p_file, const char * p_format,
+                     const char * p_separator, loadgen_hist_t * p_hist)
+{
+    const char * pp_names[] = {"p50", "p99", "p999", "max"};
+    const double p_percentiles[] = {50.0, 99.0, 99.9, 100.0};
+
+    for (int index = 0; index < 4; index++)
+    {
+        fprintf(p_file, "%s", (0 == index) ? "" : p_separator);
+        fprintf(p_file, p_format, pp_names[index],
+                loadgen_hist_percentile(p_hist, p_percentiles[index]) / 1e3);
+    }
+}
+
+/**
+ * @brief Prints the results of the run.
+ *
+ * @param p_results pointer to the results.
+ */
+static void
+loadgen_print (loadgen_results_t * p_results)
+{
+    printf("clients=%d ready=%d rooms=%d skew=%.2f senders=%d threads=%d "
+           "target_rate=%.0f\n", options.clients, p_results->ready,
+           options.rooms, options.skew, options.senders, options.threads,
+           options.rate);
+    printf("setup_seconds=%.3f duration_seconds=%.3f errors=%" PRIu64 "\n",
+           p_results->setup, p_results->elapsed, p_results->errors);
+
+    if (options.churn)
+    {
+        printf("cycles_per_second=%.1f\n", (p_results->cycles /
+                                             p_results->elapsed));
+        printf("handshake_us");
+        loadgen_print_percentiles(stdout, " %s=%.1f", "",
+                                  &p_results->handshake);
+        printf("\nlogin_us");
+        loadgen_print_percentiles(stdout, " %s=%.1f", "", &p_results->login);
+        printf("\n");
+
+        if (0 != options.server_pid)
+        {
+            printf("server_peak_rss_kb=%" PRIu64 " server_hwm_kb=%" PRIu64
+                   " server_peak_fds=%" PRIu64 "\n", p_results->peak_rss_kb,
+                   p_results->server_hwm_kb, p_results->peak_fds);
+        }
+
+        return;
+    }
+
+    printf("messages_per_second=%.1f deliveries_per_second=%.1f\n",
+           (p_results->sent / p_results->elapsed),
+           (p_results->delivered / p_results->elapsed));
+    printf("latency_us");
+    loadgen_print_percentiles(stdout, " %s=%.1f", "", &p_results->latency);
+    printf("\n");
+
+    if (!options.fanout)
+    {
+        return;
+    }
+
+    printf("listeners=%d ready_listeners=%d chats_measured=%" PRIu64
+           " chats_complete=%" PRIu64 "\n", options.listeners,
+           p_results->ready_listeners, p_results->measured,
+           p_results->complete);
+    printf("sender_latency_us");
+    loadgen_print_percentiles(stdout, " %s=%.1f", "", &p_results->first);
+    printf("\nspread_us");
+    loadgen_print_percentiles(stdout, " %s=%.1f", "", &p_results->spread);
+    printf("\nsend_stall_us");
+    loadgen_print_percentiles(stdout, " %s=%.1f", "", &p_results->send_stall);
+    printf("\n");
+}
+
+/**
+ * @brief Appends the results to the report file as one JSON object per
+ * line, so runs of different releases can be kept in one file.
+ *
+ * @param p_results pointer to the results.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+loadgen_report (loadgen_results_t * p_results)
+{
+    FILE * p_file = fopen(options.p_report, "a");
+
+    if (NULL == p_file)
+    {
+        perror("loadgen_report: fopen");
+        return FAILURE;
+    }
+
+    fprintf(p_file, "{\"label\":\"%s\",\"time\":%ld,\"scenario\":\"%s\","
+            "\"clients\":%d,\"ready\":%d,\"rooms\":%d,\"senders\":%d,"
+            "\"threads\":%d,\"target_rate\":%.0f,\"duration_s\":%.3f,"
+            "\"errors\":%" PRIu64 ",\"messages_per_second\":%.1f,"
+            "\"deliveries_per_second\":%.1f,\"latency_us\":{",
+            options.p_label, (long) time(NULL),
+            options.fanout ? "fanout" : (options.churn ? "churn" : "rooms"),
+            options.clients,
+            p_results->ready, options.rooms, options.senders,
+            options.threads, options.rate, p_results->elapsed,
+            p_results->errors, (p_results->sent / p_results->elapsed),
+            (p_results->delivered / p_results->elapsed));
+    loadgen_print_percentiles(p_file, "\"%s\":%.1f", ",", &p_results->latency);
+    fprintf(p_file, "}");
+
+    if (options.churn)
+    {
+        fprintf(p_file, ",\"cycles_per_second\":%.1f,\"handshake_us\":{",
+                (p_results->cycles / p_results->elapsed));
+        loadgen_print_percentiles(p_file, "\"%s\":%.1f", ",",
+                                  &p_results->handshake);
+        fprintf(p_file, "},\"login_us\":{");
+        loadgen_print_percentiles(p_file, "\"%s\":%.1f", ",",
+                                  &p_results->login);
+        fprintf(p_file, "},\"server_peak_rss_kb\":%" PRIu64
+                ",\"server_hwm_kb\":%" PRIu64 ",\"server_peak_fds\":%"
+                PRIu64, p_results->peak_rss_kb, p_results->server_hwm_kb,
+                p_results->peak_fds);
+    }
+
+    if (options.fanout)
+    {
+        fprintf(p_file, ",\"listeners\":%d,\"ready_listeners\":%d,"
+                "\"chats_measured\":%" PRIu64 ",\"chats_complete\":%"
+                PRIu64 ",\"sender_latency_us\":{", options.listeners,
+                p_results->ready_listeners, p_results->measured,
+                p_results->complete);
+        loadgen_print_percentiles(p_file, "\"%s\":%.1f", ",",
+                                  &p_results->first);
+        fprintf(p_file, "},\"spread_us\":{");
+        loadgen_print_percentiles(p_file, "\"%s\":%.1f", ",",
+                                  &p_results->spread);
+        fprintf(p_file, "},\"send_stall_us\":{");
+        loadgen_print_percentiles(p_file, "\"%s\":%.1f", ",",
+                                  &p_results->send_stall);
+        fprintf(p_file, "}");
+    }
+
+    fprintf(p_file, "}\n");
+
+    if (EOF == fclose(p_file))
+    {
+        perror("loadgen_report: fclose");
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Driver code for the load generator.
+ *
+ * @param argc argument count.
+ * @param argv arguments.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+main (int argc, char ** argv)
+{
+    if (FAILURE == loadgen_parse(argc, argv))
+    {
+        fprintf(stderr, "usage: %s [-h host] [-p port] [-c clients] "
+                "[-r rooms] [-D room skew] [-s senders] [-m msgs/s] "
+                "[-d seconds] [-t threads] [-u user prefix] [-a admin] "
+                "[-P admin password] [-F] [-C] [-S server pid] "
+                "[-o report file] [-L report label]\n", argv[0]);
+        return FAILURE;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    //NOTE: Large fan-out runs need more descriptors than the usual soft
+    //limit of 1024.
+    struct rlimit files;
+
+    if (SUCCESS == getrlimit(RLIMIT_NOFILE, &files))
+    {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    p_client_ctx = SSL_CTX_new(TLS_client_method());
+
+    if (NULL == p_client_ctx)
+    {
+        fprintf(stderr, "main: SSL_CTX_new\n");
+        return FAILURE;
+    }
+
+    SSL_CTX_set_verify(p_client_ctx, SSL_VERIFY_NONE, NULL);
+
+    if ((!options.churn) && (FAILURE == loadgen_create_rooms()))
+    {
+        SSL_CTX_free(p_client_ctx);
+        return FAILURE;
+    }
+
+    loadgen_session_t * p_sessions = calloc(options.clients,
+                                    sizeof(loadgen_session_t));
+    loadgen_worker_t * p_workers = calloc(options.threads,
+                                    sizeof(loadgen_worker_t));
+    loadgen_results_t * p_results = calloc(1, sizeof(loadgen_results_t));
+
+    //NOTE: Room for every chat the senders can send in the run, warm up
+    //and grace period included.
+    if (options.fanout)
+    {
+        messages_tracked = (options.rate * (options.duration + 2 +
+                            LOADGEN_GRACE_SEC)) + (2 * options.senders);
+        messages_tracked = (LOADGEN_MAX_TRACKED < messages_tracked) ?
+                            LOADGEN_MAX_TRACKED : messages_tracked;
+        p_messages = calloc(messages_tracked, sizeof(loadgen_message_t));
+    }
+
+    if ((NULL == p_sessions) || (NULL == p_workers) ||
+        (NULL == p_results) || (options.fanout && (NULL == p_messages)))
+    {
+        perror("main: calloc");
+        FREE(p_sessions);
+        FREE(p_workers);
+        FREE(p_results);
+        FREE(p_messages);
+        SSL_CTX_free(p_client_ctx);
+        return FAILURE;
+    }
+
+    loadgen_assign_rooms(p_sessions);
+    pthread_barrier_init(&start_barrier, NULL, (options.threads + 1));
+
+    uint64_t setup_ns = loadgen_now_ns();
+
+    for (int counter = 0; counter < options.threads; counter++)
+    {
+        int first = ((long) options.clients * counter) / options.threads;
+        int last = ((long) options.clients * (counter + 1)) / options.threads;
+
+        p_workers[counter].p_sessions = &p_sessions[first];
+        p_workers[counter].count = last - first;
+        pthread_create(&p_workers[counter].thread, NULL, options.churn ?
+                       loadgen_churn_worker : loadgen_worker,
+                       &p_workers[counter]);
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    setup_ns = loadgen_now_ns() - setup_ns;
+
+    //NOTE: One second of warm up so every session is sending before the
+    //measurement starts.
+    sleep(1);
+    measuring = CONTINUE;
+    uint64_t start_ns = loadgen_now_ns();
+
+    if (0 == options.server_pid)
+    {
+        sleep(options.duration);
+    }
+
+    while ((0 != options.server_pid) && ((loadgen_now_ns() - start_ns) <
+                            ((uint64_t) options.duration * 1000000000ULL)))
+    {
+        struct timespec interval = {0, (LOADGEN_SAMPLE_MS * 1000000L)};
+        loadgen_sample_server(p_results);
+        nanosleep(&interval, NULL);
+    }
+
+    measuring = STOP;
+    p_results->elapsed = (loadgen_now_ns() - start_ns) / 1e9;
+    p_results->setup = setup_ns / 1e9;
+
+    if (options.fanout)
+    {
+        sleep(LOADGEN_GRACE_SEC);
+    }
+
+    running = STOP;
+
+    for (int counter = 0; counter < options.threads; counter++)
+    {
+        pthread_join(p_workers[counter].thread, NULL);
+        p_results->sent += p_workers[counter].sent;
+        p_results->delivered += p_workers[counter].delivered;
+        p_results->errors += p_workers[counter].errors;
+        loadgen_hist_merge(&p_results->latency, &p_workers[counter].latency);
+        loadgen_hist_merge(&p_results->send_stall,
+                           &p_workers[counter].send_stall);
+        loadgen_hist_merge(&p_results->handshake,
+                           &p_workers[counter].handshake);
+        loadgen_hist_merge(&p_results->login, &p_workers[counter].login);
+        p_results->cycles += p_workers[counter].cycles;
+    }
+
+    for (int counter = 0; counter < options.clients; counter++)
+    {
+        p_results->ready += p_sessions[counter].ready;
+        p_results->ready_listeners += (p_sessions[counter].ready &&
+                                       (!p_sessions[counter].sender));
+    }
+
+    loadgen_fanout_results(p_results);
+    loadgen_print(p_results);
+
+    int return_val = SUCCESS;
+
+    if (('\0' != options.p_report[0]) &&
+        (FAILURE == loadgen_report(p_results)))
+    {
+        return_val = FAILURE;
+    }
+
+    FREE(p_results);
+    FREE(p_messages);
+    FREE(p_sessions);
+    FREE(p_workers);
+    pthread_barrier_destroy(&start_barrier);
+    SSL_CTX_free(p_client_ctx);
+
+    return return_val;
+}
+
+//End of cr_loadgen.c file
@@ -1,5 +1,55 @@
 #include "cll.h"
 
+//NOTE: Nodes come from a slab shared by every list, so adding and
+//removing them does not go through malloc. If the slab can not be created
+//they fall back to calloc and free.
+static slab_t * p_cll_node_slab = NULL;
+static pthread_once_t cll_node_slab_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Creates the cll_node slab once per process.
+ */
+static void
+cll_node_slab_init ()
+{
+    p_cll_node_slab = slab_init(sizeof(node_t));
+}
+
+/**
+ * @brief Allocates a zeroed node.
+ * 
+ * @return node_t* pointer to the node. NULL returned on failure.
+ */
+static node_t *
+cll_node_alloc ()
+{
+    pthread_once(&cll_node_slab_once, cll_node_slab_init);
+
+    if (NULL == p_cll_node_slab)
+    {
+        return calloc(1, sizeof(node_t));
+    }
+
+    return slab_alloc(p_cll_node_slab);
+}
+
+/**
+ * @brief Frees a node from cll_node_alloc.
+ * 
+ * @param p_node_holder pointer to the node.
+ */
+static void
+cll_node_free (void * p_node_holder)
+{
+    if (NULL == p_cll_node_slab)
+    {
+        free(p_node_holder);
+        return;
+    }
+
+    slab_free(p_node_holder);
+}
+
 /**
  * @brief Creates circularly linked list context.
  * 
@@ -165,11 +215,11 @@ cll_insert_element_begin (cll_t * p_cll, void * data)
         return FAILURE;
     }
 
-    node_t * p_newnode = (calloc(1, sizeof(node_t)));
+    node_t * p_newnode = cll_node_alloc();
 
     if (NULL == p_newnode)
     {
-        perror("cll_insert_element_begin: node_t calloc");
+        fprintf(stderr, "cll_insert_element_begin: node_t alloc failure\n");
         return FAILURE;
     }
 
@@ -185,7 +235,7 @@ cll_insert_element_begin (cll_t * p_cll, void * data)
     if (NULL == p_cll->p_tail)
     {
         fprintf(stderr, "cll_insert_element_begin: p_cll tail NULL\n");
-        FREE(p_newnode);
+        cll_node_free(p_newnode);
         return FAILURE;
     }
 
@@ -213,11 +263,11 @@ cll_insert_element_end (cll_t * p_cll, void * data)
         return FAILURE;
     }
 
-    node_t * p_newnode = (calloc(1, sizeof(node_t)));
+    node_t * p_newnode = cll_node_alloc();
 
     if (NULL == p_newnode)
     {
-        perror("cll_insert_element_begin: node_t calloc");
+        fprintf(stderr, "cll_insert_element_begin: node_t alloc failure\n");
         return FAILURE;
     }
 
@@ -233,7 +283,7 @@ cll_insert_element_end (cll_t * p_cll, void * data)
     if (NULL == p_cll->p_tail)
     {
         fprintf(stderr, "cll_insert_element_end: p_cll tail NULL\n");
-        FREE(p_newnode);
+        cll_node_free(p_newnode);
         return FAILURE;
     }
 
@@ -309,11 +359,11 @@ cll_insert_element (cll_t * p_cll, void * data, int position)
         }
     }
 
-    node_t * p_newnode = (node_t *)(calloc(1, sizeof(node_t)));
+    node_t * p_newnode = cll_node_alloc();
 
     if (NULL == p_newnode)
     {
-        perror("cll_insert_element: node_t calloc");
+        fprintf(stderr, "cll_insert_element: node_t alloc failure\n");
         return FAILURE;
     }
 
@@ -336,7 +386,7 @@ cll_insert_element (cll_t * p_cll, void * data, int position)
         if (NULL == p_temp)
         {
             fprintf(stderr, "cll_insert_element: node NULL");
-            FREE(p_newnode);
+            cll_node_free(p_newnode);
             return FAILURE;
         }
 
@@ -402,7 +452,8 @@ cll_remove_element_begin (cll_t * p_cll, void (*p_free_function)(void *))
     if (1 == p_cll->size)
     {
         cll_p_data_free(p_cll->p_head, p_free_function);
-        FREE(p_cll->p_head);
+        cll_node_free(p_cll->p_head);
+        p_cll->p_head = NULL;
         p_cll->p_tail = NULL;
         p_cll->size = 0;
 
@@ -419,7 +470,7 @@ cll_remove_element_begin (cll_t * p_cll, void (*p_free_function)(void *))
 
     p_cll->p_head = p_temp1->p_next;
     cll_p_data_free(p_temp1, p_free_function);
-    FREE(p_temp1);
+    cll_node_free(p_temp1);
     p_cll->p_tail->p_next = p_cll->p_head;
     p_cll->size--;
 
@@ -496,7 +547,8 @@ cll_remove_element (cll_t * p_cll, int position,
     if (1 == p_cll->size)
     {
         cll_p_data_free(p_cll->p_head, p_free_function);
-        FREE(p_cll->p_head);
+        cll_node_free(p_cll->p_head);
+        p_cll->p_head = NULL;
         p_cll->p_tail = NULL;
         p_cll->size = 0;
         return SUCCESS;
@@ -534,7 +586,7 @@ cll_remove_element (cll_t * p_cll, int position,
     }
 
     cll_p_data_free(p_temp2, p_free_function);
-    FREE(p_temp2);
+    cll_node_free(p_temp2);
     p_cll->size--;
 
     return SUCCESS;
@@ -671,7 +723,7 @@ cll_return_element_end (cll_t * p_cll)
         p_cll->size--;
 
         void * p_data = p_temp_node->p_data;
-        FREE(p_temp_node);
+        cll_node_free(p_temp_node);
         return p_data;
     }
     else
@@ -695,7 +747,7 @@ cll_return_element_end (cll_t * p_cll)
         p_cll->size--;
 
         void * p_data = p_last_node->p_data;
-        FREE(p_last_node);
+        cll_node_free(p_last_node);
         return p_data;
     }
 }
@@ -986,4 +1038,182 @@ cll_sort (cll_t * p_cll)
     }
 }
 
+/**
+ * @brief Initializes an empty intrusive list.
+ * 
+ * @param p_list pointer to the list.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+cll_intrusive_init (cll_intrusive_t * p_list)
+{
+    if (NULL == p_list)
+    {
+        fprintf(stderr, "cll_intrusive_init: p_list NULL\n");
+        return FAILURE;
+    }
+
+    p_list->head.p_next = &p_list->head;
+    p_list->head.p_prev = &p_list->head;
+    p_list->size = 0;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Abstracts size return for cll_intrusive_t structure.
+ * 
+ * @param p_list pointer to the list.
+ * @return int size of the list. If failure, -1 returned.
+ */
+int
+cll_intrusive_size (cll_intrusive_t * p_list)
+{
+    if (NULL == p_list)
+    {
+        fprintf(stderr, "cll_intrusive_size: p_list NULL\n");
+        return FAILURE_NEGATIVE;
+    }
+
+    return p_list->size;
+}
+
+/**
+ * @brief Returns whether a link is in a list.
+ * 
+ * @param p_link pointer to the link.
+ * @return true if the link is in a list.
+ * @return false if it is not, or p_link is NULL.
+ */
+bool
+cll_intrusive_linked (cll_link_t * p_link)
+{
+    return ((NULL != p_link) && (NULL != p_link->p_next));
+}
+
+/**
+ * @brief Links p_link in between two neighbouring links of a list.
+ * 
+ * @param p_list pointer to the list.
+ * @param p_link pointer to the new link.
+ * @param p_prev link that will come before p_link.
+ * @param p_next link that will come after p_link.
+ */
+static void
+cll_intrusive_link (cll_intrusive_t * p_list, cll_link_t * p_link,
+                    cll_link_t * p_prev, cll_link_t * p_next)
+{
+    p_link->p_prev = p_prev;
+    p_link->p_next = p_next;
+    p_prev->p_next = p_link;
+    p_next->p_prev = p_link;
+    p_list->size++;
+}
+
+/**
+ * @brief Adds an element at the beginning of an intrusive list.
+ * 
+ * @param p_list pointer to the list.
+ * @param p_link pointer to the element's link, which must not be in a list.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+cll_intrusive_insert_begin (cll_intrusive_t * p_list, cll_link_t * p_link)
+{
+    if ((NULL == p_list) || (NULL == p_link))
+    {
+        fprintf(stderr, "cll_intrusive_insert_begin: input NULL\n");
+        return FAILURE;
+    }
+
+    if (NULL != p_link->p_next)
+    {
+        fprintf(stderr, "cll_intrusive_insert_begin: link already in a list\n");
+        return FAILURE;
+    }
+
+    cll_intrusive_link(p_list, p_link, &p_list->head, p_list->head.p_next);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Adds an element at the end of an intrusive list.
+ * 
+ * @param p_list pointer to the list.
+ * @param p_link pointer to the element's link, which must not be in a list.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+cll_intrusive_insert_end (cll_intrusive_t * p_list, cll_link_t * p_link)
+{
+    if ((NULL == p_list) || (NULL == p_link))
+    {
+        fprintf(stderr, "cll_intrusive_insert_end: input NULL\n");
+        return FAILURE;
+    }
+
+    if (NULL != p_link->p_next)
+    {
+        fprintf(stderr, "cll_intrusive_insert_end: link already in a list\n");
+        return FAILURE;
+    }
+
+    cll_intrusive_link(p_list, p_link, p_list->head.p_prev, &p_list->head);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Removes an element from an intrusive list in constant time.
+ * 
+ * @param p_list pointer to the list the element is in.
+ * @param p_link pointer to the element's link.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+cll_intrusive_remove (cll_intrusive_t * p_list, cll_link_t * p_link)
+{
+    if ((NULL == p_list) || (NULL == p_link))
+    {
+        fprintf(stderr, "cll_intrusive_remove: input NULL\n");
+        return FAILURE;
+    }
+
+    if ((NULL == p_link->p_next) || (p_link == &p_list->head) ||
+        (0 == p_list->size))
+    {
+        fprintf(stderr, "cll_intrusive_remove: link not in the list\n");
+        return FAILURE;
+    }
+
+    p_link->p_prev->p_next = p_link->p_next;
+    p_link->p_next->p_prev = p_link->p_prev;
+    p_link->p_next = NULL;
+    p_link->p_prev = NULL;
+    p_list->size--;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Removes and returns the first element's link.
+ * 
+ * @param p_list pointer to the list.
+ * @return cll_link_t* pointer to the link, NULL if the list is empty.
+ */
+cll_link_t *
+cll_intrusive_remove_begin (cll_intrusive_t * p_list)
+{
+    if ((NULL == p_list) || (0 == p_list->size))
+    {
+        return NULL;
+    }
+
+    cll_link_t * p_link = p_list->head.p_next;
+    cll_intrusive_remove(p_list, p_link);
+
+    return p_link;
+}
+
 //End of cll.c library source file.
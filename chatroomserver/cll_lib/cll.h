@@ -5,6 +5,11 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "../slab_lib/slab.h"
 
 #ifndef SHARED_MACROS
 #define SHARED_MACROS
@@ -52,6 +57,46 @@ typedef struct node_t {
     struct node_t * p_next;
 } node_t;
 
+//NOTE: Intrusive lists. The link lives inside the element (a user in its
+//room, for instance), so inserting and removing never allocate and can not
+//fail for lack of memory, and walking the list loads one line per element
+//instead of a node and then its data. An element can be in one list per
+//link it embeds.
+
+/**
+ * @brief Link embedded in an element of an intrusive list. Both pointers are
+ * NULL while the element is in no list.
+ * 
+ * @param p_next pointer to the next link.
+ * @param p_prev pointer to the previous link.
+ */
+typedef struct cll_link_t {
+    struct cll_link_t * p_next;
+    struct cll_link_t * p_prev;
+} cll_link_t;
+
+/**
+ * @brief Intrusive circularly linked list. The head is a link of its own
+ * that is not part of any element, so the list is never without a node.
+ * 
+ * @param head link before the first and after the last element.
+ * @param size number of elements in the list.
+ */
+typedef struct cll_intrusive_t {
+    cll_link_t head;
+    int size;
+} cll_intrusive_t;
+
+//Returns the element a link is embedded in.
+#define CLL_CONTAINER(p_link, type, member) \
+    ((type *) ((char *) (p_link) - offsetof(type, member)))
+
+//Walks every link of an intrusive list from first to last. The current link
+//must not be removed inside the loop.
+#define CLL_INTRUSIVE_FOR_EACH(p_link, p_list) \
+    for (cll_link_t * p_link = (p_list)->head.p_next; \
+         p_link != &(p_list)->head; p_link = p_link->p_next)
+
 /**
  * @brief cll_t context structure.
  * 
@@ -207,6 +252,73 @@ cll_return_element_end (cll_t * p_cll);
 int
 cll_sort (cll_t * p_cll);
 
+/**
+ * @brief Initializes an empty intrusive list.
+ * 
+ * @param p_list pointer to the list.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+cll_intrusive_init (cll_intrusive_t * p_list);
+
+/**
+ * @brief Abstracts size return for cll_intrusive_t structure.
+ * 
+ * @param p_list pointer to the list.
+ * @return int size of the list. If failure, -1 returned.
+ */
+int
+cll_intrusive_size (cll_intrusive_t * p_list);
+
+/**
+ * @brief Returns whether a link is in a list.
+ * 
+ * @param p_link pointer to the link.
+ * @return true if the link is in a list.
+ * @return false if it is not, or p_link is NULL.
+ */
+bool
+cll_intrusive_linked (cll_link_t * p_link);
+
+/**
+ * @brief Adds an element at the beginning of an intrusive list.
+ * 
+ * @param p_list pointer to the list.
+ * @param p_link pointer to the element's link, which must not be in a list.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+cll_intrusive_insert_begin (cll_intrusive_t * p_list, cll_link_t * p_link);
+
+/**
+ * @brief Adds an element at the end of an intrusive list.
+ * 
+ * @param p_list pointer to the list.
+ * @param p_link pointer to the element's link, which must not be in a list.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+cll_intrusive_insert_end (cll_intrusive_t * p_list, cll_link_t * p_link);
+
+/**
+ * @brief Removes an element from an intrusive list in constant time.
+ * 
+ * @param p_list pointer to the list the element is in.
+ * @param p_link pointer to the element's link.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+cll_intrusive_remove (cll_intrusive_t * p_list, cll_link_t * p_link);
+
+/**
+ * @brief Removes and returns the first element's link.
+ * 
+ * @param p_list pointer to the list.
+ * @return cll_link_t* pointer to the link, NULL if the list is empty.
+ */
+cll_link_t *
+cll_intrusive_remove_begin (cll_intrusive_t * p_list);
+
 #endif //CLL_LIB
 
 //End of cll.h library source file.
@@ -4,6 +4,12 @@
 //during the run of the program.
 
 #include "include/cr_shared.h"
+#include "include/cr_frame.h"
+#include "include/cr_compress.h"
+#include "include/cr_metrics.h"
+#include "include/cr_trace.h"
+#include "include/cr_stats.h"
+#include "include/cr_rooms.h"
 #include <CUnit/Basic.h>
 #include <CUnit/CUnit.h>
 
@@ -213,6 +219,108 @@ test_cll_destroy ()
     CU_ASSERT(SUCCESS == cll_destroy(&p_test_cll, NULL));
 }
 
+/**
+ * @brief Element of the intrusive container tests.
+ */
+typedef struct {
+    int value;
+    cll_link_t list_link;
+    queue_link_t queue_link;
+} test_element_t;
+
+/**
+ * @brief tests the cll_intrusive functions.
+ * 
+ */
+static void
+test_cll_intrusive ()
+{
+    cll_intrusive_t list;
+    test_element_t p_elements[3];
+    memset(p_elements, 0, sizeof(p_elements));
+
+    CU_ASSERT(SUCCESS == cll_intrusive_init(&list));
+    CU_ASSERT(0 == cll_intrusive_size(&list));
+
+    for (int index = 0; index < 3; index++)
+    {
+        p_elements[index].value = index;
+        CU_ASSERT(SUCCESS == cll_intrusive_insert_end(&list,
+                                &p_elements[index].list_link));
+    }
+
+    //NOTE: An element can only be in the list once.
+    CU_ASSERT(FAILURE == cll_intrusive_insert_begin(&list,
+                                 &p_elements[1].list_link));
+    CU_ASSERT(3 == cll_intrusive_size(&list));
+
+    CU_ASSERT(SUCCESS == cll_intrusive_remove(&list,
+                           &p_elements[1].list_link));
+    CU_ASSERT(!cll_intrusive_linked(&p_elements[1].list_link));
+    CU_ASSERT(FAILURE == cll_intrusive_remove(&list,
+                           &p_elements[1].list_link));
+    CU_ASSERT(SUCCESS == cll_intrusive_insert_begin(&list,
+                                 &p_elements[1].list_link));
+
+    int p_order[3] = {0};
+    int count = 0;
+
+    CLL_INTRUSIVE_FOR_EACH(p_link, &list)
+    {
+        p_order[count++] = CLL_CONTAINER(p_link, test_element_t,
+                                                 list_link)->value;
+    }
+
+    CU_ASSERT(3 == count);
+    CU_ASSERT((1 == p_order[0]) && (0 == p_order[1]) && (2 == p_order[2]));
+
+    while (NULL != cll_intrusive_remove_begin(&list))
+    {
+    }
+
+    CU_ASSERT(0 == cll_intrusive_size(&list));
+    CU_ASSERT(!cll_intrusive_linked(&p_elements[2].list_link));
+}
+
+/**
+ * @brief tests the queue_intrusive functions.
+ * 
+ */
+static void
+test_queue_intrusive ()
+{
+    queue_intrusive_t queue;
+    test_element_t p_elements[3];
+    memset(p_elements, 0, sizeof(p_elements));
+
+    CU_ASSERT(SUCCESS == queue_intrusive_init(&queue));
+    CU_ASSERT(NULL == queue_intrusive_dequeue(&queue));
+
+    for (int index = 0; index < 3; index++)
+    {
+        p_elements[index].value = index;
+        CU_ASSERT(SUCCESS == queue_intrusive_enqueue(&queue,
+                                &p_elements[index].queue_link));
+    }
+
+    CU_ASSERT(3 == queue_intrusive_size(&queue));
+
+    for (int index = 0; index < 3; index++)
+    {
+        queue_link_t * p_link = queue_intrusive_dequeue(&queue);
+        CU_ASSERT(NULL != p_link);
+
+        if (NULL != p_link)
+        {
+            CU_ASSERT(index == QUEUE_CONTAINER(p_link, test_element_t,
+                                                  queue_link)->value);
+        }
+    }
+
+    CU_ASSERT(0 == queue_intrusive_size(&queue));
+    CU_ASSERT(NULL == queue_intrusive_dequeue(&queue));
+}
+
 /**
  * @brief test h_table_init.
  * 
@@ -254,6 +362,14 @@ test_h_table_return_entry ()
 {
     CU_ASSERT(data == h_table_return_entry(p_test_h_table_1, "0"));
     CU_ASSERT(data == h_table_return_entry(p_test_h_table_2, "0"));
+
+    //NOTE: Bytes after a short key's terminator must not move it.
+    char p_stored[KEY_LENGTH] = "lobby\0XXXX";
+    char p_lookup[KEY_LENGTH] = "lobby\0YYYY";
+
+    CU_ASSERT(SUCCESS == h_table_new_entry(p_test_h_table_1, data, p_stored));
+    CU_ASSERT(data == h_table_return_entry(p_test_h_table_1, p_lookup));
+    CU_ASSERT(data == h_table_destroy_entry(p_test_h_table_1, p_lookup));
 }
 
 /**
@@ -281,6 +397,663 @@ test_h_table_destroy ()
     CU_ASSERT(SUCCESS == h_table_destroy(p_test_h_table_2, NULL));
 }
 
+/**
+ * @brief tests is_prime, next_prime, prime_capacity and
+ * power_of_two_capacity above the old 16 bit limit.
+ * 
+ */
+static void
+test_prime_capacity ()
+{
+    for (uint32_t value = 3; 0 != value; value = prime_capacity(value + 1))
+    {
+        CU_ASSERT(is_prime(value));
+    }
+
+    CU_ASSERT(!is_prime(65535));
+    CU_ASSERT(is_prime(65537));
+    CU_ASSERT(!is_prime(3215031751u));
+    CU_ASSERT(65537 == next_prime(65521));
+    CU_ASSERT(4294967291u == next_prime(4294967279u));
+    CU_ASSERT(FAILURE == next_prime(4294967291u));
+
+    CU_ASSERT(3 == prime_capacity(0));
+    CU_ASSERT(97 == prime_capacity(97));
+    CU_ASSERT(193 == prime_capacity(98));
+    CU_ASSERT(4294967291u == prime_capacity(3221225474u));
+    CU_ASSERT(0 == prime_capacity(4294967292u));
+
+    CU_ASSERT(1 == power_of_two_capacity(0));
+    CU_ASSERT(64 == power_of_two_capacity(64));
+    CU_ASSERT(128 == power_of_two_capacity(65));
+    CU_ASSERT((UINT32_C(1) << 31) == power_of_two_capacity((1u << 30) + 1));
+    CU_ASSERT(0 == power_of_two_capacity((1u << 31) + 1));
+}
+
+/**
+ * @brief tests h_table_init_sized growing tables in both capacity modes.
+ * 
+ */
+static void
+test_h_table_init_sized ()
+{
+    static char pp_keys[200][KEY_LENGTH + 1];
+    uint8_t p_sizing[2] = {H_TABLE_PRIME, H_TABLE_POWER_OF_TWO};
+
+    CU_ASSERT(NULL == h_table_init_sized(0, NULL, H_TABLE_PRIME));
+    CU_ASSERT(NULL == h_table_init_sized(5, NULL, 2));
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+        h_table_t * p_h_table = h_table_init_sized(5, NULL, p_sizing[mode]);
+
+        CU_ASSERT(NULL != p_h_table);
+
+        if (NULL == p_h_table)
+        {
+            return;
+        }
+
+        CU_ASSERT(((H_TABLE_PRIME == p_sizing[mode]) ? 5 : 8) ==
+                                             p_h_table->capacity);
+
+        for (int counter = 0; counter < 200; counter++)
+        {
+            snprintf(pp_keys[counter], (KEY_LENGTH + 1), "key%07d", counter);
+            CU_ASSERT(SUCCESS == h_table_new_entry(p_h_table, data,
+                                                  pp_keys[counter]));
+        }
+
+        for (int counter = 0; counter < 200; counter++)
+        {
+            CU_ASSERT(data == h_table_return_entry(p_h_table,
+                                                  pp_keys[counter]));
+        }
+
+        CU_ASSERT(NULL == h_table_return_entry(p_h_table, "nokey00000"));
+
+        if (H_TABLE_PRIME == p_sizing[mode])
+        {
+            CU_ASSERT(389 == p_h_table->capacity);
+        }
+        else
+        {
+            CU_ASSERT(512 == p_h_table->capacity);
+            CU_ASSERT(511 == p_h_table->mask);
+        }
+
+        CU_ASSERT(SUCCESS == h_table_destroy(p_h_table, NULL));
+    }
+}
+
+/**
+ * @brief tests cr_frame_put_varint and cr_frame_get_varint.
+ * 
+ */
+static void
+test_cr_frame_varint ()
+{
+    char p_buffer[MAX_VARINT_LENGTH] = {0};
+    uint64_t value = 0;
+
+    CU_ASSERT(1 == cr_frame_put_varint(p_buffer, sizeof(p_buffer), 127));
+    CU_ASSERT(1 == cr_frame_get_varint(p_buffer, sizeof(p_buffer), &value));
+    CU_ASSERT(127 == value);
+
+    CU_ASSERT(2 == cr_frame_put_varint(p_buffer, sizeof(p_buffer), 300));
+    CU_ASSERT(0 == cr_frame_get_varint(p_buffer, 1, &value));
+    CU_ASSERT(2 == cr_frame_get_varint(p_buffer, sizeof(p_buffer), &value));
+    CU_ASSERT(300 == value);
+
+    CU_ASSERT(MAX_VARINT_LENGTH == cr_frame_put_varint(p_buffer,
+                                    sizeof(p_buffer), UINT64_MAX));
+    CU_ASSERT(MAX_VARINT_LENGTH == cr_frame_get_varint(p_buffer,
+                                       sizeof(p_buffer), &value));
+    CU_ASSERT(UINT64_MAX == value);
+    CU_ASSERT(FAILURE_NEGATIVE == cr_frame_put_varint(p_buffer, 1, 300));
+}
+
+/**
+ * @brief tests cr_frame_next splitting pipelined v1 packets, waiting for
+ * packets split across reads and reading short joins only from legacy
+ * connections.
+ * 
+ */
+static void
+test_cr_frame_next ()
+{
+    session_t * p_session = calloc(1, sizeof(session_t));
+    char * p_packet = calloc(1, BUFF_SIZE);
+    CU_ASSERT((NULL != p_session) && (NULL != p_packet));
+
+    if ((NULL == p_session) || (NULL == p_packet))
+    {
+        FREE(p_session);
+        FREE(p_packet);
+        return;
+    }
+
+    join_req_t join;
+    received_msg_t list = {ROOMS_TYPE, LIST_STYPE, REQUEST};
+    size_t legacy_len = offsetof(join_req_t, since);
+
+    memset(&join, 0, sizeof(join_req_t));
+    join.type = ROOMS_TYPE;
+    join.s_type = JOIN_STYPE;
+    join.opcode = REQUEST;
+    strcpy(join.p_room_name, "lobby");
+
+    //NOTE: A legacy join pipelined with a list request.
+    p_session->version = PROTOCOL_LEGACY;
+    memcpy(p_session->p_recv_buffer, &join, legacy_len);
+    memcpy((p_session->p_recv_buffer + legacy_len), &list,
+                                      sizeof(received_msg_t));
+    p_session->recv_end = legacy_len + sizeof(received_msg_t);
+
+    CU_ASSERT(SUCCESS == cr_frame_next(p_session, p_packet));
+    CU_ASSERT(legacy_len == p_session->recv_start);
+    CU_ASSERT(SUCCESS == cr_frame_next(p_session, p_packet));
+    CU_ASSERT(LIST_STYPE == (uint8_t) p_packet[1]);
+    CU_ASSERT(FRAME_INCOMPLETE == cr_frame_next(p_session, p_packet));
+
+    //NOTE: A negotiated v1 join that has only partly arrived waits for the
+    //rest, then a request whose header is split does too.
+    p_session->version = PROTOCOL_V1;
+    p_session->recv_start = 0;
+    memcpy(p_session->p_recv_buffer, &join, sizeof(join_req_t));
+    p_session->recv_end = legacy_len + sizeof(received_msg_t);
+
+    CU_ASSERT(FRAME_INCOMPLETE == cr_frame_next(p_session, p_packet));
+    CU_ASSERT(0 == p_session->recv_start);
+
+    memcpy((p_session->p_recv_buffer + sizeof(join_req_t)), &list, 2);
+    p_session->recv_end = sizeof(join_req_t) + 2;
+
+    CU_ASSERT(SUCCESS == cr_frame_next(p_session, p_packet));
+    CU_ASSERT(sizeof(join_req_t) == p_session->recv_start);
+    CU_ASSERT(FRAME_INCOMPLETE == cr_frame_next(p_session, p_packet));
+
+    FREE(p_session);
+    FREE(p_packet);
+}
+
+/**
+ * @brief tests cr_compress_deflate and cr_compress_inflate.
+ * 
+ */
+static void
+test_cr_compress_round_trip ()
+{
+    char p_history[] = "1 admin>hello\n2 admin>hello again\n"
+                       "3 guest>hello there\n";
+    char p_compressed[BUFF_SIZE] = {0};
+    char p_inflated[BUFF_SIZE] = {0};
+
+    int compressed_len = cr_compress_deflate(p_history, strlen(p_history),
+                                   p_compressed, sizeof(p_compressed));
+
+    CU_ASSERT(0 < compressed_len);
+    CU_ASSERT((int) strlen(p_history) > compressed_len);
+    CU_ASSERT((int) strlen(p_history) == cr_compress_inflate(p_compressed,
+                         compressed_len, p_inflated, sizeof(p_inflated)));
+    CU_ASSERT(0 == memcmp(p_history, p_inflated, strlen(p_history)));
+    CU_ASSERT(FAILURE_NEGATIVE == cr_compress_deflate(p_history,
+                         strlen(p_history), p_compressed, 4));
+}
+
+/**
+ * @brief Records requests and checks the counts and histogram buckets in
+ * the Prometheus output.
+ */
+static void
+test_cr_metrics_render ()
+{
+    char * p_output = NULL;
+    size_t output_len = 0;
+
+    CU_ASSERT(SUCCESS == cr_metrics_start(19464, NULL, NULL, NULL));
+
+    cr_metrics_request(CHAT_TYPE, CHAT_STYPE, 500);
+    cr_metrics_request(CHAT_TYPE, CHAT_STYPE, 3000);
+    cr_metrics_request(FAIL_TYPE, FAIL_STYPE, 100);
+
+    FILE * p_file = open_memstream(&p_output, &output_len);
+    CU_ASSERT(SUCCESS == cr_metrics_render(p_file));
+    fclose(p_file);
+
+    CU_ASSERT(NULL != strstr(p_output, "cr_requests_total{type=\"chat\","
+                                       "s_type=\"chat\"} 2\n"));
+    CU_ASSERT(NULL != strstr(p_output, "cr_requests_total{type=\"other\","
+                                       "s_type=\"other\"} 1\n"));
+    CU_ASSERT(NULL != strstr(p_output, "cr_request_duration_seconds_bucket{"
+                     "type=\"chat\",s_type=\"chat\",le=\"1.024e-06\"} 1\n"));
+    CU_ASSERT(NULL != strstr(p_output, "cr_request_duration_seconds_bucket{"
+                     "type=\"chat\",s_type=\"chat\",le=\"+Inf\"} 2\n"));
+
+    FREE(p_output);
+    cr_metrics_stop();
+}
+
+/**
+ * @brief Records a packet and a lock, dumps the rings, and checks the
+ * events read back from the dump.
+ */
+static void
+test_cr_trace_dump ()
+{
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    cr_trace_header_t header;
+    cr_trace_ring_record_t ring;
+
+    CU_ASSERT(SUCCESS == cr_trace_start());
+
+    cr_trace_record(TRACE_PACKET_RECEIVED, 0, 42);
+    CU_ASSERT(SUCCESS == CR_MUTEX_LOCK(&mutex));
+    CU_ASSERT(SUCCESS == CR_MUTEX_UNLOCK(&mutex));
+
+    FILE * p_file = tmpfile();
+    CU_ASSERT(SUCCESS == cr_trace_dump(fileno(p_file)));
+    rewind(p_file);
+
+    CU_ASSERT(1 == fread(&header, sizeof(header), 1, p_file));
+    CU_ASSERT(SUCCESS == memcmp(header.p_magic, TRACE_MAGIC,
+                                           TRACE_MAGIC_LENGTH));
+    CU_ASSERT(TRACE_RING_EVENTS == header.ring_events);
+    CU_ASSERT(1 <= header.site_count);
+
+    //NOTE: Skip the site table, then the only ring is this thread's.
+    for (uint32_t count = 0; count < header.site_count; count++)
+    {
+        cr_trace_site_record_t site;
+        CU_ASSERT(1 == fread(&site, sizeof(site), 1, p_file));
+        fseek(p_file, (site.name_len + site.function_len), SEEK_CUR);
+    }
+
+    CU_ASSERT(1 == fread(&ring, sizeof(ring), 1, p_file));
+    CU_ASSERT(3 == ring.head);
+
+    cr_trace_event_t p_events[3];
+    CU_ASSERT(3 == fread(p_events, sizeof(cr_trace_event_t), 3, p_file));
+    CU_ASSERT(TRACE_PACKET_RECEIVED == p_events[0].event);
+    CU_ASSERT(42 == p_events[0].arg);
+    CU_ASSERT(TRACE_LOCK_ACQUIRED == p_events[1].event);
+    CU_ASSERT(0 != p_events[1].site);
+    CU_ASSERT(TRACE_LOCK_RELEASED == p_events[2].event);
+    CU_ASSERT(p_events[1].ticks <= p_events[2].ticks);
+
+    fclose(p_file);
+    cr_trace_stop();
+}
+
+/**
+ * @brief Tests that cr_log writes JSON lines with the message escaped and
+ * that one call site stops after LOG_BURST messages.
+ */
+static void
+test_cr_log_rate_limit ()
+{
+    FILE * p_file = tmpfile();
+    CU_ASSERT(SUCCESS == cr_log_start(p_file));
+
+    for (int count = 0; count < (LOG_BURST + 5); count++)
+    {
+        CR_LOG_WARN("test \"%d\"", count);
+    }
+
+    cr_log_stop();
+    rewind(p_file);
+
+    char p_line[BUFF_SIZE] = {0};
+    int lines = 0;
+
+    while (NULL != fgets(p_line, BUFF_SIZE, p_file))
+    {
+        if (0 == lines)
+        {
+            CU_ASSERT(NULL != strstr(p_line, "\"level\":\"warn\""));
+            CU_ASSERT(NULL != strstr(p_line,
+                                     "\"msg\":\"test \\\"0\\\"\"}"));
+        }
+
+        lines++;
+    }
+
+    CU_ASSERT(LOG_BURST == lines);
+    fclose(p_file);
+}
+
+/**
+ * @brief Tests cr_stats_snapshot() by checking the totals and that rooms are
+ * packed busiest first. The busier room sorts last by name, so only its chat
+ * rate can put it first.
+ */
+static void
+test_cr_stats_snapshot ()
+{
+    room_t p_rooms[2];
+    memset(p_rooms, 0, sizeof(p_rooms));
+    p_rooms[0].p_name = cr_names_intern("calm", MAX_ROOM_NAME_LENGTH);
+    p_rooms[1].p_name = cr_names_intern("rush", MAX_ROOM_NAME_LENGTH);
+
+    cr_stats_start(4);
+    cr_stats_room_add(&p_rooms[0]);
+    cr_stats_room_add(&p_rooms[1]);
+    CU_ASSERT(0 <= p_rooms[0].stats_slot);
+    CU_ASSERT(p_rooms[0].stats_slot != p_rooms[1].stats_slot);
+
+    cr_stats_room_chat(&p_rooms[0]);
+
+    for (int count = 0; count < 3; count++)
+    {
+        cr_stats_room_chat(&p_rooms[1]);
+    }
+
+    cr_stats_request(1000);
+    cr_stats_bytes(10, 20);
+
+    //NOTE: The rate window only holds whole seconds before the current one.
+    struct timespec start;
+    struct timespec now;
+    struct timespec pause = {0, 10000000};
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &start);
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+    while (start.tv_sec == now.tv_sec)
+    {
+        nanosleep(&pause, NULL);
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    }
+
+    char p_packet[STATS_PACKET_SIZE];
+    size_t packet_len = cr_stats_snapshot(NULL, p_packet);
+    CU_ASSERT((sizeof(stats_ack_t) + (2 * sizeof(stats_room_t))) ==
+                                                          packet_len);
+
+    stats_ack_t * p_stats = (stats_ack_t *) p_packet;
+    stats_room_t * p_entries = (stats_room_t *) (p_packet +
+                                                 sizeof(stats_ack_t));
+
+    CU_ASSERT(SESSION_TYPE == p_stats->type);
+    CU_ASSERT(STATS_STYPE == p_stats->s_type);
+    CU_ASSERT(4 == ntohs(p_stats->pool_threads));
+    CU_ASSERT(1 == be64toh(p_stats->requests_total));
+    CU_ASSERT(4 == be64toh(p_stats->chats_total));
+    CU_ASSERT(10 == be64toh(p_stats->bytes_in));
+    CU_ASSERT(20 == be64toh(p_stats->bytes_out));
+    CU_ASSERT(2 == p_stats->room_count);
+    CU_ASSERT(4 == ntohl(p_stats->chats_window));
+    CU_ASSERT(0 == strcmp("rush", p_entries[0].p_room_name));
+    CU_ASSERT(3 == ntohl(p_entries[0].chats_window));
+    CU_ASSERT(1 == ntohl(p_entries[1].chats_window));
+    CU_ASSERT(3 == be64toh(p_entries[0].chats_total));
+    CU_ASSERT(1 == be64toh(p_entries[1].chats_total));
+
+    cr_stats_room_remove(&p_rooms[0]);
+    CU_ASSERT(-1 == p_rooms[0].stats_slot);
+    packet_len = cr_stats_snapshot(NULL, p_packet);
+    CU_ASSERT(1 == p_stats->room_count);
+
+    cr_stats_room_remove(&p_rooms[1]);
+    cr_stats_stop();
+}
+
+/**
+ * @brief Tests cr_shards_chat() by posting chats to a room worker and checking
+ * that a leave waits until they are logged.
+ */
+static void
+test_cr_shards_chat ()
+{
+    room_t room;
+    memset(&room, 0, sizeof(room_t));
+    room.p_name = cr_names_intern("sharded", MAX_ROOM_NAME_LENGTH);
+    snprintf(room.p_room_location, sizeof(room.p_room_location),
+                                             "cr_shards_test.log");
+    room.stats_slot = -1;
+    cll_intrusive_init(&room.members);
+
+    user_t user;
+    memset(&user, 0, sizeof(user_t));
+    user.p_name = cr_names_intern("poster", MAX_USERNAME_LENGTH);
+
+    CU_ASSERT(SUCCESS == cll_intrusive_insert_end(&room.members,
+                                                &user.room_link));
+    CU_ASSERT(SUCCESS == cr_shards_start(2));
+    CU_ASSERT(cr_shards_on());
+
+    //NOTE: The poster is the only member, so chats are logged and sent to
+    //nobody. The leave waits for every chat posted before it.
+    for (int count = 0; count < 50; count++)
+    {
+        CU_ASSERT(SUCCESS == cr_shards_chat(&room, &user, "hello"));
+    }
+
+    CU_ASSERT(SUCCESS == cr_shards_leave(&room, &user));
+    CU_ASSERT(50 == room.chat_seq);
+    CU_ASSERT(0 == room.members.size);
+    CU_ASSERT(!cll_intrusive_linked(&user.room_link));
+
+    char p_history[MAX_CHAT_FILE_SIZE] = {0};
+    CU_ASSERT(0 < cr_chats_history(&room, 49, p_history, sizeof(p_history)));
+    CU_ASSERT(0 == strcmp("50 poster>hello\n", p_history));
+
+    cr_shards_stop();
+    CU_ASSERT(!cr_shards_on());
+
+    remove(room.p_room_location);
+}
+
+/**
+ * @brief Tests cr_chats_page_in() by checking that a cold room reads its
+ * sequence number from its log, a warm room is left alone, and a lost log is
+ * created empty.
+ */
+static void
+test_cr_chats_page_in ()
+{
+    room_t room;
+    memset(&room, 0, sizeof(room_t));
+    room.p_name = cr_names_intern("catalog", MAX_ROOM_NAME_LENGTH);
+    snprintf(room.p_room_location, sizeof(room.p_room_location),
+                                            "cr_page_in_test.log");
+    room.stats_slot = -1;
+    cll_intrusive_init(&room.members);
+
+    FILE * file_pointer = fopen(room.p_room_location, "w");
+    CU_ASSERT(NULL != file_pointer);
+
+    if (NULL != file_pointer)
+    {
+        fputs("7 poster>first\n8 poster>second\n", file_pointer);
+        fclose(file_pointer);
+    }
+
+    //NOTE: A room from the catalog only learns its sequence number on first
+    //use, and a warm room is left alone.
+    room.log_cold = 1;
+    CU_ASSERT(SUCCESS == cr_chats_page_in(&room));
+    CU_ASSERT(8 == room.chat_seq);
+    CU_ASSERT(0 == room.log_cold);
+
+    room.chat_seq = 12;
+    CU_ASSERT(SUCCESS == cr_chats_page_in(&room));
+    CU_ASSERT(12 == room.chat_seq);
+
+    //NOTE: A lost log is created empty.
+    remove(room.p_room_location);
+    room.log_cold = 1;
+    CU_ASSERT(SUCCESS == cr_chats_page_in(&room));
+    CU_ASSERT(0 == room.chat_seq);
+    CU_ASSERT(0 == access(room.p_room_location, F_OK));
+
+    remove(room.p_room_location);
+}
+
+/**
+ * @brief Frees a slab object from another thread.
+ * 
+ * @param p_object_holder pointer to the object.
+ * @return void* NULL.
+ */
+static void *
+test_slab_free_thread (void * p_object_holder)
+{
+    slab_free(p_object_holder);
+
+    return NULL;
+}
+
+/**
+ * @brief tests slab_alloc and slab_free.
+ * 
+ */
+static void
+test_slab_alloc ()
+{
+    slab_t * p_slab = slab_init(40);
+    CU_ASSERT(NULL != p_slab);
+
+    if (NULL == p_slab)
+    {
+        return;
+    }
+
+    //NOTE: Objects come back zeroed and aligned, and a freed object is the
+    //next one handed out on the same thread.
+    uint64_t * p_first = slab_alloc(p_slab);
+    CU_ASSERT(NULL != p_first);
+    CU_ASSERT(0 == ((uintptr_t) p_first % 16));
+    CU_ASSERT(0 == p_first[0]);
+    p_first[0] = 99;
+    slab_free(p_first);
+
+    uint64_t * p_second = slab_alloc(p_slab);
+    CU_ASSERT(p_first == p_second);
+    CU_ASSERT(0 == p_second[0]);
+
+    //NOTE: An object freed on another thread goes back to this thread's
+    //cache once its own free list runs dry.
+    pthread_t thread;
+    CU_ASSERT(0 == pthread_create(&thread, NULL, test_slab_free_thread,
+                                                             p_second));
+    pthread_join(thread, NULL);
+
+    slab_stats_t stats;
+    CU_ASSERT(SUCCESS == slab_stats(p_slab, &stats));
+    CU_ASSERT(2 == stats.allocs);
+    CU_ASSERT(2 == stats.frees);
+    CU_ASSERT(1 == stats.remote_frees);
+    CU_ASSERT(1 == stats.chunks);
+
+    size_t per_chunk = stats.chunk_size / p_slab->stride;
+    int reused = 0;
+
+    for (size_t count = 0; count < per_chunk; count++)
+    {
+        reused |= (p_second == slab_alloc(p_slab));
+    }
+
+    CU_ASSERT(reused);
+    CU_ASSERT(SUCCESS == slab_stats(p_slab, &stats));
+    CU_ASSERT(1 == stats.chunks);
+
+    CU_ASSERT(SUCCESS == slab_destroy(&p_slab));
+    CU_ASSERT(NULL == p_slab);
+}
+
+/**
+ * @brief tests the cache line layout of user_t and room_t and
+ * cr_alloc_aligned.
+ * 
+ */
+static void
+test_cr_alloc_aligned ()
+{
+    //NOTE: What a broadcast reads shares no line with login_status or the
+    //names.
+    CU_ASSERT(CACHE_LINE_SIZE >= (offsetof(user_t, room_link) +
+                                  sizeof(cll_link_t)));
+    CU_ASSERT(CACHE_LINE_SIZE > offsetof(user_t, p_ssl_holder));
+    CU_ASSERT(CACHE_LINE_SIZE <= offsetof(user_t, login_status));
+    CU_ASSERT(offsetof(user_t, login_status) < offsetof(user_t, p_name));
+    CU_ASSERT(offsetof(room_t, log_cold) < offsetof(room_t, p_name));
+    CU_ASSERT(0 == (offsetof(room_t, p_name) % CACHE_LINE_SIZE));
+
+    user_t * p_user = cr_alloc_aligned(sizeof(user_t));
+    room_t * p_room = cr_alloc_aligned(sizeof(room_t));
+    CU_ASSERT((NULL != p_user) && (NULL != p_room));
+
+    if ((NULL == p_user) || (NULL == p_room))
+    {
+        FREE(p_user);
+        FREE(p_room);
+        return;
+    }
+
+    CU_ASSERT(0 == ((uintptr_t) p_user % CACHE_LINE_SIZE));
+    CU_ASSERT(0 == ((uintptr_t) p_room % CACHE_LINE_SIZE));
+    CU_ASSERT((NULL == p_user->p_ssl_holder) && (0 == p_user->login_status));
+    CU_ASSERT(NULL == p_room->p_name);
+
+    FREE(p_user);
+    FREE(p_room);
+}
+
+/**
+ * @brief tests cr_names_intern, cr_names_find and cr_names_release.
+ * 
+ */
+static void
+test_cr_names_intern ()
+{
+    //NOTE: The packet buffers names arrive in are not always terminated.
+    char p_packet_name[MAX_USERNAME_LENGTH] = "interned";
+    uint32_t count = cr_names_count();
+
+    CU_ASSERT(NULL == cr_names_find("interned", MAX_NAME_LENGTH));
+
+    const cr_name_t * p_name = cr_names_intern("interned", MAX_NAME_LENGTH);
+    CU_ASSERT(NULL != p_name);
+
+    if (NULL == p_name)
+    {
+        return;
+    }
+
+    CU_ASSERT(8 == p_name->length);
+    CU_ASSERT(0 == strcmp("interned", p_name->p_bytes));
+    CU_ASSERT(cr_names_hash("interned", 8) == p_name->hash);
+    CU_ASSERT(count + 1 == cr_names_count());
+
+    //NOTE: The same bytes give the same name, however they arrive.
+    CU_ASSERT(p_name == cr_names_intern(p_packet_name, sizeof(p_packet_name)));
+    CU_ASSERT(p_name == cr_names_find(p_packet_name, sizeof(p_packet_name)));
+
+    const cr_name_t * p_other = cr_names_intern("interne", MAX_NAME_LENGTH);
+    CU_ASSERT(p_name != p_other);
+    CU_ASSERT(count + 2 == cr_names_count());
+
+    //NOTE: Empty and overlong names are refused.
+    char p_long_name[MAX_NAME_LENGTH + 2];
+    memset(p_long_name, 'a', sizeof(p_long_name) - 1);
+    p_long_name[MAX_NAME_LENGTH + 1] = '\0';
+
+    CU_ASSERT(NULL == cr_names_intern("", MAX_NAME_LENGTH));
+    CU_ASSERT(NULL == cr_names_intern(p_long_name, sizeof(p_long_name)));
+    CU_ASSERT(count + 2 == cr_names_count());
+
+    //NOTE: A name is freed with its last reference, p_name has two.
+    cr_names_release(p_other);
+    CU_ASSERT(NULL == cr_names_find("interne", MAX_NAME_LENGTH));
+    CU_ASSERT(count + 1 == cr_names_count());
+
+    cr_names_release(p_name);
+    CU_ASSERT(p_name == cr_names_find("interned", MAX_NAME_LENGTH));
+
+    cr_names_release(p_name);
+    CU_ASSERT(NULL == cr_names_find("interned", MAX_NAME_LENGTH));
+    CU_ASSERT(count == cr_names_count());
+}
 
 int main ()
 {
@@ -308,6 +1081,10 @@ int main ()
 
         {"Testing cll_destroy():", test_cll_destroy},
 
+        {"Testing cll_intrusive_insert_end():", test_cll_intrusive},
+
+        {"Testing queue_intrusive_enqueue():", test_queue_intrusive},
+
         {"Testing h_table_init():", test_h_table_init},
 
         {"Testing h_table_new_entry():", test_h_table_new_entry},
@@ -317,6 +1094,34 @@ int main ()
         {"Testing h_table_destroy_entry():", test_h_table_destroy_entry},
 
         {"Testing h_table_destroy():", test_h_table_destroy},
+
+        {"Testing prime_capacity():", test_prime_capacity},
+
+        {"Testing h_table_init_sized():", test_h_table_init_sized},
+
+        {"Testing cr_frame_varint():", test_cr_frame_varint},
+
+        {"Testing cr_frame_next():", test_cr_frame_next},
+
+        {"Testing cr_compress_deflate():", test_cr_compress_round_trip},
+
+        {"Testing cr_metrics_render():", test_cr_metrics_render},
+
+        {"Testing cr_trace_dump():", test_cr_trace_dump},
+
+        {"Testing cr_log_write():", test_cr_log_rate_limit},
+
+        {"Testing cr_stats_snapshot():", test_cr_stats_snapshot},
+
+        {"Testing cr_shards_chat():", test_cr_shards_chat},
+
+        {"Testing cr_chats_page_in():", test_cr_chats_page_in},
+
+        {"Testing slab_alloc():", test_slab_alloc},
+
+        {"Testing cr_alloc_aligned():", test_cr_alloc_aligned},
+
+        {"Testing cr_names_intern():", test_cr_names_intern},
         
         CU_TEST_INFO_NULL
     
@@ -26,7 +26,10 @@ h_table_hash_function (const void * p_key)
 
     char * data = (char *)p_key;
 
-    for (uint8_t counter = 0; counter < KEY_LENGTH; counter++)
+    //NOTE: Keys are compared with strncmp, so the hash stops at the
+    //terminator too. Bytes after it are not part of the key.
+    for (uint8_t counter = 0; (counter < KEY_LENGTH) && ('\0' != data[counter]);
+                                                                    counter++)
     {
         hash = hash * FNV_prime;
         hash ^= data[counter];
@@ -37,7 +40,7 @@ h_table_hash_function (const void * p_key)
 
 /**
  * @brief Initializes hash table context. Sets hash function and initial size
- * and capacity.
+ * and capacity. The table is sized in H_TABLE_PRIME mode.
  * 
  * @param capacity The user-supplied initial capacity of the hash table.
  * @param p_hash_function user-supplied function for hashing the keys. accepts
@@ -45,8 +48,41 @@ h_table_hash_function (const void * p_key)
  * @return h_table_t* pointer to hash table context structure.
  */
 h_table_t *
-h_table_init (uint16_t capacity, int64_t (*p_hash_function) (const void *))
+h_table_init (uint32_t capacity, int64_t (*p_hash_function) (const void *))
 {
+    return h_table_init_sized(capacity, p_hash_function, H_TABLE_PRIME);
+}
+
+/**
+ * @brief Initializes hash table context with a chosen capacity mode. In
+ * H_TABLE_POWER_OF_TWO mode the capacity is rounded up to a power of two.
+ * 
+ * @param capacity The user-supplied initial capacity of the hash table.
+ * @param p_hash_function user-supplied function for hashing the keys. accepts
+ * a const void and returns an int.
+ * @param sizing H_TABLE_PRIME or H_TABLE_POWER_OF_TWO.
+ * @return h_table_t* pointer to hash table context structure.
+ */
+h_table_t *
+h_table_init_sized (uint32_t capacity,
+                    int64_t (*p_hash_function) (const void *), uint8_t sizing)
+{
+    if (H_TABLE_POWER_OF_TWO == sizing)
+    {
+        capacity = power_of_two_capacity(capacity);
+    }
+    else if (H_TABLE_PRIME != sizing)
+    {
+        fprintf(stderr, "h_table_init_sized: unknown sizing\n");
+        return NULL;
+    }
+
+    if (0 == capacity)
+    {
+        fprintf(stderr, "h_table_init_sized: capacity invalid\n");
+        return NULL;
+    }
+
     h_table_t * p_h_table = calloc(1, sizeof(h_table_t));
 
     if (NULL == p_h_table)
@@ -67,6 +103,8 @@ h_table_init (uint16_t capacity, int64_t (*p_hash_function) (const void *))
     }
 
     p_h_table->capacity = capacity;
+    p_h_table->mask = capacity - 1;
+    p_h_table->sizing = sizing;
 
     p_h_table->pp_array = calloc(capacity, sizeof(cll_t *));
 
@@ -80,6 +118,35 @@ h_table_init (uint16_t capacity, int64_t (*p_hash_function) (const void *))
     return p_h_table;
 }
 
+/**
+ * @brief Maps a hash to an array index. H_TABLE_PRIME tables take the hash
+ * modulo the capacity. H_TABLE_POWER_OF_TWO tables mask the low bits after
+ * mixing the hash with the murmur3 finalizer, so every bit of the key
+ * reaches the index.
+ * 
+ * @param p_h_table pointer to the hash table context.
+ * @param hash hash returned by the table's hash function.
+ * @return uint32_t array index.
+ */
+static inline uint32_t
+h_table_index (h_table_t * p_h_table, int64_t hash)
+{
+    if (H_TABLE_POWER_OF_TWO == p_h_table->sizing)
+    {
+        uint32_t mixed = (uint32_t)(hash ^ (hash >> 32));
+
+        mixed ^= mixed >> 16;
+        mixed *= 0x85ebca6b;
+        mixed ^= mixed >> 13;
+        mixed *= 0xc2b2ae35;
+        mixed ^= mixed >> 16;
+
+        return mixed & p_h_table->mask;
+    }
+
+    return (uint64_t) hash % p_h_table->capacity;
+}
+
 /**
  * @brief After the hash has been calculated, function checks if the intialized
  * list at the array index (no check done if array index empty) already has the
@@ -144,7 +211,7 @@ h_table_new_entry_add (h_table_t * p_h_table, entry_t * p_new_entry)
         return FAILURE;
     }
 
-    int64_t entry_index = hash % (int64_t)(p_h_table->capacity);
+    uint32_t entry_index = h_table_index(p_h_table, hash);
     
     if (NULL == p_h_table->pp_array[entry_index])
     {
@@ -235,7 +302,7 @@ h_table_list (h_table_t * p_h_table)
 
     cll_t * p_h_table_list = cll_init();
 
-    for (int counter = 0; counter < p_h_table->capacity; counter++)
+    for (uint32_t counter = 0; counter < p_h_table->capacity; counter++)
     {
         if (NULL != p_h_table->pp_array[counter])
         {
@@ -345,37 +412,40 @@ h_table_re_hash (h_table_t * p_h_table)
         return SUCCESS;
     }
 
-    cll_t * p_temp_cll = h_table_list(p_h_table);
+    //A hash table's size greatly impacts how often clusters form. when the
+    //size is prime, that clustering happens less often. Both modes roughly
+    //double, so re-hashing stays amortized O(1) per entry.
+    uint32_t new_capacity = 0;
 
-    if (NULL == p_temp_cll)
+    if (H_TABLE_POWER_OF_TWO == p_h_table->sizing)
     {
-        fprintf(stderr, "h_table_re_hash: h_table_list failure\n");
-        return FAILURE;
+        new_capacity = power_of_two_capacity(p_h_table->capacity + 1);
+    }
+    else if (UINT32_MAX != p_h_table->capacity)
+    {
+        new_capacity = prime_capacity(p_h_table->capacity + 1);
     }
 
-    p_h_table->size = 0;
-
-    uint16_t capacity_holder = p_h_table->capacity;
-
-    //A hash table's size greatly impacts how often clusters form. when the
-    //size is prime, that clustering happens less often.
-    p_h_table->capacity = next_prime(capacity_holder);
-
-    if (FAILURE == p_h_table->capacity)
+    //Past the largest 32 bit prime or 2^31 there is nothing to grow to. This
+    //is checked before the entries are taken out of the table.
+    if (0 == new_capacity)
     {
-        fprintf(stderr,"h_table_re_hash: next_prime failure\n");
+        fprintf(stderr, "h_table_re_hash: hash table maximum size exceeded");
         return FAILURE;
     }
 
-    //If the hash table size goes above 65521 (the highest prime number under 
-    //65535) an error will be returned. Since the capacity is uint16_t type, 
-    //it will assign the bits so that the output is lower.
-    if (p_h_table->capacity < capacity_holder)
+    cll_t * p_temp_cll = h_table_list(p_h_table);
+
+    if (NULL == p_temp_cll)
     {
-        fprintf(stderr, "h_table_re_hash: hash table maximum size exceeded");
+        fprintf(stderr, "h_table_re_hash: h_table_list failure\n");
         return FAILURE;
     }
 
+    p_h_table->size = 0;
+    p_h_table->capacity = new_capacity;
+    p_h_table->mask = new_capacity - 1;
+
     p_h_table->pp_array = realloc(p_h_table->pp_array, p_h_table->capacity * 
                                                           sizeof(cll_t *));
 
@@ -460,7 +530,7 @@ h_table_new_entry (h_table_t * p_h_table, void * p_data, const void * p_key)
  * @return void* pointer to specified data. Will return NULL if function fails.
  */
 void *
-h_table_return_entry (h_table_t * p_h_table, void * p_key)
+h_table_return_entry (h_table_t * p_h_table, const void * p_key)
 {
     if ((NULL == p_h_table) ||(NULL == p_key))
     {
@@ -483,7 +553,7 @@ h_table_return_entry (h_table_t * p_h_table, void * p_key)
         return NULL;
     }
 
-    int64_t entry_index = hash % (int64_t)(p_h_table->capacity);
+    uint32_t entry_index = h_table_index(p_h_table, hash);
     
     if (NULL == p_h_table->pp_array[entry_index])
     {
@@ -533,7 +603,7 @@ h_table_free_helper (void * p_data)
  * @return void* pointer to specified data. Returns NULL if function fails.
  */
 void *
-h_table_destroy_entry (h_table_t * p_h_table, void * p_key)
+h_table_destroy_entry (h_table_t * p_h_table, const void * p_key)
 {
     if ((NULL == p_h_table) ||(NULL == p_key))
     {
@@ -556,7 +626,7 @@ h_table_destroy_entry (h_table_t * p_h_table, void * p_key)
         return NULL;
     }
 
-    int64_t entry_index = hash % (int64_t)(p_h_table->capacity);
+    uint32_t entry_index = h_table_index(p_h_table, hash);
     
     if (NULL == p_h_table->pp_array[entry_index])
     {
@@ -630,7 +700,7 @@ h_table_destroy (h_table_t * p_h_table, void (*p_free_function)(void *))
         return FAILURE;
     }
 
-    for (int counter = 0; counter < p_h_table->capacity; counter++)
+    for (uint32_t counter = 0; counter < p_h_table->capacity; counter++)
     {
         if (NULL != p_h_table->pp_array[counter])
         {           
@@ -51,19 +51,29 @@
 
 #endif
 
+//Capacity modes for h_table_init_sized.
+#define H_TABLE_PRIME 0
+#define H_TABLE_POWER_OF_TWO 1
+
 /**
  * @brief Notes on hash table library.
  *
  * Key length is set via macro at 5. This value was selected to plan for a
  * smaller hash table. Set via macro to abstract functionality from user and
  * enable quicker/easier use of library. User-supplied p_key is cast to a char
- * pointer before being cast to int pointer to hash calulcations.
+ * pointer before being cast to int pointer to hash calulcations. The default
+ * hash stops at the first NULL terminator like the key comparisons do, so
+ * bytes after a short key's terminator do not change where it is found.
  *
- * The hash table capacity and size are both uint16_t type. This intentionally
- * limits the size of the hash table and save memory. The maximum size of the
- * hash table is 65535 but the re-hashing function only increases to the next
- * prime number so unless a higher number is given on initialization, the
- * largest size the hash table will reach is 65521.
+ * The hash table capacity and size are both uint32_t type. A table is sized
+ * in one of two modes, chosen when it is initialized. H_TABLE_PRIME takes
+ * the index as hash % capacity and grows through the prime capacity table in
+ * algorithms_lib, which roughly doubles up to 4294967291. H_TABLE_POWER_OF_TWO
+ * rounds the capacity up to a power of two, doubles it on growth and takes
+ * the index by masking the low bits. A mask only sees the low bits of the
+ * hash, so in that mode the hash is first mixed with a finalizer. The mask
+ * avoids a division on every lookup; the prime modulus is more forgiving of
+ * weak user-supplied hash functions.
  * 
  */
 
@@ -85,29 +95,47 @@ typedef struct entry_t {
  * 
  * @param size number of entries in the hash table.
  * @param capacity maximum capacity of the hash table.
+ * @param mask capacity - 1, used for indexing in H_TABLE_POWER_OF_TWO mode.
+ * @param sizing H_TABLE_PRIME or H_TABLE_POWER_OF_TWO.
  * @param p_hash_function pointer to hash function.
  * @param pp_array pointer to array of clls. This functionality enables
  * chaining at each array index.
  */
 typedef struct h_table_t {
-    uint16_t size;
-    uint16_t capacity;
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t mask;
+    uint8_t sizing;
     int64_t (*p_hash_function) (const void *);
     cll_t ** pp_array;
 } h_table_t;
 
 /**
  * @brief Initializes hash table context. Sets hash function and initial size
- * and capacity.
+ * and capacity. The table is sized in H_TABLE_PRIME mode.
  * 
  * @param capacity The user-supplied initial capacity of the hash table.
  * @param p_hash_function user-supplied function for hashing the keys. accepts
  * a const void and returns an int.
  * @return h_table_t* pointer to hash table context structure.
  */
-h_table_t * h_table_init (uint16_t capacity, 
+h_table_t * h_table_init (uint32_t capacity, 
                           int64_t (*p_hash_function) (const void *));
 
+/**
+ * @brief Initializes hash table context with a chosen capacity mode. In
+ * H_TABLE_POWER_OF_TWO mode the capacity is rounded up to a power of two.
+ * 
+ * @param capacity The user-supplied initial capacity of the hash table.
+ * @param p_hash_function user-supplied function for hashing the keys. accepts
+ * a const void and returns an int.
+ * @param sizing H_TABLE_PRIME or H_TABLE_POWER_OF_TWO.
+ * @return h_table_t* pointer to hash table context structure.
+ */
+h_table_t * h_table_init_sized (uint32_t capacity,
+                                int64_t (*p_hash_function) (const void *),
+                                uint8_t sizing);
+
 /**
  * @brief Function that adds new entries to the hash table.
  * 
@@ -126,7 +154,7 @@ int h_table_new_entry (h_table_t * p_h_table, void * p_data,
  * @param p_key pointer to user-supplied key.
  * @return void* pointer to specified data. Will return NULL if function fails.
  */
-void * h_table_return_entry (h_table_t * p_h_table, void * p_key);
+void * h_table_return_entry (h_table_t * p_h_table, const void * p_key);
 
 /**
  * @brief Destroys an entry in the hash table given a key.
@@ -135,7 +163,7 @@ void * h_table_return_entry (h_table_t * p_h_table, void * p_key);
  * @param p_key pointer to user-supplied key.
  * @return void* pointer to specified data. Returns NULL if function fails.
  */
-void * h_table_destroy_entry (h_table_t * p_h_table, void * p_key);
+void * h_table_destroy_entry (h_table_t * p_h_table, const void * p_key);
 
 /**
  * @brief Removes all entries from the hash table and destroys context.
@@ -0,0 +1,63 @@
+#ifndef CR_ALLOC
+#define CR_ALLOC
+
+#include "cr_shared.h"
+
+//NOTE: Small objects the server makes and drops on every connection or
+//message (packages, socket holders, sessions, room worker messages) come
+//from slabs sorted by size class. Each thread allocates from its own cache,
+//and an object freed on another thread goes back to the cache it came from
+//(see slab_lib). Sizes above the largest class go to calloc and free.
+
+//Smallest and largest size class, both powers of two.
+#define ALLOC_MIN_CLASS 16
+#define ALLOC_MAX_CLASS 32768
+
+//Number of classes from ALLOC_MIN_CLASS to ALLOC_MAX_CLASS.
+#define ALLOC_CLASSES 12
+
+//Frees an object from cr_alloc and clears the pointer, as FREE does.
+#define CR_FREE(a) \
+    cr_free((a), sizeof(*(a))); \
+    (a) = NULL
+
+/**
+ * @brief Allocates a zeroed object.
+ *
+ * @param size size of the object.
+ * @return void* pointer to the object. NULL returned on failure.
+ */
+void *
+cr_alloc (size_t size);
+
+/**
+ * @brief Frees an object from cr_alloc. Any thread may free it.
+ *
+ * @param p_object pointer to the object. NULL is ignored.
+ * @param size size passed to cr_alloc.
+ */
+void
+cr_free (void * p_object, size_t size);
+
+/**
+ * @brief Allocates a zeroed object that starts on a cache line, for structs
+ * laid out by cache line (user_t, room_t). Free it with free or FREE.
+ *
+ * @param size size of the object.
+ * @return void* pointer to the object. NULL returned on failure.
+ */
+void *
+cr_alloc_aligned (size_t size);
+
+/**
+ * @brief Reads the counters of every size class added together.
+ *
+ * @param p_stats set to the counters.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_alloc_stats (slab_stats_t * p_stats);
+
+#endif //CR_ALLOC
+
+//End of cr_alloc.h file
@@ -3,20 +3,78 @@
 
 #include "cr_shared.h"
 #include "cr_msg.h"
+#include "cr_stats.h"
+#include "cr_shards.h"
+#include "cr_cluster.h"
+
+//Longest log line: a 20 digit sequence number, a space, the username, '>',
+//the chat, the newline and the terminator.
+#define CHAT_LINE_MAX (20 + 1 + MAX_USERNAME_LENGTH + 1 + MAX_CHAT_LEN + 2)
 
 /**
- * @brief Sends the received chat to all other users in the chat room.
+ * @brief Reads the log of a room loaded from the room catalog the first time
+ * the room is used, and sets the room's chat sequence number from its last
+ * line. Does nothing for a room whose log was already read. A missing log is
+ * created empty.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room_t struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_chats_page_in (room_t * p_room);
+
+/**
+ * @brief Copies the log lines of a room that are newer than a specified
+ * sequence number into a buffer. Lines are stored in sequence order, so the
+ * copy starts at the first line past since and runs to the end of the log.
  * 
  * WARNING: Calling function must lock the room's mutex before use and
  * unlock after use.
  * 
+ * @param p_room pointer to room_t struct.
+ * @param since last sequence number the client holds (0 for all).
+ * @param p_history buffer the log lines are copied into.
+ * @param history_size size of p_history.
+ * @return int number of bytes copied or FAILURE_NEGATIVE (-1).
+ */
+int
+cr_chats_history (room_t * p_room, uint64_t since, char * p_history,
+                                                     size_t history_size);
+
+/**
+ * @brief Sends the received chat to all other users in the chat room.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room the client is in.
+ * @param p_user pointer to current user struct.
+ * @param p_chat message received from the client.
+ * @param seq room sequence number of the chat (0 for room notices).
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_chats_chat_send (room_t * p_room, user_t * p_user, char * p_chat,
+                                                        uint64_t seq);
+
+/**
+ * @brief Gives a chat the room's next sequence number, adds it to the log
+ * file, sends it to all other users in the room and acknowledges it to the
+ * sender.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
  * @param p_room pointer to room the client is in.
  * @param p_user pointer to current user struct.
  * @param p_chat message received from the client.
  * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
  */
 int
-cr_chats_chat_send (room_t * p_room, user_t * p_user, char * p_chat);
+cr_chats_chat_room (room_t * p_room, user_t * p_user, char * p_chat);
 
 /**
  * @brief Upon receiving client chat packet, adds the chat to the log file
@@ -30,6 +88,19 @@ cr_chats_chat_send (room_t * p_room, user_t * p_user, char * p_chat);
 int
 cr_chats_chat (rooms_t * p_rooms, user_t * p_user, char * p_buffer);
 
+/**
+ * @brief Removes a user from a room and tells the other users they left.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room_t struct.
+ * @param p_user specified user.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_chats_leave_room (room_t * p_room, user_t * p_user);
+
 /**
  * @brief removes the user from the specified chat room and sets the chatting
  * tracker to NOT_CHATTING.
@@ -48,6 +119,21 @@ int
 cr_chats_leave (rooms_t * p_rooms, int * p_chatting, user_t * p_user,
                                       SSL * p_ssl, int send_message);
 
+/**
+ * @brief Logs a chat sent on another cluster node and sends it to every
+ * member of the room here. The chat gets this node's next sequence number
+ * for the room.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @param p_username sender's username.
+ * @param p_chat chat text.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_chats_remote (rooms_t * p_rooms, char * p_room_name, char * p_username,
+                                                          char * p_chat);
+
 #endif //CR_CHATS
 
 //End of cr_chats.h file
@@ -0,0 +1,135 @@
+#ifndef CR_CLUSTER
+#define CR_CLUSTER
+
+#include <poll.h>
+
+#include "cr_shared.h"
+
+//NOTE: Cluster bus. Several chat_room processes listed in cluster.txt share
+//users and rooms. Each node dials every other node and sends it frames on
+//that connection only, so every pair of nodes is joined by two one-way TCP
+//connections. Registrations, user deletions, and room creations and
+//deletions go to every node. A chat goes only to the nodes that have
+//members in its room, which each node announces with subscribe and
+//unsubscribe frames. A node that reconnects is sent every room, user and
+//subscription again, so nodes started at different times converge.
+//
+//The bus only takes connections from the addresses in cluster.txt, and runs
+//over TLS with a certificate at both ends: each node presents server.crt
+//and server.key, and only accepts peers whose certificate chains to
+//cluster_ca.crt, which may also hold the nodes' own certificates. A node
+//dials from its own address in cluster.txt and must say hello with the id
+//listed for that address.
+//
+//WARNING: Logins are not shared. Each node only refuses a second login of
+//an account it holds itself, so the same account can be logged in on two
+//nodes at once, and its chats are sent from both.
+
+//Node ids run from 1 to CLUSTER_MAX_NODES. Zero leaves clustering off.
+#define CLUSTER_MAX_NODES 16
+#define CLUSTER_OFF 0
+
+//Rooms the routing table can follow, the local rooms and rooms only peers
+//have heard of.
+#define CLUSTER_MAX_ROOMS (MAX_TOTAL_ROOMS * 2)
+
+//Frames waiting to be written to one peer. Frames past this are dropped
+//until the peer catches up.
+#define CLUSTER_SEND_SIZE (BUFF_SIZE * 64)
+
+//Largest frame, and the read buffer for each peer.
+#define CLUSTER_FRAME_MAX 512
+#define CLUSTER_RECV_SIZE (BUFF_SIZE * 16)
+
+//Time between attempts to reach a peer that is down.
+#define CLUSTER_RETRY_MS 1000
+
+//Time a connection gets to finish its handshake and say hello.
+#define CLUSTER_HELLO_MS 3000
+
+/**
+ * @brief Reads cluster.txt, starts listening for peers on this node's
+ * address, and starts dialing every other node.
+ *
+ * @param node_id this node's id in cluster.txt. CLUSTER_OFF leaves
+ * clustering off.
+ * @param p_users pointer to users_t struct, remote registrations are added.
+ * @param p_rooms pointer to rooms_t struct, remote rooms are added.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_cluster_start (uint8_t node_id, users_t * p_users, rooms_t * p_rooms);
+
+/**
+ * @brief Stops the bus threads and closes every peer connection. Must be
+ * called before the thread pool is destroyed, which frees the users and rooms
+ * mutexes the receiver takes. Frames published after this are dropped.
+ */
+void
+cr_cluster_stop ();
+
+/**
+ * @brief Tells every peer a room was created here.
+ *
+ * @param p_room_name room name.
+ */
+void
+cr_cluster_room_add (const char * p_room_name);
+
+/**
+ * @brief Tells every peer a room was deleted here.
+ *
+ * @param p_room_name room name.
+ */
+void
+cr_cluster_room_del (const char * p_room_name);
+
+/**
+ * @brief Tells every peer a user registered here.
+ *
+ * @param p_username username.
+ * @param p_password password.
+ */
+void
+cr_cluster_user_add (const char * p_username, char * p_password);
+
+/**
+ * @brief Tells every peer a user was deleted here.
+ *
+ * @param p_username username.
+ */
+void
+cr_cluster_user_del (const char * p_username);
+
+/**
+ * @brief Counts a local member joining a room. The first one subscribes
+ * this node to the room's chats on every peer.
+ *
+ * @param p_room_name room name.
+ */
+void
+cr_cluster_room_joined (const char * p_room_name);
+
+/**
+ * @brief Counts a local member leaving a room. The last one unsubscribes
+ * this node from the room's chats on every peer.
+ *
+ * @param p_room_name room name.
+ */
+void
+cr_cluster_room_left (const char * p_room_name);
+
+/**
+ * @brief Sends a chat sent here to the peers that have members in its room.
+ *
+ * @param p_room_name room name.
+ * @param p_username sender's username.
+ * @param p_chat chat text.
+ */
+void
+cr_cluster_chat (const char * p_room_name, const char * p_username,
+                                                 char * p_chat);
+
+#endif //CR_CLUSTER
+
+//End of cr_cluster.h file
@@ -0,0 +1,77 @@
+#ifndef CR_COMPRESS
+#define CR_COMPRESS
+
+#include <zlib.h>
+
+#include "cr_shared.h"
+#include "cr_msg.h"
+
+//Compression algorithms. Only v2 connections can use compression, the
+//compressed payloads rely on the frame length.
+#define COMPRESS_NONE 0
+#define COMPRESS_ZLIB 1
+
+//zlib levels. Zero turns compression off for every connection.
+#define DEFAULT_COMPRESS_LEVEL 6
+#define MAX_COMPRESS_LEVEL 9
+
+/**
+ * @brief Sets the level used for every compressed payload.
+ *
+ * @param level zlib level, 0 (compression off) to 9.
+ * @return int SUCCESS (0) or FAILURE (1) if the level is out of range.
+ */
+int
+cr_compress_set_level (int level);
+
+/**
+ * @brief Returns the level in use.
+ *
+ * @return int zlib level, zero if compression is off.
+ */
+int
+cr_compress_level ();
+
+/**
+ * @brief Compresses a payload with zlib, primed with the chat text
+ * dictionary shared with the client.
+ *
+ * @param p_input bytes to compress.
+ * @param input_len number of bytes to compress.
+ * @param p_output buffer the compressed bytes are written to.
+ * @param output_size size of p_output.
+ * @return int length of the compressed bytes or FAILURE_NEGATIVE (-1).
+ */
+int
+cr_compress_deflate (const char * p_input, size_t input_len, char * p_output,
+                                                         size_t output_size);
+
+/**
+ * @brief Decompresses a payload made by cr_compress_deflate.
+ *
+ * @param p_input compressed bytes.
+ * @param input_len number of compressed bytes.
+ * @param p_output buffer the original bytes are written to.
+ * @param output_size size of p_output.
+ * @return int length of the original bytes or FAILURE_NEGATIVE (-1).
+ */
+int
+cr_compress_inflate (const char * p_input, size_t input_len, char * p_output,
+                                                         size_t output_size);
+
+/**
+ * @brief Handles compression requests. Acknowledges zlib if the client asked
+ * for it, the connection is on v2, and compression is on; otherwise
+ * acknowledges no compression.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_buffer pointer to buffer with received message.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_compress_negotiate (session_t * p_session, SSL * p_ssl, char * p_buffer);
+
+#endif //CR_COMPRESS
+
+//End of cr_compress.h file
@@ -0,0 +1,62 @@
+#ifndef CR_FLUSH
+#define CR_FLUSH
+
+#include "cr_shared.h"
+#include "cr_msg.h"
+#include "cr_metrics.h"
+#include <poll.h>
+
+/**
+ * @brief Starts the flusher thread. Sessions scheduled with
+ * cr_flush_schedule have their send buffers written once the window has
+ * passed, so chat updates from busy rooms share TLS records.
+ *
+ * @param window_ms flush window in milliseconds. Zero leaves the flusher
+ * stopped and every write goes out at once.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_flush_start (uint16_t window_ms);
+
+/**
+ * @brief Flushes anything still pending, stops the flusher thread, and
+ * prints the write counters.
+ */
+void
+cr_flush_stop ();
+
+/**
+ * @brief Returns the flush window in use.
+ *
+ * @return uint16_t window in milliseconds, zero if the flusher is stopped.
+ */
+uint16_t
+cr_flush_window ();
+
+/**
+ * @brief Queues a session whose send buffer holds unsent packets. The
+ * flusher writes it at the end of the current window.
+ *
+ * WARNING: Must not be called while holding the session's send mutex.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_flush_schedule (session_t * p_session);
+
+/**
+ * @brief Removes a session from the flusher's queue, waiting for the flusher
+ * if it is writing the session. Must be called after the session has left
+ * its room, so no broadcaster can queue it again, and before the session's
+ * SSL struct or the session itself is freed.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_flush_cancel (session_t * p_session);
+
+#endif //CR_FLUSH
+
+//End of cr_flush.h file
@@ -0,0 +1,107 @@
+#ifndef CR_FRAME
+#define CR_FRAME
+
+#include "cr_shared.h"
+#include "cr_msg.h"
+
+//Protocol versions. v1 packets are the fixed size structs in cr_msg.h and
+//one SSL_read is one packet. v2 prefixes every packet with its length as a
+//varint and packs variable length fields as a varint length plus bytes.
+#define PROTOCOL_V1 1
+#define PROTOCOL_V2 2
+#define PROTOCOL_MAX PROTOCOL_V2
+
+//NOTE: A v1 connection that has not sent a version request. Only these are
+//taken to be older clients whose join requests have no since field.
+#define PROTOCOL_LEGACY 0
+
+//Largest payload accepted from a client and largest frame sent to one (a
+//join acknowledge with a full room log).
+#define MAX_REQUEST_LENGTH BUFF_SIZE
+#define MAX_FRAME_LENGTH (BUFF_SIZE + MAX_CHAT_FILE_SIZE)
+
+//An unsigned 64-bit value never takes more than 10 varint bytes.
+#define MAX_VARINT_LENGTH 10
+
+//Return values for cr_frame_next.
+#define FRAME_INCOMPLETE 6
+#define FRAME_INVALID 7
+#define FRAME_CORRUPT 8
+
+/**
+ * @brief Writes an unsigned value as a little endian base 128 varint.
+ * 
+ * @param p_buffer buffer the varint is written to.
+ * @param buffer_size space left in p_buffer.
+ * @param value value to write.
+ * @return int number of bytes written or FAILURE_NEGATIVE (-1) if the
+ * buffer is too small.
+ */
+int
+cr_frame_put_varint (char * p_buffer, size_t buffer_size, uint64_t value);
+
+/**
+ * @brief Reads an unsigned little endian base 128 varint.
+ * 
+ * @param p_buffer buffer the varint is read from.
+ * @param buffer_len number of bytes available in p_buffer.
+ * @param p_value pointer the value is written to.
+ * @return int number of bytes read, 0 if the varint is not complete yet, or
+ * FAILURE_NEGATIVE (-1) if it is longer than MAX_VARINT_LENGTH.
+ */
+int
+cr_frame_get_varint (const char * p_buffer, size_t buffer_len,
+                                             uint64_t * p_value);
+
+/**
+ * @brief Converts a v1 packet built by the cr_msg functions to a v2 frame.
+ * 
+ * @param p_packet v1 packet.
+ * @param packet_len length of the v1 packet.
+ * @param p_frame buffer the frame is written to.
+ * @param frame_size size of p_frame.
+ * @param compression compression algorithm of the connection, used for the
+ * room history and room list.
+ * @return int length of the frame or FAILURE_NEGATIVE (-1).
+ */
+int
+cr_frame_encode (const char * p_packet, size_t packet_len, char * p_frame,
+                                   size_t frame_size, uint8_t compression);
+
+/**
+ * @brief Takes the next complete packet out of the session's receive buffer
+ * and writes it to p_packet in the v1 layout the request handlers read. In
+ * v1 everything received is one packet, in v2 one frame is taken at a time.
+ * 
+ * @param p_session pointer to the connection's session_t struct.
+ * @param p_packet zeroed buffer of at least BUFF_SIZE bytes.
+ * @return int SUCCESS (0) if a packet was written, FRAME_INCOMPLETE (6) if
+ * more bytes are needed, FRAME_INVALID (7) if a frame was skipped because its
+ * fields were malformed, or FRAME_CORRUPT (8) if the stream can't be read.
+ */
+int
+cr_frame_next (session_t * p_session, char * p_packet);
+
+/**
+ * @brief Moves unread bytes to the front of the session's receive buffer.
+ * 
+ * @param p_session pointer to the connection's session_t struct.
+ */
+void
+cr_frame_compact (session_t * p_session);
+
+/**
+ * @brief Handles protocol version requests. Acknowledges the highest version
+ * both sides support and switches the connection to it.
+ * 
+ * @param p_session pointer to the connection's session_t struct.
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_buffer pointer to buffer with received message.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_frame_negotiate (session_t * p_session, SSL * p_ssl, char * p_buffer);
+
+#endif //CR_FRAME
+
+//End of cr_frame.h file
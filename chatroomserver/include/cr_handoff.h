@@ -0,0 +1,146 @@
+#ifndef CR_HANDOFF
+#define CR_HANDOFF
+
+#include <poll.h>
+#include <sys/un.h>
+
+#include "cr_shared.h"
+
+//NOTE: Hot restart. A server started with hot restart on listens on a Unix
+//socket in its working directory. A new server process started in the same
+//directory connects to it and takes over: the old process passes its
+//listening sockets, every live client connection (SCM_RIGHTS) and the state
+//that goes with them, then exits without touching the rooms directory.
+//OpenSSL can not export a connection's TLS state, so the old process ends
+//TLS on each connection after a resume notice and the client runs a new
+//handshake with the new process on the same TCP connection. Clients stay
+//logged in and in their rooms, and nothing they sent is lost.
+
+#define HANDOFF_OFF 0
+#define HANDOFF_ON 1
+
+#define HANDOFF_FILENAME "chat_room.sock"
+
+//Layout of the messages between the two processes. A build only hands over
+//to a build with the same version and message size.
+#define HANDOFF_VERSION 1
+
+//Longest wait for the sessions to stop reading (they wake every 3 seconds),
+//and for the old process to hand everything over and exit.
+#define HANDOFF_PARK_MS 10000
+#define HANDOFF_TAKE_MS 30000
+
+//Time all the sessions together wait for their clients to answer the resume
+//notice, counted from when the notices go out. A client that does not is
+//closed and has to connect again. Kept well under the 5 seconds a client
+//waits for the new process to answer its handshake.
+#define HANDOFF_DRAIN_MS 1000
+
+/**
+ * @brief Takes over from a running server in the same directory, if there is
+ * one. Waits until the old process has handed over its rooms, sessions and
+ * listening sockets and has exited. The rooms are added to p_rooms, the
+ * sessions and listening sockets are kept for cr_handoff_next_session and
+ * cr_handoff_listeners.
+ *
+ * @param hot_restart HANDOFF_ON to look for a running server.
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_taken set to 1 if a server was taken over, 0 if not.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_handoff_take (uint8_t hot_restart, rooms_t * p_rooms, int * p_taken);
+
+/**
+ * @brief Returns the listening sockets taken over from the old process.
+ *
+ * @param p_socket_fds array of MAX_ACCEPTORS to fill.
+ * @return int number of sockets, 0 if nothing was taken over.
+ */
+int
+cr_handoff_listeners (int * p_socket_fds);
+
+/**
+ * @brief Returns the next session taken over from the old process. The
+ * caller owns the returned record.
+ *
+ * @param p_client_fd set to the session's connection.
+ * @return handoff_session_t * the session's state, NULL when there are no
+ * more.
+ */
+handoff_session_t *
+cr_handoff_next_session (int * p_client_fd);
+
+/**
+ * @brief Starts listening for a new server process that wants to take over.
+ *
+ * @param hot_restart HANDOFF_ON to listen, HANDOFF_OFF does nothing.
+ * @param p_rooms pointer to rooms_t struct, whose rooms are handed over.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_handoff_start (uint8_t hot_restart, rooms_t * p_rooms);
+
+/**
+ * @brief Stops listening for a new server process. After a handover this
+ * closes the connection the new process waits on, so it must be the last
+ * thing the old process does before exiting.
+ */
+void
+cr_handoff_stop ();
+
+/**
+ * @brief Adds a listening socket to the ones handed over.
+ *
+ * @param socket_fd listening socket.
+ */
+void
+cr_handoff_listener (int socket_fd);
+
+/**
+ * @brief Counts sessions handed to the thread pool and sessions that ended,
+ * so the handover knows how many to wait for.
+ *
+ * @param change 1 for a new session, -1 for one that ended.
+ */
+void
+cr_handoff_session_add (int change);
+
+/**
+ * @brief Returns whether this process is being taken over.
+ *
+ * @return int 1 once a new process has started taking over, 0 if not.
+ */
+int
+cr_handoff_active ();
+
+/**
+ * @brief Returns whether this process handed everything over, in which case
+ * the rooms directory now belongs to the new process.
+ *
+ * @return int 1 if handed over, 0 if not.
+ */
+int
+cr_handoff_done ();
+
+/**
+ * @brief Hands a session that stopped reading over to the new process. Waits
+ * for every other session to stop, sends the client the resume notice, ends
+ * TLS, and passes the connection with its login, room, protocol state and
+ * unhandled input. Waits until the handover is finished.
+ *
+ * @param p_cr_package pointer to the session's package.
+ * @param logged_in whether the user is logged in.
+ * @param chatting whether the user is in a room.
+ * @param p_user pointer to the logged in user, NULL if not logged in.
+ * @return int SUCCESS (0) if the session is over and must only be freed
+ * (handed over, or dropped), FAILURE (1) if the handover was abandoned and
+ * the session must leave its room and log out as usual.
+ */
+int
+cr_handoff_session (cr_package_t * p_cr_package, int logged_in, int chatting,
+                                                             user_t * p_user);
+
+#endif //CR_HANDOFF
+
+//End of cr_handoff.h file
@@ -8,6 +8,20 @@
 #define CLEAN 0
 #define DONT_CLEAN 1
 
+//One accept loop. With more than one loop each runs on its own thread with
+//its own SO_REUSEPORT socket.
+typedef struct {
+    pthread_t   thread;
+    int         socket_fd;
+    int         cpu; //NOTE: Core the loop and its sessions run on, NO_CPU
+                     //when unpinned.
+    int         return_val;
+    SSL_CTX   * p_ssl_ctx;
+    rooms_t   * p_rooms;
+    users_t   * p_users;
+    t_pool_t  * p_t_pool;
+} cr_acceptor_t;
+
 /**
  * @brief Creates shared structures and thread pool for the server to being listening.
  * Starts listening funciton.
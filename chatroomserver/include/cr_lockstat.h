@@ -0,0 +1,113 @@
+#ifndef CR_LOCKSTAT
+#define CR_LOCKSTAT
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "cr_trace.h"
+
+//NOTE: Lock profiling is built in with cmake -DLOCK_PROFILE=1. Without it
+//CR_MUTEX_LOCK and CR_MUTEX_UNLOCK only add the flight recorder's lock events
+//to the pthread calls and the start and stop functions do nothing.
+
+//Locks one thread can hold at once and still have their hold time measured.
+#define LOCKSTAT_DEPTH 8
+
+//Maximum lock sites printed in a summary.
+#define LOCKSTAT_MAX_SITES 128
+
+#ifdef CR_LOCK_PROFILE
+
+//NOTE: One per CR_MUTEX_LOCK call site, so every room's room_mutex taken in
+//the same function is counted together. Sites link themselves into a list the
+//first time they are used.
+typedef struct cr_lock_site {
+    const char *          p_lock;
+    const char *          p_function;
+    int                   line;
+    int                   registered;
+    uint64_t              acquisitions;
+    uint64_t              contended;
+    uint64_t              wait_ns;
+    uint64_t              wait_max_ns;
+    uint64_t              hold_ns;
+    uint64_t              hold_max_ns;
+    struct cr_lock_site * p_next;
+    cr_trace_site_t       trace_site;
+} cr_lock_site_t;
+
+#define CR_MUTEX_LOCK(p_mutex)                                              \
+    __extension__ ({                                                        \
+        static cr_lock_site_t lock_site = {#p_mutex, __func__, __LINE__,   \
+                                           0, 0, 0, 0, 0, 0, 0, NULL,      \
+                            {#p_mutex, __func__, __LINE__, 0, 0}};         \
+        cr_lockstat_lock(&lock_site, (p_mutex));                           \
+    })
+
+#define CR_MUTEX_UNLOCK(p_mutex) cr_lockstat_unlock(p_mutex)
+
+/**
+ * @brief Locks a mutex, counting the acquisition against its call site and
+ * timing the wait if the mutex was already held. Used through
+ * CR_MUTEX_LOCK.
+ *
+ * @param p_site call site record.
+ * @param p_mutex mutex to lock.
+ * @return int result of pthread_mutex_lock.
+ */
+int
+cr_lockstat_lock (cr_lock_site_t * p_site, pthread_mutex_t * p_mutex);
+
+/**
+ * @brief Unlocks a mutex and adds how long it was held to the site that
+ * locked it. Used through CR_MUTEX_UNLOCK.
+ *
+ * @param p_mutex mutex to unlock.
+ * @return int result of pthread_mutex_unlock.
+ */
+int
+cr_lockstat_unlock (pthread_mutex_t * p_mutex);
+
+#else
+
+#define CR_MUTEX_LOCK(p_mutex)                                              \
+    __extension__ ({                                                        \
+        static cr_trace_site_t trace_site = {#p_mutex, __func__, __LINE__, \
+                                             0, 0};                        \
+        cr_trace_lock(&trace_site, (p_mutex));                             \
+    })
+
+#define CR_MUTEX_UNLOCK(p_mutex) cr_trace_unlock(p_mutex)
+
+#endif //CR_LOCK_PROFILE
+
+/**
+ * @brief Starts the thread that prints the lock summary on SIGUSR1. Blocks
+ * SIGUSR1 in the calling thread, so it must be called before any other
+ * thread is created.
+ *
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_lockstat_start ();
+
+/**
+ * @brief Stops the summary thread and prints a last summary.
+ */
+void
+cr_lockstat_stop ();
+
+/**
+ * @brief Prints every lock site: acquisitions, how many found the lock
+ * held, total and worst wait, and average and worst hold. Sites are sorted
+ * by total wait.
+ *
+ * @param p_file stream to write to.
+ */
+void
+cr_lockstat_print (FILE * p_file);
+
+#endif //CR_LOCKSTAT
+
+//End of cr_lockstat.h file
@@ -0,0 +1,97 @@
+#ifndef CR_LOG
+#define CR_LOG
+
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+
+//Levels, lowest first.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+//Records each thread can hold before the drain thread empties them. Must be
+//a power of two.
+#define LOG_RING_RECORDS 128
+
+//Longest message kept, longer messages are cut.
+#define LOG_MESSAGE_SIZE 232
+
+//Messages one call site may log per LOG_BURST_NS before the rest are only
+//counted.
+#define LOG_BURST 10
+#define LOG_BURST_NS 1000000000ULL
+
+//How often the drain thread empties the rings.
+#define LOG_DRAIN_MS 20
+
+//NOTE: One per CR_LOG_* call site, for rate limiting. Declared static by the
+//macros below, so it is zeroed before first use.
+typedef struct {
+    uint64_t window_ns;
+    uint32_t count;
+    uint32_t suppressed;
+} cr_log_site_t;
+
+#define CR_LOG_AT(level, error, ...)                                        \
+    do {                                                                    \
+        static cr_log_site_t log_site;                                      \
+        cr_log_write(&log_site, (level), (error), __VA_ARGS__);             \
+    } while (0)
+
+#define CR_LOG_DEBUG(...) CR_LOG_AT(LOG_LEVEL_DEBUG, 0, __VA_ARGS__)
+#define CR_LOG_INFO(...) CR_LOG_AT(LOG_LEVEL_INFO, 0, __VA_ARGS__)
+#define CR_LOG_WARN(...) CR_LOG_AT(LOG_LEVEL_WARN, 0, __VA_ARGS__)
+#define CR_LOG_ERROR(...) CR_LOG_AT(LOG_LEVEL_ERROR, 0, __VA_ARGS__)
+
+//NOTE: Replaces perror: the message is followed by ": " and the text of the
+//current errno.
+#define CR_LOG_ERRNO(...) CR_LOG_AT(LOG_LEVEL_ERROR, errno, __VA_ARGS__)
+
+/**
+ * @brief Formats a message into the calling thread's ring for the drain
+ * thread to write. Never blocks: a full ring drops the message and counts
+ * it. Before cr_log_start and after cr_log_stop the message is written
+ * straight to the sink. Used through the CR_LOG_* macros.
+ *
+ * @param p_site call site, for rate limiting.
+ * @param level message level (LOG_LEVEL_DEBUG ...).
+ * @param error errno to append, 0 for none.
+ * @param p_format printf format.
+ */
+void
+cr_log_write (cr_log_site_t * p_site, uint8_t level, int error,
+              const char * p_format, ...)
+              __attribute__ ((format (printf, 4, 5)));
+
+/**
+ * @brief Starts the drain thread. Messages are written as JSON lines to
+ * p_sink.
+ *
+ * @param p_sink stream to write to, NULL for stderr.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_log_start (FILE * p_sink);
+
+/**
+ * @brief Writes everything still buffered, stops the drain thread, and frees
+ * every thread's ring. Must be called after the threads logging have
+ * stopped.
+ */
+void
+cr_log_stop ();
+
+/**
+ * @brief Sets the lowest level written. Messages below it are dropped at the
+ * call site.
+ *
+ * @param level lowest level (LOG_LEVEL_DEBUG ...).
+ */
+void
+cr_log_set_level (uint8_t level);
+
+#endif //CR_LOG
+
+//End of cr_log.h file
@@ -3,6 +3,7 @@
 
 #include "cr_shared.h"
 #include "cr_listener.h"
+#include "cr_compress.h"
 #include "../cll_lib/cll.h"
 
 /**
@@ -0,0 +1,124 @@
+#ifndef CR_METRICS
+#define CR_METRICS
+
+#include <poll.h>
+#include <time.h>
+
+#include "cr_shared.h"
+#include "cr_msg.h"
+
+//Requests are counted per packet type (rooms to session) and sub type. The
+//last key holds anything outside that range.
+#define METRIC_TYPES 4
+#define METRIC_STYPES 16
+#define METRIC_KEYS ((METRIC_TYPES * METRIC_STYPES) + 1)
+
+//Latency buckets: below 1.024 us, then two per power of two up to ~17 s,
+//then everything slower.
+#define METRIC_MIN_SHIFT 10
+#define METRIC_OCTAVES 24
+#define METRIC_BUCKETS ((METRIC_OCTAVES * 2) + 2)
+
+//Counters.
+#define METRIC_FRAME_INVALID 0
+#define METRIC_FRAME_CORRUPT 1
+#define METRIC_HANDSHAKE_FAILED 2
+#define METRIC_COUNTERS 3
+
+//Gauges.
+#define METRIC_SESSIONS 0
+#define METRIC_SESSIONS_WAITING 1
+#define METRIC_FLUSH_PENDING 2
+#define METRIC_GAUGES 3
+
+//Largest request read from a metrics client.
+#define METRIC_REQUEST_SIZE 1024
+
+/**
+ * @brief Starts the metrics endpoint: a plain HTTP server on 127.0.0.1 that
+ * answers GET /metrics in the Prometheus text format. Recording is off until
+ * the endpoint is started.
+ *
+ * @param port port to listen on. Zero leaves metrics off.
+ * @param p_users pointer to users_t struct, read for the user gauges.
+ * @param p_rooms pointer to rooms_t struct, read for the room gauge.
+ * @param p_t_pool pointer to the thread pool, read for the task queue gauge.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_metrics_start (uint16_t port, users_t * p_users, rooms_t * p_rooms,
+                                                  t_pool_t * p_t_pool);
+
+/**
+ * @brief Stops the metrics endpoint and frees every thread's counters. Must
+ * be called after the threads recording metrics have stopped.
+ */
+void
+cr_metrics_stop ();
+
+/**
+ * @brief Returns CLOCK_MONOTONIC in nanoseconds, for timing what is
+ * recorded.
+ *
+ * @return uint64_t current time.
+ */
+uint64_t
+cr_metrics_now ();
+
+/**
+ * @brief Records a handled request and how long it took.
+ *
+ * @param type packet type of the request.
+ * @param s_type packet sub type of the request.
+ * @param elapsed_ns time from dispatch to response in nanoseconds.
+ */
+void
+cr_metrics_request (uint8_t type, uint8_t s_type, uint64_t elapsed_ns);
+
+/**
+ * @brief Records a completed TLS handshake.
+ *
+ * @param elapsed_ns time from accept to the end of the handshake.
+ * @param failures handshakes that failed before this one.
+ */
+void
+cr_metrics_handshake (uint64_t elapsed_ns, uint32_t failures);
+
+/**
+ * @brief Adds one to a counter.
+ *
+ * @param counter counter to add to (METRIC_FRAME_INVALID ...).
+ */
+void
+cr_metrics_count (int counter);
+
+/**
+ * @brief Moves a gauge up or down.
+ *
+ * @param gauge gauge to change (METRIC_SESSIONS ...).
+ * @param delta amount to add, negative to subtract.
+ */
+void
+cr_metrics_gauge_add (int gauge, int64_t delta);
+
+/**
+ * @brief Returns a gauge's value.
+ *
+ * @param gauge gauge to read (METRIC_SESSIONS ...).
+ * @return int64_t current value, 0 for an unknown gauge.
+ */
+int64_t
+cr_metrics_gauge (int gauge);
+
+/**
+ * @brief Writes every metric in the Prometheus text format.
+ *
+ * @param p_file stream to write to.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_metrics_render (FILE * p_file);
+
+#endif //CR_METRICS
+
+//End of cr_metrics.h file
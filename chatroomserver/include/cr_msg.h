@@ -24,6 +24,10 @@
 #define LEAVE_STYPE 10
 #define LOGOUT_STYPE 11
 #define QUIT_STYPE 12
+#define VERSION_STYPE 13
+#define COMPRESS_STYPE 14
+#define STATS_STYPE 15
+#define RESUME_STYPE 16
 
 //OPCODES
 #define REQUEST 0
@@ -136,14 +140,29 @@ typedef struct {
     char    p_room_name[MAX_ROOM_NAME_LENGTH + 1];
 } room_d_req_t;
 
-//Room Join packets.
+//Room Join packets. since holds the last chat sequence number the client has
+//seen in the room (network byte order). Zero, or a short packet from an older
+//client, requests the whole room history.
 typedef struct {
-    uint8_t type;
-    uint8_t s_type;
-    uint8_t opcode;
-    char    p_room_name[MAX_ROOM_NAME_LENGTH + 1];
+    uint8_t  type;
+    uint8_t  s_type;
+    uint8_t  opcode;
+    char     p_room_name[MAX_ROOM_NAME_LENGTH + 1];
+    uint64_t since;
 } join_req_t;
 
+//Room Join acknowledge header. seq is the room's latest chat sequence number
+//and history_len the number of log bytes that follow the header. Only log
+//lines newer than the requested since value are sent. Legacy connections get
+//an acknowledge_t followed by the history lines without sequence numbers.
+typedef struct {
+    uint8_t  type;
+    uint8_t  s_type;
+    uint8_t  opcode;
+    uint64_t seq;
+    uint16_t history_len;
+} join_ack_t;
+
 typedef struct {
     uint8_t type;
     uint8_t s_type;
@@ -151,39 +170,148 @@ typedef struct {
     char    p_chat[MAX_USERNAME_LENGTH + MAX_CHAT_LEN + 2];
 } chat_t;
 
+//Chat update packets (server to client). seq is the chat's room sequence
+//number (network byte order); room notices that are not logged carry zero.
+//The sender of a chat is sent it back with the RESPONSE opcode.
+//Legacy connections are sent chat_t instead, which has no seq.
+typedef struct {
+    uint8_t  type;
+    uint8_t  s_type;
+    uint8_t  opcode;
+    uint64_t seq;
+    char     p_chat[MAX_USERNAME_LENGTH + MAX_CHAT_LEN + 2];
+} chat_update_t;
+
+//Protocol version packets (request and acknowledge). Always sent in the
+//framing in use when the request is received.
+typedef struct {
+    uint8_t type;
+    uint8_t s_type;
+    uint8_t opcode;
+    uint8_t version;
+} version_t;
+
+//Compression packets (request and acknowledge). The request carries the
+//algorithm the client supports, the acknowledge the one the server will use.
+typedef struct {
+    uint8_t type;
+    uint8_t s_type;
+    uint8_t opcode;
+    uint8_t algorithm;
+} compress_t;
+
+//Stats acknowledge. The fixed part is followed by room_count stats_room_t
+//entries, busiest room first. Rates are counts over the last rate_window_s
+//whole seconds.
+typedef struct {
+    uint8_t  type;
+    uint8_t  s_type;
+    uint8_t  opcode;
+    uint32_t uptime_s;
+    uint16_t sessions;
+    uint16_t sessions_waiting; //NOTE: Accepted connections waiting for a
+                               //pool thread (task queue depth).
+    uint16_t flush_pending;    //NOTE: Sessions queued on the flusher.
+    uint16_t pool_threads;
+    uint16_t dispatch_permille; //NOTE: Share of the pool's time spent
+                                //handling requests.
+    uint16_t users_logged_in;
+    uint8_t  rate_window_s;
+    uint32_t requests_window;
+    uint32_t chats_window;
+    uint64_t requests_total;
+    uint64_t chats_total;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint8_t  room_count;
+} stats_ack_t;
+
+typedef struct {
+    char     p_room_name[MAX_ROOM_NAME_LENGTH + 1];
+    uint16_t members;
+    uint32_t chats_window;
+    uint64_t chats_total;
+} stats_room_t;
+
 #pragma pack(pop)
 
 /**
- * @brief Creates a rejection packet.
+ * @brief Starts batching writes to the client. Packets sent to the
+ * connection are gathered until cr_msg_flush is called.
  * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_msg_batch (SSL * p_ssl);
+
+/**
+ * @brief Stops batching and writes everything gathered since cr_msg_batch
+ * to the client in a single write.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_flush (SSL * p_ssl);
+
+/**
+ * @brief Writes packets waiting in the session's send buffer unless the
+ * session's own thread is batching, in which case its flush sends them.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_flush_pending (SSL * p_ssl);
+
+/**
+ * @brief Reads the write counters: packets sent to clients and the TLS
+ * records (SSL_write calls) used to send them.
+ * 
+ * @param p_messages set to the number of packets written.
+ * @param p_records set to the number of records written.
+ */
+void
+cr_msg_write_stats (uint64_t * p_messages, uint64_t * p_records);
+
+/**
+ * @brief Fills in a rejection packet.
+ * 
+ * @param p_rejection pointer to the packet, usually on the caller's stack.
  * @param type packet type.
  * @param sub_type packet sub type.
  * @param rej_code rejection code.
- * @return rejection_t* returns a pointer to the packet.
+ * @return int SUCCESS (0) or FAILURE (1).
  */
-rejection_t *
-cr_msg_create_rej (uint8_t type, uint8_t sub_type, uint8_t rej_code);
+int
+cr_msg_create_rej (rejection_t * p_rejection, uint8_t type,
+                         uint8_t sub_type, uint8_t rej_code);
 
 /**
- * @brief Creates an acknowledge packet.
+ * @brief Fills in an acknowledge packet.
  * 
+ * @param p_acknowledge pointer to the packet, usually on the caller's stack.
  * @param type packet type.
  * @param sub_type packet sub type.
- * @return acknowledge_t* returns a pointer to the packet.
+ * @return int SUCCESS (0) or FAILURE (1).
  */
-acknowledge_t *
-cr_msg_create_ack (uint8_t type, uint8_t sub_type);
+int
+cr_msg_create_ack (acknowledge_t * p_acknowledge, uint8_t type,
+                                                 uint8_t sub_type);
 
 /**
- * @brief Creates a chat update packet.
+ * @brief Fills in a chat update packet.
  * 
- * @param p_username username of the chat sender.
+ * @param p_chat_ack pointer to the packet, usually on the caller's stack.
+ * @param p_sender interned username of the chat sender.
  * @param p_chat chat the will be sent to the client.
- * @return chat_t* returns a pointer to the packet. Returns NULL on
- * failure.
+ * @param seq room sequence number of the chat (0 for room notices).
+ * @return int SUCCESS (0) or FAILURE (1).
  */
-chat_t *
-cr_msg_create_update (char * p_username, char * p_chat);
+int
+cr_msg_create_update (chat_update_t * p_chat_ack, const cr_name_t * p_sender,
+                                           char * p_chat, uint64_t seq);
 
 /**
  * @brief sends a reject packet of specified type and sub type to the client.
@@ -213,12 +341,74 @@ cr_msg_send_ack (SSL * p_ssl, uint8_t type, uint8_t sub_type);
  * @brief sends a chat update packet to the client.
  * 
  * @param p_ssl pointer to ssl socket file descriptor.
- * @param p_username username of the chat sender.
+ * @param p_sender interned username of the chat sender.
  * @param p_chat chat message.
+ * @param seq room sequence number of the chat (0 for room notices).
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_update (SSL * p_ssl, const cr_name_t * p_sender, char * p_chat,
+                                                       uint64_t seq);
+
+/**
+ * @brief sends the sender of a chat its own chat as a chat response, which
+ * carries the sequence number the room gave it. Legacy clients are not sent
+ * anything, they never received their own chats.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_sender interned username of the chat sender.
+ * @param p_chat chat message.
+ * @param seq room sequence number of the chat.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_chat_ack (SSL * p_ssl, const cr_name_t * p_sender, char * p_chat,
+                                                         uint64_t seq);
+
+/**
+ * @brief sends a room join acknowledge packet followed by the missing tail
+ * of the room history in a single write.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param seq latest sequence number of the room.
+ * @param p_history log lines newer than the client's since value.
+ * @param history_len length of p_history (at most MAX_CHAT_FILE_SIZE).
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_join_ack (SSL * p_ssl, uint64_t seq, char * p_history,
+                                              uint16_t history_len);
+
+/**
+ * @brief sends a protocol version acknowledge packet to the client.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param version protocol version the server will use for the connection.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_version_ack (SSL * p_ssl, uint8_t version);
+
+/**
+ * @brief sends a compression acknowledge packet to the client.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param algorithm compression algorithm the server will use.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_compress_ack (SSL * p_ssl, uint8_t algorithm);
+
+/**
+ * @brief sends a stats acknowledge packet built by cr_stats_snapshot.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_packet stats acknowledge packet.
+ * @param packet_len length of the packet.
  * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
  */
 int
-cr_msg_send_update (SSL * p_ssl, char * p_username, char * p_chat);
+cr_msg_send_stats_ack (SSL * p_ssl, const char * p_packet, size_t packet_len);
 
 /**
  * @brief uses TCP cork and sendfile to send a file with a rooms/list/ack
@@ -0,0 +1,73 @@
+#ifndef CR_NAMES
+#define CR_NAMES
+
+#include "cr_shared.h"
+
+//NOTE: Interning table for usernames and room names. Each distinct name is
+//made once by cr_names_intern and never changed, so users, rooms, sessions
+//and room worker messages hold a const cr_name_t pointer, two names are
+//equal exactly when their pointers are, and the hash and length are read
+//instead of computed. Every cr_names_intern is a reference that is given
+//back with cr_names_release, and a name is freed with its last reference,
+//so deleted users and rooms and the senders of remote chats don't stay in
+//the table. Lookups of names a client sent use cr_names_find, which never
+//adds.
+
+//Buckets of the table. Must be a power of two.
+#define NAMES_BUCKETS 1024
+
+/**
+ * @brief Returns the interned name with the given bytes, adding it if it is
+ * not interned yet, and takes a reference to it. Any thread may call it.
+ *
+ * @param p_bytes name, read up to its terminator or max_length bytes.
+ * @param max_length most bytes to read.
+ * @return const cr_name_t* the name, to be given back with
+ * cr_names_release. NULL returned if the name is empty or longer than
+ * MAX_NAME_LENGTH, or on failure.
+ */
+const cr_name_t *
+cr_names_intern (const char * p_bytes, size_t max_length);
+
+/**
+ * @brief Gives back a reference taken by cr_names_intern. The name is freed
+ * with its last reference.
+ *
+ * @param p_name the name. NULL does nothing.
+ */
+void
+cr_names_release (const cr_name_t * p_name);
+
+/**
+ * @brief Returns the interned name with the given bytes, without adding it
+ * or taking a reference. The name only stays valid while another holder
+ * keeps it, so the result is meant for comparing against held names.
+ *
+ * @param p_bytes name, read up to its terminator or max_length bytes.
+ * @param max_length most bytes to read.
+ * @return const cr_name_t* the name. NULL returned if it is not interned.
+ */
+const cr_name_t *
+cr_names_find (const char * p_bytes, size_t max_length);
+
+/**
+ * @brief Hashes (FNV-1a) the bytes of a name, the hash cr_name_t carries.
+ *
+ * @param p_bytes name.
+ * @param length bytes in the name.
+ * @return uint32_t the hash.
+ */
+uint32_t
+cr_names_hash (const char * p_bytes, size_t length);
+
+/**
+ * @brief Returns the number of interned names.
+ *
+ * @return uint32_t the count.
+ */
+uint32_t
+cr_names_count ();
+
+#endif //CR_NAMES
+
+//End of cr_names.h file
@@ -0,0 +1,56 @@
+#ifndef CR_PROBES
+#define CR_PROBES
+
+//NOTE: USDT probes for perf, bpftrace and SystemTap, built in with
+//cmake -DUSDT=1 when sys/sdt.h is installed (systemtap-sdt-dev). A probe is
+//a nop instruction plus a note in the ELF file, so it costs nothing until a
+//tracer attaches. Without USDT the probes compile away. tools/bpftrace has
+//scripts built on them.
+//
+//Probes, all in the chat_room provider:
+//  handshake_done  (fd, handshake ns, failed handshakes before this one)
+//  session_start   (fd)             a pool thread took the connection.
+//  session_end     (fd, result)     result of cr_sm_session_manager.
+//  dispatch_begin  (state, type, sub type)
+//  dispatch_end    (state, type, sub type, result)
+//  broadcast_begin (room name, seq, room users)
+//  broadcast_end   (room name, seq, result)
+//  log_append_begin(room name, seq)
+//  log_append_end  (room name, seq)
+//  log_rotate_begin(room name)
+//  log_rotate_end  (room name, result)
+
+//Session states passed to the dispatch probes.
+#define PROBE_STATE_CONNECTED 0
+#define PROBE_STATE_LOGGED 1
+#define PROBE_STATE_CHATTING 2
+
+#ifdef CR_USDT
+
+#include <sys/sdt.h>
+
+#define CR_PROBE(...) STAP_PROBEV(chat_room, __VA_ARGS__)
+
+#else
+
+//NOTE: The arguments are still type checked and count as used, so a
+//variable kept only for a probe does not warn, but they are never evaluated.
+#define CR_PROBE(name, ...)                                                 \
+    do {                                                                    \
+        if (0)                                                              \
+        {                                                                   \
+            cr_probe_args(0, __VA_ARGS__);                                  \
+        }                                                                   \
+    } while (0)
+
+static inline void
+cr_probe_args (int unused, ...)
+{
+    (void) unused;
+}
+
+#endif //CR_USDT
+
+#endif //CR_PROBES
+
+//End of cr_probes.h file
@@ -4,6 +4,12 @@
 #include "cr_shared.h"
 #include "cr_msg.h"
 #include "cr_chats.h"
+#include "cr_cluster.h"
+
+//Persistent rooms. With it on the rooms directory is kept on shutdown, and the
+//room name list is the catalog the next start registers the rooms from.
+#define PERSIST_OFF 0
+#define PERSIST_ON 1
 
 /**
  * @brief Sends a list of the rooms present to the client.
@@ -15,6 +21,38 @@
 int
 cr_rooms_list (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder);
 
+/**
+ * @brief Adds a user to a room, sends them the join acknowledge with the
+ * history they are missing, and tells the other users they joined.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room_t struct.
+ * @param p_ssl_holder pointer to struct with SSL and client file descriptors.
+ * @param p_user pointer to current user struct.
+ * @param since last chat sequence number the client holds for the room.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_join_room (room_t * p_room, ssl_socket_holder_t * p_ssl_holder,
+                                      user_t * p_user, uint64_t since);
+
+/**
+ * @brief Puts a user handed over by the previous server process back in the
+ * room it was in. Nothing is sent, the client already has the room's
+ * history and the other members never saw it leave.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room_t struct.
+ * @param p_user pointer to current user struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_rejoin_room (room_t * p_room, user_t * p_user);
+
 /**
  * @brief Adds a user to a room. Sends a reject packet if the room doesn't
  * exist.
@@ -31,6 +69,21 @@ int
 cr_rooms_join (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder,
                  user_t * p_user, char * p_buffer, int * p_chatting);
 
+/**
+ * @brief Puts a user handed over by the previous server process back in the
+ * room it was in, without sending anything.
+ * 
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_user pointer to current user struct.
+ * @param p_room_name room name.
+ * @param p_chatting pointer to tracker that identifies whether the user
+ * is in a room or not.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_rejoin (rooms_t * p_rooms, user_t * p_user, char * p_room_name,
+                                                        int * p_chatting);
+
 /**
  * @brief Creates a room log and a room struct that the server will track.
  * 
@@ -57,17 +110,66 @@ int
 cr_rooms_delete (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
                                                 char * p_buffer);
 
+/**
+ * @brief Creates a room created on another cluster node. Names this node
+ * would reject, rooms it already has and rooms past its limit are skipped,
+ * and the other nodes are not told again.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_create_remote (rooms_t * p_rooms, char * p_room_name);
+
+/**
+ * @brief Deletes a room deleted on another cluster node. A room that still
+ * has members here is kept, and the other nodes are not told again.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_delete_remote (rooms_t * p_rooms, char * p_room_name);
+
+/**
+ * @brief Adds a room handed over by the previous server process. Its log and
+ * its line in the room name list are already on disk and are kept.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @param chat_seq the room's last chat sequence number.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_adopt (rooms_t * p_rooms, char * p_room_name, uint64_t chat_seq);
+
 /**
  * @brief Creates rooms log directory and file for holding room name list.
+ * With persistent rooms an existing directory is kept and every room in its
+ * room name list is registered. Their logs are only read on first use.
  * 
+ * @param p_rooms pointer to rooms_t struct.
+ * @param keep non zero when the rooms are handed over by the previous server
+ * process, whose directory and room name list are kept.
+ * @param persist_rooms PERSIST_ON to keep the rooms between runs.
  * @return int SUCCESS (0) or FAILURE (1).
  */
 int
-cr_rooms_start ();
+cr_rooms_start (rooms_t * p_rooms, int keep, uint8_t persist_rooms);
+
+/**
+ * @brief Returns whether the rooms are kept between runs.
+ * 
+ * @return int 1 with persistent rooms on, 0 if not.
+ */
+int
+cr_rooms_persistent ();
 
 /**
  * @brief Cleans rooms list file and removes room directories on server
- * shutdown.
+ * shutdown. Does nothing with persistent rooms on.
  * 
  */
 void
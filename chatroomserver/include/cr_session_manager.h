@@ -6,6 +6,13 @@
 #include "cr_users.h"
 #include "cr_rooms.h"
 #include "cr_chats.h"
+#include "cr_frame.h"
+#include "cr_flush.h"
+#include "cr_compress.h"
+#include "cr_metrics.h"
+#include "cr_stats.h"
+#include "cr_handoff.h"
+#include "cr_alloc.h"
 
 #define NO_MATCH 5
 
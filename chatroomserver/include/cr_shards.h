@@ -0,0 +1,157 @@
+#ifndef CR_SHARDS
+#define CR_SHARDS
+
+#include <semaphore.h>
+
+#include "cr_shared.h"
+#include "cr_msg.h"
+#include "cr_alloc.h"
+#include "cr_names.h"
+
+//NOTE: Room workers. With workers started, every room is owned by one worker
+//picked by a hash of its name. Joins, chats and leaves are posted to the
+//owner's inbox and the owner changes the room's members, appends its log and
+//sends its updates without taking room_mutex, so a busy room stays on one
+//core. With no workers the sessions do this themselves under room_mutex.
+
+//Most room workers.
+#define MAX_ROOM_SHARDS 32
+
+//Workers started when the config does not say.
+#define DEFAULT_ROOM_SHARDS 0
+
+//Message types.
+#define SHARD_JOIN 0
+#define SHARD_CHAT 1
+#define SHARD_LEAVE 2
+#define SHARD_BARRIER 3
+#define SHARD_STOP 4
+#define SHARD_REMOTE 5
+#define SHARD_REJOIN 6
+
+//NOTE: One request for a room's owner. Chats, local and from other cluster
+//nodes, are freed by the owner once handled; every other message lives on the poster's stack and is handed back
+//through p_done.
+typedef struct shard_msg {
+    struct shard_msg    * p_next;
+    uint8_t               type;
+    int                   return_val;
+    room_t              * p_room;
+    user_t              * p_user;
+    ssl_socket_holder_t * p_ssl_holder;
+    uint64_t              since;
+    sem_t               * p_done;
+    const cr_name_t     * p_sender; //NOTE: Sender of a remote chat.
+    char                  p_chat[MAX_CHAT_LEN + 1];
+} shard_msg_t;
+
+/**
+ * @brief Starts the room workers.
+ *
+ * @param count number of workers. Zero leaves the workers stopped and rooms
+ * are changed under room_mutex.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_start (uint8_t count);
+
+/**
+ * @brief Lets every worker finish the messages already posted, then stops
+ * them. Must be called after the sessions have stopped and before the rooms
+ * are freed.
+ */
+void
+cr_shards_stop ();
+
+/**
+ * @brief Returns whether rooms are owned by workers.
+ *
+ * @return int 1 if the workers are running, 0 if not.
+ */
+int
+cr_shards_on ();
+
+/**
+ * @brief Has the room's owner add a user to the room, send the join
+ * acknowledge and history, and tell the other members. Waits until done.
+ *
+ * @param p_room pointer to the room.
+ * @param p_ssl_holder pointer to the joining client's SSL holder.
+ * @param p_user pointer to the joining user.
+ * @param since last chat sequence number the client holds for the room.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_shards_join (room_t * p_room, ssl_socket_holder_t * p_ssl_holder,
+                                   user_t * p_user, uint64_t since);
+
+/**
+ * @brief Posts a chat to the room's owner, which logs it and sends it to the
+ * other members. Does not wait.
+ *
+ * @param p_room pointer to the room.
+ * @param p_user pointer to the sending user.
+ * @param p_chat chat text, at most MAX_CHAT_LEN characters are kept.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_chat (room_t * p_room, user_t * p_user, char * p_chat);
+
+/**
+ * @brief Posts a chat from another cluster node to the room's owner, which
+ * logs it and sends it to every member. Does not wait.
+ *
+ * @param p_room pointer to the room.
+ * @param p_sender sender's interned username. The message takes over the
+ * caller's reference, the owner gives it back once the chat is handled; on
+ * failure it stays the caller's.
+ * @param p_chat chat text, at most MAX_CHAT_LEN characters are kept.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_chat_remote (room_t * p_room, const cr_name_t * p_sender,
+                                                  char * p_chat);
+
+/**
+ * @brief Has the room's owner remove a user from the room and tell the other
+ * members. Waits until done, so every chat the user posted before is handled
+ * first.
+ *
+ * @param p_room pointer to the room.
+ * @param p_user pointer to the leaving user.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_leave (room_t * p_room, user_t * p_user);
+
+/**
+ * @brief Has the room's owner put back a user handed over by the previous
+ * server process. Nothing is sent. Waits until done.
+ *
+ * @param p_room pointer to the room.
+ * @param p_user pointer to the user.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_rejoin (room_t * p_room, user_t * p_user);
+
+/**
+ * @brief Waits until the room's owner has handled everything posted to it so
+ * far.
+ *
+ * @param p_room pointer to the room.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_barrier (room_t * p_room);
+
+/**
+ * @brief Waits until every worker has handled everything posted to it so
+ * far.
+ */
+void
+cr_shards_drain ();
+
+#endif //CR_SHARDS
+
+//End of cr_shards.h file
@@ -2,7 +2,10 @@
 #define CR_SHARED
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <inttypes.h>
+#include <endian.h>
 #include <errno.h>
 #include <string.h>
 #include <locale.h>
@@ -12,11 +15,15 @@
 #include <sys/sendfile.h>
 #include <fcntl.h>
 
+#include "../slab_lib/slab.h"
 #include "../cll_lib/cll.h"
 #include "../h_table_lib/h_table.h"
 #include "../t_pool_lib/t_pool.h"
 #include "../networking_lib/networking.h"
 #include "../algorithms_lib/algorithms.h"
+#include "cr_lockstat.h"
+#include "cr_log.h"
+#include "cr_probes.h"
 
 #ifndef SHARED_MACROS
 #define SHARED_MACROS
@@ -53,6 +60,10 @@
 
 #endif //SHARED_MACROS
 
+//NOTE: Size of a cache line on the targets the server runs on (x86-64 and
+//most arm64 parts). Fields different threads write are kept this far apart.
+#define CACHE_LINE_SIZE 64
+
 //Username attributes
 #define MAX_USERNAME_LENGTH 30
 #define MIN_USERNAME_LENGTH 1
@@ -62,6 +73,9 @@
 #define MIN_ROOM_NAME_LENGTH 5
 #define ROOM_ADDED_CHARS 12
 
+//Longest username or room name, the size interned names are made for.
+#define MAX_NAME_LENGTH 30
+
 //password attributes
 #define MAX_PASSWORD_LENGTH 30
 #define MIN_PASSWORD_LENGTH 5
@@ -79,6 +93,34 @@
 #define MIN_TOTAL_ROOMS 1
 #define MAX_CHAT_FILE_SIZE 1024
 
+//Room log line attributes. Each line is "<seq> <username>><chat>\n" where seq
+//is the room's chat sequence number in decimal (at most 20 digits).
+#define CHAT_SEQ_MAX_DIGITS 20
+#define MAX_LOG_LINE_LENGTH (CHAT_SEQ_MAX_DIGITS + MAX_USERNAME_LENGTH + \
+                             MAX_CHAT_LEN + 3)
+
+//Per-connection receive buffer. Sized to hold several maximum size requests so
+//reads that contain more than one frame don't have to be split.
+#define RECV_BUFF_SIZE (BUFF_SIZE * 4)
+
+//Per-connection send buffer. Responses produced while handling one read are
+//gathered here and written together; 16 KiB is the largest TLS record.
+#define SEND_BUFF_SIZE (BUFF_SIZE * 16)
+
+//Chat update flush window (milliseconds). Updates written to a connection
+//within the window go out in one TLS record. Zero writes every update at once.
+#define DEFAULT_FLUSH_WINDOW_MS 5
+#define MAX_FLUSH_WINDOW_MS 1000
+
+//Accept loops. A single loop accepts on one listening socket; more loops each
+//get their own SO_REUSEPORT socket and the kernel spreads new connections
+//between them. Zero starts one loop per online core.
+#define DEFAULT_ACCEPTORS 1
+#define MAX_ACCEPTORS 64
+
+//Core of a session that is not pinned.
+#define NO_CPU -1
+
 //Status code values
 #define NOT_LOGGED_IN 0
 #define LOGGED_IN 1
@@ -94,6 +136,10 @@
 #define ROOM_NAME_LIST "rooms/room_names.log"
 #define ROOM_NAME_LIST_BACKUP "rooms/room_names_b.log"
 #define LOG_DIR "rooms"
+#define CLUSTER_FILENAME "cluster.txt"
+#define CLUSTER_CA_FILENAME "cluster_ca.crt"
+#define CERT_FILENAME "server.crt"
+#define KEY_FILENAME "server.key"
 
 //strtol MACRO
 #define BASE10 10
@@ -136,22 +182,61 @@ typedef struct {
     char     p_port[PORT_MAX_STRING + 1];
     uint8_t  max_rooms;
     uint8_t  max_client;
+    uint16_t flush_window_ms;
+    uint8_t  compress_level;
+    uint16_t metrics_port;
+    uint8_t  acceptors;
+    uint8_t  pin_acceptors;
+    uint8_t  room_shards;
+    uint8_t  cluster_node;
+    uint8_t  hot_restart;
+    uint8_t  persist_rooms;
 } config_info_t;
 
+//NOTE: An interned username or room name, see cr_names.h. The bytes, hash
+//and length never change once made, so a holder reads them without a lock.
+typedef struct cr_name {
+    uint32_t         hash; //NOTE: FNV-1a of p_bytes.
+    uint32_t         refs; //NOTE: Holders, guarded by the names mutex.
+    uint8_t          length;
+    char             p_bytes[MAX_NAME_LENGTH + 1];
+    struct cr_name * p_next; //NOTE: Next name in the same bucket.
+} cr_name_t;
+
+//NOTE: The first cache line holds what a broadcast reads for every member.
+//login_status, written on login and logout, starts the next line so those
+//writes do not invalidate the line other threads are sending from, and the
+//names and password, read only on login, join and lookups, follow it. The
+//struct is cache line aligned, allocate it with cr_alloc_aligned.
 typedef struct {
-    char          p_username[MAX_USERNAME_LENGTH + 1];
-    char          p_password[MAX_PASSWORD_LENGTH + 1];
-    char          p_chat_room[MAX_ROOM_NAME_LENGTH + 1];
-    volatile int  login_status;
-    volatile int  admin_status;
     ssl_socket_holder_t * p_ssl_holder;
+    cll_link_t    room_link; //NOTE: Link in the members of the room the
+                             //user is in. Guarded like the room's members.
+    volatile int  admin_status;
+    volatile int  login_status __attribute__((aligned(CACHE_LINE_SIZE)));
+    const cr_name_t * p_name;
+    const cr_name_t * p_room_name; //NOTE: Name of the room the user is in,
+                                   //NULL if none.
+    char          p_password[MAX_PASSWORD_LENGTH + 1];
 } user_t;
 
+//NOTE: The fields taken under room_mutex for every chat come first and the
+//names, read on joins, lookups and log writes, start a new cache line. The
+//struct is cache line aligned so two rooms owned by different room workers
+//never share a line, allocate it with cr_alloc_aligned.
 typedef struct {
-    char              p_room_name[MAX_ROOM_NAME_LENGTH + 1];
-    char              p_room_location[MAX_ROOM_NAME_LENGTH + ROOM_ADDED_CHARS];
-    cll_t *           p_users;
     pthread_mutex_t   room_mutex;
+    cll_intrusive_t   members; //NOTE: Users in the room, linked through
+                               //their room_link. Guarded by room_mutex.
+    uint64_t          chat_seq; //NOTE: Last sequence number assigned to a
+                                //chat in this room. Guarded by room_mutex.
+    int               stats_slot; //NOTE: Slot in cr_stats' room table, -1
+                                  //if the table was full.
+    int               log_cold; //NOTE: Set for a room loaded from the room
+                                //catalog until its log is first read, see
+                                //cr_chats_page_in. Guarded by room_mutex.
+    const cr_name_t * p_name __attribute__((aligned(CACHE_LINE_SIZE)));
+    char              p_room_location[MAX_ROOM_NAME_LENGTH + ROOM_ADDED_CHARS];
 } room_t;
 
 typedef struct {
@@ -169,10 +254,49 @@ typedef struct {
     uint8_t           max_rooms;
 } rooms_t;
 
+//NOTE: Per-connection protocol state. Attached to the connection's SSL
+//struct as app data so message functions that only receive the SSL pointer
+//can find it.
+typedef struct session {
+    SSL *            p_ssl;
+    uint8_t          version;
+    uint8_t          compression;
+    uint32_t         recv_start;
+    uint32_t         recv_end;
+    char             p_recv_buffer[RECV_BUFF_SIZE];
+    pthread_mutex_t  send_mutex; //NOTE: Guards the fields below. Other
+                                 //sessions write chat updates here too.
+    int              batching;
+    uint32_t         send_len;
+    char             p_send_buffer[SEND_BUFF_SIZE];
+    int              pending; //NOTE: Guarded by the flusher's mutex, see
+                              //cr_flush.c.
+    struct session * p_next_pending;
+} session_t;
+
+//NOTE: A session handed over by the previous server process on a hot
+//restart. Fixed size so it can be passed whole between the processes.
+typedef struct {
+    uint8_t  logged_in;
+    uint8_t  chatting;
+    uint8_t  version;
+    uint8_t  compression;
+    char     p_username[MAX_USERNAME_LENGTH + 1];
+    char     p_room_name[MAX_ROOM_NAME_LENGTH + 1];
+    uint32_t pending_len; //NOTE: Received bytes the old process had not
+                          //handled yet.
+    char     p_pending[RECV_BUFF_SIZE];
+} handoff_session_t;
+
 typedef struct {
     rooms_t * p_rooms;
     users_t * p_users;
     ssl_socket_holder_t * p_ssl_holder;
+    session_t * p_session;
+    int cpu; //NOTE: Core that accepted the connection and runs its session,
+             //NO_CPU when acceptors are not pinned.
+    handoff_session_t * p_resume; //NOTE: Set for a session handed over by
+                                  //the previous process, NULL otherwise.
 } cr_package_t;
 
 
@@ -195,6 +319,16 @@ port_range_check (long * p_port);
 void
 free_rooms (void * p_room_entry_holder);
 
+/**
+ * @brief Same as free_rooms, but leaves the room's log on disk. Used after a
+ * hot restart handed the rooms to a new process.
+ * 
+ * @param p_room_entry_holder The input into this function is a pointer to an
+ * hash table entry that is type room_t (the pointer is void though).
+ */
+void
+free_rooms_keep (void * p_room_entry_holder);
+
 #endif //CR_SHARED
 
 //End of cr_shared.c file
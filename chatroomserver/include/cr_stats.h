@@ -0,0 +1,106 @@
+#ifndef CR_STATS
+#define CR_STATS
+
+#include "cr_shared.h"
+#include "cr_msg.h"
+#include "cr_metrics.h"
+
+//NOTE: Live numbers for the admin stats request. Everything is recorded per
+//thread or per room slot and read with relaxed loads, so a snapshot never
+//takes the users, rooms or pool locks and never holds up a session.
+
+//Seconds of per-second counts kept. Must be a power of two.
+#define STATS_SECONDS 8
+
+//Whole seconds the rates in a snapshot cover.
+#define STATS_RATE_WINDOW 5
+
+//Rooms the stats table can follow.
+#define STATS_MAX_ROOMS MAX_TOTAL_ROOMS
+
+//Largest snapshot.
+#define STATS_PACKET_SIZE (sizeof(stats_ack_t) +                            \
+                           (STATS_MAX_ROOMS * sizeof(stats_room_t)))
+
+/**
+ * @brief Turns recording on and starts the uptime clock.
+ *
+ * @param pool_threads number of threads in the session pool.
+ */
+void
+cr_stats_start (uint8_t pool_threads);
+
+/**
+ * @brief Turns recording off and frees every thread's counters. Must be
+ * called after the threads recording stats have stopped.
+ */
+void
+cr_stats_stop ();
+
+/**
+ * @brief Records a handled request and how long its dispatch took.
+ *
+ * @param elapsed_ns dispatch time in nanoseconds.
+ */
+void
+cr_stats_request (uint64_t elapsed_ns);
+
+/**
+ * @brief Records bytes read from or written to a client.
+ *
+ * @param bytes_in bytes read.
+ * @param bytes_out bytes written.
+ */
+void
+cr_stats_bytes (uint64_t bytes_in, uint64_t bytes_out);
+
+/**
+ * @brief Gives a new room a slot in the stats table. Must be called with
+ * the rooms mutex held.
+ *
+ * @param p_room pointer to the room, stats_slot is set.
+ */
+void
+cr_stats_room_add (room_t * p_room);
+
+/**
+ * @brief Frees a room's slot. Must be called with the rooms mutex held or
+ * once every session has stopped.
+ *
+ * @param p_room pointer to the room.
+ */
+void
+cr_stats_room_remove (room_t * p_room);
+
+/**
+ * @brief Updates a room's member count from its user list. Must be called
+ * with the room mutex held.
+ *
+ * @param p_room pointer to the room.
+ */
+void
+cr_stats_room_members (room_t * p_room);
+
+/**
+ * @brief Counts a chat logged in a room. Must be called with the room mutex
+ * held.
+ *
+ * @param p_room pointer to the room.
+ */
+void
+cr_stats_room_chat (room_t * p_room);
+
+/**
+ * @brief Builds a stats acknowledge packet: the fixed stats_ack_t followed
+ * by one stats_room_t per room, busiest first.
+ *
+ * @param p_users pointer to users_t struct, read for the logged in count.
+ * @param p_packet buffer of at least STATS_PACKET_SIZE bytes.
+ * @return size_t length of the packet.
+ */
+size_t
+cr_stats_snapshot (users_t * p_users, char * p_packet);
+
+#endif //CR_STATS
+
+//End of cr_stats.h file
@@ -0,0 +1,159 @@
+#ifndef CR_TRACE
+#define CR_TRACE
+
+#include <stdint.h>
+#include <pthread.h>
+
+//NOTE: The flight recorder keeps the last TRACE_RING_EVENTS events of every
+//thread in a ring. The rings are written to cr_trace_<pid>_<n>.bin on SIGUSR2
+//and to cr_trace_<pid>_crash.bin on a crash; chat_room_trace_decode turns a
+//dump into a Chrome trace. Must be a power of two.
+#define TRACE_RING_EVENTS 4096
+
+//Named sites (lock call sites) a dump can describe. Later sites share id 0.
+#define TRACE_MAX_SITES 256
+
+//Dump file magic and format version.
+#define TRACE_MAGIC "CRTRACE1"
+#define TRACE_MAGIC_LENGTH 8
+
+//Events. The decoder pairs each _BEGIN with the next _END on the same thread
+//and each LOCK_ACQUIRED with the LOCK_RELEASED of the same mutex.
+#define TRACE_PACKET_RECEIVED 1 //arg: bytes read.
+#define TRACE_DISPATCH_BEGIN 2 //arg: (type << 8) | sub type.
+#define TRACE_DISPATCH_END 3
+#define TRACE_LOCK_WAIT 4 //site: lock site, arg: mutex address. Only
+                          //recorded when the mutex was already held.
+#define TRACE_LOCK_ACQUIRED 5 //site: lock site, arg: mutex address.
+#define TRACE_LOCK_RELEASED 6 //arg: mutex address.
+#define TRACE_SSL_WRITE_BEGIN 7 //arg: bytes to write.
+#define TRACE_SSL_WRITE_END 8 //arg: bytes written or 0.
+#define TRACE_LOG_APPEND_BEGIN 9 //arg: chat sequence number.
+#define TRACE_LOG_APPEND_END 10
+#define TRACE_LOG_ROTATE_BEGIN 11
+#define TRACE_LOG_ROTATE_END 12
+
+//NOTE: On x86 events are stamped with the time stamp counter, which is about
+//half the cost of clock_gettime; the dump carries two (ticks, CLOCK_MONOTONIC)
+//pairs so the decoder can convert. Elsewhere ticks are nanoseconds.
+typedef struct {
+    uint64_t ticks;
+    uint8_t  event;
+    uint8_t  reserved;
+    uint16_t site;
+    uint32_t arg;
+} cr_trace_event_t;
+
+//NOTE: A named place in the code, declared static at the call site. It gets
+//an id the first time it is recorded and the dump carries its name.
+typedef struct {
+    const char * p_name;
+    const char * p_function;
+    int          line;
+    int          registered;
+    uint16_t     id;
+} cr_trace_site_t;
+
+//NOTE: Layout of a dump. The header is followed by site_count sites, each a
+//cr_trace_site_record_t followed by the name and function bytes, and then by
+//one cr_trace_ring_record_t and ring_events events per thread until the end
+//of the file. Everything is in host byte order.
+typedef struct {
+    char     p_magic[TRACE_MAGIC_LENGTH];
+    uint32_t pid;
+    uint32_t ring_events;
+    uint32_t site_count;
+    uint32_t reserved;
+    uint64_t start_ticks; //Ticks and CLOCK_MONOTONIC ns when recording
+    uint64_t start_ns;    //started and when the dump was taken.
+    uint64_t dump_ticks;
+    uint64_t dump_ns;
+} cr_trace_header_t;
+
+typedef struct {
+    uint16_t id;
+    uint16_t line;
+    uint16_t name_len;
+    uint16_t function_len;
+} cr_trace_site_record_t;
+
+typedef struct {
+    uint32_t tid;
+    uint32_t reserved;
+    uint64_t head; //Events ever recorded; the newest is at
+                   //(head - 1) % ring_events.
+} cr_trace_ring_record_t;
+
+/**
+ * @brief Turns the flight recorder on. Installs the crash handlers and
+ * starts the thread that dumps on SIGUSR2. Blocks SIGUSR2 in the calling
+ * thread, so it must be called before any other thread is created.
+ *
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_trace_start ();
+
+/**
+ * @brief Turns the flight recorder off, restores the crash handlers, and
+ * frees every thread's ring. Must be called after the threads recording
+ * events have stopped.
+ */
+void
+cr_trace_stop ();
+
+/**
+ * @brief Records an event in the calling thread's ring. Does nothing while
+ * the recorder is off.
+ *
+ * @param event event (TRACE_PACKET_RECEIVED ...).
+ * @param site site id from cr_trace_site or 0.
+ * @param arg event argument.
+ */
+void
+cr_trace_record (uint8_t event, uint16_t site, uint32_t arg);
+
+/**
+ * @brief Returns a site's id, giving it one on first use.
+ *
+ * @param p_site site to look up.
+ * @return uint16_t site id, 0 if the site table is full.
+ */
+uint16_t
+cr_trace_site (cr_trace_site_t * p_site);
+
+/**
+ * @brief Locks a mutex, recording the wait and the acquisition. Used
+ * through CR_MUTEX_LOCK.
+ *
+ * @param p_site lock call site.
+ * @param p_mutex mutex to lock.
+ * @return int result of pthread_mutex_lock.
+ */
+int
+cr_trace_lock (cr_trace_site_t * p_site, pthread_mutex_t * p_mutex);
+
+/**
+ * @brief Unlocks a mutex, recording the release. Used through
+ * CR_MUTEX_UNLOCK.
+ *
+ * @param p_mutex mutex to unlock.
+ * @return int result of pthread_mutex_unlock.
+ */
+int
+cr_trace_unlock (pthread_mutex_t * p_mutex);
+
+/**
+ * @brief Writes every ring to a file descriptor. Only uses
+ * async-signal-safe calls, so it can run in a crash handler. Rings still
+ * being written may hold a torn newest event.
+ *
+ * @param fd file descriptor to write to.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_trace_dump (int fd);
+
+#endif //CR_TRACE
+
+//End of cr_trace.h file
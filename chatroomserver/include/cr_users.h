@@ -3,6 +3,9 @@
 
 #include "cr_shared.h"
 #include "cr_msg.h"
+#include "cr_cluster.h"
+#include "cr_alloc.h"
+#include "cr_names.h"
 
 /**
  * @brief Adds users from user.txt file to p_users struct (with hash table)
@@ -44,6 +47,22 @@ int
 cr_users_login (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
                char * p_buffer, user_t ** pp_user, int * p_logged_in);
 
+/**
+ * @brief Logs in a user handed over by the previous server process, which
+ * already checked its password. Nothing is sent.
+ * 
+ * @param p_users pointer to users_t struct.
+ * @param p_ssl_holder pointer to struct with SSL and client file descriptors.
+ * @param p_username username.
+ * @param pp_user double pointer to user_t struct to have specified user
+ * assigned to it.
+ * @param p_logged_in pointer to logged in specifier int.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_users_resume (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
+                 char * p_username, user_t ** pp_user, int * p_logged_in);
+
 /**
  * @brief Sets a specified user's admin status to ADMIN if the user exists
  * and is not logged in. Verifies user requesting update is admin and not
@@ -92,6 +111,30 @@ int
 cr_users_remove_user (users_t * p_users, SSL * p_ssl, char * p_buffer,
                                                      user_t * p_user);
 
+/**
+ * @brief Adds a user registered on another cluster node. Does nothing if the
+ * user is already here, and does not tell the other nodes again.
+ *
+ * @param p_users pointer to users_t struct.
+ * @param p_username username.
+ * @param p_password password.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_users_add_remote (users_t * p_users, char * p_username, char * p_password);
+
+/**
+ * @brief Removes a user deleted on another cluster node. A user that is not
+ * here, is logged in here or is an admin is left alone, and the other nodes
+ * are not told again.
+ *
+ * @param p_users pointer to users_t struct.
+ * @param p_username username.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_users_remove_remote (users_t * p_users, char * p_username);
+
 #endif //CR_USERS
 
 //End of cr_users.h file
@@ -35,22 +35,19 @@ n_cr_start_ssl ()
 }
 
 /**
- * @brief Given a hostname/IP address and port number, n_listen will use
- * getaddrinfo() to create a list of possible sockaddr structs for connection
- * and attempt to listen on those settings (this increases the portability of
- * the code). n_listen will then use socket(), bind(), and listen() and then
- * return the listening file descriptor. n_listen sets SO_REUSEADDR (to enable
- * connections to recently closed sockets) and listening time to 3 seconds by
- * default.
+ * @brief Creates a listening socket for n_listen and n_listen_shared. Walks
+ * the getaddrinfo() results until one can be bound and listened on.
  *
  * @param p_address string with the host address in either letter or numeric
  * form.
  * @param p_port string with the port in numeric form.
+ * @param backlog length of the pending connection queue.
+ * @param reuse_port non zero to set SO_REUSEPORT before binding.
  * @return int either the value of the file descriptor or FAILURE_NEGATIVE
  * (-1).
  */
-int
-n_listen (char * p_address, char * p_port, int backlog)
+static int
+n_listen_helper (char * p_address, char * p_port, int backlog, int reuse_port)
 {
     if ((NULL == p_address) || (NULL == p_port))
     {
@@ -101,6 +98,21 @@ n_listen (char * p_address, char * p_port, int backlog)
                                               &optval, sizeof(int));
         n_error_print("n_listen", "setsockopt SO_REUSEADDR", err_tracker);
 
+        if (reuse_port)
+        {
+            err_tracker = setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT,
+                                                  &optval, sizeof(int));
+            n_error_print("n_listen", "setsockopt SO_REUSEPORT", err_tracker);
+
+            //NOTE: Without SO_REUSEPORT the second socket's bind fails, so
+            //give up on this address rather than listen on one socket only.
+            if (FAILURE_NEGATIVE == err_tracker)
+            {
+                close(socket_fd);
+                continue;
+            }
+        }
+
         err_tracker = setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO,
                                  &timeout, sizeof(struct timeval));
         n_error_print("n_listen", "setsockopt SO_RCVTIMEO", err_tracker);
@@ -136,6 +148,44 @@ n_listen (char * p_address, char * p_port, int backlog)
 
 }
 
+/**
+ * @brief Given a hostname/IP address and port number, n_listen will use
+ * getaddrinfo() to create a list of possible sockaddr structs for connection
+ * and attempt to listen on those settings (this increases the portability of
+ * the code). n_listen will then use socket(), bind(), and listen() and then
+ * return the listening file descriptor. n_listen sets SO_REUSEADDR (to enable
+ * connections to recently closed sockets) and listening time to 3 seconds by
+ * default.
+ *
+ * @param p_address string with the host address in either letter or numeric
+ * form.
+ * @param p_port string with the port in numeric form.
+ * @return int either the value of the file descriptor or FAILURE_NEGATIVE
+ * (-1).
+ */
+int
+n_listen (char * p_address, char * p_port, int backlog)
+{
+    return n_listen_helper(p_address, p_port, backlog, 0);
+}
+
+/**
+ * @brief Same as n_listen but also sets SO_REUSEPORT, so several sockets can
+ * listen on the same address and port. The kernel spreads new connections
+ * across every socket bound this way.
+ *
+ * @param p_address string with the host address in either letter or numeric
+ * form.
+ * @param p_port string with the port in numeric form.
+ * @return int either the value of the file descriptor or FAILURE_NEGATIVE
+ * (-1).
+ */
+int
+n_listen_shared (char * p_address, char * p_port, int backlog)
+{
+    return n_listen_helper(p_address, p_port, backlog, 1);
+}
+
 /**
  * @brief Handles SIGINT (cntrl+C) commands by user to set external variable
  * server_interrupt and allow graceful shutdown for the server.
@@ -156,10 +206,11 @@ signal_handler (int signum)
 /**
  * @brief Creates an ssl context using the TLS server method and server .crt
  * and .key files. For this client's implementation, these will be self signed
- * certificates and not verified by the client.
+ * certificates and not verified by the client. One context is shared by every
+ * accepted client socket.
  *
  * @return SSL_CTX * returns an ssl context to be used with the accepted
- * client socket.
+ * client sockets, NULL on failure.
  */
 SSL_CTX *
 createSSLContext() {
@@ -171,30 +222,95 @@ createSSLContext() {
 
     if (SSL_CTX_use_certificate_file(p_ctx, "server.crt", SSL_FILETYPE_PEM) <= 0) {
         ERR_print_errors_fp(stderr);
+        SSL_CTX_free(p_ctx);
         return NULL;
     }
 
     if (SSL_CTX_use_PrivateKey_file(p_ctx, "server.key", SSL_FILETYPE_PEM) <= 0) {
         ERR_print_errors_fp(stderr);
+        SSL_CTX_free(p_ctx);
         return NULL;
     }
 
     return p_ctx;
 }
 
+/**
+ * @brief Runs the server side of the TLS handshake on a connected socket and
+ * fills the holder. Used by n_accept, and on its own for a connection that
+ * was accepted by another process and passed over.
+ *
+ * @param client_fd connected socket file descriptor. Left open on failure.
+ * @param p_ssl_ctx shared ssl context from createSSLContext. The holder takes
+ * a reference to it that must be released with SSL_CTX_free when the client
+ * socket is closed.
+ * @param p_ssl_holder sturcture to fill with ssl and client file descriptors.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+n_ssl_accept (int client_fd, SSL_CTX * p_ssl_ctx,
+                   ssl_socket_holder_t * p_ssl_holder)
+{
+    if ((NULL == p_ssl_ctx) || (NULL == p_ssl_holder))
+    {
+        fprintf(stderr, "n_ssl_accept: input NULL\n");
+        return FAILURE;
+    }
+
+    SSL * p_ssl = SSL_new(p_ssl_ctx);
+    if (NULL == p_ssl)
+    {
+        fprintf(stderr, "n_ssl_accept: SSL_new\n");
+        return FAILURE;
+    }
+
+    if (0 == SSL_set_fd(p_ssl, client_fd))
+    {
+        fprintf(stderr, "n_ssl_accept: SSL_set_fd\n");
+        SSL_free(p_ssl);
+        return FAILURE;
+    }
+
+    if (0 >= SSL_accept(p_ssl))
+    {
+        fprintf(stderr, "SSL_accept: client connection failure\n");
+        SSL_free(p_ssl);
+        return FAILURE;
+    }
+
+    //NOTE: This reference must be freed whenever the client socket is
+    //closed.
+    SSL_CTX_up_ref(p_ssl_ctx);
+
+    p_ssl_holder->p_ssl = p_ssl;
+    p_ssl_holder->client_fd = client_fd;
+    p_ssl_holder->p_ssl_ctx = p_ssl_ctx;
+
+    return SUCCESS;
+}
+
 /**
  * @brief Given a listening socket file descriptor, returns a connection stream
  * file descriptor and prints client address and port to terminal in numeric
  * form.
  *
  * @param socket_fd file descriptor for listening socket.
+ * @param p_ssl_ctx shared ssl context from createSSLContext. The holder takes
+ * a reference to it that must be released with SSL_CTX_free when the client
+ * socket is closed.
  * @param p_ssl_holder sturcture to fill with ssl and client file descriptors.
  * @return int either the connection stream file descriptor or
  * FAILURE_NEGATIVE (-1).
  */
 int
-n_accept (int socket_fd, ssl_socket_holder_t * p_ssl_holder)
+n_accept (int socket_fd, SSL_CTX * p_ssl_ctx, ssl_socket_holder_t * p_ssl_holder)
 {
+    if ((NULL == p_ssl_ctx) || (NULL == p_ssl_holder))
+    {
+        fprintf(stderr, "n_accept: input NULL\n");
+        return FAILURE_NEGATIVE;
+    }
+
     signal(SIGINT, signal_handler);
     signal(SIGPIPE, SIG_IGN);
 
@@ -206,8 +322,13 @@ n_accept (int socket_fd, ssl_socket_holder_t * p_ssl_holder)
     char addr_str[ADDR_MAX_STRING] = {0};
 
     int flags = NI_NUMERICSERV | NI_NUMERICHOST;
+    int optval = 1;
 
     int client_fd = 0;
+    struct timespec accepted;
+    struct timespec handshaken;
+
+    p_ssl_holder->handshake_failures = 0;
 
     while (CONTINUE == server_interrupt)
     {
@@ -233,42 +354,29 @@ n_accept (int socket_fd, ssl_socket_holder_t * p_ssl_holder)
         }
         else
         {
-            //NOTE: This ssl context must be freed whenever the client socket is closed.
-            SSL_CTX * p_ssl_ctx = createSSLContext();
-
-            if (NULL == p_ssl_ctx)
-            {
-                fprintf(stderr, "n_accept: createSSLContext\n");
-                return FAILURE_NEGATIVE;
-            }
+            clock_gettime(CLOCK_MONOTONIC, &accepted);
 
-            SSL * p_ssl = SSL_new(p_ssl_ctx);
-            if (NULL == p_ssl)
+            //NOTE: Responses are already gathered into whole TLS records
+            //before they are written, so holding back small segments only
+            //adds delay.
+            if (FAILURE_NEGATIVE == setsockopt(client_fd, IPPROTO_TCP,
+                                 TCP_NODELAY, &optval, sizeof(int)))
             {
-                fprintf(stderr, "n_accept: SSL_new\n");
-                return FAILURE_NEGATIVE;
+                perror("n_accept: setsockopt TCP_NODELAY");
             }
 
-            SSL_set_fd(p_ssl, client_fd);
-            if (0 == p_ssl)
-            {
-                fprintf(stderr, "n_accept: SSL_set_fd\n");
-                return FAILURE_NEGATIVE;
-            }
-
-            p_ssl_holder->p_ssl = p_ssl;
-            p_ssl_holder->client_fd = client_fd;
-            p_ssl_holder->p_ssl_ctx = p_ssl_ctx;
-
-            if (0 >= SSL_accept(p_ssl))
+            if (FAILURE == n_ssl_accept(client_fd, p_ssl_ctx, p_ssl_holder))
             {
-                fprintf(stderr, "SSL_accept: client connection failure\n");
-                SSL_free(p_ssl_holder->p_ssl);
-                SSL_CTX_free(p_ssl_holder->p_ssl_ctx);
+                close(client_fd);
+                p_ssl_holder->handshake_failures++;
                 continue;
             }
             else
             {
+                clock_gettime(CLOCK_MONOTONIC, &handshaken);
+                p_ssl_holder->handshake_ns =
+                    ((handshaken.tv_sec - accepted.tv_sec) * 1000000000LL) +
+                    (handshaken.tv_nsec - accepted.tv_nsec);
                 break;
             }
         }
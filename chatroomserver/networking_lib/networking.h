@@ -2,10 +2,13 @@
 #define NETWORKING_LIB
 
 #include <stdio.h>
+#include <stdint.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <string.h>
@@ -56,6 +59,10 @@ typedef struct {
     SSL * p_ssl;
     SSL_CTX * p_ssl_ctx;
     int client_fd;
+    uint64_t handshake_ns; //NOTE: Time from accept to the end of the TLS
+                           //handshake, set by n_accept.
+    uint32_t handshake_failures; //NOTE: Handshakes n_accept gave up on
+                                 //before this connection.
 } ssl_socket_holder_t;
 
 //Variable designated to handle SIGINT signal and enable graceful shutdown
@@ -80,6 +87,20 @@ extern volatile sig_atomic_t server_interrupt;
 int
 n_listen (char * p_address, char * p_port, int backlog);
 
+/**
+ * @brief Same as n_listen but also sets SO_REUSEPORT, so several sockets can
+ * listen on the same address and port. The kernel spreads new connections
+ * across every socket bound this way.
+ * 
+ * @param p_address string with the host address in either letter or numeric
+ * form.
+ * @param p_port string with the port in numeric form.
+ * @return int either the value of the file descriptor or FAILURE_NEGATIVE
+ * (-1).
+ */
+int
+n_listen_shared (char * p_address, char * p_port, int backlog);
+
 /**
  * @brief Handles SIGINT (cntrl+C) commands by user to set external variable
  * server_interrupt and allow graceful shutdown for the server.
@@ -91,18 +112,49 @@ n_listen (char * p_address, char * p_port, int backlog);
 void
 signal_handler (int signum);
 
+/**
+ * @brief Creates an ssl context using the TLS server method and server .crt
+ * and .key files. For this client's implementation, these will be self signed
+ * certificates and not verified by the client. One context is shared by every
+ * accepted client socket.
+ * 
+ * @return SSL_CTX * returns an ssl context to be used with the accepted
+ * client sockets, NULL on failure.
+ */
+SSL_CTX *
+createSSLContext ();
+
+/**
+ * @brief Runs the server side of the TLS handshake on a connected socket and
+ * fills the holder. Used by n_accept, and on its own for a connection that
+ * was accepted by another process and passed over.
+ * 
+ * @param client_fd connected socket file descriptor. Left open on failure.
+ * @param p_ssl_ctx shared ssl context from createSSLContext. The holder takes
+ * a reference to it that must be released with SSL_CTX_free when the client
+ * socket is closed.
+ * @param p_ssl_holder sturcture to fill with ssl and client file descriptors.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+n_ssl_accept (int client_fd, SSL_CTX * p_ssl_ctx,
+                   ssl_socket_holder_t * p_ssl_holder);
+
 /**
  * @brief Given a listening socket file descriptor, returns a connection stream
  * file descriptor and prints client address and port to terminal in numeric
  * form.
  * 
  * @param socket_fd file descriptor for listening socket.
+ * @param p_ssl_ctx shared ssl context from createSSLContext. The holder takes
+ * a reference to it that must be released with SSL_CTX_free when the client
+ * socket is closed.
  * @param p_ssl_holder sturcture to fill with ssl and client file descriptors.
  * @return int either the connection stream file descriptor or 
  * FAILURE_NEGATIVE (-1).
  */
 int
-n_accept (int socket_fd, ssl_socket_holder_t * p_ssl_holder);
+n_accept (int socket_fd, SSL_CTX * p_ssl_ctx, ssl_socket_holder_t * p_ssl_holder);
 
 /**
  * @brief n_connect uses getaddrinfo to create a list of possible sockaddr
@@ -1,5 +1,55 @@
 #include "queue.h"
 
+//NOTE: Nodes come from a slab shared by every queue, so adding and
+//removing them does not go through malloc. If the slab can not be created
+//they fall back to calloc and free.
+static slab_t * p_queue_node_slab = NULL;
+static pthread_once_t queue_node_slab_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Creates the queue_node slab once per process.
+ */
+static void
+queue_node_slab_init ()
+{
+    p_queue_node_slab = slab_init(sizeof(queue_node_t));
+}
+
+/**
+ * @brief Allocates a zeroed node.
+ * 
+ * @return queue_node_t* pointer to the node. NULL returned on failure.
+ */
+static queue_node_t *
+queue_node_alloc ()
+{
+    pthread_once(&queue_node_slab_once, queue_node_slab_init);
+
+    if (NULL == p_queue_node_slab)
+    {
+        return calloc(1, sizeof(queue_node_t));
+    }
+
+    return slab_alloc(p_queue_node_slab);
+}
+
+/**
+ * @brief Frees a node from queue_node_alloc.
+ * 
+ * @param p_node_holder pointer to the node.
+ */
+static void
+queue_node_free (void * p_node_holder)
+{
+    if (NULL == p_queue_node_slab)
+    {
+        free(p_node_holder);
+        return;
+    }
+
+    slab_free(p_node_holder);
+}
+
 /**
  * @brief Initializes queue context.
  * 
@@ -128,11 +178,11 @@ queue_enqueue (queue_t * p_queue, void * p_data)
         return FAILURE;
     }
 
-    queue_node_t * p_queue_node = calloc(1, sizeof(queue_node_t));
+    queue_node_t * p_queue_node = queue_node_alloc();
 
     if (NULL == p_queue_node)
     {
-        perror("queue_enqueue: p_queue_node calloc");
+        fprintf(stderr, "queue_enqueue: p_queue_node alloc failure\n");
         return FAILURE;
     }
 
@@ -153,7 +203,7 @@ queue_enqueue (queue_t * p_queue, void * p_data)
     if (NULL == p_queue->p_head)
     {
         fprintf(stderr, "queue_enqueue: p_queue head NULL\n");
-        FREE(p_queue_node);
+        queue_node_free(p_queue_node);
         return FAILURE;
     }
 
@@ -219,7 +269,7 @@ queue_dequeue (queue_t * p_queue, void (*p_free_function)(void *))
     if (1 == p_queue->size)
     {
         queue_p_data_free(p_temp_node, p_free_function);
-        FREE(p_temp_node);
+        queue_node_free(p_temp_node);
         p_queue->p_head = NULL;
         p_queue->p_tail = NULL;
         p_queue->size = 0;
@@ -239,7 +289,7 @@ queue_dequeue (queue_t * p_queue, void (*p_free_function)(void *))
     p_queue->size--;
 
     queue_p_data_free(p_temp_node, p_free_function);
-    FREE(p_temp_node);
+    queue_node_free(p_temp_node);
 
     if (NULL == p_free_function)
     {
@@ -284,7 +334,7 @@ queue_destroy_dequeue (queue_t * p_queue, void (*p_free_function)(void *))
     if (1 == p_queue->size)
     {
         queue_p_data_free(p_temp_node, p_free_function);
-        FREE(p_temp_node);
+        queue_node_free(p_temp_node);
         p_queue->p_head = NULL;
         p_queue->p_tail = NULL;
         p_queue->size = 0;
@@ -297,7 +347,7 @@ queue_destroy_dequeue (queue_t * p_queue, void (*p_free_function)(void *))
     p_queue->size--;
 
     queue_p_data_free(p_temp_node, p_free_function);
-    FREE(p_temp_node);
+    queue_node_free(p_temp_node);
 
     return SUCCESS;
 }
@@ -348,4 +398,108 @@ queue_full_destroy (queue_t ** pp_queue, void (*p_free_function)(void *))
     }
 
     return queue_context_destroy(pp_queue);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Initializes an empty intrusive queue.
+ * 
+ * @param p_queue pointer to queue structure.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+queue_intrusive_init (queue_intrusive_t * p_queue)
+{
+    if (NULL == p_queue)
+    {
+        fprintf(stderr, "queue_intrusive_init: p_queue NULL\n");
+        return FAILURE;
+    }
+
+    p_queue->p_head = NULL;
+    p_queue->p_tail = NULL;
+    p_queue->size = 0;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Abstracts the return of intrusive queue size.
+ * 
+ * @param p_queue pointer to queue structure.
+ * @return int returns queue size. If p_queue is NULL, -1 returned.
+ */
+int
+queue_intrusive_size (queue_intrusive_t * p_queue)
+{
+    if (NULL == p_queue)
+    {
+        fprintf(stderr, "queue_intrusive_size: p_queue NULL\n");
+        return FAILURE_NEGATIVE;
+    }
+
+    return p_queue->size;
+}
+
+/**
+ * @brief Enqueues an element. It will be dequeued after every element
+ * already in the queue.
+ * 
+ * @param p_queue pointer to queue structure.
+ * @param p_link pointer to the element's link.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+queue_intrusive_enqueue (queue_intrusive_t * p_queue, queue_link_t * p_link)
+{
+    if ((NULL == p_queue) || (NULL == p_link))
+    {
+        fprintf(stderr, "queue_intrusive_enqueue: input NULL\n");
+        return FAILURE;
+    }
+
+    p_link->p_next = NULL;
+
+    if (NULL == p_queue->p_tail)
+    {
+        p_queue->p_head = p_link;
+    }
+    else
+    {
+        p_queue->p_tail->p_next = p_link;
+    }
+
+    p_queue->p_tail = p_link;
+    p_queue->size++;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Dequeues the oldest element.
+ * 
+ * @param p_queue pointer to queue structure.
+ * @return queue_link_t* pointer to the element's link, NULL if the queue is
+ * empty.
+ */
+queue_link_t *
+queue_intrusive_dequeue (queue_intrusive_t * p_queue)
+{
+    if ((NULL == p_queue) || (NULL == p_queue->p_head))
+    {
+        return NULL;
+    }
+
+    queue_link_t * p_link = p_queue->p_head;
+
+    p_queue->p_head = p_link->p_next;
+
+    if (NULL == p_queue->p_head)
+    {
+        p_queue->p_tail = NULL;
+    }
+
+    p_link->p_next = NULL;
+    p_queue->size--;
+
+    return p_link;
+}
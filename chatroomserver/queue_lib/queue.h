@@ -5,6 +5,10 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "../slab_lib/slab.h"
 
 #ifndef SHARED_MACROS
 #define SHARED_MACROS
@@ -69,6 +73,36 @@ typedef struct queue_t {
     int size;
 } queue_t;
 
+//NOTE: Intrusive queue. The link lives inside the element (a thread pool
+//task, for instance), so enqueueing and dequeueing never allocate and can
+//not fail for lack of memory.
+
+/**
+ * @brief Link embedded in an element of an intrusive queue.
+ * 
+ * @param p_next pointer to the next newer link.
+ */
+typedef struct queue_link_t {
+    struct queue_link_t * p_next;
+} queue_link_t;
+
+/**
+ * @brief Intrusive first in, first out queue.
+ * 
+ * @param p_head pointer to the oldest link, dequeued next.
+ * @param p_tail pointer to the newest link.
+ * @param size of the queue.
+ */
+typedef struct queue_intrusive_t {
+    queue_link_t * p_head;
+    queue_link_t * p_tail;
+    int size;
+} queue_intrusive_t;
+
+//Returns the element a link is embedded in.
+#define QUEUE_CONTAINER(p_link, type, member) \
+    ((type *) ((char *) (p_link) - offsetof(type, member)))
+
 /**
  * @brief Initializes queue context.
  * 
@@ -139,4 +173,40 @@ void * queue_dequeue (queue_t * p_queue, void (*p_free_function)(void *));
  */
 int queue_full_destroy (queue_t ** pp_queue, void (*p_free_function)(void *));
 
+/**
+ * @brief Initializes an empty intrusive queue.
+ * 
+ * @param p_queue pointer to queue structure.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int queue_intrusive_init (queue_intrusive_t * p_queue);
+
+/**
+ * @brief Abstracts the return of intrusive queue size.
+ * 
+ * @param p_queue pointer to queue structure.
+ * @return int returns queue size. If p_queue is NULL, -1 returned.
+ */
+int queue_intrusive_size (queue_intrusive_t * p_queue);
+
+/**
+ * @brief Enqueues an element. It will be dequeued after every element
+ * already in the queue.
+ * 
+ * @param p_queue pointer to queue structure.
+ * @param p_link pointer to the element's link.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int queue_intrusive_enqueue (queue_intrusive_t * p_queue,
+                             queue_link_t * p_link);
+
+/**
+ * @brief Dequeues the oldest element.
+ * 
+ * @param p_queue pointer to queue structure.
+ * @return queue_link_t* pointer to the element's link, NULL if the queue is
+ * empty.
+ */
+queue_link_t * queue_intrusive_dequeue (queue_intrusive_t * p_queue);
+
 #endif //QUEUE_LIB
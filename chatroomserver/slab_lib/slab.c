@@ -0,0 +1,326 @@
+#include "slab.h"
+
+/**
+ * @brief One slot of a thread's table of caches.
+ *
+ * @param generation generation of the slab the cache belongs to.
+ * @param p_cache the thread's cache of that slab.
+ */
+typedef struct slab_slot_t {
+    uint64_t generation;
+    slab_cache_t * p_cache;
+} slab_slot_t;
+
+//Generations start at 1 so a zeroed slot never matches a slab.
+static uint64_t slab_generation = 0;
+
+static __thread slab_slot_t p_thread_slots[SLAB_THREAD_SLOTS];
+
+/**
+ * @brief Initializes a slab of objects of one size.
+ *
+ * @param object_size size of each object.
+ * @return slab_t* pointer to the slab. NULL returned on failure.
+ */
+slab_t *
+slab_init (size_t object_size)
+{
+    if (0 == object_size)
+    {
+        fprintf(stderr, "slab_init: object_size 0\n");
+        return NULL;
+    }
+
+    slab_t * p_slab = calloc(1, sizeof(slab_t));
+
+    if (NULL == p_slab)
+    {
+        perror("slab_init: p_slab calloc");
+        return NULL;
+    }
+
+    //NOTE: The header is 16 bytes and the stride a multiple of 16, so every
+    //object keeps malloc's alignment.
+    p_slab->object_size = object_size;
+    p_slab->stride = sizeof(slab_object_t) + ((object_size + 15) & ~15UL);
+    p_slab->chunk_size = SLAB_CHUNK_SIZE;
+
+    if ((p_slab->stride * SLAB_CHUNK_OBJECTS) > p_slab->chunk_size)
+    {
+        p_slab->chunk_size = p_slab->stride * SLAB_CHUNK_OBJECTS;
+    }
+
+    p_slab->generation = __atomic_add_fetch(&slab_generation, 1,
+                                                  __ATOMIC_RELAXED);
+
+    if (0 != pthread_mutex_init(&p_slab->slab_mutex, NULL))
+    {
+        perror("slab_init: pthread_mutex_init");
+        FREE(p_slab);
+        return NULL;
+    }
+
+    return p_slab;
+}
+
+/**
+ * @brief Finds the calling thread's cache, creating it on first use. A
+ * thread that starts with the id of a thread that exited takes over its
+ * cache, and with it the objects left there.
+ *
+ * @param p_slab pointer to the slab.
+ * @return slab_cache_t* the thread's cache. NULL returned on failure.
+ */
+static slab_cache_t *
+slab_cache (slab_t * p_slab)
+{
+    slab_slot_t * p_slot = &p_thread_slots[p_slab->generation %
+                                            SLAB_THREAD_SLOTS];
+
+    if (p_slab->generation == p_slot->generation)
+    {
+        return p_slot->p_cache;
+    }
+
+    pthread_t self = pthread_self();
+
+    pthread_mutex_lock(&p_slab->slab_mutex);
+
+    slab_cache_t * p_cache = p_slab->p_caches;
+
+    while ((NULL != p_cache) && (!pthread_equal(p_cache->owner, self)))
+    {
+        p_cache = p_cache->p_next;
+    }
+
+    if (NULL == p_cache)
+    {
+        p_cache = calloc(1, sizeof(slab_cache_t));
+
+        if (NULL == p_cache)
+        {
+            perror("slab_cache: p_cache calloc");
+            pthread_mutex_unlock(&p_slab->slab_mutex);
+            return NULL;
+        }
+
+        p_cache->p_slab = p_slab;
+        p_cache->owner = self;
+        p_cache->p_next = p_slab->p_caches;
+        p_slab->p_caches = p_cache;
+    }
+
+    pthread_mutex_unlock(&p_slab->slab_mutex);
+
+    p_slot->generation = p_slab->generation;
+    p_slot->p_cache = p_cache;
+
+    return p_cache;
+}
+
+/**
+ * @brief Takes a new chunk from the system and carves it into the cache's
+ * free list.
+ *
+ * @param p_cache pointer to the calling thread's cache.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+static int
+slab_grow (slab_cache_t * p_cache)
+{
+    slab_t * p_slab = p_cache->p_slab;
+
+    //NOTE: The chunk header takes the first 16 bytes so the objects after it
+    //stay aligned.
+    size_t header_size = (sizeof(slab_chunk_t) + 15) & ~15UL;
+    slab_chunk_t * p_chunk = malloc(header_size + p_slab->chunk_size);
+
+    if (NULL == p_chunk)
+    {
+        perror("slab_grow: p_chunk malloc");
+        return FAILURE;
+    }
+
+    pthread_mutex_lock(&p_slab->slab_mutex);
+    p_chunk->p_next = p_slab->p_chunks;
+    p_slab->p_chunks = p_chunk;
+    p_slab->chunks++;
+    pthread_mutex_unlock(&p_slab->slab_mutex);
+
+    char * p_start = (char *) p_chunk + header_size;
+    size_t count = p_slab->chunk_size / p_slab->stride;
+
+    for (size_t index = count; index > 0; index--)
+    {
+        slab_object_t * p_object = (slab_object_t *) (p_start +
+                                       ((index - 1) * p_slab->stride));
+
+        p_object->p_cache = p_cache;
+        p_object->p_next = p_cache->p_free;
+        p_cache->p_free = p_object;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Allocates a zeroed object from the calling thread's cache.
+ *
+ * @param p_slab pointer to the slab.
+ * @return void* pointer to the object. NULL returned on failure.
+ */
+void *
+slab_alloc (slab_t * p_slab)
+{
+    if (NULL == p_slab)
+    {
+        fprintf(stderr, "slab_alloc: p_slab NULL\n");
+        return NULL;
+    }
+
+    slab_cache_t * p_cache = slab_cache(p_slab);
+
+    if (NULL == p_cache)
+    {
+        return NULL;
+    }
+
+    if (NULL == p_cache->p_free)
+    {
+        p_cache->p_free = __atomic_exchange_n(&p_cache->p_remote, NULL,
+                                                      __ATOMIC_ACQUIRE);
+    }
+
+    if ((NULL == p_cache->p_free) && (SUCCESS != slab_grow(p_cache)))
+    {
+        return NULL;
+    }
+
+    slab_object_t * p_object = p_cache->p_free;
+
+    p_cache->p_free = p_object->p_next;
+    p_object->p_next = NULL;
+    __atomic_store_n(&p_cache->allocs, p_cache->allocs + 1,
+                                             __ATOMIC_RELAXED);
+
+    memset(p_object + 1, 0, p_cache->p_slab->object_size);
+
+    return p_object + 1;
+}
+
+/**
+ * @brief Frees an object to the cache of the thread that allocated it. Any
+ * thread may free any object.
+ *
+ * @param p_object pointer returned by slab_alloc. NULL is ignored.
+ */
+void
+slab_free (void * p_object)
+{
+    if (NULL == p_object)
+    {
+        return;
+    }
+
+    slab_object_t * p_header = (slab_object_t *) p_object - 1;
+    slab_cache_t * p_cache = p_header->p_cache;
+
+    __atomic_add_fetch(&p_cache->frees, 1, __ATOMIC_RELAXED);
+
+    if (pthread_equal(p_cache->owner, pthread_self()))
+    {
+        p_header->p_next = p_cache->p_free;
+        p_cache->p_free = p_header;
+        return;
+    }
+
+    //NOTE: Only the owner takes objects off the remote list, and it takes
+    //them all at once, so pushing needs no protection against ABA.
+    __atomic_add_fetch(&p_cache->remote_frees, 1, __ATOMIC_RELAXED);
+    p_header->p_next = __atomic_load_n(&p_cache->p_remote, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(&p_cache->p_remote,
+                                        &p_header->p_next, p_header, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/**
+ * @brief Reads the slab's counters.
+ *
+ * @param p_slab pointer to the slab.
+ * @param p_stats set to the counters.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+slab_stats (slab_t * p_slab, slab_stats_t * p_stats)
+{
+    if ((NULL == p_slab) || (NULL == p_stats))
+    {
+        fprintf(stderr, "slab_stats: input NULL\n");
+        return FAILURE;
+    }
+
+    memset(p_stats, 0, sizeof(slab_stats_t));
+    pthread_mutex_lock(&p_slab->slab_mutex);
+
+    for (slab_cache_t * p_cache = p_slab->p_caches; NULL != p_cache;
+                                            p_cache = p_cache->p_next)
+    {
+        p_stats->allocs += __atomic_load_n(&p_cache->allocs,
+                                             __ATOMIC_RELAXED);
+        p_stats->frees += __atomic_load_n(&p_cache->frees,
+                                            __ATOMIC_RELAXED);
+        p_stats->remote_frees += __atomic_load_n(&p_cache->remote_frees,
+                                                   __ATOMIC_RELAXED);
+    }
+
+    p_stats->chunks = p_slab->chunks;
+    p_stats->chunk_size = p_slab->chunk_size;
+    pthread_mutex_unlock(&p_slab->slab_mutex);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Frees every chunk and cache and destroys the slab. Objects still
+ * allocated from it must not be used or freed afterwards.
+ *
+ * @param pp_slab pointer to the slab pointer, set to NULL.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+slab_destroy (slab_t ** pp_slab)
+{
+    if ((NULL == pp_slab) || (NULL == *pp_slab))
+    {
+        fprintf(stderr, "slab_destroy: input NULL\n");
+        return FAILURE;
+    }
+
+    slab_t * p_slab = *pp_slab;
+
+    while (NULL != p_slab->p_chunks)
+    {
+        slab_chunk_t * p_chunk = p_slab->p_chunks;
+
+        p_slab->p_chunks = p_chunk->p_next;
+        FREE(p_chunk);
+    }
+
+    while (NULL != p_slab->p_caches)
+    {
+        slab_cache_t * p_cache = p_slab->p_caches;
+
+        p_slab->p_caches = p_cache->p_next;
+        FREE(p_cache);
+    }
+
+    pthread_mutex_destroy(&p_slab->slab_mutex);
+    FREE(*pp_slab);
+
+    return SUCCESS;
+}
+
+//End of slab.c library source file.
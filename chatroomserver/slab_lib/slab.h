@@ -0,0 +1,197 @@
+#ifndef SLAB_LIB
+#define SLAB_LIB
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifndef SHARED_MACROS
+#define SHARED_MACROS
+
+#define FREE(a) \
+    free(a); \
+    (a) = NULL
+
+//macros enabling clear returns from all functions.
+#define SUCCESS 0
+#define FAILURE 1
+#define FAILURE_NEGATIVE -1
+
+//NOTE: 512, 1024, 4096 are common buffer size chunks due to them being powers
+//of 2, efficiently using memory. 1024 is a nice middle ground for potential
+//packet sizes.
+#define BUFF_SIZE 1024
+
+#define CONTINUE 1
+#define STOP 0
+
+//filenames should not exceed 50 characters - this will enable some paths.
+#define FILE_NAME_MAX_LEN 50
+
+//Maximums for strings: IPv4 or IPv6 compatable.
+#define HOST_MAX_STRING 40 //Max IP length is (IPv6) 40 ->
+                           //7 colons + 32 hexadecimal digits + terminator.
+
+#define PORT_MAX_STRING 6 //Only numeric services allowed - max length of
+                          //65535 is 5 + terminator.
+
+//IP length + Port length - 1 (one less terminator) + 2 (: designator in code).
+#define ADDR_MAX_STRING (HOST_MAX_STRING + PORT_MAX_STRING + 1)
+
+#endif //SHARED_MACROS
+
+//NOTE: A slab hands out objects of one size. Every thread that allocates
+//gets its own cache with a private free list, so allocating and freeing on
+//the same thread takes no lock and touches no shared cache line. An object
+//freed by another thread is pushed (compare and swap) on its owning cache's
+//remote list, which the owner takes back in one exchange when its private
+//list runs dry. Memory comes from the system in chunks and goes back only
+//when the slab is destroyed.
+
+//Objects are carved out of chunks of at least this many bytes, and at least
+//SLAB_CHUNK_OBJECTS objects.
+#define SLAB_CHUNK_SIZE 65536
+#define SLAB_CHUNK_OBJECTS 8
+
+//Slots in each thread's table of caches. More live slabs than this still
+//work, a thread just looks its cache up under the slab mutex more often.
+#define SLAB_THREAD_SLOTS 32
+
+/**
+ * @brief Header in front of every object.
+ *
+ * @param p_cache cache of the thread that allocated the object.
+ * @param p_next next object on a free list.
+ */
+typedef struct slab_object_t {
+    struct slab_cache_t * p_cache;
+    struct slab_object_t * p_next;
+} slab_object_t;
+
+/**
+ * @brief One thread's objects of one slab.
+ *
+ * @param p_slab slab the cache belongs to.
+ * @param owner thread the cache belongs to.
+ * @param p_free objects only the owner allocates from and frees to.
+ * @param p_remote objects other threads freed, taken back by the owner.
+ * @param allocs objects the owner allocated.
+ * @param frees objects freed to p_free or p_remote.
+ * @param remote_frees objects freed to p_remote.
+ * @param p_next next cache of the slab.
+ */
+typedef struct slab_cache_t {
+    struct slab_t * p_slab;
+    pthread_t owner;
+    slab_object_t * p_free;
+    slab_object_t * p_remote;
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t remote_frees;
+    struct slab_cache_t * p_next;
+} slab_cache_t;
+
+/**
+ * @brief Chunk of memory objects are carved from.
+ *
+ * @param p_next next chunk of the slab.
+ */
+typedef struct slab_chunk_t {
+    struct slab_chunk_t * p_next;
+} slab_chunk_t;
+
+/**
+ * @brief Slab context.
+ *
+ * @param object_size size callers asked for.
+ * @param stride bytes per object, header included, a multiple of 16.
+ * @param chunk_size bytes per chunk.
+ * @param generation number no other slab of this process has, so a thread
+ * can not mistake a cache of a destroyed slab for one of this slab.
+ * @param p_caches every thread's cache.
+ * @param p_chunks every chunk.
+ * @param chunks number of chunks.
+ * @param slab_mutex guards p_caches, p_chunks and chunks.
+ */
+typedef struct slab_t {
+    size_t object_size;
+    size_t stride;
+    size_t chunk_size;
+    uint64_t generation;
+    slab_cache_t * p_caches;
+    slab_chunk_t * p_chunks;
+    uint64_t chunks;
+    pthread_mutex_t slab_mutex;
+} slab_t;
+
+/**
+ * @brief Counters of a slab, summed over its caches.
+ *
+ * @param allocs objects allocated.
+ * @param frees objects freed.
+ * @param remote_frees objects freed by a thread other than the one that
+ * allocated them.
+ * @param chunks chunks taken from the system.
+ * @param chunk_size bytes per chunk.
+ */
+typedef struct slab_stats_t {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t remote_frees;
+    uint64_t chunks;
+    size_t chunk_size;
+} slab_stats_t;
+
+/**
+ * @brief Initializes a slab of objects of one size.
+ *
+ * @param object_size size of each object.
+ * @return slab_t* pointer to the slab. NULL returned on failure.
+ */
+slab_t *
+slab_init (size_t object_size);
+
+/**
+ * @brief Allocates a zeroed object from the calling thread's cache.
+ *
+ * @param p_slab pointer to the slab.
+ * @return void* pointer to the object. NULL returned on failure.
+ */
+void *
+slab_alloc (slab_t * p_slab);
+
+/**
+ * @brief Frees an object to the cache of the thread that allocated it. Any
+ * thread may free any object.
+ *
+ * @param p_object pointer returned by slab_alloc. NULL is ignored.
+ */
+void
+slab_free (void * p_object);
+
+/**
+ * @brief Reads the slab's counters.
+ *
+ * @param p_slab pointer to the slab.
+ * @param p_stats set to the counters.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+slab_stats (slab_t * p_slab, slab_stats_t * p_stats);
+
+/**
+ * @brief Frees every chunk and cache and destroys the slab. Objects still
+ * allocated from it must not be used or freed afterwards.
+ *
+ * @param pp_slab pointer to the slab pointer, set to NULL.
+ * @return int SUCCESS or FAILURE (0 or 1, respectively) returned.
+ */
+int
+slab_destroy (slab_t ** pp_slab);
+
+#endif //SLAB_LIB
+
+//End of slab.h file
@@ -0,0 +1,168 @@
+#include "../include/cr_alloc.h"
+
+#include <stdlib.h>
+
+//NOTE: The slabs are made on first use and live as long as the process, so
+//an object can be freed at any point of shutdown without ordering against a
+//stop call. A class whose slab could not be made falls back to calloc and
+//free.
+static slab_t * p_class_slabs[ALLOC_CLASSES];
+static pthread_once_t classes_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Creates the slab of every size class.
+ */
+static void
+cr_alloc_init ()
+{
+    size_t class_size = ALLOC_MIN_CLASS;
+
+    for (int index = 0; index < ALLOC_CLASSES; index++)
+    {
+        p_class_slabs[index] = slab_init(class_size);
+
+        if (NULL == p_class_slabs[index])
+        {
+            CR_LOG_ERROR("cr_alloc_init: slab_init()");
+        }
+
+        class_size <<= 1;
+    }
+}
+
+/**
+ * @brief Finds the smallest size class an object fits in.
+ *
+ * @param size size of the object.
+ * @return int index of the class, -1 if the object is larger than every
+ * class.
+ */
+static int
+cr_alloc_class (size_t size)
+{
+    if (size > ALLOC_MAX_CLASS)
+    {
+        return FAILURE_NEGATIVE;
+    }
+
+    int index = 0;
+    size_t class_size = ALLOC_MIN_CLASS;
+
+    while (class_size < size)
+    {
+        class_size <<= 1;
+        index++;
+    }
+
+    return index;
+}
+
+/**
+ * @brief Allocates a zeroed object.
+ *
+ * @param size size of the object.
+ * @return void* pointer to the object. NULL returned on failure.
+ */
+void *
+cr_alloc (size_t size)
+{
+    pthread_once(&classes_once, cr_alloc_init);
+
+    int index = cr_alloc_class(size);
+
+    if ((FAILURE_NEGATIVE == index) || (NULL == p_class_slabs[index]))
+    {
+        return calloc(1, size);
+    }
+
+    return slab_alloc(p_class_slabs[index]);
+}
+
+/**
+ * @brief Frees an object from cr_alloc. Any thread may free it.
+ *
+ * @param p_object pointer to the object. NULL is ignored.
+ * @param size size passed to cr_alloc.
+ */
+void
+cr_free (void * p_object, size_t size)
+{
+    if (NULL == p_object)
+    {
+        return;
+    }
+
+    //NOTE: The object came from cr_alloc, which ran the once already.
+    int index = cr_alloc_class(size);
+
+    if ((FAILURE_NEGATIVE == index) || (NULL == p_class_slabs[index]))
+    {
+        free(p_object);
+        return;
+    }
+
+    slab_free(p_object);
+}
+
+/**
+ * @brief Allocates a zeroed object that starts on a cache line, for structs
+ * laid out by cache line (user_t, room_t). Free it with free or FREE.
+ *
+ * @param size size of the object.
+ * @return void* pointer to the object. NULL returned on failure.
+ */
+void *
+cr_alloc_aligned (size_t size)
+{
+    void * p_object = NULL;
+    int return_val = posix_memalign(&p_object, CACHE_LINE_SIZE, size);
+
+    if (SUCCESS != return_val)
+    {
+        errno = return_val;
+        return NULL;
+    }
+
+    memset(p_object, 0, size);
+
+    return p_object;
+}
+
+/**
+ * @brief Reads the counters of every size class added together.
+ *
+ * @param p_stats set to the counters.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_alloc_stats (slab_stats_t * p_stats)
+{
+    if (NULL == p_stats)
+    {
+        CR_LOG_ERROR("cr_alloc_stats: input NULL");
+        return FAILURE;
+    }
+
+    pthread_once(&classes_once, cr_alloc_init);
+    memset(p_stats, 0, sizeof(slab_stats_t));
+
+    for (int index = 0; index < ALLOC_CLASSES; index++)
+    {
+        slab_stats_t class_stats;
+
+        if ((NULL == p_class_slabs[index]) ||
+            (SUCCESS != slab_stats(p_class_slabs[index], &class_stats)))
+        {
+            continue;
+        }
+
+        p_stats->allocs += class_stats.allocs;
+        p_stats->frees += class_stats.frees;
+        p_stats->remote_frees += class_stats.remote_frees;
+        p_stats->chunks += class_stats.chunks;
+    }
+
+    return SUCCESS;
+}
+
+//End of cr_alloc.c file
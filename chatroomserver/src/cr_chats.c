@@ -11,7 +11,7 @@ cr_chats_rotate_file (room_t * p_room)
 {
     if (NULL == p_room)
     {
-        fprintf(stderr, "cr_chats_rotate_file: input NULL\n");
+        CR_LOG_ERROR("cr_chats_rotate_file: input NULL");
         return FAILURE;
     }
 
@@ -20,7 +20,7 @@ cr_chats_rotate_file (room_t * p_room)
     snprintf(p_room_location_b, (strlen(p_room->p_room_location) + 4),
                                    "%s.log", p_room->p_room_location);
 
-    char line_buffer[MAX_USERNAME_LENGTH + MAX_CHAT_LEN + 2] = {0};
+    char line_buffer[MAX_LOG_LINE_LENGTH + 2] = {0};
 
     FILE * file_pointer;
     FILE * file_pointer_2;
@@ -30,7 +30,7 @@ cr_chats_rotate_file (room_t * p_room)
 
     if ((NULL == file_pointer) || (NULL == file_pointer_2))
     {
-        perror("cr_chats_rotate_file: fopen");
+        CR_LOG_ERRNO("cr_chats_rotate_file: fopen");
         return FAILURE;
     }
 
@@ -47,19 +47,19 @@ cr_chats_rotate_file (room_t * p_room)
 
     if (EOF == fclose(file_pointer))
     {
-        perror("cr_chats_rotate_file: fclose:");
+        CR_LOG_ERRNO("cr_chats_rotate_file: fclose:");
         return FAILURE;
     }
 
     if (EOF == fclose(file_pointer_2))
     {
-        perror("cr_chats_rotate_file: fclose:");
+        CR_LOG_ERRNO("cr_chats_rotate_file: fclose:");
         return FAILURE;
     }
     
     if (FAILURE_NEGATIVE == rename(p_room_location_b, p_room->p_room_location))
     {
-        perror("cr_chats_rotate_file: rename:");
+        CR_LOG_ERRNO("cr_chats_rotate_file: rename:");
         return FAILURE;
     }
 
@@ -68,46 +68,71 @@ cr_chats_rotate_file (room_t * p_room)
 
 /**
  * @brief Enters the chat that the user has sent the message to, to the
- * log file.
+ * log file, prefixed with its room sequence number.
  * 
  * @param p_room pointer to room the client is in.
- * @param p_username client username.
+ * @param p_sender sender's interned username.
  * @param p_chat message received from the client.
+ * @param seq room sequence number assigned to the chat.
  * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
  */
 static int
-cr_chats_chat_file (room_t * p_room, char * p_username, char * p_chat)
+cr_chats_chat_file (room_t * p_room, const cr_name_t * p_sender,
+                                     char * p_chat, uint64_t seq)
 {
-    if ((NULL == p_room) || (NULL == p_username) || (NULL == p_chat))
+    if ((NULL == p_room) || (NULL == p_sender) || (NULL == p_chat))
     {
-        fprintf(stderr, "cr_chats_chat_file: input NULL\n");
+        CR_LOG_ERROR("cr_chats_chat_file: input NULL");
         return FAILURE;
     }
 
-    FILE * file_pointer = fopen(p_room->p_room_location, "a");
+    //NOTE: Probe arguments must be scalars or pointers, not arrays.
+    const char * p_room_name = p_room->p_name->p_bytes;
 
-    if (NULL == file_pointer)
+    cr_trace_record(TRACE_LOG_APPEND_BEGIN, 0, seq);
+    CR_PROBE(log_append_begin, p_room_name, seq);
+    //NOTE: The line is built on the stack and appended with one write, so
+    //logging a chat does not allocate a stdio stream and its buffer.
+    char p_line[CHAT_LINE_MAX];
+    int line_len = snprintf(p_line, sizeof(p_line), "%" PRIu64 " %.*s>%.*s\n",
+                            seq, (int) p_sender->length, p_sender->p_bytes,
+                            MAX_CHAT_LEN, p_chat);
+
+    if ((0 > line_len) || ((size_t) line_len >= sizeof(p_line)))
     {
-        perror("cr_chats_chat_file: fopen");
+        CR_LOG_ERROR("cr_chats_chat_file: snprintf");
+        cr_trace_record(TRACE_LOG_APPEND_END, 0, 0);
+        CR_PROBE(log_append_end, p_room_name, seq);
         return FAILURE;
     }
 
-    fputs(p_username, file_pointer);
-    fputc('>', file_pointer);
-    fputs(p_chat, file_pointer);
-    fputc('\n', file_pointer);
+    int file_fd = open(p_room->p_room_location, O_WRONLY | O_APPEND | O_CREAT,
+                                                                      0666);
 
-    if (EOF == fclose(file_pointer))
+    if (FAILURE_NEGATIVE == file_fd)
     {
-        perror("cr_chats_chat_file: fclose:");
+        CR_LOG_ERRNO("cr_chats_chat_file: open");
+        cr_trace_record(TRACE_LOG_APPEND_END, 0, 0);
+        CR_PROBE(log_append_end, p_room_name, seq);
         return FAILURE;
     }
 
+    ssize_t written = write(file_fd, p_line, line_len);
     struct stat file_info;
+    int stat_val = fstat(file_fd, &file_info);
+    int close_val = close(file_fd);
+    cr_trace_record(TRACE_LOG_APPEND_END, 0, 0);
+    CR_PROBE(log_append_end, p_room_name, seq);
+
+    if ((line_len != written) || (SUCCESS != close_val))
+    {
+        CR_LOG_ERRNO("cr_chats_chat_file: write:");
+        return FAILURE;
+    }
 
-    if (SUCCESS != stat(p_room->p_room_location, &file_info))
+    if (SUCCESS != stat_val)
     {
-        perror("cr_chats_chat_file: stat");
+        CR_LOG_ERRNO("cr_chats_chat_file: fstat");
         return FAILURE;
     }
 
@@ -115,9 +140,15 @@ cr_chats_chat_file (room_t * p_room, char * p_username, char * p_chat)
 
     if (file_size > MAX_CHAT_FILE_SIZE)
     {
-        if (FAILURE == cr_chats_rotate_file (p_room))
+        cr_trace_record(TRACE_LOG_ROTATE_BEGIN, 0, 0);
+        CR_PROBE(log_rotate_begin, p_room_name);
+        int rotate_val = cr_chats_rotate_file (p_room);
+        cr_trace_record(TRACE_LOG_ROTATE_END, 0, 0);
+        CR_PROBE(log_rotate_end, p_room_name, rotate_val);
+
+        if (FAILURE == rotate_val)
         {
-            fprintf(stderr, "cr_chats_chat_file: cr_chats_rotate_file()\n");
+            CR_LOG_ERROR("cr_chats_chat_file: cr_chats_rotate_file()");
             return FAILURE;
         }
     }
@@ -126,58 +157,244 @@ cr_chats_chat_file (room_t * p_room, char * p_username, char * p_chat)
 }
 
 /**
- * @brief Sends the received chat to all other users in the chat room.
+ * @brief Reads the log of a room loaded from the room catalog the first time
+ * the room is used, and sets the room's chat sequence number from its last
+ * line. Does nothing for a room whose log was already read. A missing log is
+ * created empty.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room_t struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_chats_page_in (room_t * p_room)
+{
+    if (NULL == p_room)
+    {
+        CR_LOG_ERROR("cr_chats_page_in: input NULL");
+        return FAILURE;
+    }
+
+    if (!p_room->log_cold)
+    {
+        return SUCCESS;
+    }
+
+    //NOTE: "a+" reads from the start and creates a log lost since the
+    //catalog was written.
+    FILE * file_pointer = fopen(p_room->p_room_location, "a+");
+
+    if (NULL == file_pointer)
+    {
+        CR_LOG_ERRNO("cr_chats_page_in: fopen");
+        return FAILURE;
+    }
+
+    char line_buffer[MAX_LOG_LINE_LENGTH + 2] = {0};
+    uint64_t last_seq = 0;
+
+    //NOTE: Lines are in sequence order, so the last one holds the room's
+    //sequence number.
+    while (NULL != fgets(line_buffer, sizeof(line_buffer), file_pointer))
+    {
+        uint64_t seq = strtoull(line_buffer, NULL, BASE10);
+        last_seq = (seq > last_seq) ? seq : last_seq;
+    }
+
+    if (EOF == fclose(file_pointer))
+    {
+        CR_LOG_ERRNO("cr_chats_page_in: fclose:");
+        return FAILURE;
+    }
+
+    p_room->chat_seq = last_seq;
+    p_room->log_cold = 0;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Copies the log lines of a room that are newer than a specified
+ * sequence number into a buffer. Lines are stored in sequence order, so the
+ * copy starts at the first line past since and runs to the end of the log.
  * 
  * WARNING: Calling function must lock the room's mutex before use and
  * unlock after use.
  * 
+ * @param p_room pointer to room_t struct.
+ * @param since last sequence number the client holds (0 for all).
+ * @param p_history buffer the log lines are copied into.
+ * @param history_size size of p_history.
+ * @return int number of bytes copied or FAILURE_NEGATIVE (-1).
+ */
+int
+cr_chats_history (room_t * p_room, uint64_t since, char * p_history,
+                                                     size_t history_size)
+{
+    if ((NULL == p_room) || (NULL == p_history))
+    {
+        CR_LOG_ERROR("cr_chats_history: input NULL");
+        return FAILURE_NEGATIVE;
+    }
+
+    FILE * file_pointer = fopen(p_room->p_room_location, "r");
+
+    if (NULL == file_pointer)
+    {
+        CR_LOG_ERRNO("cr_chats_history: fopen");
+        return FAILURE_NEGATIVE;
+    }
+
+    char line_buffer[MAX_LOG_LINE_LENGTH + 2] = {0};
+    size_t history_len = 0;
+
+    while (NULL != fgets(line_buffer, sizeof(line_buffer), file_pointer))
+    {
+        size_t line_len = strlen(line_buffer);
+
+        if (since >= strtoull(line_buffer, NULL, BASE10))
+        {
+            continue;
+        }
+
+        //NOTE: The log is rotated once it passes MAX_CHAT_FILE_SIZE, so this
+        //only trips if the file was edited by hand.
+        if ((history_len + line_len) > history_size)
+        {
+            break;
+        }
+
+        memcpy((p_history + history_len), line_buffer, line_len);
+        history_len += line_len;
+    }
+
+    if (EOF == fclose(file_pointer))
+    {
+        CR_LOG_ERRNO("cr_chats_history: fclose:");
+        return FAILURE_NEGATIVE;
+    }
+
+    return (int) history_len;
+}
+
+/**
+ * @brief Sends the received chat to all other users in the chat room.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
  * @param p_room pointer to room the client is in.
  * @param p_user pointer to current user struct.
  * @param p_chat message received from the client.
+ * @param seq room sequence number of the chat (0 for room notices).
  * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
  */
 int
-cr_chats_chat_send (room_t * p_room, user_t * p_user, char * p_chat)
+cr_chats_chat_send (room_t * p_room, user_t * p_user, char * p_chat,
+                                                        uint64_t seq)
 {
     if ((NULL == p_room) || (NULL == p_user) || (NULL == p_chat))
     {
-        fprintf(stderr, "cr_chats_chat_send: input NULL\n");
+        CR_LOG_ERROR("cr_chats_chat_send: input NULL");
         return FAILURE;
     }
 
-    int return_val;
+    int return_val = SUCCESS;
 
-    if (EMPTY == p_room->p_users->size)
+    if (EMPTY == p_room->members.size)
     {
         return SUCCESS;
     }
 
-    for (int user_num = 0; user_num < p_room->p_users->size; user_num++)
-    {
-        user_t * p_temp_user = cll_return_element(p_room->p_users, user_num);
+    //NOTE: Probe arguments must be scalars or pointers, not arrays.
+    const char * p_room_name = p_room->p_name->p_bytes;
 
-        if (NULL == p_temp_user)
-        {
-            fprintf(stderr, "cr_chats_chat_send: cll_return_element\n");
-            return FAILURE;
-        }
+    CR_PROBE(broadcast_begin, p_room_name, seq, p_room->members.size);
+
+    CLL_INTRUSIVE_FOR_EACH(p_link, &p_room->members)
+    {
+        user_t * p_temp_user = CLL_CONTAINER(p_link, user_t, room_link);
 
         //NOTE: The message should be sent to all users in the room except
         //the sender.
         if (p_user != p_temp_user)
         {
             return_val = cr_msg_send_update(p_temp_user->p_ssl_holder->p_ssl,
-                                                 p_user->p_username, p_chat);
+                                            p_user->p_name, p_chat, seq);
             
             if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
             {
-                fprintf(stderr, "cr_chats_chat_send: cr_msg_send_update()\n");
-                return return_val;
+                CR_LOG_ERROR("cr_chats_chat_send: cr_msg_send_update()");
+                break;
             }
+
+            return_val = SUCCESS;
         }
     }
 
-    return SUCCESS;
+    CR_PROBE(broadcast_end, p_room_name, seq, return_val);
+
+    return return_val;
+}
+
+/**
+ * @brief Gives a chat the room's next sequence number, adds it to the log
+ * file, sends it to all other users in the room and acknowledges it to the
+ * sender.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room the client is in.
+ * @param p_user pointer to current user struct.
+ * @param p_chat message received from the client.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_chats_chat_room (room_t * p_room, user_t * p_user, char * p_chat)
+{
+    if ((NULL == p_room) || (NULL == p_user) || (NULL == p_chat))
+    {
+        CR_LOG_ERROR("cr_chats_chat_room: input NULL");
+        return FAILURE;
+    }
+
+    if (FAILURE == cr_chats_page_in(p_room))
+    {
+        CR_LOG_ERROR("cr_chats_chat_room: cr_chats_page_in()");
+        return FAILURE;
+    }
+
+    uint64_t seq = ++p_room->chat_seq;
+    cr_stats_room_chat(p_room);
+
+    int return_val = cr_chats_chat_file(p_room, p_user->p_name, p_chat, seq);
+
+    int return_val_2 = cr_chats_chat_send(p_room, p_user, p_chat, seq);
+
+    //NOTE: The sender is told the chat's sequence number so it can keep its
+    //own chat in its history. Senders on other nodes have no connection here.
+    if ((NULL != p_user->p_ssl_holder) &&
+        (SUCCESS != cr_msg_send_chat_ack(p_user->p_ssl_holder->p_ssl,
+                                         p_user->p_name, p_chat, seq)))
+    {
+        CR_LOG_ERROR("cr_chats_chat_room: cr_msg_send_chat_ack()");
+    }
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_chats_chat_room: cr_chats_chat_file()");
+        return return_val;
+    }
+
+    if ((FAILURE == return_val_2) || (CONNECTION_FAILURE == return_val_2))
+    {
+        CR_LOG_ERROR("cr_chats_chat_room: cr_chats_chat_send()");
+    }
+
+    return return_val_2;
 }
 
 /**
@@ -194,7 +411,7 @@ cr_chats_chat (rooms_t * p_rooms, user_t * p_user, char * p_buffer)
 {
     if ((NULL == p_rooms) || (NULL == p_user) || (NULL == p_buffer))
     {
-        fprintf(stderr, "cr_chats_chat: input NULL\n");
+        CR_LOG_ERROR("cr_chats_chat: input NULL");
         return FAILURE;
     }
 
@@ -203,138 +420,116 @@ cr_chats_chat (rooms_t * p_rooms, user_t * p_user, char * p_buffer)
     memcpy(&chat_req, p_buffer, sizeof(chat_t));
     chat_req.p_chat[MAX_CHAT_LEN] = '\0';
 
-    if (SUCCESS != pthread_mutex_lock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_chats_chat: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_chats_chat: pthread_mutex_lock:");
         return FAILURE;
     }
 
-    room_t * p_room = h_table_return_entry(p_rooms->p_rooms_table,
-                                             p_user->p_chat_room);
+    room_t * p_room = (NULL == p_user->p_room_name) ? NULL :
+                      h_table_return_entry(p_rooms->p_rooms_table,
+                                           p_user->p_room_name->p_bytes);
 
-    if (SUCCESS != pthread_mutex_unlock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_chats_chat: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_chats_chat: pthread_mutex_unlock:");
         return FAILURE;
     }
 
     if (NULL == p_room)
     {
-        fprintf(stderr, "cr_chats_chat: room not found error\n");
+        CR_LOG_ERROR("cr_chats_chat: room not found error");
         return FAILURE;
     }
 
-    if (SUCCESS != pthread_mutex_lock(&p_room->room_mutex))
+    cr_cluster_chat(p_room->p_name->p_bytes, p_user->p_name->p_bytes,
+                                              chat_req.p_chat);
+
+    //NOTE: The room's owner logs and sends the chat, the sender does not
+    //wait for it.
+    if (cr_shards_on())
     {
-        perror("cr_chats_chat: pthread_mutex_lock:");
-        return FAILURE;
+        return cr_shards_chat(p_room, p_user, chat_req.p_chat);
     }
 
-    int return_val = cr_chats_chat_file(p_room, p_user->p_username,
-                                                  chat_req.p_chat);
-
-    int return_val_2 = cr_chats_chat_send(p_room, p_user, chat_req.p_chat);
-
-    if (SUCCESS != pthread_mutex_unlock(&p_room->room_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(&p_room->room_mutex))
     {
-        perror("cr_chats_chat: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_chats_chat: pthread_mutex_lock:");
         return FAILURE;
     }
 
-    if (FAILURE == return_val)
-    {
-        fprintf(stderr, "cr_chats_chat: cr_chats_chat_file()\n");
-        return return_val;
-    }
+    int return_val = cr_chats_chat_room(p_room, p_user, chat_req.p_chat);
 
-    if ((FAILURE == return_val_2) || (CONNECTION_FAILURE == return_val_2))
+    if (SUCCESS != CR_MUTEX_UNLOCK(&p_room->room_mutex))
     {
-        fprintf(stderr, "cr_chats_chat: cr_chats_chat_send()\n");
+        CR_LOG_ERRNO("cr_chats_chat: pthread_mutex_unlock:");
+        return FAILURE;
     }
 
-    return return_val_2;
+    return return_val;
 }
 
 /**
- * @brief Find the position of the specified user.
+ * @brief finds a specified user within the room_t struct's list and removes
+ * them.
  * 
- * @param p_cll pointer to cll context with room's users.
+ * @param p_room pointer to room_t struct.
  * @param p_user specified user.
- * @return int position value or FAILURE_NEGATIVE (-1).
+ * @return int SUCCESS (0) or FAILURE (1).
  */
 static int
-cr_chats_find_user (cll_t * p_cll, user_t * p_user)
+cr_chats_leave_helper (room_t * p_room, user_t * p_user)
 {
-    if ((NULL == p_cll) || (NULL == p_user))
+    if ((NULL == p_room) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_chats_find_user: input NULL\n");
-        return FAILURE_NEGATIVE;
+        CR_LOG_ERROR("cr_chats_leave_helper: input NULL");
+        return FAILURE;
     }
 
-    if (NULL == p_cll->p_head)
+    if (FAILURE == cll_intrusive_remove(&p_room->members, &p_user->room_link))
     {
-        fprintf(stderr, "cr_chats_find_user: p_cll head NULL\n");
-        return FAILURE_NEGATIVE;
+        CR_LOG_ERROR("cr_chats_leave_helper: cll_intrusive_remove");
+        return FAILURE;
     }
 
-    int counter = 0;
-    node_t * p_temp = p_cll->p_head;
-
-    while (counter <= p_cll->size)
-    {
-        user_t * p_temp_user = p_temp->p_data;
-        
-        if (p_user == p_temp_user)
-        {
-            return counter;
-        }
-
-        counter++;
-
-        if (NULL == p_temp->p_next)
-        {
-            fprintf(stderr, "cr_chats_find_user: p_cll node NULL\n");
-            return FAILURE_NEGATIVE;
-        }
-
-        p_temp = p_temp->p_next;
-    }
+    cr_stats_room_members(p_room);
+    cr_cluster_room_left(p_room->p_name->p_bytes);
 
-    return FAILURE_NEGATIVE;
+    return SUCCESS;
 }
 
 /**
- * @brief finds a specified user within the room_t struct's list and removes
- * them.
+ * @brief Removes a user from a room and tells the other users they left.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
  * 
  * @param p_room pointer to room_t struct.
  * @param p_user specified user.
  * @return int SUCCESS (0) or FAILURE (1).
  */
-static int
-cr_chats_leave_helper (room_t * p_room, user_t * p_user)
+int
+cr_chats_leave_room (room_t * p_room, user_t * p_user)
 {
     if ((NULL == p_room) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_chats_leave_helper: input NULL\n");
+        CR_LOG_ERROR("cr_chats_leave_room: input NULL");
         return FAILURE;
     }
 
-    int position = cr_chats_find_user(p_room->p_users, p_user);
+    int return_val = cr_chats_leave_helper(p_room, p_user);
 
-    if (FAILURE_NEGATIVE == position)
-    {
-        fprintf(stderr, "cr_chats_leave_helper: cr_chats_find_user\n");
-        return FAILURE;
-    }
+    char * left_message = "User has left the room";
 
-    if (FAILURE == cll_remove_element(p_room->p_users, position, NULL))
+    int return_val_2 = cr_chats_chat_send(p_room, p_user, left_message, 0);
+
+    //NOTE: Checks success of chat update send.
+    if ((FAILURE == return_val_2) || (CONNECTION_FAILURE == return_val_2))
     {
-        fprintf(stderr, "cr_chats_leave_helper: cll_remove_element\n");
-        return FAILURE;
+        CR_LOG_ERROR("cr_chats_leave_room: cr_chats_chat_send()");
     }
 
-    return SUCCESS;
+    return return_val;
 }
 
 /**
@@ -357,66 +552,64 @@ cr_chats_leave (rooms_t * p_rooms, int * p_chatting, user_t * p_user,
 {
     if ((NULL == p_rooms) || (NULL == p_chatting) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_chats_leave: input NULL\n");
+        CR_LOG_ERROR("cr_chats_leave: input NULL");
         return FAILURE;
     }
 
     int return_val = SUCCESS;
 
 
-    if (SUCCESS != pthread_mutex_lock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_chats_leave: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_chats_leave: pthread_mutex_lock:");
         return FAILURE;
     }
 
-    room_t * p_room = h_table_return_entry(p_rooms->p_rooms_table,
-                                             p_user->p_chat_room);
+    room_t * p_room = (NULL == p_user->p_room_name) ? NULL :
+                      h_table_return_entry(p_rooms->p_rooms_table,
+                                           p_user->p_room_name->p_bytes);
 
-    if (SUCCESS != pthread_mutex_unlock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_chats_leave: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_chats_leave: pthread_mutex_unlock:");
         return FAILURE;
     }
 
     if (NULL == p_room)
     {
-        fprintf(stderr, "cr_chats_leave: h_table_return_entry");
+        CR_LOG_ERROR("cr_chats_leave: h_table_return_entry");
         return FAILURE;
     }
 
-    if (SUCCESS != pthread_mutex_lock(&p_room->room_mutex))
+    if (cr_shards_on())
     {
-        perror("cr_chats_leave: pthread_mutex_lock:");
-        return FAILURE;
+        return_val = cr_shards_leave(p_room, p_user);
     }
-    
-    return_val = cr_chats_leave_helper(p_room, p_user);
-
-    char * left_message = "User has left the room";
+    else
+    {
+        if (SUCCESS != CR_MUTEX_LOCK(&p_room->room_mutex))
+        {
+            CR_LOG_ERRNO("cr_chats_leave: pthread_mutex_lock:");
+            return FAILURE;
+        }
 
-    int return_val_2 = cr_chats_chat_send(p_room, p_user, left_message);
+        return_val = cr_chats_leave_room(p_room, p_user);
 
-    if (SUCCESS != pthread_mutex_unlock(&p_room->room_mutex))
-    {
-        perror("cr_chats_leave: pthread_mutex_unlock:");
-        return FAILURE;
+        if (SUCCESS != CR_MUTEX_UNLOCK(&p_room->room_mutex))
+        {
+            CR_LOG_ERRNO("cr_chats_leave: pthread_mutex_unlock:");
+            return FAILURE;
+        }
     }
 
     //NOTE: Checks whether leave helper was successful or not. Mutex had to be
     //unlocked first.
     if (FAILURE == return_val)
     {
-        fprintf(stderr, "cr_chats_leave: cr_chats_r_user_f_room\n");
+        CR_LOG_ERROR("cr_chats_leave: cr_chats_leave_room()");
         return FAILURE;
     }
 
-    //NOTE: Checks success of chat update send.
-    if ((FAILURE == return_val_2) || (CONNECTION_FAILURE == return_val_2))
-    {
-        fprintf(stderr, "cr_chats_leave: cr_msg_send_ack()\n");
-    }
-
     //NOTE: Utilized by quit while in the chatting state. Quit ack will be sent
     //and, as such, no leave ack is required.
     if (SEND_IT == send_message)
@@ -425,15 +618,103 @@ cr_chats_leave (rooms_t * p_rooms, int * p_chatting, user_t * p_user,
         
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_chats_leave: cr_msg_send_ack()\n");
+            CR_LOG_ERROR("cr_chats_leave: cr_msg_send_ack()");
         }
     }
 
-    memset(p_user->p_chat_room, 0, sizeof(p_user->p_chat_room));
+    p_user->p_room_name = NULL;
 
     *p_chatting = NOT_CHATTING;
     
     return return_val;
 }
 
+/**
+ * @brief Logs a chat sent on another cluster node and sends it to every
+ * member of the room here. The chat gets this node's next sequence number
+ * for the room.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @param p_username sender's username.
+ * @param p_chat chat text.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_chats_remote (rooms_t * p_rooms, char * p_room_name, char * p_username,
+                                                          char * p_chat)
+{
+    if ((NULL == p_rooms) || (NULL == p_room_name) || (NULL == p_username) ||
+        (NULL == p_chat))
+    {
+        CR_LOG_ERROR("cr_chats_remote: input NULL");
+        return FAILURE;
+    }
+
+    int return_val = SUCCESS;
+
+    //NOTE: p_rooms_mutex is held throughout so the room cannot be deleted
+    //before the chat is posted to its owner or sent.
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_chats_remote: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    room_t * p_room = h_table_return_entry(p_rooms->p_rooms_table,
+                                                     p_room_name);
+
+    //NOTE: The sender need not be a user here, so the reference is only
+    //held until the chat is handled, by the room's owner when there are
+    //room workers.
+    const cr_name_t * p_sender = cr_names_intern(p_username,
+                                                 MAX_USERNAME_LENGTH);
+
+    if (NULL == p_sender)
+    {
+        CR_LOG_WARN("cr_chats_remote: bad sender name");
+        p_room = NULL;
+    }
+
+    if ((NULL != p_room) && cr_shards_on())
+    {
+        return_val = cr_shards_chat_remote(p_room, p_sender, p_chat);
+
+        if (FAILURE == return_val)
+        {
+            cr_names_release(p_sender);
+        }
+    }
+    else if (NULL != p_room)
+    {
+        //NOTE: The sender is not a member here, so every member is sent
+        //the chat.
+        user_t remote_user;
+        memset(&remote_user, 0, sizeof(user_t));
+        remote_user.p_name = p_sender;
+
+        CR_MUTEX_LOCK(&p_room->room_mutex);
+        return_val = cr_chats_chat_room(p_room, &remote_user, p_chat);
+        CR_MUTEX_UNLOCK(&p_room->room_mutex);
+        cr_names_release(p_sender);
+    }
+    else
+    {
+        cr_names_release(p_sender);
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_chats_remote: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_chats_remote: cr_chats_chat_room()");
+    }
+
+    return (FAILURE == return_val) ? FAILURE : SUCCESS;
+}
+
 //End of cr_chats.c file
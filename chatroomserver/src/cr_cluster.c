@@ -0,0 +1,1743 @@
+#include "../include/cr_cluster.h"
+#include "../include/cr_users.h"
+#include "../include/cr_rooms.h"
+
+//Frame types. A frame is a 16 bit big endian length of what follows, a type
+//byte, then the type's fields. Strings are a length byte and the characters.
+#define BUS_HELLO 0    //node id byte
+#define BUS_ROOM_ADD 1 //room name
+#define BUS_ROOM_DEL 2 //room name
+#define BUS_USER_ADD 3 //username, password
+#define BUS_USER_DEL 4 //username
+#define BUS_SUB 5      //room name
+#define BUS_UNSUB 6    //room name
+#define BUS_CHAT 7     //room name, username, chat
+
+//Length field plus type byte.
+#define BUS_HEADER_SIZE 3
+
+#define CLUSTER_BIT(id) (1u << ((id) - 1))
+
+typedef struct {
+    uint8_t id;
+    char    p_host[HOST_MAX_STRING + 1];
+    char    p_port[PORT_MAX_STRING + 1];
+} cluster_node_t;
+
+//NOTE: A node this node sends to. Frames are added to p_send_buffer, and the
+//sender swaps it with p_write_buffer and writes everything gathered in one
+//go, so frames queued while a write is under way share the next one.
+//connected, send_len, dropped and p_send_buffer are guarded by mutex. Only
+//the sender touches refused.
+typedef struct {
+    cluster_node_t  node;
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    int             connected;
+    int             refused; //NOTE: Last handshake failed, already logged.
+    uint32_t        send_len;
+    uint64_t        dropped;
+    char          * p_send_buffer;
+    char          * p_write_buffer;
+    char            pp_buffers[2][CLUSTER_SEND_SIZE];
+} cluster_peer_t;
+
+//NOTE: A connection a node sends to this node on. Only the receiver thread
+//touches these. The socket is non blocking, and the handshake is finished
+//by the first reads.
+typedef struct {
+    int                     fd;
+    SSL                   * p_ssl;
+    struct sockaddr_storage addr;
+    time_t                  opened; //NOTE: CLOCK_MONOTONIC seconds.
+    uint8_t                 node_id; //NOTE: CLUSTER_OFF until hello.
+    uint32_t                recv_len;
+    char                    p_recv_buffer[CLUSTER_RECV_SIZE];
+} cluster_link_t;
+
+//NOTE: Routing table entry. peers has a bit for each node with members in
+//the room, local counts this node's members. Guarded by route_mutex.
+typedef struct {
+    char     p_room_name[MAX_ROOM_NAME_LENGTH + 1];
+    uint32_t peers;
+    uint32_t local;
+} cluster_route_t;
+
+static volatile int running = STOP;
+static uint8_t self_id = CLUSTER_OFF;
+static int listen_fd = FAILURE_NEGATIVE;
+static pthread_t recv_thread;
+static users_t * p_cluster_users = NULL;
+static rooms_t * p_cluster_rooms = NULL;
+static SSL_CTX * p_dial_ctx = NULL;
+static SSL_CTX * p_accept_ctx = NULL;
+
+//NOTE: Every node in cluster.txt, kept to check where connections come from.
+static cluster_node_t p_nodes[CLUSTER_MAX_NODES];
+static uint8_t node_count = 0;
+static cluster_node_t * p_self = NULL;
+
+//NOTE: Static so sessions still running while the server stops can call the
+//publishers after cr_cluster_stop. Untouched peers cost no memory.
+static cluster_peer_t p_peers[CLUSTER_MAX_NODES - 1];
+static uint8_t peer_count = 0;
+static cluster_link_t p_links[CLUSTER_MAX_NODES];
+static int link_refused = 0; //NOTE: A handshake failed, already logged.
+
+static pthread_mutex_t route_mutex = PTHREAD_MUTEX_INITIALIZER;
+static cluster_route_t p_routes[CLUSTER_MAX_ROOMS];
+
+/**
+ * @brief Reads the nodes from cluster.txt. Each line is id:host:port, blank
+ * lines and lines starting with # are skipped.
+ *
+ * @param p_nodes array of CLUSTER_MAX_NODES nodes to fill.
+ * @param p_count set to the number of nodes read.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_cluster_read_nodes (cluster_node_t * p_nodes, uint8_t * p_count)
+{
+    FILE * file_pointer = fopen(CLUSTER_FILENAME, "r");
+
+    if (NULL == file_pointer)
+    {
+        CR_LOG_ERRNO("cr_cluster_read_nodes: fopen");
+        return FAILURE;
+    }
+
+    char line_buffer[BUFF_SIZE] = {0};
+    int return_val = SUCCESS;
+
+    *p_count = 0;
+
+    while (NULL != fgets(line_buffer, sizeof(line_buffer), file_pointer))
+    {
+        line_buffer[strcspn(line_buffer, "\r\n")] = '\0';
+
+        if (('\0' == line_buffer[0]) || ('#' == line_buffer[0]))
+        {
+            continue;
+        }
+
+        //NOTE: The port follows the last colon so IPv6 hosts can be used.
+        char * p_host = strchr(line_buffer, ':');
+        char * p_port = strrchr(line_buffer, ':');
+
+        if ((NULL == p_host) || (p_host == p_port))
+        {
+            CR_LOG_ERROR("cr_cluster_read_nodes: bad line: %s", line_buffer);
+            return_val = FAILURE;
+            break;
+        }
+
+        *p_host++ = '\0';
+        *p_port++ = '\0';
+
+        long id = strtol(line_buffer, NULL, BASE10);
+        long port = strtol(p_port, NULL, BASE10);
+
+        if ((1 > id) || (CLUSTER_MAX_NODES < id) ||
+            (HOST_MAX_STRING < strlen(p_host)) ||
+            (FAILURE == port_range_check(&port)) ||
+            (CLUSTER_MAX_NODES <= *p_count))
+        {
+            CR_LOG_ERROR("cr_cluster_read_nodes: bad node %ld", id);
+            return_val = FAILURE;
+            break;
+        }
+
+        cluster_node_t * p_node = &p_nodes[(*p_count)++];
+        p_node->id = id;
+        strncpy(p_node->p_host, p_host, HOST_MAX_STRING);
+        snprintf(p_node->p_port, sizeof(p_node->p_port), "%ld", port);
+    }
+
+    if (EOF == fclose(file_pointer))
+    {
+        CR_LOG_ERRNO("cr_cluster_read_nodes: fclose");
+        return FAILURE;
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Makes the TLS context for one end of the bus. Both ends present
+ * this node's certificate and require one from the peer that chains to
+ * cluster_ca.crt. The certificates are shared by the nodes, so host names
+ * are not checked; where a connection comes from is checked against
+ * cluster.txt instead.
+ *
+ * @param p_method TLS_client_method() for dialing, TLS_server_method() for
+ * accepting.
+ * @return SSL_CTX * the context, or NULL.
+ */
+static SSL_CTX *
+cr_cluster_ssl_ctx (const SSL_METHOD * p_method)
+{
+    SSL_CTX * p_ctx = SSL_CTX_new(p_method);
+
+    if (NULL == p_ctx)
+    {
+        CR_LOG_ERROR("cr_cluster_ssl_ctx: SSL_CTX_new()");
+        ERR_print_errors_fp(stderr);
+        return NULL;
+    }
+
+    if ((1 != SSL_CTX_use_certificate_file(p_ctx, CERT_FILENAME,
+                                             SSL_FILETYPE_PEM)) ||
+        (1 != SSL_CTX_use_PrivateKey_file(p_ctx, KEY_FILENAME,
+                                             SSL_FILETYPE_PEM)) ||
+        (1 != SSL_CTX_load_verify_locations(p_ctx, CLUSTER_CA_FILENAME,
+                                                                 NULL)))
+    {
+        CR_LOG_ERROR("cr_cluster_ssl_ctx: cannot load %s, %s and %s",
+                        CERT_FILENAME, KEY_FILENAME, CLUSTER_CA_FILENAME);
+        ERR_print_errors_fp(stderr);
+        SSL_CTX_free(p_ctx);
+        return NULL;
+    }
+
+    //NOTE: Partial chains let cluster_ca.crt list the nodes' certificates
+    //themselves rather than a CA.
+    X509_STORE_set_flags(SSL_CTX_get_cert_store(p_ctx),
+                                 X509_V_FLAG_PARTIAL_CHAIN);
+    SSL_CTX_set_verify(p_ctx, (SSL_VERIFY_PEER |
+                       SSL_VERIFY_FAIL_IF_NO_PEER_CERT), NULL);
+    SSL_CTX_set_min_proto_version(p_ctx, TLS1_2_VERSION);
+
+    //NOTE: Links are never resumed, and the sender never reads the tickets.
+    SSL_CTX_set_num_tickets(p_ctx, 0);
+    SSL_CTX_set_session_cache_mode(p_ctx, SSL_SESS_CACHE_OFF);
+
+    return p_ctx;
+}
+
+/**
+ * @brief Turns an IPv4 mapped IPv6 address, as accepted on a dual stack
+ * socket, into the IPv4 address.
+ *
+ * @param p_addr address to change in place.
+ */
+static void
+cr_cluster_addr_unmap (struct sockaddr_storage * p_addr)
+{
+    struct sockaddr_in6 addr6;
+    struct sockaddr_in addr4;
+
+    if (AF_INET6 != p_addr->ss_family)
+    {
+        return;
+    }
+
+    memcpy(&addr6, p_addr, sizeof(struct sockaddr_in6));
+
+    if (!IN6_IS_ADDR_V4MAPPED(&addr6.sin6_addr))
+    {
+        return;
+    }
+
+    memset(&addr4, 0, sizeof(struct sockaddr_in));
+    addr4.sin_family = AF_INET;
+    memcpy(&addr4.sin_addr, (addr6.sin6_addr.s6_addr + 12),
+                                      sizeof(struct in_addr));
+    memset(p_addr, 0, sizeof(struct sockaddr_storage));
+    memcpy(p_addr, &addr4, sizeof(struct sockaddr_in));
+}
+
+/**
+ * @brief Checks whether a host from cluster.txt resolves to an address. Ports
+ * are not compared, nodes dial from any port.
+ *
+ * @param p_host host from cluster.txt.
+ * @param p_addr unmapped address a connection came from.
+ * @return int 1 if it does, 0 if not.
+ */
+static int
+cr_cluster_host_is (const char * p_host, struct sockaddr_storage * p_addr)
+{
+    struct addrinfo hints;
+    struct addrinfo * p_result;
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_family = AF_UNSPEC;
+
+    if (0 != getaddrinfo(p_host, NULL, &hints, &p_result))
+    {
+        return 0;
+    }
+
+    int match = 0;
+
+    for (struct addrinfo * p_temp = p_result; (NULL != p_temp) && !match;
+                                             p_temp = p_temp->ai_next)
+    {
+        struct sockaddr_storage addr;
+
+        memset(&addr, 0, sizeof(struct sockaddr_storage));
+        memcpy(&addr, p_temp->ai_addr, p_temp->ai_addrlen);
+        cr_cluster_addr_unmap(&addr);
+
+        if (addr.ss_family != p_addr->ss_family)
+        {
+            continue;
+        }
+
+        if (AF_INET == addr.ss_family)
+        {
+            match = (0 == memcmp(&((struct sockaddr_in *) &addr)->sin_addr,
+                             &((struct sockaddr_in *) p_addr)->sin_addr,
+                                              sizeof(struct in_addr)));
+        }
+        else if (AF_INET6 == addr.ss_family)
+        {
+            match = (0 == memcmp(&((struct sockaddr_in6 *) &addr)->sin6_addr,
+                            &((struct sockaddr_in6 *) p_addr)->sin6_addr,
+                                              sizeof(struct in6_addr)));
+        }
+    }
+
+    freeaddrinfo(p_result);
+
+    return match;
+}
+
+/**
+ * @brief Finds a node in cluster.txt.
+ *
+ * @param node_id node id.
+ * @return cluster_node_t * the node, or NULL.
+ */
+static cluster_node_t *
+cr_cluster_node (uint8_t node_id)
+{
+    for (uint8_t idx = 0; idx < node_count; idx++)
+    {
+        if (node_id == p_nodes[idx].id)
+        {
+            return &p_nodes[idx];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Checks whether a connection comes from one of the other nodes in
+ * cluster.txt.
+ *
+ * @param p_addr unmapped address the connection came from.
+ * @return int 1 if it does, 0 if not.
+ */
+static int
+cr_cluster_listed (struct sockaddr_storage * p_addr)
+{
+    for (uint8_t idx = 0; idx < node_count; idx++)
+    {
+        if ((self_id != p_nodes[idx].id) &&
+            cr_cluster_host_is(p_nodes[idx].p_host, p_addr))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Starts a frame.
+ *
+ * @param p_frame buffer of CLUSTER_FRAME_MAX bytes.
+ * @param type frame type (BUS_HELLO ...).
+ * @return size_t length so far.
+ */
+static size_t
+cr_cluster_frame_start (char * p_frame, uint8_t type)
+{
+    p_frame[2] = type;
+
+    return BUS_HEADER_SIZE;
+}
+
+/**
+ * @brief Adds a string to a frame, cut to max_len characters.
+ *
+ * @param p_frame frame being built.
+ * @param frame_len length so far.
+ * @param p_string string to add.
+ * @param max_len most characters kept.
+ * @return size_t new length.
+ */
+static size_t
+cr_cluster_frame_str (char * p_frame, size_t frame_len,
+                      const char * p_string, size_t max_len)
+{
+    size_t str_len = strnlen(p_string, max_len);
+
+    p_frame[frame_len] = str_len;
+    memcpy((p_frame + frame_len + 1), p_string, str_len);
+
+    return frame_len + 1 + str_len;
+}
+
+/**
+ * @brief Fills in a frame's length field.
+ *
+ * @param p_frame frame being built.
+ * @param frame_len full length of the frame.
+ * @return size_t frame_len.
+ */
+static size_t
+cr_cluster_frame_end (char * p_frame, size_t frame_len)
+{
+    uint16_t length = htons(frame_len - 2);
+
+    memcpy(p_frame, &length, sizeof(uint16_t));
+
+    return frame_len;
+}
+
+/**
+ * @brief Reads a string from a received frame.
+ *
+ * @param p_frame frame after its length field.
+ * @param frame_len length of the frame after its length field.
+ * @param p_pos position of the string, moved past it.
+ * @param p_string buffer of max_len + 1 bytes.
+ * @param max_len longest string allowed.
+ * @return int SUCCESS (0) or FAILURE (1) if the string does not fit.
+ */
+static int
+cr_cluster_frame_get_str (char * p_frame, size_t frame_len, size_t * p_pos,
+                                         char * p_string, size_t max_len)
+{
+    if (*p_pos >= frame_len)
+    {
+        return FAILURE;
+    }
+
+    size_t str_len = (uint8_t) p_frame[*p_pos];
+
+    if ((str_len > max_len) || ((*p_pos + 1 + str_len) > frame_len))
+    {
+        return FAILURE;
+    }
+
+    memcpy(p_string, (p_frame + *p_pos + 1), str_len);
+    p_string[str_len] = '\0';
+    *p_pos += 1 + str_len;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Queues a frame for one peer. Frames for a peer that is down are
+ * dropped, it is sent the whole state again when it comes back.
+ *
+ * @param p_peer pointer to the peer.
+ * @param p_frame frame to send.
+ * @param frame_len length of the frame.
+ */
+static void
+cr_cluster_queue (cluster_peer_t * p_peer, char * p_frame, size_t frame_len)
+{
+    pthread_mutex_lock(&p_peer->mutex);
+
+    if (!p_peer->connected)
+    {
+        pthread_mutex_unlock(&p_peer->mutex);
+        return;
+    }
+
+    if ((p_peer->send_len + frame_len) > CLUSTER_SEND_SIZE)
+    {
+        if (0 == p_peer->dropped++)
+        {
+            CR_LOG_WARN("cr_cluster_queue: node %u is behind, dropping "
+                                                "frames", p_peer->node.id);
+        }
+
+        pthread_mutex_unlock(&p_peer->mutex);
+        return;
+    }
+
+    memcpy((p_peer->p_send_buffer + p_peer->send_len), p_frame, frame_len);
+    p_peer->send_len += frame_len;
+    pthread_cond_signal(&p_peer->cond);
+    pthread_mutex_unlock(&p_peer->mutex);
+}
+
+/**
+ * @brief Queues a frame for every peer whose bit is set in a mask.
+ *
+ * @param p_frame frame to send.
+ * @param frame_len length of the frame.
+ * @param mask one bit per node id, UINT32_MAX for every peer.
+ */
+static void
+cr_cluster_send (char * p_frame, size_t frame_len, uint32_t mask)
+{
+    for (uint8_t idx = 0; idx < peer_count; idx++)
+    {
+        if (mask & CLUSTER_BIT(p_peers[idx].node.id))
+        {
+            cr_cluster_queue(&p_peers[idx], p_frame, frame_len);
+        }
+    }
+}
+
+/**
+ * @brief Builds and sends a frame holding one room name to every peer.
+ *
+ * @param type frame type.
+ * @param p_room_name room name.
+ */
+static void
+cr_cluster_send_room (uint8_t type, const char * p_room_name)
+{
+    char p_frame[CLUSTER_FRAME_MAX];
+    size_t frame_len = cr_cluster_frame_start(p_frame, type);
+
+    frame_len = cr_cluster_frame_str(p_frame, frame_len, p_room_name,
+                                                 MAX_ROOM_NAME_LENGTH);
+    cr_cluster_send(p_frame, cr_cluster_frame_end(p_frame, frame_len),
+                                                           UINT32_MAX);
+}
+
+/**
+ * @brief Finds a room in the routing table.
+ *
+ * WARNING: Calling function must lock route_mutex before use and unlock
+ * after use.
+ *
+ * @param p_room_name room name.
+ * @param create non zero to take a free entry if the room is not there.
+ * @return cluster_route_t * the entry, or NULL.
+ */
+static cluster_route_t *
+cr_cluster_route (const char * p_room_name, int create)
+{
+    cluster_route_t * p_free = NULL;
+
+    for (int idx = 0; idx < CLUSTER_MAX_ROOMS; idx++)
+    {
+        cluster_route_t * p_route = &p_routes[idx];
+
+        if ('\0' == p_route->p_room_name[0])
+        {
+            p_free = (NULL == p_free) ? p_route : p_free;
+            continue;
+        }
+
+        if (SUCCESS == strncmp(p_route->p_room_name, p_room_name,
+                                             MAX_ROOM_NAME_LENGTH))
+        {
+            return p_route;
+        }
+    }
+
+    if (!create)
+    {
+        return NULL;
+    }
+
+    if (NULL == p_free)
+    {
+        CR_LOG_WARN("cr_cluster_route: routing table full, %s is not "
+                                               "routed", p_room_name);
+        return NULL;
+    }
+
+    strncpy(p_free->p_room_name, p_room_name, MAX_ROOM_NAME_LENGTH);
+
+    return p_free;
+}
+
+/**
+ * @brief Frees a routing table entry no node has members in.
+ *
+ * WARNING: Calling function must lock route_mutex before use and unlock
+ * after use.
+ *
+ * @param p_route pointer to the entry.
+ */
+static void
+cr_cluster_route_trim (cluster_route_t * p_route)
+{
+    if ((0 == p_route->peers) && (0 == p_route->local))
+    {
+        memset(p_route, 0, sizeof(cluster_route_t));
+    }
+}
+
+/**
+ * @brief Queues everything a peer needs after connecting: this node's id,
+ * then every room, user and subscription. Frames for changes made while this
+ * runs may arrive before the copy of the same state, which is harmless as
+ * nodes ignore rooms and users they already have.
+ *
+ * @param p_peer pointer to the peer, just connected.
+ */
+static void
+cr_cluster_sync (cluster_peer_t * p_peer)
+{
+    char p_frame[CLUSTER_FRAME_MAX];
+    size_t frame_len = cr_cluster_frame_start(p_frame, BUS_HELLO);
+
+    p_frame[frame_len++] = self_id;
+
+    //NOTE: Set in the same lock as the hello so it is the first frame.
+    pthread_mutex_lock(&p_peer->mutex);
+    p_peer->connected = 1;
+    p_peer->send_len = 0;
+    pthread_mutex_unlock(&p_peer->mutex);
+
+    cr_cluster_queue(p_peer, p_frame, cr_cluster_frame_end(p_frame,
+                                                           frame_len));
+
+    char line_buffer[BUFF_SIZE] = {0};
+
+    if (SUCCESS == CR_MUTEX_LOCK(p_cluster_rooms->p_rooms_mutex))
+    {
+        FILE * file_pointer = fopen(ROOM_NAME_LIST, "r");
+
+        while ((NULL != file_pointer) &&
+               (NULL != fgets(line_buffer, sizeof(line_buffer), file_pointer)))
+        {
+            line_buffer[strcspn(line_buffer, "\r\n")] = '\0';
+
+            if ('\0' != line_buffer[0])
+            {
+                frame_len = cr_cluster_frame_start(p_frame, BUS_ROOM_ADD);
+                frame_len = cr_cluster_frame_str(p_frame, frame_len,
+                                   line_buffer, MAX_ROOM_NAME_LENGTH);
+                cr_cluster_queue(p_peer, p_frame,
+                             cr_cluster_frame_end(p_frame, frame_len));
+            }
+        }
+
+        if (NULL != file_pointer)
+        {
+            fclose(file_pointer);
+        }
+
+        CR_MUTEX_UNLOCK(p_cluster_rooms->p_rooms_mutex);
+    }
+
+    if (SUCCESS == CR_MUTEX_LOCK(p_cluster_users->p_users_mutex))
+    {
+        FILE * file_pointer = fopen(USER_FILENAME, "r");
+
+        while ((NULL != file_pointer) &&
+               (NULL != fgets(line_buffer, sizeof(line_buffer), file_pointer)))
+        {
+            line_buffer[strcspn(line_buffer, "\r\n")] = '\0';
+            char * p_password = strchr(line_buffer, ':');
+
+            if (NULL != p_password)
+            {
+                *p_password++ = '\0';
+                frame_len = cr_cluster_frame_start(p_frame, BUS_USER_ADD);
+                frame_len = cr_cluster_frame_str(p_frame, frame_len,
+                                    line_buffer, MAX_USERNAME_LENGTH);
+                frame_len = cr_cluster_frame_str(p_frame, frame_len,
+                                     p_password, MAX_PASSWORD_LENGTH);
+                cr_cluster_queue(p_peer, p_frame,
+                             cr_cluster_frame_end(p_frame, frame_len));
+            }
+        }
+
+        if (NULL != file_pointer)
+        {
+            fclose(file_pointer);
+        }
+
+        CR_MUTEX_UNLOCK(p_cluster_users->p_users_mutex);
+    }
+
+    pthread_mutex_lock(&route_mutex);
+
+    for (int idx = 0; idx < CLUSTER_MAX_ROOMS; idx++)
+    {
+        if (0 != p_routes[idx].local)
+        {
+            frame_len = cr_cluster_frame_start(p_frame, BUS_SUB);
+            frame_len = cr_cluster_frame_str(p_frame, frame_len,
+                      p_routes[idx].p_room_name, MAX_ROOM_NAME_LENGTH);
+            cr_cluster_queue(p_peer, p_frame,
+                         cr_cluster_frame_end(p_frame, frame_len));
+        }
+    }
+
+    pthread_mutex_unlock(&route_mutex);
+}
+
+/**
+ * @brief Binds a socket about to dial a peer to this node's address in
+ * cluster.txt, which is what the peer checks the connection against.
+ *
+ * @param socket_fd socket, not yet connected.
+ * @param family address family of the peer address being dialed.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_cluster_bind_self (int socket_fd, int family)
+{
+    struct addrinfo hints;
+    struct addrinfo * p_result;
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_family = family;
+
+    if (0 != getaddrinfo(p_self->p_host, NULL, &hints, &p_result))
+    {
+        return FAILURE;
+    }
+
+    int return_val = bind(socket_fd, p_result->ai_addr, p_result->ai_addrlen);
+
+    freeaddrinfo(p_result);
+
+    return (SUCCESS == return_val) ? SUCCESS : FAILURE;
+}
+
+/**
+ * @brief Connects to a node. Failures are expected while a node is down and
+ * are not logged.
+ *
+ * @param p_node pointer to the node.
+ * @return int connected socket or FAILURE_NEGATIVE (-1).
+ */
+static int
+cr_cluster_dial (cluster_node_t * p_node)
+{
+    struct addrinfo hints;
+    struct addrinfo * p_result;
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    if (0 != getaddrinfo(p_node->p_host, p_node->p_port, &hints, &p_result))
+    {
+        return FAILURE_NEGATIVE;
+    }
+
+    int socket_fd = FAILURE_NEGATIVE;
+
+    for (struct addrinfo * p_temp = p_result; NULL != p_temp;
+                                      p_temp = p_temp->ai_next)
+    {
+        socket_fd = socket(p_temp->ai_family, p_temp->ai_socktype,
+                                             p_temp->ai_protocol);
+
+        if (FAILURE_NEGATIVE == socket_fd)
+        {
+            continue;
+        }
+
+        if ((SUCCESS == cr_cluster_bind_self(socket_fd, p_temp->ai_family)) &&
+            (SUCCESS == connect(socket_fd, p_temp->ai_addr,
+                                          p_temp->ai_addrlen)))
+        {
+            break;
+        }
+
+        close(socket_fd);
+        socket_fd = FAILURE_NEGATIVE;
+    }
+
+    freeaddrinfo(p_result);
+
+    if (FAILURE_NEGATIVE != socket_fd)
+    {
+        //NOTE: Frames are already gathered before each write. The timeouts
+        //keep a stuck peer from holding up shutdown.
+        int optval = 1;
+        struct timeval timeout = {.tv_sec = 3, .tv_usec = 0};
+
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &optval,
+                                                     sizeof(int));
+        setsockopt(socket_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                                        sizeof(struct timeval));
+        setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                                        sizeof(struct timeval));
+    }
+
+    return socket_fd;
+}
+
+/**
+ * @brief Closes a TLS connection and its socket.
+ *
+ * @param p_ssl pointer to the connection.
+ */
+static void
+cr_cluster_ssl_close (SSL * p_ssl)
+{
+    int socket_fd = SSL_get_fd(p_ssl);
+
+    SSL_free(p_ssl);
+    close(socket_fd);
+}
+
+/**
+ * @brief Connects to a node and finishes the TLS handshake. A node that is
+ * down is not logged, a handshake that fails is logged once until one
+ * succeeds.
+ *
+ * @param p_peer pointer to the peer.
+ * @return SSL * the connection, or NULL.
+ */
+static SSL *
+cr_cluster_connect (cluster_peer_t * p_peer)
+{
+    int socket_fd = cr_cluster_dial(&p_peer->node);
+
+    if (FAILURE_NEGATIVE == socket_fd)
+    {
+        return NULL;
+    }
+
+    SSL * p_ssl = SSL_new(p_dial_ctx);
+
+    if ((NULL == p_ssl) || (1 != SSL_set_fd(p_ssl, socket_fd)))
+    {
+        CR_LOG_ERROR("cr_cluster_connect: SSL_new()/SSL_set_fd()");
+        SSL_free(p_ssl);
+        close(socket_fd);
+        return NULL;
+    }
+
+    if (1 != SSL_connect(p_ssl))
+    {
+        if (!p_peer->refused)
+        {
+            CR_LOG_WARN("cr_cluster_connect: handshake with node %u failed",
+                                                          p_peer->node.id);
+            ERR_print_errors_fp(stderr);
+        }
+
+        ERR_clear_error();
+        p_peer->refused = 1;
+        cr_cluster_ssl_close(p_ssl);
+        return NULL;
+    }
+
+    p_peer->refused = 0;
+
+    return p_ssl;
+}
+
+/**
+ * @brief Writes a whole buffer to a peer.
+ *
+ * @param p_ssl connected peer.
+ * @param p_buffer bytes to write.
+ * @param buffer_len number of bytes.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_cluster_write (SSL * p_ssl, char * p_buffer, uint32_t buffer_len)
+{
+    uint32_t written = 0;
+
+    while (written < buffer_len)
+    {
+        int sent = SSL_write(p_ssl, (p_buffer + written),
+                                  (buffer_len - written));
+
+        if (0 >= sent)
+        {
+            ERR_clear_error();
+            return FAILURE;
+        }
+
+        written += sent;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Sender thread for one peer. Connects, sends the peer the whole
+ * state, then writes queued frames until the connection breaks, and starts
+ * over.
+ *
+ * @param p_peer_holder pointer to the peer's cluster_peer_t. Must be void
+ * pointer type to be compatable with pthread library.
+ * @return void * NULL.
+ */
+static void *
+cr_cluster_sender (void * p_peer_holder)
+{
+    cluster_peer_t * p_peer = p_peer_holder;
+    SSL * p_ssl = NULL;
+
+    pthread_mutex_lock(&p_peer->mutex);
+
+    while (CONTINUE == running)
+    {
+        if (!p_peer->connected)
+        {
+            pthread_mutex_unlock(&p_peer->mutex);
+            p_ssl = cr_cluster_connect(p_peer);
+
+            if (NULL != p_ssl)
+            {
+                CR_LOG_INFO("cr_cluster_sender: connected to node %u",
+                                                      p_peer->node.id);
+                cr_cluster_sync(p_peer);
+                pthread_mutex_lock(&p_peer->mutex);
+                continue;
+            }
+
+            struct timespec retry;
+            clock_gettime(CLOCK_REALTIME, &retry);
+            retry.tv_sec += CLUSTER_RETRY_MS / 1000;
+
+            pthread_mutex_lock(&p_peer->mutex);
+
+            if (CONTINUE == running)
+            {
+                pthread_cond_timedwait(&p_peer->cond, &p_peer->mutex,
+                                                             &retry);
+            }
+
+            continue;
+        }
+
+        if (0 == p_peer->send_len)
+        {
+            pthread_cond_wait(&p_peer->cond, &p_peer->mutex);
+            continue;
+        }
+
+        char * p_write_buffer = p_peer->p_send_buffer;
+        uint32_t write_len = p_peer->send_len;
+
+        p_peer->p_send_buffer = p_peer->p_write_buffer;
+        p_peer->p_write_buffer = p_write_buffer;
+        p_peer->send_len = 0;
+
+        pthread_mutex_unlock(&p_peer->mutex);
+
+        int return_val = cr_cluster_write(p_ssl, p_write_buffer, write_len);
+
+        pthread_mutex_lock(&p_peer->mutex);
+
+        if (FAILURE == return_val)
+        {
+            CR_LOG_WARN("cr_cluster_sender: lost node %u", p_peer->node.id);
+            cr_cluster_ssl_close(p_ssl);
+            p_ssl = NULL;
+            p_peer->connected = 0;
+            p_peer->send_len = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&p_peer->mutex);
+
+    if (NULL != p_ssl)
+    {
+        cr_cluster_ssl_close(p_ssl);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Closes a receiving connection and drops the node's subscriptions,
+ * which it sends again when it reconnects.
+ *
+ * @param p_link pointer to the connection.
+ */
+static void
+cr_cluster_link_close (cluster_link_t * p_link)
+{
+    if (CLUSTER_OFF != p_link->node_id)
+    {
+        CR_LOG_WARN("cr_cluster_link_close: node %u left", p_link->node_id);
+        pthread_mutex_lock(&route_mutex);
+
+        for (int idx = 0; idx < CLUSTER_MAX_ROOMS; idx++)
+        {
+            p_routes[idx].peers &= ~CLUSTER_BIT(p_link->node_id);
+
+            if ('\0' != p_routes[idx].p_room_name[0])
+            {
+                cr_cluster_route_trim(&p_routes[idx]);
+            }
+        }
+
+        pthread_mutex_unlock(&route_mutex);
+    }
+
+    cr_cluster_ssl_close(p_link->p_ssl);
+    p_link->p_ssl = NULL;
+    p_link->fd = FAILURE_NEGATIVE;
+    p_link->node_id = CLUSTER_OFF;
+    p_link->recv_len = 0;
+}
+
+/**
+ * @brief Applies one frame received from a node.
+ *
+ * @param p_link pointer to the connection it came on.
+ * @param p_frame frame after its length field.
+ * @param frame_len length of the frame after its length field.
+ * @return int SUCCESS (0) or FAILURE (1) if the frame is malformed.
+ */
+static int
+cr_cluster_handle (cluster_link_t * p_link, char * p_frame, size_t frame_len)
+{
+    char p_room_name[MAX_ROOM_NAME_LENGTH + 1] = {0};
+    char p_username[MAX_USERNAME_LENGTH + 1] = {0};
+    char p_password[MAX_PASSWORD_LENGTH + 1] = {0};
+    char p_chat[MAX_CHAT_LEN + 1] = {0};
+    cluster_route_t * p_route;
+    size_t pos = 1;
+
+    uint8_t type = p_frame[0];
+
+    if ((CLUSTER_OFF == p_link->node_id) && (BUS_HELLO != type))
+    {
+        return FAILURE;
+    }
+
+    cluster_node_t * p_node;
+
+    switch (type)
+    {
+        case BUS_HELLO:
+            if ((CLUSTER_OFF != p_link->node_id) || (2 > frame_len) ||
+                (self_id == (uint8_t) p_frame[1]))
+            {
+                return FAILURE;
+            }
+
+            //NOTE: A node can only speak for the id listed for its address.
+            p_node = cr_cluster_node(p_frame[1]);
+
+            if ((NULL == p_node) ||
+                !cr_cluster_host_is(p_node->p_host, &p_link->addr))
+            {
+                CR_LOG_WARN("cr_cluster_handle: hello from an address not "
+                          "listed for node %u", (uint8_t) p_frame[1]);
+                return FAILURE;
+            }
+
+            p_link->node_id = p_frame[1];
+            link_refused = 0;
+            CR_LOG_INFO("cr_cluster_handle: node %u joined", p_link->node_id);
+            break;
+        case BUS_ROOM_ADD:
+        case BUS_ROOM_DEL:
+        case BUS_SUB:
+        case BUS_UNSUB:
+            if (FAILURE == cr_cluster_frame_get_str(p_frame, frame_len, &pos,
+                                      p_room_name, MAX_ROOM_NAME_LENGTH))
+            {
+                return FAILURE;
+            }
+
+            if (BUS_ROOM_ADD == type)
+            {
+                cr_rooms_create_remote(p_cluster_rooms, p_room_name);
+                break;
+            }
+
+            if (BUS_ROOM_DEL == type)
+            {
+                cr_rooms_delete_remote(p_cluster_rooms, p_room_name);
+                break;
+            }
+
+            pthread_mutex_lock(&route_mutex);
+            p_route = cr_cluster_route(p_room_name, (BUS_SUB == type));
+
+            if ((NULL != p_route) && (BUS_SUB == type))
+            {
+                p_route->peers |= CLUSTER_BIT(p_link->node_id);
+            }
+            else if (NULL != p_route)
+            {
+                p_route->peers &= ~CLUSTER_BIT(p_link->node_id);
+                cr_cluster_route_trim(p_route);
+            }
+
+            pthread_mutex_unlock(&route_mutex);
+            break;
+        case BUS_USER_ADD:
+            if ((FAILURE == cr_cluster_frame_get_str(p_frame, frame_len, &pos,
+                                       p_username, MAX_USERNAME_LENGTH)) ||
+                (FAILURE == cr_cluster_frame_get_str(p_frame, frame_len, &pos,
+                                       p_password, MAX_PASSWORD_LENGTH)))
+            {
+                return FAILURE;
+            }
+
+            cr_users_add_remote(p_cluster_users, p_username, p_password);
+            break;
+        case BUS_USER_DEL:
+            if (FAILURE == cr_cluster_frame_get_str(p_frame, frame_len, &pos,
+                                        p_username, MAX_USERNAME_LENGTH))
+            {
+                return FAILURE;
+            }
+
+            cr_users_remove_remote(p_cluster_users, p_username);
+            break;
+        case BUS_CHAT:
+            if ((FAILURE == cr_cluster_frame_get_str(p_frame, frame_len, &pos,
+                                      p_room_name, MAX_ROOM_NAME_LENGTH)) ||
+                (FAILURE == cr_cluster_frame_get_str(p_frame, frame_len, &pos,
+                                       p_username, MAX_USERNAME_LENGTH)) ||
+                (FAILURE == cr_cluster_frame_get_str(p_frame, frame_len, &pos,
+                                               p_chat, MAX_CHAT_LEN)))
+            {
+                return FAILURE;
+            }
+
+            cr_chats_remote(p_cluster_rooms, p_room_name, p_username, p_chat);
+            break;
+        default:
+            //NOTE: Frames from newer nodes are skipped.
+            break;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Applies every whole frame in a connection's read buffer.
+ *
+ * @param p_link pointer to the connection.
+ * @return int SUCCESS (0) or FAILURE (1) if the connection should close.
+ */
+static int
+cr_cluster_link_frames (cluster_link_t * p_link)
+{
+    uint32_t pos = 0;
+
+    while ((p_link->recv_len - pos) >= 2)
+    {
+        uint16_t frame_len;
+        memcpy(&frame_len, (p_link->p_recv_buffer + pos), sizeof(uint16_t));
+        frame_len = ntohs(frame_len);
+
+        if ((0 == frame_len) || ((CLUSTER_FRAME_MAX - 2) < frame_len))
+        {
+            CR_LOG_ERROR("cr_cluster_link_read: bad frame length %u",
+                                                           frame_len);
+            return FAILURE;
+        }
+
+        if ((p_link->recv_len - pos) < (uint32_t) (frame_len + 2))
+        {
+            break;
+        }
+
+        if (FAILURE == cr_cluster_handle(p_link, (p_link->p_recv_buffer +
+                                                   pos + 2), frame_len))
+        {
+            CR_LOG_ERROR("cr_cluster_link_read: bad frame");
+            return FAILURE;
+        }
+
+        pos += frame_len + 2;
+    }
+
+    memmove(p_link->p_recv_buffer, (p_link->p_recv_buffer + pos),
+                                           (p_link->recv_len - pos));
+    p_link->recv_len -= pos;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Reads what a node has sent and applies every whole frame. Reads
+ * until the socket is drained, as TLS may hold decrypted bytes poll does not
+ * see. The first reads finish the handshake.
+ *
+ * @param p_link pointer to the connection.
+ * @return int SUCCESS (0) or FAILURE (1) if the connection should close.
+ */
+static int
+cr_cluster_link_read (cluster_link_t * p_link)
+{
+    for (;;)
+    {
+        //NOTE: Frames are applied after every read, so less than a frame is
+        //left over and the buffer always has room.
+        int received = SSL_read(p_link->p_ssl, (p_link->p_recv_buffer +
+                                                       p_link->recv_len),
+                                 (CLUSTER_RECV_SIZE - p_link->recv_len));
+
+        if (0 >= received)
+        {
+            int ssl_error = SSL_get_error(p_link->p_ssl, received);
+
+            if ((SSL_ERROR_WANT_READ == ssl_error) ||
+                (SSL_ERROR_WANT_WRITE == ssl_error))
+            {
+                return SUCCESS;
+            }
+
+            //NOTE: A peer that keeps failing its handshake is logged once.
+            if ((SSL_ERROR_SSL == ssl_error) && !link_refused)
+            {
+                CR_LOG_WARN("cr_cluster_link_read: TLS from a node failed");
+                ERR_print_errors_fp(stderr);
+                link_refused = (CLUSTER_OFF == p_link->node_id);
+            }
+
+            ERR_clear_error();
+            return FAILURE;
+        }
+
+        p_link->recv_len += received;
+
+        if (FAILURE == cr_cluster_link_frames(p_link))
+        {
+            return FAILURE;
+        }
+    }
+}
+
+/**
+ * @brief Takes a connection from another node. Connections from addresses
+ * not in cluster.txt are closed at once.
+ *
+ * @param client_fd accepted socket.
+ * @param p_addr address it came from.
+ */
+static void
+cr_cluster_link_open (int client_fd, struct sockaddr_storage * p_addr)
+{
+    cr_cluster_addr_unmap(p_addr);
+
+    if (!cr_cluster_listed(p_addr))
+    {
+        char p_host[INET6_ADDRSTRLEN] = {0};
+
+        getnameinfo((struct sockaddr *) p_addr, sizeof(struct sockaddr_storage),
+                     p_host, sizeof(p_host), NULL, 0, NI_NUMERICHOST);
+        CR_LOG_WARN("cr_cluster_link_open: %s is not in %s", p_host,
+                                                     CLUSTER_FILENAME);
+        close(client_fd);
+        return;
+    }
+
+    cluster_link_t * p_link = NULL;
+
+    for (int idx = 0; idx < CLUSTER_MAX_NODES; idx++)
+    {
+        if (FAILURE_NEGATIVE == p_links[idx].fd)
+        {
+            p_link = &p_links[idx];
+            break;
+        }
+    }
+
+    if (NULL == p_link)
+    {
+        CR_LOG_WARN("cr_cluster_link_open: too many node connections");
+        close(client_fd);
+        return;
+    }
+
+    SSL * p_ssl = SSL_new(p_accept_ctx);
+
+    if ((NULL == p_ssl) || (1 != SSL_set_fd(p_ssl, client_fd)) ||
+        (FAILURE_NEGATIVE == fcntl(client_fd, F_SETFL,
+                        (fcntl(client_fd, F_GETFL) | O_NONBLOCK))))
+    {
+        CR_LOG_ERROR("cr_cluster_link_open: SSL_new()/SSL_set_fd()/fcntl()");
+        SSL_free(p_ssl);
+        close(client_fd);
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    SSL_set_accept_state(p_ssl);
+    p_link->fd = client_fd;
+    p_link->p_ssl = p_ssl;
+    p_link->addr = *p_addr;
+    p_link->opened = now.tv_sec;
+    p_link->node_id = CLUSTER_OFF;
+    p_link->recv_len = 0;
+}
+
+/**
+ * @brief Receiver thread. Accepts connections from other nodes and applies
+ * the frames they send.
+ *
+ * @param p_arg unused, required by pthread_create.
+ * @return void * NULL.
+ */
+static void *
+cr_cluster_receiver (void * p_arg)
+{
+    (void) p_arg;
+
+    struct pollfd p_fds[CLUSTER_MAX_NODES + 1];
+    int p_link_idx[CLUSTER_MAX_NODES + 1];
+
+    while (CONTINUE == running)
+    {
+        nfds_t fd_count = 1;
+
+        p_fds[0].fd = listen_fd;
+        p_fds[0].events = POLLIN;
+
+        for (int idx = 0; idx < CLUSTER_MAX_NODES; idx++)
+        {
+            if (FAILURE_NEGATIVE != p_links[idx].fd)
+            {
+                p_fds[fd_count].fd = p_links[idx].fd;
+                p_fds[fd_count].events = POLLIN;
+                p_link_idx[fd_count++] = idx;
+            }
+        }
+
+        //NOTE: Woken twice a second to see whether the server is stopping,
+        //and to drop connections that never said hello.
+        int ready = poll(p_fds, fd_count, 500);
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        for (nfds_t idx = 1; idx < fd_count; idx++)
+        {
+            cluster_link_t * p_link = &p_links[p_link_idx[idx]];
+
+            if ((CLUSTER_OFF == p_link->node_id) &&
+                (CLUSTER_HELLO_MS < ((now.tv_sec - p_link->opened) * 1000)))
+            {
+                CR_LOG_WARN("cr_cluster_receiver: a connection never said "
+                                                                  "hello");
+                cr_cluster_link_close(p_link);
+                p_fds[idx].revents = 0;
+            }
+        }
+
+        if (0 >= ready)
+        {
+            continue;
+        }
+
+        for (nfds_t idx = 1; idx < fd_count; idx++)
+        {
+            if ((0 != p_fds[idx].revents) &&
+                (FAILURE_NEGATIVE != p_links[p_link_idx[idx]].fd) &&
+                (FAILURE == cr_cluster_link_read(&p_links[p_link_idx[idx]])))
+            {
+                cr_cluster_link_close(&p_links[p_link_idx[idx]]);
+            }
+        }
+
+        if (0 == (p_fds[0].revents & POLLIN))
+        {
+            continue;
+        }
+
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(struct sockaddr_storage);
+        int client_fd = accept(listen_fd, (struct sockaddr *) &addr,
+                                                          &addr_len);
+
+        if (FAILURE_NEGATIVE != client_fd)
+        {
+            cr_cluster_link_open(client_fd, &addr);
+        }
+    }
+
+    for (int idx = 0; idx < CLUSTER_MAX_NODES; idx++)
+    {
+        if (FAILURE_NEGATIVE != p_links[idx].fd)
+        {
+            cr_cluster_link_close(&p_links[idx]);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Reads cluster.txt, starts listening for peers on this node's
+ * address, and starts dialing every other node.
+ *
+ * @param node_id this node's id in cluster.txt. CLUSTER_OFF leaves
+ * clustering off.
+ * @param p_users pointer to users_t struct, remote registrations are added.
+ * @param p_rooms pointer to rooms_t struct, remote rooms are added.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_cluster_start (uint8_t node_id, users_t * p_users, rooms_t * p_rooms)
+{
+    if ((CLUSTER_OFF == node_id) || (CONTINUE == running))
+    {
+        return SUCCESS;
+    }
+
+    if ((NULL == p_users) || (NULL == p_rooms))
+    {
+        CR_LOG_ERROR("cr_cluster_start: input NULL");
+        return FAILURE;
+    }
+
+    if (FAILURE == cr_cluster_read_nodes(p_nodes, &node_count))
+    {
+        CR_LOG_ERROR("cr_cluster_start: cr_cluster_read_nodes()");
+        return FAILURE;
+    }
+
+    p_self = cr_cluster_node(node_id);
+
+    if (NULL == p_self)
+    {
+        CR_LOG_ERROR("cr_cluster_start: node %u is not in %s", node_id,
+                                                     CLUSTER_FILENAME);
+        return FAILURE;
+    }
+
+    p_dial_ctx = cr_cluster_ssl_ctx(TLS_client_method());
+    p_accept_ctx = cr_cluster_ssl_ctx(TLS_server_method());
+
+    if ((NULL == p_dial_ctx) || (NULL == p_accept_ctx))
+    {
+        CR_LOG_ERROR("cr_cluster_start: cr_cluster_ssl_ctx()");
+        SSL_CTX_free(p_dial_ctx);
+        SSL_CTX_free(p_accept_ctx);
+        p_dial_ctx = NULL;
+        p_accept_ctx = NULL;
+        return FAILURE;
+    }
+
+    listen_fd = n_listen(p_self->p_host, p_self->p_port, CLUSTER_MAX_NODES);
+
+    if (FAILURE_NEGATIVE == listen_fd)
+    {
+        CR_LOG_ERROR("cr_cluster_start: n_listen()");
+        SSL_CTX_free(p_dial_ctx);
+        SSL_CTX_free(p_accept_ctx);
+        p_dial_ctx = NULL;
+        p_accept_ctx = NULL;
+        return FAILURE;
+    }
+
+    //NOTE: SSL_write has no MSG_NOSIGNAL, a peer that goes away must not
+    //kill the server. Clients' connections already rely on this.
+    signal(SIGPIPE, SIG_IGN);
+
+    self_id = node_id;
+    p_cluster_users = p_users;
+    p_cluster_rooms = p_rooms;
+    peer_count = 0;
+
+    for (int idx = 0; idx < CLUSTER_MAX_NODES; idx++)
+    {
+        p_links[idx].fd = FAILURE_NEGATIVE;
+        p_links[idx].p_ssl = NULL;
+    }
+
+    running = CONTINUE;
+
+    if (SUCCESS != pthread_create(&recv_thread, NULL, cr_cluster_receiver,
+                                                                    NULL))
+    {
+        CR_LOG_ERRNO("cr_cluster_start: pthread_create:");
+        running = STOP;
+        close(listen_fd);
+        listen_fd = FAILURE_NEGATIVE;
+        SSL_CTX_free(p_dial_ctx);
+        SSL_CTX_free(p_accept_ctx);
+        p_dial_ctx = NULL;
+        p_accept_ctx = NULL;
+        return FAILURE;
+    }
+
+    for (uint8_t idx = 0; idx < node_count; idx++)
+    {
+        if (node_id == p_nodes[idx].id)
+        {
+            continue;
+        }
+
+        cluster_peer_t * p_peer = &p_peers[peer_count];
+
+        memset(p_peer, 0, offsetof(cluster_peer_t, pp_buffers));
+        p_peer->node = p_nodes[idx];
+        p_peer->p_send_buffer = p_peer->pp_buffers[0];
+        p_peer->p_write_buffer = p_peer->pp_buffers[1];
+        pthread_mutex_init(&p_peer->mutex, NULL);
+        pthread_cond_init(&p_peer->cond, NULL);
+
+        if (SUCCESS != pthread_create(&p_peer->thread, NULL,
+                                      cr_cluster_sender, p_peer))
+        {
+            CR_LOG_ERRNO("cr_cluster_start: pthread_create:");
+            cr_cluster_stop();
+            return FAILURE;
+        }
+
+        peer_count++;
+    }
+
+    printf("cr_cluster: node %u listening on %s:%s, %u peers\n", self_id,
+                              p_self->p_host, p_self->p_port, peer_count);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Stops the bus threads and closes every peer connection. Must be
+ * called before the thread pool is destroyed, which frees the users and rooms
+ * mutexes the receiver takes. Frames published after this are dropped.
+ */
+void
+cr_cluster_stop ()
+{
+    if (CONTINUE != running)
+    {
+        return;
+    }
+
+    running = STOP;
+
+    for (uint8_t idx = 0; idx < peer_count; idx++)
+    {
+        pthread_mutex_lock(&p_peers[idx].mutex);
+        pthread_cond_broadcast(&p_peers[idx].cond);
+        pthread_mutex_unlock(&p_peers[idx].mutex);
+    }
+
+    for (uint8_t idx = 0; idx < peer_count; idx++)
+    {
+        if (SUCCESS != pthread_join(p_peers[idx].thread, NULL))
+        {
+            CR_LOG_ERRNO("cr_cluster_stop: pthread_join:");
+        }
+
+        if (0 != p_peers[idx].dropped)
+        {
+            printf("cr_cluster: %" PRIu64 " frames to node %u dropped\n",
+                            p_peers[idx].dropped, p_peers[idx].node.id);
+        }
+
+        //NOTE: The mutex and cond are kept, sessions may still be
+        //publishing.
+        pthread_mutex_lock(&p_peers[idx].mutex);
+        p_peers[idx].connected = 0;
+        p_peers[idx].send_len = 0;
+        pthread_mutex_unlock(&p_peers[idx].mutex);
+    }
+
+    if (SUCCESS != pthread_join(recv_thread, NULL))
+    {
+        CR_LOG_ERRNO("cr_cluster_stop: pthread_join:");
+    }
+
+    close(listen_fd);
+    listen_fd = FAILURE_NEGATIVE;
+    SSL_CTX_free(p_dial_ctx);
+    SSL_CTX_free(p_accept_ctx);
+    p_dial_ctx = NULL;
+    p_accept_ctx = NULL;
+}
+
+/**
+ * @brief Tells every peer a room was created here.
+ *
+ * @param p_room_name room name.
+ */
+void
+cr_cluster_room_add (const char * p_room_name)
+{
+    if ((CONTINUE == running) && (NULL != p_room_name))
+    {
+        cr_cluster_send_room(BUS_ROOM_ADD, p_room_name);
+    }
+}
+
+/**
+ * @brief Tells every peer a room was deleted here.
+ *
+ * @param p_room_name room name.
+ */
+void
+cr_cluster_room_del (const char * p_room_name)
+{
+    if ((CONTINUE == running) && (NULL != p_room_name))
+    {
+        cr_cluster_send_room(BUS_ROOM_DEL, p_room_name);
+    }
+}
+
+/**
+ * @brief Tells every peer a user registered here.
+ *
+ * @param p_username username.
+ * @param p_password password.
+ */
+void
+cr_cluster_user_add (const char * p_username, char * p_password)
+{
+    if ((CONTINUE != running) || (NULL == p_username) ||
+        (NULL == p_password))
+    {
+        return;
+    }
+
+    char p_frame[CLUSTER_FRAME_MAX];
+    size_t frame_len = cr_cluster_frame_start(p_frame, BUS_USER_ADD);
+
+    frame_len = cr_cluster_frame_str(p_frame, frame_len, p_username,
+                                                 MAX_USERNAME_LENGTH);
+    frame_len = cr_cluster_frame_str(p_frame, frame_len, p_password,
+                                                 MAX_PASSWORD_LENGTH);
+    cr_cluster_send(p_frame, cr_cluster_frame_end(p_frame, frame_len),
+                                                           UINT32_MAX);
+}
+
+/**
+ * @brief Tells every peer a user was deleted here.
+ *
+ * @param p_username username.
+ */
+void
+cr_cluster_user_del (const char * p_username)
+{
+    if ((CONTINUE != running) || (NULL == p_username))
+    {
+        return;
+    }
+
+    char p_frame[CLUSTER_FRAME_MAX];
+    size_t frame_len = cr_cluster_frame_start(p_frame, BUS_USER_DEL);
+
+    frame_len = cr_cluster_frame_str(p_frame, frame_len, p_username,
+                                                 MAX_USERNAME_LENGTH);
+    cr_cluster_send(p_frame, cr_cluster_frame_end(p_frame, frame_len),
+                                                           UINT32_MAX);
+}
+
+/**
+ * @brief Counts a local member joining a room. The first one subscribes
+ * this node to the room's chats on every peer.
+ *
+ * @param p_room_name room name.
+ */
+void
+cr_cluster_room_joined (const char * p_room_name)
+{
+    if ((CONTINUE != running) || (NULL == p_room_name))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&route_mutex);
+
+    cluster_route_t * p_route = cr_cluster_route(p_room_name, 1);
+    int first = (NULL != p_route) && (1 == ++p_route->local);
+
+    pthread_mutex_unlock(&route_mutex);
+
+    if (first)
+    {
+        cr_cluster_send_room(BUS_SUB, p_room_name);
+    }
+}
+
+/**
+ * @brief Counts a local member leaving a room. The last one unsubscribes
+ * this node from the room's chats on every peer.
+ *
+ * @param p_room_name room name.
+ */
+void
+cr_cluster_room_left (const char * p_room_name)
+{
+    if ((CONTINUE != running) || (NULL == p_room_name))
+    {
+        return;
+    }
+
+    int last = 0;
+
+    pthread_mutex_lock(&route_mutex);
+
+    cluster_route_t * p_route = cr_cluster_route(p_room_name, 0);
+
+    if ((NULL != p_route) && (0 != p_route->local))
+    {
+        last = (0 == --p_route->local);
+        cr_cluster_route_trim(p_route);
+    }
+
+    pthread_mutex_unlock(&route_mutex);
+
+    if (last)
+    {
+        cr_cluster_send_room(BUS_UNSUB, p_room_name);
+    }
+}
+
+/**
+ * @brief Sends a chat sent here to the peers that have members in its room.
+ *
+ * @param p_room_name room name.
+ * @param p_username sender's username.
+ * @param p_chat chat text.
+ */
+void
+cr_cluster_chat (const char * p_room_name, const char * p_username,
+                                                 char * p_chat)
+{
+    if ((CONTINUE != running) || (NULL == p_room_name) ||
+        (NULL == p_username) || (NULL == p_chat))
+    {
+        return;
+    }
+
+    uint32_t peers = 0;
+
+    pthread_mutex_lock(&route_mutex);
+
+    cluster_route_t * p_route = cr_cluster_route(p_room_name, 0);
+
+    if (NULL != p_route)
+    {
+        peers = p_route->peers;
+    }
+
+    pthread_mutex_unlock(&route_mutex);
+
+    if (0 == peers)
+    {
+        return;
+    }
+
+    char p_frame[CLUSTER_FRAME_MAX];
+    size_t frame_len = cr_cluster_frame_start(p_frame, BUS_CHAT);
+
+    frame_len = cr_cluster_frame_str(p_frame, frame_len, p_room_name,
+                                                MAX_ROOM_NAME_LENGTH);
+    frame_len = cr_cluster_frame_str(p_frame, frame_len, p_username,
+                                                 MAX_USERNAME_LENGTH);
+    frame_len = cr_cluster_frame_str(p_frame, frame_len, p_chat,
+                                                        MAX_CHAT_LEN);
+    cr_cluster_send(p_frame, cr_cluster_frame_end(p_frame, frame_len),
+                                                                peers);
+}
+
+//End of cr_cluster.c file
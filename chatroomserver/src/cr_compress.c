@@ -0,0 +1,281 @@
+#include "../include/cr_compress.h"
+#include "../include/cr_frame.h"
+
+//NOTE: Preset dictionary shared with the client (_cr_messages.py). Room
+//history and the room list are short, so priming zlib with the text they
+//usually contain saves most of the first occurrences. The most common strings
+//go last, zlib reaches the end of the dictionary with the shortest distances.
+static const char p_dictionary[] =
+    "what when just know think about would there some will this that with "
+    "have from your they been good like yeah okay thanks sure time "
+    "room\nchat\ngeneral\nrandom\n"
+    "0123456789 the you and for are not but can was all "
+    ">User has left the room\n"
+    ">User has joined the room\n";
+
+static volatile int compress_level = DEFAULT_COMPRESS_LEVEL;
+
+//NOTE: deflateInit allocates a few hundred KiB of state, which costs more
+//than compressing a room log. Each thread keeps one stream and resets it.
+static pthread_key_t deflate_key;
+static pthread_once_t deflate_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Frees a thread's deflate stream when the thread exits.
+ *
+ * @param p_stream_holder pointer to the thread's z_stream.
+ */
+static void
+cr_compress_stream_free (void * p_stream_holder)
+{
+    z_stream * p_stream = p_stream_holder;
+
+    deflateEnd(p_stream);
+    FREE(p_stream);
+}
+
+/**
+ * @brief Creates the key for the per-thread deflate streams.
+ */
+static void
+cr_compress_key_create ()
+{
+    if (SUCCESS != pthread_key_create(&deflate_key, cr_compress_stream_free))
+    {
+        CR_LOG_ERRNO("cr_compress_key_create: pthread_key_create:");
+    }
+}
+
+/**
+ * @brief Returns the calling thread's deflate stream, reset and primed with
+ * the dictionary at the current level.
+ *
+ * @return z_stream* the stream or NULL on failure.
+ */
+static z_stream *
+cr_compress_stream ()
+{
+    pthread_once(&deflate_key_once, cr_compress_key_create);
+
+    z_stream * p_stream = pthread_getspecific(deflate_key);
+    int level = compress_level;
+
+    if (NULL == p_stream)
+    {
+        p_stream = calloc(1, sizeof(z_stream));
+
+        if (NULL == p_stream)
+        {
+            CR_LOG_ERRNO("cr_compress_stream: p_stream calloc");
+            return NULL;
+        }
+
+        if (Z_OK != deflateInit(p_stream, level))
+        {
+            CR_LOG_ERROR("cr_compress_stream: deflateInit()");
+            FREE(p_stream);
+            return NULL;
+        }
+
+        pthread_setspecific(deflate_key, p_stream);
+    }
+    else if ((Z_OK != deflateReset(p_stream)) ||
+             (Z_OK != deflateParams(p_stream, level, Z_DEFAULT_STRATEGY)))
+    {
+        CR_LOG_ERROR("cr_compress_stream: deflateReset()");
+        return NULL;
+    }
+
+    if (Z_OK != deflateSetDictionary(p_stream, (const Bytef *) p_dictionary,
+                                               (sizeof(p_dictionary) - 1)))
+    {
+        CR_LOG_ERROR("cr_compress_stream: deflateSetDictionary()");
+        return NULL;
+    }
+
+    return p_stream;
+}
+
+/**
+ * @brief Sets the level used for every compressed payload.
+ *
+ * @param level zlib level, 0 (compression off) to 9.
+ * @return int SUCCESS (0) or FAILURE (1) if the level is out of range.
+ */
+int
+cr_compress_set_level (int level)
+{
+    if ((0 > level) || (MAX_COMPRESS_LEVEL < level))
+    {
+        CR_LOG_ERROR("cr_compress_set_level: level out of range");
+        return FAILURE;
+    }
+
+    compress_level = level;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Returns the level in use.
+ *
+ * @return int zlib level, zero if compression is off.
+ */
+int
+cr_compress_level ()
+{
+    return compress_level;
+}
+
+/**
+ * @brief Compresses a payload with zlib, primed with the chat text
+ * dictionary shared with the client.
+ *
+ * @param p_input bytes to compress.
+ * @param input_len number of bytes to compress.
+ * @param p_output buffer the compressed bytes are written to.
+ * @param output_size size of p_output.
+ * @return int length of the compressed bytes or FAILURE_NEGATIVE (-1).
+ */
+int
+cr_compress_deflate (const char * p_input, size_t input_len, char * p_output,
+                                                         size_t output_size)
+{
+    if ((NULL == p_input) || (NULL == p_output))
+    {
+        CR_LOG_ERROR("cr_compress_deflate: input NULL");
+        return FAILURE_NEGATIVE;
+    }
+
+    z_stream * p_stream = cr_compress_stream();
+
+    if (NULL == p_stream)
+    {
+        CR_LOG_ERROR("cr_compress_deflate: cr_compress_stream()");
+        return FAILURE_NEGATIVE;
+    }
+
+    p_stream->next_in = (Bytef *) p_input;
+    p_stream->avail_in = input_len;
+    p_stream->next_out = (Bytef *) p_output;
+    p_stream->avail_out = output_size;
+
+    int return_val = deflate(p_stream, Z_FINISH);
+    int output_len = p_stream->total_out;
+
+    if (Z_STREAM_END != return_val)
+    {
+        CR_LOG_ERROR("cr_compress_deflate: deflate() output too small");
+        return FAILURE_NEGATIVE;
+    }
+
+    return output_len;
+}
+
+/**
+ * @brief Decompresses a payload made by cr_compress_deflate.
+ *
+ * @param p_input compressed bytes.
+ * @param input_len number of compressed bytes.
+ * @param p_output buffer the original bytes are written to.
+ * @param output_size size of p_output.
+ * @return int length of the original bytes or FAILURE_NEGATIVE (-1).
+ */
+int
+cr_compress_inflate (const char * p_input, size_t input_len, char * p_output,
+                                                         size_t output_size)
+{
+    if ((NULL == p_input) || (NULL == p_output))
+    {
+        CR_LOG_ERROR("cr_compress_inflate: input NULL");
+        return FAILURE_NEGATIVE;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+
+    if (Z_OK != inflateInit(&stream))
+    {
+        CR_LOG_ERROR("cr_compress_inflate: inflateInit()");
+        return FAILURE_NEGATIVE;
+    }
+
+    stream.next_in = (Bytef *) p_input;
+    stream.avail_in = input_len;
+    stream.next_out = (Bytef *) p_output;
+    stream.avail_out = output_size;
+
+    int return_val = inflate(&stream, Z_FINISH);
+
+    //NOTE: zlib asks for the dictionary once it has read the header.
+    if (Z_NEED_DICT == return_val)
+    {
+        if (Z_OK != inflateSetDictionary(&stream,
+                    (const Bytef *) p_dictionary, (sizeof(p_dictionary) - 1)))
+        {
+            CR_LOG_ERROR("cr_compress_inflate: inflateSetDictionary()");
+            inflateEnd(&stream);
+            return FAILURE_NEGATIVE;
+        }
+
+        return_val = inflate(&stream, Z_FINISH);
+    }
+
+    int output_len = stream.total_out;
+
+    inflateEnd(&stream);
+
+    if (Z_STREAM_END != return_val)
+    {
+        CR_LOG_ERROR("cr_compress_inflate: inflate()");
+        return FAILURE_NEGATIVE;
+    }
+
+    return output_len;
+}
+
+/**
+ * @brief Handles compression requests. Acknowledges zlib if the client asked
+ * for it, the connection is on v2, and compression is on; otherwise
+ * acknowledges no compression.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_buffer pointer to buffer with received message.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_compress_negotiate (session_t * p_session, SSL * p_ssl, char * p_buffer)
+{
+    if ((NULL == p_session) || (NULL == p_buffer))
+    {
+        CR_LOG_ERROR("cr_compress_negotiate: input NULL");
+        return FAILURE;
+    }
+
+    compress_t compress_req;
+    memset(&compress_req, 0, sizeof(compress_t));
+    memcpy(&compress_req, p_buffer, sizeof(compress_t));
+
+    uint8_t algorithm = COMPRESS_NONE;
+
+    if ((COMPRESS_ZLIB == compress_req.algorithm) &&
+        (PROTOCOL_V2 == p_session->version) && (0 != compress_level))
+    {
+        algorithm = COMPRESS_ZLIB;
+    }
+
+    int return_val = cr_msg_send_compress_ack(p_ssl, algorithm);
+
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_compress_negotiate: cr_msg_send_compress_ack()");
+        return return_val;
+    }
+
+    p_session->compression = algorithm;
+
+    return SUCCESS;
+}
+
+//End of cr_compress.c file
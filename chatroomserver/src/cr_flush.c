@@ -0,0 +1,307 @@
+#include "../include/cr_flush.h"
+
+//NOTE: Sessions waiting for a flush form an intrusive list through
+//p_next_pending. A pass moves the list to p_flushing_head and writes the
+//sessions one at a time with flush_mutex unlocked, so broadcasters queueing
+//sessions never wait on a client. The lists, the pending flags, p_flushing
+//and running are guarded by flush_mutex, which is never held while taking
+//a session's send_mutex.
+static pthread_mutex_t flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t flushed_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t flush_thread;
+static session_t * p_pending_head = NULL;
+static session_t * p_flushing_head = NULL;
+static session_t * p_flushing = NULL;
+static volatile int running = STOP;
+static volatile uint16_t flush_window_ms = 0;
+
+/**
+ * @brief Checks whether the session's socket can take more bytes, so the
+ * flusher doesn't block on a client that stopped reading. Errors count as
+ * writable so the write reports them.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @return int 1 if the socket is writable, otherwise 0.
+ */
+static int
+cr_flush_writable (session_t * p_session)
+{
+    struct pollfd poll_fd = {
+        .fd = SSL_get_fd(p_session->p_ssl),
+        .events = POLLOUT
+    };
+
+    if (1 != poll(&poll_fd, 1, 0))
+    {
+        return 0;
+    }
+
+    return (0 != (poll_fd.revents & (POLLOUT | POLLERR | POLLHUP)));
+}
+
+/**
+ * @brief Writes the send buffer of every queued session and empties the
+ * queue. Sessions whose socket is full are queued again for the next window
+ * instead of holding up the rest.
+ *
+ * WARNING: Calling function must lock flush_mutex before use and unlock after
+ * use. The mutex is unlocked while each session is written.
+ */
+static void
+cr_flush_pending_helper ()
+{
+    p_flushing_head = p_pending_head;
+    p_pending_head = NULL;
+
+    while (NULL != p_flushing_head)
+    {
+        session_t * p_session = p_flushing_head;
+        p_flushing_head = p_session->p_next_pending;
+
+        if (!cr_flush_writable(p_session))
+        {
+            p_session->p_next_pending = p_pending_head;
+            p_pending_head = p_session;
+            continue;
+        }
+
+        p_session->p_next_pending = NULL;
+        p_session->pending = 0;
+        cr_metrics_gauge_add(METRIC_FLUSH_PENDING, -1);
+        p_flushing = p_session;
+        pthread_mutex_unlock(&flush_mutex);
+
+        //NOTE: A failed write is left for the session's own thread, its next
+        //read will see the broken connection.
+        if (SUCCESS != cr_msg_flush_pending(p_session->p_ssl))
+        {
+            CR_LOG_ERROR("cr_flush_pending_helper: "
+                                "cr_msg_flush_pending()");
+        }
+
+        pthread_mutex_lock(&flush_mutex);
+        p_flushing = NULL;
+        pthread_cond_broadcast(&flushed_cond);
+    }
+}
+
+/**
+ * @brief Flusher thread. Waits for a session to be queued, lets the window
+ * pass so more updates can gather, then writes every queued session.
+ *
+ * @param p_arg unused, required by pthread_create.
+ * @return void* NULL.
+ */
+static void *
+cr_flush_thread (void * p_arg)
+{
+    (void) p_arg;
+
+    struct timespec window = {
+        .tv_sec = flush_window_ms / 1000,
+        .tv_nsec = (flush_window_ms % 1000) * 1000000L
+    };
+
+    pthread_mutex_lock(&flush_mutex);
+
+    while (CONTINUE == running)
+    {
+        if (NULL == p_pending_head)
+        {
+            pthread_cond_wait(&flush_cond, &flush_mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&flush_mutex);
+        nanosleep(&window, NULL);
+        pthread_mutex_lock(&flush_mutex);
+
+        cr_flush_pending_helper();
+    }
+
+    pthread_mutex_unlock(&flush_mutex);
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the flusher thread. Sessions scheduled with
+ * cr_flush_schedule have their send buffers written once the window has
+ * passed, so chat updates from busy rooms share TLS records.
+ *
+ * @param window_ms flush window in milliseconds. Zero leaves the flusher
+ * stopped and every write goes out at once.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_flush_start (uint16_t window_ms)
+{
+    if ((0 == window_ms) || (CONTINUE == running))
+    {
+        return SUCCESS;
+    }
+
+    flush_window_ms = window_ms;
+    running = CONTINUE;
+
+    if (SUCCESS != pthread_create(&flush_thread, NULL, cr_flush_thread,
+                                                                  NULL))
+    {
+        CR_LOG_ERRNO("cr_flush_start: pthread_create:");
+        running = STOP;
+        flush_window_ms = 0;
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Flushes anything still pending, stops the flusher thread, and
+ * prints the write counters.
+ */
+void
+cr_flush_stop ()
+{
+    if (CONTINUE == running)
+    {
+        pthread_mutex_lock(&flush_mutex);
+        running = STOP;
+        pthread_cond_broadcast(&flush_cond);
+        pthread_mutex_unlock(&flush_mutex);
+
+        if (SUCCESS != pthread_join(flush_thread, NULL))
+        {
+            CR_LOG_ERRNO("cr_flush_stop: pthread_join:");
+        }
+
+        pthread_mutex_lock(&flush_mutex);
+        cr_flush_pending_helper();
+        flush_window_ms = 0;
+        pthread_mutex_unlock(&flush_mutex);
+    }
+
+    uint64_t messages = 0;
+    uint64_t records = 0;
+    cr_msg_write_stats(&messages, &records);
+
+    printf("cr_flush: %" PRIu64 " messages in %" PRIu64 " records "
+           "(%.3f records per message)\n", messages, records,
+           (0 == messages) ? 0.0 : ((double) records / messages));
+}
+
+/**
+ * @brief Returns the flush window in use.
+ *
+ * @return uint16_t window in milliseconds, zero if the flusher is stopped.
+ */
+uint16_t
+cr_flush_window ()
+{
+    return flush_window_ms;
+}
+
+/**
+ * @brief Queues a session whose send buffer holds unsent packets. The
+ * flusher writes it at the end of the current window.
+ *
+ * WARNING: Must not be called while holding the session's send mutex.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_flush_schedule (session_t * p_session)
+{
+    if (NULL == p_session)
+    {
+        CR_LOG_ERROR("cr_flush_schedule: input NULL");
+        return FAILURE;
+    }
+
+    if (SUCCESS != pthread_mutex_lock(&flush_mutex))
+    {
+        CR_LOG_ERRNO("cr_flush_schedule: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    if (!p_session->pending)
+    {
+        p_session->pending = 1;
+        p_session->p_next_pending = p_pending_head;
+        p_pending_head = p_session;
+        cr_metrics_gauge_add(METRIC_FLUSH_PENDING, 1);
+        pthread_cond_signal(&flush_cond);
+    }
+
+    if (SUCCESS != pthread_mutex_unlock(&flush_mutex))
+    {
+        CR_LOG_ERRNO("cr_flush_schedule: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Removes a session from the flusher's queue, waiting for the flusher
+ * if it is writing the session. Must be called after the session has left
+ * its room, so no broadcaster can queue it again, and before the session's
+ * SSL struct or the session itself is freed.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_flush_cancel (session_t * p_session)
+{
+    if (NULL == p_session)
+    {
+        CR_LOG_ERROR("cr_flush_cancel: input NULL");
+        return FAILURE;
+    }
+
+    if (SUCCESS != pthread_mutex_lock(&flush_mutex))
+    {
+        CR_LOG_ERRNO("cr_flush_cancel: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    session_t ** p_heads[] = {&p_pending_head, &p_flushing_head};
+
+    for (size_t list = 0; list < (sizeof(p_heads) / sizeof(p_heads[0]));
+                                                                  list++)
+    {
+        session_t ** pp_link = p_heads[list];
+
+        while (p_session->pending && (NULL != *pp_link))
+        {
+            if (p_session == *pp_link)
+            {
+                *pp_link = p_session->p_next_pending;
+                p_session->p_next_pending = NULL;
+                p_session->pending = 0;
+                cr_metrics_gauge_add(METRIC_FLUSH_PENDING, -1);
+                break;
+            }
+
+            pp_link = &(*pp_link)->p_next_pending;
+        }
+    }
+
+    while (p_session == p_flushing)
+    {
+        pthread_cond_wait(&flushed_cond, &flush_mutex);
+    }
+
+    if (SUCCESS != pthread_mutex_unlock(&flush_mutex))
+    {
+        CR_LOG_ERRNO("cr_flush_cancel: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+//End of cr_flush.c file
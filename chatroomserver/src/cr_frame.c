@@ -0,0 +1,671 @@
+#include "../include/cr_frame.h"
+#include "../include/cr_compress.h"
+
+/**
+ * @brief Writes an unsigned value as a little endian base 128 varint.
+ *
+ * @param p_buffer buffer the varint is written to.
+ * @param buffer_size space left in p_buffer.
+ * @param value value to write.
+ * @return int number of bytes written or FAILURE_NEGATIVE (-1) if the
+ * buffer is too small.
+ */
+int
+cr_frame_put_varint (char * p_buffer, size_t buffer_size, uint64_t value)
+{
+    if (NULL == p_buffer)
+    {
+        CR_LOG_ERROR("cr_frame_put_varint: input NULL");
+        return FAILURE_NEGATIVE;
+    }
+
+    size_t index = 0;
+
+    do
+    {
+        if (index >= buffer_size)
+        {
+            return FAILURE_NEGATIVE;
+        }
+
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+
+        if (0 != value)
+        {
+            byte |= 0x80;
+        }
+
+        p_buffer[index++] = (char) byte;
+    } while (0 != value);
+
+    return (int) index;
+}
+
+/**
+ * @brief Reads an unsigned little endian base 128 varint.
+ *
+ * @param p_buffer buffer the varint is read from.
+ * @param buffer_len number of bytes available in p_buffer.
+ * @param p_value pointer the value is written to.
+ * @return int number of bytes read, 0 if the varint is not complete yet, or
+ * FAILURE_NEGATIVE (-1) if it is longer than MAX_VARINT_LENGTH.
+ */
+int
+cr_frame_get_varint (const char * p_buffer, size_t buffer_len,
+                                             uint64_t * p_value)
+{
+    if ((NULL == p_buffer) || (NULL == p_value))
+    {
+        CR_LOG_ERROR("cr_frame_get_varint: input NULL");
+        return FAILURE_NEGATIVE;
+    }
+
+    uint64_t value = 0;
+
+    for (size_t index = 0; index < MAX_VARINT_LENGTH; index++)
+    {
+        if (index >= buffer_len)
+        {
+            return 0;
+        }
+
+        uint8_t byte = (uint8_t) p_buffer[index];
+        value |= ((uint64_t) (byte & 0x7F)) << (7 * index);
+
+        if (0 == (byte & 0x80))
+        {
+            *p_value = value;
+            return (int) (index + 1);
+        }
+    }
+
+    return FAILURE_NEGATIVE;
+}
+
+/**
+ * @brief Appends a sequence number varint to a frame payload.
+ *
+ * @param p_payload payload buffer.
+ * @param payload_size size of p_payload.
+ * @param p_offset pointer to the current payload length, advanced on success.
+ * @param seq sequence number.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_frame_put_seq (char * p_payload, size_t payload_size, size_t * p_offset,
+                                                          uint64_t seq)
+{
+    int varint_len = cr_frame_put_varint((p_payload + *p_offset),
+                                     (payload_size - *p_offset), seq);
+
+    if (FAILURE_NEGATIVE == varint_len)
+    {
+        CR_LOG_ERROR("cr_frame_put_seq: payload full");
+        return FAILURE;
+    }
+
+    *p_offset += varint_len;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Appends a string field (varint length then bytes) to a frame
+ * payload.
+ *
+ * @param p_payload payload buffer.
+ * @param payload_size size of p_payload.
+ * @param p_offset pointer to the current payload length, advanced on success.
+ * @param p_string field, not necessarily NULL terminated.
+ * @param max_len size of the field in the v1 packet.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_frame_put_string (char * p_payload, size_t payload_size, size_t * p_offset,
+                                      const char * p_string, size_t max_len)
+{
+    size_t str_len = strnlen(p_string, max_len);
+
+    int varint_len = cr_frame_put_varint((p_payload + *p_offset),
+                                   (payload_size - *p_offset), str_len);
+
+    if ((FAILURE_NEGATIVE == varint_len) ||
+        ((*p_offset + varint_len + str_len) > payload_size))
+    {
+        CR_LOG_ERROR("cr_frame_put_string: payload full");
+        return FAILURE;
+    }
+
+    *p_offset += varint_len;
+    memcpy((p_payload + *p_offset), p_string, str_len);
+    *p_offset += str_len;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Appends a file payload (room history or room list) to a frame
+ * payload. Without compression the bytes are copied as they are; with zlib
+ * the original length is written as a varint followed by the compressed
+ * bytes.
+ *
+ * @param p_payload frame payload being built.
+ * @param payload_size size of p_payload.
+ * @param p_offset current end of the payload, moved past the field.
+ * @param p_data file bytes.
+ * @param data_len number of file bytes.
+ * @param compression compression algorithm of the connection.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_frame_put_file (char * p_payload, size_t payload_size, size_t * p_offset,
+                   const char * p_data, size_t data_len, uint8_t compression)
+{
+    if (COMPRESS_ZLIB != compression)
+    {
+        if ((*p_offset + data_len) > payload_size)
+        {
+            return FAILURE;
+        }
+
+        memcpy((p_payload + *p_offset), p_data, data_len);
+        *p_offset += data_len;
+
+        return SUCCESS;
+    }
+
+    int varint_len = cr_frame_put_varint((p_payload + *p_offset),
+                                (payload_size - *p_offset), data_len);
+
+    if (FAILURE_NEGATIVE == varint_len)
+    {
+        return FAILURE;
+    }
+
+    *p_offset += varint_len;
+
+    if (0 == data_len)
+    {
+        return SUCCESS;
+    }
+
+    int compressed_len = cr_compress_deflate(p_data, data_len,
+                      (p_payload + *p_offset), (payload_size - *p_offset));
+
+    if (FAILURE_NEGATIVE == compressed_len)
+    {
+        return FAILURE;
+    }
+
+    *p_offset += compressed_len;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Converts a v1 packet built by the cr_msg functions to a v2 frame.
+ *
+ * @param p_packet v1 packet.
+ * @param packet_len length of the v1 packet.
+ * @param p_frame buffer the frame is written to.
+ * @param frame_size size of p_frame.
+ * @param compression compression algorithm of the connection, used for the
+ * room history and room list.
+ * @return int length of the frame or FAILURE_NEGATIVE (-1).
+ */
+int
+cr_frame_encode (const char * p_packet, size_t packet_len, char * p_frame,
+                                   size_t frame_size, uint8_t compression)
+{
+    if ((NULL == p_packet) || (NULL == p_frame) ||
+        (sizeof(received_msg_t) > packet_len) ||
+        (MAX_FRAME_LENGTH < packet_len))
+    {
+        CR_LOG_ERROR("cr_frame_encode: input invalid");
+        return FAILURE_NEGATIVE;
+    }
+
+    char p_payload[MAX_FRAME_LENGTH] = {0};
+    size_t offset = sizeof(received_msg_t);
+    int return_val = SUCCESS;
+
+    received_msg_t header;
+    memcpy(&header, p_packet, sizeof(received_msg_t));
+    memcpy(p_payload, p_packet, sizeof(received_msg_t));
+
+    //NOTE: Only chat updates and responses, join acknowledges and the room
+    //list have fields to pack. Every other packet (rejects, acks) is header
+    //plus raw bytes.
+    if ((CHAT_TYPE == header.type) && (CHAT_STYPE == header.s_type) &&
+        ((ACKNOWLEDGE == header.opcode) || (RESPONSE == header.opcode)) &&
+        (sizeof(chat_update_t) == packet_len))
+    {
+        const chat_update_t * p_update = (const chat_update_t *) p_packet;
+
+        return_val = cr_frame_put_seq(p_payload, sizeof(p_payload), &offset,
+                                             be64toh(p_update->seq));
+
+        if (SUCCESS == return_val)
+        {
+            return_val = cr_frame_put_string(p_payload, sizeof(p_payload),
+                          &offset, p_update->p_chat, MAX_USERNAME_LENGTH);
+        }
+
+        if (SUCCESS == return_val)
+        {
+            return_val = cr_frame_put_string(p_payload, sizeof(p_payload),
+                                &offset, (p_update->p_chat +
+                                MAX_USERNAME_LENGTH + 1), MAX_CHAT_LEN);
+        }
+    }
+    else if ((ROOMS_TYPE == header.type) && (JOIN_STYPE == header.s_type) &&
+             (ACKNOWLEDGE == header.opcode) && (sizeof(join_ack_t) <= packet_len))
+    {
+        const join_ack_t * p_join_ack = (const join_ack_t *) p_packet;
+        size_t history_len = packet_len - sizeof(join_ack_t);
+
+        return_val = cr_frame_put_seq(p_payload, sizeof(p_payload), &offset,
+                                           be64toh(p_join_ack->seq));
+
+        if (SUCCESS == return_val)
+        {
+            return_val = cr_frame_put_file(p_payload, sizeof(p_payload),
+                         &offset, (p_packet + sizeof(join_ack_t)),
+                                           history_len, compression);
+        }
+    }
+    else if ((ROOMS_TYPE == header.type) && (LIST_STYPE == header.s_type) &&
+             (ACKNOWLEDGE == header.opcode))
+    {
+        return_val = cr_frame_put_file(p_payload, sizeof(p_payload), &offset,
+                                     (p_packet + sizeof(received_msg_t)),
+                                     (packet_len - sizeof(received_msg_t)),
+                                                             compression);
+    }
+    else
+    {
+        memcpy((p_payload + offset), (p_packet + sizeof(received_msg_t)),
+                               (packet_len - sizeof(received_msg_t)));
+        offset = packet_len;
+    }
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_frame_encode: field too long");
+        return FAILURE_NEGATIVE;
+    }
+
+    int varint_len = cr_frame_put_varint(p_frame, frame_size, offset);
+
+    if ((FAILURE_NEGATIVE == varint_len) ||
+        ((varint_len + offset) > frame_size))
+    {
+        CR_LOG_ERROR("cr_frame_encode: frame buffer too small");
+        return FAILURE_NEGATIVE;
+    }
+
+    memcpy((p_frame + varint_len), p_payload, offset);
+
+    return (int) (varint_len + offset);
+}
+
+/**
+ * @brief Reads a string field (varint length then bytes) from a frame payload
+ * into its fixed size v1 field.
+ *
+ * @param p_payload payload buffer.
+ * @param payload_len length of the payload.
+ * @param p_offset pointer to the read offset, advanced on success.
+ * @param p_field v1 field the string is copied to (zeroed by the caller).
+ * @param max_len maximum string length the field holds.
+ * @return int SUCCESS (0) or FRAME_INVALID (7).
+ */
+static int
+cr_frame_get_string (const char * p_payload, size_t payload_len,
+              size_t * p_offset, char * p_field, size_t max_len)
+{
+    uint64_t str_len = 0;
+
+    int varint_len = cr_frame_get_varint((p_payload + *p_offset),
+                                 (payload_len - *p_offset), &str_len);
+
+    if ((0 >= varint_len) || (max_len < str_len) ||
+        ((*p_offset + varint_len + str_len) > payload_len))
+    {
+        return FRAME_INVALID;
+    }
+
+    *p_offset += varint_len;
+    memcpy(p_field, (p_payload + *p_offset), str_len);
+    *p_offset += str_len;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Expands a v2 request payload into the v1 packet layout.
+ *
+ * @param p_payload frame payload.
+ * @param payload_len length of the payload.
+ * @param p_packet zeroed buffer of at least BUFF_SIZE bytes.
+ * @return int SUCCESS (0) or FRAME_INVALID (7).
+ */
+static int
+cr_frame_decode (const char * p_payload, size_t payload_len, char * p_packet)
+{
+    if (sizeof(received_msg_t) > payload_len)
+    {
+        return FRAME_INVALID;
+    }
+
+    received_msg_t header;
+    memcpy(&header, p_payload, sizeof(received_msg_t));
+    memcpy(p_packet, p_payload, sizeof(received_msg_t));
+
+    size_t offset = sizeof(received_msg_t);
+    int return_val = SUCCESS;
+
+    if (REQUEST != header.opcode)
+    {
+        return FRAME_INVALID;
+    }
+
+    if ((ACCOUNT_TYPE == header.type) && ((REGISTER_STYPE == header.s_type) ||
+                                          (LOGIN_STYPE == header.s_type)))
+    {
+        register_req_t * p_req = (register_req_t *) p_packet;
+
+        return_val = cr_frame_get_string(p_payload, payload_len, &offset,
+                                 p_req->p_username, MAX_USERNAME_LENGTH);
+
+        if (SUCCESS == return_val)
+        {
+            return_val = cr_frame_get_string(p_payload, payload_len,
+                       &offset, p_req->p_password, MAX_PASSWORD_LENGTH);
+        }
+    }
+    else if ((ACCOUNT_TYPE == header.type) && ((DEL_STYPE == header.s_type) ||
+             (ADMIN_STYPE == header.s_type) ||
+             (ADMIN_REMOVE_STYPE == header.s_type)))
+    {
+        delete_req_t * p_req = (delete_req_t *) p_packet;
+
+        return_val = cr_frame_get_string(p_payload, payload_len, &offset,
+                                 p_req->p_username, MAX_USERNAME_LENGTH);
+    }
+    else if ((ROOMS_TYPE == header.type) && ((CREATE_STYPE == header.s_type) ||
+                                             (DEL_STYPE == header.s_type)))
+    {
+        room_req_t * p_req = (room_req_t *) p_packet;
+
+        return_val = cr_frame_get_string(p_payload, payload_len, &offset,
+                               p_req->p_room_name, MAX_ROOM_NAME_LENGTH);
+    }
+    else if ((ROOMS_TYPE == header.type) && (JOIN_STYPE == header.s_type))
+    {
+        join_req_t * p_req = (join_req_t *) p_packet;
+        uint64_t since = 0;
+
+        return_val = cr_frame_get_string(p_payload, payload_len, &offset,
+                               p_req->p_room_name, MAX_ROOM_NAME_LENGTH);
+
+        //NOTE: since is optional, as it is in v1.
+        if ((SUCCESS == return_val) && (offset < payload_len))
+        {
+            int varint_len = cr_frame_get_varint((p_payload + offset),
+                                        (payload_len - offset), &since);
+
+            if (0 >= varint_len)
+            {
+                return FRAME_INVALID;
+            }
+
+            offset += varint_len;
+        }
+
+        p_req->since = htobe64(since);
+    }
+    else if ((CHAT_TYPE == header.type) && (CHAT_STYPE == header.s_type))
+    {
+        chat_t * p_req = (chat_t *) p_packet;
+
+        return_val = cr_frame_get_string(p_payload, payload_len, &offset,
+                                          p_req->p_chat, MAX_CHAT_LEN);
+    }
+    else
+    {
+        memcpy((p_packet + offset), (p_payload + offset),
+                                 (payload_len - offset));
+        offset = payload_len;
+    }
+
+    if ((SUCCESS != return_val) || (offset != payload_len))
+    {
+        return FRAME_INVALID;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Finds the length of the v1 packet at the start of the buffer from
+ * its type and sub-type, so several pipelined v1 packets can be split.
+ * Unknown packets take the whole remainder like the one packet per read v1
+ * behaviour.
+ *
+ * @param p_start start of the unread bytes.
+ * @param available number of unread bytes.
+ * @param version protocol version of the connection, PROTOCOL_LEGACY joins
+ * have no since field.
+ * @return size_t length of the packet, which may be more than available.
+ */
+static size_t
+cr_frame_v1_length (const char * p_start, size_t available, uint8_t version)
+{
+    size_t packet_len = available;
+
+    if (sizeof(received_msg_t) > available)
+    {
+        return sizeof(received_msg_t);
+    }
+
+    uint8_t type = (uint8_t) p_start[0];
+    uint8_t s_type = (uint8_t) p_start[1];
+
+    if ((ACCOUNT_TYPE == type) &&
+        ((REGISTER_STYPE == s_type) || (LOGIN_STYPE == s_type)))
+    {
+        packet_len = sizeof(register_req_t);
+    }
+    else if ((ACCOUNT_TYPE == type) &&
+             ((DEL_STYPE == s_type) || (ADMIN_STYPE == s_type) ||
+              (ADMIN_REMOVE_STYPE == s_type)))
+    {
+        packet_len = sizeof(delete_req_t);
+    }
+    else if (((ACCOUNT_TYPE == type) && (LOGOUT_STYPE == s_type)) ||
+             ((ROOMS_TYPE == type) && (LIST_STYPE == s_type)) ||
+             ((CHAT_TYPE == type) && (LEAVE_STYPE == s_type)) ||
+             ((SESSION_TYPE == type) &&
+              ((QUIT_STYPE == s_type) || (STATS_STYPE == s_type))))
+    {
+        packet_len = sizeof(received_msg_t);
+    }
+    else if ((ROOMS_TYPE == type) &&
+             ((CREATE_STYPE == s_type) || (DEL_STYPE == s_type)))
+    {
+        packet_len = sizeof(room_req_t);
+    }
+    //NOTE: Older clients send joins without the since field.
+    else if ((ROOMS_TYPE == type) && (JOIN_STYPE == s_type))
+    {
+        packet_len = (PROTOCOL_LEGACY == version) ?
+                     offsetof(join_req_t, since) : sizeof(join_req_t);
+    }
+    else if ((CHAT_TYPE == type) && (CHAT_STYPE == s_type))
+    {
+        packet_len = offsetof(chat_t, p_chat) + MAX_CHAT_LEN + 1;
+    }
+    else if ((SESSION_TYPE == type) && (VERSION_STYPE == s_type))
+    {
+        packet_len = sizeof(version_t);
+    }
+
+    return packet_len;
+}
+
+/**
+ * @brief Takes the next complete packet out of the session's receive buffer
+ * and writes it to p_packet in the v1 layout the request handlers read. In
+ * v1 everything received is one packet, in v2 one frame is taken at a time.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @param p_packet zeroed buffer of at least BUFF_SIZE bytes.
+ * @return int SUCCESS (0) if a packet was written, FRAME_INCOMPLETE (6) if
+ * more bytes are needed, FRAME_INVALID (7) if a frame was skipped because its
+ * fields were malformed, or FRAME_CORRUPT (8) if the stream can't be read.
+ */
+int
+cr_frame_next (session_t * p_session, char * p_packet)
+{
+    if ((NULL == p_session) || (NULL == p_packet))
+    {
+        CR_LOG_ERROR("cr_frame_next: input NULL");
+        return FRAME_CORRUPT;
+    }
+
+    char * p_start = p_session->p_recv_buffer + p_session->recv_start;
+    size_t available = p_session->recv_end - p_session->recv_start;
+
+    if (0 == available)
+    {
+        return FRAME_INCOMPLETE;
+    }
+
+    if (PROTOCOL_V2 != p_session->version)
+    {
+        size_t packet_len = cr_frame_v1_length(p_start, available,
+                                                p_session->version);
+
+        //NOTE: A packet split across reads waits for the rest of its bytes
+        //instead of being handled cut short.
+        if (packet_len > available)
+        {
+            return FRAME_INCOMPLETE;
+        }
+
+        if (BUFF_SIZE < packet_len)
+        {
+            packet_len = BUFF_SIZE;
+        }
+
+        memcpy(p_packet, p_start, packet_len);
+        p_session->recv_start += packet_len;
+
+        return SUCCESS;
+    }
+
+    uint64_t payload_len = 0;
+    int varint_len = cr_frame_get_varint(p_start, available, &payload_len);
+
+    if (0 == varint_len)
+    {
+        return FRAME_INCOMPLETE;
+    }
+
+    //NOTE: Without a sane length the next frame can't be found, so the
+    //connection is dropped.
+    if ((FAILURE_NEGATIVE == varint_len) ||
+        (MAX_REQUEST_LENGTH < payload_len))
+    {
+        CR_LOG_WARN("cr_frame_next: bad frame length");
+        return FRAME_CORRUPT;
+    }
+
+    if ((varint_len + payload_len) > available)
+    {
+        return FRAME_INCOMPLETE;
+    }
+
+    p_session->recv_start += varint_len + payload_len;
+
+    return cr_frame_decode((p_start + varint_len), payload_len, p_packet);
+}
+
+/**
+ * @brief Moves unread bytes to the front of the session's receive buffer.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ */
+void
+cr_frame_compact (session_t * p_session)
+{
+    if (NULL == p_session)
+    {
+        CR_LOG_ERROR("cr_frame_compact: input NULL");
+        return;
+    }
+
+    if (0 == p_session->recv_start)
+    {
+        return;
+    }
+
+    memmove(p_session->p_recv_buffer,
+           (p_session->p_recv_buffer + p_session->recv_start),
+           (p_session->recv_end - p_session->recv_start));
+
+    p_session->recv_end -= p_session->recv_start;
+    p_session->recv_start = 0;
+}
+
+/**
+ * @brief Handles protocol version requests. Acknowledges the highest version
+ * both sides support and switches the connection to it.
+ *
+ * @param p_session pointer to the connection's session_t struct.
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_buffer pointer to buffer with received message.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_frame_negotiate (session_t * p_session, SSL * p_ssl, char * p_buffer)
+{
+    if ((NULL == p_session) || (NULL == p_buffer))
+    {
+        CR_LOG_ERROR("cr_frame_negotiate: input NULL");
+        return FAILURE;
+    }
+
+    version_t version_req;
+    memset(&version_req, 0, sizeof(version_t));
+    memcpy(&version_req, p_buffer, sizeof(version_t));
+
+    uint8_t version = version_req.version;
+
+    if (PROTOCOL_MAX < version)
+    {
+        version = PROTOCOL_MAX;
+    }
+    else if (PROTOCOL_V1 > version)
+    {
+        version = PROTOCOL_V1;
+    }
+
+    //NOTE: The acknowledge goes out in the framing the request came in, the
+    //switch only applies to packets after it.
+    int return_val = cr_msg_send_version_ack(p_ssl, version);
+
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_frame_negotiate: cr_msg_send_version_ack()");
+        return return_val;
+    }
+
+    p_session->version = version;
+
+    return SUCCESS;
+}
+
+//End of cr_frame.c file
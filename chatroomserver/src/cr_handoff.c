@@ -0,0 +1,1068 @@
+#include "../include/cr_handoff.h"
+#include "../include/cr_msg.h"
+#include "../include/cr_rooms.h"
+#include "../include/cr_shards.h"
+#include "../include/cr_frame.h"
+#include "../include/cr_cluster.h"
+
+//Message types. Every message is one handoff_msg_t on a SOCK_SEQPACKET
+//socket, connections and listening sockets ride along as SCM_RIGHTS.
+#define HANDOFF_HELLO 0   //new to old: version and message size
+#define HANDOFF_LISTEN 1  //old to new: count listening sockets
+#define HANDOFF_SESSION 2 //old to new: session and its connection
+#define HANDOFF_ROOM 3    //old to new: room name and chat_seq
+#define HANDOFF_DONE 4    //old to new: everything was sent
+
+//Handover states of the old process.
+#define HANDOFF_IDLE 0    //no new process yet
+#define HANDOFF_PARKING 1 //sessions are stopping
+#define HANDOFF_MOVING 2  //sessions are handing themselves over
+#define HANDOFF_FREEING 3 //sessions are over and only freed
+#define HANDOFF_ABORTED 4 //new process went away, sessions clean up as usual
+
+typedef struct {
+    uint8_t           type;
+    uint8_t           count;
+    uint16_t          version;
+    uint32_t          size;
+    uint64_t          chat_seq;
+    char              p_room_name[MAX_ROOM_NAME_LENGTH + 1];
+    handoff_session_t session;
+} handoff_msg_t;
+
+static volatile int running = STOP;
+static int listen_fd = FAILURE_NEGATIVE;
+static int conn_fd = FAILURE_NEGATIVE;
+static pthread_t handoff_thread;
+static rooms_t * p_handoff_rooms = NULL;
+
+//NOTE: state, handed_over, the session counts and the listening sockets are
+//guarded by state_mutex. send_mutex keeps the sessions' messages whole.
+static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t state_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t send_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile int state = HANDOFF_IDLE;
+static volatile int handed_over = 0;
+static int live = 0;
+static int parked = 0;
+static int moved = 0;
+static int sent = 0;
+static uint64_t drain_deadline = 0;
+static int p_listeners[MAX_ACCEPTORS];
+static int listener_count = 0;
+
+//NOTE: What the new process took over, only touched by the listener before
+//the sessions start.
+static int p_taken_listeners[MAX_ACCEPTORS];
+static int taken_listener_count = 0;
+static handoff_session_t * pp_taken_sessions[MAX_TOTAL_CLIENTS];
+static int p_taken_fds[MAX_TOTAL_CLIENTS];
+static int taken_count = 0;
+static int taken_next = 0;
+
+/**
+ * @brief Returns the monotonic clock in milliseconds.
+ *
+ * @return uint64_t milliseconds.
+ */
+static uint64_t
+cr_handoff_now_ms ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+/**
+ * @brief Fills a Unix socket address with the handoff socket's path.
+ *
+ * @param p_addr pointer to the address.
+ */
+static void
+cr_handoff_addr (struct sockaddr_un * p_addr)
+{
+    memset(p_addr, 0, sizeof(struct sockaddr_un));
+    p_addr->sun_family = AF_UNIX;
+    strncpy(p_addr->sun_path, HANDOFF_FILENAME, sizeof(p_addr->sun_path) - 1);
+}
+
+/**
+ * @brief Sets the receive timeout of a socket.
+ *
+ * @param socket_fd socket.
+ * @param seconds timeout.
+ */
+static void
+cr_handoff_timeout (int socket_fd, int seconds)
+{
+    struct timeval timeout = {.tv_sec = seconds, .tv_usec = 0};
+
+    if (FAILURE_NEGATIVE == setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO,
+                                    &timeout, sizeof(struct timeval)))
+    {
+        CR_LOG_ERRNO("cr_handoff_timeout: setsockopt SO_RCVTIMEO");
+    }
+}
+
+/**
+ * @brief Sends one message, with file descriptors if there are any.
+ *
+ * @param socket_fd handoff connection.
+ * @param p_msg message.
+ * @param p_fds file descriptors to pass, NULL for none.
+ * @param fd_count number of file descriptors, at most MAX_ACCEPTORS.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_handoff_send (int socket_fd, handoff_msg_t * p_msg, int * p_fds,
+                                                       int fd_count)
+{
+    union {
+        struct cmsghdr align;
+        char           p_buffer[CMSG_SPACE(sizeof(int) * MAX_ACCEPTORS)];
+    } control;
+
+    struct iovec iov = {.iov_base = p_msg, .iov_len = sizeof(handoff_msg_t)};
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(struct msghdr));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if ((NULL != p_fds) && (0 < fd_count))
+    {
+        msg.msg_control = control.p_buffer;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+
+        struct cmsghdr * p_cmsg = CMSG_FIRSTHDR(&msg);
+        p_cmsg->cmsg_level = SOL_SOCKET;
+        p_cmsg->cmsg_type = SCM_RIGHTS;
+        p_cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+        memcpy(CMSG_DATA(p_cmsg), p_fds, sizeof(int) * fd_count);
+    }
+
+    if (sizeof(handoff_msg_t) != sendmsg(socket_fd, &msg, MSG_NOSIGNAL))
+    {
+        CR_LOG_ERRNO("cr_handoff_send: sendmsg");
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Receives one message and the file descriptors sent with it.
+ *
+ * @param socket_fd handoff connection.
+ * @param p_msg message to fill.
+ * @param p_fds array of MAX_ACCEPTORS to fill.
+ * @param p_fd_count set to the number of file descriptors received.
+ * @return ssize_t bytes received, 0 when the other process closed the
+ * connection, or FAILURE_NEGATIVE (-1) with errno set.
+ */
+static ssize_t
+cr_handoff_recv (int socket_fd, handoff_msg_t * p_msg, int * p_fds,
+                                                    int * p_fd_count)
+{
+    union {
+        struct cmsghdr align;
+        char           p_buffer[CMSG_SPACE(sizeof(int) * MAX_ACCEPTORS)];
+    } control;
+
+    struct iovec iov = {.iov_base = p_msg, .iov_len = sizeof(handoff_msg_t)};
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.p_buffer;
+    msg.msg_controllen = sizeof(control.p_buffer);
+
+    *p_fd_count = 0;
+
+    ssize_t recv_len = recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC);
+
+    if (0 >= recv_len)
+    {
+        return recv_len;
+    }
+
+    for (struct cmsghdr * p_cmsg = CMSG_FIRSTHDR(&msg); NULL != p_cmsg;
+                                    p_cmsg = CMSG_NXTHDR(&msg, p_cmsg))
+    {
+        if ((SOL_SOCKET == p_cmsg->cmsg_level) &&
+            (SCM_RIGHTS == p_cmsg->cmsg_type))
+        {
+            *p_fd_count = (p_cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(p_fds, CMSG_DATA(p_cmsg), sizeof(int) * (*p_fd_count));
+        }
+    }
+
+    return recv_len;
+}
+
+/**
+ * @brief Closes file descriptors received with a message that is not used.
+ *
+ * @param p_fds file descriptors.
+ * @param fd_count number of file descriptors.
+ */
+static void
+cr_handoff_close_fds (int * p_fds, int fd_count)
+{
+    for (int idx = 0; idx < fd_count; idx++)
+    {
+        close(p_fds[idx]);
+    }
+}
+
+/**
+ * @brief Frees everything taken over after a handover that did not finish.
+ */
+static void
+cr_handoff_drop_taken ()
+{
+    cr_handoff_close_fds(p_taken_listeners, taken_listener_count);
+    cr_handoff_close_fds(p_taken_fds, taken_count);
+
+    for (int idx = 0; idx < taken_count; idx++)
+    {
+        FREE(pp_taken_sessions[idx]);
+    }
+
+    taken_listener_count = 0;
+    taken_count = 0;
+}
+
+/**
+ * @brief Handles one message from the old process.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_msg message.
+ * @param p_fds file descriptors received with it.
+ * @param fd_count number of file descriptors.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_handoff_take_msg (rooms_t * p_rooms, handoff_msg_t * p_msg, int * p_fds,
+                                                              int fd_count)
+{
+    if ((HANDOFF_LISTEN == p_msg->type) && (0 == taken_listener_count))
+    {
+        memcpy(p_taken_listeners, p_fds, sizeof(int) * fd_count);
+        taken_listener_count = fd_count;
+        return SUCCESS;
+    }
+
+    if (HANDOFF_ROOM == p_msg->type)
+    {
+        cr_handoff_close_fds(p_fds, fd_count);
+        p_msg->p_room_name[MAX_ROOM_NAME_LENGTH] = '\0';
+
+        return cr_rooms_adopt(p_rooms, p_msg->p_room_name, p_msg->chat_seq);
+    }
+
+    if ((HANDOFF_SESSION == p_msg->type) && (1 == fd_count) &&
+        (MAX_TOTAL_CLIENTS > taken_count))
+    {
+        handoff_session_t * p_session = malloc(sizeof(handoff_session_t));
+
+        if (NULL == p_session)
+        {
+            CR_LOG_ERRNO("cr_handoff_take_msg: p_session malloc");
+            close(p_fds[0]);
+            return FAILURE;
+        }
+
+        memcpy(p_session, &p_msg->session, sizeof(handoff_session_t));
+        p_session->p_username[MAX_USERNAME_LENGTH] = '\0';
+        p_session->p_room_name[MAX_ROOM_NAME_LENGTH] = '\0';
+
+        if (RECV_BUFF_SIZE < p_session->pending_len)
+        {
+            p_session->pending_len = 0;
+        }
+
+        pp_taken_sessions[taken_count] = p_session;
+        p_taken_fds[taken_count++] = p_fds[0];
+        return SUCCESS;
+    }
+
+    CR_LOG_WARN("cr_handoff_take_msg: unexpected message %u", p_msg->type);
+    cr_handoff_close_fds(p_fds, fd_count);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Receives messages from the old process until it sends done, then
+ * until it exits and closes the connection.
+ *
+ * @param socket_fd handoff connection.
+ * @param p_rooms pointer to rooms_t struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_handoff_take_all (int socket_fd, rooms_t * p_rooms)
+{
+    uint64_t deadline = cr_handoff_now_ms() + HANDOFF_TAKE_MS;
+    int done = 0;
+
+    while (1)
+    {
+        handoff_msg_t msg;
+        int p_fds[MAX_ACCEPTORS];
+        int fd_count = 0;
+
+        ssize_t recv_len = cr_handoff_recv(socket_fd, &msg, p_fds, &fd_count);
+
+        if (0 == recv_len)
+        {
+            break;
+        }
+
+        if (FAILURE_NEGATIVE == recv_len)
+        {
+            if (((EAGAIN == errno) || (EWOULDBLOCK == errno) ||
+                 (EINTR == errno)) && (cr_handoff_now_ms() < deadline))
+            {
+                continue;
+            }
+
+            CR_LOG_ERRNO("cr_handoff_take_all: recvmsg");
+            return FAILURE;
+        }
+
+        if (done || (sizeof(handoff_msg_t) != recv_len))
+        {
+            cr_handoff_close_fds(p_fds, fd_count);
+            continue;
+        }
+
+        if (HANDOFF_DONE == msg.type)
+        {
+            done = 1;
+            continue;
+        }
+
+        if (FAILURE == cr_handoff_take_msg(p_rooms, &msg, p_fds, fd_count))
+        {
+            return FAILURE;
+        }
+    }
+
+    if (!done)
+    {
+        CR_LOG_ERROR("cr_handoff_take_all: old process closed early");
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Takes over from a running server in the same directory, if there is
+ * one. Waits until the old process has handed over its rooms, sessions and
+ * listening sockets and has exited. The rooms are added to p_rooms, the
+ * sessions and listening sockets are kept for cr_handoff_next_session and
+ * cr_handoff_listeners.
+ *
+ * @param hot_restart HANDOFF_ON to look for a running server.
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_taken set to 1 if a server was taken over, 0 if not.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_handoff_take (uint8_t hot_restart, rooms_t * p_rooms, int * p_taken)
+{
+    if ((NULL == p_rooms) || (NULL == p_taken))
+    {
+        CR_LOG_ERROR("cr_handoff_take: input NULL");
+        return FAILURE;
+    }
+
+    *p_taken = 0;
+
+    if (HANDOFF_ON != hot_restart)
+    {
+        return SUCCESS;
+    }
+
+    int socket_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+    if (FAILURE_NEGATIVE == socket_fd)
+    {
+        CR_LOG_ERRNO("cr_handoff_take: socket");
+        return FAILURE;
+    }
+
+    struct sockaddr_un addr;
+    cr_handoff_addr(&addr);
+
+    //NOTE: No socket, or one left by a server that is gone, is a cold start.
+    if (FAILURE_NEGATIVE == connect(socket_fd, (struct sockaddr *) &addr,
+                                            sizeof(struct sockaddr_un)))
+    {
+        close(socket_fd);
+        return SUCCESS;
+    }
+
+    CR_LOG_INFO("cr_handoff_take: taking over from the running server");
+    cr_handoff_timeout(socket_fd, 1);
+
+    handoff_msg_t hello;
+    memset(&hello, 0, sizeof(handoff_msg_t));
+    hello.type = HANDOFF_HELLO;
+    hello.version = HANDOFF_VERSION;
+    hello.size = sizeof(handoff_msg_t);
+
+    if ((FAILURE == cr_handoff_send(socket_fd, &hello, NULL, 0)) ||
+        (FAILURE == cr_handoff_take_all(socket_fd, p_rooms)))
+    {
+        CR_LOG_ERROR("cr_handoff_take: handover failed");
+        cr_handoff_drop_taken();
+        close(socket_fd);
+        return FAILURE;
+    }
+
+    close(socket_fd);
+
+    CR_LOG_INFO("cr_handoff_take: took over %d sessions", taken_count);
+    *p_taken = 1;
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Returns the listening sockets taken over from the old process.
+ *
+ * @param p_socket_fds array of MAX_ACCEPTORS to fill.
+ * @return int number of sockets, 0 if nothing was taken over.
+ */
+int
+cr_handoff_listeners (int * p_socket_fds)
+{
+    if (NULL == p_socket_fds)
+    {
+        CR_LOG_ERROR("cr_handoff_listeners: input NULL");
+        return 0;
+    }
+
+    memcpy(p_socket_fds, p_taken_listeners,
+                 sizeof(int) * taken_listener_count);
+
+    return taken_listener_count;
+}
+
+/**
+ * @brief Returns the next session taken over from the old process. The
+ * caller owns the returned record.
+ *
+ * @param p_client_fd set to the session's connection.
+ * @return handoff_session_t * the session's state, NULL when there are no
+ * more.
+ */
+handoff_session_t *
+cr_handoff_next_session (int * p_client_fd)
+{
+    if ((NULL == p_client_fd) || (taken_next >= taken_count))
+    {
+        return NULL;
+    }
+
+    *p_client_fd = p_taken_fds[taken_next];
+
+    return pp_taken_sessions[taken_next++];
+}
+
+/**
+ * @brief Sends the new process every room and its sequence number. Called
+ * once the sessions and workers are idle, so the sequence numbers are final.
+ *
+ * @param socket_fd handoff connection.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_handoff_give_rooms (int socket_fd)
+{
+    if (SUCCESS != CR_MUTEX_LOCK(p_handoff_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_handoff_give_rooms: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    int return_val = SUCCESS;
+    char line_buffer[BUFF_SIZE] = {0};
+    FILE * file_pointer = fopen(ROOM_NAME_LIST, "r");
+
+    while ((SUCCESS == return_val) && (NULL != file_pointer) &&
+           (NULL != fgets(line_buffer, sizeof(line_buffer), file_pointer)))
+    {
+        //NOTE: The buffer is reused, a shorter line leaves the end of the
+        //one before it behind the terminator.
+        size_t line_length = strcspn(line_buffer, "\r\n");
+        memset((line_buffer + line_length), 0,
+               (sizeof(line_buffer) - line_length));
+
+        room_t * p_room = h_table_return_entry(p_handoff_rooms->p_rooms_table,
+                                                                 line_buffer);
+
+        //NOTE: The sessions and workers are idle, nothing else holds the
+        //room.
+        if ((NULL == p_room) || (FAILURE == cr_chats_page_in(p_room)))
+        {
+            continue;
+        }
+
+        handoff_msg_t msg;
+        memset(&msg, 0, sizeof(handoff_msg_t));
+        msg.type = HANDOFF_ROOM;
+        msg.chat_seq = p_room->chat_seq;
+        memcpy(msg.p_room_name, p_room->p_name->p_bytes,
+                                p_room->p_name->length);
+
+        return_val = cr_handoff_send(socket_fd, &msg, NULL, 0);
+    }
+
+    if (NULL != file_pointer)
+    {
+        fclose(file_pointer);
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_handoff_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_handoff_give_rooms: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Moves the handover to a new state and wakes the sessions.
+ *
+ * @param new_state state.
+ */
+static void
+cr_handoff_set_state (int new_state)
+{
+    pthread_mutex_lock(&state_mutex);
+    state = new_state;
+    pthread_cond_broadcast(&state_cond);
+    pthread_mutex_unlock(&state_mutex);
+}
+
+/**
+ * @brief Hands everything over to the new process on socket_fd. Once the
+ * server is stopped there is no going back: the handover either finishes, or
+ * the sessions clean up as in any other shutdown.
+ *
+ * @param socket_fd connection from the new process.
+ * @return int SUCCESS (0) if the server was stopped, FAILURE (1) if the new
+ * process was turned away and the server keeps running.
+ */
+static int
+cr_handoff_give (int socket_fd)
+{
+    handoff_msg_t msg;
+    int p_fds[MAX_ACCEPTORS];
+    int fd_count = 0;
+
+    cr_handoff_timeout(socket_fd, 3);
+
+    ssize_t recv_len = cr_handoff_recv(socket_fd, &msg, p_fds, &fd_count);
+    cr_handoff_close_fds(p_fds, fd_count);
+
+    if ((sizeof(handoff_msg_t) != recv_len) || (HANDOFF_HELLO != msg.type) ||
+        (HANDOFF_VERSION != msg.version) ||
+        (sizeof(handoff_msg_t) != msg.size))
+    {
+        CR_LOG_WARN("cr_handoff_give: new process does not match");
+        return FAILURE;
+    }
+
+    pthread_mutex_lock(&state_mutex);
+    fd_count = listener_count;
+    memcpy(p_fds, p_listeners, sizeof(int) * fd_count);
+    pthread_mutex_unlock(&state_mutex);
+
+    memset(&msg, 0, sizeof(handoff_msg_t));
+    msg.type = HANDOFF_LISTEN;
+    msg.count = fd_count;
+
+    if (FAILURE == cr_handoff_send(socket_fd, &msg, p_fds, fd_count))
+    {
+        return FAILURE;
+    }
+
+    CR_LOG_INFO("cr_handoff_give: handing over to a new process");
+
+    //NOTE: Before the server stops, so the listener's own cr_cluster_stop
+    //finds it stopped. The new process rejoins the cluster.
+    cr_cluster_stop();
+
+    conn_fd = socket_fd;
+    cr_handoff_set_state(HANDOFF_PARKING);
+    server_interrupt = STOP;
+
+    uint64_t deadline = cr_handoff_now_ms() + HANDOFF_PARK_MS;
+
+    pthread_mutex_lock(&state_mutex);
+
+    while ((parked < live) && (cr_handoff_now_ms() < deadline))
+    {
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += 1;
+        pthread_cond_timedwait(&state_cond, &state_mutex, &wake);
+    }
+
+    if (parked < live)
+    {
+        CR_LOG_WARN("cr_handoff_give: %d sessions did not stop",
+                                                 live - parked);
+    }
+
+    pthread_mutex_unlock(&state_mutex);
+
+    //NOTE: Chats already posted to the workers reach the members before
+    //their connections move.
+    cr_shards_drain();
+
+    struct pollfd poll_fd = {.fd = socket_fd, .events = POLLIN};
+
+    if ((0 != poll(&poll_fd, 1, 0)) ||
+        (FAILURE == cr_handoff_give_rooms(socket_fd)))
+    {
+        CR_LOG_ERROR("cr_handoff_give: new process went away");
+        cr_handoff_set_state(HANDOFF_ABORTED);
+        return SUCCESS;
+    }
+
+    //NOTE: Every client gets the notice once the state moves, they share
+    //one deadline so a client that never answers can't hold up the rest.
+    drain_deadline = cr_handoff_now_ms() + HANDOFF_DRAIN_MS;
+    cr_handoff_set_state(HANDOFF_MOVING);
+
+    pthread_mutex_lock(&state_mutex);
+
+    while (moved < parked)
+    {
+        pthread_cond_wait(&state_cond, &state_mutex);
+    }
+
+    int sent_count = sent;
+    pthread_mutex_unlock(&state_mutex);
+
+    memset(&msg, 0, sizeof(handoff_msg_t));
+    msg.type = HANDOFF_DONE;
+
+    if (SUCCESS == cr_handoff_send(socket_fd, &msg, NULL, 0))
+    {
+        handed_over = 1;
+        CR_LOG_INFO("cr_handoff_give: handed over %d sessions", sent_count);
+    }
+
+    cr_handoff_set_state(HANDOFF_FREEING);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Waits for a new server process to connect and take over.
+ *
+ * @param p_arg unused.
+ * @return void * NULL.
+ */
+static void *
+cr_handoff_thread (void * p_arg)
+{
+    (void) p_arg;
+
+    struct pollfd poll_fd = {.fd = listen_fd, .events = POLLIN};
+
+    while ((CONTINUE == running) && (CONTINUE == server_interrupt))
+    {
+        //NOTE: Woken every second to see whether the server is stopping.
+        if (0 >= poll(&poll_fd, 1, 1000))
+        {
+            continue;
+        }
+
+        int socket_fd = accept(listen_fd, NULL, NULL);
+
+        if (FAILURE_NEGATIVE == socket_fd)
+        {
+            continue;
+        }
+
+        if (SUCCESS == cr_handoff_give(socket_fd))
+        {
+            break;
+        }
+
+        close(socket_fd);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts listening for a new server process that wants to take over.
+ *
+ * @param hot_restart HANDOFF_ON to listen, HANDOFF_OFF does nothing.
+ * @param p_rooms pointer to rooms_t struct, whose rooms are handed over.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_handoff_start (uint8_t hot_restart, rooms_t * p_rooms)
+{
+    if (NULL == p_rooms)
+    {
+        CR_LOG_ERROR("cr_handoff_start: input NULL");
+        return FAILURE;
+    }
+
+    if (HANDOFF_ON != hot_restart)
+    {
+        return SUCCESS;
+    }
+
+    p_handoff_rooms = p_rooms;
+    listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+    if (FAILURE_NEGATIVE == listen_fd)
+    {
+        CR_LOG_ERRNO("cr_handoff_start: socket");
+        return FAILURE;
+    }
+
+    struct sockaddr_un addr;
+    cr_handoff_addr(&addr);
+
+    //NOTE: The socket of a server that was taken over, or that crashed, is
+    //still on disk.
+    unlink(HANDOFF_FILENAME);
+
+    if ((FAILURE_NEGATIVE == bind(listen_fd, (struct sockaddr *) &addr,
+                                          sizeof(struct sockaddr_un))) ||
+        (FAILURE_NEGATIVE == listen(listen_fd, 1)))
+    {
+        CR_LOG_ERRNO("cr_handoff_start: bind/listen");
+        close(listen_fd);
+        listen_fd = FAILURE_NEGATIVE;
+        return FAILURE;
+    }
+
+    running = CONTINUE;
+
+    if (0 != pthread_create(&handoff_thread, NULL, cr_handoff_thread, NULL))
+    {
+        CR_LOG_ERRNO("cr_handoff_start: pthread_create");
+        running = STOP;
+        unlink(HANDOFF_FILENAME);
+        close(listen_fd);
+        listen_fd = FAILURE_NEGATIVE;
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Stops listening for a new server process. After a handover this
+ * closes the connection the new process waits on, so it must be the last
+ * thing the old process does before exiting.
+ */
+void
+cr_handoff_stop ()
+{
+    if (CONTINUE == running)
+    {
+        running = STOP;
+
+        if (SUCCESS != pthread_join(handoff_thread, NULL))
+        {
+            CR_LOG_ERRNO("cr_handoff_stop: pthread_join:");
+        }
+    }
+
+    //NOTE: After a handover the path is the new process's to replace.
+    if (FAILURE_NEGATIVE != listen_fd)
+    {
+        if (!handed_over)
+        {
+            unlink(HANDOFF_FILENAME);
+        }
+
+        close(listen_fd);
+        listen_fd = FAILURE_NEGATIVE;
+    }
+
+    if (FAILURE_NEGATIVE != conn_fd)
+    {
+        close(conn_fd);
+        conn_fd = FAILURE_NEGATIVE;
+    }
+}
+
+/**
+ * @brief Adds a listening socket to the ones handed over.
+ *
+ * @param socket_fd listening socket.
+ */
+void
+cr_handoff_listener (int socket_fd)
+{
+    pthread_mutex_lock(&state_mutex);
+
+    if (MAX_ACCEPTORS > listener_count)
+    {
+        p_listeners[listener_count++] = socket_fd;
+    }
+
+    pthread_mutex_unlock(&state_mutex);
+}
+
+/**
+ * @brief Counts sessions handed to the thread pool and sessions that ended,
+ * so the handover knows how many to wait for.
+ *
+ * @param change 1 for a new session, -1 for one that ended.
+ */
+void
+cr_handoff_session_add (int change)
+{
+    pthread_mutex_lock(&state_mutex);
+    live += change;
+    pthread_cond_broadcast(&state_cond);
+    pthread_mutex_unlock(&state_mutex);
+}
+
+/**
+ * @brief Returns whether this process is being taken over.
+ *
+ * @return int 1 once a new process has started taking over, 0 if not.
+ */
+int
+cr_handoff_active ()
+{
+    return (HANDOFF_IDLE != state);
+}
+
+/**
+ * @brief Returns whether this process handed everything over, in which case
+ * the rooms directory now belongs to the new process.
+ *
+ * @return int 1 if handed over, 0 if not.
+ */
+int
+cr_handoff_done ()
+{
+    return handed_over;
+}
+
+/**
+ * @brief Sends the client the resume notice, ends TLS, and reads until the
+ * client's close notify or the drain deadline. Requests that arrive in the
+ * meantime are kept in the receive buffer for the new process.
+ *
+ * @param p_cr_package pointer to the session's package.
+ * @return int SUCCESS (0), or FAILURE (1) if the client did not resume.
+ */
+static int
+cr_handoff_close_tls (cr_package_t * p_cr_package)
+{
+    SSL * p_ssl = p_cr_package->p_ssl_holder->p_ssl;
+    session_t * p_session = p_cr_package->p_session;
+
+    //NOTE: The notice goes out in the same write as the updates still
+    //waiting for the flusher, so it is the last thing the client reads.
+    cr_msg_batch(p_ssl);
+    cr_msg_send_ack(p_ssl, SESSION_TYPE, RESUME_STYPE);
+
+    if (SUCCESS != cr_msg_flush(p_ssl))
+    {
+        CR_LOG_ERROR("cr_handoff_close_tls: cr_msg_flush()");
+        return FAILURE;
+    }
+
+    SSL_shutdown(p_ssl);
+
+    struct pollfd poll_fd = {.fd = p_cr_package->p_ssl_holder->client_fd,
+                             .events = POLLIN};
+
+    while (1)
+    {
+        cr_frame_compact(p_session);
+
+        if (RECV_BUFF_SIZE == p_session->recv_end)
+        {
+            break;
+        }
+
+        //NOTE: The session's socket only times out after 3 seconds, so the
+        //wait for more input is bounded by poll instead.
+        uint64_t now = cr_handoff_now_ms();
+
+        if ((0 == SSL_pending(p_ssl)) &&
+            ((now >= drain_deadline) ||
+             (0 >= poll(&poll_fd, 1, (int) (drain_deadline - now)))))
+        {
+            break;
+        }
+
+        int return_val = SSL_read(p_ssl,
+                        (p_session->p_recv_buffer + p_session->recv_end),
+                        (RECV_BUFF_SIZE - p_session->recv_end));
+
+        if (0 < return_val)
+        {
+            p_session->recv_end += return_val;
+            continue;
+        }
+
+        if (SSL_ERROR_ZERO_RETURN == SSL_get_error(p_ssl, return_val))
+        {
+            return SUCCESS;
+        }
+
+        if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))
+        {
+            break;
+        }
+    }
+
+    return FAILURE;
+}
+
+/**
+ * @brief Sends a stopped session and its connection to the new process.
+ *
+ * @param p_cr_package pointer to the session's package.
+ * @param logged_in whether the user is logged in.
+ * @param chatting whether the user is in a room.
+ * @param p_user pointer to the logged in user, NULL if not logged in.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_handoff_move (cr_package_t * p_cr_package, int logged_in, int chatting,
+                                                           user_t * p_user)
+{
+    if (FAILURE == cr_handoff_close_tls(p_cr_package))
+    {
+        //NOTE: The close notify already went out. Another SSL_shutdown when
+        //the session is freed would wait on the client's for the socket's
+        //whole timeout and hold up the old process's exit.
+        SSL_set_quiet_shutdown(p_cr_package->p_ssl_holder->p_ssl, 1);
+        CR_LOG_WARN("cr_handoff_move: client did not resume");
+        return FAILURE;
+    }
+
+    session_t * p_session = p_cr_package->p_session;
+
+    handoff_msg_t msg;
+    memset(&msg, 0, sizeof(handoff_msg_t));
+    msg.type = HANDOFF_SESSION;
+    msg.session.version = p_session->version;
+    msg.session.compression = p_session->compression;
+
+    if ((LOGGED_IN == logged_in) && (NULL != p_user))
+    {
+        msg.session.logged_in = LOGGED_IN;
+        memcpy(msg.session.p_username, p_user->p_name->p_bytes,
+                                       p_user->p_name->length);
+
+        if ((CHATTING == chatting) && (NULL != p_user->p_room_name))
+        {
+            msg.session.chatting = CHATTING;
+            memcpy(msg.session.p_room_name, p_user->p_room_name->p_bytes,
+                                            p_user->p_room_name->length);
+        }
+    }
+
+    msg.session.pending_len = p_session->recv_end - p_session->recv_start;
+    memcpy(msg.session.p_pending,
+           (p_session->p_recv_buffer + p_session->recv_start),
+           msg.session.pending_len);
+
+    pthread_mutex_lock(&send_mutex);
+    int return_val = cr_handoff_send(conn_fd, &msg,
+                    &p_cr_package->p_ssl_holder->client_fd, 1);
+    pthread_mutex_unlock(&send_mutex);
+
+    return return_val;
+}
+
+/**
+ * @brief Hands a session that stopped reading over to the new process. Waits
+ * for every other session to stop, sends the client the resume notice, ends
+ * TLS, and passes the connection with its login, room, protocol state and
+ * unhandled input. Waits until the handover is finished.
+ *
+ * @param p_cr_package pointer to the session's package.
+ * @param logged_in whether the user is logged in.
+ * @param chatting whether the user is in a room.
+ * @param p_user pointer to the logged in user, NULL if not logged in.
+ * @return int SUCCESS (0) if the session is over and must only be freed
+ * (handed over, or dropped), FAILURE (1) if the handover was abandoned and
+ * the session must leave its room and log out as usual.
+ */
+int
+cr_handoff_session (cr_package_t * p_cr_package, int logged_in, int chatting,
+                                                             user_t * p_user)
+{
+    if (NULL == p_cr_package)
+    {
+        CR_LOG_ERROR("cr_handoff_session: input NULL");
+        return FAILURE;
+    }
+
+    pthread_mutex_lock(&state_mutex);
+
+    //NOTE: A session that stops after the others were moved, one that sat
+    //in the pool's queue past the wait, is dropped.
+    if (HANDOFF_PARKING == state)
+    {
+        parked++;
+        pthread_cond_broadcast(&state_cond);
+
+        while (HANDOFF_PARKING == state)
+        {
+            pthread_cond_wait(&state_cond, &state_mutex);
+        }
+
+        if (HANDOFF_MOVING == state)
+        {
+            pthread_mutex_unlock(&state_mutex);
+
+            int move_val = cr_handoff_move(p_cr_package, logged_in, chatting,
+                                                                    p_user);
+
+            if (FAILURE == move_val)
+            {
+                CR_LOG_ERROR("cr_handoff_session: cr_handoff_move()");
+            }
+
+            pthread_mutex_lock(&state_mutex);
+            moved++;
+            sent += (SUCCESS == move_val);
+            pthread_cond_broadcast(&state_cond);
+
+            while (HANDOFF_MOVING == state)
+            {
+                pthread_cond_wait(&state_cond, &state_mutex);
+            }
+        }
+    }
+
+    int return_val = (HANDOFF_ABORTED == state) ? FAILURE : SUCCESS;
+
+    pthread_mutex_unlock(&state_mutex);
+
+    return return_val;
+}
+
+//End of cr_handoff.c file
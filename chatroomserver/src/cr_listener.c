@@ -1,3 +1,6 @@
+//NOTE: Needed for pthread_setaffinity_np and the CPU_SET macros.
+#define _GNU_SOURCE
+
 #include "../include/cr_listener.h"
 
 /**
@@ -22,6 +25,10 @@ cr_listener_clean(users_t * p_users, h_table_t * p_users_table,
                   rooms_t * p_rooms, h_table_t * p_rooms_table,
                   t_pool_t * p_t_pool, int rooms_clean)
 {
+    //NOTE: Before the thread pool, the bus applies remote changes under the
+    //users and rooms mutexes that t_pool_destroy frees.
+    cr_cluster_stop();
+
     //WARNING: t_pool_destroy frees mutexes inside of p_users and p_rooms,
     //do not double free below.
     if (NULL != p_t_pool)
@@ -29,6 +36,19 @@ cr_listener_clean(users_t * p_users, h_table_t * p_users_table,
         t_pool_destroy(p_t_pool, WAIT);
     }
 
+    //NOTE: After the sessions so chats they posted are still handled, and
+    //before the rooms are freed.
+    cr_shards_stop();
+    cr_flush_stop();
+    cr_metrics_stop();
+    cr_stats_stop();
+    cr_lockstat_stop();
+    cr_trace_stop();
+
+    //NOTE: Stopped last so the modules above can still log while they stop.
+    //Anything logged after this is written straight to stderr.
+    cr_log_stop();
+
     if (NULL != p_users)
     {
         h_table_destroy(p_users->p_users_table, &free);
@@ -39,7 +59,16 @@ cr_listener_clean(users_t * p_users, h_table_t * p_users_table,
         h_table_destroy(p_users_table, &free);
     }
 
-    if(NULL != p_rooms)
+    //NOTE: After a hot restart handover the rooms and their logs belong to
+    //the new process, persistent rooms keep theirs for the next run.
+    int keep_logs = cr_handoff_done() || cr_rooms_persistent();
+
+    if ((NULL != p_rooms) && keep_logs)
+    {
+        h_table_destroy(p_rooms->p_rooms_table, &free_rooms_keep);
+        FREE(p_rooms);
+    }
+    else if (NULL != p_rooms)
     {
         h_table_destroy(p_rooms->p_rooms_table, &free_rooms);
         FREE(p_rooms);
@@ -49,16 +78,47 @@ cr_listener_clean(users_t * p_users, h_table_t * p_users_table,
         h_table_destroy(p_rooms_table, &free_rooms);
     }
 
-    if (CLEAN == rooms_clean)
+    if ((CLEAN == rooms_clean) && !keep_logs)
     {
         cr_rooms_clean();
     }
+
+    //NOTE: Last, the new process waits for this to know the old one is gone.
+    cr_handoff_stop();
+}
+
+/**
+ * @brief Pins the calling thread to one core.
+ * 
+ * @param cpu core to run on.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_listener_pin (int cpu)
+{
+    cpu_set_t cpu_set;
+
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                                                             &cpu_set);
+
+    if (0 != err)
+    {
+        errno = err;
+        CR_LOG_ERRNO("cr_listener_pin: pthread_setaffinity_np");
+        return FAILURE;
+    }
+
+    return SUCCESS;
 }
 
 /**
  * @brief Thread created by connection to server. Starts session using session
  * manager library, responsible for cleaning client file descriptor and freeing
- * p_cr_package.
+ * p_cr_package. A session accepted on a pinned core runs on that core, so its
+ * reads, writes and state stay in one core's cache.
  * 
  * @param p_cr_package_holder pointer to package with client file descriptor,
  * users_t struct, and rooms_t struct. Must be void pointer type to be
@@ -69,93 +129,225 @@ cr_listener_thread (void * p_cr_package_holder)
 {    
     if (NULL == p_cr_package_holder)
     {
-        fprintf(stderr, "cr_listener_thread: input NULL\n");
+        CR_LOG_ERROR("cr_listener_thread: input NULL");
         return;
     }
 
     cr_package_t * p_cr_package = p_cr_package_holder;
 
-    if (FAILURE == cr_sm_session_manager(p_cr_package))
+    cr_metrics_gauge_add(METRIC_SESSIONS_WAITING, -1);
+    cr_metrics_gauge_add(METRIC_SESSIONS, 1);
+
+    int client_fd = p_cr_package->p_ssl_holder->client_fd;
+    CR_PROBE(session_start, client_fd);
+
+    //NOTE: Pool threads are shared by every core, so the thread's own mask
+    //is put back once the session ends.
+    cpu_set_t pool_cpus;
+    int pinned = 0;
+
+    if ((NO_CPU != p_cr_package->cpu) &&
+        (0 == pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                                                          &pool_cpus)))
     {
-        fprintf(stderr, "cr_listener_thread: cr_session_manager()\n");
+        pinned = (SUCCESS == cr_listener_pin(p_cr_package->cpu));
+    }
+
+    int return_val = cr_sm_session_manager(p_cr_package);
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_listener_thread: cr_session_manager()");
         server_interrupt = STOP;
     }
+
+    if (pinned)
+    {
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &pool_cpus);
+    }
+
+    CR_PROBE(session_end, client_fd, return_val);
+    cr_metrics_gauge_add(METRIC_SESSIONS, -1);
+    cr_handoff_session_add(-1);
 }
 
 /**
- * @brief Listens for connection attempts and begins a thread to handle client
- * communications.
+ * @brief Thread running a session taken over from the previous server
+ * process. Runs the client's new TLS handshake on the connection it already
+ * has, then continues as cr_listener_thread.
  * 
- * @param p_config_info pointer to configuration information from main server.
- * @return int SUCCESS (0) or FAILURE (1).
+ * @param p_cr_package_holder pointer to package with the client file
+ * descriptor in p_ssl_holder and the session's state in p_resume. Must be
+ * void pointer type to be compatable with pthread library.
  */
-static int
-cr_listener_listen (config_info_t * p_config_info, rooms_t * p_rooms,
-                              users_t * p_users, t_pool_t * p_t_pool)
+static void
+cr_listener_resume (void * p_cr_package_holder)
 {
-    if (NULL == p_config_info)
+    if (NULL == p_cr_package_holder)
     {
-        fprintf(stderr, "cr_listener_listen: input NULL\n");
-        return FAILURE;
+        CR_LOG_ERROR("cr_listener_resume: input NULL");
+        return;
     }
 
-    int socket_fd = n_listen(p_config_info->p_host,
-                                p_config_info->p_port,
-                                p_config_info->max_client);
-    
-    if (FAILURE_NEGATIVE == socket_fd)
+    cr_package_t * p_cr_package = p_cr_package_holder;
+    ssl_socket_holder_t * p_ssl_holder = p_cr_package->p_ssl_holder;
+    SSL_CTX * p_ssl_ctx = p_ssl_holder->p_ssl_ctx;
+
+    int return_val = n_ssl_accept(p_ssl_holder->client_fd, p_ssl_ctx,
+                                                        p_ssl_holder);
+
+    //NOTE: Drops the reference taken when the task was queued, a
+    //successful handshake holds its own.
+    SSL_CTX_free(p_ssl_ctx);
+
+    if (FAILURE == return_val)
     {
-        fprintf(stderr, "cr_listener_listen: n_listen()\n");
+        CR_LOG_WARN("cr_listener_resume: client did not resume");
+        close(p_ssl_holder->client_fd);
+        FREE(p_cr_package->p_resume);
+        CR_FREE(p_ssl_holder);
+        CR_FREE(p_cr_package);
+        cr_metrics_gauge_add(METRIC_SESSIONS_WAITING, -1);
+        cr_handoff_session_add(-1);
+        return;
+    }
+
+    cr_listener_thread(p_cr_package);
+}
+
+/**
+ * @brief Queues the sessions taken over from the previous server process.
+ * A session that can not be queued is closed, its client has to connect
+ * again.
+ * 
+ * @param p_template accept loop settings shared by every loop.
+ */
+static void
+cr_listener_resume_all (cr_acceptor_t * p_template)
+{
+    int client_fd = FAILURE_NEGATIVE;
+    handoff_session_t * p_resume = NULL;
+
+    while (NULL != (p_resume = cr_handoff_next_session(&client_fd)))
+    {
+        cr_package_t * p_cr_package = cr_alloc(sizeof(cr_package_t));
+        ssl_socket_holder_t * p_ssl_holder = cr_alloc(
+                         sizeof(ssl_socket_holder_t));
+
+        if ((NULL == p_cr_package) || (NULL == p_ssl_holder))
+        {
+            CR_LOG_ERRNO("cr_listener_resume_all: cr_alloc");
+            CR_FREE(p_cr_package);
+            CR_FREE(p_ssl_holder);
+            FREE(p_resume);
+            close(client_fd);
+            continue;
+        }
+
+        SSL_CTX_up_ref(p_template->p_ssl_ctx);
+        p_ssl_holder->client_fd = client_fd;
+        p_ssl_holder->p_ssl_ctx = p_template->p_ssl_ctx;
+        p_cr_package->p_rooms = p_template->p_rooms;
+        p_cr_package->p_users = p_template->p_users;
+        p_cr_package->p_ssl_holder = p_ssl_holder;
+        p_cr_package->p_resume = p_resume;
+        p_cr_package->cpu = NO_CPU;
+
+        if (FAILURE == t_pool_submit_task(p_template->p_t_pool,
+                              cr_listener_resume, p_cr_package))
+        {
+            CR_LOG_ERROR("cr_listener_resume_all: t_pool_submit_task()");
+            SSL_CTX_free(p_template->p_ssl_ctx);
+            close(client_fd);
+            FREE(p_resume);
+            CR_FREE(p_ssl_holder);
+            CR_FREE(p_cr_package);
+            continue;
+        }
+
+        cr_metrics_gauge_add(METRIC_SESSIONS_WAITING, 1);
+        cr_handoff_session_add(1);
+    }
+}
+
+/**
+ * @brief Accepts connections on one listening socket and begins a thread to
+ * handle each client's communications. Closes the socket when it returns.
+ * 
+ * @param p_acceptor pointer to the accept loop's socket and shared structures.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_listener_accept (cr_acceptor_t * p_acceptor)
+{
+    if (NULL == p_acceptor)
+    {
+        CR_LOG_ERROR("cr_listener_accept: input NULL");
         return FAILURE;
     }
 
+    int socket_fd = p_acceptor->socket_fd;
+
     while (CONTINUE == server_interrupt)
     {
-        cr_package_t * p_cr_package = calloc(1, sizeof(cr_package_t));
+        cr_package_t * p_cr_package = cr_alloc(sizeof(cr_package_t));
 
         if (NULL == p_cr_package)
         {
-            perror("cr_listener_listen: p_cr_package calloc");
+            CR_LOG_ERRNO("cr_listener_accept: p_cr_package cr_alloc");
             close(socket_fd);
             return FAILURE;
         }
 
-        p_cr_package->p_rooms = p_rooms;
-        p_cr_package->p_users = p_users;
+        p_cr_package->p_rooms = p_acceptor->p_rooms;
+        p_cr_package->p_users = p_acceptor->p_users;
+        p_cr_package->cpu = p_acceptor->cpu;
 
-        ssl_socket_holder_t * p_ssl_holder = calloc(1,
+        ssl_socket_holder_t * p_ssl_holder = cr_alloc(
                          sizeof(ssl_socket_holder_t));
 
         if (NULL == p_ssl_holder)
         {
-            perror("cr_listener_listen: p_ssl_holder calloc");
-            FREE(p_cr_package);
+            CR_LOG_ERRNO("cr_listener_accept: p_ssl_holder cr_alloc");
+            CR_FREE(p_cr_package);
             close(socket_fd);
             return FAILURE;
         }
 
-        int client_fd = n_accept(socket_fd, p_ssl_holder);
+        int client_fd = n_accept(socket_fd, p_acceptor->p_ssl_ctx,
+                                                     p_ssl_holder);
 
         if (FAILURE_NEGATIVE == client_fd)
         {
-            fprintf(stderr, "cr_listener_listen: n_accept()\n");
-            FREE(p_ssl_holder);
-            FREE(p_cr_package);
+            CR_LOG_ERROR("cr_listener_accept: n_accept()");
+            CR_FREE(p_ssl_holder);
+            CR_FREE(p_cr_package);
             close(socket_fd);
             return FAILURE;
         }
 
         p_cr_package->p_ssl_holder = p_ssl_holder;
+        CR_PROBE(handshake_done, client_fd, p_ssl_holder->handshake_ns,
+                                     p_ssl_holder->handshake_failures);
+        cr_metrics_handshake(p_ssl_holder->handshake_ns,
+                             p_ssl_holder->handshake_failures);
 
-        if (FAILURE == t_pool_submit_task(p_t_pool, cr_listener_thread,
-                                                         p_cr_package))
+        if (FAILURE == t_pool_submit_task(p_acceptor->p_t_pool,
+                                 cr_listener_thread, p_cr_package))
         {
-            fprintf(stderr, "cr_listener_listen: t_pool_submit_task()\n");
-            FREE(p_ssl_holder);
-            FREE(p_cr_package);
+            CR_LOG_ERROR("cr_listener_accept: t_pool_submit_task()");
+            SSL_free(p_ssl_holder->p_ssl);
+            SSL_CTX_free(p_ssl_holder->p_ssl_ctx);
+            close(client_fd);
+            CR_FREE(p_ssl_holder);
+            CR_FREE(p_cr_package);
             close(socket_fd);
             return FAILURE;
         }
+
+        //NOTE: The task waits in the pool's queue until a thread is free.
+        cr_metrics_gauge_add(METRIC_SESSIONS_WAITING, 1);
+        cr_handoff_session_add(1);
     }
 
     close(socket_fd);
@@ -163,6 +355,242 @@ cr_listener_listen (config_info_t * p_config_info, rooms_t * p_rooms,
     return SUCCESS;
 }
 
+/**
+ * @brief Thread running one of several accept loops. A loop that fails stops
+ * the others so the server shuts down as it would with a single loop.
+ * 
+ * @param p_acceptor_holder pointer to the loop's cr_acceptor_t. Must be void
+ * pointer type to be compatable with pthread library.
+ * @return void * NULL, the result is left in return_val.
+ */
+static void *
+cr_listener_acceptor (void * p_acceptor_holder)
+{
+    cr_acceptor_t * p_acceptor = p_acceptor_holder;
+
+    if (NO_CPU != p_acceptor->cpu)
+    {
+        cr_listener_pin(p_acceptor->cpu);
+    }
+
+    p_acceptor->return_val = cr_listener_accept(p_acceptor);
+
+    if (FAILURE == p_acceptor->return_val)
+    {
+        server_interrupt = STOP;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Runs several accept loops, each on its own thread with its own
+ * SO_REUSEPORT socket so the kernel spreads new connections (and the TLS
+ * handshakes done in the loops) between them. Every socket is listening
+ * before any loop starts.
+ * 
+ * @param p_config_info pointer to configuration information from main server.
+ * @param p_template accept loop settings shared by every loop.
+ * @param p_cpus cores the process may run on.
+ * @param p_socket_fds listening sockets taken over from the previous server
+ * process, NULL to open count new ones.
+ * @param count number of accept loops.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_listener_acceptors (config_info_t * p_config_info,
+                       cr_acceptor_t * p_template, cpu_set_t * p_cpus,
+                       int * p_socket_fds, int count)
+{
+    cr_acceptor_t * p_acceptors = calloc(count, sizeof(cr_acceptor_t));
+
+    if (NULL == p_acceptors)
+    {
+        CR_LOG_ERRNO("cr_listener_acceptors: p_acceptors calloc");
+        return FAILURE;
+    }
+
+    int cpu = -1;
+
+    for (int idx = 0; idx < count; idx++)
+    {
+        p_acceptors[idx] = *p_template;
+        p_acceptors[idx].cpu = NO_CPU;
+
+        if (p_config_info->pin_acceptors)
+        {
+            //NOTE: Loops past the core count wrap around to the first core.
+            do
+            {
+                cpu = (cpu + 1) % CPU_SETSIZE;
+            } while (!CPU_ISSET(cpu, p_cpus));
+
+            p_acceptors[idx].cpu = cpu;
+        }
+
+        if (NULL != p_socket_fds)
+        {
+            p_acceptors[idx].socket_fd = p_socket_fds[idx];
+            cr_handoff_listener(p_acceptors[idx].socket_fd);
+            continue;
+        }
+
+        p_acceptors[idx].socket_fd = n_listen_shared(p_config_info->p_host,
+                                                     p_config_info->p_port,
+                                                 p_config_info->max_client);
+
+        if (FAILURE_NEGATIVE != p_acceptors[idx].socket_fd)
+        {
+            cr_handoff_listener(p_acceptors[idx].socket_fd);
+        }
+        else
+        {
+            CR_LOG_ERROR("cr_listener_acceptors: n_listen_shared()");
+
+            for (int close_idx = 0; close_idx < idx; close_idx++)
+            {
+                close(p_acceptors[close_idx].socket_fd);
+            }
+
+            FREE(p_acceptors);
+            return FAILURE;
+        }
+    }
+
+    int started = 0;
+
+    for (; started < count; started++)
+    {
+        if (0 != pthread_create(&p_acceptors[started].thread, NULL,
+                         cr_listener_acceptor, &p_acceptors[started]))
+        {
+            CR_LOG_ERRNO("cr_listener_acceptors: pthread_create");
+            server_interrupt = STOP;
+            break;
+        }
+    }
+
+    int return_val = (started == count) ? SUCCESS : FAILURE;
+
+    for (int idx = 0; idx < count; idx++)
+    {
+        if (idx >= started)
+        {
+            close(p_acceptors[idx].socket_fd);
+            continue;
+        }
+
+        pthread_join(p_acceptors[idx].thread, NULL);
+
+        if (FAILURE == p_acceptors[idx].return_val)
+        {
+            return_val = FAILURE;
+        }
+    }
+
+    FREE(p_acceptors);
+
+    return return_val;
+}
+
+/**
+ * @brief Listens for connection attempts and begins a thread to handle client
+ * communications. One accept loop runs on the calling thread; more are spread
+ * over the cores the process may run on.
+ * 
+ * @param p_config_info pointer to configuration information from main server.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_listener_listen (config_info_t * p_config_info, rooms_t * p_rooms,
+                              users_t * p_users, t_pool_t * p_t_pool)
+{
+    if (NULL == p_config_info)
+    {
+        CR_LOG_ERROR("cr_listener_listen: input NULL");
+        return FAILURE;
+    }
+
+    cpu_set_t cpus;
+    int count = p_config_info->acceptors;
+
+    if (0 != pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus))
+    {
+        CR_LOG_ERROR("cr_listener_listen: pthread_getaffinity_np");
+        return FAILURE;
+    }
+
+    if (0 == count)
+    {
+        count = CPU_COUNT(&cpus);
+        count = (MAX_ACCEPTORS < count) ? MAX_ACCEPTORS : count;
+    }
+
+    //NOTE: Shared by every connection, each session holds a reference.
+    SSL_CTX * p_ssl_ctx = createSSLContext();
+
+    if (NULL == p_ssl_ctx)
+    {
+        CR_LOG_ERROR("cr_listener_listen: createSSLContext()");
+        return FAILURE;
+    }
+
+    cr_acceptor_t acceptor = {
+        .socket_fd = FAILURE_NEGATIVE,
+        .cpu = NO_CPU,
+        .return_val = SUCCESS,
+        .p_ssl_ctx = p_ssl_ctx,
+        .p_rooms = p_rooms,
+        .p_users = p_users,
+        .p_t_pool = p_t_pool,
+    };
+
+    //NOTE: After a hot restart the previous process's sockets are used as
+    //they are, one loop each, and its sessions are queued before any new
+    //connection.
+    int p_taken_fds[MAX_ACCEPTORS];
+    int taken = cr_handoff_listeners(p_taken_fds);
+
+    if (0 < taken)
+    {
+        count = taken;
+    }
+
+    cr_listener_resume_all(&acceptor);
+
+    int return_val = SUCCESS;
+
+    if (1 < count)
+    {
+        return_val = cr_listener_acceptors(p_config_info, &acceptor, &cpus,
+                                   (0 < taken) ? p_taken_fds : NULL, count);
+    }
+    else
+    {
+        //NOTE: A single loop is never pinned, it would put every session on
+        //one core.
+        acceptor.socket_fd = (0 < taken) ? p_taken_fds[0] :
+                                  n_listen(p_config_info->p_host,
+                                           p_config_info->p_port,
+                                           p_config_info->max_client);
+
+        if (FAILURE_NEGATIVE == acceptor.socket_fd)
+        {
+            CR_LOG_ERROR("cr_listener_listen: n_listen()");
+            return_val = FAILURE;
+        }
+        else
+        {
+            cr_handoff_listener(acceptor.socket_fd);
+            return_val = cr_listener_accept(&acceptor);
+        }
+    }
+
+    SSL_CTX_free(p_ssl_ctx);
+
+    return return_val;
+}
+
 /**
  * @brief Creates shared structures and thread pool for the server to being listening.
  * Starts listening funciton.
@@ -175,7 +603,32 @@ cr_listener(config_info_t * p_config_info)
 {
     if (NULL == p_config_info)
     {
-        fprintf(stderr, "cr_listenter: input NULL\n");
+        CR_LOG_ERROR("cr_listenter: input NULL");
+        return FAILURE;
+    }
+
+    //NOTE: Started before the thread pool so every thread inherits the
+    //blocked SIGUSR1 and SIGUSR2.
+    if (FAILURE == cr_lockstat_start())
+    {
+        CR_LOG_ERROR("cr_listener: cr_lockstat_start()");
+        return FAILURE;
+    }
+
+    if (FAILURE == cr_trace_start())
+    {
+        CR_LOG_ERROR("cr_listener: cr_trace_start()");
+        cr_lockstat_stop();
+        return FAILURE;
+    }
+
+    //NOTE: Started after the signals are blocked so the drain thread does
+    //not take SIGUSR1 or SIGUSR2.
+    if (FAILURE == cr_log_start(NULL))
+    {
+        CR_LOG_ERROR("cr_listener: cr_log_start()");
+        cr_lockstat_stop();
+        cr_trace_stop();
         return FAILURE;
     }
 
@@ -185,18 +638,23 @@ cr_listener(config_info_t * p_config_info)
 
     if (NULL == p_t_pool)
     {
-        fprintf(stderr, "cr_listener: t_pool_init");
+        CR_LOG_ERROR("cr_listener: t_pool_init");
+        cr_lockstat_stop();
+        cr_trace_stop();
+        cr_log_stop();
         return FAILURE;
     }
 
-    uint8_t room_h_table_size = next_prime(p_config_info->max_rooms);
-    uint8_t user_h_table_size = next_prime(p_config_info->max_client);
+    cr_stats_start(num_threads);
+
+    uint32_t room_h_table_size = prime_capacity(p_config_info->max_rooms);
+    uint32_t user_h_table_size = prime_capacity(p_config_info->max_client);
 
     h_table_t * p_rooms_table = h_table_init(room_h_table_size, NULL);
 
     if (NULL == p_rooms_table)
     {
-        fprintf(stderr, "cr_listener: p_rooms_table init\n");
+        CR_LOG_ERROR("cr_listener: p_rooms_table init");
         cr_listener_clean(NULL, NULL, NULL, NULL, p_t_pool, DONT_CLEAN);
         return FAILURE;
     }
@@ -205,7 +663,7 @@ cr_listener(config_info_t * p_config_info)
 
     if (NULL == p_rooms)
     {
-        perror("cr_listener: p_rooms calloc");
+        CR_LOG_ERRNO("cr_listener: p_rooms calloc");
         cr_listener_clean(NULL, NULL, NULL, p_rooms_table, p_t_pool, 
                                                         DONT_CLEAN);
         return FAILURE;
@@ -220,7 +678,7 @@ cr_listener(config_info_t * p_config_info)
 
     if (NULL == p_users_table)
     {
-        fprintf(stderr, "cr_listener: p_users_table init\n");
+        CR_LOG_ERROR("cr_listener: p_users_table init");
         cr_listener_clean(NULL, NULL, p_rooms, NULL, p_t_pool,DONT_CLEAN);
         return FAILURE;
     }
@@ -229,7 +687,7 @@ cr_listener(config_info_t * p_config_info)
 
     if (NULL == p_users)
     {
-        perror("cr_listener: p_users calloc");
+        CR_LOG_ERRNO("cr_listener: p_users calloc");
         cr_listener_clean(NULL, p_users_table, p_rooms, NULL, p_t_pool,
                                                             DONT_CLEAN);
         return FAILURE;
@@ -242,27 +700,83 @@ cr_listener(config_info_t * p_config_info)
 
     if (FAILURE == cr_users_start(p_users))
     {
-        fprintf(stderr, "cr_listener: cr_users_start()\n");
+        CR_LOG_ERROR("cr_listener: cr_users_start()");
+        cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, DONT_CLEAN);
+        return FAILURE;
+    }
+
+    //NOTE: Before the rooms are started, rooms taken over from a previous
+    //process keep their logs.
+    int taken = 0;
+
+    if (FAILURE == cr_handoff_take(p_config_info->hot_restart, p_rooms,
+                                                              &taken))
+    {
+        CR_LOG_ERROR("cr_listener: cr_handoff_take()");
         cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, DONT_CLEAN);
         return FAILURE;
     }
 
-    if (FAILURE == cr_rooms_start())
+    if (FAILURE == cr_rooms_start(p_rooms, taken,
+                                  p_config_info->persist_rooms))
     {
-        fprintf(stderr, "cr_listener: cr_rooms_start()\n");
+        CR_LOG_ERROR("cr_listener: cr_rooms_start()");
         cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, DONT_CLEAN);
         return FAILURE;
     }
 
-    if (FAILURE == cr_listener_listen(p_config_info, p_rooms, p_users,
-                                                            p_t_pool))
+    cr_compress_set_level(p_config_info->compress_level);
+
+    if (FAILURE == cr_shards_start(p_config_info->room_shards))
+    {
+        CR_LOG_ERROR("cr_listener: cr_shards_start()");
+        cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, CLEAN);
+        return FAILURE;
+    }
+
+    if (FAILURE == cr_cluster_start(p_config_info->cluster_node, p_users,
+                                                             p_rooms))
+    {
+        CR_LOG_ERROR("cr_listener: cr_cluster_start()");
+        cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, CLEAN);
+        return FAILURE;
+    }
+
+    if (FAILURE == cr_flush_start(p_config_info->flush_window_ms))
+    {
+        CR_LOG_ERROR("cr_listener: cr_flush_start()");
+        cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, CLEAN);
+        return FAILURE;
+    }
+
+    if (FAILURE == cr_metrics_start(p_config_info->metrics_port, p_users,
+                                                  p_rooms, p_t_pool))
     {
-        fprintf(stderr, "cr_listener: cr_listener_listen()\n");
+        CR_LOG_ERROR("cr_listener: cr_metrics_start()");
         cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, CLEAN);
         return FAILURE;
     }
 
+    if (FAILURE == cr_handoff_start(p_config_info->hot_restart, p_rooms))
+    {
+        CR_LOG_ERROR("cr_listener: cr_handoff_start()");
+        cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, CLEAN);
+        return FAILURE;
+    }
+
+    int return_val = cr_listener_listen(p_config_info, p_rooms, p_users,
+                                                            p_t_pool);
+
     cr_listener_clean(p_users, NULL, p_rooms, NULL, p_t_pool, CLEAN);
+
+    //NOTE: A handover stops the accept loops in the middle of n_accept(),
+    //which they report as a failure. Only known once the sessions are gone.
+    if ((FAILURE == return_val) && !cr_handoff_done())
+    {
+        CR_LOG_ERROR("cr_listener: cr_listener_listen()");
+        return FAILURE;
+    }
+
     return SUCCESS;
 }
 
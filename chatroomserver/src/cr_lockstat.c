@@ -0,0 +1,385 @@
+#include "../include/cr_lockstat.h"
+#include "../include/cr_shared.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef CR_LOCK_PROFILE
+
+//NOTE: The locks a thread holds, with the site that locked them and when, so
+//the unlock can charge the hold time to the right site.
+typedef struct {
+    pthread_mutex_t * p_mutex;
+    cr_lock_site_t *  p_site;
+    uint64_t          locked_ns;
+} lockstat_held_t;
+
+static pthread_t lockstat_thread;
+static volatile int running = STOP;
+static cr_lock_site_t * p_sites_head = NULL;
+static __thread lockstat_held_t p_held[LOCKSTAT_DEPTH];
+static __thread int held_count = 0;
+
+/**
+ * @brief Returns CLOCK_MONOTONIC in nanoseconds.
+ *
+ * @return uint64_t current time.
+ */
+static inline uint64_t
+cr_lockstat_now ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @brief Raises a maximum shared between threads.
+ *
+ * @param p_max pointer to the maximum.
+ * @param value value to compare against it.
+ */
+static inline void
+cr_lockstat_max (uint64_t * p_max, uint64_t value)
+{
+    uint64_t current = __atomic_load_n(p_max, __ATOMIC_RELAXED);
+
+    while ((value > current) &&
+           (!__atomic_compare_exchange_n(p_max, &current, value, 1,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)))
+    {
+    }
+}
+
+/**
+ * @brief Links a site into the list of sites the first time it is used.
+ *
+ * @param p_site call site record.
+ */
+static void
+cr_lockstat_register (cr_lock_site_t * p_site)
+{
+    int expected = 0;
+
+    if (!__atomic_compare_exchange_n(&p_site->registered, &expected, 1, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+
+    cr_lock_site_t * p_head = __atomic_load_n(&p_sites_head,
+                                              __ATOMIC_RELAXED);
+
+    do
+    {
+        p_site->p_next = p_head;
+    } while (!__atomic_compare_exchange_n(&p_sites_head, &p_head, p_site, 1,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Locks a mutex, counting the acquisition against its call site and
+ * timing the wait if the mutex was already held. Used through
+ * CR_MUTEX_LOCK.
+ *
+ * @param p_site call site record.
+ * @param p_mutex mutex to lock.
+ * @return int result of pthread_mutex_lock.
+ */
+int
+cr_lockstat_lock (cr_lock_site_t * p_site, pthread_mutex_t * p_mutex)
+{
+    if (0 == __atomic_load_n(&p_site->registered, __ATOMIC_ACQUIRE))
+    {
+        cr_lockstat_register(p_site);
+    }
+
+    uint16_t trace_site = cr_trace_site(&p_site->trace_site);
+
+    //NOTE: Only a lock that is already held pays for the clock reads of the
+    //wait.
+    int status = pthread_mutex_trylock(p_mutex);
+
+    if (EBUSY == status)
+    {
+        cr_trace_record(TRACE_LOCK_WAIT, trace_site,
+                        (uint32_t) (uintptr_t) p_mutex);
+        uint64_t start_ns = cr_lockstat_now();
+        status = pthread_mutex_lock(p_mutex);
+        uint64_t wait_ns = cr_lockstat_now() - start_ns;
+
+        __atomic_add_fetch(&p_site->contended, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&p_site->wait_ns, wait_ns, __ATOMIC_RELAXED);
+        cr_lockstat_max(&p_site->wait_max_ns, wait_ns);
+    }
+
+    if (SUCCESS != status)
+    {
+        return status;
+    }
+
+    __atomic_add_fetch(&p_site->acquisitions, 1, __ATOMIC_RELAXED);
+    cr_trace_record(TRACE_LOCK_ACQUIRED, trace_site,
+                    (uint32_t) (uintptr_t) p_mutex);
+
+    if (LOCKSTAT_DEPTH > held_count)
+    {
+        p_held[held_count].p_mutex = p_mutex;
+        p_held[held_count].p_site = p_site;
+        p_held[held_count].locked_ns = cr_lockstat_now();
+        held_count++;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Unlocks a mutex and adds how long it was held to the site that
+ * locked it. Used through CR_MUTEX_UNLOCK.
+ *
+ * @param p_mutex mutex to unlock.
+ * @return int result of pthread_mutex_unlock.
+ */
+int
+cr_lockstat_unlock (pthread_mutex_t * p_mutex)
+{
+    for (int idx = (held_count - 1); idx >= 0; idx--)
+    {
+        if (p_mutex != p_held[idx].p_mutex)
+        {
+            continue;
+        }
+
+        uint64_t hold_ns = cr_lockstat_now() - p_held[idx].locked_ns;
+        cr_lock_site_t * p_site = p_held[idx].p_site;
+
+        __atomic_add_fetch(&p_site->hold_ns, hold_ns, __ATOMIC_RELAXED);
+        cr_lockstat_max(&p_site->hold_max_ns, hold_ns);
+
+        held_count--;
+        memmove(&p_held[idx], &p_held[idx + 1],
+                (held_count - idx) * sizeof(lockstat_held_t));
+        break;
+    }
+
+    return cr_trace_unlock(p_mutex);
+}
+
+/**
+ * @brief Orders sites by total wait, longest first. Used with qsort.
+ *
+ * @param p_left pointer to a site pointer.
+ * @param p_right pointer to a site pointer.
+ * @return int qsort comparison result.
+ */
+static int
+cr_lockstat_compare (const void * p_left, const void * p_right)
+{
+    uint64_t left = (*(cr_lock_site_t * const *) p_left)->wait_ns;
+    uint64_t right = (*(cr_lock_site_t * const *) p_right)->wait_ns;
+
+    return (left < right) - (left > right);
+}
+
+/**
+ * @brief Prints every lock site: acquisitions, how many found the lock
+ * held, total and worst wait, and average and worst hold. Sites are sorted
+ * by total wait.
+ *
+ * @param p_file stream to write to.
+ */
+void
+cr_lockstat_print (FILE * p_file)
+{
+    if (NULL == p_file)
+    {
+        CR_LOG_ERROR("cr_lockstat_print: input NULL");
+        return;
+    }
+
+    cr_lock_site_t * pp_sites[LOCKSTAT_MAX_SITES];
+    int site_count = 0;
+
+    for (cr_lock_site_t * p_site = __atomic_load_n(&p_sites_head,
+                                                   __ATOMIC_ACQUIRE);
+         (NULL != p_site) && (LOCKSTAT_MAX_SITES > site_count);
+         p_site = p_site->p_next)
+    {
+        pp_sites[site_count++] = p_site;
+    }
+
+    qsort(pp_sites, site_count, sizeof(cr_lock_site_t *),
+                                      cr_lockstat_compare);
+
+    fprintf(p_file, "%-30s %-36s %11s %11s %6s %11s %11s %11s %11s\n",
+            "lock", "site", "acquired", "contended", "cont%", "wait_ms",
+            "wait_max_us", "hold_avg_us", "hold_max_us");
+
+    for (int idx = 0; idx < site_count; idx++)
+    {
+        cr_lock_site_t * p_site = pp_sites[idx];
+        char p_where[FILE_NAME_MAX_LEN] = {0};
+
+        uint64_t acquisitions = __atomic_load_n(&p_site->acquisitions,
+                                                __ATOMIC_RELAXED);
+        uint64_t contended = __atomic_load_n(&p_site->contended,
+                                             __ATOMIC_RELAXED);
+
+        snprintf(p_where, FILE_NAME_MAX_LEN, "%s:%d", p_site->p_function,
+                                                          p_site->line);
+
+        fprintf(p_file, "%-30s %-36s %11" PRIu64 " %11" PRIu64 " %6.2f "
+                "%11.3f %11.1f %11.2f %11.1f\n", p_site->p_lock, p_where,
+                acquisitions, contended,
+                (0 == acquisitions) ? 0.0 :
+                    ((100.0 * contended) / acquisitions),
+                __atomic_load_n(&p_site->wait_ns, __ATOMIC_RELAXED) / 1e6,
+                __atomic_load_n(&p_site->wait_max_ns, __ATOMIC_RELAXED) /
+                                                                      1e3,
+                (0 == acquisitions) ? 0.0 :
+                    ((__atomic_load_n(&p_site->hold_ns, __ATOMIC_RELAXED) /
+                                               1e3) / acquisitions),
+                __atomic_load_n(&p_site->hold_max_ns, __ATOMIC_RELAXED) /
+                                                                      1e3);
+    }
+
+    fflush(p_file);
+}
+
+/**
+ * @brief Summary thread. Prints the lock summary each time SIGUSR1 arrives
+ * until stopped.
+ *
+ * @param p_arg unused, required by pthread_create.
+ * @return void* NULL.
+ */
+static void *
+cr_lockstat_thread (void * p_arg)
+{
+    (void) p_arg;
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+
+    //NOTE: The timeout lets the thread see the stop flag.
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = 500000000L};
+
+    while (CONTINUE == running)
+    {
+        if (SIGUSR1 == sigtimedwait(&signals, NULL, &timeout))
+        {
+            cr_lockstat_print(stderr);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the thread that prints the lock summary on SIGUSR1. Blocks
+ * SIGUSR1 in the calling thread, so it must be called before any other
+ * thread is created.
+ *
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_lockstat_start ()
+{
+    if (CONTINUE == running)
+    {
+        return SUCCESS;
+    }
+
+    //NOTE: Threads inherit the mask, so SIGUSR1 is only ever taken by
+    //sigtimedwait and never interrupts a session's reads.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+
+    if (SUCCESS != pthread_sigmask(SIG_BLOCK, &signals, NULL))
+    {
+        CR_LOG_ERRNO("cr_lockstat_start: pthread_sigmask:");
+        return FAILURE;
+    }
+
+    running = CONTINUE;
+
+    if (SUCCESS != pthread_create(&lockstat_thread, NULL, cr_lockstat_thread,
+                                                                      NULL))
+    {
+        CR_LOG_ERRNO("cr_lockstat_start: pthread_create:");
+        running = STOP;
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Stops the summary thread and prints a last summary.
+ */
+void
+cr_lockstat_stop ()
+{
+    if (CONTINUE != running)
+    {
+        return;
+    }
+
+    running = STOP;
+
+    if (SUCCESS != pthread_join(lockstat_thread, NULL))
+    {
+        CR_LOG_ERRNO("cr_lockstat_stop: pthread_join:");
+    }
+
+    cr_lockstat_print(stderr);
+}
+
+#else
+
+/**
+ * @brief Starts the thread that prints the lock summary on SIGUSR1. Lock
+ * profiling is not built in, so there is nothing to start.
+ *
+ * @return int SUCCESS (0).
+ */
+int
+cr_lockstat_start ()
+{
+    return SUCCESS;
+}
+
+/**
+ * @brief Stops the summary thread. Lock profiling is not built in, so there
+ * is nothing to stop.
+ */
+void
+cr_lockstat_stop ()
+{
+}
+
+/**
+ * @brief Prints the lock summary. Lock profiling is not built in, so only a
+ * note saying so is printed.
+ *
+ * @param p_file stream to write to.
+ */
+void
+cr_lockstat_print (FILE * p_file)
+{
+    if (NULL == p_file)
+    {
+        CR_LOG_ERROR("cr_lockstat_print: input NULL");
+        return;
+    }
+
+    fprintf(p_file, "cr_lockstat: built without LOCK_PROFILE\n");
+}
+
+#endif //CR_LOCK_PROFILE
+
+//End of cr_lockstat.c file
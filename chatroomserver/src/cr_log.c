@@ -0,0 +1,427 @@
+#include "../include/cr_log.h"
+#include "../include/cr_shared.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+//Longest JSON line: every message byte escaped as \u00XX plus the fields.
+#define LOG_LINE_SIZE ((LOG_MESSAGE_SIZE * 6) + 128)
+
+typedef struct {
+    uint64_t time_ns; //CLOCK_REALTIME.
+    uint16_t length;
+    uint8_t  level;
+    uint8_t  reserved;
+    char     p_message[LOG_MESSAGE_SIZE];
+} cr_log_record_t;
+
+//NOTE: Single producer, single consumer. The owning thread is the only one to
+//move head and the drain thread the only one to move tail, so neither side
+//takes a lock. Rings are pushed onto p_rings_head with a compare and swap,
+//the same way as the flight recorder's.
+typedef struct cr_log_ring {
+    uint64_t             head;
+    uint64_t             tail;
+    uint64_t             dropped;
+    uint32_t             tid;
+    cr_log_record_t      p_records[LOG_RING_RECORDS];
+    struct cr_log_ring * p_next;
+} cr_log_ring_t;
+
+static const char * pp_level_names[] = {"debug", "info", "warn", "error"};
+
+static cr_log_ring_t * p_rings_head = NULL;
+static __thread cr_log_ring_t * p_local = NULL;
+
+static pthread_t log_thread;
+static volatile int running = STOP;
+static FILE * p_log_sink = NULL;
+#ifdef DEBUG
+static uint8_t min_level = LOG_LEVEL_DEBUG;
+#else
+static uint8_t min_level = LOG_LEVEL_INFO;
+#endif
+
+/**
+ * @brief Returns a clock in nanoseconds.
+ *
+ * @param clock_id clock to read.
+ * @return uint64_t current time.
+ */
+static uint64_t
+cr_log_now (clockid_t clock_id)
+{
+    struct timespec now;
+    clock_gettime(clock_id, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @brief Returns the calling thread's ring, creating it on first use.
+ *
+ * @return cr_log_ring_t* the ring or NULL if the drain thread is not running
+ * or the allocation failed.
+ */
+static cr_log_ring_t *
+cr_log_local ()
+{
+    if ((NULL != p_local) || (CONTINUE != running))
+    {
+        return p_local;
+    }
+
+    cr_log_ring_t * p_ring = calloc(1, sizeof(cr_log_ring_t));
+
+    if (NULL == p_ring)
+    {
+        return NULL;
+    }
+
+    p_ring->tid = syscall(SYS_gettid);
+    p_ring->p_next = __atomic_load_n(&p_rings_head, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(&p_rings_head, &p_ring->p_next,
+                       p_ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+
+    p_local = p_ring;
+
+    return p_local;
+}
+
+/**
+ * @brief Decides whether a call site may log now. Each site may log
+ * LOG_BURST messages per LOG_BURST_NS; the rest are counted.
+ *
+ * @param p_site call site.
+ * @param p_suppressed set to the messages suppressed since this site last
+ * logged.
+ * @return int SUCCESS (0) if the message may be logged, FAILURE (1) if not.
+ */
+static int
+cr_log_allow (cr_log_site_t * p_site, uint32_t * p_suppressed)
+{
+    uint64_t now = cr_log_now(CLOCK_MONOTONIC);
+    uint64_t window = __atomic_load_n(&p_site->window_ns, __ATOMIC_RELAXED);
+
+    //NOTE: Only the thread that moves the window resets the count, so a
+    //site logged from several threads can let a few extra through.
+    if ((LOG_BURST_NS <= (now - window)) &&
+        __atomic_compare_exchange_n(&p_site->window_ns, &window, now, 0,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(&p_site->count, 0, __ATOMIC_RELAXED);
+    }
+
+    if (LOG_BURST <= __atomic_fetch_add(&p_site->count, 1, __ATOMIC_RELAXED))
+    {
+        __atomic_fetch_add(&p_site->suppressed, 1, __ATOMIC_RELAXED);
+        return FAILURE;
+    }
+
+    *p_suppressed = __atomic_exchange_n(&p_site->suppressed, 0,
+                                        __ATOMIC_RELAXED);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Formats a record as one JSON line.
+ *
+ * @param p_record record to format.
+ * @param tid thread that logged it.
+ * @param p_line buffer of LOG_LINE_SIZE bytes.
+ * @return size_t length of the line, newline included.
+ */
+static size_t
+cr_log_format (cr_log_record_t * p_record, uint32_t tid, char * p_line)
+{
+    time_t seconds = (time_t) (p_record->time_ns / 1000000000ULL);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+
+    char p_time[32] = {0};
+    strftime(p_time, sizeof(p_time), "%Y-%m-%dT%H:%M:%S", &utc);
+
+    size_t length = snprintf(p_line, LOG_LINE_SIZE,
+                    "{\"ts\":\"%s.%06uZ\",\"level\":\"%s\",\"tid\":%u,"
+                    "\"msg\":\"", p_time,
+                    (unsigned) ((p_record->time_ns % 1000000000ULL) / 1000),
+                    pp_level_names[p_record->level & 3], tid);
+
+    for (uint16_t idx = 0; idx < p_record->length; idx++)
+    {
+        unsigned char byte = p_record->p_message[idx];
+
+        if (('"' == byte) || ('\\' == byte))
+        {
+            p_line[length++] = '\\';
+            p_line[length++] = byte;
+        }
+        else if (0x20 > byte)
+        {
+            length += snprintf((p_line + length), 7, "\\u%04x", byte);
+        }
+        else
+        {
+            p_line[length++] = byte;
+        }
+    }
+
+    memcpy((p_line + length), "\"}\n", 3);
+
+    return (length + 3);
+}
+
+/**
+ * @brief Writes one record to the sink.
+ *
+ * @param p_record record to write.
+ * @param tid thread that logged it.
+ */
+static void
+cr_log_emit (cr_log_record_t * p_record, uint32_t tid)
+{
+    char p_line[LOG_LINE_SIZE];
+    size_t length = cr_log_format(p_record, tid, p_line);
+    FILE * p_sink = (NULL != p_log_sink) ? p_log_sink : stderr;
+
+    //NOTE: One fwrite per line, so lines written synchronously by several
+    //threads do not interleave.
+    fwrite(p_line, 1, length, p_sink);
+}
+
+/**
+ * @brief Formats a message into the calling thread's ring for the drain
+ * thread to write. Never blocks: a full ring drops the message and counts
+ * it. Before cr_log_start and after cr_log_stop the message is written
+ * straight to the sink. Used through the CR_LOG_* macros.
+ *
+ * @param p_site call site, for rate limiting.
+ * @param level message level (LOG_LEVEL_DEBUG ...).
+ * @param error errno to append, 0 for none.
+ * @param p_format printf format.
+ */
+void
+cr_log_write (cr_log_site_t * p_site, uint8_t level, int error,
+              const char * p_format, ...)
+{
+    uint32_t suppressed = 0;
+
+    if ((NULL == p_site) || (NULL == p_format) || (min_level > level) ||
+        (SUCCESS != cr_log_allow(p_site, &suppressed)))
+    {
+        return;
+    }
+
+    cr_log_ring_t * p_ring = cr_log_local();
+    cr_log_record_t local_record;
+    cr_log_record_t * p_record = &local_record;
+    uint64_t head = 0;
+
+    if (NULL != p_ring)
+    {
+        head = p_ring->head;
+
+        if (LOG_RING_RECORDS <= (head - __atomic_load_n(&p_ring->tail,
+                                                        __ATOMIC_ACQUIRE)))
+        {
+            __atomic_fetch_add(&p_ring->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+
+        p_record = &p_ring->p_records[head & (LOG_RING_RECORDS - 1)];
+    }
+
+    va_list args;
+    va_start(args, p_format);
+    int length = vsnprintf(p_record->p_message, LOG_MESSAGE_SIZE, p_format,
+                                                                     args);
+    va_end(args);
+
+    if (0 > length)
+    {
+        length = 0;
+    }
+
+    if (LOG_MESSAGE_SIZE <= length)
+    {
+        length = LOG_MESSAGE_SIZE - 1;
+    }
+
+    if (0 != error)
+    {
+        length += snprintf((p_record->p_message + length),
+                           (LOG_MESSAGE_SIZE - length), ": %s",
+                           strerror(error));
+    }
+
+    if ((0 != suppressed) && (LOG_MESSAGE_SIZE > length))
+    {
+        length += snprintf((p_record->p_message + length),
+                           (LOG_MESSAGE_SIZE - length),
+                           " (%u similar suppressed)", suppressed);
+    }
+
+    if (LOG_MESSAGE_SIZE <= length)
+    {
+        length = LOG_MESSAGE_SIZE - 1;
+    }
+
+    p_record->time_ns = cr_log_now(CLOCK_REALTIME);
+    p_record->length = length;
+    p_record->level = level;
+
+    if (NULL == p_ring)
+    {
+        cr_log_emit(p_record, syscall(SYS_gettid));
+        return;
+    }
+
+    __atomic_store_n(&p_ring->head, (head + 1), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Writes every record buffered in every ring, and a warning for each
+ * ring that dropped messages since the last pass.
+ */
+static void
+cr_log_drain ()
+{
+    for (cr_log_ring_t * p_ring = __atomic_load_n(&p_rings_head,
+                                                  __ATOMIC_ACQUIRE);
+         NULL != p_ring; p_ring = p_ring->p_next)
+    {
+        uint64_t head = __atomic_load_n(&p_ring->head, __ATOMIC_ACQUIRE);
+        uint64_t tail = p_ring->tail;
+
+        for (; tail < head; tail++)
+        {
+            cr_log_emit(&p_ring->p_records[tail & (LOG_RING_RECORDS - 1)],
+                                                              p_ring->tid);
+        }
+
+        __atomic_store_n(&p_ring->tail, tail, __ATOMIC_RELEASE);
+
+        uint64_t dropped = __atomic_exchange_n(&p_ring->dropped, 0,
+                                               __ATOMIC_RELAXED);
+
+        if (0 != dropped)
+        {
+            cr_log_record_t record = {.time_ns = cr_log_now(CLOCK_REALTIME),
+                                      .level = LOG_LEVEL_WARN};
+            record.length = snprintf(record.p_message, LOG_MESSAGE_SIZE,
+                                     "cr_log: dropped %" PRIu64 " messages",
+                                     dropped);
+            cr_log_emit(&record, p_ring->tid);
+        }
+    }
+
+    fflush((NULL != p_log_sink) ? p_log_sink : stderr);
+}
+
+/**
+ * @brief Drain thread. Empties the rings every LOG_DRAIN_MS until stopped.
+ *
+ * @param p_arg unused, required by pthread_create.
+ * @return void* NULL.
+ */
+static void *
+cr_log_thread (void * p_arg)
+{
+    (void) p_arg;
+
+    struct timespec interval = {.tv_sec = 0,
+                                .tv_nsec = (LOG_DRAIN_MS * 1000000L)};
+
+    while (CONTINUE == running)
+    {
+        nanosleep(&interval, NULL);
+        cr_log_drain();
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the drain thread. Messages are written as JSON lines to
+ * p_sink.
+ *
+ * @param p_sink stream to write to, NULL for stderr.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_log_start (FILE * p_sink)
+{
+    if (CONTINUE == running)
+    {
+        return SUCCESS;
+    }
+
+    p_log_sink = p_sink;
+    running = CONTINUE;
+
+    if (SUCCESS != pthread_create(&log_thread, NULL, cr_log_thread, NULL))
+    {
+        running = STOP;
+        CR_LOG_ERRNO("cr_log_start: pthread_create:");
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Writes everything still buffered, stops the drain thread, and frees
+ * every thread's ring. Must be called after the threads logging have
+ * stopped.
+ */
+void
+cr_log_stop ()
+{
+    if (CONTINUE != running)
+    {
+        return;
+    }
+
+    running = STOP;
+
+    if (SUCCESS != pthread_join(log_thread, NULL))
+    {
+        CR_LOG_ERRNO("cr_log_stop: pthread_join:");
+    }
+
+    //NOTE: The drain thread may have slept through the last messages.
+    cr_log_drain();
+
+    cr_log_ring_t * p_ring = __atomic_exchange_n(&p_rings_head, NULL,
+                                                       __ATOMIC_ACQ_REL);
+
+    while (NULL != p_ring)
+    {
+        cr_log_ring_t * p_next = p_ring->p_next;
+        FREE(p_ring);
+        p_ring = p_next;
+    }
+
+    p_local = NULL;
+    p_log_sink = NULL;
+}
+
+/**
+ * @brief Sets the lowest level written. Messages below it are dropped at the
+ * call site.
+ *
+ * @param level lowest level (LOG_LEVEL_DEBUG ...).
+ */
+void
+cr_log_set_level (uint8_t level)
+{
+    min_level = (LOG_LEVEL_ERROR < level) ? LOG_LEVEL_ERROR : level;
+}
+
+//End of cr_log.c file
@@ -17,7 +17,7 @@ set_config_members (config_info_t * p_config_info, char * p_buffer,
 {
     if ((NULL == p_config_info) || (NULL == p_buffer) || (NULL == target_index))
     {
-        fprintf(stderr, "set_config_members: input NULL\n");
+        CR_LOG_ERROR("set_config_members: input NULL");
         return FAILURE;
     }
     
@@ -45,8 +45,8 @@ set_config_members (config_info_t * p_config_info, char * p_buffer,
 
             if (FAILURE == port_range_check(&value_holder))
             {
-                fprintf(stderr, "set_config_members: server listening port "
-                                         "value (out of range 1-65535).\n");
+                CR_LOG_ERROR("set_config_members: server listening port "
+                                         "value (out of range 1-65535).");
                 return FAILURE;
             }
 
@@ -60,8 +60,8 @@ set_config_members (config_info_t * p_config_info, char * p_buffer,
             if ((MIN_TOTAL_ROOMS > value_holder) ||
                 (MAX_TOTAL_ROOMS < value_holder))
             {
-                fprintf(stderr, "set_config_members: max rooms out of "
-                                                    "range (1-20).\n");
+                CR_LOG_ERROR("set_config_members: max rooms out of "
+                                                    "range (1-20).");
                 return FAILURE;
             }
 
@@ -75,19 +75,147 @@ set_config_members (config_info_t * p_config_info, char * p_buffer,
             if ((MIN_TOTAL_CLIENTS > value_holder) ||
                 (MAX_TOTAL_CLIENTS < value_holder))
             {
-                fprintf(stderr, "set_config_members: max clients out of "
-                                                      "range (2-50).\n");
+                CR_LOG_ERROR("set_config_members: max clients out of "
+                                                      "range (2-50).");
                 return FAILURE;
             }
 
             p_config_info->max_client = value_holder;
 
+            break;
+        case 4:
+            //max allowed: 1 second
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((0 > value_holder) || (MAX_FLUSH_WINDOW_MS < value_holder))
+            {
+                CR_LOG_ERROR("set_config_members: flush window out of "
+                                                  "range (0-1000 ms).");
+                return FAILURE;
+            }
+
+            p_config_info->flush_window_ms = value_holder;
+
+            break;
+        case 5:
+            //zlib levels: 0 (off) to 9
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((0 > value_holder) || (MAX_COMPRESS_LEVEL < value_holder))
+            {
+                CR_LOG_ERROR("set_config_members: compression level out "
+                                                     "of range (0-9).");
+                return FAILURE;
+            }
+
+            p_config_info->compress_level = value_holder;
+
+            break;
+        case 6:
+            //0 turns the metrics endpoint off
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((0 != value_holder) &&
+                (FAILURE == port_range_check(&value_holder)))
+            {
+                CR_LOG_ERROR("set_config_members: metrics port out of "
+                                               "range (0-65535).");
+                return FAILURE;
+            }
+
+            p_config_info->metrics_port = value_holder;
+
+            break;
+        case 7:
+            //0 starts one accept loop per online core
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((0 > value_holder) || (MAX_ACCEPTORS < value_holder))
+            {
+                CR_LOG_ERROR("set_config_members: acceptor threads out of "
+                                                         "range (0-64).");
+                return FAILURE;
+            }
+
+            p_config_info->acceptors = value_holder;
+
+            break;
+        case 8:
+            //0 leaves the acceptors and their sessions unpinned
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((0 != value_holder) && (1 != value_holder))
+            {
+                CR_LOG_ERROR("set_config_members: acceptor pinning out of "
+                                                         "range (0-1).");
+                return FAILURE;
+            }
+
+            p_config_info->pin_acceptors = value_holder;
+
+            break;
+        case 9:
+            //0 leaves rooms to the sessions, under room_mutex
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((0 > value_holder) || (MAX_ROOM_SHARDS < value_holder))
+            {
+                CR_LOG_ERROR("set_config_members: room workers out of "
+                                                      "range (0-32).");
+                return FAILURE;
+            }
+
+            p_config_info->room_shards = value_holder;
+
+            break;
+        case 10:
+            //0 leaves clustering off, otherwise an id from cluster.txt
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((CLUSTER_OFF > value_holder) ||
+                (CLUSTER_MAX_NODES < value_holder))
+            {
+                CR_LOG_ERROR("set_config_members: cluster node id out of "
+                                                          "range (0-16).");
+                return FAILURE;
+            }
+
+            p_config_info->cluster_node = value_holder;
+
+            break;
+        case 11:
+            //0 leaves hot restart off, 1 hands over to a new process
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((HANDOFF_OFF > value_holder) || (HANDOFF_ON < value_holder))
+            {
+                CR_LOG_ERROR("set_config_members: hot restart out of "
+                                                       "range (0-1).");
+                return FAILURE;
+            }
+
+            p_config_info->hot_restart = value_holder;
+
+            break;
+        case 12:
+            //0 removes the rooms on shutdown, 1 keeps them for the next run
+            value_holder = strtol(p_buffer, &p_string_holder, BASE10);
+
+            if ((PERSIST_OFF > value_holder) || (PERSIST_ON < value_holder))
+            {
+                CR_LOG_ERROR("set_config_members: persistent rooms out of "
+                                                            "range (0-1).");
+                return FAILURE;
+            }
+
+            p_config_info->persist_rooms = value_holder;
+
             break;
     }
 
     if (errno == ERANGE)
     {
-        perror("set_config_members: strtol conversion\n");
+        CR_LOG_ERRNO("set_config_members: strtol conversion");
         return FAILURE;
     }
 
@@ -106,7 +234,7 @@ config_file_open (config_info_t * p_config_info)
 {
     if ((NULL == p_config_info))
     {
-        fprintf(stderr, "config file open: input NULL\n");
+        CR_LOG_ERROR("config file open: input NULL");
         return FAILURE;
     }
     
@@ -116,33 +244,54 @@ config_file_open (config_info_t * p_config_info)
 
     if (NULL == file_pointer)
     {
-        perror("config_file_open: fopen");
+        CR_LOG_ERRNO("config_file_open: fopen");
         return FAILURE;
     }
 
-    //NOTE: Array is hard set due to fighter file requirements.
-    uint8_t target_lines[4] = {2, 5, 8, 11};
+    //NOTE: Array is hard set due to fighter file requirements. The last nine
+    //lines (flush window, compression level, metrics port, acceptor threads,
+    //acceptor pinning, room workers, cluster node id, hot restart, persistent
+    //rooms) are optional so older config files keep working.
+    uint8_t target_lines[13] = {2, 5, 8, 11, 14, 17, 20, 23, 26, 29, 32, 35,
+                                                                        38};
     int current_line = 1;
 
     char p_buffer[BUFF_SIZE];
 
-    //WARNING: The counter checks for all four target lines, altering target
-    //lines must be done in conjuction with altering input file standards.
-    for (uint8_t target_counter = 0; target_counter < 4 ; target_counter++)
+    p_config_info->flush_window_ms = DEFAULT_FLUSH_WINDOW_MS;
+    p_config_info->compress_level = DEFAULT_COMPRESS_LEVEL;
+    p_config_info->acceptors = DEFAULT_ACCEPTORS;
+    p_config_info->room_shards = DEFAULT_ROOM_SHARDS;
+
+    //WARNING: The counter checks for all thirteen target lines, altering
+    //target lines must be done in conjuction with altering input file
+    //standards.
+    for (uint8_t target_counter = 0; target_counter < 13 ; target_counter++)
     {
+        int line_missing = 0;
+
         while (current_line != (target_lines[target_counter] + 1))
         {
-            fgets(p_buffer, sizeof(p_buffer), file_pointer);
+            if (NULL == fgets(p_buffer, sizeof(p_buffer), file_pointer))
+            {
+                line_missing = 1;
+                break;
+            }
             current_line++;
         }
 
+        if (line_missing && (4 <= target_counter))
+        {
+            break;
+        }
+
         if (FAILURE == set_config_members(p_config_info, p_buffer,
                                                 &target_counter))
         {
-            fprintf(stderr, "config_file_open: set_config_members failure.\n");
+            CR_LOG_ERROR("config_file_open: set_config_members failure.");
             if (FAILURE_NEGATIVE == fclose(file_pointer))
             {
-                perror("config_file_open: fclose");
+                CR_LOG_ERRNO("config_file_open: fclose");
                 return FAILURE;
             }
             return FAILURE;
@@ -151,7 +300,7 @@ config_file_open (config_info_t * p_config_info)
 
     if (FAILURE_NEGATIVE == fclose(file_pointer))
     {
-        perror("config_file_open: fclose");
+        CR_LOG_ERRNO("config_file_open: fclose");
         return FAILURE;
     }
 
@@ -176,20 +325,20 @@ main ()
 
     if(NULL == p_config_info)
     {
-        fprintf(stderr, "main: p_config_info calloc\n");
+        CR_LOG_ERROR("main: p_config_info calloc");
         return FAILURE;
     }
 
     if (FAILURE == config_file_open(p_config_info))
     {
-        fprintf(stderr, "main: config_file_open()\n");
+        CR_LOG_ERROR("main: config_file_open()");
         FREE(p_config_info);
         return FAILURE;
     }
 
     if (FAILURE == cr_listener(p_config_info))
     {
-        fprintf(stderr, "main: cr_listener()\n");
+        CR_LOG_ERROR("main: cr_listener()");
         FREE(p_config_info);
         return FAILURE;
     }
@@ -0,0 +1,637 @@
+#include "../include/cr_metrics.h"
+
+//NOTE: Every thread records into its own metrics_thread_t, so recording is a
+//few plain adds with no lock or atomic read-modify-write. The scrape thread
+//sums the blocks; each value has a single writer, relaxed loads and stores
+//keep the reads whole. Blocks are linked into a list under metrics_mutex the
+//first time a thread records and freed by cr_metrics_stop.
+typedef struct metrics_thread {
+    uint64_t                p_requests[METRIC_KEYS];
+    uint64_t                p_latency_sum[METRIC_KEYS];
+    uint64_t                pp_latency[METRIC_KEYS][METRIC_BUCKETS];
+    uint64_t                handshakes;
+    uint64_t                handshake_sum;
+    uint64_t                p_handshake[METRIC_BUCKETS];
+    uint64_t                p_counters[METRIC_COUNTERS];
+    struct metrics_thread * p_next;
+} metrics_thread_t;
+
+static const char * pp_type_names[METRIC_TYPES] = {
+    "rooms", "account", "chat", "session"
+};
+
+static const char * pp_stype_names[METRIC_STYPES] = {
+    "join", "list", "create", "register", "login", "admin", "chat", "fail",
+    "delete", "admin_remove", "leave", "logout", "quit", "version",
+    "compress", "stats"
+};
+
+static const char * pp_gauge_names[METRIC_GAUGES] = {
+    "cr_sessions", "cr_sessions_waiting", "cr_flush_pending_sessions"
+};
+
+static pthread_mutex_t metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+static metrics_thread_t * p_threads_head = NULL;
+static __thread metrics_thread_t * p_local = NULL;
+static int64_t p_gauges[METRIC_GAUGES] = {0};
+
+static pthread_t metrics_thread;
+static volatile int running = STOP;
+static int listen_fd = -1;
+static users_t * p_metrics_users = NULL;
+static rooms_t * p_metrics_rooms = NULL;
+static t_pool_t * p_metrics_t_pool = NULL;
+
+/**
+ * @brief Adds to a value only the calling thread writes.
+ *
+ * @param p_value pointer to the value.
+ * @param amount amount to add.
+ */
+static inline void
+cr_metrics_add (uint64_t * p_value, uint64_t amount)
+{
+    __atomic_store_n(p_value, (__atomic_load_n(p_value, __ATOMIC_RELAXED) +
+                                              amount), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Returns the calling thread's block, creating it on first use.
+ *
+ * @return metrics_thread_t* the block or NULL if metrics are off or the
+ * allocation failed.
+ */
+static inline metrics_thread_t *
+cr_metrics_local ()
+{
+    if ((NULL != p_local) || (CONTINUE != running))
+    {
+        return p_local;
+    }
+
+    metrics_thread_t * p_block = calloc(1, sizeof(metrics_thread_t));
+
+    if (NULL == p_block)
+    {
+        CR_LOG_ERRNO("cr_metrics_local: p_block calloc");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&metrics_mutex);
+    p_block->p_next = p_threads_head;
+    p_threads_head = p_block;
+    pthread_mutex_unlock(&metrics_mutex);
+
+    p_local = p_block;
+
+    return p_local;
+}
+
+/**
+ * @brief Returns the latency bucket of a duration.
+ *
+ * @param elapsed_ns duration in nanoseconds.
+ * @return int bucket index.
+ */
+static inline int
+cr_metrics_bucket (uint64_t elapsed_ns)
+{
+    if ((1ULL << METRIC_MIN_SHIFT) > elapsed_ns)
+    {
+        return 0;
+    }
+
+    int msb = 63 - __builtin_clzll(elapsed_ns);
+    int bucket = 1 + ((msb - METRIC_MIN_SHIFT) * 2) +
+                 ((elapsed_ns >> (msb - 1)) & 1);
+
+    return (METRIC_BUCKETS > bucket) ? bucket : (METRIC_BUCKETS - 1);
+}
+
+/**
+ * @brief Returns the upper bound of a latency bucket.
+ *
+ * @param bucket bucket index, below METRIC_BUCKETS - 1.
+ * @return double upper bound in seconds.
+ */
+static double
+cr_metrics_bucket_bound (int bucket)
+{
+    if (0 == bucket)
+    {
+        return (1ULL << METRIC_MIN_SHIFT) / 1e9;
+    }
+
+    int msb = METRIC_MIN_SHIFT + ((bucket - 1) / 2);
+    uint64_t bound = (uint64_t) (3 + ((bucket - 1) % 2)) << (msb - 1);
+
+    return bound / 1e9;
+}
+
+/**
+ * @brief Returns CLOCK_MONOTONIC in nanoseconds, for timing what is
+ * recorded.
+ *
+ * @return uint64_t current time.
+ */
+uint64_t
+cr_metrics_now ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * @brief Records a handled request and how long it took.
+ *
+ * @param type packet type of the request.
+ * @param s_type packet sub type of the request.
+ * @param elapsed_ns time from dispatch to response in nanoseconds.
+ */
+void
+cr_metrics_request (uint8_t type, uint8_t s_type, uint64_t elapsed_ns)
+{
+    metrics_thread_t * p_block = cr_metrics_local();
+
+    if (NULL == p_block)
+    {
+        return;
+    }
+
+    int key = METRIC_KEYS - 1;
+
+    if ((METRIC_TYPES > type) && (METRIC_STYPES > s_type))
+    {
+        key = (type * METRIC_STYPES) + s_type;
+    }
+
+    cr_metrics_add(&p_block->p_requests[key], 1);
+    cr_metrics_add(&p_block->p_latency_sum[key], elapsed_ns);
+    cr_metrics_add(&p_block->pp_latency[key][cr_metrics_bucket(elapsed_ns)],
+                                                                         1);
+}
+
+/**
+ * @brief Records a completed TLS handshake.
+ *
+ * @param elapsed_ns time from accept to the end of the handshake.
+ * @param failures handshakes that failed before this one.
+ */
+void
+cr_metrics_handshake (uint64_t elapsed_ns, uint32_t failures)
+{
+    metrics_thread_t * p_block = cr_metrics_local();
+
+    if (NULL == p_block)
+    {
+        return;
+    }
+
+    cr_metrics_add(&p_block->handshakes, 1);
+    cr_metrics_add(&p_block->handshake_sum, elapsed_ns);
+    cr_metrics_add(&p_block->p_handshake[cr_metrics_bucket(elapsed_ns)], 1);
+    cr_metrics_add(&p_block->p_counters[METRIC_HANDSHAKE_FAILED], failures);
+}
+
+/**
+ * @brief Adds one to a counter.
+ *
+ * @param counter counter to add to (METRIC_FRAME_INVALID ...).
+ */
+void
+cr_metrics_count (int counter)
+{
+    metrics_thread_t * p_block = cr_metrics_local();
+
+    if ((NULL == p_block) || (0 > counter) || (METRIC_COUNTERS <= counter))
+    {
+        return;
+    }
+
+    cr_metrics_add(&p_block->p_counters[counter], 1);
+}
+
+/**
+ * @brief Moves a gauge up or down.
+ *
+ * @param gauge gauge to change (METRIC_SESSIONS ...).
+ * @param delta amount to add, negative to subtract.
+ */
+void
+cr_metrics_gauge_add (int gauge, int64_t delta)
+{
+    //NOTE: Gauges are kept while metrics are off so they are right from the
+    //first scrape. They change per session or per flush, not per packet.
+    if ((0 > gauge) || (METRIC_GAUGES <= gauge))
+    {
+        return;
+    }
+
+    __atomic_add_fetch(&p_gauges[gauge], delta, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Returns a gauge's value.
+ *
+ * @param gauge gauge to read (METRIC_SESSIONS ...).
+ * @return int64_t current value, 0 for an unknown gauge.
+ */
+int64_t
+cr_metrics_gauge (int gauge)
+{
+    if ((0 > gauge) || (METRIC_GAUGES <= gauge))
+    {
+        return 0;
+    }
+
+    return __atomic_load_n(&p_gauges[gauge], __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Writes one latency histogram in the Prometheus text format.
+ *
+ * @param p_file stream to write to.
+ * @param p_name metric name.
+ * @param p_labels labels without braces, may be empty.
+ * @param p_buckets bucket counts (METRIC_BUCKETS).
+ * @param count number of observations.
+ * @param sum_ns sum of the observations in nanoseconds.
+ */
+static void
+cr_metrics_render_histogram (FILE * p_file, const char * p_name,
+                             const char * p_labels, uint64_t * p_buckets,
+                             uint64_t count, uint64_t sum_ns)
+{
+    int labelled = ('\0' != p_labels[0]);
+    uint64_t cumulative = 0;
+
+    for (int bucket = 0; bucket < (METRIC_BUCKETS - 1); bucket++)
+    {
+        cumulative += p_buckets[bucket];
+        fprintf(p_file, "%s_bucket{%s%sle=\"%g\"} %" PRIu64 "\n", p_name,
+                p_labels, labelled ? "," : "",
+                cr_metrics_bucket_bound(bucket), cumulative);
+    }
+
+    fprintf(p_file, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n", p_name,
+            p_labels, labelled ? "," : "", count);
+    fprintf(p_file, "%s_sum%s%s%s %.9f\n", p_name, labelled ? "{" : "",
+            p_labels, labelled ? "}" : "", sum_ns / 1e9);
+    fprintf(p_file, "%s_count%s%s%s %" PRIu64 "\n", p_name,
+            labelled ? "{" : "", p_labels, labelled ? "}" : "", count);
+}
+
+/**
+ * @brief Writes every metric in the Prometheus text format.
+ *
+ * @param p_file stream to write to.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_metrics_render (FILE * p_file)
+{
+    if (NULL == p_file)
+    {
+        CR_LOG_ERROR("cr_metrics_render: input NULL");
+        return FAILURE;
+    }
+
+    metrics_thread_t * p_total = calloc(1, sizeof(metrics_thread_t));
+
+    if (NULL == p_total)
+    {
+        CR_LOG_ERRNO("cr_metrics_render: p_total calloc");
+        return FAILURE;
+    }
+
+    uint64_t * p_from = NULL;
+    uint64_t * p_to = (uint64_t *) p_total;
+    size_t values = offsetof(metrics_thread_t, p_next) / sizeof(uint64_t);
+
+    pthread_mutex_lock(&metrics_mutex);
+
+    for (metrics_thread_t * p_block = p_threads_head; NULL != p_block;
+                                          p_block = p_block->p_next)
+    {
+        p_from = (uint64_t *) p_block;
+
+        for (size_t index = 0; index < values; index++)
+        {
+            p_to[index] += __atomic_load_n(&p_from[index], __ATOMIC_RELAXED);
+        }
+    }
+
+    pthread_mutex_unlock(&metrics_mutex);
+
+    fprintf(p_file, "# HELP cr_requests_total Requests handled, by packet "
+                    "type and sub type.\n# TYPE cr_requests_total counter\n");
+
+    for (int key = 0; key < METRIC_KEYS; key++)
+    {
+        if (0 == p_total->p_requests[key])
+        {
+            continue;
+        }
+
+        const char * p_type = (METRIC_KEYS - 1 == key) ? "other" :
+                              pp_type_names[key / METRIC_STYPES];
+        const char * p_s_type = (METRIC_KEYS - 1 == key) ? "other" :
+                                pp_stype_names[key % METRIC_STYPES];
+
+        fprintf(p_file, "cr_requests_total{type=\"%s\",s_type=\"%s\"} %"
+                PRIu64 "\n", p_type, p_s_type, p_total->p_requests[key]);
+    }
+
+    fprintf(p_file, "# HELP cr_request_duration_seconds Time from dispatch "
+                    "to response.\n"
+                    "# TYPE cr_request_duration_seconds histogram\n");
+
+    for (int key = 0; key < METRIC_KEYS; key++)
+    {
+        if (0 == p_total->p_requests[key])
+        {
+            continue;
+        }
+
+        char p_labels[64] = {0};
+        snprintf(p_labels, sizeof(p_labels), "type=\"%s\",s_type=\"%s\"",
+                 (METRIC_KEYS - 1 == key) ? "other" :
+                 pp_type_names[key / METRIC_STYPES],
+                 (METRIC_KEYS - 1 == key) ? "other" :
+                 pp_stype_names[key % METRIC_STYPES]);
+        cr_metrics_render_histogram(p_file, "cr_request_duration_seconds",
+                                    p_labels, p_total->pp_latency[key],
+                                    p_total->p_requests[key],
+                                    p_total->p_latency_sum[key]);
+    }
+
+    fprintf(p_file, "# HELP cr_tls_handshake_duration_seconds Time from "
+                    "accept to the end of the TLS handshake.\n"
+                    "# TYPE cr_tls_handshake_duration_seconds histogram\n");
+    cr_metrics_render_histogram(p_file, "cr_tls_handshake_duration_seconds",
+                                "", p_total->p_handshake,
+                                p_total->handshakes, p_total->handshake_sum);
+
+    fprintf(p_file, "# TYPE cr_tls_handshake_failures_total counter\n"
+            "cr_tls_handshake_failures_total %" PRIu64 "\n"
+            "# HELP cr_frame_errors_total Requests that could not be "
+            "decoded.\n# TYPE cr_frame_errors_total counter\n"
+            "cr_frame_errors_total{reason=\"invalid\"} %" PRIu64 "\n"
+            "cr_frame_errors_total{reason=\"corrupt\"} %" PRIu64 "\n",
+            p_total->p_counters[METRIC_HANDSHAKE_FAILED],
+            p_total->p_counters[METRIC_FRAME_INVALID],
+            p_total->p_counters[METRIC_FRAME_CORRUPT]);
+
+    uint64_t messages = 0;
+    uint64_t records = 0;
+    cr_msg_write_stats(&messages, &records);
+
+    fprintf(p_file, "# HELP cr_messages_sent_total Packets sent to clients."
+                    "\n# TYPE cr_messages_sent_total counter\n"
+                    "cr_messages_sent_total %" PRIu64 "\n"
+                    "# HELP cr_tls_records_written_total TLS writes used to "
+                    "send them.\n# TYPE cr_tls_records_written_total counter"
+                    "\ncr_tls_records_written_total %" PRIu64 "\n",
+                    messages, records);
+
+    for (int gauge = 0; gauge < METRIC_GAUGES; gauge++)
+    {
+        fprintf(p_file, "# TYPE %s gauge\n%s %" PRId64 "\n",
+                pp_gauge_names[gauge], pp_gauge_names[gauge],
+                __atomic_load_n(&p_gauges[gauge], __ATOMIC_RELAXED));
+    }
+
+    //NOTE: The counts are single bytes, read without the table locks.
+    if (NULL != p_metrics_users)
+    {
+        fprintf(p_file, "# TYPE cr_users_logged_in gauge\n"
+                "cr_users_logged_in %d\n# TYPE cr_users_registered gauge\n"
+                "cr_users_registered %d\n",
+                __atomic_load_n(&p_metrics_users->client_count,
+                                               __ATOMIC_RELAXED),
+                __atomic_load_n(&p_metrics_users->user_count,
+                                             __ATOMIC_RELAXED));
+    }
+
+    if (NULL != p_metrics_rooms)
+    {
+        fprintf(p_file, "# TYPE cr_rooms gauge\ncr_rooms %d\n",
+                __atomic_load_n(&p_metrics_rooms->room_count,
+                                            __ATOMIC_RELAXED));
+    }
+
+    if (NULL != p_metrics_t_pool)
+    {
+        pthread_mutex_lock(&p_metrics_t_pool->queue_access_mutex);
+        int depth = queue_intrusive_size(&p_metrics_t_pool->task_queue);
+        pthread_mutex_unlock(&p_metrics_t_pool->queue_access_mutex);
+
+        fprintf(p_file, "# TYPE cr_task_queue_depth gauge\n"
+                        "cr_task_queue_depth %d\n", depth);
+    }
+
+    FREE(p_total);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Answers one metrics client and closes the connection.
+ *
+ * @param client_fd connected socket.
+ */
+static void
+cr_metrics_serve (int client_fd)
+{
+    char p_request[METRIC_REQUEST_SIZE + 1] = {0};
+    struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if (0 >= recv(client_fd, p_request, METRIC_REQUEST_SIZE, 0))
+    {
+        close(client_fd);
+        return;
+    }
+
+    char * p_body = NULL;
+    size_t body_len = 0;
+    FILE * p_file = open_memstream(&p_body, &body_len);
+    const char * p_status = "404 Not Found";
+
+    if (NULL == p_file)
+    {
+        CR_LOG_ERRNO("cr_metrics_serve: open_memstream");
+        close(client_fd);
+        return;
+    }
+
+    if ((0 == strncmp(p_request, "GET /metrics ", 13)) ||
+        (0 == strncmp(p_request, "GET / ", 6)))
+    {
+        p_status = "200 OK";
+        cr_metrics_render(p_file);
+    }
+
+    fclose(p_file);
+
+    char p_header[BUFF_SIZE] = {0};
+    int header_len = snprintf(p_header, sizeof(p_header),
+                    "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4"
+                    "\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                    p_status, body_len);
+
+    if ((FAILURE_NEGATIVE != send_n(client_fd, p_header, header_len,
+                                                MSG_NOSIGNAL)) &&
+        (0 != body_len))
+    {
+        send_n(client_fd, p_body, body_len, MSG_NOSIGNAL);
+    }
+
+    FREE(p_body);
+    close(client_fd);
+}
+
+/**
+ * @brief Metrics thread. Accepts one client at a time until stopped.
+ *
+ * @param p_arg unused, required by pthread_create.
+ * @return void* NULL.
+ */
+static void *
+cr_metrics_thread (void * p_arg)
+{
+    (void) p_arg;
+
+    struct pollfd listen_poll = {.fd = listen_fd, .events = POLLIN};
+
+    while (CONTINUE == running)
+    {
+        //NOTE: The timeout lets the thread see the stop flag.
+        if (0 >= poll(&listen_poll, 1, 500))
+        {
+            continue;
+        }
+
+        int client_fd = accept(listen_fd, NULL, NULL);
+
+        if (0 > client_fd)
+        {
+            continue;
+        }
+
+        cr_metrics_serve(client_fd);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the metrics endpoint: a plain HTTP server on 127.0.0.1 that
+ * answers GET /metrics in the Prometheus text format. Recording is off until
+ * the endpoint is started.
+ *
+ * @param port port to listen on. Zero leaves metrics off.
+ * @param p_users pointer to users_t struct, read for the user gauges.
+ * @param p_rooms pointer to rooms_t struct, read for the room gauge.
+ * @param p_t_pool pointer to the thread pool, read for the task queue gauge.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_metrics_start (uint16_t port, users_t * p_users, rooms_t * p_rooms,
+                                                  t_pool_t * p_t_pool)
+{
+    if ((0 == port) || (CONTINUE == running))
+    {
+        return SUCCESS;
+    }
+
+    //NOTE: Metrics are not encrypted or authenticated, so the endpoint only
+    //listens on loopback.
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    int reuse = 1;
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (0 > listen_fd)
+    {
+        CR_LOG_ERRNO("cr_metrics_start: socket:");
+        return FAILURE;
+    }
+
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if ((SUCCESS != bind(listen_fd, (struct sockaddr *) &address,
+                                               sizeof(address))) ||
+        (SUCCESS != listen(listen_fd, BACKLOG)))
+    {
+        CR_LOG_ERRNO("cr_metrics_start: bind/listen:");
+        close(listen_fd);
+        listen_fd = -1;
+        return FAILURE;
+    }
+
+    p_metrics_users = p_users;
+    p_metrics_rooms = p_rooms;
+    p_metrics_t_pool = p_t_pool;
+    running = CONTINUE;
+
+    if (SUCCESS != pthread_create(&metrics_thread, NULL, cr_metrics_thread,
+                                                                     NULL))
+    {
+        CR_LOG_ERRNO("cr_metrics_start: pthread_create:");
+        running = STOP;
+        close(listen_fd);
+        listen_fd = -1;
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Stops the metrics endpoint and frees every thread's counters. Must
+ * be called after the threads recording metrics have stopped.
+ */
+void
+cr_metrics_stop ()
+{
+    if (CONTINUE != running)
+    {
+        return;
+    }
+
+    running = STOP;
+
+    if (SUCCESS != pthread_join(metrics_thread, NULL))
+    {
+        CR_LOG_ERRNO("cr_metrics_stop: pthread_join:");
+    }
+
+    close(listen_fd);
+    listen_fd = -1;
+
+    pthread_mutex_lock(&metrics_mutex);
+
+    while (NULL != p_threads_head)
+    {
+        metrics_thread_t * p_block = p_threads_head;
+        p_threads_head = p_block->p_next;
+        FREE(p_block);
+    }
+
+    pthread_mutex_unlock(&metrics_mutex);
+
+    p_local = NULL;
+    p_metrics_users = NULL;
+    p_metrics_rooms = NULL;
+    p_metrics_t_pool = NULL;
+}
+
+//End of cr_metrics.c file
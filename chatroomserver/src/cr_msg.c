@@ -1,92 +1,395 @@
 #include "../include/cr_msg.h"
+#include "../include/cr_frame.h"
+#include "../include/cr_flush.h"
+#include "../include/cr_stats.h"
+
+//NOTE: Write counters. messages_written counts packets handed to
+//cr_msg_write and records_written counts SSL_write calls, so their ratio
+//shows how well writes are being coalesced.
+static uint64_t messages_written = 0;
+static uint64_t records_written = 0;
+
+/**
+ * @brief Writes the session's send buffer to the client.
+ * 
+ * WARNING: Calling function must lock the session's send mutex before use
+ * and unlock after use.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_session pointer to the connection's session_t struct.
+ * @return int SUCCESS (0) or CONNECTION_FAILURE (2).
+ */
+static int
+cr_msg_flush_helper (SSL * p_ssl, session_t * p_session)
+{
+    if (0 == p_session->send_len)
+    {
+        return SUCCESS;
+    }
+
+    cr_trace_record(TRACE_SSL_WRITE_BEGIN, 0, p_session->send_len);
+    int sent_bytes = SSL_write(p_ssl, p_session->p_send_buffer,
+                                          p_session->send_len);
+    cr_trace_record(TRACE_SSL_WRITE_END, 0,
+                    (0 < sent_bytes) ? sent_bytes : 0);
+
+    p_session->send_len = 0;
+    __atomic_add_fetch(&records_written, 1, __ATOMIC_RELAXED);
+
+    if (0 >= sent_bytes)
+    {
+        CR_LOG_ERRNO("cr_msg_flush_helper: SSL_write():");
+        return CONNECTION_FAILURE;
+    }
+
+    cr_stats_bytes(0, sent_bytes);
+
+    return SUCCESS;
+}
 
 /**
- * @brief Creates a rejection packet.
+ * @brief Writes a v1 packet to the client, converting it to a v2 frame first
+ * if the connection negotiated v2. While the connection is batching, the
+ * packet is added to the send buffer instead and goes out with the next
+ * flush.
  * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_packet v1 packet.
+ * @param packet_len length of the packet.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+static int
+cr_msg_write (SSL * p_ssl, const void * p_packet, size_t packet_len)
+{
+    if ((NULL == p_ssl) || (NULL == p_packet))
+    {
+        CR_LOG_ERROR("cr_msg_write: input NULL");
+        return FAILURE;
+    }
+
+    session_t * p_session = SSL_get_app_data(p_ssl);
+    char p_frame[MAX_FRAME_LENGTH + MAX_VARINT_LENGTH] = {0};
+
+    __atomic_add_fetch(&messages_written, 1, __ATOMIC_RELAXED);
+
+    if (NULL == p_session)
+    {
+        __atomic_add_fetch(&records_written, 1, __ATOMIC_RELAXED);
+
+        cr_trace_record(TRACE_SSL_WRITE_BEGIN, 0, packet_len);
+        int sent_bytes = SSL_write(p_ssl, p_packet, packet_len);
+        cr_trace_record(TRACE_SSL_WRITE_END, 0,
+                        (0 < sent_bytes) ? sent_bytes : 0);
+
+        if (0 >= sent_bytes)
+        {
+            CR_LOG_ERRNO("cr_msg_write: SSL_write():");
+            return CONNECTION_FAILURE;
+        }
+
+        cr_stats_bytes(0, sent_bytes);
+
+        return SUCCESS;
+    }
+
+    if (PROTOCOL_V2 == p_session->version)
+    {
+        int frame_len = cr_frame_encode(p_packet, packet_len, p_frame,
+                               sizeof(p_frame), p_session->compression);
+
+        if (FAILURE_NEGATIVE == frame_len)
+        {
+            CR_LOG_ERROR("cr_msg_write: cr_frame_encode()");
+            return FAILURE;
+        }
+
+        p_packet = p_frame;
+        packet_len = frame_len;
+    }
+
+    if (SUCCESS != CR_MUTEX_LOCK(&p_session->send_mutex))
+    {
+        CR_LOG_ERRNO("cr_msg_write: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    int return_val = SUCCESS;
+    int schedule = 0;
+
+    //NOTE: A full buffer is written out early rather than dropping packets.
+    if ((p_session->send_len + packet_len) > SEND_BUFF_SIZE)
+    {
+        return_val = cr_msg_flush_helper(p_ssl, p_session);
+    }
+
+    if (SUCCESS == return_val)
+    {
+        memcpy((p_session->p_send_buffer + p_session->send_len), p_packet,
+                                                              packet_len);
+        p_session->send_len += packet_len;
+
+        //NOTE: Outside of a batch the packet either goes out now or, with a
+        //flush window, waits for the flusher so packets written to this
+        //connection by other sessions in the window share one record. Only
+        //the first packet in the buffer needs to queue the session.
+        if ((!p_session->batching) && (0 == cr_flush_window()))
+        {
+            return_val = cr_msg_flush_helper(p_ssl, p_session);
+        }
+        else if (!p_session->batching)
+        {
+            schedule = (p_session->send_len == packet_len);
+        }
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(&p_session->send_mutex))
+    {
+        CR_LOG_ERRNO("cr_msg_write: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    if (schedule && (SUCCESS != cr_flush_schedule(p_session)))
+    {
+        CR_LOG_ERROR("cr_msg_write: cr_flush_schedule()");
+        return FAILURE;
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Checks whether the client is an older one that never sent a version
+ * request. These read chat updates and join acknowledges in the layout they
+ * had before rooms numbered their chats.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @return int 1 if the connection is a legacy one, otherwise 0.
+ */
+static int
+cr_msg_legacy (SSL * p_ssl)
+{
+    session_t * p_session = SSL_get_app_data(p_ssl);
+
+    return ((NULL != p_session) && (PROTOCOL_LEGACY == p_session->version));
+}
+
+/**
+ * @brief Starts batching writes to the client. Packets sent to the
+ * connection are gathered until cr_msg_flush is called.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_msg_batch (SSL * p_ssl)
+{
+    session_t * p_session = SSL_get_app_data(p_ssl);
+
+    if (NULL == p_session)
+    {
+        CR_LOG_ERROR("cr_msg_batch: no session");
+        return FAILURE;
+    }
+
+    if (SUCCESS != CR_MUTEX_LOCK(&p_session->send_mutex))
+    {
+        CR_LOG_ERRNO("cr_msg_batch: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    p_session->batching = 1;
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(&p_session->send_mutex))
+    {
+        CR_LOG_ERRNO("cr_msg_batch: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Stops batching and writes everything gathered since cr_msg_batch
+ * to the client in a single write.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_flush (SSL * p_ssl)
+{
+    session_t * p_session = SSL_get_app_data(p_ssl);
+
+    if (NULL == p_session)
+    {
+        CR_LOG_ERROR("cr_msg_flush: no session");
+        return FAILURE;
+    }
+
+    if (SUCCESS != CR_MUTEX_LOCK(&p_session->send_mutex))
+    {
+        CR_LOG_ERRNO("cr_msg_flush: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    p_session->batching = 0;
+    int return_val = cr_msg_flush_helper(p_ssl, p_session);
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(&p_session->send_mutex))
+    {
+        CR_LOG_ERRNO("cr_msg_flush: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Writes packets waiting in the session's send buffer unless the
+ * session's own thread is batching, in which case its flush sends them.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_flush_pending (SSL * p_ssl)
+{
+    session_t * p_session = SSL_get_app_data(p_ssl);
+
+    if (NULL == p_session)
+    {
+        CR_LOG_ERROR("cr_msg_flush_pending: no session");
+        return FAILURE;
+    }
+
+    if (SUCCESS != CR_MUTEX_LOCK(&p_session->send_mutex))
+    {
+        CR_LOG_ERRNO("cr_msg_flush_pending: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    int return_val = SUCCESS;
+
+    if (!p_session->batching)
+    {
+        return_val = cr_msg_flush_helper(p_ssl, p_session);
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(&p_session->send_mutex))
+    {
+        CR_LOG_ERRNO("cr_msg_flush_pending: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Reads the write counters: packets sent to clients and the TLS
+ * records (SSL_write calls) used to send them.
+ * 
+ * @param p_messages set to the number of packets written.
+ * @param p_records set to the number of records written.
+ */
+void
+cr_msg_write_stats (uint64_t * p_messages, uint64_t * p_records)
+{
+    if ((NULL == p_messages) || (NULL == p_records))
+    {
+        CR_LOG_ERROR("cr_msg_write_stats: input NULL");
+        return;
+    }
+
+    *p_messages = __atomic_load_n(&messages_written, __ATOMIC_RELAXED);
+    *p_records = __atomic_load_n(&records_written, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Fills in a rejection packet.
+ * 
+ * @param p_rejection pointer to the packet, usually on the caller's stack.
  * @param type packet type.
  * @param sub_type packet sub type.
  * @param rej_code rejection code.
- * @return rejection_t* returns a pointer to the packet.
+ * @return int SUCCESS (0) or FAILURE (1).
  */
-rejection_t *
-cr_msg_create_rej (uint8_t type, uint8_t sub_type, uint8_t rej_code)
+int
+cr_msg_create_rej (rejection_t * p_rejection, uint8_t type,
+                         uint8_t sub_type, uint8_t rej_code)
 {
-    rejection_t * p_rejection = calloc(1, sizeof(rejection_t));
-
     if (NULL == p_rejection)
     {
-        perror("cr_msg_create_rej: calloc");
-        return NULL;
+        CR_LOG_ERROR("cr_msg_create_rej: input NULL");
+        return FAILURE;
     }
 
+    memset(p_rejection, 0, sizeof(rejection_t));
     p_rejection->type = type;
     p_rejection->s_type = sub_type;
     p_rejection->opcode = REJECT;
     p_rejection->r_code = rej_code;
 
-    return p_rejection;
+    return SUCCESS;
 }
 
 /**
- * @brief Creates an acknowledge packet.
+ * @brief Fills in an acknowledge packet.
  * 
+ * @param p_acknowledge pointer to the packet, usually on the caller's stack.
  * @param type packet type.
  * @param sub_type packet sub type.
- * @return acknowledge_t* returns a pointer to the packet.
+ * @return int SUCCESS (0) or FAILURE (1).
  */
-acknowledge_t *
-cr_msg_create_ack (uint8_t type, uint8_t sub_type)
+int
+cr_msg_create_ack (acknowledge_t * p_acknowledge, uint8_t type,
+                                                 uint8_t sub_type)
 {
-    acknowledge_t * p_acknowledge = calloc(1, sizeof(acknowledge_t));
-
     if (NULL == p_acknowledge)
     {
-        perror("cr_msg_create_reg_ack: calloc");
-        return NULL;
+        CR_LOG_ERROR("cr_msg_create_ack: input NULL");
+        return FAILURE;
     }
 
+    memset(p_acknowledge, 0, sizeof(acknowledge_t));
     p_acknowledge->type = type;
     p_acknowledge->s_type = sub_type;
     p_acknowledge->opcode = ACKNOWLEDGE;
 
-    return p_acknowledge;
+    return SUCCESS;
 }
 
 /**
- * @brief Creates a chat update packet.
+ * @brief Fills in a chat update packet.
  * 
- * @param p_username username of the chat sender.
+ * @param p_chat_ack pointer to the packet, usually on the caller's stack.
+ * @param p_sender interned username of the chat sender.
  * @param p_chat chat the will be sent to the client.
- * @return chat_t* returns a pointer to the packet. Returns NULL on
- * failure.
+ * @param seq room sequence number of the chat (0 for room notices).
+ * @return int SUCCESS (0) or FAILURE (1).
  */
-chat_t *
-cr_msg_create_update (char * p_username, char * p_chat)
+int
+cr_msg_create_update (chat_update_t * p_chat_ack, const cr_name_t * p_sender,
+                                           char * p_chat, uint64_t seq)
 {
-    if ((NULL == p_username) || (NULL == p_chat))
+    if ((NULL == p_chat_ack) || (NULL == p_sender) || (NULL == p_chat))
     {
-        fprintf(stderr, "cr_msg_create_update: input NULL\n");
-        return NULL;
-    }
-
-    chat_t * p_chat_ack = calloc(1, sizeof(chat_t));
-
-    if (NULL == p_chat_ack)
-    {
-        perror("cr_msg_create_reg_ack: calloc");
-        return NULL;
+        CR_LOG_ERROR("cr_msg_create_update: input NULL");
+        return FAILURE;
     }
 
+    memset(p_chat_ack, 0, sizeof(chat_update_t));
     p_chat_ack->type = CHAT_TYPE;
     p_chat_ack->s_type = CHAT_STYPE;
     p_chat_ack->opcode = ACKNOWLEDGE;
+    p_chat_ack->seq = htobe64(seq);
     char * p_carrot = ">";
-    strncpy(p_chat_ack->p_chat, p_username, MAX_USERNAME_LENGTH);
+    //NOTE: The name's length is known, so it is copied without scanning it.
+    memcpy(p_chat_ack->p_chat, p_sender->p_bytes, p_sender->length);
     strncpy((p_chat_ack->p_chat + MAX_USERNAME_LENGTH), p_carrot, 1);
     strncpy((p_chat_ack->p_chat + MAX_USERNAME_LENGTH + 1), p_chat,
                                                      MAX_CHAT_LEN);
 
-    return p_chat_ack;
+    return SUCCESS;
 }
 
 /**
@@ -102,27 +405,24 @@ int
 cr_msg_send_rej (SSL * p_ssl, uint8_t type, uint8_t sub_type,
                                          uint8_t reject_code)
 {
-    rejection_t * p_rejection = cr_msg_create_rej(type, sub_type,
-                                                    reject_code);
+    //NOTE: The packet is copied into the session's send buffer, so it lives
+    //on the stack and sending it allocates nothing.
+    rejection_t rejection;
 
-    if (NULL == p_rejection)
+    if (SUCCESS != cr_msg_create_rej(&rejection, type, sub_type, reject_code))
     {
-        fprintf(stderr, "cr_msg_send_reg_rej: cr_msg_create_rej()\n");
+        CR_LOG_ERROR("cr_msg_send_reg_rej: cr_msg_create_rej()");
         return FAILURE;
     }
 
-    int sent_bytes = SSL_write(p_ssl, p_rejection, sizeof(rejection_t));
+    int return_val = cr_msg_write(p_ssl, &rejection, sizeof(rejection_t));
 
-    if (0 >= sent_bytes)
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        perror("cr_msg_send_reg_rej: SSL_write():");
-        FREE(p_rejection);
-        return CONNECTION_FAILURE;
+        CR_LOG_ERROR("cr_msg_send_reg_rej: cr_msg_write()");
     }
 
-    FREE(p_rejection);
-
-    return SUCCESS;
+    return return_val;
 }
 
 /**
@@ -136,65 +436,280 @@ cr_msg_send_rej (SSL * p_ssl, uint8_t type, uint8_t sub_type,
 int
 cr_msg_send_ack (SSL * p_ssl, uint8_t type, uint8_t sub_type)
 {
-    acknowledge_t * p_acknowledge = cr_msg_create_ack(type, sub_type);
+    acknowledge_t acknowledge;
 
-    if (NULL == p_acknowledge)
+    if (SUCCESS != cr_msg_create_ack(&acknowledge, type, sub_type))
     {
-        fprintf(stderr, "cr_msg_send_reg_ack: cr_msg_create_ack()\n");
+        CR_LOG_ERROR("cr_msg_send_reg_ack: cr_msg_create_ack()");
         return FAILURE;
     }
 
-    int sent_bytes = SSL_write(p_ssl, p_acknowledge, sizeof(acknowledge_t));
+    int return_val = cr_msg_write(p_ssl, &acknowledge,
+                                   sizeof(acknowledge_t));
 
-    if (0 >= sent_bytes)
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        perror("cr_msg_send_reg_ack: SSL_write():");
-        FREE(p_acknowledge);
-        return CONNECTION_FAILURE;
+        CR_LOG_ERROR("cr_msg_send_reg_ack: cr_msg_write()");
     }
 
-    FREE(p_acknowledge);
-
-    return SUCCESS;
+    return return_val;
 }
 
 /**
  * @brief sends a chat update packet to the client.
  * 
  * @param p_ssl pointer to ssl socket file descriptor.
- * @param p_username username of the chat sender.
+ * @param p_sender interned username of the chat sender.
  * @param p_chat chat message.
+ * @param seq room sequence number of the chat (0 for room notices).
  * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
  */
 int
-cr_msg_send_update (SSL * p_ssl, char * p_username, char * p_chat)
+cr_msg_send_update (SSL * p_ssl, const cr_name_t * p_sender, char * p_chat,
+                                                       uint64_t seq)
 {
-    if ((NULL == p_username) || (NULL == p_chat))
+    if ((NULL == p_sender) || (NULL == p_chat))
     {
-        fprintf(stderr, "cr_msg_send_update: input NULL\n");
+        CR_LOG_ERROR("cr_msg_send_update: input NULL");
         return FAILURE;
     }
     
-    chat_t * p_chat_ack = cr_msg_create_update(p_username, p_chat);
+    chat_update_t chat_ack;
 
-    if (NULL == p_chat_ack)
+    if (SUCCESS != cr_msg_create_update(&chat_ack, p_sender, p_chat, seq))
     {
-        fprintf(stderr, "cr_msg_send_update: cr_msg_create_update()\n");
+        CR_LOG_ERROR("cr_msg_send_update: cr_msg_create_update()");
         return FAILURE;
     }
 
-    int sent_bytes = SSL_write(p_ssl, p_chat_ack, sizeof(chat_t));
+    int return_val = SUCCESS;
 
-    if (0 >= sent_bytes)
+    if (cr_msg_legacy(p_ssl))
     {
-        perror("cr_msg_send_update: SSL_write():");
-        FREE(p_chat_ack);
-        return CONNECTION_FAILURE;
+        chat_t legacy_ack;
+        memset(&legacy_ack, 0, sizeof(chat_t));
+        memcpy(&legacy_ack, &chat_ack, offsetof(chat_t, p_chat));
+        memcpy(legacy_ack.p_chat, chat_ack.p_chat, sizeof(legacy_ack.p_chat));
+
+        return_val = cr_msg_write(p_ssl, &legacy_ack, sizeof(chat_t));
+    }
+    else
+    {
+        return_val = cr_msg_write(p_ssl, &chat_ack, sizeof(chat_update_t));
     }
 
-    FREE(p_chat_ack);
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_msg_send_update: cr_msg_write()");
+    }
 
-    return SUCCESS;
+    return return_val;
+}
+
+/**
+ * @brief sends the sender of a chat its own chat as a chat response, which
+ * carries the sequence number the room gave it. Legacy clients are not sent
+ * anything, they never received their own chats.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_sender interned username of the chat sender.
+ * @param p_chat chat message.
+ * @param seq room sequence number of the chat.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_chat_ack (SSL * p_ssl, const cr_name_t * p_sender, char * p_chat,
+                                                         uint64_t seq)
+{
+    if ((NULL == p_sender) || (NULL == p_chat))
+    {
+        CR_LOG_ERROR("cr_msg_send_chat_ack: input NULL");
+        return FAILURE;
+    }
+
+    if (cr_msg_legacy(p_ssl))
+    {
+        return SUCCESS;
+    }
+
+    chat_update_t chat_ack;
+
+    if (SUCCESS != cr_msg_create_update(&chat_ack, p_sender, p_chat, seq))
+    {
+        CR_LOG_ERROR("cr_msg_send_chat_ack: cr_msg_create_update()");
+        return FAILURE;
+    }
+
+    chat_ack.opcode = RESPONSE;
+
+    int return_val = cr_msg_write(p_ssl, &chat_ack, sizeof(chat_update_t));
+
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_msg_send_chat_ack: cr_msg_write()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief sends a room join acknowledge packet followed by the missing tail
+ * of the room history in a single write.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param seq latest sequence number of the room.
+ * @param p_history log lines newer than the client's since value.
+ * @param history_len length of p_history (at most MAX_CHAT_FILE_SIZE).
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_join_ack (SSL * p_ssl, uint64_t seq, char * p_history,
+                                              uint16_t history_len)
+{
+    if ((NULL == p_history) || (MAX_CHAT_FILE_SIZE < history_len))
+    {
+        CR_LOG_ERROR("cr_msg_send_join_ack: input invalid");
+        return FAILURE;
+    }
+
+    //NOTE: Header and history are sent in one record so the client receives
+    //the catch-up as a single unit.
+    char p_packet[sizeof(join_ack_t) + MAX_CHAT_FILE_SIZE] = {0};
+    size_t packet_len = 0;
+
+    //NOTE: Legacy clients take a plain acknowledge followed by the history
+    //lines without their sequence numbers.
+    if (cr_msg_legacy(p_ssl))
+    {
+        if (SUCCESS != cr_msg_create_ack((acknowledge_t *) p_packet,
+                                         ROOMS_TYPE, JOIN_STYPE))
+        {
+            CR_LOG_ERROR("cr_msg_send_join_ack: cr_msg_create_ack()");
+            return FAILURE;
+        }
+
+        packet_len = sizeof(acknowledge_t);
+        size_t offset = 0;
+
+        while (offset < history_len)
+        {
+            char * p_line = p_history + offset;
+            char * p_end = memchr(p_line, '\n', (history_len - offset));
+            size_t line_len = (NULL == p_end) ? (history_len - offset) :
+                              (size_t) (p_end - p_line) + 1;
+            char * p_space = memchr(p_line, ' ', line_len);
+            char * p_text = (NULL == p_space) ? p_line : (p_space + 1);
+            size_t text_len = line_len - (size_t) (p_text - p_line);
+
+            memcpy((p_packet + packet_len), p_text, text_len);
+            packet_len += text_len;
+            offset += line_len;
+        }
+    }
+    else
+    {
+        join_ack_t * p_join_ack = (join_ack_t *) p_packet;
+
+        p_join_ack->type = ROOMS_TYPE;
+        p_join_ack->s_type = JOIN_STYPE;
+        p_join_ack->opcode = ACKNOWLEDGE;
+        p_join_ack->seq = htobe64(seq);
+        p_join_ack->history_len = htons(history_len);
+        memcpy((p_packet + sizeof(join_ack_t)), p_history, history_len);
+        packet_len = sizeof(join_ack_t) + history_len;
+    }
+
+    int return_val = cr_msg_write(p_ssl, p_packet, packet_len);
+
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_msg_send_join_ack: cr_msg_write()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief sends a protocol version acknowledge packet to the client.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param version protocol version the server will use for the connection.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_version_ack (SSL * p_ssl, uint8_t version)
+{
+    version_t version_ack;
+    memset(&version_ack, 0, sizeof(version_t));
+
+    version_ack.type = SESSION_TYPE;
+    version_ack.s_type = VERSION_STYPE;
+    version_ack.opcode = ACKNOWLEDGE;
+    version_ack.version = version;
+
+    int return_val = cr_msg_write(p_ssl, &version_ack, sizeof(version_t));
+
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_msg_send_version_ack: cr_msg_write()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief sends a compression acknowledge packet to the client.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param algorithm compression algorithm the server will use.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_compress_ack (SSL * p_ssl, uint8_t algorithm)
+{
+    compress_t compress_ack;
+    memset(&compress_ack, 0, sizeof(compress_t));
+
+    compress_ack.type = SESSION_TYPE;
+    compress_ack.s_type = COMPRESS_STYPE;
+    compress_ack.opcode = ACKNOWLEDGE;
+    compress_ack.algorithm = algorithm;
+
+    int return_val = cr_msg_write(p_ssl, &compress_ack, sizeof(compress_t));
+
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_msg_send_compress_ack: cr_msg_write()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief sends a stats acknowledge packet built by cr_stats_snapshot.
+ * 
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param p_packet stats acknowledge packet.
+ * @param packet_len length of the packet.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_msg_send_stats_ack (SSL * p_ssl, const char * p_packet, size_t packet_len)
+{
+    if ((NULL == p_packet) || (sizeof(stats_ack_t) > packet_len))
+    {
+        CR_LOG_ERROR("cr_msg_send_stats_ack: input invalid");
+        return FAILURE;
+    }
+
+    int return_val = cr_msg_write(p_ssl, p_packet, packet_len);
+
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_msg_send_stats_ack: cr_msg_write()");
+    }
+
+    return return_val;
 }
 
 /**
@@ -212,55 +727,62 @@ cr_msg_send_file_ack_helper (SSL * p_ssl, uint8_t type, uint8_t sub_type,
 {
     if (NULL == p_filename)
     {
-        fprintf(stderr, "cr_msg_send_file_ack_helper: input NULL\n");
+        CR_LOG_ERROR("cr_msg_send_file_ack_helper: input NULL");
         return FAILURE;
     }
-    
-    int return_val = cr_msg_send_ack(p_ssl, type, sub_type);
-
-    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
-    {
-        fprintf(stderr, "cr_msg_send_file_ack_helper: cr_msg_send_rej()\n");
-        return return_val;
-    }
 
     struct stat file_info;
 
     if (SUCCESS != stat(p_filename, &file_info))
     {
-        perror("cr_msg_send_file_ack_helper: stat");
+        CR_LOG_ERRNO("cr_msg_send_file_ack_helper: stat");
         return FAILURE;
     }
 
     off_t file_size = file_info.st_size;
 
-    int file_descriptor = open(p_filename, O_RDONLY);
-
-    if (FAILURE_NEGATIVE == file_descriptor)
+    if (MAX_CHAT_FILE_SIZE < file_size)
     {
-        perror("cr_msg_send_file_ack_helper: open");
+        CR_LOG_ERROR("cr_msg_send_file_ack_helper: file too large");
         return FAILURE;
     }
 
-    char p_buffer[MAX_CHAT_FILE_SIZE + 1] = {0};
+    int file_descriptor = open(p_filename, O_RDONLY);
 
-    if (FAILURE_NEGATIVE == read(file_descriptor, p_buffer, file_size))
+    if (FAILURE_NEGATIVE == file_descriptor)
     {
-        perror("cr_msg_send_file_ack_helper: sendfile");
-        close(file_descriptor);
+        CR_LOG_ERRNO("cr_msg_send_file_ack_helper: open");
         return FAILURE;
     }
 
-    if (FAILURE_NEGATIVE == SSL_write(p_ssl, p_buffer, file_size))
+    //NOTE: The ack header and the file are sent as one packet so the v2
+    //framing can give them a single length prefix.
+    char p_packet[sizeof(acknowledge_t) + MAX_CHAT_FILE_SIZE] = {0};
+    acknowledge_t * p_acknowledge = (acknowledge_t *) p_packet;
+
+    p_acknowledge->type = type;
+    p_acknowledge->s_type = sub_type;
+    p_acknowledge->opcode = ACKNOWLEDGE;
+
+    if (FAILURE_NEGATIVE == read(file_descriptor,
+                          (p_packet + sizeof(acknowledge_t)), file_size))
     {
-        perror("cr_msg_send_file_ack_helper: sendfile");
+        CR_LOG_ERRNO("cr_msg_send_file_ack_helper: read");
         close(file_descriptor);
         return FAILURE;
     }
 
     close(file_descriptor);
 
-    return SUCCESS;
+    int return_val = cr_msg_write(p_ssl, p_packet,
+                          (sizeof(acknowledge_t) + file_size));
+
+    if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+    {
+        CR_LOG_ERROR("cr_msg_send_file_ack_helper: cr_msg_write()");
+    }
+
+    return return_val;
 }
 
 /**
@@ -280,7 +802,7 @@ cr_msg_send_file_ack (SSL * p_ssl, int client_fd, uint8_t type,
 {
     if (NULL == p_filename)
     {
-        fprintf(stderr, "cr_msg_send_file_ack: input NULL\n");
+        CR_LOG_ERROR("cr_msg_send_file_ack: input NULL");
         return FAILURE;
     }
     
@@ -289,7 +811,7 @@ cr_msg_send_file_ack (SSL * p_ssl, int client_fd, uint8_t type,
     if (FAILURE_NEGATIVE == setsockopt(client_fd, IPPROTO_TCP, TCP_CORK,
                                                &optval, sizeof(optval)))
     {
-        perror("cr_msg_send_file_ack: setsockopt()\n");
+        CR_LOG_ERRNO("cr_msg_send_file_ack: setsockopt()");
         return FAILURE;
     }
 
@@ -301,13 +823,13 @@ cr_msg_send_file_ack (SSL * p_ssl, int client_fd, uint8_t type,
     if (FAILURE_NEGATIVE == setsockopt(client_fd, IPPROTO_TCP, TCP_CORK,
                                                &optval, sizeof(optval)))
     {
-        perror("cr_msg_send_file_ack: setsockopt()\n");
+        CR_LOG_ERRNO("cr_msg_send_file_ack: setsockopt()");
         return CONNECTION_FAILURE;
     }
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_msg_send_file_ack: cr_msg_send_rej()\n");
+        CR_LOG_ERROR("cr_msg_send_file_ack: cr_msg_send_rej()");
     }
 
     return return_val;
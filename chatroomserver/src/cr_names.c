@@ -0,0 +1,203 @@
+#include "../include/cr_names.h"
+
+//NOTE: names_mutex guards the chains and the reference counts. Names are
+//looked up on registration, room creation and remote chats, not per member,
+//so one lock is enough.
+static cr_name_t * p_name_buckets[NAMES_BUCKETS];
+static pthread_mutex_t names_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t name_count = 0;
+
+/**
+ * @brief Hashes (FNV-1a) the bytes of a name, the hash cr_name_t carries.
+ *
+ * @param p_bytes name.
+ * @param length bytes in the name.
+ * @return uint32_t the hash.
+ */
+uint32_t
+cr_names_hash (const char * p_bytes, size_t length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t index = 0; index < length; index++)
+    {
+        hash = (hash ^ (uint8_t) p_bytes[index]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Walks a bucket for a name.
+ *
+ * WARNING: Calling function must hold names_mutex.
+ *
+ * @param hash hash of the name.
+ * @param p_bytes name.
+ * @param length bytes in the name.
+ * @return cr_name_t* the name. NULL returned if it is not in the bucket.
+ */
+static cr_name_t *
+cr_names_walk (uint32_t hash, const char * p_bytes, size_t length)
+{
+    cr_name_t * p_name = p_name_buckets[hash & (NAMES_BUCKETS - 1)];
+
+    while (NULL != p_name)
+    {
+        if ((hash == p_name->hash) && (length == p_name->length) &&
+            (0 == memcmp(p_bytes, p_name->p_bytes, length)))
+        {
+            return p_name;
+        }
+
+        p_name = p_name->p_next;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Returns the interned name with the given bytes, adding it if it is
+ * not interned yet. Any thread may call it.
+ *
+ * @param p_bytes name, read up to its terminator or max_length bytes.
+ * @param max_length most bytes to read.
+ * @return const cr_name_t* the name. NULL returned if the name is empty or
+ * longer than MAX_NAME_LENGTH, or on failure.
+ */
+const cr_name_t *
+cr_names_intern (const char * p_bytes, size_t max_length)
+{
+    if (NULL == p_bytes)
+    {
+        CR_LOG_ERROR("cr_names_intern: input NULL");
+        return NULL;
+    }
+
+    size_t length = strnlen(p_bytes, max_length);
+
+    if ((0 == length) || (MAX_NAME_LENGTH < length))
+    {
+        return NULL;
+    }
+
+    uint32_t hash = cr_names_hash(p_bytes, length);
+
+    pthread_mutex_lock(&names_mutex);
+
+    cr_name_t * p_name = cr_names_walk(hash, p_bytes, length);
+
+    if (NULL == p_name)
+    {
+        p_name = calloc(1, sizeof(cr_name_t));
+
+        if (NULL == p_name)
+        {
+            CR_LOG_ERRNO("cr_names_intern: p_name calloc");
+            pthread_mutex_unlock(&names_mutex);
+            return NULL;
+        }
+
+        cr_name_t ** pp_bucket = &p_name_buckets[hash & (NAMES_BUCKETS - 1)];
+
+        p_name->hash = hash;
+        p_name->length = (uint8_t) length;
+        memcpy(p_name->p_bytes, p_bytes, length);
+        p_name->p_next = *pp_bucket;
+        *pp_bucket = p_name;
+        __atomic_add_fetch(&name_count, 1, __ATOMIC_RELAXED);
+    }
+
+    p_name->refs++;
+
+    pthread_mutex_unlock(&names_mutex);
+
+    return p_name;
+}
+
+/**
+ * @brief Gives back a reference taken by cr_names_intern. The name is freed
+ * with its last reference.
+ *
+ * @param p_name the name. NULL does nothing.
+ */
+void
+cr_names_release (const cr_name_t * p_name)
+{
+    if (NULL == p_name)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&names_mutex);
+
+    cr_name_t ** pp_link = &p_name_buckets[p_name->hash &
+                                           (NAMES_BUCKETS - 1)];
+
+    while ((NULL != *pp_link) && (p_name != *pp_link))
+    {
+        pp_link = &(*pp_link)->p_next;
+    }
+
+    cr_name_t * p_held = *pp_link;
+
+    if (NULL == p_held)
+    {
+        CR_LOG_ERROR("cr_names_release: name not interned");
+    }
+    else if (0 == --p_held->refs)
+    {
+        *pp_link = p_held->p_next;
+        __atomic_sub_fetch(&name_count, 1, __ATOMIC_RELAXED);
+        free(p_held);
+    }
+
+    pthread_mutex_unlock(&names_mutex);
+}
+
+/**
+ * @brief Returns the interned name with the given bytes, without adding it
+ * or taking a reference. The name only stays valid while another holder
+ * keeps it, so the result is meant for comparing against held names.
+ *
+ * @param p_bytes name, read up to its terminator or max_length bytes.
+ * @param max_length most bytes to read.
+ * @return const cr_name_t* the name. NULL returned if it is not interned.
+ */
+const cr_name_t *
+cr_names_find (const char * p_bytes, size_t max_length)
+{
+    if (NULL == p_bytes)
+    {
+        CR_LOG_ERROR("cr_names_find: input NULL");
+        return NULL;
+    }
+
+    size_t length = strnlen(p_bytes, max_length);
+
+    if ((0 == length) || (MAX_NAME_LENGTH < length))
+    {
+        return NULL;
+    }
+
+    uint32_t hash = cr_names_hash(p_bytes, length);
+
+    pthread_mutex_lock(&names_mutex);
+    const cr_name_t * p_name = cr_names_walk(hash, p_bytes, length);
+    pthread_mutex_unlock(&names_mutex);
+
+    return p_name;
+}
+
+/**
+ * @brief Returns the number of interned names.
+ *
+ * @return uint32_t the count.
+ */
+uint32_t
+cr_names_count ()
+{
+    return __atomic_load_n(&name_count, __ATOMIC_RELAXED);
+}
+
+//End of cr_names.c file
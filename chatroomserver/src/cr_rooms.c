@@ -1,5 +1,8 @@
 #include "../include/cr_rooms.h"
 
+//NOTE: Set once by cr_rooms_start before any session runs.
+static uint8_t rooms_persist = PERSIST_OFF;
+
 /**
  * @brief Sets TCP cork socket option and sends a packet header along with
  * the file with all of the room names in it.
@@ -13,7 +16,7 @@ cr_rooms_list_helper (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder)
 {
     if (NULL == p_rooms)
     {
-        fprintf(stderr, "cr_rooms_list_helper: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_list_helper: input NULL");
         return FAILURE;
     }
 
@@ -26,7 +29,7 @@ cr_rooms_list_helper (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder)
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_list_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_list_helper: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -37,7 +40,7 @@ cr_rooms_list_helper (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder)
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_rooms_list_helper: cr_msg_send_file_ack()\n");
+        CR_LOG_ERROR("cr_rooms_list_helper: cr_msg_send_file_ack()");
     }
 
     return return_val;
@@ -55,35 +58,157 @@ cr_rooms_list (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder)
 {
     if (NULL == p_rooms)
     {
-        fprintf(stderr, "cr_rooms_list: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_list: input NULL");
         return FAILURE;
     }
 
     int return_val;
     
-    if (SUCCESS != pthread_mutex_lock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_rooms_list: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_rooms_list: pthread_mutex_lock:");
         return FAILURE;
     }
 
     return_val = cr_rooms_list_helper(p_rooms, p_ssl_holder);
 
-    if (SUCCESS != pthread_mutex_unlock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_rooms_list: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_rooms_list: pthread_mutex_unlock:");
         return FAILURE;
     }
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_rooms_list: cr_msg_send_rej()\n");
+        CR_LOG_ERROR("cr_rooms_list: cr_msg_send_rej()");
     }
     
     return return_val;
 }
 
 
+/**
+ * @brief Adds a user to a room, sends them the join acknowledge with the
+ * history they are missing, and tells the other users they joined.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room_t struct.
+ * @param p_ssl_holder pointer to struct with SSL and client file descriptors.
+ * @param p_user pointer to current user struct.
+ * @param since last chat sequence number the client holds for the room.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_join_room (room_t * p_room, ssl_socket_holder_t * p_ssl_holder,
+                                      user_t * p_user, uint64_t since)
+{
+    if ((NULL == p_room) || (NULL == p_ssl_holder) || (NULL == p_user))
+    {
+        CR_LOG_ERROR("cr_rooms_join_room: input NULL");
+        return FAILURE;
+    }
+
+    int return_val = SUCCESS;
+
+    if (FAILURE == cll_intrusive_insert_end(&p_room->members,
+                                            &p_user->room_link))
+    {
+        CR_LOG_ERROR("cr_rooms_join_room: cll_intrusive_insert_end()");
+        return_val = FAILURE;
+    }
+    else
+    {
+        cr_cluster_room_joined(p_room->p_name->p_bytes);
+    }
+
+    cr_stats_room_members(p_room);
+
+    p_user->p_room_name = p_room->p_name;
+
+    //NOTE: A room loaded from the catalog reads its log on its first join.
+    if (FAILURE == cr_chats_page_in(p_room))
+    {
+        CR_LOG_ERROR("cr_rooms_join_room: cr_chats_page_in()");
+    }
+
+    //NOTE: A since value past the room's sequence means the client saw an
+    //older room of the same name, so the whole history is sent instead.
+    if (since > p_room->chat_seq)
+    {
+        since = 0;
+    }
+
+    char p_history[MAX_CHAT_FILE_SIZE] = {0};
+    int return_val_2 = FAILURE;
+    int history_len = cr_chats_history(p_room, since, p_history,
+                                                 sizeof(p_history));
+
+    if (FAILURE_NEGATIVE == history_len)
+    {
+        CR_LOG_ERROR("cr_rooms_join_room: cr_chats_history()");
+    }
+    else
+    {
+        return_val_2 = cr_msg_send_join_ack(p_ssl_holder->p_ssl,
+                   p_room->chat_seq, p_history, (uint16_t) history_len);
+    }
+
+    char * p_joined_message = "User has joined the room";
+                                                    
+    int return_val_3 = cr_chats_chat_send(p_room, p_user, p_joined_message,
+                                                                        0);
+
+    if ((FAILURE == return_val_2) || (CONNECTION_FAILURE == return_val_2))
+    {
+        CR_LOG_ERROR("cr_rooms_join_room: cr_msg_send_ack()");
+    }
+
+    if ((FAILURE == return_val_3) || (CONNECTION_FAILURE == return_val_3))
+    {
+        CR_LOG_ERROR("cr_rooms_join_room: cr_chats_chat_send()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Puts a user handed over by the previous server process back in the
+ * room it was in. Nothing is sent, the client already has the room's
+ * history and the other members never saw it leave.
+ * 
+ * WARNING: Calling function must lock the room's mutex before use and
+ * unlock after use, or be the room's owning worker.
+ * 
+ * @param p_room pointer to room_t struct.
+ * @param p_user pointer to current user struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_rejoin_room (room_t * p_room, user_t * p_user)
+{
+    if ((NULL == p_room) || (NULL == p_user))
+    {
+        CR_LOG_ERROR("cr_rooms_rejoin_room: input NULL");
+        return FAILURE;
+    }
+
+    if (FAILURE == cll_intrusive_insert_end(&p_room->members,
+                                            &p_user->room_link))
+    {
+        CR_LOG_ERROR("cr_rooms_rejoin_room: cll_intrusive_insert_end()");
+        return FAILURE;
+    }
+
+    cr_cluster_room_joined(p_room->p_name->p_bytes);
+    cr_stats_room_members(p_room);
+
+    p_user->p_room_name = p_room->p_name;
+
+    return SUCCESS;
+}
+
 /**
  * @brief critical section for join functionality.
  * 
@@ -93,16 +218,18 @@ cr_rooms_list (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder)
  * @param p_room_name room name.
  * @param p_chatting pointer to tracker that identifies whether the user
  * is in a room or not.
+ * @param since last chat sequence number the client holds for the room.
  * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
  */
 int
 cr_rooms_join_helper (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder,
-                      user_t * p_user, char * p_room_name, int * p_chatting)
+                      user_t * p_user, char * p_room_name, int * p_chatting,
+                                                              uint64_t since)
 {
     if ((NULL == p_rooms) || (NULL == p_user) || (NULL == p_room_name) ||
         (NULL == p_chatting))
     {
-        fprintf(stderr, "cr_rooms_join_helper: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_join_helper: input NULL");
         return FAILURE;
     }
 
@@ -118,54 +245,37 @@ cr_rooms_join_helper (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_join_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_join_helper: cr_msg_send_rej()");
         }
 
         return return_val;
     }
 
-    if (SUCCESS != pthread_mutex_lock(&p_room->room_mutex))
+    if (cr_shards_on())
     {
-        perror("cr_rooms_join_helper: pthread_mutex_lock:");
-        return FAILURE;
+        return_val = cr_shards_join(p_room, p_ssl_holder, p_user, since);
     }
-
-    if (FAILURE == cll_insert_element_end(p_room->p_users, p_user))
+    else
     {
-        fprintf(stderr, "cr_rooms_join_helper: cll_insert_element_end()\n");
-        return_val = FAILURE;
-    }
-
-    strncpy(p_user->p_chat_room, p_room_name, strlen(p_room_name));
-
-    int return_val_2 = cr_msg_send_file_ack(p_ssl_holder->p_ssl,
-                        p_ssl_holder->client_fd, ROOMS_TYPE, JOIN_STYPE,
-                        p_room->p_room_location);
+        if (SUCCESS != CR_MUTEX_LOCK(&p_room->room_mutex))
+        {
+            CR_LOG_ERRNO("cr_rooms_join_helper: pthread_mutex_lock:");
+            return FAILURE;
+        }
 
-    char * p_joined_message = "User has joined the room";
-                                                    
-    int return_val_3 = cr_chats_chat_send(p_room, p_user, p_joined_message);
+        return_val = cr_rooms_join_room(p_room, p_ssl_holder, p_user, since);
 
-    if (SUCCESS != pthread_mutex_unlock(&p_room->room_mutex))
-    {
-        perror("cr_rooms_join_helper: pthread_mutex_unlock:");
-        return FAILURE;
+        if (SUCCESS != CR_MUTEX_UNLOCK(&p_room->room_mutex))
+        {
+            CR_LOG_ERRNO("cr_rooms_join_helper: pthread_mutex_unlock:");
+            return FAILURE;
+        }
     }
 
     if (FAILURE == return_val)
     {
         return FAILURE;
     }
-    
-    if ((FAILURE == return_val_2) || (CONNECTION_FAILURE == return_val_2))
-    {
-        fprintf(stderr, "cr_rooms_join_helper: cr_msg_send_ack()\n");
-    }
-
-    if ((FAILURE == return_val_3) || (CONNECTION_FAILURE == return_val_3))
-    {
-        fprintf(stderr, "cr_rooms_join_helper: cr_chats_chat_send()\n");
-    }
 
     *p_chatting = CHATTING;
 
@@ -191,7 +301,7 @@ cr_rooms_join (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder,
     if ((NULL == p_rooms) || (NULL == p_user) || (NULL == p_buffer) ||
         (NULL == p_chatting))
     {
-        fprintf(stderr, "cr_rooms_join: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_join: input NULL");
         return FAILURE;
     }
 
@@ -202,24 +312,95 @@ cr_rooms_join (rooms_t * p_rooms, ssl_socket_holder_t * p_ssl_holder,
 
     int return_val;
 
-    if (SUCCESS != pthread_mutex_lock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_rooms_join: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_rooms_join: pthread_mutex_lock:");
         return FAILURE;
     }
 
     return_val = cr_rooms_join_helper(p_rooms, p_ssl_holder, p_user,
-                                  join_req.p_room_name, p_chatting);
+                              join_req.p_room_name, p_chatting,
+                              be64toh(join_req.since));
 
-    if (SUCCESS != pthread_mutex_unlock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_rooms_join: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_rooms_join: pthread_mutex_unlock:");
         return FAILURE;
     }
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_rooms_join: cr_rooms_join_helper()\n");
+        CR_LOG_ERROR("cr_rooms_join: cr_rooms_join_helper()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Puts a user handed over by the previous server process back in the
+ * room it was in, without sending anything.
+ * 
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_user pointer to current user struct.
+ * @param p_room_name room name.
+ * @param p_chatting pointer to tracker that identifies whether the user
+ * is in a room or not.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_rejoin (rooms_t * p_rooms, user_t * p_user, char * p_room_name,
+                                                        int * p_chatting)
+{
+    if ((NULL == p_rooms) || (NULL == p_user) || (NULL == p_room_name) ||
+        (NULL == p_chatting))
+    {
+        CR_LOG_ERROR("cr_rooms_rejoin: input NULL");
+        return FAILURE;
+    }
+
+    int return_val = FAILURE;
+
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_rooms_rejoin: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    room_t * p_room = h_table_return_entry(p_rooms->p_rooms_table,
+                                                     p_room_name);
+
+    if (NULL == p_room)
+    {
+        CR_LOG_WARN("cr_rooms_rejoin: %s was not handed over", p_room_name);
+    }
+    else if (cr_shards_on())
+    {
+        return_val = cr_shards_rejoin(p_room, p_user);
+    }
+    else if (SUCCESS == CR_MUTEX_LOCK(&p_room->room_mutex))
+    {
+        return_val = cr_rooms_rejoin_room(p_room, p_user);
+
+        if (SUCCESS != CR_MUTEX_UNLOCK(&p_room->room_mutex))
+        {
+            CR_LOG_ERRNO("cr_rooms_rejoin: pthread_mutex_unlock:");
+            return_val = FAILURE;
+        }
+    }
+    else
+    {
+        CR_LOG_ERRNO("cr_rooms_rejoin: pthread_mutex_lock:");
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_rooms_rejoin: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    if (SUCCESS == return_val)
+    {
+        *p_chatting = CHATTING;
     }
 
     return return_val;
@@ -242,7 +423,7 @@ cr_rooms_chk_str_chars (char * p_string)
 {
     if (NULL == p_string)
     {
-        fprintf(stderr, "cr_rooms_chk_str_chars: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_chk_str_chars: input NULL");
     }
 
     int str_len = strnlen(p_string, MAX_USERNAME_LENGTH);
@@ -285,7 +466,7 @@ cr_rooms_create_name_to_file (char * p_room_name)
 {
     if (NULL == p_room_name)
     {
-        fprintf(stderr, "cr_rooms_create_name_to_file: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_create_name_to_file: input NULL");
         return FAILURE;
     }
     
@@ -293,7 +474,7 @@ cr_rooms_create_name_to_file (char * p_room_name)
 
     if (NULL == file_pointer)
     {
-        perror("cr_rooms_create_name_to_file: fopen");
+        CR_LOG_ERRNO("cr_rooms_create_name_to_file: fopen");
         return FAILURE;
     }
 
@@ -302,102 +483,161 @@ cr_rooms_create_name_to_file (char * p_room_name)
 
     if (EOF == fclose(file_pointer))
     {
-        perror("cr_rooms_create_name_to_file: fclose:");
+        CR_LOG_ERRNO("cr_rooms_create_name_to_file: fclose:");
         return FAILURE;
     }
 
     return SUCCESS;
 }
 
+/**
+ * @brief Creates a room struct, initiallizes its data structure and adds it
+ * to the rooms table. Leaves the room's files alone.
+ *
+ * WARNING: Calling function must lock p_rooms_mutex before use and unlock
+ * after use, and must have checked the name and the room count.
+ * 
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @return room_t * pointer to the new room, NULL on failure.
+ */
+static room_t *
+cr_rooms_new_room (rooms_t * p_rooms, char * p_room_name)
+{
+    if ((NULL == p_rooms) || (NULL == p_room_name))
+    {
+        CR_LOG_ERROR("cr_rooms_new_room: input NULL");
+        return NULL;
+    }
+
+    room_t * p_room = cr_alloc_aligned(sizeof(room_t));
+
+    if (NULL == p_room)
+    {
+        CR_LOG_ERRNO("cr_rooms_new_room: p_room cr_alloc_aligned()");
+        return NULL;
+    }
+
+    p_room->p_name = cr_names_intern(p_room_name, MAX_ROOM_NAME_LENGTH);
+
+    if (NULL == p_room->p_name)
+    {
+        CR_LOG_ERROR("cr_rooms_new_room: cr_names_intern()");
+        FREE(p_room);
+        return NULL;
+    }
+
+    snprintf(p_room->p_room_location, (MAX_ROOM_NAME_LENGTH +
+                  ROOM_ADDED_CHARS), "rooms/%s.log", p_room->p_name->p_bytes);
+
+    if (SUCCESS != pthread_mutex_init(&p_room->room_mutex, NULL))
+    {
+        CR_LOG_ERRNO("cr_rooms_new_room: pthread_mutex_init:");
+        cr_names_release(p_room->p_name);
+        FREE(p_room);
+        return NULL;
+    }
+
+    cll_intrusive_init(&p_room->members);
+
+    if (FAILURE == h_table_new_entry(p_rooms->p_rooms_table, p_room,
+                                               p_room->p_name->p_bytes))
+    {
+        CR_LOG_ERROR("cr_rooms_new_room: h_table_new_entry()");
+        pthread_mutex_destroy(&p_room->room_mutex);
+        cr_names_release(p_room->p_name);
+        FREE(p_room);
+        return NULL;
+    }
+
+    cr_stats_room_add(p_room);
+    p_rooms->room_count++;
+
+    return p_room;
+}
+
 /**
  * @brief Create a rooms struct, initiallizes its data structure and log file.
+ *
+ * WARNING: Calling function must lock p_rooms_mutex before use and unlock
+ * after use, and must have checked the name and the room count.
  * 
  * @param p_rooms pointer to rooms_t struct.
- * @param p_ssl pointer to ssl socket file descriptor.
- * @param room_req packet received from client.
- * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ * @param p_room_name room name.
+ * @return int SUCCESS (0) or FAILURE (1).
  */
-int
-cr_rooms_create_helper_2 (rooms_t * p_rooms, SSL * p_ssl,
-                                     room_req_t room_req)
+static int
+cr_rooms_create_room (rooms_t * p_rooms, char * p_room_name)
 {
-    if (NULL == p_rooms)
+    if ((NULL == p_rooms) || (NULL == p_room_name))
     {
-        fprintf(stderr, "cr_rooms_create_helper_2: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_create_room: input NULL");
         return FAILURE;
     }
 
-    int return_val;
-
     char p_filename[MAX_ROOM_NAME_LENGTH + ROOM_ADDED_CHARS] = {0};
     snprintf(p_filename, (MAX_ROOM_NAME_LENGTH + ROOM_ADDED_CHARS),
-                             "rooms/%s.log", room_req.p_room_name);
+                             "rooms/%s.log", p_room_name);
 
     FILE * file_pointer = fopen(p_filename, "w");
 
     if (NULL == file_pointer)
     {
-        perror("cr_rooms_create_helper_2: fopen:");
+        CR_LOG_ERRNO("cr_rooms_create_room: fopen:");
         return FAILURE;
     }
 
     if (EOF == fclose(file_pointer))
     {
-        perror("cr_rooms_create_helper_2: fclose:");
+        CR_LOG_ERRNO("cr_rooms_create_room: fclose:");
         return FAILURE;
     }
 
-    room_t * p_room = calloc(1, sizeof(room_t));
-
-    if (NULL == p_room)
+    if (NULL == cr_rooms_new_room(p_rooms, p_room_name))
     {
-        perror("cr_rooms_create_helper_2: p_room calloc");
+        CR_LOG_ERROR("cr_rooms_create_room: cr_rooms_new_room()");
         return FAILURE;
     }
 
-    strncpy(p_room->p_room_location, p_filename, strlen(p_filename));
-    strncpy(p_room->p_room_name, room_req.p_room_name,
-                        strlen(room_req.p_room_name));
-
-    if (SUCCESS != pthread_mutex_init(&p_room->room_mutex, NULL))
+    if (FAILURE == cr_rooms_create_name_to_file(p_room_name))
     {
-        perror("cr_rooms_create_helper_2: pthread_mutex_init:");
-        FREE(p_room);
         return FAILURE;
     }
 
-    p_room->p_users = cll_init();
-
-    if (NULL == p_room->p_users)
-    {
-        fprintf(stderr, "cr_rooms_create_helper_2: cll_init");
-        pthread_mutex_destroy(&p_room->room_mutex);
-        FREE(p_room);
-        return FAILURE;
-    }
+    return SUCCESS;
+}
 
-    if (FAILURE == h_table_new_entry(p_rooms->p_rooms_table, p_room,
-                                               p_room->p_room_name))
+/**
+ * @brief Creates the room and sends an acknowledge packet to the client.
+ * 
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_ssl pointer to ssl socket file descriptor.
+ * @param room_req packet received from client.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_rooms_create_helper_2 (rooms_t * p_rooms, SSL * p_ssl,
+                                     room_req_t room_req)
+{
+    if (NULL == p_rooms)
     {
-        fprintf(stderr, "cr_rooms_create_helper_2: h_table_new_entry()\n");
-        cll_destroy(&p_room->p_users, NULL);
-        pthread_mutex_destroy(&p_room->room_mutex);
-        FREE(p_room);
+        CR_LOG_ERROR("cr_rooms_create_helper_2: input NULL");
         return FAILURE;
     }
 
-    if (FAILURE == cr_rooms_create_name_to_file(room_req.p_room_name))
+    if (FAILURE == cr_rooms_create_room(p_rooms, room_req.p_room_name))
     {
+        CR_LOG_ERROR("cr_rooms_create_helper_2: cr_rooms_create_room()");
         return FAILURE;
     }
 
-    p_rooms->room_count++;
+    cr_cluster_room_add(room_req.p_room_name);
 
-    return_val = cr_msg_send_ack(p_ssl, ROOMS_TYPE, CREATE_STYPE);
+    int return_val = cr_msg_send_ack(p_ssl, ROOMS_TYPE, CREATE_STYPE);
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_rooms_create_helper_2: cr_msg_send_ack()\n");
+        CR_LOG_ERROR("cr_rooms_create_helper_2: cr_msg_send_ack()");
     }
 
     return return_val;
@@ -418,7 +658,7 @@ cr_rooms_create_helper (rooms_t * p_rooms, SSL * p_ssl, room_req_t room_req)
 {
     if (NULL == p_rooms)
     {
-        fprintf(stderr, "cr_rooms_create_helper: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_create_helper: input NULL");
         return FAILURE;
     }
 
@@ -431,7 +671,7 @@ cr_rooms_create_helper (rooms_t * p_rooms, SSL * p_ssl, room_req_t room_req)
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_create_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_create_helper: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -445,7 +685,7 @@ cr_rooms_create_helper (rooms_t * p_rooms, SSL * p_ssl, room_req_t room_req)
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_create_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_create_helper: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -455,8 +695,8 @@ cr_rooms_create_helper (rooms_t * p_rooms, SSL * p_ssl, room_req_t room_req)
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_rooms_create_helper: "
-                        "cr_rooms_create_helper_2()\n");
+        CR_LOG_ERROR("cr_rooms_create_helper: "
+                        "cr_rooms_create_helper_2()");
     }
 
     return return_val;
@@ -477,7 +717,7 @@ cr_rooms_create (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
 {
     if ((NULL == p_rooms) || (NULL == p_buffer) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_rooms_create: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_create: input NULL");
         return FAILURE;
     }
 
@@ -496,7 +736,7 @@ cr_rooms_create (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_create: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_create: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -513,7 +753,7 @@ cr_rooms_create (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_create: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_create: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -527,29 +767,29 @@ cr_rooms_create (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_create: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_create: cr_msg_send_rej()");
         }
 
         return return_val;
     }
 
-    if (SUCCESS != pthread_mutex_lock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_rooms_create: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_rooms_create: pthread_mutex_lock:");
         return FAILURE;
     }
 
     return_val = cr_rooms_create_helper(p_rooms, p_ssl, room_req);
 
-    if (SUCCESS != pthread_mutex_unlock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_rooms_create: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_rooms_create: pthread_mutex_unlock:");
         return FAILURE;
     }
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_rooms_create: cr_rooms_create_helper()\n");
+        CR_LOG_ERROR("cr_rooms_create: cr_rooms_create_helper()");
     }
 
     return return_val;
@@ -563,11 +803,11 @@ cr_rooms_create (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
  * @return int SUCCESS (0) or FAILURE (1)
  */
 static int
-cr_rooms_delete_h_file (rooms_t * p_rooms, char * p_room_name)
+cr_rooms_delete_h_file (rooms_t * p_rooms, const char * p_room_name)
 {
     if ((NULL == p_rooms) || (NULL == p_room_name))
     {
-        fprintf(stderr, "cr_rooms_delete_h_file: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_delete_h_file: input NULL");
         return FAILURE;
     }
 
@@ -581,7 +821,7 @@ cr_rooms_delete_h_file (rooms_t * p_rooms, char * p_room_name)
 
     if ((NULL == file_pointer) || (NULL == file_pointer_2))
     {
-        perror("cr_rooms_delete_h_file: fopen");
+        CR_LOG_ERRNO("cr_rooms_delete_h_file: fopen");
         return FAILURE;
     }
 
@@ -595,19 +835,19 @@ cr_rooms_delete_h_file (rooms_t * p_rooms, char * p_room_name)
 
     if (EOF == fclose(file_pointer))
     {
-        perror("cr_rooms_delete_h_file: fclose:");
+        CR_LOG_ERRNO("cr_rooms_delete_h_file: fclose:");
         return FAILURE;
     }
 
     if (EOF == fclose(file_pointer_2))
     {
-        perror("cr_rooms_delete_h_file: fclose:");
+        CR_LOG_ERRNO("cr_rooms_delete_h_file: fclose:");
         return FAILURE;
     }
     
     if (FAILURE_NEGATIVE == rename(ROOM_NAME_LIST_BACKUP, ROOM_NAME_LIST))
     {
-        perror("cr_rooms_delete_h_file: rename:");
+        CR_LOG_ERRNO("cr_rooms_delete_h_file: rename:");
         return FAILURE;
     }
 
@@ -625,25 +865,21 @@ cr_users_free_room (room_t * p_room)
 {
     if (NULL == p_room)
     {
-        fprintf(stderr, "cr_users_free_room: input NULL\n");
+        CR_LOG_ERROR("cr_users_free_room: input NULL");
         return FAILURE;
     }
 
-    if (FAILURE == cll_destroy(&p_room->p_users, NULL))
-    {
-        fprintf(stderr, "cr_users_free_room: cll_destroy()\n");
-        return FAILURE;
-    }
+    cr_stats_room_remove(p_room);
 
     if (SUCCESS != pthread_mutex_destroy(&p_room->room_mutex))
     {
-        perror("cr_users_free_room: pthread_mutex_destroy:");
+        CR_LOG_ERRNO("cr_users_free_room: pthread_mutex_destroy:");
         return FAILURE;
     }
 
     if (SUCCESS != remove(p_room->p_room_location))
     {
-        perror("cr_users_free_room: remove:");
+        CR_LOG_ERRNO("cr_users_free_room: remove:");
         return FAILURE;
     }
 
@@ -652,6 +888,58 @@ cr_users_free_room (room_t * p_room)
     return SUCCESS;
 }
 
+/**
+ * @brief Destroys the room's hash table entry, frees it and removes it from
+ * the room name list.
+ *
+ * WARNING: Calling function must lock p_rooms_mutex before use and unlock
+ * after use, and must have checked the room is empty.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room pointer to the room.
+ * @return int SUCCESS (0) or FAILURE (1)
+ */
+static int
+cr_rooms_delete_room (rooms_t * p_rooms, room_t * p_room)
+{
+    if ((NULL == p_rooms) || (NULL == p_room))
+    {
+        CR_LOG_ERROR("cr_rooms_delete_room: input NULL");
+        return FAILURE;
+    }
+
+    //NOTE: The room's reference to its name is given back last, the name
+    //is still needed for the room name list.
+    const cr_name_t * p_name = p_room->p_name;
+    const char * p_room_name = p_name->p_bytes;
+
+    if (NULL == h_table_destroy_entry(p_rooms->p_rooms_table, p_room_name))
+    {
+        CR_LOG_ERROR("cr_rooms_delete_room: h_table_destroy_entry()");
+        return FAILURE;
+    }
+
+    if (FAILURE == cr_users_free_room(p_room))
+    {
+        CR_LOG_ERROR("cr_rooms_delete_room: cr_users_free_room()");
+        return FAILURE;
+    }
+
+    int return_val = cr_rooms_delete_h_file(p_rooms, p_room_name);
+
+    cr_names_release(p_name);
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_rooms_delete_room: cr_rooms_delete_h_file()");
+        return FAILURE;
+    }
+
+    p_rooms->room_count--;
+
+    return SUCCESS;
+}
+
 /**
  * @brief Sends a reject packet if the room doesn't exist or already has
  * a user in it. Destroys hash table entry and removes room from log file.
@@ -666,7 +954,7 @@ cr_rooms_delete_helper (rooms_t * p_rooms, SSL * p_ssl, char * p_room_name)
 {
     if ((NULL == p_rooms) || (NULL == p_room_name))
     {
-        fprintf(stderr, "cr_rooms_delete_helper: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_delete_helper: input NULL");
         return FAILURE;
     }
 
@@ -682,50 +970,46 @@ cr_rooms_delete_helper (rooms_t * p_rooms, SSL * p_ssl, char * p_room_name)
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_delete_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_delete_helper: cr_msg_send_rej()");
         }
 
         return return_val;
     }
 
-    if (EMPTY != p_room->p_users->size)
+    //NOTE: A leave still waiting on the room's owner has not emptied the
+    //room yet, and the owner may still be sending its notice.
+    if (cr_shards_on() && (FAILURE == cr_shards_barrier(p_room)))
+    {
+        CR_LOG_ERROR("cr_rooms_delete_helper: cr_shards_barrier()");
+        return FAILURE;
+    }
+
+    if (EMPTY != p_room->members.size)
     {
         return_val = cr_msg_send_rej(p_ssl, ROOMS_TYPE, DEL_STYPE,
                                                      ROOM_IN_USE);
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_delete_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_delete_helper: cr_msg_send_rej()");
         }
 
         return return_val;
     }
 
-    if (NULL == h_table_destroy_entry(p_rooms->p_rooms_table, p_room_name))
+    if (FAILURE == cr_rooms_delete_room(p_rooms, p_room))
     {
-        fprintf(stderr, "cr_rooms_delete_helper: h_table_destroy_entry()\n");
+        CR_LOG_ERROR("cr_rooms_delete_helper: cr_rooms_delete_room()");
         return FAILURE;
     }
 
-    if (FAILURE == cr_users_free_room(p_room))
-    {
-        fprintf(stderr, "cr_rooms_delete_helper: cr_users_free_room()\n");
-        return FAILURE;
-    }
-
-    if (FAILURE == cr_rooms_delete_h_file(p_rooms, p_room_name))
-    {
-        fprintf(stderr, "cr_rooms_delete_helper: cr_rooms_delete_h_file()\n");
-        return FAILURE;
-    }
-
-    p_rooms->room_count--;
+    cr_cluster_room_del(p_room_name);
 
     return_val = cr_msg_send_ack(p_ssl, ROOMS_TYPE, DEL_STYPE);
     
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_rooms_delete_helper: cr_msg_send_ack()\n");
+        CR_LOG_ERROR("cr_rooms_delete_helper: cr_msg_send_ack()");
     }
 
     return return_val;
@@ -746,7 +1030,7 @@ cr_rooms_delete (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
 {
     if ((NULL == p_rooms) || (NULL == p_buffer) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_rooms_delete: input NULL\n");
+        CR_LOG_ERROR("cr_rooms_delete: input NULL");
         return FAILURE;
     }
 
@@ -759,7 +1043,7 @@ cr_rooms_delete (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_rooms_delete: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_rooms_delete: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -769,40 +1053,318 @@ cr_rooms_delete (rooms_t * p_rooms, SSL * p_ssl, user_t * p_user,
     memcpy(&room_d_req, p_buffer, sizeof(room_d_req_t));
     room_d_req.p_room_name[MAX_ROOM_NAME_LENGTH] = '\0';
 
-    if (SUCCESS != pthread_mutex_lock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_rooms_delete: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_rooms_delete: pthread_mutex_lock:");
         return FAILURE;
     }
 
     return_val = cr_rooms_delete_helper(p_rooms, p_ssl,
                                         room_d_req.p_room_name);
 
-    if (SUCCESS != pthread_mutex_unlock(p_rooms->p_rooms_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
     {
-        perror("cr_rooms_delete: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_rooms_delete: pthread_mutex_unlock:");
         return FAILURE;
     }
     
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_rooms_delete: cr_msg_send_ack()\n");
+        CR_LOG_ERROR("cr_rooms_delete: cr_msg_send_ack()");
     }
 
     return return_val;
 }
 
+/**
+ * @brief Creates a room created on another cluster node. Names this node
+ * would reject, rooms it already has and rooms past its limit are skipped,
+ * and the other nodes are not told again.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_create_remote (rooms_t * p_rooms, char * p_room_name)
+{
+    if ((NULL == p_rooms) || (NULL == p_room_name))
+    {
+        CR_LOG_ERROR("cr_rooms_create_remote: input NULL");
+        return FAILURE;
+    }
+
+    if ((BAD_CHAR == cr_rooms_chk_str_chars(p_room_name)) ||
+        (MIN_ROOM_NAME_LENGTH > strlen(p_room_name)))
+    {
+        CR_LOG_WARN("cr_rooms_create_remote: bad room name %s", p_room_name);
+        return SUCCESS;
+    }
+
+    int return_val = SUCCESS;
+
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_rooms_create_remote: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    if (NULL == h_table_return_entry(p_rooms->p_rooms_table, p_room_name))
+    {
+        if (p_rooms->room_count >= p_rooms->max_rooms)
+        {
+            CR_LOG_WARN("cr_rooms_create_remote: no space for %s",
+                                                        p_room_name);
+        }
+        else
+        {
+            return_val = cr_rooms_create_room(p_rooms, p_room_name);
+        }
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_rooms_create_remote: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_rooms_create_remote: cr_rooms_create_room()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Deletes a room deleted on another cluster node. A room that still
+ * has members here is kept, and the other nodes are not told again.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_delete_remote (rooms_t * p_rooms, char * p_room_name)
+{
+    if ((NULL == p_rooms) || (NULL == p_room_name))
+    {
+        CR_LOG_ERROR("cr_rooms_delete_remote: input NULL");
+        return FAILURE;
+    }
+
+    int return_val = SUCCESS;
+
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_rooms_delete_remote: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    room_t * p_room = h_table_return_entry(p_rooms->p_rooms_table,
+                                                     p_room_name);
+
+    if ((NULL != p_room) && cr_shards_on())
+    {
+        return_val = cr_shards_barrier(p_room);
+    }
+
+    if ((NULL != p_room) && (SUCCESS == return_val))
+    {
+        if (EMPTY != p_room->members.size)
+        {
+            CR_LOG_WARN("cr_rooms_delete_remote: %s is in use", p_room_name);
+        }
+        else
+        {
+            return_val = cr_rooms_delete_room(p_rooms, p_room);
+        }
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_rooms_delete_remote: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_rooms_delete_remote: cr_rooms_delete_room()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Adds a room handed over by the previous server process. Its log and
+ * its line in the room name list are already on disk and are kept.
+ *
+ * @param p_rooms pointer to rooms_t struct.
+ * @param p_room_name room name.
+ * @param chat_seq the room's last chat sequence number.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_rooms_adopt (rooms_t * p_rooms, char * p_room_name, uint64_t chat_seq)
+{
+    if ((NULL == p_rooms) || (NULL == p_room_name))
+    {
+        CR_LOG_ERROR("cr_rooms_adopt: input NULL");
+        return FAILURE;
+    }
+
+    if ((BAD_CHAR == cr_rooms_chk_str_chars(p_room_name)) ||
+        (MIN_ROOM_NAME_LENGTH > strlen(p_room_name)))
+    {
+        CR_LOG_WARN("cr_rooms_adopt: bad room name %s", p_room_name);
+        return SUCCESS;
+    }
+
+    int return_val = SUCCESS;
+
+    if (SUCCESS != CR_MUTEX_LOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_rooms_adopt: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    if (NULL == h_table_return_entry(p_rooms->p_rooms_table, p_room_name))
+    {
+        if (p_rooms->room_count >= p_rooms->max_rooms)
+        {
+            CR_LOG_WARN("cr_rooms_adopt: no space for %s", p_room_name);
+        }
+        else
+        {
+            room_t * p_room = cr_rooms_new_room(p_rooms, p_room_name);
+
+            if (NULL == p_room)
+            {
+                return_val = FAILURE;
+            }
+            else
+            {
+                p_room->chat_seq = chat_seq;
+            }
+        }
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_rooms->p_rooms_mutex))
+    {
+        CR_LOG_ERRNO("cr_rooms_adopt: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_rooms_adopt: cr_rooms_new_room()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Registers every room in the room name list left by a previous run.
+ * Only the names are read, each room reads its log on first use.
+ * 
+ * @param p_rooms pointer to rooms_t struct.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_rooms_load (rooms_t * p_rooms)
+{
+    FILE * file_pointer = fopen(ROOM_NAME_LIST, "r");
+
+    if (NULL == file_pointer)
+    {
+        CR_LOG_ERRNO("cr_rooms_load: fopen");
+        return FAILURE;
+    }
+
+    char line_buffer[BUFF_SIZE] = {0};
+    int return_val = SUCCESS;
+
+    while ((SUCCESS == return_val) &&
+           (NULL != fgets(line_buffer, sizeof(line_buffer), file_pointer)))
+    {
+        line_buffer[strcspn(line_buffer, "\r\n")] = '\0';
+
+        if ((MIN_ROOM_NAME_LENGTH > strlen(line_buffer)) ||
+            (MAX_ROOM_NAME_LENGTH < strlen(line_buffer)) ||
+            (BAD_CHAR == cr_rooms_chk_str_chars(line_buffer)) ||
+            (NULL != h_table_return_entry(p_rooms->p_rooms_table,
+                                                     line_buffer)))
+        {
+            CR_LOG_WARN("cr_rooms_load: skipped room %s", line_buffer);
+            continue;
+        }
+
+        if (p_rooms->room_count >= p_rooms->max_rooms)
+        {
+            CR_LOG_WARN("cr_rooms_load: no space for %s", line_buffer);
+            break;
+        }
+
+        room_t * p_room = cr_rooms_new_room(p_rooms, line_buffer);
+
+        if (NULL == p_room)
+        {
+            CR_LOG_ERROR("cr_rooms_load: cr_rooms_new_room()");
+            return_val = FAILURE;
+            break;
+        }
+
+        p_room->log_cold = 1;
+    }
+
+    if (EOF == fclose(file_pointer))
+    {
+        CR_LOG_ERRNO("cr_rooms_load: fclose:");
+        return FAILURE;
+    }
+
+    CR_LOG_INFO("cr_rooms_load: %u rooms", p_rooms->room_count);
+
+    return return_val;
+}
+
 /**
  * @brief Creates rooms log directory and file for holding room name list.
+ * With persistent rooms an existing directory is kept and every room in its
+ * room name list is registered. Their logs are only read on first use.
  * 
+ * @param p_rooms pointer to rooms_t struct.
+ * @param keep non zero when the rooms are handed over by the previous server
+ * process, whose directory and room name list are kept.
+ * @param persist_rooms PERSIST_ON to keep the rooms between runs.
  * @return int SUCCESS (0) or FAILURE (1).
  */
 int
-cr_rooms_start ()
+cr_rooms_start (rooms_t * p_rooms, int keep, uint8_t persist_rooms)
 {
+    if (NULL == p_rooms)
+    {
+        CR_LOG_ERROR("cr_rooms_start: input NULL");
+        return FAILURE;
+    }
+
+    rooms_persist = persist_rooms;
+
+    if (keep)
+    {
+        return SUCCESS;
+    }
+
     if (SUCCESS != mkdir(LOG_DIR, S_IRUSR | S_IWUSR | S_IXUSR))
     {
-        perror("cr_rooms_start: mkdir");
+        //NOTE: The rooms of a previous run, its room name list is the
+        //catalog.
+        if ((EEXIST == errno) && (PERSIST_ON == persist_rooms))
+        {
+            return cr_rooms_load(p_rooms);
+        }
+
+        CR_LOG_ERRNO("cr_rooms_start: mkdir");
         return FAILURE;
     }
 
@@ -810,35 +1372,51 @@ cr_rooms_start ()
 
     if (NULL == file_pointer)
     {
-        perror("cr_rooms_start: fopen");
+        CR_LOG_ERRNO("cr_rooms_start: fopen");
         return FAILURE;
     }
 
     if (EOF == fclose(file_pointer))
     {
-        perror("cr_rooms_start: fclose:");
+        CR_LOG_ERRNO("cr_rooms_start: fclose:");
         return FAILURE;
     }
 
     return SUCCESS;
 }
 
+/**
+ * @brief Returns whether the rooms are kept between runs.
+ * 
+ * @return int 1 with persistent rooms on, 0 if not.
+ */
+int
+cr_rooms_persistent ()
+{
+    return (PERSIST_ON == rooms_persist);
+}
+
 /**
  * @brief Cleans rooms list file and removes room directories on server
- * shutdown.
+ * shutdown. Does nothing with persistent rooms on.
  * 
  */
 void
 cr_rooms_clean ()
 {
+    if (PERSIST_ON == rooms_persist)
+    {
+        return;
+    }
+
     if (SUCCESS != remove(ROOM_NAME_LIST))
     {
-        perror("cr_rooms_clean: remove");
+        CR_LOG_ERRNO("cr_rooms_clean: remove");
     }
 
     if(SUCCESS != rmdir(LOG_DIR))
     {
-        perror("cr_rooms_clean: rmdir");
+        CR_LOG_ERRNO("cr_rooms_clean: rmdir");
     }
 }
 
@@ -21,7 +21,7 @@ cr_sm_chat_state (cr_package_t * p_cr_package, char * p_buffer,
     if ((NULL == p_cr_package) || (NULL == p_buffer) || (NULL == p_chatting)
                                                         || (NULL == p_user))
     {
-        fprintf(stderr, "cr_sm_chat_state: input NULL\n");
+        CR_LOG_ERROR("cr_sm_chat_state: input NULL");
         return FAILURE;
     }
 
@@ -41,7 +41,7 @@ cr_sm_chat_state (cr_package_t * p_cr_package, char * p_buffer,
 
             if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
             {
-                fprintf(stderr, "cr_sm_chat_state: cr_chats_chat()\n");
+                CR_LOG_ERROR("cr_sm_chat_state: cr_chats_chat()");
             }
 
             return return_val;
@@ -53,7 +53,7 @@ cr_sm_chat_state (cr_package_t * p_cr_package, char * p_buffer,
 
             if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
             {
-                fprintf(stderr, "cr_sm_chat_state: cr_chats_leave()\n");
+                CR_LOG_ERROR("cr_sm_chat_state: cr_chats_leave()");
             }
 
             return return_val;
@@ -67,7 +67,7 @@ cr_sm_chat_state (cr_package_t * p_cr_package, char * p_buffer,
             if(FAILURE == cr_chats_leave(p_cr_package->p_rooms, p_chatting,
                      p_user, p_cr_package->p_ssl_holder->p_ssl, DONT_SEND))
             {
-                fprintf(stderr, "cr_sm_chat_state: cr_chats_leave()\n");
+                CR_LOG_ERROR("cr_sm_chat_state: cr_chats_leave()");
                 return FAILURE;
             }
 
@@ -75,7 +75,7 @@ cr_sm_chat_state (cr_package_t * p_cr_package, char * p_buffer,
                 p_cr_package->p_ssl_holder->p_ssl, p_user, p_logged_in,
                 DONT_SEND))
             {
-                fprintf(stderr, "cr_sm_chat_state: cr_users_logout()\n");
+                CR_LOG_ERROR("cr_sm_chat_state: cr_users_logout()");
                 return FAILURE;
             }
 
@@ -84,7 +84,7 @@ cr_sm_chat_state (cr_package_t * p_cr_package, char * p_buffer,
 
             if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
             {
-                fprintf(stderr, "cr_sm_chat_state: cr_msg_send_ack()\n");
+                CR_LOG_ERROR("cr_sm_chat_state: cr_msg_send_ack()");
                 return return_val;
             }
 
@@ -99,7 +99,7 @@ cr_sm_chat_state (cr_package_t * p_cr_package, char * p_buffer,
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_sm_chat_state: cr_msg_send_rej()\n");
+        CR_LOG_ERROR("cr_sm_chat_state: cr_msg_send_rej()");
     }
 
     return return_val;
@@ -126,7 +126,7 @@ cr_sm_ls_rooms (cr_package_t * p_cr_package, char * p_buffer, int * p_chatting,
     if ((NULL == p_cr_package) || (NULL == p_buffer) || (NULL == p_chatting) ||
                                                               (NULL == p_user))
     {
-        fprintf(stderr, "cr_sm_ls_rooms: input NULL\n");
+        CR_LOG_ERROR("cr_sm_ls_rooms: input NULL");
         return FAILURE;
     }
 
@@ -139,7 +139,7 @@ cr_sm_ls_rooms (cr_package_t * p_cr_package, char * p_buffer, int * p_chatting,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_sm_ls_rooms: cr_rooms_list()\n");
+            CR_LOG_ERROR("cr_sm_ls_rooms: cr_rooms_list()");
         }
 
         return return_val;
@@ -151,7 +151,7 @@ cr_sm_ls_rooms (cr_package_t * p_cr_package, char * p_buffer, int * p_chatting,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_sm_ls_rooms: cr_rooms_join()\n");
+            CR_LOG_ERROR("cr_sm_ls_rooms: cr_rooms_join()");
         }
 
         return return_val;
@@ -163,7 +163,7 @@ cr_sm_ls_rooms (cr_package_t * p_cr_package, char * p_buffer, int * p_chatting,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_sm_ls_rooms: cr_rooms_create()\n");
+            CR_LOG_ERROR("cr_sm_ls_rooms: cr_rooms_create()");
         }
 
         return return_val;
@@ -175,7 +175,7 @@ cr_sm_ls_rooms (cr_package_t * p_cr_package, char * p_buffer, int * p_chatting,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_sm_ls_rooms: cr_rooms_delete()\n");
+            CR_LOG_ERROR("cr_sm_ls_rooms: cr_rooms_delete()");
         }
 
         return return_val;
@@ -203,7 +203,7 @@ cr_sm_ls_account (cr_package_t * p_cr_package, char * p_buffer,
     if ((NULL == p_cr_package) || (NULL == p_buffer) ||
         (NULL == p_logged_in) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_sm_ls_account: input NULL\n");
+        CR_LOG_ERROR("cr_sm_ls_account: input NULL");
         return FAILURE;
     }
 
@@ -216,7 +216,7 @@ cr_sm_ls_account (cr_package_t * p_cr_package, char * p_buffer,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_sm_ls_account: cr_users_admin()\n");
+            CR_LOG_ERROR("cr_sm_ls_account: cr_users_admin()");
         }
 
         return return_val;
@@ -228,7 +228,7 @@ cr_sm_ls_account (cr_package_t * p_cr_package, char * p_buffer,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_sm_ls_account: cr_users_admin()\n");
+            CR_LOG_ERROR("cr_sm_ls_account: cr_users_admin()");
         }
 
         return return_val;
@@ -240,7 +240,7 @@ cr_sm_ls_account (cr_package_t * p_cr_package, char * p_buffer,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_sm_ls_account: cr_users_remove_user()\n");
+            CR_LOG_ERROR("cr_sm_ls_account: cr_users_remove_user()");
         }
 
         return return_val;
@@ -252,7 +252,7 @@ cr_sm_ls_account (cr_package_t * p_cr_package, char * p_buffer,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_sm_ls_account: cr_users_logout()\n");
+            CR_LOG_ERROR("cr_sm_ls_account: cr_users_logout()");
         }
 
         return return_val;
@@ -261,6 +261,37 @@ cr_sm_ls_account (cr_package_t * p_cr_package, char * p_buffer,
     return NO_MATCH;
 }
 
+/**
+ * @brief Helper function for cr_sm_logged_state. Answers an admin's stats
+ * request with a snapshot of the server; anyone else is rejected.
+ *
+ * @param p_cr_package pointer to package with client file descriptor,
+ * users_t struct, and rooms_t struct.
+ * @param p_user pointer to the logged in user's user_t struct.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+static int
+cr_sm_ls_stats (cr_package_t * p_cr_package, user_t * p_user)
+{
+    if ((NULL == p_cr_package) || (NULL == p_user))
+    {
+        CR_LOG_ERROR("cr_sm_ls_stats: input NULL");
+        return FAILURE;
+    }
+
+    SSL * p_ssl = p_cr_package->p_ssl_holder->p_ssl;
+
+    if (ADMIN != p_user->admin_status)
+    {
+        return cr_msg_send_rej(p_ssl, SESSION_TYPE, STATS_STYPE, ADMIN_PRIV);
+    }
+
+    char p_packet[STATS_PACKET_SIZE];
+    size_t packet_len = cr_stats_snapshot(p_cr_package->p_users, p_packet);
+
+    return cr_msg_send_stats_ack(p_ssl, p_packet, packet_len);
+}
+
 /**
  * @brief handles packets received from the client while in the logged in
  * state. calls users and rooms libraries to handle admin, removal, logout,
@@ -282,7 +313,7 @@ cr_sm_logged_state (cr_package_t * p_cr_package, char * p_buffer,
     if ((NULL == p_cr_package) || (NULL == p_buffer) || (NULL == p_logged_in)
                                  || (NULL == p_chatting) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_sm_logged_state: input NULL\n");
+        CR_LOG_ERROR("cr_sm_logged_state: input NULL");
         return FAILURE;
     }
 
@@ -322,7 +353,7 @@ cr_sm_logged_state (cr_package_t * p_cr_package, char * p_buffer,
                 p_cr_package->p_ssl_holder->p_ssl, p_user, p_logged_in,
                 DONT_SEND))
             {
-                fprintf(stderr, "cr_sm_logged_state: cr_users_logout()\n");
+                CR_LOG_ERROR("cr_sm_logged_state: cr_users_logout()");
                 return return_val;
             }
 
@@ -331,12 +362,23 @@ cr_sm_logged_state (cr_package_t * p_cr_package, char * p_buffer,
 
             if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
             {
-                fprintf(stderr, "cr_sm_logged_state: cr_msg_send_ack()\n");
+                CR_LOG_ERROR("cr_sm_logged_state: cr_msg_send_ack()");
                 return return_val;
             }
 
             return THREAD_SHUTDOWN;
         }
+        else if (STATS_STYPE == p_recvd_msg.s_type)
+        {
+            return_val = cr_sm_ls_stats(p_cr_package, p_user);
+
+            if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+            {
+                CR_LOG_ERROR("cr_sm_logged_state: cr_sm_ls_stats()");
+            }
+
+            return return_val;
+        }
     }
 
     //NOTE: If the received packet type is not login, register, or quit then
@@ -346,7 +388,7 @@ cr_sm_logged_state (cr_package_t * p_cr_package, char * p_buffer,
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_sm_logged_state: cr_msg_send_rej()\n");
+        CR_LOG_ERROR("cr_sm_logged_state: cr_msg_send_rej()");
     }
 
     return return_val;
@@ -370,7 +412,7 @@ cr_sm_connected_state (cr_package_t * p_cr_package, char * p_buffer,
 {
     if ((NULL == p_cr_package) || (NULL == p_logged_in))
     {
-        fprintf(stderr, "cr_sm_connected_state: input NULL\n");
+        CR_LOG_ERROR("cr_sm_connected_state: input NULL");
         return FAILURE;
     }
 
@@ -389,7 +431,7 @@ cr_sm_connected_state (cr_package_t * p_cr_package, char * p_buffer,
 
             if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
             {
-                fprintf(stderr, "cr_sm_connected_state: cr_users_login()\n");
+                CR_LOG_ERROR("cr_sm_connected_state: cr_users_login()");
             }
 
             return return_val;
@@ -401,8 +443,8 @@ cr_sm_connected_state (cr_package_t * p_cr_package, char * p_buffer,
 
             if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
             {
-                fprintf(stderr, "cr_sm_connected_state: "
-                                "cr_users_register()\n");
+                CR_LOG_ERROR("cr_sm_connected_state: "
+                                "cr_users_register()");
             }
 
             return return_val;
@@ -418,12 +460,38 @@ cr_sm_connected_state (cr_package_t * p_cr_package, char * p_buffer,
 
             if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
             {
-                fprintf(stderr, "cr_sm_connected_state: cr_msg_send_ack()\n");
+                CR_LOG_ERROR("cr_sm_connected_state: cr_msg_send_ack()");
                 return return_val;
             }
 
             return THREAD_SHUTDOWN;
         }
+        else if (VERSION_STYPE == p_recvd_msg.s_type)
+        {
+            return_val = cr_frame_negotiate(p_cr_package->p_session,
+                          p_cr_package->p_ssl_holder->p_ssl, p_buffer);
+
+            if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+            {
+                CR_LOG_ERROR("cr_sm_connected_state: "
+                                "cr_frame_negotiate()");
+            }
+
+            return return_val;
+        }
+        else if (COMPRESS_STYPE == p_recvd_msg.s_type)
+        {
+            return_val = cr_compress_negotiate(p_cr_package->p_session,
+                             p_cr_package->p_ssl_holder->p_ssl, p_buffer);
+
+            if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
+            {
+                CR_LOG_ERROR("cr_sm_connected_state: "
+                                "cr_compress_negotiate()");
+            }
+
+            return return_val;
+        }
     }
 
     //NOTE: If the received packet type is not login, register, or quit then
@@ -433,7 +501,7 @@ cr_sm_connected_state (cr_package_t * p_cr_package, char * p_buffer,
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_sm_connected_state: cr_msg_send_rej()\n");
+        CR_LOG_ERROR("cr_sm_connected_state: cr_msg_send_rej()");
     }
 
     return return_val;
@@ -449,16 +517,36 @@ cr_sm_connected_state (cr_package_t * p_cr_package, char * p_buffer,
 static void
 cr_sm_session_clean_help (cr_package_t * p_cr_package, user_t ** pp_user)
 {
+    if (NULL != p_cr_package->p_session)
+    {
+        cr_flush_cancel(p_cr_package->p_session);
+    }
+
     if (NULL != p_cr_package->p_ssl_holder->p_ssl)
     {
+        //NOTE: Packets still waiting for the flusher are sent before the
+        //connection closes.
+        if (NULL != p_cr_package->p_session)
+        {
+            cr_msg_flush(p_cr_package->p_ssl_holder->p_ssl);
+        }
+
         SSL_shutdown(p_cr_package->p_ssl_holder->p_ssl);
         SSL_free(p_cr_package->p_ssl_holder->p_ssl);
     }
     close(p_cr_package->p_ssl_holder->client_fd);
     SSL_CTX_free(p_cr_package->p_ssl_holder->p_ssl_ctx);
-    FREE(p_cr_package->p_ssl_holder);
-    FREE(pp_user);
-    FREE(p_cr_package);
+    CR_FREE(p_cr_package->p_ssl_holder);
+
+    if (NULL != p_cr_package->p_session)
+    {
+        pthread_mutex_destroy(&p_cr_package->p_session->send_mutex);
+    }
+
+    CR_FREE(p_cr_package->p_session);
+    FREE(p_cr_package->p_resume);
+    CR_FREE(pp_user);
+    CR_FREE(p_cr_package);
 }
 
 /**
@@ -482,7 +570,7 @@ cr_sm_session_clean (cr_package_t * p_cr_package, int * p_chatting,
         if(FAILURE == cr_chats_leave(p_cr_package->p_rooms, p_chatting,
                         *pp_user, p_cr_package->p_ssl_holder->p_ssl, DONT_SEND))
         {
-            fprintf(stderr, "cr_sm_session_clean: cr_chats_leave()\n");
+            CR_LOG_ERROR("cr_sm_session_clean: cr_chats_leave()");
             cr_sm_session_clean_help(p_cr_package, pp_user);
             return FAILURE;
         }
@@ -493,7 +581,7 @@ cr_sm_session_clean (cr_package_t * p_cr_package, int * p_chatting,
         if (FAILURE == cr_users_logout(p_cr_package->p_users,
             p_cr_package->p_ssl_holder->p_ssl, *pp_user, p_logged_in, DONT_SEND))
         {
-            fprintf(stderr, "cr_sm_session_clean: cr_users_logout()\n");
+            CR_LOG_ERROR("cr_sm_session_clean: cr_users_logout()");
             cr_sm_session_clean_help(p_cr_package, pp_user);
             return FAILURE;
         }
@@ -504,6 +592,173 @@ cr_sm_session_clean (cr_package_t * p_cr_package, int * p_chatting,
     return SUCCESS;
 }
 
+/**
+ * @brief Passes a received packet to the handler for the session's current
+ * state. States: connected, logged in, chatting.
+ *
+ * @param p_cr_package pointer to package with client file descriptor,
+ * users_t struct, and rooms_t struct.
+ * @param p_buffer pointer to buffer with received message.
+ * @param p_logged_in tracker for whether the user is logged in or not.
+ * @param p_chatting tracker for whether the user is chatting or not.
+ * @param pp_user double pointer to hold a pointer to the user.
+ * @return int SUCCESS (0), FAILURE (1), CONNECTION_FAILURE (2), or
+ * THREAD_SHUTDOWN (3).
+ */
+static int
+cr_sm_dispatch (cr_package_t * p_cr_package, char * p_buffer,
+     int * p_logged_in, int * p_chatting, user_t ** pp_user)
+{
+    int return_val;
+    int state = PROBE_STATE_CHATTING;
+
+    if (NOT_LOGGED_IN == *p_logged_in)
+    {
+        state = PROBE_STATE_CONNECTED;
+    }
+    else if (NOT_CHATTING == *p_chatting)
+    {
+        state = PROBE_STATE_LOGGED;
+    }
+
+    CR_PROBE(dispatch_begin, state, p_buffer[0], p_buffer[1]);
+
+    if (PROBE_STATE_CONNECTED == state)
+    {
+        return_val = cr_sm_connected_state(p_cr_package, p_buffer,
+                                                     p_logged_in, pp_user);
+    }
+    else if (PROBE_STATE_LOGGED == state)
+    {
+        return_val = cr_sm_logged_state(p_cr_package, p_buffer,
+                                        p_logged_in, p_chatting, *pp_user);
+    }
+    else
+    {
+        return_val = cr_sm_chat_state(p_cr_package, p_buffer,
+                          p_chatting, *pp_user, p_logged_in);
+    }
+
+    CR_PROBE(dispatch_end, state, p_buffer[0], p_buffer[1], return_val);
+
+    return return_val;
+}
+
+/**
+ * @brief Dispatches every complete packet in the session's receive buffer.
+ * A partial v2 frame is left in the buffer for the next read. The responses
+ * are batched and sent to the client in a single write.
+ *
+ * @param p_cr_package pointer to package with client file descriptor,
+ * users_t struct, and rooms_t struct.
+ * @param p_logged_in tracker for whether the user is logged in or not.
+ * @param p_chatting tracker for whether the user is chatting or not.
+ * @param pp_user double pointer to hold a pointer to the user.
+ * @return int SUCCESS (0), FAILURE (1), CONNECTION_FAILURE (2), or
+ * THREAD_SHUTDOWN (3).
+ */
+static int
+cr_sm_handle_reads (cr_package_t * p_cr_package, int * p_logged_in,
+                               int * p_chatting, user_t ** pp_user)
+{
+    SSL * p_ssl = p_cr_package->p_ssl_holder->p_ssl;
+    int return_val = cr_msg_batch(p_ssl);
+
+    while (SUCCESS == return_val)
+    {
+        char p_buffer[BUFF_SIZE + 1] = {0};
+        int frame_val = cr_frame_next(p_cr_package->p_session, p_buffer);
+
+        if (FRAME_INCOMPLETE == frame_val)
+        {
+            break;
+        }
+        else if (FRAME_CORRUPT == frame_val)
+        {
+            CR_LOG_ERROR("cr_sm_handle_reads: cr_frame_next()");
+            cr_metrics_count(METRIC_FRAME_CORRUPT);
+            return_val = CONNECTION_FAILURE;
+            break;
+        }
+        else if (FRAME_INVALID == frame_val)
+        {
+            cr_metrics_count(METRIC_FRAME_INVALID);
+            return_val = cr_msg_send_rej(p_ssl, FAIL_TYPE, FAIL_STYPE,
+                                             INVALID_PACKET_RCODE);
+            continue;
+        }
+
+        uint64_t start_ns = cr_metrics_now();
+        cr_trace_record(TRACE_DISPATCH_BEGIN, 0,
+            (((uint8_t) p_buffer[0] << 8) | (uint8_t) p_buffer[1]));
+        return_val = cr_sm_dispatch(p_cr_package, p_buffer, p_logged_in,
+                                                     p_chatting, pp_user);
+        cr_trace_record(TRACE_DISPATCH_END, 0, 0);
+        uint64_t elapsed_ns = cr_metrics_now() - start_ns;
+        cr_metrics_request(p_buffer[0], p_buffer[1], elapsed_ns);
+        cr_stats_request(elapsed_ns);
+    }
+
+    //NOTE: The batch is flushed on every exit so the responses gathered
+    //before a quit or a failure still reach the client.
+    int flush_val = cr_msg_flush(p_ssl);
+
+    if ((SUCCESS == return_val) && (SUCCESS != flush_val))
+    {
+        CR_LOG_ERROR("cr_sm_handle_reads: cr_msg_flush()");
+        return_val = CONNECTION_FAILURE;
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Restores a session handed over by the previous server process: its
+ * protocol state, login and room, then handles the requests it had received
+ * but not handled. A user that can not be restored stays logged out or out of
+ * the room, the client is told by the responses to its next requests.
+ *
+ * @param p_cr_package pointer to package with the session's state in
+ * p_resume.
+ * @param p_logged_in tracker for whether the user is logged in or not.
+ * @param p_chatting tracker for whether the user is chatting or not.
+ * @param pp_user double pointer to hold a pointer to the user.
+ * @return int SUCCESS (0), FAILURE (1), CONNECTION_FAILURE (2), or
+ * THREAD_SHUTDOWN (3).
+ */
+static int
+cr_sm_session_resume (cr_package_t * p_cr_package, int * p_logged_in,
+                                     int * p_chatting, user_t ** pp_user)
+{
+    handoff_session_t * p_resume = p_cr_package->p_resume;
+    session_t * p_session = p_cr_package->p_session;
+
+    p_session->version = p_resume->version;
+    p_session->compression = p_resume->compression;
+    memcpy(p_session->p_recv_buffer, p_resume->p_pending,
+                                     p_resume->pending_len);
+    p_session->recv_end = p_resume->pending_len;
+
+    if ((LOGGED_IN == p_resume->logged_in) &&
+        (SUCCESS == cr_users_resume(p_cr_package->p_users,
+                  p_cr_package->p_ssl_holder, p_resume->p_username,
+                                            pp_user, p_logged_in)) &&
+        (CHATTING == p_resume->chatting))
+    {
+        cr_rooms_rejoin(p_cr_package->p_rooms, *pp_user,
+                        p_resume->p_room_name, p_chatting);
+    }
+
+    FREE(p_cr_package->p_resume);
+
+    if (0 == p_session->recv_end)
+    {
+        return SUCCESS;
+    }
+
+    return cr_sm_handle_reads(p_cr_package, p_logged_in, p_chatting, pp_user);
+}
+
 /**
  * @brief Maintains session with client. Listens for client packets and
  * responds according to messaging protocols after conducting necessary
@@ -518,7 +773,7 @@ cr_sm_session_manager (cr_package_t * p_cr_package)
 {
     if (NULL == p_cr_package)
     {
-        fprintf(stderr, "cr_sm_session_manager: input NULL\n");
+        CR_LOG_ERROR("cr_sm_session_manager: input NULL");
         return FAILURE;
     }
 
@@ -529,19 +784,71 @@ cr_sm_session_manager (cr_package_t * p_cr_package)
     int * p_logged_in = &logged_in;
     int * p_chatting = &chatting;
 
-    user_t ** pp_user = calloc(1, sizeof(user_t *));
+    user_t ** pp_user = cr_alloc(sizeof(user_t *));
 
     if (NULL == pp_user)
     {
-        perror("cr_sm_session_manager: pp_user calloc");
+        CR_LOG_ERRNO("cr_sm_session_manager: pp_user cr_alloc");
         return FAILURE;
     }
 
-    while (CONTINUE == server_interrupt)
+    p_cr_package->p_session = cr_alloc(sizeof(session_t));
+
+    if (NULL == p_cr_package->p_session)
     {
-        char p_buffer[BUFF_SIZE + 1] = {0};
-        int return_val = SSL_read(p_cr_package->p_ssl_holder->p_ssl, p_buffer,
-                                                                   BUFF_SIZE);
+        CR_LOG_ERRNO("cr_sm_session_manager: p_session cr_alloc");
+        CR_FREE(pp_user);
+        return FAILURE;
+    }
+
+    if (SUCCESS != pthread_mutex_init(&p_cr_package->p_session->send_mutex,
+                                                                      NULL))
+    {
+        CR_LOG_ERRNO("cr_sm_session_manager: send_mutex init");
+        CR_FREE(p_cr_package->p_session);
+        CR_FREE(pp_user);
+        return FAILURE;
+    }
+
+    //NOTE: Every connection starts with the fixed size v1 packets until the
+    //client asks for a newer version. Until it asks for any version it may be
+    //an older client.
+    p_cr_package->p_session->version = PROTOCOL_LEGACY;
+    p_cr_package->p_session->p_ssl = p_cr_package->p_ssl_holder->p_ssl;
+    SSL_set_app_data(p_cr_package->p_ssl_holder->p_ssl,
+                             p_cr_package->p_session);
+
+    session_t * p_session = p_cr_package->p_session;
+
+    //NOTE: Set when the client ends the session, as opposed to the server
+    //stopping.
+    int session_over = 0;
+
+    if (NULL != p_cr_package->p_resume)
+    {
+        int return_val = cr_sm_session_resume(p_cr_package, p_logged_in,
+                                                   p_chatting, pp_user);
+
+        if (FAILURE == return_val)
+        {
+            CR_LOG_ERROR("cr_sm_session_manager: cr_sm_session_resume()");
+            signal_handler(SIGINT);
+            session_over = 1;
+        }
+        else if ((CONNECTION_FAILURE == return_val) ||
+                 (THREAD_SHUTDOWN == return_val))
+        {
+            session_over = 1;
+        }
+    }
+
+    while ((CONTINUE == server_interrupt) && !session_over)
+    {
+        cr_frame_compact(p_session);
+
+        int return_val = SSL_read(p_cr_package->p_ssl_holder->p_ssl,
+                        (p_session->p_recv_buffer + p_session->recv_end),
+                        (RECV_BUFF_SIZE - p_session->recv_end));
         if (0 >= return_val)
         {
             //NOTE: The timeout on the socket has been set to 3 seconds.
@@ -555,9 +862,13 @@ cr_sm_session_manager (cr_package_t * p_cr_package)
             }
             else
             {
-                perror("cr_sm_session_manager: SSL_read:");
-                SSL_free(p_cr_package->p_ssl_holder->p_ssl);
-                p_cr_package->p_ssl_holder->p_ssl = NULL;
+                CR_LOG_ERRNO("cr_sm_session_manager: SSL_read:");
+
+                //NOTE: The session leaves its room before the flusher drops
+                //it and its SSL struct is freed, so a broadcaster can't queue
+                //it again in between. No close_notify goes out on the broken
+                //connection.
+                SSL_set_quiet_shutdown(p_cr_package->p_ssl_holder->p_ssl, 1);
                 cr_sm_session_clean(p_cr_package, p_chatting, p_logged_in,
                                                                  pp_user);
                 return SUCCESS;
@@ -568,34 +879,25 @@ cr_sm_session_manager (cr_package_t * p_cr_package)
         //will be zero.
         if (0 == return_val)
         {
-            fprintf(stderr, "cr_sm_session_manager: "
-                    "client disconnected\n");
+            CR_LOG_INFO("cr_sm_session_manager: "
+                    "client disconnected");
+            session_over = 1;
             break;
         }
 
-        //NOTE: State determination made here. States: connected, logged in,
-        //chatting.
-        if (NOT_LOGGED_IN == *p_logged_in)
-        {
-            return_val = cr_sm_connected_state(p_cr_package, p_buffer,
-                                                         p_logged_in, pp_user);
-        }
-        else if (NOT_CHATTING == *p_chatting)
-        {
-            return_val = cr_sm_logged_state(p_cr_package, p_buffer,
-                                            p_logged_in, p_chatting, *pp_user);
-        }
-        else
-        {
-            return_val = cr_sm_chat_state(p_cr_package, p_buffer,
-                              p_chatting, *pp_user, p_logged_in);
-        }
+        p_session->recv_end += return_val;
+        cr_trace_record(TRACE_PACKET_RECEIVED, 0, return_val);
+        cr_stats_bytes(return_val, 0);
+
+        return_val = cr_sm_handle_reads(p_cr_package, p_logged_in, p_chatting,
+                                                                     pp_user);
 
         if (FAILURE == return_val)
         {
-            fprintf(stderr, "cr_sm_session_manager: "
-                    "handle_packet_connected()\n");
+            CR_LOG_ERROR("cr_sm_session_manager: "
+                    "handle_packet_connected()");
             signal_handler(SIGINT);
+            session_over = 1;
             break;
         }
         //NOTE: Thread failure doesn't require server shutdown -
@@ -603,16 +905,28 @@ cr_sm_session_manager (cr_package_t * p_cr_package)
         //total shutdown.
         else if (CONNECTION_FAILURE == return_val)
         {
-            fprintf(stderr, "cr_sm_session_manager: "
-                    "handle_packet_connected()\n");
+            CR_LOG_ERROR("cr_sm_session_manager: "
+                    "handle_packet_connected()");
+            session_over = 1;
             break;
         }
         else if (THREAD_SHUTDOWN == return_val)
         {
+            session_over = 1;
             break;
         }
     }
 
+    //NOTE: A session stopped by a hot restart goes to the new process with
+    //its user still logged in and in its room.
+    if (!session_over && cr_handoff_active() &&
+        (SUCCESS == cr_handoff_session(p_cr_package, logged_in, chatting,
+                                                              *pp_user)))
+    {
+        cr_sm_session_clean_help(p_cr_package, pp_user);
+        return SUCCESS;
+    }
+
     int return_val = cr_sm_session_clean(p_cr_package, p_chatting, p_logged_in,
                                                                       pp_user);
 
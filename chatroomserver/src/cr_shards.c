@@ -0,0 +1,522 @@
+#include "../include/cr_shards.h"
+#include "../include/cr_rooms.h"
+
+#include <sched.h>
+
+//NOTE: Each worker's inbox is an intrusive multi-producer, single-consumer
+//queue. Posters swap themselves in at p_head and then link the old head to
+//themselves; only the worker moves p_tail. The stub keeps the queue from
+//ever being empty, so a post never touches p_tail. ready counts the messages
+//posted, the worker sleeps on it when its inbox is empty.
+typedef struct {
+    shard_msg_t * p_head __attribute__((aligned(CACHE_LINE_SIZE)));
+    shard_msg_t * p_tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    shard_msg_t   stub;
+    sem_t         ready;
+    pthread_t     thread;
+} shard_t;
+
+static shard_t p_shards[MAX_ROOM_SHARDS];
+static uint8_t shard_count = 0;
+
+/**
+ * @brief Picks the worker that owns a room from the hash its name carries.
+ *
+ * @param p_room pointer to the room.
+ * @return shard_t * the owning worker.
+ */
+static shard_t *
+cr_shards_owner (room_t * p_room)
+{
+    return &p_shards[p_room->p_name->hash % shard_count];
+}
+
+/**
+ * @brief Adds a message to a worker's inbox and wakes the worker.
+ *
+ * @param p_shard pointer to the worker.
+ * @param p_msg message to post, owned by the worker until it is handled.
+ */
+static void
+cr_shards_push (shard_t * p_shard, shard_msg_t * p_msg)
+{
+    __atomic_store_n(&p_msg->p_next, NULL, __ATOMIC_RELAXED);
+
+    shard_msg_t * p_prev = __atomic_exchange_n(&p_shard->p_head, p_msg,
+                                                        __ATOMIC_ACQ_REL);
+
+    __atomic_store_n(&p_prev->p_next, p_msg, __ATOMIC_RELEASE);
+    sem_post(&p_shard->ready);
+}
+
+/**
+ * @brief Takes the oldest message from a worker's inbox. Only the worker may
+ * call this.
+ *
+ * @param p_shard pointer to the worker.
+ * @return shard_msg_t * the message, or NULL if none is ready. A message can
+ * be posted but not ready yet while its poster is between the two steps of
+ * cr_shards_push.
+ */
+static shard_msg_t *
+cr_shards_pop (shard_t * p_shard)
+{
+    shard_msg_t * p_tail = p_shard->p_tail;
+    shard_msg_t * p_next = __atomic_load_n(&p_tail->p_next,
+                                                  __ATOMIC_ACQUIRE);
+
+    if (&p_shard->stub == p_tail)
+    {
+        if (NULL == p_next)
+        {
+            return NULL;
+        }
+
+        p_shard->p_tail = p_next;
+        p_tail = p_next;
+        p_next = __atomic_load_n(&p_tail->p_next, __ATOMIC_ACQUIRE);
+    }
+
+    if (NULL != p_next)
+    {
+        p_shard->p_tail = p_next;
+        return p_tail;
+    }
+
+    if (p_tail != __atomic_load_n(&p_shard->p_head, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    //NOTE: p_tail is the last message. The stub goes in behind it so the
+    //message can be handed out without emptying the queue.
+    __atomic_store_n(&p_shard->stub.p_next, NULL, __ATOMIC_RELAXED);
+    shard_msg_t * p_prev = __atomic_exchange_n(&p_shard->p_head,
+                                   &p_shard->stub, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&p_prev->p_next, &p_shard->stub, __ATOMIC_RELEASE);
+
+    p_next = __atomic_load_n(&p_tail->p_next, __ATOMIC_ACQUIRE);
+
+    if (NULL != p_next)
+    {
+        p_shard->p_tail = p_next;
+        return p_tail;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Handles a chat from another cluster node. The sender is not a member
+ * here, so a stand-in user carries the name and every member is sent it.
+ *
+ * @param p_msg pointer to the message.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+static int
+cr_shards_remote (shard_msg_t * p_msg)
+{
+    user_t remote_user;
+
+    memset(&remote_user, 0, sizeof(user_t));
+    remote_user.p_name = p_msg->p_sender;
+
+    return cr_chats_chat_room(p_msg->p_room, &remote_user, p_msg->p_chat);
+}
+
+/**
+ * @brief Room worker. Handles every message posted to it in order until it
+ * is told to stop.
+ *
+ * @param p_shard_holder pointer to the worker's shard_t. Must be void pointer
+ * type to be compatable with pthread library.
+ * @return void * NULL.
+ */
+static void *
+cr_shards_thread (void * p_shard_holder)
+{
+    shard_t * p_shard = p_shard_holder;
+    int running = CONTINUE;
+
+    while (CONTINUE == running)
+    {
+        if (SUCCESS != sem_wait(&p_shard->ready))
+        {
+            continue;
+        }
+
+        shard_msg_t * p_msg = cr_shards_pop(p_shard);
+
+        while (NULL == p_msg)
+        {
+            sched_yield();
+            p_msg = cr_shards_pop(p_shard);
+        }
+
+        switch (p_msg->type)
+        {
+            case SHARD_JOIN:
+                p_msg->return_val = cr_rooms_join_room(p_msg->p_room,
+                                   p_msg->p_ssl_holder, p_msg->p_user,
+                                                         p_msg->since);
+                break;
+            case SHARD_CHAT:
+                if (FAILURE == cr_chats_chat_room(p_msg->p_room,
+                                       p_msg->p_user, p_msg->p_chat))
+                {
+                    CR_LOG_ERROR("cr_shards_thread: cr_chats_chat_room()");
+                }
+
+                CR_FREE(p_msg);
+                continue;
+            case SHARD_REMOTE:
+                if (FAILURE == cr_shards_remote(p_msg))
+                {
+                    CR_LOG_ERROR("cr_shards_thread: cr_chats_chat_room()");
+                }
+
+                cr_names_release(p_msg->p_sender);
+                CR_FREE(p_msg);
+                continue;
+            case SHARD_REJOIN:
+                p_msg->return_val = cr_rooms_rejoin_room(p_msg->p_room,
+                                                         p_msg->p_user);
+                break;
+            case SHARD_LEAVE:
+                p_msg->return_val = cr_chats_leave_room(p_msg->p_room,
+                                                        p_msg->p_user);
+                break;
+            case SHARD_STOP:
+                running = STOP;
+                p_msg->return_val = SUCCESS;
+                break;
+            default:
+                p_msg->return_val = SUCCESS;
+                break;
+        }
+
+        sem_post(p_msg->p_done);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Posts a message to the room's owner and waits for it to be handled.
+ *
+ * @param p_shard pointer to the worker.
+ * @param p_msg message to post.
+ * @return int the message's return value, or FAILURE (1).
+ */
+static int
+cr_shards_call (shard_t * p_shard, shard_msg_t * p_msg)
+{
+    sem_t done;
+
+    if (SUCCESS != sem_init(&done, 0, 0))
+    {
+        CR_LOG_ERRNO("cr_shards_call: sem_init");
+        return FAILURE;
+    }
+
+    p_msg->p_done = &done;
+    cr_shards_push(p_shard, p_msg);
+
+    while (SUCCESS != sem_wait(&done))
+    {
+        //NOTE: Only interrupted by signals, the worker always posts.
+    }
+
+    sem_destroy(&done);
+
+    return p_msg->return_val;
+}
+
+/**
+ * @brief Starts the room workers.
+ *
+ * @param count number of workers. Zero leaves the workers stopped and rooms
+ * are changed under room_mutex.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_start (uint8_t count)
+{
+    if ((0 == count) || (0 != shard_count))
+    {
+        return SUCCESS;
+    }
+
+    if (MAX_ROOM_SHARDS < count)
+    {
+        count = MAX_ROOM_SHARDS;
+    }
+
+    for (uint8_t idx = 0; idx < count; idx++)
+    {
+        shard_t * p_shard = &p_shards[idx];
+
+        p_shard->stub.p_next = NULL;
+        p_shard->p_head = &p_shard->stub;
+        p_shard->p_tail = &p_shard->stub;
+
+        if (SUCCESS != sem_init(&p_shard->ready, 0, 0))
+        {
+            CR_LOG_ERRNO("cr_shards_start: sem_init");
+            cr_shards_stop();
+            return FAILURE;
+        }
+
+        if (SUCCESS != pthread_create(&p_shard->thread, NULL,
+                                      cr_shards_thread, p_shard))
+        {
+            CR_LOG_ERRNO("cr_shards_start: pthread_create:");
+            sem_destroy(&p_shard->ready);
+            cr_shards_stop();
+            return FAILURE;
+        }
+
+        shard_count++;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Lets every worker finish the messages already posted, then stops
+ * them. Must be called after the sessions have stopped and before the rooms
+ * are freed.
+ */
+void
+cr_shards_stop ()
+{
+    for (uint8_t idx = 0; idx < shard_count; idx++)
+    {
+        shard_t * p_shard = &p_shards[idx];
+        shard_msg_t stop_msg = {.type = SHARD_STOP};
+
+        cr_shards_call(p_shard, &stop_msg);
+
+        if (SUCCESS != pthread_join(p_shard->thread, NULL))
+        {
+            CR_LOG_ERRNO("cr_shards_stop: pthread_join:");
+        }
+
+        sem_destroy(&p_shard->ready);
+    }
+
+    shard_count = 0;
+}
+
+/**
+ * @brief Returns whether rooms are owned by workers.
+ *
+ * @return int 1 if the workers are running, 0 if not.
+ */
+int
+cr_shards_on ()
+{
+    return (0 != shard_count);
+}
+
+/**
+ * @brief Has the room's owner add a user to the room, send the join
+ * acknowledge and history, and tell the other members. Waits until done.
+ *
+ * @param p_room pointer to the room.
+ * @param p_ssl_holder pointer to the joining client's SSL holder.
+ * @param p_user pointer to the joining user.
+ * @param since last chat sequence number the client holds for the room.
+ * @return int SUCCESS (0), FAILURE (1), or CONNECTION_FAILURE (2).
+ */
+int
+cr_shards_join (room_t * p_room, ssl_socket_holder_t * p_ssl_holder,
+                                   user_t * p_user, uint64_t since)
+{
+    if ((NULL == p_room) || (NULL == p_ssl_holder) || (NULL == p_user))
+    {
+        CR_LOG_ERROR("cr_shards_join: input NULL");
+        return FAILURE;
+    }
+
+    shard_msg_t join_msg = {
+        .type = SHARD_JOIN,
+        .p_room = p_room,
+        .p_user = p_user,
+        .p_ssl_holder = p_ssl_holder,
+        .since = since
+    };
+
+    return cr_shards_call(cr_shards_owner(p_room), &join_msg);
+}
+
+/**
+ * @brief Posts a chat to the room's owner, which logs it and sends it to the
+ * other members. Does not wait.
+ *
+ * @param p_room pointer to the room.
+ * @param p_user pointer to the sending user.
+ * @param p_chat chat text, at most MAX_CHAT_LEN characters are kept.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_chat (room_t * p_room, user_t * p_user, char * p_chat)
+{
+    if ((NULL == p_room) || (NULL == p_user) || (NULL == p_chat))
+    {
+        CR_LOG_ERROR("cr_shards_chat: input NULL");
+        return FAILURE;
+    }
+
+    shard_msg_t * p_msg = cr_alloc(sizeof(shard_msg_t));
+
+    if (NULL == p_msg)
+    {
+        CR_LOG_ERRNO("cr_shards_chat: p_msg cr_alloc");
+        return FAILURE;
+    }
+
+    p_msg->type = SHARD_CHAT;
+    p_msg->p_room = p_room;
+    p_msg->p_user = p_user;
+    p_msg->p_done = NULL;
+    strncpy(p_msg->p_chat, p_chat, MAX_CHAT_LEN);
+    p_msg->p_chat[MAX_CHAT_LEN] = '\0';
+
+    cr_shards_push(cr_shards_owner(p_room), p_msg);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Posts a chat from another cluster node to the room's owner, which
+ * logs it and sends it to every member. Does not wait.
+ *
+ * @param p_room pointer to the room.
+ * @param p_sender sender's interned username. The message takes over the
+ * caller's reference, the owner gives it back once the chat is handled; on
+ * failure it stays the caller's.
+ * @param p_chat chat text, at most MAX_CHAT_LEN characters are kept.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_chat_remote (room_t * p_room, const cr_name_t * p_sender,
+                                                  char * p_chat)
+{
+    if ((NULL == p_room) || (NULL == p_sender) || (NULL == p_chat))
+    {
+        CR_LOG_ERROR("cr_shards_chat_remote: input NULL");
+        return FAILURE;
+    }
+
+    shard_msg_t * p_msg = cr_alloc(sizeof(shard_msg_t));
+
+    if (NULL == p_msg)
+    {
+        CR_LOG_ERRNO("cr_shards_chat_remote: p_msg cr_alloc");
+        return FAILURE;
+    }
+
+    p_msg->type = SHARD_REMOTE;
+    p_msg->p_room = p_room;
+    p_msg->p_user = NULL;
+    p_msg->p_done = NULL;
+    p_msg->p_sender = p_sender;
+    strncpy(p_msg->p_chat, p_chat, MAX_CHAT_LEN);
+    p_msg->p_chat[MAX_CHAT_LEN] = '\0';
+
+    cr_shards_push(cr_shards_owner(p_room), p_msg);
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Has the room's owner remove a user from the room and tell the other
+ * members. Waits until done, so every chat the user posted before is handled
+ * first.
+ *
+ * @param p_room pointer to the room.
+ * @param p_user pointer to the leaving user.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_leave (room_t * p_room, user_t * p_user)
+{
+    if ((NULL == p_room) || (NULL == p_user))
+    {
+        CR_LOG_ERROR("cr_shards_leave: input NULL");
+        return FAILURE;
+    }
+
+    shard_msg_t leave_msg = {
+        .type = SHARD_LEAVE,
+        .p_room = p_room,
+        .p_user = p_user
+    };
+
+    return cr_shards_call(cr_shards_owner(p_room), &leave_msg);
+}
+
+/**
+ * @brief Has the room's owner put back a user handed over by the previous
+ * server process. Nothing is sent. Waits until done.
+ *
+ * @param p_room pointer to the room.
+ * @param p_user pointer to the user.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_rejoin (room_t * p_room, user_t * p_user)
+{
+    if ((NULL == p_room) || (NULL == p_user))
+    {
+        CR_LOG_ERROR("cr_shards_rejoin: input NULL");
+        return FAILURE;
+    }
+
+    shard_msg_t rejoin_msg = {
+        .type = SHARD_REJOIN,
+        .p_room = p_room,
+        .p_user = p_user
+    };
+
+    return cr_shards_call(cr_shards_owner(p_room), &rejoin_msg);
+}
+
+/**
+ * @brief Waits until the room's owner has handled everything posted to it so
+ * far.
+ *
+ * @param p_room pointer to the room.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_shards_barrier (room_t * p_room)
+{
+    if (NULL == p_room)
+    {
+        CR_LOG_ERROR("cr_shards_barrier: input NULL");
+        return FAILURE;
+    }
+
+    shard_msg_t barrier_msg = {.type = SHARD_BARRIER};
+
+    return cr_shards_call(cr_shards_owner(p_room), &barrier_msg);
+}
+
+/**
+ * @brief Waits until every worker has handled everything posted to it so
+ * far.
+ */
+void
+cr_shards_drain ()
+{
+    for (uint8_t idx = 0; idx < shard_count; idx++)
+    {
+        shard_msg_t barrier_msg = {.type = SHARD_BARRIER};
+
+        cr_shards_call(&p_shards[idx], &barrier_msg);
+    }
+}
+
+//End of cr_shards.c file
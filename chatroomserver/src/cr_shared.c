@@ -1,4 +1,5 @@
 #include "../include/cr_shared.h"
+#include "../include/cr_stats.h"
 
 /**
  * @brief Simple function to check if an int variable is a valid port number.
@@ -11,13 +12,13 @@ port_range_check (long * p_port)
 {
     if (NULL == p_port)
     {
-        fprintf(stderr, "set_config_members: input NULL.\n");
+        CR_LOG_ERROR("set_config_members: input NULL.");
         return FAILURE;
     }
     
     if ((0 == *p_port) || (65535 < *p_port))
     {
-        fprintf(stderr, "port_range_check: config port out of range.\n");
+        CR_LOG_ERROR("port_range_check: config port out of range.");
         return FAILURE;
     }
     
@@ -36,25 +37,45 @@ free_rooms (void * p_room_entry_holder)
 {
     if (NULL == p_room_entry_holder)
     {
-        fprintf(stderr, "free_rooms: input NULL\n");
+        CR_LOG_ERROR("free_rooms: input NULL");
         return;
     }
     
     room_t * p_room_entry = p_room_entry_holder;
 
-    if (FAILURE == cll_destroy(&p_room_entry->p_users, NULL))
+    if (SUCCESS != remove(p_room_entry->p_room_location))
     {
-        fprintf(stderr, "free_rooms: cll_destroy()\n");
+        CR_LOG_ERRNO("free_rooms: remove:");
     }
 
-    if (SUCCESS != pthread_mutex_destroy(&p_room_entry->room_mutex))
+    free_rooms_keep(p_room_entry);
+}
+
+/**
+ * @brief Same as free_rooms, but leaves the room's log on disk. Used after a
+ * hot restart handed the rooms to a new process.
+ * 
+ * @param p_room_entry_holder The input into this function is a pointer to an
+ * hash table entry that is type room_t (the pointer is void though).
+ */
+void
+free_rooms_keep (void * p_room_entry_holder)
+{
+    if (NULL == p_room_entry_holder)
     {
-        perror("free_rooms: pthread_mutex_destroy:");
+        CR_LOG_ERROR("free_rooms_keep: input NULL");
+        return;
     }
 
-    if (SUCCESS != remove(p_room_entry->p_room_location))
+    room_t * p_room_entry = p_room_entry_holder;
+
+    cr_stats_room_remove(p_room_entry);
+
+    //NOTE: The members are linked through their own users, so there is
+    //nothing to free for them here.
+    if (SUCCESS != pthread_mutex_destroy(&p_room_entry->room_mutex))
     {
-        perror("free_rooms: remove:");
+        CR_LOG_ERRNO("free_rooms_keep: pthread_mutex_destroy:");
     }
 
     FREE(p_room_entry);
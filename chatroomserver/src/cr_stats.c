@@ -0,0 +1,552 @@
+#include "../include/cr_stats.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+//NOTE: Counts for one second. A slot of the ring is reused when its second
+//comes round again, so a reader only adds the slots whose second is inside
+//the rate window.
+typedef struct {
+    uint64_t second;
+    uint64_t requests;
+    uint64_t chats;
+    uint64_t busy_ns;
+} stats_second_t;
+
+//NOTE: One per thread, written only by that thread. Blocks are pushed onto
+//p_threads_head with a compare and swap so the snapshot can walk the list
+//without a lock.
+typedef struct stats_thread {
+    uint64_t              requests;
+    uint64_t              chats;
+    uint64_t              bytes_in;
+    uint64_t              bytes_out;
+    stats_second_t        p_seconds[STATS_SECONDS];
+    struct stats_thread * p_next;
+} stats_thread_t;
+
+//NOTE: One per room. generation is odd while the slot is being given to or
+//taken from a room, so a reader that sees it change copies the slot again.
+//The counters are written with the room mutex held.
+typedef struct {
+    uint32_t generation;
+    int      in_use;
+    char     p_room_name[MAX_ROOM_NAME_LENGTH + 1];
+    uint32_t members;
+    uint64_t chats;
+    uint64_t p_second[STATS_SECONDS];
+    uint64_t p_chats[STATS_SECONDS];
+} stats_room_slot_t;
+
+static stats_thread_t * p_threads_head = NULL;
+static __thread stats_thread_t * p_local = NULL;
+static stats_room_slot_t p_room_slots[STATS_MAX_ROOMS];
+
+static volatile int running = STOP;
+static uint64_t start_second = 0;
+static uint8_t stats_pool_threads = 0;
+
+/**
+ * @brief Returns the current second of CLOCK_MONOTONIC_COARSE, which is
+ * cheap enough to read on every request.
+ *
+ * @return uint64_t current second.
+ */
+static inline uint64_t
+cr_stats_second ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+    return now.tv_sec;
+}
+
+/**
+ * @brief Adds to a value only one writer changes at a time.
+ *
+ * @param p_value pointer to the value.
+ * @param amount amount to add.
+ */
+static inline void
+cr_stats_add (uint64_t * p_value, uint64_t amount)
+{
+    __atomic_store_n(p_value, (__atomic_load_n(p_value, __ATOMIC_RELAXED) +
+                                              amount), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Returns the calling thread's block, creating it on first use.
+ *
+ * @return stats_thread_t* the block or NULL if recording is off or the
+ * allocation failed.
+ */
+static stats_thread_t *
+cr_stats_local ()
+{
+    if ((NULL != p_local) || (CONTINUE != running))
+    {
+        return p_local;
+    }
+
+    stats_thread_t * p_block = calloc(1, sizeof(stats_thread_t));
+
+    if (NULL == p_block)
+    {
+        CR_LOG_ERRNO("cr_stats_local: p_block calloc");
+        return NULL;
+    }
+
+    p_block->p_next = __atomic_load_n(&p_threads_head, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(&p_threads_head, &p_block->p_next,
+                       p_block, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+
+    p_local = p_block;
+
+    return p_local;
+}
+
+/**
+ * @brief Returns the calling thread's counts for the current second.
+ *
+ * @param p_block calling thread's block.
+ * @return stats_second_t* counts for this second.
+ */
+static stats_second_t *
+cr_stats_this_second (stats_thread_t * p_block)
+{
+    uint64_t second = cr_stats_second();
+    stats_second_t * p_second =
+        &p_block->p_seconds[second & (STATS_SECONDS - 1)];
+
+    if (second != p_second->second)
+    {
+        __atomic_store_n(&p_second->requests, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&p_second->chats, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&p_second->busy_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&p_second->second, second, __ATOMIC_RELEASE);
+    }
+
+    return p_second;
+}
+
+/**
+ * @brief Turns recording on and starts the uptime clock.
+ *
+ * @param pool_threads number of threads in the session pool.
+ */
+void
+cr_stats_start (uint8_t pool_threads)
+{
+    if (CONTINUE == running)
+    {
+        return;
+    }
+
+    start_second = cr_stats_second();
+    stats_pool_threads = pool_threads;
+    running = CONTINUE;
+}
+
+/**
+ * @brief Turns recording off and frees every thread's counters. Must be
+ * called after the threads recording stats have stopped.
+ */
+void
+cr_stats_stop ()
+{
+    if (CONTINUE != running)
+    {
+        return;
+    }
+
+    running = STOP;
+
+    stats_thread_t * p_block = __atomic_exchange_n(&p_threads_head, NULL,
+                                                         __ATOMIC_ACQ_REL);
+
+    while (NULL != p_block)
+    {
+        stats_thread_t * p_next = p_block->p_next;
+        FREE(p_block);
+        p_block = p_next;
+    }
+
+    p_local = NULL;
+}
+
+/**
+ * @brief Records a handled request and how long its dispatch took.
+ *
+ * @param elapsed_ns dispatch time in nanoseconds.
+ */
+void
+cr_stats_request (uint64_t elapsed_ns)
+{
+    stats_thread_t * p_block = cr_stats_local();
+
+    if (NULL == p_block)
+    {
+        return;
+    }
+
+    stats_second_t * p_second = cr_stats_this_second(p_block);
+
+    cr_stats_add(&p_block->requests, 1);
+    cr_stats_add(&p_second->requests, 1);
+    cr_stats_add(&p_second->busy_ns, elapsed_ns);
+}
+
+/**
+ * @brief Records bytes read from or written to a client.
+ *
+ * @param bytes_in bytes read.
+ * @param bytes_out bytes written.
+ */
+void
+cr_stats_bytes (uint64_t bytes_in, uint64_t bytes_out)
+{
+    stats_thread_t * p_block = cr_stats_local();
+
+    if (NULL == p_block)
+    {
+        return;
+    }
+
+    cr_stats_add(&p_block->bytes_in, bytes_in);
+    cr_stats_add(&p_block->bytes_out, bytes_out);
+}
+
+/**
+ * @brief Gives a new room a slot in the stats table. Must be called with
+ * the rooms mutex held.
+ *
+ * @param p_room pointer to the room, stats_slot is set.
+ */
+void
+cr_stats_room_add (room_t * p_room)
+{
+    if (NULL == p_room)
+    {
+        CR_LOG_ERROR("cr_stats_room_add: input NULL");
+        return;
+    }
+
+    p_room->stats_slot = -1;
+
+    for (int slot = 0; slot < STATS_MAX_ROOMS; slot++)
+    {
+        stats_room_slot_t * p_slot = &p_room_slots[slot];
+
+        if (p_slot->in_use)
+        {
+            continue;
+        }
+
+        __atomic_add_fetch(&p_slot->generation, 1, __ATOMIC_ACQ_REL);
+        memset(p_slot->p_room_name, 0, sizeof(p_slot->p_room_name));
+        memcpy(p_slot->p_room_name, p_room->p_name->p_bytes,
+                                    p_room->p_name->length);
+        p_slot->members = 0;
+        p_slot->chats = 0;
+        memset(p_slot->p_second, 0, sizeof(p_slot->p_second));
+        memset(p_slot->p_chats, 0, sizeof(p_slot->p_chats));
+        p_slot->in_use = 1;
+        __atomic_add_fetch(&p_slot->generation, 1, __ATOMIC_RELEASE);
+
+        p_room->stats_slot = slot;
+        return;
+    }
+}
+
+/**
+ * @brief Frees a room's slot. Must be called with the rooms mutex held or
+ * once every session has stopped.
+ *
+ * @param p_room pointer to the room.
+ */
+void
+cr_stats_room_remove (room_t * p_room)
+{
+    if ((NULL == p_room) || (0 > p_room->stats_slot) ||
+        (STATS_MAX_ROOMS <= p_room->stats_slot))
+    {
+        return;
+    }
+
+    stats_room_slot_t * p_slot = &p_room_slots[p_room->stats_slot];
+
+    __atomic_add_fetch(&p_slot->generation, 1, __ATOMIC_ACQ_REL);
+    p_slot->in_use = 0;
+    __atomic_add_fetch(&p_slot->generation, 1, __ATOMIC_RELEASE);
+
+    p_room->stats_slot = -1;
+}
+
+/**
+ * @brief Updates a room's member count from its user list. Must be called
+ * with the room mutex held.
+ *
+ * @param p_room pointer to the room.
+ */
+void
+cr_stats_room_members (room_t * p_room)
+{
+    if ((NULL == p_room) || (0 > p_room->stats_slot) ||
+        (STATS_MAX_ROOMS <= p_room->stats_slot))
+    {
+        return;
+    }
+
+    __atomic_store_n(&p_room_slots[p_room->stats_slot].members,
+                     p_room->members.size, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Counts a chat logged in a room. Must be called with the room mutex
+ * held.
+ *
+ * @param p_room pointer to the room.
+ */
+void
+cr_stats_room_chat (room_t * p_room)
+{
+    stats_thread_t * p_block = cr_stats_local();
+
+    if (NULL != p_block)
+    {
+        cr_stats_add(&p_block->chats, 1);
+        cr_stats_add(&cr_stats_this_second(p_block)->chats, 1);
+    }
+
+    if ((NULL == p_room) || (0 > p_room->stats_slot) ||
+        (STATS_MAX_ROOMS <= p_room->stats_slot))
+    {
+        return;
+    }
+
+    stats_room_slot_t * p_slot = &p_room_slots[p_room->stats_slot];
+    uint64_t second = cr_stats_second();
+    int index = second & (STATS_SECONDS - 1);
+
+    if (second != p_slot->p_second[index])
+    {
+        __atomic_store_n(&p_slot->p_chats[index], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&p_slot->p_second[index], second, __ATOMIC_RELEASE);
+    }
+
+    cr_stats_add(&p_slot->chats, 1);
+    cr_stats_add(&p_slot->p_chats[index], 1);
+}
+
+/**
+ * @brief Returns whether a second is inside the rate window: one of the
+ * STATS_RATE_WINDOW whole seconds before the current one.
+ *
+ * @param second second a count belongs to.
+ * @param now current second.
+ * @return int 1 if it is, 0 if not.
+ */
+static inline int
+cr_stats_in_window (uint64_t second, uint64_t now)
+{
+    return (second < now) && ((now - second) <= STATS_RATE_WINDOW);
+}
+
+/**
+ * @brief Orders rooms busiest first for qsort.
+ *
+ * @param p_first first stats_room_t, counts in host byte order.
+ * @param p_second second stats_room_t, counts in host byte order.
+ * @return int negative if the first room was busier.
+ */
+static int
+cr_stats_room_compare (const void * p_first, const void * p_second)
+{
+    const stats_room_t * p_a = p_first;
+    const stats_room_t * p_b = p_second;
+
+    if (p_a->chats_window != p_b->chats_window)
+    {
+        return (p_a->chats_window > p_b->chats_window) ? -1 : 1;
+    }
+
+    if (p_a->members != p_b->members)
+    {
+        return (p_a->members > p_b->members) ? -1 : 1;
+    }
+
+    return strncmp(p_a->p_room_name, p_b->p_room_name,
+                            (MAX_ROOM_NAME_LENGTH + 1));
+}
+
+/**
+ * @brief Copies the rooms in the stats table, busiest first.
+ *
+ * @param p_rooms array of STATS_MAX_ROOMS entries, counts left in host byte
+ * order.
+ * @param now current second.
+ * @return uint8_t number of rooms copied.
+ */
+static uint8_t
+cr_stats_rooms (stats_room_t * p_rooms, uint64_t now)
+{
+    uint8_t count = 0;
+
+    for (int slot = 0; slot < STATS_MAX_ROOMS; slot++)
+    {
+        stats_room_slot_t * p_slot = &p_room_slots[slot];
+        stats_room_t room;
+
+        //NOTE: A slot changing hands twice while it is copied is not worth
+        //more than a few retries; it is left out of this snapshot.
+        for (int attempt = 0; attempt < 4; attempt++)
+        {
+            uint32_t generation = __atomic_load_n(&p_slot->generation,
+                                                  __ATOMIC_ACQUIRE);
+
+            if ((generation & 1) ||
+                !__atomic_load_n(&p_slot->in_use, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+
+            memset(&room, 0, sizeof(room));
+            memcpy(room.p_room_name, p_slot->p_room_name,
+                                     sizeof(room.p_room_name));
+            room.p_room_name[MAX_ROOM_NAME_LENGTH] = '\0';
+            room.members = __atomic_load_n(&p_slot->members,
+                                           __ATOMIC_RELAXED);
+            room.chats_total = __atomic_load_n(&p_slot->chats,
+                                               __ATOMIC_RELAXED);
+
+            for (int index = 0; index < STATS_SECONDS; index++)
+            {
+                if (cr_stats_in_window(__atomic_load_n(
+                    &p_slot->p_second[index], __ATOMIC_ACQUIRE), now))
+                {
+                    room.chats_window += __atomic_load_n(
+                                 &p_slot->p_chats[index], __ATOMIC_RELAXED);
+                }
+            }
+
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if (generation == __atomic_load_n(&p_slot->generation,
+                                              __ATOMIC_RELAXED))
+            {
+                p_rooms[count++] = room;
+                break;
+            }
+        }
+    }
+
+    qsort(p_rooms, count, sizeof(stats_room_t), cr_stats_room_compare);
+
+    return count;
+}
+
+/**
+ * @brief Builds a stats acknowledge packet: the fixed stats_ack_t followed
+ * by one stats_room_t per room, busiest first.
+ *
+ * @param p_users pointer to users_t struct, read for the logged in count.
+ * @param p_packet buffer of at least STATS_PACKET_SIZE bytes.
+ * @return size_t length of the packet.
+ */
+size_t
+cr_stats_snapshot (users_t * p_users, char * p_packet)
+{
+    if (NULL == p_packet)
+    {
+        CR_LOG_ERROR("cr_stats_snapshot: input NULL");
+        return 0;
+    }
+
+    uint64_t now = cr_stats_second();
+    uint64_t requests = 0;
+    uint64_t chats = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t requests_window = 0;
+    uint64_t chats_window = 0;
+    uint64_t busy_ns = 0;
+
+    for (stats_thread_t * p_block = __atomic_load_n(&p_threads_head,
+                                                    __ATOMIC_ACQUIRE);
+         NULL != p_block; p_block = p_block->p_next)
+    {
+        requests += __atomic_load_n(&p_block->requests, __ATOMIC_RELAXED);
+        chats += __atomic_load_n(&p_block->chats, __ATOMIC_RELAXED);
+        bytes_in += __atomic_load_n(&p_block->bytes_in, __ATOMIC_RELAXED);
+        bytes_out += __atomic_load_n(&p_block->bytes_out, __ATOMIC_RELAXED);
+
+        for (int index = 0; index < STATS_SECONDS; index++)
+        {
+            stats_second_t * p_second = &p_block->p_seconds[index];
+
+            if (!cr_stats_in_window(__atomic_load_n(&p_second->second,
+                                              __ATOMIC_ACQUIRE), now))
+            {
+                continue;
+            }
+
+            requests_window += __atomic_load_n(&p_second->requests,
+                                               __ATOMIC_RELAXED);
+            chats_window += __atomic_load_n(&p_second->chats,
+                                            __ATOMIC_RELAXED);
+            busy_ns += __atomic_load_n(&p_second->busy_ns, __ATOMIC_RELAXED);
+        }
+    }
+
+    uint64_t pool_ns = (uint64_t) stats_pool_threads * STATS_RATE_WINDOW *
+                                                             1000000000ULL;
+    uint64_t permille = (0 == pool_ns) ? 0 : ((busy_ns * 1000) / pool_ns);
+    int64_t sessions = cr_metrics_gauge(METRIC_SESSIONS);
+    int64_t waiting = cr_metrics_gauge(METRIC_SESSIONS_WAITING);
+    int64_t pending = cr_metrics_gauge(METRIC_FLUSH_PENDING);
+
+    stats_room_t p_rooms[STATS_MAX_ROOMS];
+    uint8_t room_count = cr_stats_rooms(p_rooms, now);
+
+    stats_ack_t * p_stats = (stats_ack_t *) p_packet;
+    memset(p_stats, 0, sizeof(stats_ack_t));
+
+    p_stats->type = SESSION_TYPE;
+    p_stats->s_type = STATS_STYPE;
+    p_stats->opcode = ACKNOWLEDGE;
+    p_stats->uptime_s = htonl((CONTINUE == running) ?
+                              (uint32_t) (now - start_second) : 0);
+    p_stats->sessions = htons((0 < sessions) ? sessions : 0);
+    p_stats->sessions_waiting = htons((0 < waiting) ? waiting : 0);
+    p_stats->flush_pending = htons((0 < pending) ? pending : 0);
+    p_stats->pool_threads = htons(stats_pool_threads);
+    p_stats->dispatch_permille = htons((1000 < permille) ? 1000 : permille);
+    p_stats->users_logged_in = htons((NULL == p_users) ? 0 :
+                    __atomic_load_n(&p_users->client_count, __ATOMIC_RELAXED));
+    p_stats->rate_window_s = STATS_RATE_WINDOW;
+    p_stats->requests_window = htonl(requests_window);
+    p_stats->chats_window = htonl(chats_window);
+    p_stats->requests_total = htobe64(requests);
+    p_stats->chats_total = htobe64(chats);
+    p_stats->bytes_in = htobe64(bytes_in);
+    p_stats->bytes_out = htobe64(bytes_out);
+    p_stats->room_count = room_count;
+
+    stats_room_t * p_entries = (stats_room_t *) (p_packet +
+                                                 sizeof(stats_ack_t));
+
+    for (uint8_t index = 0; index < room_count; index++)
+    {
+        p_entries[index] = p_rooms[index];
+        p_entries[index].members = htons(p_rooms[index].members);
+        p_entries[index].chats_window = htonl(p_rooms[index].chats_window);
+        p_entries[index].chats_total = htobe64(p_rooms[index].chats_total);
+    }
+
+    return sizeof(stats_ack_t) + (room_count * sizeof(stats_room_t));
+}
+
+//End of cr_stats.c file
@@ -0,0 +1,552 @@
+#include "../include/cr_trace.h"
+#include "../include/cr_shared.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+//NOTE: Every thread writes only its own ring, so recording an event is a
+//clock read and a few stores. head is published with a release store after
+//the event so a dump sees whole events everywhere but possibly the newest.
+//Rings are pushed onto p_rings_head with a compare and swap so the crash
+//handler can walk the list without taking a lock.
+typedef struct cr_trace_ring {
+    uint64_t               head;
+    uint32_t               tid;
+    cr_trace_event_t       p_events[TRACE_RING_EVENTS];
+    struct cr_trace_ring * p_next;
+} cr_trace_ring_t;
+
+//Crash signals the recorder dumps on before the default action runs.
+static const int p_crash_signals[] = {
+    SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT
+};
+#define TRACE_CRASH_SIGNALS (sizeof(p_crash_signals) / sizeof(int))
+
+static cr_trace_ring_t * p_rings_head = NULL;
+static __thread cr_trace_ring_t * p_local = NULL;
+static cr_trace_site_t * pp_sites[TRACE_MAX_SITES] = {0};
+static uint16_t site_count = 1; //NOTE: Id 0 means no site.
+
+static pthread_t trace_thread;
+static volatile int running = STOP;
+static char p_crash_file[FILE_NAME_MAX_LEN] = {0};
+static uint64_t start_ticks = 0;
+static uint64_t start_ns = 0;
+
+/**
+ * @brief Returns CLOCK_MONOTONIC in nanoseconds. Async-signal-safe.
+ *
+ * @return uint64_t current time.
+ */
+static uint64_t
+cr_trace_now ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @brief Returns the time stamp for an event: the time stamp counter on x86,
+ * CLOCK_MONOTONIC nanoseconds elsewhere.
+ *
+ * @return uint64_t current ticks.
+ */
+static inline uint64_t
+cr_trace_ticks ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return cr_trace_now();
+#endif
+}
+
+/**
+ * @brief Returns the calling thread's ring, creating it on first use.
+ *
+ * @return cr_trace_ring_t* the ring or NULL if the recorder is off or the
+ * allocation failed.
+ */
+static cr_trace_ring_t *
+cr_trace_local ()
+{
+    if ((NULL != p_local) || (CONTINUE != running))
+    {
+        return p_local;
+    }
+
+    cr_trace_ring_t * p_ring = calloc(1, sizeof(cr_trace_ring_t));
+
+    if (NULL == p_ring)
+    {
+        CR_LOG_ERRNO("cr_trace_local: p_ring calloc");
+        return NULL;
+    }
+
+    p_ring->tid = syscall(SYS_gettid);
+    p_ring->p_next = __atomic_load_n(&p_rings_head, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(&p_rings_head, &p_ring->p_next,
+                       p_ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+
+    p_local = p_ring;
+
+    return p_local;
+}
+
+/**
+ * @brief Records an event in the calling thread's ring. Does nothing while
+ * the recorder is off.
+ *
+ * @param event event (TRACE_PACKET_RECEIVED ...).
+ * @param site site id from cr_trace_site or 0.
+ * @param arg event argument.
+ */
+void
+cr_trace_record (uint8_t event, uint16_t site, uint32_t arg)
+{
+    cr_trace_ring_t * p_ring = cr_trace_local();
+
+    if (NULL == p_ring)
+    {
+        return;
+    }
+
+    uint64_t head = p_ring->head;
+    cr_trace_event_t * p_event =
+        &p_ring->p_events[head & (TRACE_RING_EVENTS - 1)];
+
+    p_event->ticks = cr_trace_ticks();
+    p_event->event = event;
+    p_event->site = site;
+    p_event->arg = arg;
+
+    __atomic_store_n(&p_ring->head, (head + 1), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Returns a site's id, giving it one on first use.
+ *
+ * @param p_site site to look up.
+ * @return uint16_t site id, 0 if the site table is full.
+ */
+uint16_t
+cr_trace_site (cr_trace_site_t * p_site)
+{
+    if (NULL == p_site)
+    {
+        return 0;
+    }
+
+    if (2 == __atomic_load_n(&p_site->registered, __ATOMIC_ACQUIRE))
+    {
+        return p_site->id;
+    }
+
+    //NOTE: registered goes 0 (new), 1 (being given an id), 2 (done). A
+    //thread that loses the race records this event without a site.
+    int expected = 0;
+
+    if (!__atomic_compare_exchange_n(&p_site->registered, &expected, 1, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+    {
+        return 0;
+    }
+
+    uint16_t id = __atomic_fetch_add(&site_count, 1, __ATOMIC_RELAXED);
+
+    if (TRACE_MAX_SITES <= id)
+    {
+        id = 0;
+    }
+    else
+    {
+        __atomic_store_n(&pp_sites[id], p_site, __ATOMIC_RELEASE);
+    }
+
+    p_site->id = id;
+    __atomic_store_n(&p_site->registered, 2, __ATOMIC_RELEASE);
+
+    return id;
+}
+
+/**
+ * @brief Locks a mutex, recording the wait and the acquisition. Used
+ * through CR_MUTEX_LOCK.
+ *
+ * @param p_site lock call site.
+ * @param p_mutex mutex to lock.
+ * @return int result of pthread_mutex_lock.
+ */
+int
+cr_trace_lock (cr_trace_site_t * p_site, pthread_mutex_t * p_mutex)
+{
+    if (CONTINUE != running)
+    {
+        return pthread_mutex_lock(p_mutex);
+    }
+
+    uint16_t site = cr_trace_site(p_site);
+    uint32_t mutex = (uint32_t) (uintptr_t) p_mutex;
+
+    //NOTE: A wait is only recorded when the mutex is already held, so an
+    //uncontended lock costs two events.
+    int status = pthread_mutex_trylock(p_mutex);
+
+    if (EBUSY == status)
+    {
+        cr_trace_record(TRACE_LOCK_WAIT, site, mutex);
+        status = pthread_mutex_lock(p_mutex);
+    }
+
+    if (SUCCESS == status)
+    {
+        cr_trace_record(TRACE_LOCK_ACQUIRED, site, mutex);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Unlocks a mutex, recording the release. Used through
+ * CR_MUTEX_UNLOCK.
+ *
+ * @param p_mutex mutex to unlock.
+ * @return int result of pthread_mutex_unlock.
+ */
+int
+cr_trace_unlock (pthread_mutex_t * p_mutex)
+{
+    cr_trace_record(TRACE_LOCK_RELEASED, 0, (uint32_t) (uintptr_t) p_mutex);
+
+    return pthread_mutex_unlock(p_mutex);
+}
+
+/**
+ * @brief Writes a whole buffer, retrying short writes. Async-signal-safe.
+ *
+ * @param fd file descriptor to write to.
+ * @param p_buffer bytes to write.
+ * @param length number of bytes.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+cr_trace_write (int fd, const void * p_buffer, size_t length)
+{
+    const char * p_bytes = p_buffer;
+
+    while (0 < length)
+    {
+        ssize_t written = write(fd, p_bytes, length);
+
+        if (0 > written)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            return FAILURE;
+        }
+
+        p_bytes += written;
+        length -= written;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Returns the length of a string. Async-signal-safe.
+ *
+ * @param p_string string to measure.
+ * @return uint16_t length, capped at UINT16_MAX.
+ */
+static uint16_t
+cr_trace_strlen (const char * p_string)
+{
+    uint16_t length = 0;
+
+    while ((UINT16_MAX > length) && ('\0' != p_string[length]))
+    {
+        length++;
+    }
+
+    return length;
+}
+
+/**
+ * @brief Writes every ring to a file descriptor. Only uses
+ * async-signal-safe calls, so it can run in a crash handler. Rings still
+ * being written may hold a torn newest event.
+ *
+ * @param fd file descriptor to write to.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_trace_dump (int fd)
+{
+    uint16_t sites = __atomic_load_n(&site_count, __ATOMIC_ACQUIRE);
+    cr_trace_header_t header = {
+        .pid = getpid(),
+        .ring_events = TRACE_RING_EVENTS,
+        .site_count = 0,
+        .start_ticks = start_ticks,
+        .start_ns = start_ns,
+        .dump_ticks = cr_trace_ticks(),
+        .dump_ns = cr_trace_now()
+    };
+
+    if (TRACE_MAX_SITES < sites)
+    {
+        sites = TRACE_MAX_SITES;
+    }
+
+    //NOTE: A site still being given an id is left out; the decoder names
+    //its events by id.
+    for (uint16_t id = 1; id < sites; id++)
+    {
+        if (NULL != __atomic_load_n(&pp_sites[id], __ATOMIC_ACQUIRE))
+        {
+            header.site_count++;
+        }
+    }
+
+    memcpy(header.p_magic, TRACE_MAGIC, TRACE_MAGIC_LENGTH);
+
+    if (SUCCESS != cr_trace_write(fd, &header, sizeof(header)))
+    {
+        return FAILURE;
+    }
+
+    uint32_t written_sites = 0;
+
+    for (uint16_t id = 1; (id < sites) &&
+                          (written_sites < header.site_count); id++)
+    {
+        cr_trace_site_t * p_site = __atomic_load_n(&pp_sites[id],
+                                                   __ATOMIC_ACQUIRE);
+
+        if (NULL == p_site)
+        {
+            continue;
+        }
+
+        cr_trace_site_record_t record = {
+            .id = id,
+            .line = p_site->line,
+            .name_len = cr_trace_strlen(p_site->p_name),
+            .function_len = cr_trace_strlen(p_site->p_function)
+        };
+
+        if ((SUCCESS != cr_trace_write(fd, &record, sizeof(record))) ||
+            (SUCCESS != cr_trace_write(fd, p_site->p_name,
+                                               record.name_len)) ||
+            (SUCCESS != cr_trace_write(fd, p_site->p_function,
+                                           record.function_len)))
+        {
+            return FAILURE;
+        }
+
+        written_sites++;
+    }
+
+    for (cr_trace_ring_t * p_ring = __atomic_load_n(&p_rings_head,
+                                                    __ATOMIC_ACQUIRE);
+         NULL != p_ring; p_ring = p_ring->p_next)
+    {
+        cr_trace_ring_record_t record = {
+            .tid = p_ring->tid,
+            .head = __atomic_load_n(&p_ring->head, __ATOMIC_ACQUIRE)
+        };
+
+        if ((SUCCESS != cr_trace_write(fd, &record, sizeof(record))) ||
+            (SUCCESS != cr_trace_write(fd, p_ring->p_events,
+                                       sizeof(p_ring->p_events))))
+        {
+            return FAILURE;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Dumps the rings when the server crashes, then lets the signal's
+ * default action end the process.
+ *
+ * @param signum crash signal received.
+ */
+static void
+cr_trace_crash_handler (int signum)
+{
+    int fd = open(p_crash_file, (O_WRONLY | O_CREAT | O_TRUNC), 0600);
+
+    if (0 <= fd)
+    {
+        cr_trace_dump(fd);
+        close(fd);
+    }
+
+    //NOTE: The handler was reset to the default when it ran.
+    raise(signum);
+}
+
+/**
+ * @brief Dump thread. Writes the rings to a new file each time SIGUSR2
+ * arrives until stopped.
+ *
+ * @param p_arg unused, required by pthread_create.
+ * @return void* NULL.
+ */
+static void *
+cr_trace_thread (void * p_arg)
+{
+    (void) p_arg;
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR2);
+
+    //NOTE: The timeout lets the thread see the stop flag.
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = 500000000L};
+    int dumps = 0;
+
+    while (CONTINUE == running)
+    {
+        if (SIGUSR2 != sigtimedwait(&signals, NULL, &timeout))
+        {
+            continue;
+        }
+
+        char p_file[FILE_NAME_MAX_LEN] = {0};
+        snprintf(p_file, FILE_NAME_MAX_LEN, "cr_trace_%d_%d.bin",
+                                          (int) getpid(), dumps++);
+
+        int fd = open(p_file, (O_WRONLY | O_CREAT | O_TRUNC), 0600);
+
+        if (0 > fd)
+        {
+            CR_LOG_ERRNO("cr_trace_thread: open:");
+            continue;
+        }
+
+        if (SUCCESS != cr_trace_dump(fd))
+        {
+            CR_LOG_ERRNO("cr_trace_thread: cr_trace_dump:");
+        }
+        else
+        {
+            CR_LOG_INFO("cr_trace: wrote %s", p_file);
+        }
+
+        close(fd);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Turns the flight recorder on. Installs the crash handlers and
+ * starts the thread that dumps on SIGUSR2. Blocks SIGUSR2 in the calling
+ * thread, so it must be called before any other thread is created.
+ *
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_trace_start ()
+{
+    if (CONTINUE == running)
+    {
+        return SUCCESS;
+    }
+
+    snprintf(p_crash_file, FILE_NAME_MAX_LEN, "cr_trace_%d_crash.bin",
+                                                       (int) getpid());
+    start_ticks = cr_trace_ticks();
+    start_ns = cr_trace_now();
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR2);
+
+    if (SUCCESS != pthread_sigmask(SIG_BLOCK, &signals, NULL))
+    {
+        CR_LOG_ERRNO("cr_trace_start: pthread_sigmask:");
+        return FAILURE;
+    }
+
+    struct sigaction crash_action = {0};
+    crash_action.sa_handler = cr_trace_crash_handler;
+    crash_action.sa_flags = (SA_RESETHAND | SA_NODEFER);
+    sigemptyset(&crash_action.sa_mask);
+
+    for (size_t idx = 0; idx < TRACE_CRASH_SIGNALS; idx++)
+    {
+        sigaction(p_crash_signals[idx], &crash_action, NULL);
+    }
+
+    running = CONTINUE;
+
+    if (SUCCESS != pthread_create(&trace_thread, NULL, cr_trace_thread,
+                                                                  NULL))
+    {
+        CR_LOG_ERRNO("cr_trace_start: pthread_create:");
+        running = STOP;
+
+        for (size_t idx = 0; idx < TRACE_CRASH_SIGNALS; idx++)
+        {
+            signal(p_crash_signals[idx], SIG_DFL);
+        }
+
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Turns the flight recorder off, restores the crash handlers, and
+ * frees every thread's ring. Must be called after the threads recording
+ * events have stopped.
+ */
+void
+cr_trace_stop ()
+{
+    if (CONTINUE != running)
+    {
+        return;
+    }
+
+    running = STOP;
+
+    for (size_t idx = 0; idx < TRACE_CRASH_SIGNALS; idx++)
+    {
+        signal(p_crash_signals[idx], SIG_DFL);
+    }
+
+    if (SUCCESS != pthread_join(trace_thread, NULL))
+    {
+        CR_LOG_ERRNO("cr_trace_stop: pthread_join:");
+    }
+
+    cr_trace_ring_t * p_ring = __atomic_exchange_n(&p_rings_head, NULL,
+                                                         __ATOMIC_ACQ_REL);
+
+    while (NULL != p_ring)
+    {
+        cr_trace_ring_t * p_next = p_ring->p_next;
+        FREE(p_ring);
+        p_ring = p_next;
+    }
+
+    p_local = NULL;
+}
+
+//End of cr_trace.c file
@@ -14,11 +14,12 @@ cr_users_from_buf (user_t * p_user, char * p_buffer)
 {
     if ((NULL == p_user) || (NULL == p_buffer))
     {
-        fprintf(stderr, "cr_users_add_file_user: input NULL\n");
+        CR_LOG_ERROR("cr_users_add_file_user: input NULL");
         return FAILURE;
     }
 
-    char * copy_to = p_user->p_username;
+    char p_username[MAX_USERNAME_LENGTH + 1] = {0};
+    char * copy_to = p_username;
     int counter = 0;
     int offset = 0;
 
@@ -26,8 +27,8 @@ cr_users_from_buf (user_t * p_user, char * p_buffer)
     {
         if (MAX_USERNAME_LENGTH < counter)
         {
-            fprintf(stderr, "cr_users_from_buf: username or password too "
-                                                                "long\n");
+            CR_LOG_ERROR("cr_users_from_buf: username or password too "
+                                                                "long");
             return FAILURE;
         }
 
@@ -71,12 +72,20 @@ cr_users_from_buf (user_t * p_user, char * p_buffer)
         }
         else
         {
-            fprintf(stderr, "cr_users_from_buf: invalid characters in "
-                                                        "users.txt\n");
+            CR_LOG_ERROR("cr_users_from_buf: invalid characters in "
+                                                        "users.txt");
             return FAILURE;
         }
     }
 
+    p_user->p_name = cr_names_intern(p_username, sizeof(p_username));
+
+    if (NULL == p_user->p_name)
+    {
+        CR_LOG_ERROR("cr_users_from_buf: cr_names_intern()");
+        return FAILURE;
+    }
+
     return SUCCESS;
 }
 
@@ -97,7 +106,7 @@ cr_users_add_file_user (users_t * p_users, char * p_buffer)
 {
     if ((NULL == p_users) || (NULL == p_buffer))
     {
-        fprintf(stderr, "cr_users_add_file_user: input NULL\n");
+        CR_LOG_ERROR("cr_users_add_file_user: input NULL");
         return FAILURE;
     }
 
@@ -106,11 +115,11 @@ cr_users_add_file_user (users_t * p_users, char * p_buffer)
         return USERS_FULL;
     }
 
-    user_t * p_user = calloc(1, sizeof(user_t));
+    user_t * p_user = cr_alloc_aligned(sizeof(user_t));
 
     if (NULL == p_user)
     {
-        perror("cr_users_add_file_user: p_user calloc");
+        CR_LOG_ERRNO("cr_users_add_file_user: p_user cr_alloc_aligned()");
         return FAILURE;
     }
 
@@ -118,20 +127,20 @@ cr_users_add_file_user (users_t * p_users, char * p_buffer)
 
     if (FAILURE == cr_users_from_buf(p_user, p_buffer))
     {
-        fprintf(stderr, "cr_users_add_file_user: cr_users_from_buf()\n");
+        CR_LOG_ERROR("cr_users_add_file_user: cr_users_from_buf()");
         FREE(p_user);
         return FAILURE;
     }
 
     if (NULL != h_table_return_entry(p_users->p_users_table,
-                                        p_user->p_username))
+                                        p_user->p_name->p_bytes))
     {
+        cr_names_release(p_user->p_name);
         FREE(p_user);
         return USER_PRESENT;
     }
 
-    if (SUCCESS == strncmp(p_user->p_username, "admin", strlen(
-                                          p_user->p_username)))
+    if (p_user->p_name == cr_names_find("admin", MAX_NAME_LENGTH))
     {
         p_user->admin_status = ADMIN;
     }
@@ -141,9 +150,10 @@ cr_users_add_file_user (users_t * p_users, char * p_buffer)
     }
 
     if (FAILURE == h_table_new_entry(p_users->p_users_table, p_user,
-                                                p_user->p_username))
+                                                p_user->p_name->p_bytes))
     {
-        fprintf(stderr, "cr_users_add_file_user: h_table_new_entry()\n");
+        CR_LOG_ERROR("cr_users_add_file_user: h_table_new_entry()");
+        cr_names_release(p_user->p_name);
         FREE(p_user);
         return FAILURE;
     }
@@ -170,7 +180,7 @@ cr_users_start (users_t * p_users)
 
     if (NULL == file_pointer)
     {
-        perror("cr_users_start: fopen");
+        CR_LOG_ERRNO("cr_users_start: fopen");
         return FAILURE;
     }
 
@@ -179,6 +189,13 @@ cr_users_start (users_t * p_users)
 
     while (fgets(p_buffer, BUFF_SIZE, file_pointer) != NULL)
     {
+        //NOTE: A blank line holds no user, and an empty name can not be
+        //interned.
+        if ('\n' == p_buffer[0])
+        {
+            continue;
+        }
+
         int result = cr_users_add_file_user(p_users, p_buffer);
 
         if (USERS_FULL == result)
@@ -188,7 +205,7 @@ cr_users_start (users_t * p_users)
 
         if (FAILURE == result)
         {
-            fprintf(stderr, "cr_users_start: cr_users_add_file_user()\n");
+            CR_LOG_ERROR("cr_users_start: cr_users_add_file_user()");
             fclose(file_pointer);
             return FAILURE;
         }
@@ -218,7 +235,7 @@ cr_users_chk_str_chars (char * p_string)
 {
     if (NULL == p_string)
     {
-        fprintf(stderr, "cr_users_chk_str_chars: input NULL\n");
+        CR_LOG_ERROR("cr_users_chk_str_chars: input NULL");
     }
 
     int str_len = strnlen(p_string, MAX_USERNAME_LENGTH);
@@ -274,7 +291,7 @@ cr_users_chk_usr_and_pass (char * p_username, char * p_password,
 {
     if ((NULL == p_username) || (NULL == p_password))
     {
-        fprintf(stderr, "cr_users_chk_usr_and_pass: input NULL\n");
+        CR_LOG_ERROR("cr_users_chk_usr_and_pass: input NULL");
         return FAILURE;
     }
 
@@ -325,7 +342,7 @@ cr_users_add_user_file (users_t * p_users, char * p_userpass)
 {
     if ((NULL == p_users) || (NULL == p_userpass))
     {
-        fprintf(stderr, "cr_users_add_user_file: input NULL\n");
+        CR_LOG_ERROR("cr_users_add_user_file: input NULL");
         return FAILURE;
     }
 
@@ -335,25 +352,25 @@ cr_users_add_user_file (users_t * p_users, char * p_userpass)
 
     if (NULL == file_pointer)
     {
-        perror("cr_users_add_user_file: fopen");
+        CR_LOG_ERRNO("cr_users_add_user_file: fopen");
         return FAILURE;
     }
 
     if (EOF == fputc('\n', file_pointer))
     {
-        perror("cr_users_add_user_file: fputc");
+        CR_LOG_ERRNO("cr_users_add_user_file: fputc");
         return FAILURE;
     }
 
     if (EOF == fputs(p_userpass, file_pointer))
     {
-        perror("cr_users_add_user_file: fputs");
+        CR_LOG_ERRNO("cr_users_add_user_file: fputs");
         return FAILURE;
     }
 
     if (EOF == fclose(file_pointer))
     {
-        perror("cr_users_add_user_file: fclose");
+        CR_LOG_ERRNO("cr_users_add_user_file: fclose");
         return FAILURE;
     }
 
@@ -374,25 +391,35 @@ cr_users_add_user_table (users_t * p_users, char * p_username,
 {
     if ((NULL == p_users) || (NULL == p_username) || (NULL == p_password))
     {
-        fprintf(stderr, "cr_users_add_user_table: input NULL\n");
+        CR_LOG_ERROR("cr_users_add_user_table: input NULL");
         return FAILURE;
     }
 
-    user_t * p_user = calloc(1, sizeof(user_t));
+    user_t * p_user = cr_alloc_aligned(sizeof(user_t));
 
     if (NULL == p_user)
     {
-        perror("cr_users_add_user_table: calloc");
+        CR_LOG_ERRNO("cr_users_add_user_table: cr_alloc_aligned()");
+        return FAILURE;
+    }
+
+    p_user->p_name = cr_names_intern(p_username, MAX_USERNAME_LENGTH);
+
+    if (NULL == p_user->p_name)
+    {
+        CR_LOG_ERROR("cr_users_add_user_table: cr_names_intern()");
+        FREE(p_user);
         return FAILURE;
     }
 
-    strncpy(p_user->p_username, p_username, strlen(p_username));
     strncpy(p_user->p_password, p_password, strlen(p_password));
 
     if (FAILURE == h_table_new_entry(p_users->p_users_table, p_user,
-                                                p_user->p_username))
+                                                p_user->p_name->p_bytes))
     {
-        fprintf(stderr, "cr_users_add_user_table: h_table_new_entry()\n");
+        CR_LOG_ERROR("cr_users_add_user_table: h_table_new_entry()");
+        cr_names_release(p_user->p_name);
+        FREE(p_user);
         return FAILURE;
     }
 
@@ -414,7 +441,7 @@ cr_users_reg_helper (users_t * p_users, SSL * p_ssl, register_req_t register_req
 {
     if (NULL == p_users)
     {
-        fprintf(stderr, "cr_users_reg_helper: input NULL\n");
+        CR_LOG_ERROR("cr_users_reg_helper: input NULL");
         return FAILURE;
     }
 
@@ -426,9 +453,9 @@ cr_users_reg_helper (users_t * p_users, SSL * p_ssl, register_req_t register_req
     int add_return_1 = SUCCESS;
     int add_return_2 = SUCCESS;
 
-    if (SUCCESS != pthread_mutex_lock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_reg_helper: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_users_reg_helper: pthread_mutex_lock:");
         return FAILURE;
     }
 
@@ -437,18 +464,18 @@ cr_users_reg_helper (users_t * p_users, SSL * p_ssl, register_req_t register_req
 
     add_return_2 = cr_users_add_user_file(p_users, p_userpass);
 
-    if (SUCCESS != pthread_mutex_unlock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_reg_helper: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_users_reg_helper: pthread_mutex_unlock:");
 
         if (FAILURE == add_return_2)
         {
-            fprintf(stderr, "cr_users_reg_helper: cr_users_add_user_file()\n");
+            CR_LOG_ERROR("cr_users_reg_helper: cr_users_add_user_file()");
         }
         else if (FAILURE == add_return_1)
         {
-            fprintf(stderr, "cr_users_reg_helper: "
-                         "cr_users_add_user_table()\n");
+            CR_LOG_ERROR("cr_users_reg_helper: "
+                         "cr_users_add_user_table()");
         }
 
         return FAILURE;
@@ -456,20 +483,22 @@ cr_users_reg_helper (users_t * p_users, SSL * p_ssl, register_req_t register_req
 
     if (FAILURE == add_return_2)
     {
-        fprintf(stderr, "cr_users_reg_helper: cr_users_add_user_file()\n");
+        CR_LOG_ERROR("cr_users_reg_helper: cr_users_add_user_file()");
         return FAILURE;
     }
     else if (FAILURE == add_return_1)
     {
-        fprintf(stderr, "cr_users_reg_helper: cr_users_add_user_table()\n");
+        CR_LOG_ERROR("cr_users_reg_helper: cr_users_add_user_table()");
         return FAILURE;
     }
 
+    cr_cluster_user_add(register_req.p_username, register_req.p_password);
+
     int return_val = cr_msg_send_ack(p_ssl, ACCOUNT_TYPE, REGISTER_STYPE);
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_users_reg_helper: cr_msg_send_ack()\n");
+        CR_LOG_ERROR("cr_users_reg_helper: cr_msg_send_ack()");
         return return_val;
     }
 
@@ -491,7 +520,7 @@ cr_users_register (users_t * p_users, SSL * p_ssl, char * p_buffer)
 {
     if ((NULL == p_users) || (NULL == p_buffer))
     {
-        fprintf(stderr, "cr_users_register: input NULL\n");
+        CR_LOG_ERROR("cr_users_register: input NULL");
         return FAILURE;
     }
 
@@ -503,9 +532,9 @@ cr_users_register (users_t * p_users, SSL * p_ssl, char * p_buffer)
 
     int return_val = SUCCESS;
 
-    if (SUCCESS != pthread_mutex_lock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_register: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_users_register: pthread_mutex_lock:");
         return FAILURE;
     }
 
@@ -514,9 +543,9 @@ cr_users_register (users_t * p_users, SSL * p_ssl, char * p_buffer)
 
     int user_count = p_users->user_count;
 
-    if (SUCCESS != pthread_mutex_unlock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_register: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_users_register: pthread_mutex_unlock:");
         return FAILURE;
     }
 
@@ -527,7 +556,7 @@ cr_users_register (users_t * p_users, SSL * p_ssl, char * p_buffer)
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_register: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_register: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -540,7 +569,7 @@ cr_users_register (users_t * p_users, SSL * p_ssl, char * p_buffer)
 
     if(FAILURE == return_val)
     {
-        fprintf(stderr, "cr_users_register: cr_users_chk_usr_and_pass");
+        CR_LOG_ERROR("cr_users_register: cr_users_chk_usr_and_pass");
         return FAILURE;
     }
     //NOTE: If the password doesn't meet specifications, the return_val will
@@ -552,7 +581,7 @@ cr_users_register (users_t * p_users, SSL * p_ssl, char * p_buffer)
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_register: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_register: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -562,7 +591,7 @@ cr_users_register (users_t * p_users, SSL * p_ssl, char * p_buffer)
 
     if (FAILURE == return_val)
     {
-        fprintf(stderr, "cr_users_register: cr_users_reg_helper()\n");
+        CR_LOG_ERROR("cr_users_register: cr_users_reg_helper()");
     }
 
     return return_val;
@@ -588,7 +617,7 @@ cr_users_login_helper (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
 {
     if ((NULL == p_users) || (NULL == pp_user) || (NULL == p_logged_in))
     {
-        fprintf(stderr, "cr_users_login_helper: input NULL\n");
+        CR_LOG_ERROR("cr_users_login_helper: input NULL");
         return FAILURE;
     }
 
@@ -605,7 +634,7 @@ cr_users_login_helper (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_login_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_login_helper: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -618,7 +647,7 @@ cr_users_login_helper (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_login_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_login_helper: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -631,7 +660,7 @@ cr_users_login_helper (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_login_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_login_helper: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -650,7 +679,7 @@ cr_users_login_helper (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_login_helper: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_login_helper: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -661,7 +690,7 @@ cr_users_login_helper (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_users_login_helper: cr_msg_send_ack()\n");
+        CR_LOG_ERROR("cr_users_login_helper: cr_msg_send_ack()");
         return return_val;
     }
 
@@ -694,7 +723,7 @@ cr_users_login (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
     if ((NULL == p_users) || (NULL == p_buffer) || (NULL == pp_user) ||
                                                  (NULL == p_logged_in))
     {
-        fprintf(stderr, "cr_users_login: input NULL\n");
+        CR_LOG_ERROR("cr_users_login: input NULL");
         return FAILURE;
     }
 
@@ -706,30 +735,87 @@ cr_users_login (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
 
     int return_val = SUCCESS;
 
-    if (SUCCESS != pthread_mutex_lock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_login: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_users_login: pthread_mutex_lock:");
         return FAILURE;
     }
 
     return_val = cr_users_login_helper(p_users, p_ssl_holder, login_req,
                                                   pp_user, p_logged_in);
 
-    if (SUCCESS != pthread_mutex_unlock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_login: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_users_login: pthread_mutex_unlock:");
         return FAILURE;
     }
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_users_login: cr_msg_send_ack()\n");
+        CR_LOG_ERROR("cr_users_login: cr_msg_send_ack()");
         return return_val;
     }
 
     return SUCCESS;
 }
 
+/**
+ * @brief Logs in a user handed over by the previous server process, which
+ * already checked its password. Nothing is sent.
+ *
+ * @param p_users pointer to users_t struct.
+ * @param p_ssl_holder pointer to struct with SSL and client file descriptors.
+ * @param p_username username.
+ * @param pp_user double pointer to user_t struct to have specified user
+ * assigned to it.
+ * @param p_logged_in pointer to logged in specifier int.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_users_resume (users_t * p_users, ssl_socket_holder_t * p_ssl_holder,
+                 char * p_username, user_t ** pp_user, int * p_logged_in)
+{
+    if ((NULL == p_users) || (NULL == p_ssl_holder) || (NULL == p_username)
+                       || (NULL == pp_user) || (NULL == p_logged_in))
+    {
+        CR_LOG_ERROR("cr_users_resume: input NULL");
+        return FAILURE;
+    }
+
+    int return_val = FAILURE;
+
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
+    {
+        CR_LOG_ERRNO("cr_users_resume: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    user_t * p_user = h_table_return_entry(p_users->p_users_table,
+                                                       p_username);
+
+    if ((NULL == p_user) || (LOGGED_IN == p_user->login_status))
+    {
+        CR_LOG_WARN("cr_users_resume: %s can not be logged in", p_username);
+    }
+    else
+    {
+        p_user->p_ssl_holder = p_ssl_holder;
+        p_user->login_status = LOGGED_IN;
+        *pp_user = p_user;
+        p_users->client_count++;
+        *p_logged_in = LOGGED_IN;
+        return_val = SUCCESS;
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
+    {
+        CR_LOG_ERRNO("cr_users_resume: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    return return_val;
+}
+
 /**
  * @brief Critical section that inspects the hash table for the specified user.
  * Checks the specified user for logged in status and sets admin status to
@@ -748,7 +834,7 @@ cr_users_admin_helper_2 (users_t * p_users, char * p_username,
 {
     if (NULL == p_users)
     {
-        fprintf(stderr, "cr_users_admin_helper_2: input NULL\n");
+        CR_LOG_ERROR("cr_users_admin_helper_2: input NULL");
         return FAILURE;
     }
 
@@ -787,15 +873,15 @@ cr_users_admin_helper_1 (users_t * p_users, admin_req_t admin_req,
 {
     if (NULL == p_users)
     {
-        fprintf(stderr, "cr_users_admin_helper_1: input NULL\n");
+        CR_LOG_ERROR("cr_users_admin_helper_1: input NULL");
         return FAILURE;
     }
 
     int return_val;
 
-    if (SUCCESS != pthread_mutex_lock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_admin_helper_1: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_users_admin_helper_1: pthread_mutex_lock:");
         return FAILURE;
     }
 
@@ -804,14 +890,14 @@ cr_users_admin_helper_1 (users_t * p_users, admin_req_t admin_req,
     return_val = cr_users_admin_helper_2(p_users, admin_req.p_username,
                                                        admin_set_to);
 
-    if (SUCCESS != pthread_mutex_unlock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_admin_helper_1: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_users_admin_helper_1: pthread_mutex_unlock:");
 
         if (FAILURE == return_val)
         {
-            fprintf(stderr, "cr_users_admin_helper_1:"
-                       "cr_users_admin_helper_2()\n");
+            CR_LOG_ERROR("cr_users_admin_helper_1:"
+                       "cr_users_admin_helper_2()");
         }
 
         return FAILURE;
@@ -819,8 +905,8 @@ cr_users_admin_helper_1 (users_t * p_users, admin_req_t admin_req,
 
     if (FAILURE == return_val)
     {
-        fprintf(stderr, "cr_users_admin_helper_1:"
-                   "cr_users_admin_helper_2()\n");
+        CR_LOG_ERROR("cr_users_admin_helper_1:"
+                   "cr_users_admin_helper_2()");
         return FAILURE;
     }
 
@@ -831,8 +917,8 @@ cr_users_admin_helper_1 (users_t * p_users, admin_req_t admin_req,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_admin_helper_1: "
-                                "cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_admin_helper_1: "
+                                "cr_msg_send_rej()");
         }
 
         return return_val;
@@ -842,8 +928,8 @@ cr_users_admin_helper_1 (users_t * p_users, admin_req_t admin_req,
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_users_admin_helper_1: "
-                            "cr_msg_send_ack()\n");
+        CR_LOG_ERROR("cr_users_admin_helper_1: "
+                            "cr_msg_send_ack()");
     }
 
     return return_val;
@@ -868,7 +954,7 @@ cr_users_admin (users_t * p_users, SSL * p_ssl, char * p_buffer,
 {
     if ((NULL == p_users) || (NULL == p_buffer) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_users_admin: input NULL\n");
+        CR_LOG_ERROR("cr_users_admin: input NULL");
         return FAILURE;
     }
 
@@ -890,15 +976,15 @@ cr_users_admin (users_t * p_users, SSL * p_ssl, char * p_buffer,
 
     int return_val = SUCCESS;
 
-    if (SUCCESS == strncmp(p_user->p_username, admin_req.p_username,
-                                               MAX_USERNAME_LENGTH))
+    if (p_user->p_name == cr_names_find(admin_req.p_username,
+                                        MAX_USERNAME_LENGTH))
     {
         return_val = cr_msg_send_rej(p_ssl, ACCOUNT_TYPE, sub_type,
                                                            ADMIN_SELF);
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_admin: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_admin: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -911,7 +997,7 @@ cr_users_admin (users_t * p_users, SSL * p_ssl, char * p_buffer,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_admin: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_admin: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -922,7 +1008,7 @@ cr_users_admin (users_t * p_users, SSL * p_ssl, char * p_buffer,
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_users_admin: cr_users_admin_helper_1()\n");
+        CR_LOG_ERROR("cr_users_admin: cr_users_admin_helper_1()");
     }
 
     return return_val;
@@ -947,7 +1033,7 @@ cr_users_logout (users_t * p_users, SSL * p_ssl, user_t * p_user,
 {
     if ((NULL == p_users) || (NULL == p_user) || (NULL == p_logged_in))
     {
-        fprintf(stderr, "cr_users_logout: input NULL\n");
+        CR_LOG_ERROR("cr_users_logout: input NULL");
         return FAILURE;
     }
 
@@ -957,23 +1043,23 @@ cr_users_logout (users_t * p_users, SSL * p_ssl, user_t * p_user,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_logout: cr_msg_send_ack()\n");
+            CR_LOG_ERROR("cr_users_logout: cr_msg_send_ack()");
             return return_val;
         }
     }
 
-    if (SUCCESS != pthread_mutex_lock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_logout: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_users_logout: pthread_mutex_lock:");
         return FAILURE;
     }
 
     p_user->login_status = NOT_LOGGED_IN;
     p_users->client_count--;
 
-    if (SUCCESS != pthread_mutex_unlock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_logout: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_users_logout: pthread_mutex_unlock:");
         return FAILURE;
     }
 
@@ -995,7 +1081,7 @@ cr_users_remove_table (users_t * p_users, SSL * p_ssl, char * p_username)
 {
     if ((NULL == p_users) || (NULL == p_username))
     {
-        fprintf(stderr, "cr_users_remove_table: input NULL\n");
+        CR_LOG_ERROR("cr_users_remove_table: input NULL");
         return FAILURE;
     }
 
@@ -1011,7 +1097,7 @@ cr_users_remove_table (users_t * p_users, SSL * p_ssl, char * p_username)
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_remove_table: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_remove_table: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -1024,7 +1110,7 @@ cr_users_remove_table (users_t * p_users, SSL * p_ssl, char * p_username)
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_remove_table: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_remove_table: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -1032,17 +1118,20 @@ cr_users_remove_table (users_t * p_users, SSL * p_ssl, char * p_username)
 
     if (NULL == h_table_destroy_entry(p_users->p_users_table, p_username))
     {
-        fprintf(stderr, "cr_users_remove_table: cr_msg_send_rej()\n");
+        CR_LOG_ERROR("cr_users_remove_table: cr_msg_send_rej()");
         return FAILURE;
     }
 
+    cr_cluster_user_del(p_username);
+
     return_val = cr_msg_send_ack(p_ssl, ACCOUNT_TYPE, DEL_STYPE);
 
     if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
     {
-        fprintf(stderr, "cr_users_remove_table: cr_msg_send_ack()\n");
+        CR_LOG_ERROR("cr_users_remove_table: cr_msg_send_ack()");
     }
 
+    cr_names_release(p_user->p_name);
     FREE(p_user);
     return return_val;
 }
@@ -1059,7 +1148,7 @@ cr_users_remove_file (users_t * p_users, char * p_username)
 {
     if ((NULL == p_users) || (NULL == p_username))
     {
-        fprintf(stderr, "cr_users_remove_file: input NULL\n");
+        CR_LOG_ERROR("cr_users_remove_file: input NULL");
         return FAILURE;
     }
 
@@ -1074,7 +1163,7 @@ cr_users_remove_file (users_t * p_users, char * p_username)
 
     if ((NULL == file_pointer) || (NULL == file_pointer_2))
     {
-        perror("cr_users_remove_file: fopen");
+        CR_LOG_ERRNO("cr_users_remove_file: fopen");
         return FAILURE;
     }
 
@@ -1088,19 +1177,19 @@ cr_users_remove_file (users_t * p_users, char * p_username)
 
     if (EOF == fclose(file_pointer))
     {
-        perror("cr_users_remove_file: fclose:");
+        CR_LOG_ERRNO("cr_users_remove_file: fclose:");
         return FAILURE;
     }
 
     if (EOF == fclose(file_pointer_2))
     {
-        perror("cr_users_remove_file: fclose:");
+        CR_LOG_ERRNO("cr_users_remove_file: fclose:");
         return FAILURE;
     }
 
     if (FAILURE_NEGATIVE == rename(USER_BACKUP_FILENAME, USER_FILENAME))
     {
-        perror("cr_users_remove_file: rename:");
+        CR_LOG_ERRNO("cr_users_remove_file: rename:");
         return FAILURE;
     }
 
@@ -1122,7 +1211,7 @@ cr_users_remove_user (users_t * p_users, SSL * p_ssl, char * p_buffer,
 {
     if ((NULL == p_users) || (NULL == p_buffer) || (NULL == p_user))
     {
-        fprintf(stderr, "cr_users_remove_user: input NULL\n");
+        CR_LOG_ERROR("cr_users_remove_user: input NULL");
         return FAILURE;
     }
 
@@ -1136,7 +1225,7 @@ cr_users_remove_user (users_t * p_users, SSL * p_ssl, char * p_buffer,
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_remove_user: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_remove_user: cr_msg_send_rej()");
         }
 
         return return_val;
@@ -1147,23 +1236,23 @@ cr_users_remove_user (users_t * p_users, SSL * p_ssl, char * p_buffer,
     memcpy(&delete_req, p_buffer, sizeof(delete_req_t));
     delete_req.p_username[MAX_USERNAME_LENGTH] = '\0';
 
-    if (SUCCESS == strncmp(p_user->p_username, delete_req.p_username,
-                                                MAX_USERNAME_LENGTH))
+    if (p_user->p_name == cr_names_find(delete_req.p_username,
+                                         MAX_USERNAME_LENGTH))
     {
         return_val = cr_msg_send_rej(p_ssl, ACCOUNT_TYPE, DEL_STYPE,
                                                             ADMIN_SELF);
 
         if ((FAILURE == return_val) || (CONNECTION_FAILURE == return_val))
         {
-            fprintf(stderr, "cr_users_remove_user: cr_msg_send_rej()\n");
+            CR_LOG_ERROR("cr_users_remove_user: cr_msg_send_rej()");
         }
 
         return return_val;
     }
 
-    if (SUCCESS != pthread_mutex_lock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_remove_user: pthread_mutex_lock:");
+        CR_LOG_ERRNO("cr_users_remove_user: pthread_mutex_lock:");
         return FAILURE;
     }
 
@@ -1171,28 +1260,150 @@ cr_users_remove_user (users_t * p_users, SSL * p_ssl, char * p_buffer,
 
     return_val_2 = cr_users_remove_file(p_users, delete_req.p_username);
 
-    if (SUCCESS != pthread_mutex_unlock(p_users->p_users_mutex))
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
     {
-        perror("cr_users_remove_user: pthread_mutex_unlock:");
+        CR_LOG_ERRNO("cr_users_remove_user: pthread_mutex_unlock:");
         return FAILURE;
     }
 
     if ((FAILURE == return_val) || (FAILURE == return_val_2))
     {
-        fprintf(stderr, "cr_users_remove_user: cr_users_remove_table()/"
-                                              "cr_users_remove_file\n");
+        CR_LOG_ERROR("cr_users_remove_user: cr_users_remove_table()/"
+                                              "cr_users_remove_file");
         return FAILURE;
     }
 
     if ((CONNECTION_FAILURE == return_val) ||
         (CONNECTION_FAILURE == return_val_2))
     {
-        fprintf(stderr, "cr_users_remove_user: cr_users_remove_table()/"
-                                              "cr_users_remove_file\n");
+        CR_LOG_ERROR("cr_users_remove_user: cr_users_remove_table()/"
+                                              "cr_users_remove_file");
         return CONNECTION_FAILURE;
     }
 
     return SUCCESS;
 }
 
+/**
+ * @brief Adds a user registered on another cluster node. Does nothing if the
+ * user is already here, and does not tell the other nodes again.
+ *
+ * @param p_users pointer to users_t struct.
+ * @param p_username username.
+ * @param p_password password.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_users_add_remote (users_t * p_users, char * p_username, char * p_password)
+{
+    if ((NULL == p_users) || (NULL == p_username) || (NULL == p_password))
+    {
+        CR_LOG_ERROR("cr_users_add_remote: input NULL");
+        return FAILURE;
+    }
+
+    char p_userpass[MAX_USERNAME_LENGTH + MAX_PASSWORD_LENGTH + 4] = {0};
+
+    snprintf(p_userpass, (MAX_USERNAME_LENGTH + MAX_PASSWORD_LENGTH + 3),
+                                          "%s:%s", p_username, p_password);
+
+    int return_val = SUCCESS;
+
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
+    {
+        CR_LOG_ERRNO("cr_users_add_remote: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    if ((NULL == h_table_return_entry(p_users->p_users_table, p_username)) &&
+        (SUCCESS == cr_users_chk_usr_and_pass(p_username, p_password,
+                                                 p_users->user_count)))
+    {
+        return_val = cr_users_add_user_table(p_users, p_username, p_password);
+
+        if (SUCCESS == return_val)
+        {
+            return_val = cr_users_add_user_file(p_users, p_userpass);
+        }
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
+    {
+        CR_LOG_ERRNO("cr_users_add_remote: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_users_add_remote: cr_users_add_user_table()/"
+                                              "cr_users_add_user_file()");
+    }
+
+    return return_val;
+}
+
+/**
+ * @brief Removes a user deleted on another cluster node. A user that is not
+ * here, is logged in here or is an admin is left alone, and the other nodes
+ * are not told again.
+ *
+ * @param p_users pointer to users_t struct.
+ * @param p_username username.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+cr_users_remove_remote (users_t * p_users, char * p_username)
+{
+    if ((NULL == p_users) || (NULL == p_username))
+    {
+        CR_LOG_ERROR("cr_users_remove_remote: input NULL");
+        return FAILURE;
+    }
+
+    int return_val = SUCCESS;
+
+    if (SUCCESS != CR_MUTEX_LOCK(p_users->p_users_mutex))
+    {
+        CR_LOG_ERRNO("cr_users_remove_remote: pthread_mutex_lock:");
+        return FAILURE;
+    }
+
+    user_t * p_user = h_table_return_entry(p_users->p_users_table,
+                                                      p_username);
+
+    if ((NULL != p_user) && ((ADMIN == p_user->admin_status) ||
+        (p_user->p_name == cr_names_find("admin", MAX_NAME_LENGTH))))
+    {
+        CR_LOG_WARN("cr_users_remove_remote: refused to remove admin %s",
+                                                            p_username);
+    }
+    else if ((NULL != p_user) && (LOGGED_IN != p_user->login_status))
+    {
+        if (NULL == h_table_destroy_entry(p_users->p_users_table, p_username))
+        {
+            return_val = FAILURE;
+        }
+        else
+        {
+            cr_names_release(p_user->p_name);
+            FREE(p_user);
+            return_val = cr_users_remove_file(p_users, p_username);
+        }
+    }
+
+    if (SUCCESS != CR_MUTEX_UNLOCK(p_users->p_users_mutex))
+    {
+        CR_LOG_ERRNO("cr_users_remove_remote: pthread_mutex_unlock:");
+        return FAILURE;
+    }
+
+    if (FAILURE == return_val)
+    {
+        CR_LOG_ERROR("cr_users_remove_remote: h_table_destroy_entry()/"
+                                              "cr_users_remove_file()");
+    }
+
+    return return_val;
+}
+
 //End of cr_users.c file
@@ -1,5 +1,55 @@
 #include "t_pool.h"
 
+//NOTE: Tasks come from a slab shared by every thread pool, so adding and
+//removing them does not go through malloc. If the slab can not be created
+//they fall back to calloc and free.
+static slab_t * p_t_pool_task_slab = NULL;
+static pthread_once_t t_pool_task_slab_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Creates the t_pool_task slab once per process.
+ */
+static void
+t_pool_task_slab_init ()
+{
+    p_t_pool_task_slab = slab_init(sizeof(task_t));
+}
+
+/**
+ * @brief Allocates a zeroed task.
+ * 
+ * @return task_t* pointer to the task. NULL returned on failure.
+ */
+static task_t *
+t_pool_task_alloc ()
+{
+    pthread_once(&t_pool_task_slab_once, t_pool_task_slab_init);
+
+    if (NULL == p_t_pool_task_slab)
+    {
+        return calloc(1, sizeof(task_t));
+    }
+
+    return slab_alloc(p_t_pool_task_slab);
+}
+
+/**
+ * @brief Frees a task from t_pool_task_alloc.
+ * 
+ * @param p_task_holder pointer to the task.
+ */
+static void
+t_pool_task_free (void * p_task_holder)
+{
+    if (NULL == p_t_pool_task_slab)
+    {
+        free(p_task_holder);
+        return;
+    }
+
+    slab_free(p_task_holder);
+}
+
 //prototype function enabling t_pool_init
 static void * t_pool_worker ();
 
@@ -108,13 +158,11 @@ t_pool_init (uint8_t * num_threads)
     p_t_pool->shutdown = CONTINUE;
     p_t_pool->queue_shutdown = CONTINUE;
 
-        p_t_pool->p_task_queue = queue_init();
-
-    if (NULL == p_t_pool->p_task_queue)
+    if (SUCCESS != queue_intrusive_init(&(p_t_pool->task_queue)))
     {
         FREE(p_t_pool->p_threads);
         FREE(p_t_pool);
-        fprintf(stderr, "t_pool_init: queue_init failure\n");
+        fprintf(stderr, "t_pool_init: queue_intrusive_init failure\n");
         return NULL;
     }
     
@@ -163,7 +211,7 @@ t_pool_worker (t_pool_t * p_t_pool)
             return NULL;
         }
 
-        int queue_size_holder = queue_size(p_t_pool->p_task_queue);
+        int queue_size_holder = queue_intrusive_size(&(p_t_pool->task_queue));
 
         if (FAILURE_NEGATIVE == queue_size_holder)
         {
@@ -187,7 +235,7 @@ t_pool_worker (t_pool_t * p_t_pool)
                 return NULL;
             }
 
-            queue_size_holder = queue_size(p_t_pool->p_task_queue);
+            queue_size_holder = queue_intrusive_size(&(p_t_pool->task_queue));
 
             if (FAILURE_NEGATIVE == queue_size_holder)
             {
@@ -207,9 +255,10 @@ t_pool_worker (t_pool_t * p_t_pool)
             break;
         }
 
-        task_t * p_temp_task = queue_dequeue(p_t_pool->p_task_queue, NULL);
+        queue_link_t * p_link = queue_intrusive_dequeue(
+                                        &(p_t_pool->task_queue));
         
-        if (NULL == p_temp_task)
+        if (NULL == p_link)
         {
             fprintf(stderr, "t_pool_worker: queue_dequeue failure\n");
             return NULL;
@@ -221,6 +270,8 @@ t_pool_worker (t_pool_t * p_t_pool)
             return NULL;
         }
 
+        task_t * p_temp_task = QUEUE_CONTAINER(p_link, task_t, link);
+
         if (NULL == p_temp_task->p_function)
         {
             fprintf(stderr, "t_pool_worker: task function NULL\n");
@@ -228,7 +279,7 @@ t_pool_worker (t_pool_t * p_t_pool)
         }
 
         p_temp_task->p_function(p_temp_task->p_arg);
-        FREE(p_temp_task);
+        t_pool_task_free(p_temp_task);
     }
     while (CONTINUE == p_t_pool->shutdown);
 
@@ -259,11 +310,11 @@ t_pool_submit_task (t_pool_t * p_t_pool, void (*p_function)(void *),
         return FAILURE;
     }
 
-    task_t * p_task = calloc(1, sizeof(task_t));
+    task_t * p_task = t_pool_task_alloc();
 
     if (NULL == p_task)
     {
-        perror("t_pool_submit_task: p_task calloc");
+        fprintf(stderr, "t_pool_submit_task: p_task alloc failure\n");
         return FAILURE;
     }
 
@@ -273,28 +324,29 @@ t_pool_submit_task (t_pool_t * p_t_pool, void (*p_function)(void *),
     if (SUCCESS != pthread_mutex_lock(&(p_t_pool->queue_access_mutex)))
     {
         perror("t_pool_submit_task: pthread_mutex_lock:");
-        FREE(p_task);
+        t_pool_task_free(p_task);
         return FAILURE;
     }
 
-    if (FAILURE == queue_enqueue(p_t_pool->p_task_queue, p_task))
+    if (FAILURE == queue_intrusive_enqueue(&(p_t_pool->task_queue),
+                                                    &(p_task->link)))
     {
         fprintf(stderr, "t_pool_submit_task: queue_enqueue failure\n");
-        FREE(p_task);
+        t_pool_task_free(p_task);
         return FAILURE;
     }
 
     if (SUCCESS != pthread_mutex_unlock(&(p_t_pool->queue_access_mutex)))
     {
         perror("t_pool_submit_task: pthread_mutex_unlock:");
-        FREE(p_task);
+        t_pool_task_free(p_task);
         return FAILURE;
     }
     
     if (SUCCESS != pthread_cond_signal(&(p_t_pool->queue_wait_cond)))
     {
         perror("t_pool_submit_task: pthread_cond_signal:");
-        FREE(p_task);
+        t_pool_task_free(p_task);
         return FAILURE;
     }
 
@@ -317,7 +369,7 @@ t_pool_destroy_wait (t_pool_t * p_t_pool)
         return FAILURE;
     }
 
-    int queue_size_holder = queue_size(p_t_pool->p_task_queue);
+    int queue_size_holder = queue_intrusive_size(&(p_t_pool->task_queue));
 
     if (FAILURE_NEGATIVE == queue_size_holder)
     {
@@ -335,7 +387,7 @@ t_pool_destroy_wait (t_pool_t * p_t_pool)
             return FAILURE;
         }
 
-        queue_size_holder = queue_size(p_t_pool->p_task_queue);
+        queue_size_holder = queue_intrusive_size(&(p_t_pool->task_queue));
 
         if (FAILURE_NEGATIVE == queue_size_holder)
         {
@@ -457,13 +509,13 @@ t_pool_destroy (t_pool_t * p_t_pool, int handle)
         return FAILURE;
     }
 
-    if (FAILURE == queue_full_destroy(&(p_t_pool->p_task_queue), &free))
+    queue_link_t * p_link = NULL;
+
+    while (NULL != (p_link = queue_intrusive_dequeue(&(p_t_pool->task_queue))))
     {
-        FREE(p_t_pool);
-        fprintf(stderr, "t_pool_destroy: queue_full_destroy failure\n");
-        return FAILURE;
+        t_pool_task_free(QUEUE_CONTAINER(p_link, task_t, link));
     }
-    
+
     FREE(p_t_pool);
 
     return SUCCESS;
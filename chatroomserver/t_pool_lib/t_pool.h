@@ -7,6 +7,7 @@
 #include <stdint.h>
 
 #include "../queue_lib/queue.h"
+#include "../slab_lib/slab.h"
 
 #ifndef SHARED_MACROS
 #define SHARED_MACROS
@@ -88,10 +89,12 @@
 /**
  * @brief Task structure for thread pool library.
  *
+ * @param link link in the pool's task queue.
  * @param p_function pointer to user-supplied function.
  * @param p_arg pointer to user-supplied argument. 
  */
 typedef struct task_t {
+    queue_link_t link;
     void (*p_function)(void * p_arg);
     void * p_arg;
 } task_t;
@@ -107,8 +110,8 @@ typedef struct task_t {
  * @param shutdown flag for shutdown processes.
  * @param queue_shutdown flag for shutdown processes.
  * @param p_threads pointer to thread list.
- * @param p_task_queue queue created using queue_lib, holds all submitted 
- * tasks.
+ * @param task_queue intrusive queue from queue_lib, holds all submitted
+ * tasks. Queueing a task does not allocate a node.
  */
 typedef struct t_pool_t {
     pthread_mutex_t queue_access_mutex;
@@ -118,7 +121,7 @@ typedef struct t_pool_t {
     uint8_t shutdown;
     uint8_t queue_shutdown;
     pthread_t * p_threads;
-    queue_t * p_task_queue;
+    queue_intrusive_t task_queue;
     //Mutexes for use in the chat room server implementation
     pthread_mutex_t users_mutex;
     pthread_mutex_t rooms_mutex;
@@ -0,0 +1,647 @@
+//NOTE: Turns a flight recorder dump (cr_trace_<pid>_<n>.bin) into a Chrome
+//trace that chrome://tracing or ui.perfetto.dev can open. Each server thread
+//is a row; dispatches, lock waits, lock holds, SSL writes, log appends and
+//log rotations are slices and received packets are instants.
+//
+//Usage: chat_room_trace_decode [-o output file] dump file
+
+#include <getopt.h>
+
+#include "../include/cr_shared.h"
+#include "../include/cr_trace.h"
+
+//Locks one thread can wait on or hold at once.
+#define DECODE_OPEN_LOCKS 16
+
+//Longest site name printed: "name @ function:line".
+#define DECODE_SITE_NAME 128
+
+//Slices that begin and end on the same thread and do not nest with
+//themselves.
+#define DECODE_DISPATCH 0
+#define DECODE_SSL_WRITE 1
+#define DECODE_LOG_APPEND 2
+#define DECODE_LOG_ROTATE 3
+#define DECODE_SLICES 4
+
+typedef struct {
+    int      open;
+    uint64_t ticks;
+    uint32_t arg;
+} decode_slice_t;
+
+typedef struct {
+    uint32_t mutex;
+    uint16_t site;
+    uint64_t ticks;
+} decode_lock_t;
+
+typedef struct {
+    decode_slice_t p_slices[DECODE_SLICES];
+    decode_lock_t  p_waits[DECODE_OPEN_LOCKS];
+    decode_lock_t  p_holds[DECODE_OPEN_LOCKS];
+    int            wait_count;
+    int            hold_count;
+} decode_thread_t;
+
+static const char * pp_slice_names[DECODE_SLICES] = {
+    "dispatch", "SSL_write", "log append", "log rotate"
+};
+
+//NOTE: Same names the metrics endpoint uses for packet types and sub types.
+static const char * pp_type_names[] = {
+    "rooms", "account", "chat", "session"
+};
+
+static const char * pp_stype_names[] = {
+    "join", "list", "create", "register", "login", "admin", "chat", "fail",
+    "delete", "admin_remove", "leave", "logout", "quit", "version",
+    "compress", "unknown"
+};
+
+static char pp_site_names[TRACE_MAX_SITES][DECODE_SITE_NAME];
+static uint32_t trace_pid = 0;
+static uint64_t base_ticks = UINT64_MAX;
+static double ns_per_tick = 1.0;
+static int first_event = 1;
+
+/**
+ * @brief Reads a whole file into memory.
+ *
+ * @param p_path file to read.
+ * @param p_length set to the number of bytes read.
+ * @return char* the bytes, to be freed by the caller, or NULL.
+ */
+static char *
+decode_read_file (const char * p_path, size_t * p_length)
+{
+    FILE * p_file = fopen(p_path, "rb");
+
+    if (NULL == p_file)
+    {
+        perror("decode_read_file: fopen");
+        return NULL;
+    }
+
+    char * p_data = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    size_t read_bytes = 0;
+
+    do
+    {
+        if (length == capacity)
+        {
+            capacity = (0 == capacity) ? (1 << 20) : (capacity * 2);
+            char * p_grown = realloc(p_data, capacity);
+
+            if (NULL == p_grown)
+            {
+                perror("decode_read_file: realloc");
+                FREE(p_data);
+                fclose(p_file);
+                return NULL;
+            }
+
+            p_data = p_grown;
+        }
+
+        read_bytes = fread((p_data + length), 1, (capacity - length), p_file);
+        length += read_bytes;
+    } while (0 < read_bytes);
+
+    fclose(p_file);
+    *p_length = length;
+
+    return p_data;
+}
+
+/**
+ * @brief Starts the next trace event object, separating it from the one
+ * before.
+ *
+ * @param p_out stream to write to.
+ */
+static void
+decode_next (FILE * p_out)
+{
+    fprintf(p_out, "%s\n    ", (first_event) ? "" : ",");
+    first_event = 0;
+}
+
+/**
+ * @brief Converts an event time stamp to microseconds since the first
+ * event in the dump.
+ *
+ * @param ticks event time stamp.
+ * @return double microseconds.
+ */
+static double
+decode_us (uint64_t ticks)
+{
+    return ((ticks - base_ticks) * ns_per_tick) / 1000.0;
+}
+
+/**
+ * @brief Writes the name of a dispatched packet, e.g. "dispatch chat/chat".
+ *
+ * @param p_name buffer to write to.
+ * @param length size of p_name.
+ * @param arg dispatch argument: (type << 8) | sub type.
+ */
+static void
+decode_dispatch_name (char * p_name, size_t length, uint32_t arg)
+{
+    uint8_t type = (arg >> 8) & 0xFF;
+    uint8_t s_type = arg & 0xFF;
+
+    if ((type < (sizeof(pp_type_names) / sizeof(char *))) &&
+        (s_type < (sizeof(pp_stype_names) / sizeof(char *))))
+    {
+        snprintf(p_name, length, "dispatch %s/%s", pp_type_names[type],
+                                                   pp_stype_names[s_type]);
+    }
+    else
+    {
+        snprintf(p_name, length, "dispatch %u/%u", type, s_type);
+    }
+}
+
+/**
+ * @brief Writes a slice with a known start and end.
+ *
+ * @param p_out stream to write to.
+ * @param p_name slice name.
+ * @param p_category slice category.
+ * @param tid thread the slice ran on.
+ * @param start_ticks start of the slice.
+ * @param end_ticks end of the slice.
+ * @param p_args JSON object body for args, may be empty.
+ */
+static void
+decode_complete (FILE * p_out, const char * p_name, const char * p_category,
+                 uint32_t tid, uint64_t start_ticks, uint64_t end_ticks,
+                 const char * p_args)
+{
+    decode_next(p_out);
+    fprintf(p_out, "{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+            "\"ts\": %.3f, \"dur\": %.3f, \"pid\": %u, \"tid\": %u, "
+            "\"args\": {%s}}", p_name, p_category, decode_us(start_ticks),
+            (decode_us(end_ticks) - decode_us(start_ticks)), trace_pid, tid,
+            p_args);
+}
+
+/**
+ * @brief Writes a slice that was still open when the dump was taken.
+ *
+ * @param p_out stream to write to.
+ * @param p_name slice name.
+ * @param p_category slice category.
+ * @param tid thread the slice ran on.
+ * @param start_ticks start of the slice.
+ */
+static void
+decode_begin (FILE * p_out, const char * p_name, const char * p_category,
+              uint32_t tid, uint64_t start_ticks)
+{
+    decode_next(p_out);
+    fprintf(p_out, "{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"B\", "
+            "\"ts\": %.3f, \"pid\": %u, \"tid\": %u}", p_name, p_category,
+            decode_us(start_ticks), trace_pid, tid);
+}
+
+/**
+ * @brief Writes the name of a lock site, or its id if the dump has no name
+ * for it.
+ *
+ * @param p_name buffer to write to.
+ * @param length size of p_name.
+ * @param p_prefix "wait" or "hold".
+ * @param site site id.
+ */
+static void
+decode_lock_name (char * p_name, size_t length, const char * p_prefix,
+                                                         uint16_t site)
+{
+    if ((TRACE_MAX_SITES > site) && ('\0' != pp_site_names[site][0]))
+    {
+        snprintf(p_name, length, "%s %s", p_prefix, pp_site_names[site]);
+    }
+    else
+    {
+        snprintf(p_name, length, "%s lock site %u", p_prefix, site);
+    }
+}
+
+/**
+ * @brief Removes an open lock by mutex, returning it.
+ *
+ * @param p_locks open locks.
+ * @param p_count number of open locks.
+ * @param mutex mutex to find.
+ * @param p_lock set to the removed lock.
+ * @return int SUCCESS (0) or FAILURE (1) if the mutex was not open.
+ */
+static int
+decode_lock_take (decode_lock_t * p_locks, int * p_count, uint32_t mutex,
+                                                     decode_lock_t * p_lock)
+{
+    for (int idx = (*p_count - 1); idx >= 0; idx--)
+    {
+        if (mutex != p_locks[idx].mutex)
+        {
+            continue;
+        }
+
+        *p_lock = p_locks[idx];
+        (*p_count)--;
+        memmove(&p_locks[idx], &p_locks[idx + 1],
+                (*p_count - idx) * sizeof(decode_lock_t));
+
+        return SUCCESS;
+    }
+
+    return FAILURE;
+}
+
+/**
+ * @brief Adds an open lock, dropping the oldest if the table is full.
+ *
+ * @param p_locks open locks.
+ * @param p_count number of open locks.
+ * @param p_event lock event.
+ */
+static void
+decode_lock_put (decode_lock_t * p_locks, int * p_count,
+                 const cr_trace_event_t * p_event)
+{
+    if (DECODE_OPEN_LOCKS == *p_count)
+    {
+        (*p_count)--;
+        memmove(&p_locks[0], &p_locks[1],
+                *p_count * sizeof(decode_lock_t));
+    }
+
+    p_locks[*p_count].mutex = p_event->arg;
+    p_locks[*p_count].site = p_event->site;
+    p_locks[*p_count].ticks = p_event->ticks;
+    (*p_count)++;
+}
+
+/**
+ * @brief Turns one event into trace output, pairing it with the open slice
+ * it ends.
+ *
+ * @param p_out stream to write to.
+ * @param p_thread the thread's open slices.
+ * @param tid thread the event ran on.
+ * @param p_event event to decode.
+ */
+static void
+decode_event (FILE * p_out, decode_thread_t * p_thread, uint32_t tid,
+              const cr_trace_event_t * p_event)
+{
+    char p_name[DECODE_SITE_NAME + 16] = {0};
+    char p_args[64] = {0};
+    decode_lock_t lock;
+    int slice = -1;
+    int begin = 0;
+
+    switch (p_event->event)
+    {
+        case TRACE_PACKET_RECEIVED:
+            decode_next(p_out);
+            fprintf(p_out, "{\"name\": \"packet received\", \"cat\": "
+                    "\"session\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, "
+                    "\"pid\": %u, \"tid\": %u, \"args\": {\"bytes\": %u}}",
+                    decode_us(p_event->ticks), trace_pid, tid,
+                    p_event->arg);
+            return;
+        case TRACE_LOCK_WAIT:
+            decode_lock_put(p_thread->p_waits, &p_thread->wait_count,
+                                                              p_event);
+            return;
+        case TRACE_LOCK_ACQUIRED:
+            if (SUCCESS == decode_lock_take(p_thread->p_waits,
+                            &p_thread->wait_count, p_event->arg, &lock))
+            {
+                decode_lock_name(p_name, sizeof(p_name), "wait",
+                                                     p_event->site);
+                decode_complete(p_out, p_name, "lock", tid, lock.ticks,
+                                                   p_event->ticks, "");
+            }
+
+            decode_lock_put(p_thread->p_holds, &p_thread->hold_count,
+                                                              p_event);
+            return;
+        case TRACE_LOCK_RELEASED:
+            if (SUCCESS == decode_lock_take(p_thread->p_holds,
+                            &p_thread->hold_count, p_event->arg, &lock))
+            {
+                decode_lock_name(p_name, sizeof(p_name), "hold",
+                                                         lock.site);
+                decode_complete(p_out, p_name, "lock", tid, lock.ticks,
+                                                   p_event->ticks, "");
+            }
+            return;
+        case TRACE_DISPATCH_BEGIN:
+            begin = 1;
+            slice = DECODE_DISPATCH;
+            break;
+        case TRACE_DISPATCH_END:
+            slice = DECODE_DISPATCH;
+            break;
+        case TRACE_SSL_WRITE_BEGIN:
+            begin = 1;
+            slice = DECODE_SSL_WRITE;
+            break;
+        case TRACE_SSL_WRITE_END:
+            slice = DECODE_SSL_WRITE;
+            break;
+        case TRACE_LOG_APPEND_BEGIN:
+            begin = 1;
+            slice = DECODE_LOG_APPEND;
+            break;
+        case TRACE_LOG_APPEND_END:
+            slice = DECODE_LOG_APPEND;
+            break;
+        case TRACE_LOG_ROTATE_BEGIN:
+            begin = 1;
+            slice = DECODE_LOG_ROTATE;
+            break;
+        case TRACE_LOG_ROTATE_END:
+            slice = DECODE_LOG_ROTATE;
+            break;
+        default:
+            return;
+    }
+
+    decode_slice_t * p_slice = &p_thread->p_slices[slice];
+
+    if (begin)
+    {
+        p_slice->open = 1;
+        p_slice->ticks = p_event->ticks;
+        p_slice->arg = p_event->arg;
+        return;
+    }
+
+    //NOTE: An end whose begin was overwritten by the ring is dropped.
+    if (!p_slice->open)
+    {
+        return;
+    }
+
+    p_slice->open = 0;
+    snprintf(p_name, sizeof(p_name), "%s", pp_slice_names[slice]);
+
+    if (DECODE_DISPATCH == slice)
+    {
+        decode_dispatch_name(p_name, sizeof(p_name), p_slice->arg);
+    }
+    else if (DECODE_SSL_WRITE == slice)
+    {
+        snprintf(p_args, sizeof(p_args), "\"bytes\": %u, \"written\": %u",
+                                          p_slice->arg, p_event->arg);
+    }
+    else if (DECODE_LOG_APPEND == slice)
+    {
+        snprintf(p_args, sizeof(p_args), "\"seq\": %u", p_slice->arg);
+    }
+
+    decode_complete(p_out, p_name, "server", tid, p_slice->ticks,
+                                         p_event->ticks, p_args);
+}
+
+/**
+ * @brief Writes every event of one thread's ring, oldest first.
+ *
+ * @param p_out stream to write to.
+ * @param p_record ring record.
+ * @param p_events the ring's events.
+ * @param ring_events size of the ring.
+ */
+static void
+decode_ring (FILE * p_out, const cr_trace_ring_record_t * p_record,
+             const cr_trace_event_t * p_events, uint32_t ring_events)
+{
+    decode_thread_t thread;
+    memset(&thread, 0, sizeof(thread));
+
+    uint64_t count = (p_record->head < ring_events) ? p_record->head :
+                                                             ring_events;
+
+    decode_next(p_out);
+    fprintf(p_out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %u, "
+            "\"tid\": %u, \"args\": {\"name\": \"thread %u\"}}", trace_pid,
+            p_record->tid, p_record->tid);
+
+    for (uint64_t seq = (p_record->head - count); seq < p_record->head; seq++)
+    {
+        const cr_trace_event_t * p_event = &p_events[seq % ring_events];
+
+        if (0 != p_event->ticks)
+        {
+            decode_event(p_out, &thread, p_record->tid, p_event);
+        }
+    }
+
+    char p_name[DECODE_SITE_NAME + 16] = {0};
+
+    for (int slice = 0; slice < DECODE_SLICES; slice++)
+    {
+        if (thread.p_slices[slice].open)
+        {
+            decode_begin(p_out, pp_slice_names[slice], "server",
+                         p_record->tid, thread.p_slices[slice].ticks);
+        }
+    }
+
+    for (int idx = 0; idx < thread.hold_count; idx++)
+    {
+        decode_lock_name(p_name, sizeof(p_name), "hold",
+                                      thread.p_holds[idx].site);
+        decode_begin(p_out, p_name, "lock", p_record->tid,
+                               thread.p_holds[idx].ticks);
+    }
+
+    for (int idx = 0; idx < thread.wait_count; idx++)
+    {
+        decode_lock_name(p_name, sizeof(p_name), "wait",
+                                      thread.p_waits[idx].site);
+        decode_begin(p_out, p_name, "lock", p_record->tid,
+                               thread.p_waits[idx].ticks);
+    }
+}
+
+/**
+ * @brief Decodes a dump held in memory.
+ *
+ * @param p_out stream to write to.
+ * @param p_data dump bytes.
+ * @param length number of bytes.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+static int
+decode_dump (FILE * p_out, const char * p_data, size_t length)
+{
+    cr_trace_header_t header;
+
+    if ((sizeof(header) > length) ||
+        (SUCCESS != memcmp(p_data, TRACE_MAGIC, TRACE_MAGIC_LENGTH)))
+    {
+        fprintf(stderr, "decode_dump: not a flight recorder dump\n");
+        return FAILURE;
+    }
+
+    memcpy(&header, p_data, sizeof(header));
+
+    if (0 == header.ring_events)
+    {
+        fprintf(stderr, "decode_dump: empty rings\n");
+        return FAILURE;
+    }
+
+    trace_pid = header.pid;
+
+    //NOTE: Time stamps are ticks of the server's clock; the two reference
+    //pairs in the header give their length in nanoseconds.
+    if ((header.dump_ticks > header.start_ticks) &&
+        (header.dump_ns > header.start_ns))
+    {
+        ns_per_tick = (double) (header.dump_ns - header.start_ns) /
+                      (double) (header.dump_ticks - header.start_ticks);
+    }
+    size_t offset = sizeof(header);
+
+    for (uint32_t count = 0; count < header.site_count; count++)
+    {
+        cr_trace_site_record_t record;
+
+        if ((offset + sizeof(record)) > length)
+        {
+            fprintf(stderr, "decode_dump: truncated site table\n");
+            return FAILURE;
+        }
+
+        memcpy(&record, (p_data + offset), sizeof(record));
+        offset += sizeof(record);
+
+        if ((offset + record.name_len + record.function_len) > length)
+        {
+            fprintf(stderr, "decode_dump: truncated site table\n");
+            return FAILURE;
+        }
+
+        if (TRACE_MAX_SITES > record.id)
+        {
+            snprintf(pp_site_names[record.id], DECODE_SITE_NAME,
+                     "%.*s @ %.*s:%u", record.name_len, (p_data + offset),
+                     record.function_len,
+                     (p_data + offset + record.name_len), record.line);
+        }
+
+        offset += record.name_len + record.function_len;
+    }
+
+    size_t ring_size = sizeof(cr_trace_ring_record_t) +
+                       ((size_t) header.ring_events * sizeof(cr_trace_event_t));
+    size_t rings_offset = offset;
+
+    //NOTE: Timestamps are printed relative to the oldest event in the dump.
+    for (offset = rings_offset; (offset + ring_size) <= length;
+                                             offset += ring_size)
+    {
+        const cr_trace_event_t * p_events = (const cr_trace_event_t *)
+                       (p_data + offset + sizeof(cr_trace_ring_record_t));
+
+        for (uint32_t idx = 0; idx < header.ring_events; idx++)
+        {
+            if ((0 != p_events[idx].ticks) &&
+                (base_ticks > p_events[idx].ticks))
+            {
+                base_ticks = p_events[idx].ticks;
+            }
+        }
+    }
+
+    fprintf(p_out, "{\n  \"displayTimeUnit\": \"ns\",\n  \"traceEvents\": [");
+
+    for (offset = rings_offset; (offset + ring_size) <= length;
+                                             offset += ring_size)
+    {
+        cr_trace_ring_record_t record;
+        memcpy(&record, (p_data + offset), sizeof(record));
+
+        decode_ring(p_out, &record, (const cr_trace_event_t *)
+                    (p_data + offset + sizeof(record)), header.ring_events);
+    }
+
+    fprintf(p_out, "\n  ]\n}\n");
+
+    return SUCCESS;
+}
+
+/**
+ * @brief Driver code for the trace decoder.
+ *
+ * @param argc argument count.
+ * @param argv arguments.
+ * @return int SUCCESS (0) or FAILURE (1).
+ */
+int
+main (int argc, char ** argv)
+{
+    const char * p_output = NULL;
+    int option = 0;
+    int usage = 0;
+
+    while (-1 != (option = getopt(argc, argv, "o:")))
+    {
+        switch (option)
+        {
+            case 'o':
+                p_output = optarg;
+                break;
+            default:
+                usage = 1;
+                break;
+        }
+    }
+
+    if ((usage) || ((optind + 1) != argc))
+    {
+        fprintf(stderr, "usage: %s [-o output file] dump file\n", argv[0]);
+        return FAILURE;
+    }
+
+    size_t length = 0;
+    char * p_data = decode_read_file(argv[optind], &length);
+
+    if (NULL == p_data)
+    {
+        return FAILURE;
+    }
+
+    FILE * p_out = stdout;
+
+    if ((NULL != p_output) && (NULL == (p_out = fopen(p_output, "w"))))
+    {
+        perror("main: fopen");
+        FREE(p_data);
+        return FAILURE;
+    }
+
+    int return_val = decode_dump(p_out, p_data, length);
+
+    if (stdout != p_out)
+    {
+        fclose(p_out);
+    }
+
+    FREE(p_data);
+
+    return return_val;
+}
+
+//End of cr_trace_decode.c file